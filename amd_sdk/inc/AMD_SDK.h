@@ -50,6 +50,13 @@
 #include "..\\src\\Geometry.h"
 #include "..\\src\\LineRender.h"
 #include "..\\src\\AMD_Mesh.h"
+#include "..\\src\\MeshOptimizer.h"
+#include "..\\src\\MeshSimplifier.h"
+#include "..\\src\\Meshlet.h"
+#include "..\\src\\MeshletMesh.h"
+#include "..\\src\\PointLights.h"
+#include "..\\src\\CameraPath.h"
+#include "..\\src\\BenchmarkReport.h"
 
 #ifndef ARRAYSIZE
 #define ARRAYSIZE(A) (sizeof(A)/sizeof((A)[0]))
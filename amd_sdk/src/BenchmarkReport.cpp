@@ -0,0 +1,467 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: BenchmarkReport.cpp
+//
+// Collects benchmark values per frame and writes them as CSV and JSON
+//--------------------------------------------------------------------------------------
+#include "BenchmarkReport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    static std::string ToUtf8( const wchar_t* szText )
+    {
+        std::string Result;
+        for ( ; szText && *szText; szText++ )
+        {
+            const unsigned int c = (unsigned int)*szText;
+            if ( c < 0x80 )
+            {
+                Result += (char)c;
+            }
+            else if ( c < 0x800 )
+            {
+                Result += (char)( 0xC0 | ( c >> 6 ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else if ( c < 0x10000 )
+            {
+                Result += (char)( 0xE0 | ( c >> 12 ) );
+                Result += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else
+            {
+                Result += (char)( 0xF0 | ( c >> 18 ) );
+                Result += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+        }
+        return Result;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static FILE* OpenOutputFile( const wchar_t* szFileName )
+    {
+        FILE* pFile = NULL;
+#if defined( _WIN32 )
+        if ( _wfopen_s( &pFile, szFileName, L"wb" ) != 0 )
+        {
+            pFile = NULL;
+        }
+#else
+        char szNarrowName[1024];
+        if ( wcstombs( szNarrowName, szFileName, sizeof( szNarrowName ) ) < sizeof( szNarrowName ) )
+        {
+            pFile = fopen( szNarrowName, "wb" );
+        }
+#endif
+        return pFile;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void WriteCsvString( FILE* pFile, const std::string& Text )
+    {
+        if ( Text.find_first_of( ",\"\r\n" ) == std::string::npos )
+        {
+            fputs( Text.c_str(), pFile );
+            return;
+        }
+
+        fputc( '"', pFile );
+        for ( size_t i = 0; i < Text.size(); i++ )
+        {
+            if ( Text[i] == '"' )
+            {
+                fputc( '"', pFile );
+            }
+            fputc( Text[i], pFile );
+        }
+        fputc( '"', pFile );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void WriteJsonString( FILE* pFile, const std::string& Text )
+    {
+        fputc( '"', pFile );
+        for ( size_t i = 0; i < Text.size(); i++ )
+        {
+            const unsigned char c = (unsigned char)Text[i];
+            if ( c == '"' || c == '\\' )
+            {
+                fputc( '\\', pFile );
+                fputc( c, pFile );
+            }
+            else if ( c < 0x20 )
+            {
+                fprintf( pFile, "\\u%04x", c );
+            }
+            else
+            {
+                fputc( c, pFile );
+            }
+        }
+        fputc( '"', pFile );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // JSON has no NaN or infinity, write those as null like values that weren't set
+    //--------------------------------------------------------------------------------------
+    static void WriteJsonNumber( FILE* pFile, double fValue, bool bSet = true )
+    {
+        if ( bSet && fabs( fValue ) <= DBL_MAX )
+        {
+            fprintf( pFile, "%.9g", fValue );
+        }
+        else
+        {
+            fputs( "null", pFile );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::Clear()
+    {
+        m_Info.clear();
+        m_Columns.clear();
+        m_ColumnIndices.clear();
+        m_Runs.clear();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::SetInfo( const wchar_t* szKey, const wchar_t* szValue )
+    {
+        const std::string Key = ToUtf8( szKey );
+        for ( size_t i = 0; i < m_Info.size(); i++ )
+        {
+            if ( m_Info[i].first == Key )
+            {
+                m_Info[i].second = ToUtf8( szValue );
+                return;
+            }
+        }
+        m_Info.push_back( std::make_pair( Key, ToUtf8( szValue ) ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::BeginRun( const wchar_t* szName )
+    {
+        m_Runs.push_back( Run() );
+        m_Runs.back().Name = ToUtf8( szName );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::SetRunParameter( const wchar_t* szKey, double fValue )
+    {
+        if ( m_Runs.empty() )
+        {
+            BeginRun( L"" );
+        }
+        m_Runs.back().Parameters.push_back( std::make_pair( ToUtf8( szKey ), fValue ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::BeginFrame()
+    {
+        if ( m_Runs.empty() )
+        {
+            BeginRun( L"" );
+        }
+        m_Runs.back().Frames.push_back( Frame() );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::SetValue( const wchar_t* szColumn, double fValue )
+    {
+        if ( m_Runs.empty() || m_Runs.back().Frames.empty() )
+        {
+            BeginFrame();
+        }
+
+        SetFrameValue( m_Runs.back().Frames.size() - 1, szColumn, fValue );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BenchmarkReport::SetFrameValue( size_t uFrame, const wchar_t* szColumn, double fValue )
+    {
+        if ( m_Runs.empty() || uFrame >= m_Runs.back().Frames.size() )
+        {
+            return;
+        }
+
+        const std::string Column = ToUtf8( szColumn );
+        std::map<std::string, size_t>::const_iterator it = m_ColumnIndices.find( Column );
+        size_t uColumn;
+        if ( it != m_ColumnIndices.end() )
+        {
+            uColumn = it->second;
+        }
+        else
+        {
+            uColumn = m_Columns.size();
+            m_Columns.push_back( Column );
+            m_ColumnIndices[Column] = uColumn;
+        }
+
+        Frame& F = m_Runs.back().Frames[uFrame];
+        if ( F.Values.size() <= uColumn )
+        {
+            F.Values.resize( uColumn + 1, 0.0 );
+            F.Set.resize( uColumn + 1, 0 );
+        }
+        F.Values[uColumn] = fValue;
+        F.Set[uColumn] = 1;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool BenchmarkReport::Summarize( const Run& R, size_t uColumn, BenchmarkSummary& Summary ) const
+    {
+        std::vector<double> Values;
+        Values.reserve( R.Frames.size() );
+        double fSum = 0.0;
+        for ( size_t f = 0; f < R.Frames.size(); f++ )
+        {
+            if ( R.Frames[f].IsSet( uColumn ) )
+            {
+                Values.push_back( R.Frames[f].Values[uColumn] );
+                fSum += R.Frames[f].Values[uColumn];
+            }
+        }
+
+        if ( Values.empty() )
+        {
+            return false;
+        }
+
+        // Nearest rank percentiles
+        std::sort( Values.begin(), Values.end() );
+        const size_t uCount = Values.size();
+        Summary.fMean = fSum / (double)uCount;
+        Summary.fMin = Values[0];
+        Summary.fP50 = Values[ ( uCount * 50 + 99 ) / 100 - 1 ];
+        Summary.fP95 = Values[ ( uCount * 95 + 99 ) / 100 - 1 ];
+        Summary.fMax = Values[uCount - 1];
+        Summary.uFrames = (unsigned int)uCount;
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool BenchmarkReport::GetSummary( size_t uRun, const wchar_t* szColumn, BenchmarkSummary& Summary ) const
+    {
+        std::map<std::string, size_t>::const_iterator it = m_ColumnIndices.find( ToUtf8( szColumn ) );
+        if ( uRun >= m_Runs.size() || it == m_ColumnIndices.end() )
+        {
+            return false;
+        }
+        return Summarize( m_Runs[uRun], it->second, Summary );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool BenchmarkReport::WriteCsv( const wchar_t* szFileName ) const
+    {
+        FILE* pFile = OpenOutputFile( szFileName );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        // Run parameters become columns too, in order of first use
+        std::vector<std::string> Parameters;
+        for ( size_t r = 0; r < m_Runs.size(); r++ )
+        {
+            for ( size_t p = 0; p < m_Runs[r].Parameters.size(); p++ )
+            {
+                if ( std::find( Parameters.begin(), Parameters.end(), m_Runs[r].Parameters[p].first ) == Parameters.end() )
+                {
+                    Parameters.push_back( m_Runs[r].Parameters[p].first );
+                }
+            }
+        }
+
+        fputs( "run,frame", pFile );
+        for ( size_t p = 0; p < Parameters.size(); p++ )
+        {
+            fputc( ',', pFile );
+            WriteCsvString( pFile, Parameters[p] );
+        }
+        for ( size_t c = 0; c < m_Columns.size(); c++ )
+        {
+            fputc( ',', pFile );
+            WriteCsvString( pFile, m_Columns[c] );
+        }
+        fputs( "\n", pFile );
+
+        for ( size_t r = 0; r < m_Runs.size(); r++ )
+        {
+            const Run& R = m_Runs[r];
+            for ( size_t f = 0; f < R.Frames.size(); f++ )
+            {
+                WriteCsvString( pFile, R.Name );
+                fprintf( pFile, ",%u", (unsigned int)f );
+
+                for ( size_t p = 0; p < Parameters.size(); p++ )
+                {
+                    fputc( ',', pFile );
+                    for ( size_t i = 0; i < R.Parameters.size(); i++ )
+                    {
+                        if ( R.Parameters[i].first == Parameters[p] )
+                        {
+                            fprintf( pFile, "%.9g", R.Parameters[i].second );
+                            break;
+                        }
+                    }
+                }
+
+                const Frame& F = R.Frames[f];
+                for ( size_t c = 0; c < m_Columns.size(); c++ )
+                {
+                    fputc( ',', pFile );
+                    if ( F.IsSet( c ) )
+                    {
+                        fprintf( pFile, "%.9g", F.Values[c] );
+                    }
+                }
+                fputs( "\n", pFile );
+            }
+        }
+
+        const bool bWritten = ferror( pFile ) == 0;
+        return ( fclose( pFile ) == 0 ) && bWritten;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool BenchmarkReport::WriteJson( const wchar_t* szFileName ) const
+    {
+        FILE* pFile = OpenOutputFile( szFileName );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        fputs( "{\n  \"info\": {", pFile );
+        for ( size_t i = 0; i < m_Info.size(); i++ )
+        {
+            fputs( i ? ",\n    " : "\n    ", pFile );
+            WriteJsonString( pFile, m_Info[i].first );
+            fputs( ": ", pFile );
+            WriteJsonString( pFile, m_Info[i].second );
+        }
+        fputs( m_Info.empty() ? "},\n" : "\n  },\n", pFile );
+
+        fputs( "  \"runs\": [", pFile );
+        for ( size_t r = 0; r < m_Runs.size(); r++ )
+        {
+            const Run& R = m_Runs[r];
+            fputs( r ? ",\n    {\n      \"name\": " : "\n    {\n      \"name\": ", pFile );
+            WriteJsonString( pFile, R.Name );
+            fprintf( pFile, ",\n      \"frames\": %u,\n      \"parameters\": {", (unsigned int)R.Frames.size() );
+            for ( size_t p = 0; p < R.Parameters.size(); p++ )
+            {
+                fputs( p ? ", " : " ", pFile );
+                WriteJsonString( pFile, R.Parameters[p].first );
+                fputs( ": ", pFile );
+                WriteJsonNumber( pFile, R.Parameters[p].second );
+            }
+            fputs( R.Parameters.empty() ? "},\n" : " },\n", pFile );
+
+            // Summaries first, so the interesting part is readable without scrolling past the values
+            fputs( "      \"summary\": {", pFile );
+            bool bFirst = true;
+            for ( size_t c = 0; c < m_Columns.size(); c++ )
+            {
+                BenchmarkSummary Summary;
+                if ( !Summarize( R, c, Summary ) )
+                {
+                    continue;
+                }
+                fputs( bFirst ? "\n        " : ",\n        ", pFile );
+                bFirst = false;
+                WriteJsonString( pFile, m_Columns[c] );
+                fputs( ": { \"mean\": ", pFile );
+                WriteJsonNumber( pFile, Summary.fMean );
+                fputs( ", \"min\": ", pFile );
+                WriteJsonNumber( pFile, Summary.fMin );
+                fputs( ", \"p50\": ", pFile );
+                WriteJsonNumber( pFile, Summary.fP50 );
+                fputs( ", \"p95\": ", pFile );
+                WriteJsonNumber( pFile, Summary.fP95 );
+                fputs( ", \"max\": ", pFile );
+                WriteJsonNumber( pFile, Summary.fMax );
+                fprintf( pFile, ", \"frames\": %u }", Summary.uFrames );
+            }
+            fputs( bFirst ? "},\n" : "\n      },\n", pFile );
+
+            fputs( "      \"values\": {", pFile );
+            bFirst = true;
+            for ( size_t c = 0; c < m_Columns.size(); c++ )
+            {
+                BenchmarkSummary Summary;
+                if ( !Summarize( R, c, Summary ) )
+                {
+                    continue;
+                }
+                fputs( bFirst ? "\n        " : ",\n        ", pFile );
+                bFirst = false;
+                WriteJsonString( pFile, m_Columns[c] );
+                fputs( ": [", pFile );
+                for ( size_t f = 0; f < R.Frames.size(); f++ )
+                {
+                    if ( f )
+                    {
+                        fputc( ',', pFile );
+                    }
+                    WriteJsonNumber( pFile, R.Frames[f].IsSet( c ) ? R.Frames[f].Values[c] : 0.0, R.Frames[f].IsSet( c ) );
+                }
+                fputc( ']', pFile );
+            }
+            fputs( bFirst ? "}\n    }" : "\n      }\n    }", pFile );
+        }
+        fputs( m_Runs.empty() ? "]\n}\n" : "\n  ]\n}\n", pFile );
+
+        const bool bWritten = ferror( pFile ) == 0;
+        return ( fclose( pFile ) == 0 ) && bWritten;
+    }
+}
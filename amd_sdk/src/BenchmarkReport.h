@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: BenchmarkReport.h
+//
+// Collects per-frame values of a benchmark, such as timer results and counters, and
+// writes them as CSV (one row per frame) and JSON (per-run summaries plus every value).
+//
+// A report holds a list of runs, for example one per light count of a sweep. Each frame
+// of a run sets any number of named values; columns are created the first time a name
+// is used, so different runs may report different values. Values a frame didn't set
+// are empty in the CSV and null in the JSON.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_BENCHMARK_REPORT_H
+#define AMD_SDK_BENCHMARK_REPORT_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace AMD
+{
+    // Statistics of one column over the frames of a run
+    struct BenchmarkSummary
+    {
+        double          fMean;
+        double          fMin;
+        double          fP50;
+        double          fP95;
+        double          fMax;
+        unsigned int    uFrames;        // Frames that set the value
+    };
+
+    class BenchmarkReport
+    {
+    public:
+
+        void Clear();
+
+        // Describes the whole benchmark, e.g. the settings or the device
+        void SetInfo( const wchar_t* szKey, const wchar_t* szValue );
+
+        // Starts a run; frames and values go to the latest run
+        void BeginRun( const wchar_t* szName );
+        void SetRunParameter( const wchar_t* szKey, double fValue );
+
+        // Starts a frame of the current run and sets its values
+        void BeginFrame();
+        void SetValue( const wchar_t* szColumn, double fValue );
+
+        // Sets a value of an earlier frame of the current run, e.g. a GPU time that came back
+        // a few frames late. Ignored if the run has no such frame.
+        void SetFrameValue( size_t uFrame, const wchar_t* szColumn, double fValue );
+
+        size_t GetRunCount() const { return m_Runs.size(); }
+        size_t GetFrameCount( size_t uRun ) const { return m_Runs[uRun].Frames.size(); }
+        size_t GetColumnCount() const { return m_Columns.size(); }
+
+        // False if no frame of the run set the column
+        bool GetSummary( size_t uRun, const wchar_t* szColumn, BenchmarkSummary& Summary ) const;
+
+        bool WriteCsv( const wchar_t* szFileName ) const;
+        bool WriteJson( const wchar_t* szFileName ) const;
+
+    private:
+
+        // Not NaN for unset values, fast floating point math may not preserve it
+        struct Frame
+        {
+            std::vector<double>                                 Values;     // Per column
+            std::vector<unsigned char>                          Set;
+
+            bool IsSet( size_t uColumn ) const { return uColumn < Set.size() && Set[uColumn]; }
+        };
+
+        struct Run
+        {
+            std::string                                         Name;
+            std::vector< std::pair<std::string, double> >       Parameters;
+            std::vector<Frame>                                  Frames;
+        };
+
+        bool Summarize( const Run& R, size_t uColumn, BenchmarkSummary& Summary ) const;
+
+        std::vector< std::pair<std::string, std::string> >      m_Info;
+        std::vector<std::string>                                m_Columns;  // UTF-8
+        std::map<std::string, size_t>                           m_ColumnIndices;
+        std::vector<Run>                                        m_Runs;
+    };
+}
+
+#endif // AMD_SDK_BENCHMARK_REPORT_H
@@ -0,0 +1,505 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: CameraPath.cpp
+//
+// Scripted camera paths and camera matrices
+//--------------------------------------------------------------------------------------
+#include "CameraPath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    static FILE* OpenFile( const wchar_t* szFileName, const wchar_t* szMode )
+    {
+        FILE* pFile = NULL;
+#if defined( _WIN32 )
+        if ( _wfopen_s( &pFile, szFileName, szMode ) != 0 )
+        {
+            pFile = NULL;
+        }
+#else
+        char szNarrowName[1024];
+        char szNarrowMode[8];
+        if ( wcstombs( szNarrowName, szFileName, sizeof( szNarrowName ) ) < sizeof( szNarrowName ) &&
+             wcstombs( szNarrowMode, szMode, sizeof( szNarrowMode ) ) < sizeof( szNarrowMode ) )
+        {
+            pFile = fopen( szNarrowName, szNarrowMode );
+        }
+#endif
+        return pFile;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Binary paths are little-endian whatever the platform
+    //--------------------------------------------------------------------------------------
+    static void PutUInt( unsigned char* pOut, unsigned int uValue )
+    {
+        for ( int i = 0; i < 4; i++ )
+        {
+            pOut[i] = (unsigned char)( uValue >> ( 8 * i ) );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static unsigned int GetUInt( const unsigned char* pIn )
+    {
+        return (unsigned int)pIn[0] | ( (unsigned int)pIn[1] << 8 ) | ( (unsigned int)pIn[2] << 16 ) | ( (unsigned int)pIn[3] << 24 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void PutFloat( unsigned char* pOut, float fValue )
+    {
+        unsigned int uBits;
+        memcpy( &uBits, &fValue, sizeof( uBits ) );
+        PutUInt( pOut, uBits );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static float GetFloat( const unsigned char* pIn )
+    {
+        const unsigned int uBits = GetUInt( pIn );
+        float fValue;
+        memcpy( &fValue, &uBits, sizeof( fValue ) );
+        return fValue;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // The fields of a key in file order: time, eye, look-at, then the projection if present
+    //--------------------------------------------------------------------------------------
+    static void KeyToFields( const CameraKey& Key, float* pFields )
+    {
+        pFields[0] = Key.fTime;
+        for ( int k = 0; k < 3; k++ )
+        {
+            pFields[1 + k] = Key.fEye[k];
+            pFields[4 + k] = Key.fAt[k];
+        }
+        pFields[7] = Key.fFovY;
+        pFields[8] = Key.fAspect;
+        pFields[9] = Key.fNearClip;
+        pFields[10] = Key.fFarClip;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void FieldsToKey( const float* pFields, bool bProjection, CameraKey& Key )
+    {
+        Key.fTime = pFields[0];
+        for ( int k = 0; k < 3; k++ )
+        {
+            Key.fEye[k] = pFields[1 + k];
+            Key.fAt[k] = pFields[4 + k];
+        }
+        Key.fFovY = bProjection ? pFields[7] : 0.0f;
+        Key.fAspect = bProjection ? pFields[8] : 0.0f;
+        Key.fNearClip = bProjection ? pFields[9] : 0.0f;
+        Key.fFarClip = bProjection ? pFields[10] : 0.0f;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Hermite tangent at key i, from its neighbours (one-sided at the ends), per second
+    //--------------------------------------------------------------------------------------
+    static float GetTangent( const std::vector<CameraKey>& Keys, size_t i, size_t uComponent, bool bEye )
+    {
+        const size_t uPrev = ( i > 0 ) ? i - 1 : i;
+        const size_t uNext = ( i + 1 < Keys.size() ) ? i + 1 : i;
+        const float fDuration = Keys[uNext].fTime - Keys[uPrev].fTime;
+        if ( fDuration <= 0.0f )
+        {
+            return 0.0f;
+        }
+
+        const float* pPrev = bEye ? Keys[uPrev].fEye : Keys[uPrev].fAt;
+        const float* pNext = bEye ? Keys[uNext].fEye : Keys[uNext].fAt;
+        return ( pNext[uComponent] - pPrev[uComponent] ) / fDuration;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void CameraPath::AddKey( float fTime, const float* pEye, const float* pAt )
+    {
+        float fFields[11] = { fTime, pEye[0], pEye[1], pEye[2], pAt[0], pAt[1], pAt[2] };
+        CameraKey Key;
+        FieldsToKey( fFields, false, Key );
+        m_Keys.push_back( Key );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::Load( const wchar_t* szFileName )
+    {
+        FILE* pFile = OpenFile( szFileName, L"rb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        unsigned char Magic[4] = {};
+        const bool bBinary = fread( Magic, sizeof( Magic ), 1, pFile ) == 1 && GetUInt( Magic ) == CAMERA_PATH_MAGIC;
+        rewind( pFile );
+
+        std::vector<CameraKey> Keys;
+        bool bValid = bBinary ? LoadBinary( pFile, Keys ) : LoadText( pFile, Keys );
+        fclose( pFile );
+
+        for ( size_t i = 1; i < Keys.size() && bValid; i++ )
+        {
+            bValid = Keys[i].fTime > Keys[i - 1].fTime && Keys[i].HasProjection() == Keys[0].HasProjection();
+        }
+
+        if ( !bValid || Keys.empty() )
+        {
+            return false;
+        }
+
+        m_Keys.swap( Keys );
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::LoadBinary( FILE* pFile, std::vector<CameraKey>& Keys ) const
+    {
+        unsigned char Header[sizeof( CAMERA_PATH_HEADER )];
+        if ( fread( Header, sizeof( Header ), 1, pFile ) != 1 || GetUInt( Header + 4 ) != CAMERA_PATH_VERSION )
+        {
+            return false;
+        }
+
+        const unsigned int uFlags = GetUInt( Header + 8 );
+        const unsigned int uKeys = GetUInt( Header + 12 );
+        const bool bProjection = ( uFlags & CAMERA_PATH_PROJECTION ) != 0;
+        const size_t uFields = bProjection ? 11 : 7;
+
+        // The count comes from the file, read in blocks rather than trusting it for one allocation
+        unsigned char Block[64 * 11 * sizeof( float )];
+        for ( unsigned int uRead = 0; uRead < uKeys; )
+        {
+            const unsigned int uBlockKeys = std::min( uKeys - uRead, 64u );
+            if ( fread( Block, uFields * sizeof( float ), uBlockKeys, pFile ) != uBlockKeys )
+            {
+                return false;
+            }
+
+            for ( unsigned int i = 0; i < uBlockKeys; i++ )
+            {
+                float fFields[11];
+                for ( size_t f = 0; f < uFields; f++ )
+                {
+                    fFields[f] = GetFloat( Block + ( i * uFields + f ) * sizeof( float ) );
+                }
+
+                CameraKey Key;
+                FieldsToKey( fFields, bProjection, Key );
+                Keys.push_back( Key );
+            }
+            uRead += uBlockKeys;
+        }
+
+        // The flag promises a field of view in every key
+        return !bProjection || Keys.empty() || Keys[0].HasProjection();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::LoadText( FILE* pFile, std::vector<CameraKey>& Keys ) const
+    {
+        char szLine[512];
+        while ( fgets( szLine, sizeof( szLine ), pFile ) )
+        {
+            char* pComment = strchr( szLine, '#' );
+            if ( pComment )
+            {
+                *pComment = 0;
+            }
+
+            // strtod rather than sscanf, which the Visual C++ runtime deprecates
+            float fFields[11];
+            int iFields = 0;
+            const char* pRead = szLine;
+            for ( ;; )
+            {
+                char* pEnd;
+                const double fValue = strtod( pRead, &pEnd );
+                if ( pEnd == pRead )
+                {
+                    break;
+                }
+                if ( iFields < 11 )
+                {
+                    fFields[iFields] = (float)fValue;
+                }
+                iFields++;
+                pRead = pEnd;
+            }
+
+            while ( *pRead == ' ' || *pRead == '\t' || *pRead == '\r' || *pRead == '\n' )
+            {
+                pRead++;
+            }
+
+            if ( iFields == 0 && *pRead == 0 )
+            {
+                continue;   // Blank or comment
+            }
+
+            if ( ( iFields != 7 && iFields != 11 ) || *pRead != 0 || ( iFields == 11 && fFields[7] <= 0.0f ) )
+            {
+                return false;
+            }
+
+            CameraKey Key;
+            FieldsToKey( fFields, iFields == 11, Key );
+            Keys.push_back( Key );
+        }
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::Save( const wchar_t* szFileName, bool bText ) const
+    {
+        FILE* pFile = OpenFile( szFileName, bText ? L"wt" : L"wb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        const bool bProjection = HasProjection();
+        const size_t uFields = bProjection ? 11 : 7;
+        bool bWritten = true;
+
+        if ( bText )
+        {
+            bWritten = fprintf( pFile, bProjection ? "# time  eye.x eye.y eye.z  at.x at.y at.z  fov aspect near far\n" :
+                                                     "# time  eye.x eye.y eye.z  at.x at.y at.z\n" ) > 0;
+        }
+        else
+        {
+            unsigned char Header[sizeof( CAMERA_PATH_HEADER )];
+            PutUInt( Header, CAMERA_PATH_MAGIC );
+            PutUInt( Header + 4, CAMERA_PATH_VERSION );
+            PutUInt( Header + 8, bProjection ? CAMERA_PATH_PROJECTION : 0 );
+            PutUInt( Header + 12, (unsigned int)m_Keys.size() );
+            bWritten = fwrite( Header, sizeof( Header ), 1, pFile ) == 1;
+        }
+
+        for ( size_t i = 0; i < m_Keys.size() && bWritten; i++ )
+        {
+            float fFields[11];
+            KeyToFields( m_Keys[i], fFields );
+
+            if ( bText )
+            {
+                // %.9g keeps every bit of a float
+                for ( size_t f = 0; f < uFields && bWritten; f++ )
+                {
+                    bWritten = fprintf( pFile, ( f == 0 ) ? "%.9g" : ( f == 1 || f == 4 || f == 7 ) ? "  %.9g" : " %.9g", fFields[f] ) > 0;
+                }
+                bWritten = bWritten && fputc( '\n', pFile ) != EOF;
+            }
+            else
+            {
+                unsigned char Fields[11 * sizeof( float )];
+                for ( size_t f = 0; f < uFields; f++ )
+                {
+                    PutFloat( Fields + f * sizeof( float ), fFields[f] );
+                }
+                bWritten = fwrite( Fields, uFields * sizeof( float ), 1, pFile ) == 1;
+            }
+        }
+
+        return ( fclose( pFile ) == 0 ) && bWritten;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void CameraPath::SetOrbit( const float* pCenter, const float* pExtents, float fDuration, unsigned int uKeys )
+    {
+        m_Keys.clear();
+        uKeys = ( uKeys < 3 ) ? 3 : uKeys;
+
+        // Inside the box, a little above its center, so the lights are seen from near and far
+        for ( unsigned int i = 0; i <= uKeys; i++ )
+        {
+            const float fAngle = 2.0f * 3.14159265f * (float)( i % uKeys ) / (float)uKeys;
+            const float fEye[3] =
+            {
+                pCenter[0] + 0.75f * pExtents[0] * cosf( fAngle ),
+                pCenter[1] + 0.25f * pExtents[1],
+                pCenter[2] + 0.75f * pExtents[2] * sinf( fAngle )
+            };
+            AddKey( fDuration * (float)i / (float)uKeys, fEye, pCenter );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::Evaluate( float fTime, float* pEye, float* pAt ) const
+    {
+        CameraKey Key;
+        if ( !Evaluate( fTime, Key ) )
+        {
+            return false;
+        }
+
+        for ( int k = 0; k < 3; k++ )
+        {
+            pEye[k] = Key.fEye[k];
+            pAt[k] = Key.fAt[k];
+        }
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CameraPath::Evaluate( float fTime, CameraKey& Key ) const
+    {
+        if ( m_Keys.empty() )
+        {
+            return false;
+        }
+
+        // First key after fTime
+        size_t uNext = 0;
+        while ( uNext < m_Keys.size() && m_Keys[uNext].fTime <= fTime )
+        {
+            uNext++;
+        }
+
+        if ( uNext == 0 || uNext == m_Keys.size() )
+        {
+            Key = m_Keys[ ( uNext == 0 ) ? 0 : m_Keys.size() - 1 ];
+            Key.fTime = fTime;
+            return true;
+        }
+
+        const size_t uPrev = uNext - 1;
+        const CameraKey& Key0 = m_Keys[uPrev];
+        const CameraKey& Key1 = m_Keys[uNext];
+        const float fSpan = Key1.fTime - Key0.fTime;
+        const float s = ( fTime - Key0.fTime ) / fSpan;
+
+        // Cubic Hermite basis
+        const float s2 = s * s;
+        const float s3 = s2 * s;
+        const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+        const float h10 = s3 - 2.0f * s2 + s;
+        const float h01 = -2.0f * s3 + 3.0f * s2;
+        const float h11 = s3 - s2;
+
+        Key.fTime = fTime;
+        for ( size_t k = 0; k < 3; k++ )
+        {
+            Key.fEye[k] = h00 * Key0.fEye[k] + h10 * fSpan * GetTangent( m_Keys, uPrev, k, true ) +
+                          h01 * Key1.fEye[k] + h11 * fSpan * GetTangent( m_Keys, uNext, k, true );
+            Key.fAt[k] = h00 * Key0.fAt[k] + h10 * fSpan * GetTangent( m_Keys, uPrev, k, false ) +
+                         h01 * Key1.fAt[k] + h11 * fSpan * GetTangent( m_Keys, uNext, k, false );
+        }
+
+        Key.fFovY = Key0.fFovY + s * ( Key1.fFovY - Key0.fFovY );
+        Key.fAspect = Key0.fAspect + s * ( Key1.fAspect - Key0.fAspect );
+        Key.fNearClip = Key0.fNearClip + s * ( Key1.fNearClip - Key0.fNearClip );
+        Key.fFarClip = Key0.fFarClip + s * ( Key1.fFarClip - Key0.fFarClip );
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BuildLookAtMatrix( float* pOut, const float* pEye, const float* pAt, const float* pUp )
+    {
+        float z[3] = { pAt[0] - pEye[0], pAt[1] - pEye[1], pAt[2] - pEye[2] };
+        float fLength = sqrtf( z[0] * z[0] + z[1] * z[1] + z[2] * z[2] );
+        for ( int k = 0; k < 3; k++ )
+        {
+            z[k] /= fLength;
+        }
+
+        float x[3] = { pUp[1] * z[2] - pUp[2] * z[1], pUp[2] * z[0] - pUp[0] * z[2], pUp[0] * z[1] - pUp[1] * z[0] };
+        fLength = sqrtf( x[0] * x[0] + x[1] * x[1] + x[2] * x[2] );
+        for ( int k = 0; k < 3; k++ )
+        {
+            x[k] /= fLength;
+        }
+
+        const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+        const float View[16] =
+        {
+            x[0], y[0], z[0], 0.0f,
+            x[1], y[1], z[1], 0.0f,
+            x[2], y[2], z[2], 0.0f,
+            -( x[0] * pEye[0] + x[1] * pEye[1] + x[2] * pEye[2] ),
+            -( y[0] * pEye[0] + y[1] * pEye[1] + y[2] * pEye[2] ),
+            -( z[0] * pEye[0] + z[1] * pEye[1] + z[2] * pEye[2] ), 1.0f
+        };
+        std::copy( View, View + 16, pOut );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BuildPerspectiveMatrix( float* pOut, float fFovY, float fAspect, float fNear, float fFar )
+    {
+        const float fHeight = 1.0f / tanf( 0.5f * fFovY );
+        const float fWidth = fHeight / fAspect;
+        const float fRange = fFar / ( fFar - fNear );
+
+        const float Projection[16] =
+        {
+            fWidth, 0.0f, 0.0f, 0.0f,
+            0.0f, fHeight, 0.0f, 0.0f,
+            0.0f, 0.0f, fRange, 1.0f,
+            0.0f, 0.0f, -fRange * fNear, 0.0f
+        };
+        std::copy( Projection, Projection + 16, pOut );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void MultiplyMatrix( float* pOut, const float* pA, const float* pB )
+    {
+        for ( int r = 0; r < 4; r++ )
+        {
+            for ( int c = 0; c < 4; c++ )
+            {
+                pOut[r * 4 + c] = pA[r * 4 + 0] * pB[0 * 4 + c] + pA[r * 4 + 1] * pB[1 * 4 + c] +
+                                  pA[r * 4 + 2] * pB[2 * 4 + c] + pA[r * 4 + 3] * pB[3 * 4 + c];
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: CameraPath.h
+//
+// A scripted camera path: eye and look-at positions at key times, interpolated with
+// Catmull-Rom splines. Benchmarks evaluate it at fixed frame times, so every run sees
+// the same views whatever the frame rate.
+//
+// A path is loaded from a text file with one key per line,
+//
+//   # time  eye.x eye.y eye.z  at.x at.y at.z  [fov aspect near far]
+//   0.0     100 5 0            0 0 0
+//
+// where '#' starts a comment, or built around a scene's bounds with SetOrbit. The
+// optional projection is the vertical field of view in radians, the aspect ratio and the
+// clip planes; all keys of a file either have it or don't.
+//
+// Recorded paths are saved in a compact binary form instead, one key per frame: a
+// CAMERA_PATH_HEADER followed by 7 little-endian floats per key (11 with the projection).
+// Load reads either form.
+// The matrix helpers follow DirectXMath's left-handed, row-vector conventions.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_CAMERA_PATH_H
+#define AMD_SDK_CAMERA_PATH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+namespace AMD
+{
+    struct CameraKey
+    {
+        float           fTime;                  // In seconds, increasing
+        float           fEye[3];
+        float           fAt[3];
+
+        // Projection, all 0 if the path doesn't set it
+        float           fFovY;                  // Vertical, in radians
+        float           fAspect;
+        float           fNearClip;
+        float           fFarClip;
+
+        bool HasProjection() const { return fFovY > 0.0f; }
+    };
+
+    static const unsigned int CAMERA_PATH_MAGIC = 0x48544150;      // "PATH"
+    static const unsigned int CAMERA_PATH_VERSION = 1;
+    static const unsigned int CAMERA_PATH_PROJECTION = 0x1;         // Keys have 11 floats rather than 7
+
+    struct CAMERA_PATH_HEADER
+    {
+        unsigned int    uMagic;
+        unsigned int    uVersion;
+        unsigned int    uFlags;
+        unsigned int    uKeys;
+    };
+
+    class CameraPath
+    {
+    public:
+
+        void Clear() { m_Keys.clear(); }
+
+        // Keys must be added in order of time, and either all or none with a projection
+        void AddKey( float fTime, const float* pEye, const float* pAt );
+        void AddKey( const CameraKey& Key ) { m_Keys.push_back( Key ); }
+
+        // Replaces the keys with those in a text or binary path file. Fails if the file
+        // can't be read or parsed or the times don't increase.
+        bool Load( const wchar_t* szFileName );
+
+        // Writes the binary form, or the text form with bText
+        bool Save( const wchar_t* szFileName, bool bText = false ) const;
+
+        // A closed loop of uKeys keys around the box pCenter +/- pExtents, looking at its center
+        void SetOrbit( const float* pCenter, const float* pExtents, float fDuration, unsigned int uKeys = 8 );
+
+        size_t GetKeyCount() const { return m_Keys.size(); }
+        const CameraKey& GetKey( size_t i ) const { return m_Keys[i]; }
+        float GetDuration() const { return m_Keys.empty() ? 0.0f : m_Keys.back().fTime; }
+
+        bool HasProjection() const { return !m_Keys.empty() && m_Keys[0].HasProjection(); }
+
+        // Position at fTime, clamped to the first and last key. False if there are no keys.
+        bool Evaluate( float fTime, float* pEye, float* pAt ) const;
+
+        // Also interpolates the projection, linearly
+        bool Evaluate( float fTime, CameraKey& Key ) const;
+
+    private:
+
+        bool LoadBinary( FILE* pFile, std::vector<CameraKey>& Keys ) const;
+        bool LoadText( FILE* pFile, std::vector<CameraKey>& Keys ) const;
+
+        std::vector<CameraKey>  m_Keys;
+    };
+
+    // XMMatrixLookAtLH
+    void BuildLookAtMatrix( float* pOut, const float* pEye, const float* pAt, const float* pUp );
+
+    // XMMatrixPerspectiveFovLH
+    void BuildPerspectiveMatrix( float* pOut, float fFovY, float fAspect, float fNear, float fFar );
+
+    // pA * pB, pOut must not alias either
+    void MultiplyMatrix( float* pOut, const float* pA, const float* pB );
+}
+
+#endif // AMD_SDK_CAMERA_PATH_H
@@ -0,0 +1,209 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: FrameCounters.cpp
+//
+// Per-frame counters, accumulated per thread without locks
+//--------------------------------------------------------------------------------------
+#include "FrameCounters.h"
+
+#include <wchar.h>
+
+#if defined( _MSC_VER )
+#define AMD_THREAD_LOCAL __declspec( thread )
+#else
+#define AMD_THREAD_LOCAL __thread
+#endif
+
+namespace AMD
+{
+    static const wchar_t* s_szBuiltinCounterNames[FRAME_COUNTER_BUILTIN_COUNT] =
+    {
+        L"lights",
+        L"lights frustum culled",
+        L"lights drawn",
+        L"depth bounds calls",
+        L"draw calls",
+        L"state changes",
+        L"bytes mapped",
+        L"sprites flushed",
+    };
+
+    // Every registry gets a new generation, so a thread's cached block is never used with
+    // a registry that was destroyed and recreated at the same address
+    static std::atomic<unsigned int> s_uRegistryGeneration( 0 );
+
+    static AMD_THREAD_LOCAL unsigned int         s_uCachedGeneration = 0;
+    static AMD_THREAD_LOCAL ThreadCounterBlock*  s_pCachedBlock = NULL;
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadCounterBlock::ThreadCounterBlock( std::thread::id ThreadId ) :
+        m_ThreadId( ThreadId ),
+        m_pNext( NULL )
+    {
+        for ( unsigned int i = 0; i < FRAME_COUNTER_CAPACITY; i++ )
+        {
+            m_iTotals[i].store( 0, std::memory_order_relaxed );
+            m_iCounted[i] = 0;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    FrameCounterRegistry::FrameCounterRegistry() :
+        m_pHead( NULL ),
+        m_uGeneration( ++s_uRegistryGeneration ),
+        m_uCount( 0 ),
+        m_uFrames( 0 )
+    {
+        for ( unsigned int i = 0; i < FRAME_COUNTER_CAPACITY; i++ )
+        {
+            m_szNames[i][0] = 0;
+            m_iFrameValues[i] = 0;
+        }
+
+        for ( unsigned int i = 0; i < FRAME_COUNTER_BUILTIN_COUNT; i++ )
+        {
+            Register( s_szBuiltinCounterNames[i] );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    FrameCounterRegistry::~FrameCounterRegistry()
+    {
+        Destroy();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    FrameCounterRegistry& FrameCounterRegistry::Instance()
+    {
+        static FrameCounterRegistry Registry;
+        return Registry;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned int FrameCounterRegistry::Register( const wchar_t* szName )
+    {
+        for ( unsigned int i = 0; i < m_uCount; i++ )
+        {
+            if ( wcsncmp( m_szNames[i], szName, FRAME_COUNTER_NAME_LENGTH - 1 ) == 0 )
+            {
+                return i;
+            }
+        }
+
+        if ( m_uCount == FRAME_COUNTER_CAPACITY )
+        {
+            return FRAME_COUNTER_CAPACITY;
+        }
+
+        unsigned int i = 0;
+        for ( ; i < FRAME_COUNTER_NAME_LENGTH - 1 && szName[i]; i++ )
+        {
+            m_szNames[m_uCount][i] = szName[i];
+        }
+        m_szNames[m_uCount][i] = 0;
+
+        return m_uCount++;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void FrameCounterRegistry::EndFrame()
+    {
+        for ( unsigned int i = 0; i < m_uCount; i++ )
+        {
+            m_iFrameValues[i] = 0;
+        }
+
+        for ( ThreadCounterBlock* pBlock = m_pHead.load( std::memory_order_acquire ); pBlock; pBlock = pBlock->m_pNext )
+        {
+            for ( unsigned int i = 0; i < m_uCount; i++ )
+            {
+                const long long iTotal = pBlock->GetTotal( i );
+                m_iFrameValues[i] += iTotal - pBlock->m_iCounted[i];
+                pBlock->m_iCounted[i] = iTotal;
+            }
+        }
+
+        m_uFrames++;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadCounterBlock* FrameCounterRegistry::GetBlock()
+    {
+        if ( s_uCachedGeneration == m_uGeneration )
+        {
+            return s_pCachedBlock;
+        }
+
+        // The thread may already have a block if it used another registry in between
+        const std::thread::id ThreadId = std::this_thread::get_id();
+        ThreadCounterBlock* pBlock = m_pHead.load( std::memory_order_acquire );
+        while ( pBlock && pBlock->GetThreadId() != ThreadId )
+        {
+            pBlock = pBlock->GetNext();
+        }
+
+        if ( !pBlock )
+        {
+            pBlock = new ThreadCounterBlock( ThreadId );
+
+            ThreadCounterBlock* pHead = m_pHead.load( std::memory_order_relaxed );
+            do
+            {
+                pBlock->m_pNext = pHead;
+            } while ( !m_pHead.compare_exchange_weak( pHead, pBlock, std::memory_order_release, std::memory_order_relaxed ) );
+        }
+
+        s_uCachedGeneration = m_uGeneration;
+        s_pCachedBlock = pBlock;
+
+        return pBlock;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void FrameCounterRegistry::Destroy()
+    {
+        ThreadCounterBlock* pBlock = m_pHead.exchange( NULL );
+        while ( pBlock )
+        {
+            ThreadCounterBlock* pNext = pBlock->m_pNext;
+            delete pBlock;
+            pBlock = pNext;
+        }
+
+        for ( unsigned int i = 0; i < FRAME_COUNTER_CAPACITY; i++ )
+        {
+            m_iFrameValues[i] = 0;
+        }
+        m_uFrames = 0;
+        m_uGeneration = ++s_uRegistryGeneration;
+    }
+}
@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: FrameCounters.h
+//
+// Counts what a frame did, e.g. lights drawn, draw calls or bytes mapped, next to the
+// times that TimerEx measures.
+//
+// Every thread that adds to a counter gets its own block of running totals, which only
+// that thread writes, so adding is a plain load and store with no lock and no shared
+// cache line. Once per frame the owner thread calls EndFrame, which sums the change of
+// every block since the previous EndFrame into the values of the frame. Totals are never
+// reset, so a thread may keep adding while EndFrame reads it and nothing is lost or
+// counted twice; an add that races EndFrame is counted in the next frame.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_FRAME_COUNTERS_H
+#define AMD_SDK_FRAME_COUNTERS_H
+
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+
+namespace AMD
+{
+    static const unsigned int FRAME_COUNTER_CAPACITY = 32;         // Counters per registry, built-in ones included
+    static const unsigned int FRAME_COUNTER_NAME_LENGTH = 32;      // Longer names are truncated
+
+    // Counters every registry starts with, fed by the samples and the SDK
+    enum FrameCounter
+    {
+        FRAME_COUNTER_LIGHTS,                   // Lights in the scene
+        FRAME_COUNTER_LIGHTS_CULLED,            // Lights outside the view frustum
+        FRAME_COUNTER_LIGHTS_DRAWN,
+        FRAME_COUNTER_DEPTH_BOUNDS,             // Depth bounds set on the device
+        FRAME_COUNTER_DRAW_CALLS,
+        FRAME_COUNTER_STATE_CHANGES,            // Context calls made with COUNTER_State that bind shaders, layouts, buffers, views,
+                                                // samplers, states, targets, viewports or the topology. Clears, maps and draws
+                                                // are not state changes, and neither are the binds inside CDXUTSDKMesh.
+        FRAME_COUNTER_BYTES_MAPPED,             // Written to mapped resources
+        FRAME_COUNTER_SPRITES_FLUSHED,          // GUI and text quads drawn
+        FRAME_COUNTER_BUILTIN_COUNT
+    };
+
+    // Block of running totals of one thread
+    class ThreadCounterBlock
+    {
+    public:
+
+        ThreadCounterBlock( std::thread::id ThreadId );
+
+        // Only called by the thread the block belongs to. A load and a store rather than
+        // an atomic add, as nothing else writes the total.
+        void Add( unsigned int uCounter, long long iValue )
+        {
+            std::atomic<long long>& Total = m_iTotals[uCounter];
+            Total.store( Total.load( std::memory_order_relaxed ) + iValue, std::memory_order_relaxed );
+        }
+
+        long long GetTotal( unsigned int uCounter ) const { return m_iTotals[uCounter].load( std::memory_order_relaxed ); }
+
+        std::thread::id GetThreadId() const { return m_ThreadId; }
+        ThreadCounterBlock* GetNext() const { return m_pNext; }
+
+    private:
+
+        friend class FrameCounterRegistry;
+
+        ThreadCounterBlock( const ThreadCounterBlock& );
+        ThreadCounterBlock& operator=( const ThreadCounterBlock& );
+
+        std::atomic<long long>          m_iTotals[FRAME_COUNTER_CAPACITY];
+        long long                       m_iCounted[FRAME_COUNTER_CAPACITY];  // Totals at the last EndFrame, owner only
+        std::thread::id                 m_ThreadId;
+        ThreadCounterBlock*             m_pNext;
+    };
+
+    class FrameCounterRegistry
+    {
+    public:
+
+        FrameCounterRegistry();
+        ~FrameCounterRegistry();
+
+        // The registry the COUNTER_ macros use
+        static FrameCounterRegistry& Instance();
+
+        // Adds a counter and returns its id, or the id of the counter that already has the
+        // name. Returns FRAME_COUNTER_CAPACITY if the registry is full. Register counters on
+        // the owner thread before other threads add to them.
+        unsigned int Register( const wchar_t* szName );
+
+        // Any thread, lock-free once the thread's block exists
+        void Add( unsigned int uCounter, long long iValue )
+        {
+            if ( uCounter < FRAME_COUNTER_CAPACITY )
+            {
+                GetBlock()->Add( uCounter, iValue );
+            }
+        }
+
+        // Owner thread only. Makes what was added since the previous call the values of
+        // the last frame.
+        void EndFrame();
+
+        unsigned int GetCount() const { return m_uCount; }
+        const wchar_t* GetName( unsigned int uCounter ) const { return m_szNames[uCounter]; }
+
+        // Value of a counter in the last frame, owner thread only
+        long long GetFrameValue( unsigned int uCounter ) const { return uCounter < m_uCount ? m_iFrameValues[uCounter] : 0; }
+
+        // Frames ended so far
+        unsigned int GetFrameCount() const { return m_uFrames; }
+
+        // Block of the calling thread, created on first use
+        ThreadCounterBlock* GetBlock();
+
+        // Deletes all blocks and zeroes the counters, keeping their names. No thread may be
+        // adding while this runs.
+        void Destroy();
+
+    private:
+
+        FrameCounterRegistry( const FrameCounterRegistry& );
+        FrameCounterRegistry& operator=( const FrameCounterRegistry& );
+
+        std::atomic<ThreadCounterBlock*>    m_pHead;
+        unsigned int                        m_uGeneration;          // Invalidates the per-thread block caches
+        unsigned int                        m_uCount;
+        unsigned int                        m_uFrames;
+        wchar_t                             m_szNames[FRAME_COUNTER_CAPACITY][FRAME_COUNTER_NAME_LENGTH];
+        long long                           m_iFrameValues[FRAME_COUNTER_CAPACITY];
+    };
+}
+
+//--------------------------------------------------------------------------------------
+// Macros in the style of the TIMER_ macros of Timer.h
+//--------------------------------------------------------------------------------------
+#define COUNTER_Add( counter, value )               \
+    AMD::FrameCounterRegistry::Instance( ).Add( counter, value );
+
+#define COUNTER_EndFrame( )                         \
+    AMD::FrameCounterRegistry::Instance( ).EndFrame( );
+
+#define COUNTER_Get( counter )                      \
+    AMD::FrameCounterRegistry::Instance( ).GetFrameValue( counter )
+
+// Makes a state-setting call and counts it as one FRAME_COUNTER_STATE_CHANGES
+#define COUNTER_State( call )                       \
+    { call; AMD::FrameCounterRegistry::Instance( ).Add( AMD::FRAME_COUNTER_STATE_CHANGES, 1 ); }
+
+#endif // AMD_SDK_FRAME_COUNTERS_H
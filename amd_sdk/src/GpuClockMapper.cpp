@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: GpuClockMapper.cpp
+//
+// Maps GPU timestamps into CPU clock ticks, corrected for drift between the clocks
+//--------------------------------------------------------------------------------------
+#include "GpuClockMapper.h"
+
+#include <math.h>
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    GpuClockMapper::GpuClockMapper( long long iCpuFrequency ) :
+    m_iCpuFrequency( iCpuFrequency ),
+    m_uGpuFrequency( 0 ),
+    m_uNextSample( 0 ),
+    m_uSamples( 0 ),
+    m_fOffset( 0.0 ),
+    m_fSlope( 1.0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuClockMapper::Clear()
+    {
+        m_uGpuFrequency = 0;
+        m_uNextSample = 0;
+        m_uSamples = 0;
+        m_fOffset = 0.0;
+        m_fSlope = 1.0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuClockMapper::AddSample( long long iCpuBefore, long long iCpuAfter, unsigned long long uGpuTicks, unsigned long long uGpuFrequency )
+    {
+        if ( 0 == uGpuFrequency || iCpuAfter < iCpuBefore )
+        {
+            return;
+        }
+
+        if ( uGpuFrequency != m_uGpuFrequency )
+        {
+            Clear();
+            m_uGpuFrequency = uGpuFrequency;
+        }
+
+        Sample& S = m_Samples[m_uNextSample];
+        S.iCpu = iCpuBefore + ( iCpuAfter - iCpuBefore ) / 2;
+        S.iHalfWidth = ( iCpuAfter - iCpuBefore ) / 2;
+        S.uGpu = uGpuTicks;
+
+        m_uNextSample = ( m_uNextSample + 1 ) % GPU_CLOCK_MAPPER_SAMPLES;
+        if ( m_uSamples < GPU_CLOCK_MAPPER_SAMPLES )
+        {
+            m_uSamples++;
+        }
+
+        Fit();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuClockMapper::Fit()
+    {
+        const Sample& Newest = m_Samples[( m_uNextSample + GPU_CLOCK_MAPPER_SAMPLES - 1 ) % GPU_CLOCK_MAPPER_SAMPLES];
+        const double fCpuFrequency = (double)m_iCpuFrequency;
+        const double fGpuFrequency = (double)m_uGpuFrequency;
+
+        // Relative to the newest sample, so the sums stay small enough for doubles.
+        // Weighted by 1 / variance, with a floor of one tick for perfectly bracketed samples.
+        double fSumW = 0.0, fSumX = 0.0, fSumY = 0.0, fSumXX = 0.0, fSumXY = 0.0;
+        for ( unsigned int i = 0; i < m_uSamples; i++ )
+        {
+            const Sample& S = m_Samples[i];
+            const double fX = (double)(long long)( S.uGpu - Newest.uGpu ) / fGpuFrequency;
+            const double fY = (double)( S.iCpu - Newest.iCpu ) / fCpuFrequency;
+            const double fSigma = (double)( S.iHalfWidth > 0 ? S.iHalfWidth : 1 ) / fCpuFrequency;
+            const double fW = 1.0 / ( fSigma * fSigma );
+
+            fSumW += fW;
+            fSumX += fW * fX;
+            fSumY += fW * fY;
+            fSumXX += fW * fX * fX;
+            fSumXY += fW * fX * fY;
+        }
+
+        const double fMeanX = fSumX / fSumW;
+        const double fMeanY = fSumY / fSumW;
+        const double fVarX = fSumXX / fSumW - fMeanX * fMeanX;
+
+        // Samples too close together in time to tell the rates apart, or a fit that makes no
+        // sense for two crystal clocks: keep the nominal rates and only average the offset.
+        // Otherwise the fit is blended with the nominal rate by their variances, so a few
+        // noisy samples a second apart don't tilt the line more than the clocks could drift.
+        double fSlope = 1.0;
+        if ( m_uSamples > 1 && fVarX > 1e-6 )
+        {
+            const double fFitSlope = ( fSumXY / fSumW - fMeanX * fMeanY ) / fVarX;
+            if ( fabs( fFitSlope - 1.0 ) <= GPU_CLOCK_MAPPER_MAX_DRIFT )
+            {
+                const double fFitWeight = fSumW * fVarX;
+                const double fNominalWeight = 1.0 / ( GPU_CLOCK_MAPPER_TYPICAL_DRIFT * GPU_CLOCK_MAPPER_TYPICAL_DRIFT );
+                fSlope = ( fFitSlope * fFitWeight + fNominalWeight ) / ( fFitWeight + fNominalWeight );
+            }
+        }
+
+        m_fSlope = fSlope;
+        m_fOffset = fMeanY - fSlope * fMeanX;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    long long GpuClockMapper::GpuToCpu( unsigned long long uGpuTicks ) const
+    {
+        if ( 0 == m_uSamples )
+        {
+            return 0;
+        }
+
+        const Sample& Newest = m_Samples[( m_uNextSample + GPU_CLOCK_MAPPER_SAMPLES - 1 ) % GPU_CLOCK_MAPPER_SAMPLES];
+
+        const double fX = (double)(long long)( uGpuTicks - Newest.uGpu ) / (double)m_uGpuFrequency;
+        const double fY = m_fOffset + m_fSlope * fX;
+
+        return Newest.iCpu + (long long)floor( fY * (double)m_iCpuFrequency + 0.5 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    double GpuClockMapper::GetUncertainty() const
+    {
+        if ( 0 == m_uSamples )
+        {
+            return 0.0;
+        }
+
+        const Sample& Newest = m_Samples[( m_uNextSample + GPU_CLOCK_MAPPER_SAMPLES - 1 ) % GPU_CLOCK_MAPPER_SAMPLES];
+        return (double)Newest.iHalfWidth / (double)m_iCpuFrequency;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    long long GpuClockMapper::GetLastSampleTicks() const
+    {
+        if ( 0 == m_uSamples )
+        {
+            return 0;
+        }
+
+        return m_Samples[( m_uNextSample + GPU_CLOCK_MAPPER_SAMPLES - 1 ) % GPU_CLOCK_MAPPER_SAMPLES].iCpu;
+    }
+}
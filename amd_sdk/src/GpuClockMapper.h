@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: GpuClockMapper.h
+//
+// Maps GPU timestamps into CPU clock ticks, so GPU work can be placed on the same
+// timeline as the CPU work that submitted it.
+//
+// Each calibration sample is a GPU timestamp known to have been written between two
+// CPU clock reads. The mapping is a weighted least squares line through the last
+// GPU_CLOCK_MAPPER_SAMPLES samples, weighted by how tightly each sample was bracketed,
+// so the slope follows the drift between the two clocks instead of assuming that their
+// nominal frequencies are exact. With a single sample the nominal frequencies are used.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_GPU_CLOCK_MAPPER_H
+#define AMD_SDK_GPU_CLOCK_MAPPER_H
+
+namespace AMD
+{
+    static const unsigned int GPU_CLOCK_MAPPER_SAMPLES = 8;
+    static const double GPU_CLOCK_MAPPER_TYPICAL_DRIFT = 1e-4;  // How far off crystal clocks usually are
+    static const double GPU_CLOCK_MAPPER_MAX_DRIFT = 1e-3;      // Fits drifting more than this are not trusted
+
+    class GpuClockMapper
+    {
+    public:
+
+        // iCpuFrequency: CPU clock ticks per second
+        explicit GpuClockMapper( long long iCpuFrequency );
+
+        void Clear();
+
+        // The GPU wrote uGpuTicks after the CPU read iCpuBefore and before it read iCpuAfter.
+        // A change of the GPU frequency starts over.
+        void AddSample( long long iCpuBefore, long long iCpuAfter, unsigned long long uGpuTicks, unsigned long long uGpuFrequency );
+
+        bool IsCalibrated() const { return m_uSamples > 0; }
+
+        // CPU ticks at which the GPU clock read uGpuTicks. Timestamps may be older or newer
+        // than the samples. 0 if not calibrated.
+        long long GpuToCpu( unsigned long long uGpuTicks ) const;
+
+        // How much faster the GPU clock runs than its nominal frequency, in parts per million
+        double GetDriftPpm() const { return ( 1.0 / m_fSlope - 1.0 ) * 1e6; }
+
+        // Half the CPU time the newest sample was bracketed by, in seconds
+        double GetUncertainty() const;
+
+        unsigned int GetSampleCount() const { return m_uSamples; }
+
+        // CPU ticks of the newest sample, 0 if there is none
+        long long GetLastSampleTicks() const;
+
+    private:
+
+        struct Sample
+        {
+            long long           iCpu;           // Middle of the bracket
+            long long           iHalfWidth;
+            unsigned long long  uGpu;
+        };
+
+        void Fit();
+
+        long long           m_iCpuFrequency;
+        unsigned long long  m_uGpuFrequency;
+        Sample              m_Samples[GPU_CLOCK_MAPPER_SAMPLES];
+        unsigned int        m_uNextSample;
+        unsigned int        m_uSamples;
+
+        // CPU seconds since m_Samples[newest].iCpu = m_fOffset + m_fSlope * GPU seconds since its uGpu
+        double              m_fOffset;
+        double              m_fSlope;
+    };
+}
+
+#endif // AMD_SDK_GPU_CLOCK_MAPPER_H
@@ -0,0 +1,323 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: GpuQueryPool.cpp
+//
+// Shared pool of GPU timestamp queries, resolved a few frames late without waiting
+//--------------------------------------------------------------------------------------
+#include "GpuQueryPool.h"
+
+#include <string.h>
+
+namespace AMD
+{
+    // Timestamps of a timer that the GPU failed to write read back as all ones in the low bits
+    static bool IsBadTimestamp( unsigned long long uTicks )
+    {
+        return ( uTicks & 0xFFFFFFFF ) == 0xFFFFFFFF;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    GpuQueryPool::GpuQueryPool() :
+    m_pBackend( NULL ),
+    m_uScopesPerFrame( 0 ),
+    m_uFrame( 0 ),
+    m_uResolveFrame( 0 )
+    {
+        memset( &m_Stats, 0, sizeof( m_Stats ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    GpuQueryPool::~GpuQueryPool()
+    {
+        Destroy();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool GpuQueryPool::Create( GpuQueryBackend* pBackend, unsigned int uScopesPerFrame )
+    {
+        Destroy();
+
+        if ( NULL == pBackend || 0 == uScopesPerFrame )
+        {
+            return false;
+        }
+
+        if ( !pBackend->Create( GPU_QUERY_POOL_FRAMES, GPU_QUERY_POOL_FRAMES * uScopesPerFrame * 2 ) )
+        {
+            return false;
+        }
+
+        m_pBackend = pBackend;
+        m_uScopesPerFrame = uScopesPerFrame;
+        m_uFrame = 0;
+        m_uResolveFrame = 0;
+        memset( &m_Stats, 0, sizeof( m_Stats ) );
+
+        for ( unsigned int i = 0; i < GPU_QUERY_POOL_FRAMES; i++ )
+        {
+            m_Slots[i].uFrame = 0;
+            m_Slots[i].uScopes = 0;
+            m_Slots[i].uResolvedScopes = 0;
+            m_Slots[i].bPending = false;
+            m_Slots[i].Scopes.resize( uScopesPerFrame );
+        }
+
+        BeginFrame();
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::Destroy()
+    {
+        if ( NULL == m_pBackend )
+        {
+            return;
+        }
+
+        m_pBackend->Destroy();
+        m_pBackend = NULL;
+
+        for ( unsigned int i = 0; i < GPU_QUERY_POOL_FRAMES; i++ )
+        {
+            m_Slots[i].bPending = false;
+            std::vector<Scope>().swap( m_Slots[i].Scopes );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::BeginFrame()
+    {
+        const unsigned int uSlot = m_uFrame % GPU_QUERY_POOL_FRAMES;
+        FrameSlot& Slot = m_Slots[uSlot];
+
+        // The GPU is more than GPU_QUERY_POOL_FRAMES - 1 frames behind. Reusing the queries
+        // discards the oldest frame, where waiting for it would stall the CPU.
+        if ( Slot.bPending )
+        {
+            Slot.bPending = false;
+            m_Stats.uFramesDropped++;
+            m_uResolveFrame = m_uFrame - GPU_QUERY_POOL_FRAMES + 1;
+        }
+
+        Slot.uFrame = m_uFrame;
+        Slot.uScopes = 0;
+        Slot.uResolvedScopes = 0;
+
+        m_pBackend->BeginDisjoint( uSlot );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::NextFrame()
+    {
+        if ( NULL == m_pBackend )
+        {
+            return;
+        }
+
+        const unsigned int uSlot = m_uFrame % GPU_QUERY_POOL_FRAMES;
+        m_pBackend->EndDisjoint( uSlot );
+        m_Slots[uSlot].bPending = true;
+
+        m_uFrame++;
+
+        Resolve();
+        BeginFrame();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::Resolve()
+    {
+        if ( NULL == m_pBackend )
+        {
+            return;
+        }
+
+        // Frames are resolved in order, so clients see their scopes in the order they began
+        while ( m_uResolveFrame != m_uFrame )
+        {
+            FrameSlot& Slot = m_Slots[m_uResolveFrame % GPU_QUERY_POOL_FRAMES];
+
+            if ( Slot.bPending )
+            {
+                if ( !ResolveFrame( Slot ) )
+                {
+                    return;
+                }
+
+                Slot.bPending = false;
+                m_Stats.uFramesResolved++;
+
+                const unsigned int uLatency = m_uFrame - Slot.uFrame;
+                if ( uLatency > m_Stats.uMaxLatency )
+                {
+                    m_Stats.uMaxLatency = uLatency;
+                }
+            }
+
+            m_uResolveFrame++;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool GpuQueryPool::ResolveFrame( FrameSlot& Slot )
+    {
+        const unsigned int uSlot = (unsigned int)( &Slot - m_Slots );
+
+        GpuScopeResult Result;
+        bool bDisjoint = false;
+        if ( !m_pBackend->GetDisjoint( uSlot, Result.uFrequency, bDisjoint ) )
+        {
+            return false;
+        }
+
+        Result.uFrame = Slot.uFrame;
+
+        const unsigned int uFirstTimestamp = uSlot * m_uScopesPerFrame * 2;
+        for ( ; Slot.uResolvedScopes < Slot.uScopes; Slot.uResolvedScopes++ )
+        {
+            const Scope& S = Slot.Scopes[Slot.uResolvedScopes];
+            if ( NULL == S.pClient || !S.bEnded )
+            {
+                continue;
+            }
+
+            // The disjoint query ended after every timestamp of the frame, but the API
+            // doesn't promise they are all readable at once; pick up from here next time.
+            const unsigned int uTimestamp = uFirstTimestamp + Slot.uResolvedScopes * 2;
+            if ( !m_pBackend->GetTimestamp( uTimestamp, Result.uStart ) ||
+                 !m_pBackend->GetTimestamp( uTimestamp + 1, Result.uStop ) )
+            {
+                return false;
+            }
+
+            Result.uUserData = S.uUserData;
+            Result.iCpuTicks = S.iCpuTicks;
+            Result.bValid = !bDisjoint && !IsBadTimestamp( Result.uStart ) && !IsBadTimestamp( Result.uStop );
+            S.pClient->OnGpuScope( Result );
+        }
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::Flush()
+    {
+        if ( NULL == m_pBackend )
+        {
+            return;
+        }
+
+        NextFrame();
+
+        while ( m_uResolveFrame != m_uFrame )
+        {
+            Resolve();
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned int GpuQueryPool::BeginScope( GpuQueryClient* pClient, unsigned int uUserData, long long iCpuTicks )
+    {
+        if ( NULL == m_pBackend )
+        {
+            return GPU_QUERY_POOL_INVALID_SCOPE;
+        }
+
+        const unsigned int uSlot = m_uFrame % GPU_QUERY_POOL_FRAMES;
+        FrameSlot& Slot = m_Slots[uSlot];
+
+        if ( Slot.uScopes == m_uScopesPerFrame )
+        {
+            m_Stats.uScopesDropped++;
+            return GPU_QUERY_POOL_INVALID_SCOPE;
+        }
+
+        Scope& S = Slot.Scopes[Slot.uScopes];
+        S.pClient = pClient;
+        S.uUserData = uUserData;
+        S.iCpuTicks = iCpuTicks;
+        S.bEnded = false;
+
+        const unsigned int uScope = uSlot * m_uScopesPerFrame + Slot.uScopes;
+        Slot.uScopes++;
+
+        m_pBackend->EndTimestamp( uScope * 2 );
+
+        return uScope;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::EndScope( unsigned int uScope )
+    {
+        if ( GPU_QUERY_POOL_INVALID_SCOPE == uScope || NULL == m_pBackend )
+        {
+            return;
+        }
+
+        // A scope has to end in the frame it began in
+        FrameSlot& Slot = m_Slots[uScope / m_uScopesPerFrame];
+        if ( &Slot != &m_Slots[m_uFrame % GPU_QUERY_POOL_FRAMES] )
+        {
+            return;
+        }
+
+        Slot.Scopes[uScope % m_uScopesPerFrame].bEnded = true;
+
+        m_pBackend->EndTimestamp( uScope * 2 + 1 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GpuQueryPool::RemoveClient( GpuQueryClient* pClient )
+    {
+        if ( NULL == m_pBackend )
+        {
+            return;
+        }
+
+        for ( unsigned int i = 0; i < GPU_QUERY_POOL_FRAMES; i++ )
+        {
+            FrameSlot& Slot = m_Slots[i];
+            for ( unsigned int j = Slot.uResolvedScopes; j < Slot.uScopes; j++ )
+            {
+                if ( Slot.Scopes[j].pClient == pClient )
+                {
+                    Slot.Scopes[j].pClient = NULL;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: GpuQueryPool.h
+//
+// Shared pool of GPU timestamp queries for all GpuTimer scopes of a frame.
+//
+// Every frame slot owns one disjoint query and two timestamp queries per scope, and
+// GPU_QUERY_POOL_FRAMES slots are in flight, so the results of a frame are read back
+// two or three frames after it was issued. Resolve() only takes results that are
+// already available and never waits for the GPU; if the GPU falls so far behind that
+// a slot is needed again before its results came back, that frame is dropped instead.
+//
+// The graphics API sits behind GpuQueryBackend, so the pooling and frame matching can
+// be driven by a fake backend without a device (see TimerTool gpupool).
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_GPU_QUERY_POOL_H
+#define AMD_SDK_GPU_QUERY_POOL_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace AMD
+{
+    static const unsigned int GPU_QUERY_POOL_FRAMES = 4;                // Frame slots in flight
+    static const unsigned int GPU_QUERY_POOL_SCOPES = 512;              // Default scopes per frame
+    static const unsigned int GPU_QUERY_POOL_INVALID_SCOPE = 0xFFFFFFFF;
+
+    // The queries of a pool, addressed by index: uFrames disjoint queries and uTimestamps
+    // timestamp queries. Getters must not wait, they return false if the result isn't
+    // available yet.
+    class GpuQueryBackend
+    {
+    public:
+
+        virtual ~GpuQueryBackend() {}
+
+        virtual bool Create( unsigned int uFrames, unsigned int uTimestamps ) = 0;
+        virtual void Destroy() = 0;
+
+        virtual void BeginDisjoint( unsigned int uFrame ) = 0;
+        virtual void EndDisjoint( unsigned int uFrame ) = 0;
+        virtual void EndTimestamp( unsigned int uTimestamp ) = 0;
+
+        virtual bool GetDisjoint( unsigned int uFrame, unsigned long long& uFrequency, bool& bDisjoint ) = 0;
+        virtual bool GetTimestamp( unsigned int uTimestamp, unsigned long long& uTicks ) = 0;
+    };
+
+    struct GpuScopeResult
+    {
+        unsigned int        uFrame;         // GpuQueryPool::GetFrame() when the scope began
+        unsigned int        uUserData;      // Passed to BeginScope
+        long long           iCpuTicks;      // Passed to BeginScope
+        unsigned long long  uStart;         // GPU ticks
+        unsigned long long  uStop;
+        unsigned long long  uFrequency;     // GPU ticks per second
+        bool                bValid;         // false if the frame was disjoint or a timestamp is bad
+    };
+
+    // Receives the results of its scopes, in the order they began, from Resolve()
+    class GpuQueryClient
+    {
+    public:
+
+        virtual ~GpuQueryClient() {}
+
+        virtual void OnGpuScope( const GpuScopeResult& Result ) = 0;
+    };
+
+    struct GpuQueryPoolStats
+    {
+        unsigned int    uFramesResolved;
+        unsigned int    uFramesDropped;     // Slot was needed again before the GPU finished the frame
+        unsigned int    uScopesDropped;     // Frame was full
+        unsigned int    uMaxLatency;        // Most frames a frame took to resolve after it ended
+    };
+
+    class GpuQueryPool
+    {
+    public:
+
+        GpuQueryPool();
+        ~GpuQueryPool();
+
+        // Creates the queries and opens frame 0. The pool doesn't own pBackend.
+        bool Create( GpuQueryBackend* pBackend, unsigned int uScopesPerFrame = GPU_QUERY_POOL_SCOPES );
+        void Destroy();
+
+        bool IsCreated() const { return NULL != m_pBackend; }
+
+        // Ends the current frame, resolves what is available and opens the next frame.
+        // To be called once per frame.
+        void NextFrame();
+
+        // Hands the results of all frames the GPU has finished to their clients, oldest first
+        void Resolve();
+
+        // Ends the current frame like NextFrame and waits until every frame is resolved.
+        // Stalls the CPU, only for explicit requests to wait for the GPU.
+        void Flush();
+
+        // Returns GPU_QUERY_POOL_INVALID_SCOPE if the frame is full, EndScope accepts it.
+        // iCpuTicks is handed back with the result, e.g. the CPU time the scope was submitted.
+        unsigned int BeginScope( GpuQueryClient* pClient, unsigned int uUserData, long long iCpuTicks = 0 );
+        void EndScope( unsigned int uScope );
+
+        // Drops the pending results of a client that is about to be destroyed
+        void RemoveClient( GpuQueryClient* pClient );
+
+        unsigned int GetFrame() const { return m_uFrame; }
+
+        // Every frame before this one has been resolved or dropped
+        unsigned int GetResolvedFrame() const { return m_uResolveFrame; }
+
+        unsigned int GetScopesPerFrame() const { return m_uScopesPerFrame; }
+
+        void GetStats( GpuQueryPoolStats& Stats ) const { Stats = m_Stats; }
+
+    private:
+
+        struct Scope
+        {
+            GpuQueryClient* pClient;        // NULL once removed
+            unsigned int    uUserData;
+            long long       iCpuTicks;
+            bool            bEnded;
+        };
+
+        struct FrameSlot
+        {
+            unsigned int        uFrame;
+            unsigned int        uScopes;            // Begun this frame
+            unsigned int        uResolvedScopes;    // Handed to clients so far
+            bool                bPending;           // Ended and not resolved yet
+            std::vector<Scope>  Scopes;
+        };
+
+        bool ResolveFrame( FrameSlot& Slot );
+        void BeginFrame();
+
+        GpuQueryBackend*    m_pBackend;
+        unsigned int        m_uScopesPerFrame;
+        unsigned int        m_uFrame;           // Open frame
+        unsigned int        m_uResolveFrame;    // Oldest frame not resolved yet
+        FrameSlot           m_Slots[GPU_QUERY_POOL_FRAMES];
+        GpuQueryPoolStats   m_Stats;
+    };
+}
+
+#endif // AMD_SDK_GPU_QUERY_POOL_H
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: LatencyHistogram.cpp
+//
+// Fixed-size latency histogram over a sliding window of samples
+//--------------------------------------------------------------------------------------
+#include "LatencyHistogram.h"
+
+#include <string.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace AMD
+{
+    static const unsigned int SUB_BUCKETS = 1u << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+
+    // The window is tracked in 16 bit counts and bucket indices
+    static_assert( LATENCY_HISTOGRAM_WINDOW <= 0xFFFF && LATENCY_HISTOGRAM_BUCKETS <= 0xFFFF, "LatencyHistogram counters too small" );
+
+
+    //--------------------------------------------------------------------------------------
+    // Index of the highest set bit, uValue must not be 0
+    static unsigned int HighestBit( unsigned long long uValue )
+    {
+#if defined( _MSC_VER ) && defined( _M_X64 )
+        unsigned long uBit;
+        _BitScanReverse64( &uBit, uValue );
+        return (unsigned int)uBit;
+#elif defined( __GNUC__ )
+        return 63u - (unsigned int)__builtin_clzll( uValue );
+#else
+        unsigned int uBit = 0;
+        while ( uValue >>= 1 )
+        {
+            uBit++;
+        }
+        return uBit;
+#endif
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    LatencyHistogram::LatencyHistogram()
+    {
+        Clear();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void LatencyHistogram::Clear()
+    {
+        memset( m_uCounts, 0, sizeof( m_uCounts ) );
+        memset( m_uWindow, 0, sizeof( m_uWindow ) );
+        m_uNextSample = 0;
+        m_uSamples = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned int LatencyHistogram::GetBucketIndex( unsigned long long uNanoseconds )
+    {
+        // Values below SUB_BUCKETS get one bucket each, every power of two above that
+        // SUB_BUCKETS buckets of equal width
+        if ( uNanoseconds < SUB_BUCKETS )
+        {
+            return (unsigned int)uNanoseconds;
+        }
+
+        const unsigned int uShift = HighestBit( uNanoseconds ) - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+        const unsigned int uIndex = ( ( uShift + 1 ) << LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) + (unsigned int)( uNanoseconds >> uShift ) - SUB_BUCKETS;
+
+        return ( uIndex < LATENCY_HISTOGRAM_BUCKETS ) ? uIndex : LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long LatencyHistogram::GetBucketUpperBound( unsigned int uIndex )
+    {
+        if ( uIndex < SUB_BUCKETS )
+        {
+            return uIndex;
+        }
+
+        const unsigned int uShift = ( uIndex >> LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) - 1;
+        const unsigned long long uLowest = (unsigned long long)( ( uIndex & ( SUB_BUCKETS - 1 ) ) + SUB_BUCKETS ) << uShift;
+
+        return uLowest + ( 1ull << uShift ) - 1;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void LatencyHistogram::Record( double fSeconds )
+    {
+        // Also maps NaN to 0
+        const double fNanoseconds = fSeconds * 1e9;
+        const unsigned long long uNanoseconds = ( fNanoseconds > 0.0 ) ? ( fNanoseconds < 1e18 ? (unsigned long long)fNanoseconds : 1000000000000000000ull ) : 0;
+        const unsigned short uBucket = (unsigned short)GetBucketIndex( uNanoseconds );
+
+        if ( m_uSamples == LATENCY_HISTOGRAM_WINDOW )
+        {
+            m_uCounts[m_uWindow[m_uNextSample]]--;
+        }
+        else
+        {
+            m_uSamples++;
+        }
+
+        m_uCounts[uBucket]++;
+        m_uWindow[m_uNextSample] = uBucket;
+        m_uNextSample = ( m_uNextSample + 1 ) % LATENCY_HISTOGRAM_WINDOW;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    double LatencyHistogram::GetPercentile( double fPercentile ) const
+    {
+        if ( m_uSamples == 0 )
+        {
+            return 0.0;
+        }
+
+        // Rank of the sample, counting from 1
+        double fRank = fPercentile * 0.01 * m_uSamples;
+        unsigned int uRank = ( fRank < 1.0 ) ? 1 : (unsigned int)fRank;
+        uRank += ( uRank < fRank ) ? 1 : 0;
+        uRank = ( uRank < m_uSamples ) ? uRank : m_uSamples;
+
+        unsigned int uCount = 0;
+        for ( unsigned int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++ )
+        {
+            uCount += m_uCounts[i];
+            if ( uCount >= uRank )
+            {
+                return (double)GetBucketUpperBound( i ) * 1e-9;
+            }
+        }
+
+        return (double)GetBucketUpperBound( LATENCY_HISTOGRAM_BUCKETS - 1 ) * 1e-9;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void LatencyHistogram::GetPercentiles( LatencyPercentiles& Percentiles ) const
+    {
+        Percentiles.fP50 = GetPercentile( 50.0 );
+        Percentiles.fP90 = GetPercentile( 90.0 );
+        Percentiles.fP99 = GetPercentile( 99.0 );
+        Percentiles.fMax = GetPercentile( 100.0 );
+        Percentiles.uSamples = m_uSamples;
+    }
+}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: LatencyHistogram.h
+//
+// Fixed-size latency histogram over a sliding window of samples, in the style of
+// HdrHistogram: every power of two range of nanoseconds is split into 32 linear buckets,
+// so any percentile is accurate to about 3% of its value from 1 ns to about a minute.
+//
+// TimingEvent keeps one per timer for the CPU and the GPU time of each frame, which gives
+// p50/p90/p99/max over the last frames where averages would hide the occasional stutter.
+// Record() is O(1) and never allocates; reading percentiles walks the buckets once.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_LATENCY_HISTOGRAM_H
+#define AMD_SDK_LATENCY_HISTOGRAM_H
+
+namespace AMD
+{
+    static const unsigned int LATENCY_HISTOGRAM_SUB_BUCKET_BITS = 5;                // 32 buckets per power of two
+    static const unsigned int LATENCY_HISTOGRAM_MAX_BITS = 36;                      // Up to 2^36 ns, about 68 s
+    static const unsigned int LATENCY_HISTOGRAM_BUCKETS = ( LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1 ) << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    static const unsigned int LATENCY_HISTOGRAM_WINDOW = 512;                       // Samples the percentiles are taken over
+
+    // In seconds, like the times TimerEx reports
+    struct LatencyPercentiles
+    {
+        double          fP50;
+        double          fP90;
+        double          fP99;
+        double          fMax;
+        unsigned int    uSamples;       // In the window, at most LATENCY_HISTOGRAM_WINDOW
+    };
+
+    class LatencyHistogram
+    {
+    public:
+
+        LatencyHistogram();
+
+        // Adds a sample and drops the oldest one once the window is full
+        void Record( double fSeconds );
+
+        void Clear();
+
+        unsigned int GetSampleCount() const { return m_uSamples; }
+
+        // Smallest value that fPercentile percent of the samples in the window don't exceed,
+        // rounded up to the end of its bucket. 0 if there are no samples.
+        double GetPercentile( double fPercentile ) const;
+        void GetPercentiles( LatencyPercentiles& Percentiles ) const;
+
+        static unsigned int GetBucketIndex( unsigned long long uNanoseconds );
+        static unsigned long long GetBucketUpperBound( unsigned int uIndex );    // Largest value in the bucket, in ns
+
+    private:
+
+        unsigned short  m_uCounts[LATENCY_HISTOGRAM_BUCKETS];
+        unsigned short  m_uWindow[LATENCY_HISTOGRAM_WINDOW];                        // Bucket of each sample in the window
+        unsigned int    m_uNextSample;                                              // Oldest sample once the window is full
+        unsigned int    m_uSamples;
+    };
+}
+
+#endif // AMD_SDK_LATENCY_HISTOGRAM_H
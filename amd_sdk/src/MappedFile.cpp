@@ -0,0 +1,333 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MappedFile.cpp
+//
+// Read-only memory mapped files, and file operations by wide path
+//--------------------------------------------------------------------------------------
+#include "MappedFile.h"
+
+#include <wchar.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#endif
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    MappedFile::MappedFile()
+        : m_pData( NULL )
+        , m_uSize( 0 )
+        , m_hFile( 0 )
+        , m_hMapping( 0 )
+        , m_bOpen( false )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+
+#ifdef _WIN32
+
+    //--------------------------------------------------------------------------------------
+    bool MappedFile::Open( const wchar_t* szFileName )
+    {
+        Close();
+
+        HANDLE hFile = CreateFileW( szFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if ( hFile == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        LARGE_INTEGER Size;
+        if ( !GetFileSizeEx( hFile, &Size ) || (unsigned long long)Size.QuadPart > (size_t)-1 )
+        {
+            CloseHandle( hFile );
+            return false;
+        }
+
+        m_hFile = (intptr_t)hFile;
+        m_uSize = (size_t)Size.QuadPart;
+        m_bOpen = true;
+
+        // An empty file can't be mapped
+        if ( m_uSize == 0 )
+        {
+            return true;
+        }
+
+        HANDLE hMapping = CreateFileMappingW( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( hMapping == NULL )
+        {
+            Close();
+            return false;
+        }
+        m_hMapping = (intptr_t)hMapping;
+
+        m_pData = (const char*)MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+        if ( m_pData == NULL )
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void MappedFile::Close()
+    {
+        if ( m_pData )
+        {
+            UnmapViewOfFile( m_pData );
+        }
+        if ( m_hMapping )
+        {
+            CloseHandle( (HANDLE)m_hMapping );
+        }
+        if ( m_hFile )
+        {
+            CloseHandle( (HANDLE)m_hFile );
+        }
+
+        m_pData = NULL;
+        m_uSize = 0;
+        m_hFile = 0;
+        m_hMapping = 0;
+        m_bOpen = false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool GetFileInfo( const wchar_t* szFileName, unsigned long long& uModifiedTime, unsigned long long& uSize )
+    {
+        WIN32_FILE_ATTRIBUTE_DATA Data;
+        if ( !GetFileAttributesExW( szFileName, GetFileExInfoStandard, &Data ) )
+        {
+            return false;
+        }
+
+        uModifiedTime = ( (unsigned long long)Data.ftLastWriteTime.dwHighDateTime << 32 ) | Data.ftLastWriteTime.dwLowDateTime;
+        uSize = ( (unsigned long long)Data.nFileSizeHigh << 32 ) | Data.nFileSizeLow;
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    FILE* OpenFileStream( const wchar_t* szFileName, const char* szMode )
+    {
+        wchar_t szWideMode[8] = { 0 };
+        for ( int i = 0; szMode[i] && i < 7; i++ )
+        {
+            szWideMode[i] = (wchar_t)szMode[i];
+        }
+
+        FILE* pFile = NULL;
+        return _wfopen_s( &pFile, szFileName, szWideMode ) == 0 ? pFile : NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool FlushFileToDisk( FILE* pFile )
+    {
+        return fflush( pFile ) == 0 && _commit( _fileno( pFile ) ) == 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ReplaceFileWith( const wchar_t* szFileName, const wchar_t* szNewFile )
+    {
+        return MoveFileExW( szNewFile, szFileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != FALSE;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool RemoveFile( const wchar_t* szFileName )
+    {
+        return DeleteFileW( szFileName ) != FALSE;
+    }
+
+#else
+
+    //--------------------------------------------------------------------------------------
+    // Paths are UTF-8 on POSIX
+    //--------------------------------------------------------------------------------------
+    static std::string ToUtf8( const wchar_t* szText )
+    {
+        std::string Text;
+        for ( const wchar_t* p = szText; *p; p++ )
+        {
+            const unsigned int c = (unsigned int)*p;
+            if ( c < 0x80 )
+            {
+                Text += (char)c;
+            }
+            else if ( c < 0x800 )
+            {
+                Text += (char)( 0xC0 | ( c >> 6 ) );
+                Text += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else if ( c < 0x10000 )
+            {
+                Text += (char)( 0xE0 | ( c >> 12 ) );
+                Text += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Text += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else
+            {
+                Text += (char)( 0xF0 | ( c >> 18 ) );
+                Text += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                Text += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Text += (char)( 0x80 | ( c & 0x3F ) );
+            }
+        }
+        return Text;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool MappedFile::Open( const wchar_t* szFileName )
+    {
+        Close();
+
+        int iFile = open( ToUtf8( szFileName ).c_str(), O_RDONLY );
+        if ( iFile < 0 )
+        {
+            return false;
+        }
+
+        struct stat Stat;
+        if ( fstat( iFile, &Stat ) != 0 )
+        {
+            close( iFile );
+            return false;
+        }
+
+        // Descriptors are stored plus one, so that 0 means none
+        m_hFile = (intptr_t)iFile + 1;
+        m_uSize = (size_t)Stat.st_size;
+        m_bOpen = true;
+
+        if ( m_uSize == 0 )
+        {
+            return true;
+        }
+
+        void* pData = mmap( NULL, m_uSize, PROT_READ, MAP_PRIVATE, iFile, 0 );
+        if ( pData == MAP_FAILED )
+        {
+            Close();
+            return false;
+        }
+        m_pData = (const char*)pData;
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void MappedFile::Close()
+    {
+        if ( m_pData )
+        {
+            munmap( (void*)m_pData, m_uSize );
+        }
+        if ( m_hFile )
+        {
+            close( (int)( m_hFile - 1 ) );
+        }
+
+        m_pData = NULL;
+        m_uSize = 0;
+        m_hFile = 0;
+        m_hMapping = 0;
+        m_bOpen = false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool GetFileInfo( const wchar_t* szFileName, unsigned long long& uModifiedTime, unsigned long long& uSize )
+    {
+        struct stat Stat;
+        if ( stat( ToUtf8( szFileName ).c_str(), &Stat ) != 0 )
+        {
+            return false;
+        }
+
+#ifdef __linux__
+        uModifiedTime = (unsigned long long)Stat.st_mtim.tv_sec * 1000000000ULL + (unsigned long long)Stat.st_mtim.tv_nsec;
+#else
+        uModifiedTime = (unsigned long long)Stat.st_mtime;
+#endif
+        uSize = (unsigned long long)Stat.st_size;
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    FILE* OpenFileStream( const wchar_t* szFileName, const char* szMode )
+    {
+        return fopen( ToUtf8( szFileName ).c_str(), szMode );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool FlushFileToDisk( FILE* pFile )
+    {
+        return fflush( pFile ) == 0 && fsync( fileno( pFile ) ) == 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ReplaceFileWith( const wchar_t* szFileName, const wchar_t* szNewFile )
+    {
+        return rename( ToUtf8( szNewFile ).c_str(), ToUtf8( szFileName ).c_str() ) == 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool RemoveFile( const wchar_t* szFileName )
+    {
+        return remove( ToUtf8( szFileName ).c_str() ) == 0;
+    }
+
+#endif
+}
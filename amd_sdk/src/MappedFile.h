@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MappedFile.h
+//
+// Read-only memory mapping of a whole file, with an implementation for Windows and one
+// for POSIX, so the shader cache can hash and load its files without reading them into
+// buffers first.
+//
+// Also the few file operations the cache needs on both to check its sources and to write
+// its files safely: looking up a file's time and size, opening by a wide path, flushing
+// to disk and replacing one file with another.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_MAPPED_FILE_H
+#define AMD_SDK_MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace AMD
+{
+    class MappedFile
+    {
+    public:
+
+        MappedFile();
+        ~MappedFile();
+
+        // Maps the file, closing the one mapped before. False if it can't be opened or
+        // mapped. An empty file maps with no data.
+        bool Open( const wchar_t* szFileName );
+        void Close();
+
+        bool IsOpen() const { return m_bOpen; }
+        const char* GetData() const { return m_pData; }
+        size_t GetSize() const { return m_uSize; }
+
+    private:
+
+        MappedFile( const MappedFile& );
+        MappedFile& operator=( const MappedFile& );
+
+        const char*         m_pData;
+        size_t              m_uSize;
+        intptr_t            m_hFile;        // Handle on Windows, descriptor on POSIX
+        intptr_t            m_hMapping;     // Windows only
+        bool                m_bOpen;
+    };
+
+    // Last write time, in units that depend on the platform, and size of a file, without
+    // opening it. False if it doesn't exist.
+    bool GetFileInfo( const wchar_t* szFileName, unsigned long long& uModifiedTime, unsigned long long& uSize );
+
+    // fopen with a wide path, which is UTF-8 on POSIX
+    FILE* OpenFileStream( const wchar_t* szFileName, const char* szMode );
+
+    // Flushes the file's buffers and waits for the data to reach the disk
+    bool FlushFileToDisk( FILE* pFile );
+
+    // Renames szNewFile to szFileName, replacing it in one step if it exists
+    bool ReplaceFileWith( const wchar_t* szFileName, const wchar_t* szNewFile );
+
+    bool RemoveFile( const wchar_t* szFileName );
+}
+
+#endif // AMD_SDK_MAPPED_FILE_H
@@ -0,0 +1,743 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshOptimizer.cpp
+//
+// Offline triangle and vertex reordering for indexed triangle lists.
+//--------------------------------------------------------------------------------------
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+
+namespace AMD
+{
+
+//--------------------------------------------------------------------------------------
+// Forsyth vertex cache optimization constants
+//--------------------------------------------------------------------------------------
+static const int   FORSYTH_CACHE_SIZE           = 32;
+static const float FORSYTH_CACHE_DECAY_POWER    = 1.5f;
+static const float FORSYTH_LAST_TRI_SCORE       = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE  = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER  = 0.5f;
+
+// Resolution of the software rasterizer used to measure overdraw
+static const int   OVERDRAW_RESOLUTION          = 256;
+
+// Vertex fetch cache model
+static const unsigned int FETCH_CACHE_LINE_SIZE = 64;
+static const unsigned int FETCH_CACHE_LINES     = 128;
+
+
+//--------------------------------------------------------------------------------------
+// Simple FIFO cache simulation, as used by the post-transform cache on GCN
+//--------------------------------------------------------------------------------------
+class FIFOCache
+{
+public:
+
+    FIFOCache( size_t uVertexCount, unsigned int uCacheSize ) :
+      m_Timestamps( uVertexCount, 0 ),
+      m_uTime( uCacheSize + 1 ),
+      m_uCacheSize( uCacheSize )
+    {
+    }
+
+    // Returns true on a cache miss
+    bool Access( unsigned int uVertex )
+    {
+        if ( m_uTime - m_Timestamps[uVertex] > m_uCacheSize )
+        {
+            m_Timestamps[uVertex] = m_uTime++;
+            return true;
+        }
+        return false;
+    }
+
+    // Invalidates the whole cache
+    void Flush()
+    {
+        m_uTime += m_uCacheSize + 1;
+    }
+
+private:
+
+    std::vector<unsigned int>   m_Timestamps;
+    unsigned int                m_uTime;
+    unsigned int                m_uCacheSize;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Per-vertex triangle adjacency, stored as one flat array
+//--------------------------------------------------------------------------------------
+struct TriangleAdjacency
+{
+    std::vector<unsigned int> m_Counts;
+    std::vector<unsigned int> m_Offsets;
+    std::vector<unsigned int> m_Triangles;
+
+    void Build( const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount )
+    {
+        const size_t uTriangleCount = uIndexCount / 3;
+
+        m_Counts.assign( uVertexCount, 0 );
+        m_Offsets.assign( uVertexCount, 0 );
+        m_Triangles.resize( uTriangleCount * 3 );
+
+        for ( size_t i = 0; i < uTriangleCount * 3; i++ )
+        {
+            m_Counts[ pIndices[i] ]++;
+        }
+
+        unsigned int uOffset = 0;
+        for ( size_t i = 0; i < uVertexCount; i++ )
+        {
+            m_Offsets[i] = uOffset;
+            uOffset += m_Counts[i];
+        }
+
+        std::vector<unsigned int> Fill( m_Offsets );
+        for ( size_t i = 0; i < uTriangleCount * 3; i++ )
+        {
+            m_Triangles[ Fill[ pIndices[i] ]++ ] = (unsigned int)( i / 3 );
+        }
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Forsyth vertex score, based on the cache position and the number of remaining triangles
+//--------------------------------------------------------------------------------------
+static float ForsythVertexScore( int iCachePosition, unsigned int uRemainingTriangles )
+{
+    if ( uRemainingTriangles == 0 )
+    {
+        // No triangles left, this vertex is not needed any more
+        return -1.0f;
+    }
+
+    float fScore = 0.0f;
+    if ( iCachePosition >= 0 )
+    {
+        if ( iCachePosition < 3 )
+        {
+            // Used by the last triangle, which gets a fixed score so that
+            // fans and strips are not followed too eagerly
+            fScore = FORSYTH_LAST_TRI_SCORE;
+        }
+        else
+        {
+            const float fScaler = 1.0f / ( FORSYTH_CACHE_SIZE - 3 );
+            fScore = 1.0f - (float)( iCachePosition - 3 ) * fScaler;
+            fScore = powf( fScore, FORSYTH_CACHE_DECAY_POWER );
+        }
+    }
+
+    // Bonus for vertices with few remaining triangles, so lone triangles get finished off
+    fScore += FORSYTH_VALENCE_BOOST_SCALE * powf( (float)uRemainingTriangles, -FORSYTH_VALENCE_BOOST_POWER );
+
+    return fScore;
+}
+
+
+//--------------------------------------------------------------------------------------
+VertexCacheStatistics AnalyzeVertexCache( const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount, unsigned int uCacheSize )
+{
+    VertexCacheStatistics Stats;
+    memset( &Stats, 0, sizeof( Stats ) );
+
+    if ( uIndexCount < 3 || uVertexCount == 0 )
+    {
+        return Stats;
+    }
+
+    FIFOCache Cache( uVertexCount, uCacheSize );
+    std::vector<bool> Referenced( uVertexCount, false );
+    unsigned int uUniqueVertices = 0;
+
+    const size_t uTriangleCount = uIndexCount / 3;
+    for ( size_t i = 0; i < uTriangleCount * 3; i++ )
+    {
+        const unsigned int uVertex = pIndices[i];
+
+        if ( Cache.Access( uVertex ) )
+        {
+            Stats.uVerticesTransformed++;
+        }
+
+        if ( !Referenced[uVertex] )
+        {
+            Referenced[uVertex] = true;
+            uUniqueVertices++;
+        }
+    }
+
+    Stats.fACMR = (float)Stats.uVerticesTransformed / (float)uTriangleCount;
+    Stats.fATVR = (float)Stats.uVerticesTransformed / (float)uUniqueVertices;
+
+    return Stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Rasterizes one triangle into the depth buffer, counting the pixels that pass the depth
+// test. Vertices are in pixel units in x and y, and [0,1] in z. Only counter-clockwise
+// triangles (in this coordinate system) are drawn, mirroring back-face culling.
+//--------------------------------------------------------------------------------------
+static unsigned int RasterizeTriangle( float* pDepth, const float* v0, const float* v1, const float* v2 )
+{
+    const float fArea = ( v1[0] - v0[0] ) * ( v2[1] - v0[1] ) - ( v1[1] - v0[1] ) * ( v2[0] - v0[0] );
+    if ( fArea <= 0.0f )
+    {
+        return 0;
+    }
+
+    const float fInvArea = 1.0f / fArea;
+
+    int iMinX = (int)floorf( std::min( v0[0], std::min( v1[0], v2[0] ) ) );
+    int iMinY = (int)floorf( std::min( v0[1], std::min( v1[1], v2[1] ) ) );
+    int iMaxX = (int)ceilf( std::max( v0[0], std::max( v1[0], v2[0] ) ) );
+    int iMaxY = (int)ceilf( std::max( v0[1], std::max( v1[1], v2[1] ) ) );
+
+    iMinX = std::max( iMinX, 0 );
+    iMinY = std::max( iMinY, 0 );
+    iMaxX = std::min( iMaxX, OVERDRAW_RESOLUTION - 1 );
+    iMaxY = std::min( iMaxY, OVERDRAW_RESOLUTION - 1 );
+
+    unsigned int uShaded = 0;
+
+    for ( int y = iMinY; y <= iMaxY; y++ )
+    {
+        const float py = (float)y + 0.5f;
+
+        for ( int x = iMinX; x <= iMaxX; x++ )
+        {
+            const float px = (float)x + 0.5f;
+
+            // Barycentric coordinates from the edge functions
+            const float w0 = ( v2[0] - v1[0] ) * ( py - v1[1] ) - ( v2[1] - v1[1] ) * ( px - v1[0] );
+            const float w1 = ( v0[0] - v2[0] ) * ( py - v2[1] ) - ( v0[1] - v2[1] ) * ( px - v2[0] );
+            const float w2 = ( v1[0] - v0[0] ) * ( py - v0[1] ) - ( v1[1] - v0[1] ) * ( px - v0[0] );
+
+            if ( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f )
+            {
+                continue;
+            }
+
+            const float z = ( w0 * v0[2] + w1 * v1[2] + w2 * v2[2] ) * fInvArea;
+
+            float& fDepth = pDepth[ y * OVERDRAW_RESOLUTION + x ];
+            if ( z < fDepth )
+            {
+                fDepth = z;
+                uShaded++;
+            }
+        }
+    }
+
+    return uShaded;
+}
+
+
+//--------------------------------------------------------------------------------------
+OverdrawStatistics AnalyzeOverdraw( const unsigned int* pIndices, size_t uIndexCount,
+                                    const float* pPositions, size_t uVertexCount, size_t uPositionStride )
+{
+    OverdrawStatistics Stats;
+    memset( &Stats, 0, sizeof( Stats ) );
+
+    if ( uIndexCount < 3 || uVertexCount == 0 )
+    {
+        return Stats;
+    }
+
+    const unsigned char* pPositionBytes = (const unsigned char*)pPositions;
+
+    // Bounding box of the referenced vertices
+    float fMin[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+    float fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const float* p = (const float*)( pPositionBytes + pIndices[i] * uPositionStride );
+        for ( int j = 0; j < 3; j++ )
+        {
+            fMin[j] = std::min( fMin[j], p[j] );
+            fMax[j] = std::max( fMax[j], p[j] );
+        }
+    }
+
+    const float fExtent = std::max( fMax[0] - fMin[0], std::max( fMax[1] - fMin[1], fMax[2] - fMin[2] ) );
+    const float fScale = ( fExtent > 0.0f ) ? 1.0f / fExtent : 0.0f;
+
+    std::vector<float> Depth( OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION );
+    std::vector<float> Projected( uVertexCount * 3 );
+
+    const size_t uTriangleCount = uIndexCount / 3;
+
+    // Render along +X, -X, +Y, -Y, +Z and -Z
+    for ( int iAxis = 0; iAxis < 3; iAxis++ )
+    {
+        for ( int iSign = 0; iSign < 2; iSign++ )
+        {
+            const int iU = ( iAxis + 1 ) % 3;
+            const int iV = ( iAxis + 2 ) % 3;
+
+            for ( size_t i = 0; i < uIndexCount; i++ )
+            {
+                const unsigned int uVertex = pIndices[i];
+                const float* p = (const float*)( pPositionBytes + uVertex * uPositionStride );
+                float* pProjected = &Projected[ uVertex * 3 ];
+
+                float u = ( p[iU] - fMin[iU] ) * fScale;
+                float v = ( p[iV] - fMin[iV] ) * fScale;
+                float z = ( p[iAxis] - fMin[iAxis] ) * fScale;
+
+                // Looking from the other side mirrors the image and reverses depth
+                if ( iSign )
+                {
+                    u = 1.0f - u;
+                    z = 1.0f - z;
+                }
+
+                pProjected[0] = u * OVERDRAW_RESOLUTION;
+                pProjected[1] = v * OVERDRAW_RESOLUTION;
+                pProjected[2] = z;
+            }
+
+            std::fill( Depth.begin(), Depth.end(), FLT_MAX );
+
+            for ( size_t t = 0; t < uTriangleCount; t++ )
+            {
+                Stats.uPixelsShaded += RasterizeTriangle( &Depth[0],
+                                                          &Projected[ pIndices[ t * 3 + 0 ] * 3 ],
+                                                          &Projected[ pIndices[ t * 3 + 1 ] * 3 ],
+                                                          &Projected[ pIndices[ t * 3 + 2 ] * 3 ] );
+            }
+
+            for ( size_t i = 0; i < Depth.size(); i++ )
+            {
+                if ( Depth[i] != FLT_MAX )
+                {
+                    Stats.uPixelsCovered++;
+                }
+            }
+        }
+    }
+
+    Stats.fOverdraw = ( Stats.uPixelsCovered > 0 ) ? (float)Stats.uPixelsShaded / (float)Stats.uPixelsCovered : 0.0f;
+
+    return Stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+VertexFetchStatistics AnalyzeVertexFetch( const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount, size_t uVertexSize )
+{
+    VertexFetchStatistics Stats;
+    memset( &Stats, 0, sizeof( Stats ) );
+
+    if ( uIndexCount == 0 || uVertexCount == 0 || uVertexSize == 0 )
+    {
+        return Stats;
+    }
+
+    // Fully associative LRU cache of FETCH_CACHE_LINES lines
+    size_t uLines[FETCH_CACHE_LINES];
+    unsigned int uNumLines = 0;
+
+    std::vector<bool> Referenced( uVertexCount, false );
+    size_t uUniqueVertices = 0;
+
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const unsigned int uVertex = pIndices[i];
+
+        if ( !Referenced[uVertex] )
+        {
+            Referenced[uVertex] = true;
+            uUniqueVertices++;
+        }
+
+        const size_t uStartLine = ( uVertex * uVertexSize ) / FETCH_CACHE_LINE_SIZE;
+        const size_t uEndLine = ( uVertex * uVertexSize + uVertexSize - 1 ) / FETCH_CACHE_LINE_SIZE;
+
+        for ( size_t uLine = uStartLine; uLine <= uEndLine; uLine++ )
+        {
+            unsigned int uSlot = 0;
+            while ( uSlot < uNumLines && uLines[uSlot] != uLine )
+            {
+                uSlot++;
+            }
+
+            if ( uSlot == uNumLines )
+            {
+                // Miss: evict the least recently used line (the last one)
+                Stats.uBytesFetched += FETCH_CACHE_LINE_SIZE;
+                if ( uNumLines < FETCH_CACHE_LINES )
+                {
+                    uNumLines++;
+                }
+                uSlot = uNumLines - 1;
+            }
+
+            // Move to the front
+            memmove( &uLines[1], &uLines[0], uSlot * sizeof( size_t ) );
+            uLines[0] = uLine;
+        }
+    }
+
+    Stats.fOverfetch = (float)Stats.uBytesFetched / (float)( uUniqueVertices * uVertexSize );
+
+    return Stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OptimizeVertexCache( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount )
+{
+    const size_t uTriangleCount = uIndexCount / 3;
+    if ( uTriangleCount == 0 )
+    {
+        return;
+    }
+
+    TriangleAdjacency Adjacency;
+    Adjacency.Build( pIndices, uTriangleCount * 3, uVertexCount );
+
+    // Remaining (not yet emitted) triangle count per vertex
+    std::vector<unsigned int> Remaining( Adjacency.m_Counts );
+
+    std::vector<int> CachePosition( uVertexCount, -1 );
+    std::vector<float> VertexScore( uVertexCount );
+    for ( size_t i = 0; i < uVertexCount; i++ )
+    {
+        VertexScore[i] = ForsythVertexScore( -1, Remaining[i] );
+    }
+
+    std::vector<float> TriangleScore( uTriangleCount );
+    for ( size_t t = 0; t < uTriangleCount; t++ )
+    {
+        TriangleScore[t] = VertexScore[ pIndices[ t * 3 + 0 ] ] + VertexScore[ pIndices[ t * 3 + 1 ] ] + VertexScore[ pIndices[ t * 3 + 2 ] ];
+    }
+
+    std::vector<bool> Emitted( uTriangleCount, false );
+
+    // LRU cache, with room for the 3 vertices pushed in by the new triangle
+    unsigned int Cache[ FORSYTH_CACHE_SIZE + 3 ];
+    unsigned int NewCache[ FORSYTH_CACHE_SIZE + 3 ];
+    int iCacheCount = 0;
+
+    size_t uInputCursor = 0;
+    size_t uOutputTriangle = 0;
+    unsigned int uBestTriangle = 0;
+
+    while ( uOutputTriangle < uTriangleCount )
+    {
+        // Emit the best triangle
+        const unsigned int* pTri = &pIndices[ uBestTriangle * 3 ];
+        pDstIndices[ uOutputTriangle * 3 + 0 ] = pTri[0];
+        pDstIndices[ uOutputTriangle * 3 + 1 ] = pTri[1];
+        pDstIndices[ uOutputTriangle * 3 + 2 ] = pTri[2];
+        uOutputTriangle++;
+        Emitted[uBestTriangle] = true;
+
+        // Push its vertices to the front of the LRU cache
+        int iNewCount = 0;
+        NewCache[iNewCount++] = pTri[0];
+        NewCache[iNewCount++] = pTri[1];
+        NewCache[iNewCount++] = pTri[2];
+        for ( int i = 0; i < iCacheCount; i++ )
+        {
+            const unsigned int uVertex = Cache[i];
+            if ( uVertex != pTri[0] && uVertex != pTri[1] && uVertex != pTri[2] )
+            {
+                NewCache[iNewCount++] = uVertex;
+            }
+        }
+
+        // Remove the triangle from the adjacency of its vertices
+        for ( int k = 0; k < 3; k++ )
+        {
+            const unsigned int uVertex = pTri[k];
+            unsigned int* pAdjacent = &Adjacency.m_Triangles[ Adjacency.m_Offsets[uVertex] ];
+            const unsigned int uCount = Remaining[uVertex];
+            for ( unsigned int i = 0; i < uCount; i++ )
+            {
+                if ( pAdjacent[i] == uBestTriangle )
+                {
+                    pAdjacent[i] = pAdjacent[ uCount - 1 ];
+                    break;
+                }
+            }
+            Remaining[uVertex]--;
+        }
+
+        // Update the scores of all vertices in the cache (including the ones falling out),
+        // and the scores of their triangles. The best candidate is picked from these.
+        float fBestScore = -1.0f;
+        unsigned int uBestCandidate = ~0u;
+
+        for ( int i = 0; i < iNewCount; i++ )
+        {
+            const unsigned int uVertex = NewCache[i];
+            const int iPosition = ( i < FORSYTH_CACHE_SIZE ) ? i : -1;
+
+            CachePosition[uVertex] = iPosition;
+
+            const float fNewScore = ForsythVertexScore( iPosition, Remaining[uVertex] );
+            const float fDelta = fNewScore - VertexScore[uVertex];
+            VertexScore[uVertex] = fNewScore;
+
+            const unsigned int* pAdjacent = &Adjacency.m_Triangles[ Adjacency.m_Offsets[uVertex] ];
+            for ( unsigned int j = 0; j < Remaining[uVertex]; j++ )
+            {
+                const unsigned int uTriangle = pAdjacent[j];
+                TriangleScore[uTriangle] += fDelta;
+
+                if ( TriangleScore[uTriangle] > fBestScore )
+                {
+                    fBestScore = TriangleScore[uTriangle];
+                    uBestCandidate = uTriangle;
+                }
+            }
+        }
+
+        iCacheCount = std::min( iNewCount, FORSYTH_CACHE_SIZE );
+        memcpy( Cache, NewCache, iCacheCount * sizeof( unsigned int ) );
+
+        if ( uBestCandidate == ~0u )
+        {
+            // Nothing adjacent to the cache, continue with the next triangle in input order
+            while ( uInputCursor < uTriangleCount && Emitted[uInputCursor] )
+            {
+                uInputCursor++;
+            }
+            if ( uInputCursor == uTriangleCount )
+            {
+                break;
+            }
+            uBestCandidate = (unsigned int)uInputCursor;
+        }
+
+        uBestTriangle = uBestCandidate;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void OptimizeOverdraw( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount,
+                       const float* pPositions, size_t uVertexCount, size_t uPositionStride, float fThreshold )
+{
+    const size_t uTriangleCount = uIndexCount / 3;
+    if ( uTriangleCount == 0 )
+    {
+        return;
+    }
+
+    const unsigned char* pPositionBytes = (const unsigned char*)pPositions;
+
+    // ACMR of the input order, used as the reference for closing clusters
+    const VertexCacheStatistics InputStats = AnalyzeVertexCache( pIndices, uTriangleCount * 3, uVertexCount );
+    const float fTargetACMR = InputStats.fACMR * fThreshold;
+
+    // Split the input into clusters. Each cluster starts with a cold cache, since it may
+    // be moved anywhere in the output. A cluster is closed once its ACMR has come down
+    // to the target, or when the input order flushes the cache anyway.
+    std::vector<size_t> ClusterStart( 1, 0 );
+    {
+        FIFOCache Cache( uVertexCount, MESH_OPTIMIZER_VERTEX_CACHE_SIZE );
+        unsigned int uClusterMisses = 0;
+        size_t uClusterTriangles = 0;
+
+        for ( size_t t = 0; t < uTriangleCount; t++ )
+        {
+            unsigned int uMisses = 0;
+            for ( int k = 0; k < 3; k++ )
+            {
+                uMisses += Cache.Access( pIndices[ t * 3 + k ] ) ? 1 : 0;
+            }
+
+            // A triangle that misses all three vertices starts a new cluster for free
+            if ( uMisses == 3 && uClusterTriangles > 0 )
+            {
+                ClusterStart.push_back( t );
+                uClusterMisses = 0;
+                uClusterTriangles = 0;
+            }
+
+            uClusterMisses += uMisses;
+            uClusterTriangles++;
+
+            if ( (float)uClusterMisses <= fTargetACMR * (float)uClusterTriangles && t + 1 < uTriangleCount )
+            {
+                // Close the cluster here; the next one starts cold
+                ClusterStart.push_back( t + 1 );
+                Cache.Flush();
+                uClusterMisses = 0;
+                uClusterTriangles = 0;
+            }
+        }
+    }
+    const size_t uClusterCount = ClusterStart.size();
+    ClusterStart.push_back( uTriangleCount );
+
+    // Area weighted centroid and normal for every cluster, plus the mesh centroid
+    std::vector<float> ClusterData( uClusterCount * 6, 0.0f );
+    float fMeshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float fMeshArea = 0.0f;
+
+    for ( size_t c = 0; c < uClusterCount; c++ )
+    {
+        float* pCentroid = &ClusterData[ c * 6 + 0 ];
+        float* pNormal = &ClusterData[ c * 6 + 3 ];
+        float fClusterArea = 0.0f;
+
+        for ( size_t t = ClusterStart[c]; t < ClusterStart[ c + 1 ]; t++ )
+        {
+            const float* p0 = (const float*)( pPositionBytes + pIndices[ t * 3 + 0 ] * uPositionStride );
+            const float* p1 = (const float*)( pPositionBytes + pIndices[ t * 3 + 1 ] * uPositionStride );
+            const float* p2 = (const float*)( pPositionBytes + pIndices[ t * 3 + 2 ] * uPositionStride );
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                 e1[2] * e2[0] - e1[0] * e2[2],
+                                 e1[0] * e2[1] - e1[1] * e2[0] };
+            const float fArea = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+            for ( int k = 0; k < 3; k++ )
+            {
+                pCentroid[k] += ( p0[k] + p1[k] + p2[k] ) * ( 1.0f / 3.0f ) * fArea;
+                pNormal[k] += n[k];
+            }
+            fClusterArea += fArea;
+        }
+
+        for ( int k = 0; k < 3; k++ )
+        {
+            fMeshCentroid[k] += pCentroid[k];
+        }
+        fMeshArea += fClusterArea;
+
+        const float fInvArea = ( fClusterArea > 0.0f ) ? 1.0f / fClusterArea : 0.0f;
+        const float fNormalLength = sqrtf( pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2] );
+        const float fInvNormalLength = ( fNormalLength > 0.0f ) ? 1.0f / fNormalLength : 0.0f;
+        for ( int k = 0; k < 3; k++ )
+        {
+            pCentroid[k] *= fInvArea;
+            pNormal[k] *= fInvNormalLength;
+        }
+    }
+
+    const float fInvMeshArea = ( fMeshArea > 0.0f ) ? 1.0f / fMeshArea : 0.0f;
+    for ( int k = 0; k < 3; k++ )
+    {
+        fMeshCentroid[k] *= fInvMeshArea;
+    }
+
+    // Clusters that face away from the mesh centre are likely to occlude the
+    // others from any view point, so draw them first
+    std::vector< std::pair<float, unsigned int> > SortKeys( uClusterCount );
+    for ( size_t c = 0; c < uClusterCount; c++ )
+    {
+        const float* pCentroid = &ClusterData[ c * 6 + 0 ];
+        const float* pNormal = &ClusterData[ c * 6 + 3 ];
+        const float fDot = ( pCentroid[0] - fMeshCentroid[0] ) * pNormal[0] +
+                           ( pCentroid[1] - fMeshCentroid[1] ) * pNormal[1] +
+                           ( pCentroid[2] - fMeshCentroid[2] ) * pNormal[2];
+
+        SortKeys[c] = std::make_pair( -fDot, (unsigned int)c );
+    }
+    std::stable_sort( SortKeys.begin(), SortKeys.end() );
+
+    size_t uOutput = 0;
+    for ( size_t i = 0; i < uClusterCount; i++ )
+    {
+        const unsigned int c = SortKeys[i].second;
+        const size_t uStart = ClusterStart[c] * 3;
+        const size_t uEnd = ClusterStart[ c + 1 ] * 3;
+
+        memcpy( &pDstIndices[uOutput], &pIndices[uStart], ( uEnd - uStart ) * sizeof( unsigned int ) );
+        uOutput += uEnd - uStart;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t OptimizeVertexFetchRemap( unsigned int* pRemap, const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount )
+{
+    memset( pRemap, 0xFF, uVertexCount * sizeof( unsigned int ) );
+
+    unsigned int uNextVertex = 0;
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const unsigned int uVertex = pIndices[i];
+        if ( pRemap[uVertex] == ~0u )
+        {
+            pRemap[uVertex] = uNextVertex++;
+        }
+    }
+
+    const size_t uReferenced = uNextVertex;
+
+    // Keep unreferenced vertices, in their original order, after the referenced ones
+    for ( size_t i = 0; i < uVertexCount; i++ )
+    {
+        if ( pRemap[i] == ~0u )
+        {
+            pRemap[i] = uNextVertex++;
+        }
+    }
+
+    return uReferenced;
+}
+
+
+//--------------------------------------------------------------------------------------
+void RemapIndices( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount, const unsigned int* pRemap )
+{
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        pDstIndices[i] = pRemap[ pIndices[i] ];
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void RemapVertices( void* pDstVertices, const void* pVertices, size_t uVertexCount, size_t uVertexSize, const unsigned int* pRemap )
+{
+    unsigned char* pDst = (unsigned char*)pDstVertices;
+    const unsigned char* pSrc = (const unsigned char*)pVertices;
+
+    for ( size_t i = 0; i < uVertexCount; i++ )
+    {
+        memcpy( pDst + pRemap[i] * uVertexSize, pSrc + i * uVertexSize, uVertexSize );
+    }
+}
+
+} // namespace AMD
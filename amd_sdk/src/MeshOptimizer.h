@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshOptimizer.h
+//
+// Offline triangle and vertex reordering for indexed triangle lists. The functions here
+// only touch plain index and vertex arrays, so they can be used by the sample at load
+// time as well as by headless tools that have no D3D device.
+//
+// OptimizeVertexCache reorders triangles for post-transform vertex cache locality using
+// Tom Forsyth's linear-speed vertex cache optimisation. OptimizeOverdraw then splits that
+// order into clusters and sorts them front-to-back from the outside of the mesh, following
+// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw" (SIGGRAPH 2007). OptimizeVertexFetchRemap finally lays vertices out in the
+// order they are first referenced.
+//
+// The Analyze functions simulate the respective hardware units so the effect of each
+// step can be measured before and after.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_MESH_OPTIMIZER_H
+#define AMD_SDK_MESH_OPTIMIZER_H
+
+#include <stddef.h>
+
+namespace AMD
+{
+    // Size of the FIFO post-transform cache used for the statistics
+    static const unsigned int MESH_OPTIMIZER_VERTEX_CACHE_SIZE = 16;
+
+    // Post-transform vertex cache statistics
+    struct VertexCacheStatistics
+    {
+        unsigned int    uVerticesTransformed;   // Number of cache misses
+        float           fACMR;                  // Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0)
+        float           fATVR;                  // Average transform to vertex ratio: transformed vertices per referenced vertex (1.0 - 6.0)
+    };
+
+    // Overdraw statistics, gathered by rasterizing the mesh from the 6 axis directions
+    struct OverdrawStatistics
+    {
+        unsigned int    uPixelsCovered;         // Pixels covered by at least one triangle
+        unsigned int    uPixelsShaded;          // Pixels that passed the depth test
+        float           fOverdraw;              // Shaded / covered (1.0 is optimal)
+    };
+
+    // Vertex fetch statistics, simulating a small cache of 64 byte lines
+    struct VertexFetchStatistics
+    {
+        unsigned int    uBytesFetched;          // Bytes read from memory
+        float           fOverfetch;             // Fetched / referenced vertex data (1.0 is optimal)
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    // Analysis
+    //--------------------------------------------------------------------------------------
+    VertexCacheStatistics AnalyzeVertexCache( const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount,
+                                              unsigned int uCacheSize = MESH_OPTIMIZER_VERTEX_CACHE_SIZE );
+
+    OverdrawStatistics AnalyzeOverdraw( const unsigned int* pIndices, size_t uIndexCount,
+                                        const float* pPositions, size_t uVertexCount, size_t uPositionStride );
+
+    VertexFetchStatistics AnalyzeVertexFetch( const unsigned int* pIndices, size_t uIndexCount,
+                                              size_t uVertexCount, size_t uVertexSize );
+
+
+    //--------------------------------------------------------------------------------------
+    // Optimization
+    //--------------------------------------------------------------------------------------
+
+    // Reorders triangles for vertex cache locality. pDstIndices must not alias pIndices.
+    void OptimizeVertexCache( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount );
+
+    // Reorders clusters of an already cache-optimized index list to reduce overdraw. fThreshold is the
+    // ACMR a cluster may reach, relative to the input, before it is closed (1.05 keeps the cache
+    // efficiency within 5%). uPositionStride is in bytes. pDstIndices must not alias pIndices.
+    void OptimizeOverdraw( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount,
+                           const float* pPositions, size_t uVertexCount, size_t uPositionStride, float fThreshold = 1.05f );
+
+    // Generates a remap table (pRemap[uOldVertex] = uNewVertex) that orders vertices by first use.
+    // Unreferenced vertices are kept and moved to the end. Returns the number of referenced vertices.
+    size_t OptimizeVertexFetchRemap( unsigned int* pRemap, const unsigned int* pIndices, size_t uIndexCount, size_t uVertexCount );
+
+    // Apply a remap table generated by OptimizeVertexFetchRemap
+    void RemapIndices( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount, const unsigned int* pRemap );
+    void RemapVertices( void* pDstVertices, const void* pVertices, size_t uVertexCount, size_t uVertexSize, const unsigned int* pRemap );
+
+} // namespace AMD
+
+#endif // AMD_SDK_MESH_OPTIMIZER_H
@@ -0,0 +1,435 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshSimplifier.cpp
+//
+// Quadric error metric simplification for indexed triangle lists.
+//--------------------------------------------------------------------------------------
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace AMD
+{
+
+//--------------------------------------------------------------------------------------
+// Symmetric 4x4 error quadric, stored as the upper triangle. w is the accumulated area,
+// used to turn the summed squared distances into an average.
+//--------------------------------------------------------------------------------------
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double w;
+};
+
+static void QuadricFromTriangle( Quadric& Q, const float* p0, const float* p1, const float* p2 )
+{
+    const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    double n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0] };
+
+    const double fLength = sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+    const double fArea = fLength * 0.5;
+    if ( fLength > 0.0 )
+    {
+        n[0] /= fLength;
+        n[1] /= fLength;
+        n[2] /= fLength;
+    }
+
+    const double d = -( n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2] );
+
+    Q.a00 = fArea * n[0] * n[0];
+    Q.a01 = fArea * n[0] * n[1];
+    Q.a02 = fArea * n[0] * n[2];
+    Q.a11 = fArea * n[1] * n[1];
+    Q.a12 = fArea * n[1] * n[2];
+    Q.a22 = fArea * n[2] * n[2];
+    Q.b0 = fArea * n[0] * d;
+    Q.b1 = fArea * n[1] * d;
+    Q.b2 = fArea * n[2] * d;
+    Q.c = fArea * d * d;
+    Q.w = fArea;
+}
+
+static void QuadricAdd( Quadric& Q, const Quadric& R )
+{
+    Q.a00 += R.a00; Q.a01 += R.a01; Q.a02 += R.a02;
+    Q.a11 += R.a11; Q.a12 += R.a12; Q.a22 += R.a22;
+    Q.b0 += R.b0; Q.b1 += R.b1; Q.b2 += R.b2;
+    Q.c += R.c;
+    Q.w += R.w;
+}
+
+// Average squared distance of p to the planes summed in Q and R
+static double QuadricError( const Quadric& Q, const Quadric& R, const float* p )
+{
+    const double x = p[0], y = p[1], z = p[2];
+
+    const double a00 = Q.a00 + R.a00, a01 = Q.a01 + R.a01, a02 = Q.a02 + R.a02;
+    const double a11 = Q.a11 + R.a11, a12 = Q.a12 + R.a12, a22 = Q.a22 + R.a22;
+    const double b0 = Q.b0 + R.b0, b1 = Q.b1 + R.b1, b2 = Q.b2 + R.b2;
+    const double w = Q.w + R.w;
+
+    const double fError = a00 * x * x + a11 * y * y + a22 * z * z +
+                          2.0 * ( a01 * x * y + a02 * x * z + a12 * y * z ) +
+                          2.0 * ( b0 * x + b1 * y + b2 * z ) +
+                          Q.c + R.c;
+
+    return ( w > 0.0 ) ? fabs( fError ) / w : 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Hashes vertex positions so that copies of a vertex can be found
+//--------------------------------------------------------------------------------------
+struct PositionKey
+{
+    unsigned int x, y, z;
+
+    bool operator==( const PositionKey& rhs ) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()( const PositionKey& k ) const
+    {
+        return ( k.x * 73856093u ) ^ ( k.y * 19349663u ) ^ ( k.z * 83492791u );
+    }
+};
+
+
+// A collapse of canonical vertex U into canonical vertex V
+struct Collapse
+{
+    double          fCost;
+    unsigned int    U;
+    unsigned int    V;
+
+    bool operator<( const Collapse& rhs ) const { return fCost < rhs.fCost; }
+};
+
+
+//--------------------------------------------------------------------------------------
+static const float* GetPosition( const float* pPositions, size_t uPositionStride, unsigned int uVertex )
+{
+    return (const float*)( (const unsigned char*)pPositions + uVertex * uPositionStride );
+}
+
+static void TriangleNormal( const float* p0, const float* p1, const float* p2, double* n )
+{
+    const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t SimplifyMesh( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount,
+                     const float* pPositions, size_t uVertexCount, size_t uPositionStride,
+                     size_t uTargetIndexCount, float fTargetError, float* pResultError )
+{
+    std::vector<unsigned int> Indices( pIndices, pIndices + uIndexCount / 3 * 3 );
+    double fResultError = 0.0;
+
+    // Map every vertex to the first vertex with the same position
+    std::vector<unsigned int> Canonical( uVertexCount );
+    {
+        std::unordered_map<PositionKey, unsigned int, PositionKeyHash> Positions;
+        Positions.reserve( uVertexCount );
+
+        for ( unsigned int i = 0; i < (unsigned int)uVertexCount; i++ )
+        {
+            const float* p = GetPosition( pPositions, uPositionStride, i );
+            PositionKey Key;
+            memcpy( &Key, p, sizeof( Key ) );
+
+            Canonical[i] = Positions.insert( std::make_pair( Key, i ) ).first->second;
+        }
+    }
+
+    std::vector<Quadric> Quadrics( uVertexCount );
+    memset( &Quadrics[0], 0, uVertexCount * sizeof( Quadric ) );
+    for ( size_t i = 0; i < Indices.size(); i += 3 )
+    {
+        Quadric Q;
+        QuadricFromTriangle( Q,
+                             GetPosition( pPositions, uPositionStride, Indices[ i + 0 ] ),
+                             GetPosition( pPositions, uPositionStride, Indices[ i + 1 ] ),
+                             GetPosition( pPositions, uPositionStride, Indices[ i + 2 ] ) );
+
+        for ( int k = 0; k < 3; k++ )
+        {
+            QuadricAdd( Quadrics[ Canonical[ Indices[ i + k ] ] ], Q );
+        }
+    }
+
+    const double fMaxCost = (double)fTargetError * (double)fTargetError;
+    const size_t uTargetTriangles = uTargetIndexCount / 3;
+
+    std::vector<unsigned int> AdjacencyCounts( uVertexCount );
+    std::vector<unsigned int> AdjacencyOffsets( uVertexCount );
+    std::vector<unsigned int> Adjacency;
+    std::vector<bool> Locked( uVertexCount );
+    std::vector<bool> Touched( uVertexCount );
+    std::vector<unsigned int> Remap( uVertexCount );
+    std::vector<Collapse> Collapses;
+    std::vector< std::pair<unsigned int, unsigned int> > Copies;
+    std::unordered_map<unsigned long long, unsigned int> Edges;
+
+    // Each pass collapses a set of independent edges, cheapest first
+    while ( Indices.size() / 3 > uTargetTriangles )
+    {
+        const size_t uTriangleCount = Indices.size() / 3;
+
+        // Triangles around every canonical vertex
+        std::fill( AdjacencyCounts.begin(), AdjacencyCounts.end(), 0 );
+        for ( size_t i = 0; i < Indices.size(); i++ )
+        {
+            AdjacencyCounts[ Canonical[ Indices[i] ] ]++;
+        }
+        unsigned int uOffset = 0;
+        for ( size_t i = 0; i < uVertexCount; i++ )
+        {
+            AdjacencyOffsets[i] = uOffset;
+            uOffset += AdjacencyCounts[i];
+        }
+        Adjacency.resize( Indices.size() );
+        std::fill( AdjacencyCounts.begin(), AdjacencyCounts.end(), 0 );
+        for ( size_t i = 0; i < Indices.size(); i++ )
+        {
+            const unsigned int c = Canonical[ Indices[i] ];
+            Adjacency[ AdjacencyOffsets[c] + AdjacencyCounts[c]++ ] = (unsigned int)( i / 3 );
+        }
+
+        // Count the triangles on each edge. Vertices on open or non-manifold edges are locked.
+        Edges.clear();
+        for ( size_t t = 0; t < uTriangleCount; t++ )
+        {
+            for ( int k = 0; k < 3; k++ )
+            {
+                const unsigned int a = Canonical[ Indices[ t * 3 + k ] ];
+                const unsigned int b = Canonical[ Indices[ t * 3 + ( k + 1 ) % 3 ] ];
+                const unsigned long long uKey = ( (unsigned long long)std::min( a, b ) << 32 ) | std::max( a, b );
+                Edges[uKey]++;
+            }
+        }
+
+        std::fill( Locked.begin(), Locked.end(), false );
+        for ( auto it = Edges.begin(); it != Edges.end(); ++it )
+        {
+            if ( it->second != 2 )
+            {
+                Locked[ (unsigned int)( it->first >> 32 ) ] = true;
+                Locked[ (unsigned int)( it->first & 0xFFFFFFFF ) ] = true;
+            }
+        }
+
+        // Cheapest direction for every edge
+        Collapses.clear();
+        for ( auto it = Edges.begin(); it != Edges.end(); ++it )
+        {
+            const unsigned int a = (unsigned int)( it->first >> 32 );
+            const unsigned int b = (unsigned int)( it->first & 0xFFFFFFFF );
+            if ( a == b || ( Locked[a] && Locked[b] ) )
+            {
+                continue;
+            }
+
+            Collapse AB = { Locked[a] ? HUGE_VAL : QuadricError( Quadrics[a], Quadrics[b], GetPosition( pPositions, uPositionStride, b ) ), a, b };
+            Collapse BA = { Locked[b] ? HUGE_VAL : QuadricError( Quadrics[a], Quadrics[b], GetPosition( pPositions, uPositionStride, a ) ), b, a };
+            Collapses.push_back( AB.fCost <= BA.fCost ? AB : BA );
+        }
+        std::sort( Collapses.begin(), Collapses.end() );
+
+        std::fill( Touched.begin(), Touched.end(), false );
+        for ( unsigned int i = 0; i < (unsigned int)uVertexCount; i++ )
+        {
+            Remap[i] = i;
+        }
+
+        size_t uRemovedTriangles = 0;
+        size_t uCollapseCount = 0;
+
+        for ( size_t i = 0; i < Collapses.size(); i++ )
+        {
+            const Collapse& C = Collapses[i];
+            if ( C.fCost > fMaxCost )
+            {
+                break;
+            }
+            if ( Touched[C.U] || Touched[C.V] )
+            {
+                continue;
+            }
+
+            const unsigned int* pAdjacent = &Adjacency[ AdjacencyOffsets[C.U] ];
+            const unsigned int uAdjacentCount = AdjacencyCounts[C.U];
+            const float* pTarget = GetPosition( pPositions, uPositionStride, C.V );
+
+            // Reject collapses that flip a remaining triangle, and find the copy of V that
+            // each copy of U is connected to
+            bool bValid = true;
+            size_t uRemoved = 0;
+            Copies.clear();
+
+            for ( unsigned int j = 0; j < uAdjacentCount && bValid; j++ )
+            {
+                const unsigned int* pTri = &Indices[ pAdjacent[j] * 3 ];
+
+                int iCornerU = -1, iCornerV = -1;
+                for ( int k = 0; k < 3; k++ )
+                {
+                    iCornerU = ( Canonical[ pTri[k] ] == C.U ) ? k : iCornerU;
+                    iCornerV = ( Canonical[ pTri[k] ] == C.V ) ? k : iCornerV;
+                }
+
+                if ( iCornerV >= 0 )
+                {
+                    uRemoved++;
+
+                    bool bKnown = false;
+                    for ( size_t k = 0; k < Copies.size(); k++ )
+                    {
+                        bKnown |= ( Copies[k].first == pTri[iCornerU] );
+                    }
+                    if ( !bKnown )
+                    {
+                        Copies.push_back( std::make_pair( pTri[iCornerU], pTri[iCornerV] ) );
+                    }
+                    continue;
+                }
+
+                const float* p[3];
+                for ( int k = 0; k < 3; k++ )
+                {
+                    p[k] = GetPosition( pPositions, uPositionStride, pTri[k] );
+                }
+
+                double n0[3], n1[3];
+                TriangleNormal( p[0], p[1], p[2], n0 );
+                p[iCornerU] = pTarget;
+                TriangleNormal( p[0], p[1], p[2], n1 );
+
+                bValid = ( n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] ) > 0.0;
+            }
+
+            // Every copy of U must have a copy of V to move to
+            for ( unsigned int j = 0; j < uAdjacentCount && bValid; j++ )
+            {
+                const unsigned int* pTri = &Indices[ pAdjacent[j] * 3 ];
+                for ( int k = 0; k < 3 && bValid; k++ )
+                {
+                    if ( Canonical[ pTri[k] ] != C.U )
+                    {
+                        continue;
+                    }
+
+                    bool bFound = false;
+                    for ( size_t m = 0; m < Copies.size(); m++ )
+                    {
+                        bFound |= ( Copies[m].first == pTri[k] );
+                    }
+                    bValid = bFound;
+                }
+            }
+
+            if ( !bValid )
+            {
+                continue;
+            }
+
+            for ( size_t k = 0; k < Copies.size(); k++ )
+            {
+                Remap[ Copies[k].first ] = Copies[k].second;
+            }
+
+            QuadricAdd( Quadrics[C.V], Quadrics[C.U] );
+            fResultError = std::max( fResultError, C.fCost );
+
+            // Keep the neighbourhood fixed for the rest of this pass
+            for ( unsigned int j = 0; j < uAdjacentCount; j++ )
+            {
+                const unsigned int* pTri = &Indices[ pAdjacent[j] * 3 ];
+                Touched[ Canonical[ pTri[0] ] ] = true;
+                Touched[ Canonical[ pTri[1] ] ] = true;
+                Touched[ Canonical[ pTri[2] ] ] = true;
+            }
+
+            uRemovedTriangles += uRemoved;
+            uCollapseCount++;
+
+            if ( uTriangleCount - uRemovedTriangles <= uTargetTriangles )
+            {
+                break;
+            }
+        }
+
+        if ( uCollapseCount == 0 )
+        {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t uWrite = 0;
+        for ( size_t t = 0; t < uTriangleCount; t++ )
+        {
+            const unsigned int i0 = Remap[ Indices[ t * 3 + 0 ] ];
+            const unsigned int i1 = Remap[ Indices[ t * 3 + 1 ] ];
+            const unsigned int i2 = Remap[ Indices[ t * 3 + 2 ] ];
+            const unsigned int c0 = Canonical[i0], c1 = Canonical[i1], c2 = Canonical[i2];
+
+            if ( c0 != c1 && c1 != c2 && c0 != c2 )
+            {
+                Indices[ uWrite++ ] = i0;
+                Indices[ uWrite++ ] = i1;
+                Indices[ uWrite++ ] = i2;
+            }
+        }
+        Indices.resize( uWrite );
+    }
+
+    if ( !Indices.empty() )
+    {
+        memcpy( pDstIndices, &Indices[0], Indices.size() * sizeof( unsigned int ) );
+    }
+
+    if ( pResultError )
+    {
+        *pResultError = (float)sqrt( fResultError );
+    }
+
+    return Indices.size();
+}
+
+} // namespace AMD
@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshSimplifier.h
+//
+// Quadric error metric simplification for indexed triangle lists, after Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics" (SIGGRAPH 1997).
+//
+// Edges are only ever collapsed into one of their existing end points, so the simplified
+// index list can be drawn with the original vertex buffer. Vertices that share a position
+// (e.g. along UV or normal seams) are treated as one, and a collapse is only allowed if
+// every copy of the removed vertex has a matching copy of the kept vertex, which keeps
+// seams intact. Open borders are locked.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_MESH_SIMPLIFIER_H
+#define AMD_SDK_MESH_SIMPLIFIER_H
+
+#include <stddef.h>
+
+namespace AMD
+{
+    // Simplifies the mesh until it has no more than uTargetIndexCount indices, or until the next
+    // collapse would move the surface by more than fTargetError (in the units of the positions).
+    // pDstIndices must have room for uIndexCount indices and may alias pIndices. uPositionStride
+    // is in bytes. The error of the result is returned in pResultError.
+    // Returns the number of indices written to pDstIndices.
+    size_t SimplifyMesh( unsigned int* pDstIndices, const unsigned int* pIndices, size_t uIndexCount,
+                         const float* pPositions, size_t uVertexCount, size_t uPositionStride,
+                         size_t uTargetIndexCount, float fTargetError, float* pResultError = nullptr );
+
+} // namespace AMD
+
+#endif // AMD_SDK_MESH_SIMPLIFIER_H
@@ -0,0 +1,643 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: Meshlet.cpp
+//
+// Meshlet building, bounds and SIMD culling.
+//--------------------------------------------------------------------------------------
+#include "Meshlet.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include <xmmintrin.h>
+
+namespace AMD
+{
+
+// Number of meshlets culled per job by MeshletCuller, a multiple of 4
+static const size_t MESHLET_CULL_CHUNK_SIZE = 1024;
+
+// Local index marking a vertex that isn't part of the current meshlet
+static const unsigned char MESHLET_NO_VERTEX = 0xFF;
+
+
+static inline const float* GetPosition( const float* pPositions, size_t uPositionStride, unsigned int uVertex )
+{
+    return (const float*)( (const unsigned char*)pPositions + uVertex * uPositionStride );
+}
+
+static void ComputeTriangleNormal( float* pNormal, const float* p0, const float* p1, const float* p2 )
+{
+    const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    pNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    pNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    pNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+    const float fLength = sqrtf( pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2] );
+    const float fScale = ( fLength > 0.0f ) ? 1.0f / fLength : 0.0f;
+    pNormal[0] *= fScale;
+    pNormal[1] *= fScale;
+    pNormal[2] *= fScale;
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletCullStatistics::Add( const MeshletCullStatistics& Other )
+{
+    uMeshlets += Other.uMeshlets;
+    uFrustumCulled += Other.uFrustumCulled;
+    uConeCulled += Other.uConeCulled;
+    uVisible += Other.uVisible;
+    uTriangles += Other.uTriangles;
+    uTrianglesVisible += Other.uTrianglesVisible;
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletBoundsSoA::Build( const MeshletBounds* pBounds, size_t uMeshletCount )
+{
+    uCount = uMeshletCount;
+
+    const size_t uPadded = ( uMeshletCount + 3 ) & ~(size_t)3;
+    std::vector<float>* Arrays[] = { &CenterX, &CenterY, &CenterZ, &Radius, &AxisX, &AxisY, &AxisZ, &Cutoff };
+    for ( size_t i = 0; i < sizeof( Arrays ) / sizeof( Arrays[0] ); i++ )
+    {
+        Arrays[i]->assign( uPadded, 0.0f );
+    }
+
+    for ( size_t i = 0; i < uMeshletCount; i++ )
+    {
+        CenterX[i] = pBounds[i].fCenter[0];
+        CenterY[i] = pBounds[i].fCenter[1];
+        CenterZ[i] = pBounds[i].fCenter[2];
+        Radius[i] = pBounds[i].fRadius;
+        AxisX[i] = pBounds[i].fConeAxis[0];
+        AxisY[i] = pBounds[i].fConeAxis[1];
+        AxisZ[i] = pBounds[i].fConeAxis[2];
+        Cutoff[i] = pBounds[i].fConeCutoff;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t BuildMeshlets( std::vector<Meshlet>& Meshlets, std::vector<unsigned int>& MeshletVertices,
+                      std::vector<unsigned char>& MeshletTriangles,
+                      const unsigned int* pIndices, size_t uIndexCount,
+                      const float* pPositions, size_t uVertexCount, size_t uPositionStride,
+                      unsigned int uMaxVertices, unsigned int uMaxTriangles )
+{
+    const size_t uTriangleCount = uIndexCount / 3;
+    const size_t uFirstMeshlet = Meshlets.size();
+
+    // Local indices are bytes, and MESHLET_NO_VERTEX is reserved
+    uMaxVertices = std::min( std::max( uMaxVertices, 3u ), 255u );
+    uMaxTriangles = std::max( uMaxTriangles, 1u );
+
+    if ( uTriangleCount == 0 )
+    {
+        return 0;
+    }
+
+    std::vector<float> Normals( uTriangleCount * 3 );
+    for ( size_t t = 0; t < uTriangleCount; t++ )
+    {
+        ComputeTriangleNormal( &Normals[t * 3],
+                               GetPosition( pPositions, uPositionStride, pIndices[t * 3 + 0] ),
+                               GetPosition( pPositions, uPositionStride, pIndices[t * 3 + 1] ),
+                               GetPosition( pPositions, uPositionStride, pIndices[t * 3 + 2] ) );
+    }
+
+    // Vertex to triangle adjacency, and the number of triangles of each vertex not yet in a meshlet
+    std::vector<unsigned int> AdjacencyOffsets( uVertexCount + 1, 0 );
+    std::vector<unsigned int> AdjacencyTriangles( uTriangleCount * 3 );
+    std::vector<unsigned int> LiveCount( uVertexCount, 0 );
+    for ( size_t i = 0; i < uTriangleCount * 3; i++ )
+    {
+        LiveCount[ pIndices[i] ]++;
+    }
+    for ( size_t v = 0; v < uVertexCount; v++ )
+    {
+        AdjacencyOffsets[v + 1] = AdjacencyOffsets[v] + LiveCount[v];
+    }
+    {
+        std::vector<unsigned int> Fill( AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1 );
+        for ( size_t i = 0; i < uTriangleCount * 3; i++ )
+        {
+            AdjacencyTriangles[ Fill[ pIndices[i] ]++ ] = (unsigned int)( i / 3 );
+        }
+    }
+
+    std::vector<unsigned char> Emitted( uTriangleCount, 0 );
+    std::vector<unsigned char> LocalIndex( uVertexCount, MESHLET_NO_VERTEX );
+
+    Meshlet Current;
+    Current.uVertexOffset = (unsigned int)MeshletVertices.size();
+    Current.uTriangleOffset = (unsigned int)MeshletTriangles.size();
+    Current.uVertexCount = 0;
+    Current.uTriangleCount = 0;
+    float fConeSum[3] = { 0.0f, 0.0f, 0.0f };
+    size_t uScan = 0;
+
+    for ( size_t uEmitted = 0; uEmitted < uTriangleCount; uEmitted++ )
+    {
+        // Direction the meshlet faces so far, to keep its normal cone narrow
+        float fAxis[3] = { fConeSum[0], fConeSum[1], fConeSum[2] };
+        const float fAxisLength = sqrtf( fAxis[0] * fAxis[0] + fAxis[1] * fAxis[1] + fAxis[2] * fAxis[2] );
+        const float fAxisScale = ( fAxisLength > 0.0f ) ? 1.0f / fAxisLength : 0.0f;
+
+        // Find the connected triangle that adds the fewest vertices and bends the cone the least
+        unsigned int uBest = ~0u;
+        unsigned int uBestNewVertices = 0;
+        float fBestScore = FLT_MAX;
+        for ( unsigned int i = 0; i < Current.uVertexCount; i++ )
+        {
+            const unsigned int v = MeshletVertices[ Current.uVertexOffset + i ];
+            if ( LiveCount[v] == 0 )
+            {
+                continue;
+            }
+
+            for ( unsigned int a = AdjacencyOffsets[v]; a < AdjacencyOffsets[v + 1]; a++ )
+            {
+                const unsigned int t = AdjacencyTriangles[a];
+                if ( Emitted[t] )
+                {
+                    continue;
+                }
+
+                const unsigned int uNewVertices = ( LocalIndex[ pIndices[t * 3 + 0] ] == MESHLET_NO_VERTEX ) +
+                                                  ( LocalIndex[ pIndices[t * 3 + 1] ] == MESHLET_NO_VERTEX ) +
+                                                  ( LocalIndex[ pIndices[t * 3 + 2] ] == MESHLET_NO_VERTEX );
+                const float* n = &Normals[t * 3];
+                const float fDot = ( n[0] * fAxis[0] + n[1] * fAxis[1] + n[2] * fAxis[2] ) * fAxisScale;
+                const float fScore = (float)uNewVertices + 0.5f * ( 1.0f - fDot );
+
+                if ( fScore < fBestScore )
+                {
+                    fBestScore = fScore;
+                    uBest = t;
+                    uBestNewVertices = uNewVertices;
+                }
+            }
+        }
+
+        // Nothing connected is left, continue with the next triangle in input order
+        if ( uBest == ~0u )
+        {
+            while ( Emitted[uScan] )
+            {
+                uScan++;
+            }
+            uBest = (unsigned int)uScan;
+            uBestNewVertices = 3;
+        }
+
+        // Start a new meshlet if the triangle doesn't fit
+        if ( Current.uVertexCount + uBestNewVertices > uMaxVertices || Current.uTriangleCount >= uMaxTriangles )
+        {
+            for ( unsigned int i = 0; i < Current.uVertexCount; i++ )
+            {
+                LocalIndex[ MeshletVertices[ Current.uVertexOffset + i ] ] = MESHLET_NO_VERTEX;
+            }
+            Meshlets.push_back( Current );
+
+            Current.uVertexOffset = (unsigned int)MeshletVertices.size();
+            Current.uTriangleOffset = (unsigned int)MeshletTriangles.size();
+            Current.uVertexCount = 0;
+            Current.uTriangleCount = 0;
+            fConeSum[0] = fConeSum[1] = fConeSum[2] = 0.0f;
+        }
+
+        for ( unsigned int k = 0; k < 3; k++ )
+        {
+            const unsigned int v = pIndices[ uBest * 3 + k ];
+            if ( LocalIndex[v] == MESHLET_NO_VERTEX )
+            {
+                LocalIndex[v] = (unsigned char)Current.uVertexCount++;
+                MeshletVertices.push_back( v );
+            }
+            MeshletTriangles.push_back( LocalIndex[v] );
+            LiveCount[v]--;
+        }
+
+        Emitted[uBest] = 1;
+        Current.uTriangleCount++;
+        fConeSum[0] += Normals[ uBest * 3 + 0 ];
+        fConeSum[1] += Normals[ uBest * 3 + 1 ];
+        fConeSum[2] += Normals[ uBest * 3 + 2 ];
+    }
+
+    Meshlets.push_back( Current );
+
+    return Meshlets.size() - uFirstMeshlet;
+}
+
+
+//--------------------------------------------------------------------------------------
+MeshletBounds ComputeMeshletBounds( const Meshlet& M, const unsigned int* pMeshletVertices, const unsigned char* pMeshletTriangles,
+                                    const float* pPositions, size_t uPositionStride )
+{
+    MeshletBounds Bounds;
+    memset( &Bounds, 0, sizeof( Bounds ) );
+    Bounds.fConeCutoff = 1.0f;
+
+    if ( M.uVertexCount == 0 )
+    {
+        return Bounds;
+    }
+
+    // Sphere around the centre of the bounding box
+    float fMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( unsigned int i = 0; i < M.uVertexCount; i++ )
+    {
+        const float* p = GetPosition( pPositions, uPositionStride, pMeshletVertices[ M.uVertexOffset + i ] );
+        for ( int k = 0; k < 3; k++ )
+        {
+            fMin[k] = std::min( fMin[k], p[k] );
+            fMax[k] = std::max( fMax[k], p[k] );
+        }
+    }
+
+    float fRadiusSq = 0.0f;
+    for ( int k = 0; k < 3; k++ )
+    {
+        Bounds.fCenter[k] = ( fMin[k] + fMax[k] ) * 0.5f;
+    }
+    for ( unsigned int i = 0; i < M.uVertexCount; i++ )
+    {
+        const float* p = GetPosition( pPositions, uPositionStride, pMeshletVertices[ M.uVertexOffset + i ] );
+        const float d[3] = { p[0] - Bounds.fCenter[0], p[1] - Bounds.fCenter[1], p[2] - Bounds.fCenter[2] };
+        fRadiusSq = std::max( fRadiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+    }
+    Bounds.fRadius = sqrtf( fRadiusSq );
+
+    // Normal cone: the average normal, opened up until it contains every triangle normal
+    std::vector<float> Normals( M.uTriangleCount * 3 );
+    float fAxis[3] = { 0.0f, 0.0f, 0.0f };
+    for ( unsigned int t = 0; t < M.uTriangleCount; t++ )
+    {
+        const unsigned char* pTriangle = &pMeshletTriangles[ M.uTriangleOffset + t * 3 ];
+        float* n = &Normals[t * 3];
+        ComputeTriangleNormal( n,
+                               GetPosition( pPositions, uPositionStride, pMeshletVertices[ M.uVertexOffset + pTriangle[0] ] ),
+                               GetPosition( pPositions, uPositionStride, pMeshletVertices[ M.uVertexOffset + pTriangle[1] ] ),
+                               GetPosition( pPositions, uPositionStride, pMeshletVertices[ M.uVertexOffset + pTriangle[2] ] ) );
+        fAxis[0] += n[0];
+        fAxis[1] += n[1];
+        fAxis[2] += n[2];
+    }
+
+    const float fAxisLength = sqrtf( fAxis[0] * fAxis[0] + fAxis[1] * fAxis[1] + fAxis[2] * fAxis[2] );
+    if ( fAxisLength <= 0.0f )
+    {
+        return Bounds;
+    }
+    for ( int k = 0; k < 3; k++ )
+    {
+        Bounds.fConeAxis[k] = fAxis[k] / fAxisLength;
+    }
+
+    float fMinDot = 1.0f;
+    for ( unsigned int t = 0; t < M.uTriangleCount; t++ )
+    {
+        const float* n = &Normals[t * 3];
+        if ( n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f )
+        {
+            continue;
+        }
+        fMinDot = std::min( fMinDot, n[0] * Bounds.fConeAxis[0] + n[1] * Bounds.fConeAxis[1] + n[2] * Bounds.fConeAxis[2] );
+    }
+
+    // A cone of 90 degrees or more always has a triangle facing the camera
+    Bounds.fConeCutoff = ( fMinDot > 0.0f ) ? sqrtf( 1.0f - fMinDot * fMinDot ) : 1.0f;
+
+    return Bounds;
+}
+
+
+//--------------------------------------------------------------------------------------
+void SetupMeshletCullView( MeshletCullView* pView, const float* pWorldViewProjection, const float* pCameraPosition, bool bConeCulling )
+{
+    // With row vectors, clip space component k is the dot product with column k
+    float fColumns[4][4];
+    for ( int k = 0; k < 4; k++ )
+    {
+        for ( int r = 0; r < 4; r++ )
+        {
+            fColumns[k][r] = pWorldViewProjection[ r * 4 + k ];
+        }
+    }
+
+    for ( int r = 0; r < 4; r++ )
+    {
+        pView->fPlanes[0][r] = fColumns[3][r] + fColumns[0][r];    // Left
+        pView->fPlanes[1][r] = fColumns[3][r] - fColumns[0][r];    // Right
+        pView->fPlanes[2][r] = fColumns[3][r] + fColumns[1][r];    // Bottom
+        pView->fPlanes[3][r] = fColumns[3][r] - fColumns[1][r];    // Top
+        pView->fPlanes[4][r] = fColumns[2][r];                     // Near
+        pView->fPlanes[5][r] = fColumns[3][r] - fColumns[2][r];    // Far
+    }
+
+    for ( int i = 0; i < 6; i++ )
+    {
+        float* pPlane = pView->fPlanes[i];
+        const float fLength = sqrtf( pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2] );
+        const float fScale = ( fLength > 0.0f ) ? 1.0f / fLength : 0.0f;
+        for ( int r = 0; r < 4; r++ )
+        {
+            pPlane[r] *= fScale;
+        }
+    }
+
+    pView->fCameraPosition[0] = pCameraPosition[0];
+    pView->fCameraPosition[1] = pCameraPosition[1];
+    pView->fCameraPosition[2] = pCameraPosition[2];
+    pView->bConeCulling = bConeCulling;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CullMeshlets( const MeshletCullView& View, const MeshletBoundsSoA& Bounds, size_t uFirst, size_t uCount,
+                   unsigned char* pVisible, MeshletCullStatistics* pStats )
+{
+    __m128 vPlanes[6][4];
+    for ( int i = 0; i < 6; i++ )
+    {
+        for ( int r = 0; r < 4; r++ )
+        {
+            vPlanes[i][r] = _mm_set1_ps( View.fPlanes[i][r] );
+        }
+    }
+    const __m128 vCameraX = _mm_set1_ps( View.fCameraPosition[0] );
+    const __m128 vCameraY = _mm_set1_ps( View.fCameraPosition[1] );
+    const __m128 vCameraZ = _mm_set1_ps( View.fCameraPosition[2] );
+    const __m128 vZero = _mm_setzero_ps();
+
+    unsigned int uFrustumCulled = 0, uConeCulled = 0, uVisible = 0;
+
+    for ( size_t i = 0; i < uCount; i += 4 )
+    {
+        const size_t j = uFirst + i;
+        const __m128 vCenterX = _mm_loadu_ps( &Bounds.CenterX[j] );
+        const __m128 vCenterY = _mm_loadu_ps( &Bounds.CenterY[j] );
+        const __m128 vCenterZ = _mm_loadu_ps( &Bounds.CenterZ[j] );
+        const __m128 vRadius = _mm_loadu_ps( &Bounds.Radius[j] );
+        const __m128 vNegRadius = _mm_sub_ps( vZero, vRadius );
+
+        // Inside unless the sphere is entirely behind one of the planes
+        __m128 vInside = _mm_cmpeq_ps( vZero, vZero );
+        for ( int p = 0; p < 6; p++ )
+        {
+            __m128 vDistance = _mm_add_ps( _mm_mul_ps( vPlanes[p][0], vCenterX ), _mm_mul_ps( vPlanes[p][1], vCenterY ) );
+            vDistance = _mm_add_ps( vDistance, _mm_add_ps( _mm_mul_ps( vPlanes[p][2], vCenterZ ), vPlanes[p][3] ) );
+            vInside = _mm_and_ps( vInside, _mm_cmpge_ps( vDistance, vNegRadius ) );
+        }
+
+        // Back-facing if the view direction to every point of the sphere lies within 90 degrees
+        // minus the cone angle of the axis: dot( C - Eye, Axis ) > Cutoff * |C - Eye| + Radius
+        __m128 vBackFacing = vZero;
+        if ( View.bConeCulling )
+        {
+            const __m128 vDX = _mm_sub_ps( vCenterX, vCameraX );
+            const __m128 vDY = _mm_sub_ps( vCenterY, vCameraY );
+            const __m128 vDZ = _mm_sub_ps( vCenterZ, vCameraZ );
+            const __m128 vLength = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( vDX, vDX ), _mm_mul_ps( vDY, vDY ) ), _mm_mul_ps( vDZ, vDZ ) ) );
+            const __m128 vDot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vDX, _mm_loadu_ps( &Bounds.AxisX[j] ) ),
+                                                        _mm_mul_ps( vDY, _mm_loadu_ps( &Bounds.AxisY[j] ) ) ),
+                                                        _mm_mul_ps( vDZ, _mm_loadu_ps( &Bounds.AxisZ[j] ) ) );
+            const __m128 vLimit = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &Bounds.Cutoff[j] ), vLength ), vRadius );
+            vBackFacing = _mm_cmpgt_ps( vDot, vLimit );
+        }
+
+        const size_t uLanes = std::min( (size_t)4, uCount - i );
+        const int iLaneMask = ( 1 << uLanes ) - 1;
+        const int iInside = _mm_movemask_ps( vInside ) & iLaneMask;
+        const int iBackFacing = _mm_movemask_ps( vBackFacing ) & iInside;
+        const int iVisible = iInside & ~iBackFacing;
+
+        for ( size_t k = 0; k < uLanes; k++ )
+        {
+            pVisible[i + k] = (unsigned char)( ( iVisible >> k ) & 1 );
+        }
+
+        static const unsigned char BitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+        uFrustumCulled += (unsigned int)uLanes - BitCount[iInside];
+        uConeCulled += BitCount[iBackFacing];
+        uVisible += BitCount[iVisible];
+    }
+
+    if ( pStats )
+    {
+        pStats->uMeshlets += (unsigned int)uCount;
+        pStats->uFrustumCulled += uFrustumCulled;
+        pStats->uConeCulled += uConeCulled;
+        pStats->uVisible += uVisible;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+MeshletCuller::MeshletCuller( unsigned int uThreadCount ) :
+    m_pJob( nullptr ),
+    m_uJobCount( 0 ),
+    m_uNextJob( 0 ),
+    m_uBusyWorkers( 0 ),
+    m_uGeneration( 0 ),
+    m_bQuit( false )
+{
+    if ( uThreadCount == 0 )
+    {
+        uThreadCount = std::max( std::thread::hardware_concurrency(), 1u );
+    }
+
+    for ( unsigned int i = 1; i < uThreadCount; i++ )
+    {
+        m_Workers.push_back( std::thread( &MeshletCuller::WorkerThreadProc, this ) );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+MeshletCuller::~MeshletCuller()
+{
+    {
+        std::lock_guard<std::mutex> Lock( m_Mutex );
+        m_bQuit = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        m_Workers[i].join();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletCuller::RunJobs()
+{
+    for ( size_t i = m_uNextJob++; i < m_uJobCount; i = m_uNextJob++ )
+    {
+        ( *m_pJob )( i );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletCuller::WorkerThreadProc()
+{
+    unsigned int uGeneration = 0;
+
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> Lock( m_Mutex );
+            m_WakeCondition.wait( Lock, [&]() { return m_bQuit || m_uGeneration != uGeneration; } );
+            if ( m_bQuit )
+            {
+                return;
+            }
+            uGeneration = m_uGeneration;
+        }
+
+        RunJobs();
+
+        {
+            std::lock_guard<std::mutex> Lock( m_Mutex );
+            if ( --m_uBusyWorkers == 0 )
+            {
+                m_DoneCondition.notify_one();
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletCuller::Dispatch( size_t uJobCount, const std::function<void( size_t )>& Job )
+{
+    if ( m_Workers.empty() || uJobCount <= 1 )
+    {
+        for ( size_t i = 0; i < uJobCount; i++ )
+        {
+            Job( i );
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock( m_Mutex );
+        m_pJob = &Job;
+        m_uJobCount = uJobCount;
+        m_uNextJob = 0;
+        m_uBusyWorkers = (unsigned int)m_Workers.size();
+        m_uGeneration++;
+    }
+    m_WakeCondition.notify_all();
+
+    RunJobs();
+
+    std::unique_lock<std::mutex> Lock( m_Mutex );
+    m_DoneCondition.wait( Lock, [&]() { return m_uBusyWorkers == 0; } );
+    m_pJob = nullptr;
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t MeshletCuller::CullAndCompact( const MeshletCullView& View, const MeshletBoundsSoA& Bounds,
+                                      const unsigned int* pMeshletIndexOffsets, const unsigned int* pMeshletIndices,
+                                      unsigned int* pDstIndices, unsigned int* pDstOffsets, MeshletCullStatistics* pStats )
+{
+    const size_t uCount = Bounds.uCount;
+    const size_t uChunkCount = ( uCount + MESHLET_CULL_CHUNK_SIZE - 1 ) / MESHLET_CULL_CHUNK_SIZE;
+
+    m_Visible.resize( uCount );
+    m_ChunkIndexCounts.assign( uChunkCount, 0 );
+    m_ChunkStats.assign( uChunkCount, MeshletCullStatistics() );
+
+    // Cull and count the indices each chunk will write
+    Dispatch( uChunkCount, [&]( size_t uChunk )
+    {
+        const size_t uFirst = uChunk * MESHLET_CULL_CHUNK_SIZE;
+        const size_t uLast = std::min( uFirst + MESHLET_CULL_CHUNK_SIZE, uCount );
+        MeshletCullStatistics& Stats = m_ChunkStats[uChunk];
+
+        CullMeshlets( View, Bounds, uFirst, uLast - uFirst, &m_Visible[uFirst], &Stats );
+
+        size_t uIndices = 0, uTotal = 0;
+        for ( size_t i = uFirst; i < uLast; i++ )
+        {
+            const size_t uMeshletIndices = pMeshletIndexOffsets[i + 1] - pMeshletIndexOffsets[i];
+            uTotal += uMeshletIndices;
+            uIndices += m_Visible[i] ? uMeshletIndices : 0;
+        }
+        Stats.uTriangles = (unsigned int)( uTotal / 3 );
+        Stats.uTrianglesVisible = (unsigned int)( uIndices / 3 );
+        m_ChunkIndexCounts[uChunk] = uIndices;
+    } );
+
+    // Turn the counts into output offsets
+    size_t uTotalIndices = 0;
+    for ( size_t uChunk = 0; uChunk < uChunkCount; uChunk++ )
+    {
+        const size_t uIndices = m_ChunkIndexCounts[uChunk];
+        m_ChunkIndexCounts[uChunk] = uTotalIndices;
+        uTotalIndices += uIndices;
+    }
+
+    // Copy the visible meshlets
+    Dispatch( uChunkCount, [&]( size_t uChunk )
+    {
+        const size_t uFirst = uChunk * MESHLET_CULL_CHUNK_SIZE;
+        const size_t uLast = std::min( uFirst + MESHLET_CULL_CHUNK_SIZE, uCount );
+        size_t uDst = m_ChunkIndexCounts[uChunk];
+
+        for ( size_t i = uFirst; i < uLast; i++ )
+        {
+            pDstOffsets[i] = (unsigned int)uDst;
+            if ( m_Visible[i] )
+            {
+                const size_t uMeshletIndices = pMeshletIndexOffsets[i + 1] - pMeshletIndexOffsets[i];
+                memcpy( pDstIndices + uDst, pMeshletIndices + pMeshletIndexOffsets[i], uMeshletIndices * sizeof( unsigned int ) );
+                uDst += uMeshletIndices;
+            }
+        }
+    } );
+    pDstOffsets[uCount] = (unsigned int)uTotalIndices;
+
+    if ( pStats )
+    {
+        for ( size_t uChunk = 0; uChunk < uChunkCount; uChunk++ )
+        {
+            pStats->Add( m_ChunkStats[uChunk] );
+        }
+    }
+
+    return uTotalIndices;
+}
+
+} // namespace AMD
@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: Meshlet.h
+//
+// Splits indexed triangle lists into meshlets, small clusters of at most 64 vertices and
+// 124 triangles, and culls them on the CPU before they are submitted.
+//
+// Every meshlet gets a bounding sphere and a normal cone. The sphere is tested against
+// the view frustum and the cone tells whether all triangles of the meshlet face away
+// from the camera, so clusters that are off-screen or back-facing never reach the
+// rasterizer. Culling works on 4 meshlets at a time with SSE and can be spread over a
+// pool of worker threads with MeshletCuller.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_MESHLET_H
+#define AMD_SDK_MESHLET_H
+
+#include <stddef.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace AMD
+{
+    static const unsigned int MESHLET_MAX_VERTICES = 64;
+    static const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+    struct Meshlet
+    {
+        unsigned int    uVertexOffset;          // First entry in the meshlet vertex list
+        unsigned int    uTriangleOffset;        // First entry in the meshlet triangle list (3 local indices per triangle)
+        unsigned int    uVertexCount;
+        unsigned int    uTriangleCount;
+    };
+
+    struct MeshletBounds
+    {
+        float           fCenter[3];             // Bounding sphere
+        float           fRadius;
+        float           fConeAxis[3];           // Average facing direction of the triangles
+        float           fConeCutoff;            // Sine of the cone's half angle, 1 if the meshlet can't be cone culled
+    };
+
+    // Bounds of all meshlets in structure-of-arrays layout, padded to a multiple of 4
+    struct MeshletBoundsSoA
+    {
+        std::vector<float>  CenterX, CenterY, CenterZ, Radius;
+        std::vector<float>  AxisX, AxisY, AxisZ, Cutoff;
+        size_t              uCount;
+
+        MeshletBoundsSoA() : uCount( 0 ) {}
+        void Build( const MeshletBounds* pBounds, size_t uMeshletCount );
+    };
+
+    // Frustum and camera position, both in the object space of the meshlets
+    struct MeshletCullView
+    {
+        float           fPlanes[6][4];          // Normalized, pointing inwards
+        float           fCameraPosition[3];
+        bool            bConeCulling;
+    };
+
+    struct MeshletCullStatistics
+    {
+        unsigned int    uMeshlets;
+        unsigned int    uFrustumCulled;
+        unsigned int    uConeCulled;
+        unsigned int    uVisible;
+        unsigned int    uTriangles;             // Of all meshlets
+        unsigned int    uTrianglesVisible;
+
+        MeshletCullStatistics() : uMeshlets( 0 ), uFrustumCulled( 0 ), uConeCulled( 0 ), uVisible( 0 ), uTriangles( 0 ), uTrianglesVisible( 0 ) {}
+        void Add( const MeshletCullStatistics& Other );
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    // Building
+    //--------------------------------------------------------------------------------------
+
+    // Greedily grows meshlets over shared vertices, preferring triangles that add the fewest
+    // new vertices and that face the same way as the meshlet so far. Vertex-cache optimized
+    // input gives the best results. Meshlets are appended to the output arrays, with vertices
+    // referring to the input vertices. uPositionStride is in bytes. Returns the number of
+    // meshlets added.
+    size_t BuildMeshlets( std::vector<Meshlet>& Meshlets, std::vector<unsigned int>& MeshletVertices,
+                          std::vector<unsigned char>& MeshletTriangles,
+                          const unsigned int* pIndices, size_t uIndexCount,
+                          const float* pPositions, size_t uVertexCount, size_t uPositionStride,
+                          unsigned int uMaxVertices = MESHLET_MAX_VERTICES, unsigned int uMaxTriangles = MESHLET_MAX_TRIANGLES );
+
+    // Computes the bounding sphere and normal cone of one meshlet. The cone assumes clockwise
+    // front faces, as in D3D's default rasterizer state.
+    MeshletBounds ComputeMeshletBounds( const Meshlet& M, const unsigned int* pMeshletVertices, const unsigned char* pMeshletTriangles,
+                                        const float* pPositions, size_t uPositionStride );
+
+
+    //--------------------------------------------------------------------------------------
+    // Culling
+    //--------------------------------------------------------------------------------------
+
+    // Sets up a cull view from a row-major world-view-projection matrix (row vectors, as in
+    // DirectXMath) and the camera position in object space. Cone culling is only correct if
+    // the world matrix has a uniform, positive scale and back faces are culled.
+    void SetupMeshletCullView( MeshletCullView* pView, const float* pWorldViewProjection, const float* pCameraPosition, bool bConeCulling = true );
+
+    // Culls meshlets [uFirst, uFirst + uCount) and sets pVisible[i - uFirst] to 1 or 0.
+    // uFirst must be a multiple of 4. Only the meshlet counts of pStats are updated.
+    void CullMeshlets( const MeshletCullView& View, const MeshletBoundsSoA& Bounds, size_t uFirst, size_t uCount,
+                       unsigned char* pVisible, MeshletCullStatistics* pStats );
+
+    //--------------------------------------------------------------------------------------
+    // Culls meshlets on a pool of worker threads and writes the indices of the visible ones
+    // to a compacted index list, ready to be drawn in one call per subset.
+    //--------------------------------------------------------------------------------------
+    class MeshletCuller
+    {
+    public:
+
+        // uThreadCount includes the calling thread; 0 uses all cores
+        explicit MeshletCuller( unsigned int uThreadCount = 0 );
+        ~MeshletCuller();
+
+        unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+        // pMeshletIndexOffsets has one entry per meshlet plus one: the indices of meshlet i are
+        // pMeshletIndices[ pMeshletIndexOffsets[i] ... pMeshletIndexOffsets[i + 1] ). The visible
+        // ones are copied to pDstIndices in meshlet order, and pDstOffsets (one entry per meshlet
+        // plus one) receives where each meshlet starts in the output, so callers can find the
+        // range of a group of consecutive meshlets. Returns the number of indices written.
+        size_t CullAndCompact( const MeshletCullView& View, const MeshletBoundsSoA& Bounds,
+                               const unsigned int* pMeshletIndexOffsets, const unsigned int* pMeshletIndices,
+                               unsigned int* pDstIndices, unsigned int* pDstOffsets, MeshletCullStatistics* pStats );
+
+        // Runs Job( 0 ) ... Job( uJobCount - 1 ) on the pool and the calling thread, and returns
+        // once all of them have finished
+        void Dispatch( size_t uJobCount, const std::function<void( size_t )>& Job );
+
+    private:
+
+        MeshletCuller( const MeshletCuller& );
+        MeshletCuller& operator=( const MeshletCuller& );
+
+        void WorkerThreadProc();
+        void RunJobs();
+
+        std::vector<std::thread>            m_Workers;
+        std::mutex                          m_Mutex;
+        std::condition_variable             m_WakeCondition;
+        std::condition_variable             m_DoneCondition;
+        const std::function<void( size_t )>* m_pJob;
+        size_t                              m_uJobCount;
+        std::atomic<size_t>                 m_uNextJob;
+        unsigned int                        m_uBusyWorkers;
+        unsigned int                        m_uGeneration;
+        bool                                m_bQuit;
+
+        // Per chunk results of CullAndCompact
+        std::vector<unsigned char>          m_Visible;
+        std::vector<size_t>                 m_ChunkIndexCounts;
+        std::vector<MeshletCullStatistics>  m_ChunkStats;
+    };
+
+} // namespace AMD
+
+#endif // AMD_SDK_MESHLET_H
@@ -0,0 +1,366 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshletMesh.cpp
+//
+// CPU culled meshlet rendering for sdkmesh files.
+//--------------------------------------------------------------------------------------
+#include "..\\..\\DXUT\\Core\\DXUT.h"
+#include "..\\..\\DXUT\\Optional\\SDKmesh.h"
+
+#include "MeshletMesh.h"
+#include "FrameCounters.h"
+
+using namespace DirectX;
+
+namespace AMD
+{
+
+// The meshlets of one subset while they are being built
+struct SubsetMeshletBuild
+{
+    UINT                        iMesh;
+    UINT                        iSubset;
+    const float*                pPositions;
+    size_t                      uPositionStride;
+    std::vector<Meshlet>        Meshlets;
+    std::vector<MeshletBounds>  Bounds;
+    std::vector<unsigned int>   Indices;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Finds the float3 or float4 position in the vertex streams of a mesh
+//--------------------------------------------------------------------------------------
+static bool FindPositions( CDXUTSDKMesh* pMesh, UINT iMesh, const SDKMESH_SUBSET* pSubset, const float** ppPositions, size_t* pStride )
+{
+    const SDKMESH_MESH* pSDKMesh = pMesh->GetMesh( iMesh );
+
+    for ( UINT iStream = 0; iStream < pSDKMesh->NumVertexBuffers; iStream++ )
+    {
+        const UINT iVB = pSDKMesh->VertexBuffers[iStream];
+        const D3DVERTEXELEMENT9* pDecl = pMesh->GetVertexDeclAt( iVB );
+
+        for ( UINT i = 0; i < MAX_VERTEX_ELEMENTS && pDecl[i].Stream != 0xFF; i++ )
+        {
+            if ( pDecl[i].Usage == D3DDECLUSAGE_POSITION && pDecl[i].UsageIndex == 0 &&
+                 ( pDecl[i].Type == D3DDECLTYPE_FLOAT3 || pDecl[i].Type == D3DDECLTYPE_FLOAT4 ) )
+            {
+                const size_t uStride = pMesh->GetVertexStride( iMesh, iStream );
+                *ppPositions = (const float*)( pMesh->GetRawVerticesAt( iVB ) + pSubset->VertexStart * uStride + pDecl[i].Offset );
+                *pStride = uStride;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Builds the meshlets of one subset, with indices relative to its VertexStart
+//--------------------------------------------------------------------------------------
+static void BuildSubsetMeshlets( CDXUTSDKMesh* pMesh, SubsetMeshletBuild& Build )
+{
+    const SDKMESH_MESH* pSDKMesh = pMesh->GetMesh( Build.iMesh );
+    const SDKMESH_SUBSET* pSubset = pMesh->GetSubset( Build.iMesh, Build.iSubset );
+    const BYTE* pRawIndices = pMesh->GetRawIndicesAt( pSDKMesh->IndexBuffer );
+    const bool b32Bit = ( pMesh->GetIndexType( Build.iMesh ) == IT_32BIT );
+
+    const size_t uIndexCount = (size_t)( pSubset->IndexCount / 3 * 3 );
+    std::vector<unsigned int> Indices( uIndexCount );
+    unsigned int uMaxIndex = 0;
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const size_t uIndex = (size_t)pSubset->IndexStart + i;
+        Indices[i] = b32Bit ? ( (const UINT*)pRawIndices )[uIndex] : ( (const WORD*)pRawIndices )[uIndex];
+        uMaxIndex = ( Indices[i] > uMaxIndex ) ? Indices[i] : uMaxIndex;
+    }
+
+    std::vector<unsigned int> MeshletVertices;
+    std::vector<unsigned char> MeshletTriangles;
+    BuildMeshlets( Build.Meshlets, MeshletVertices, MeshletTriangles, &Indices[0], uIndexCount,
+                   Build.pPositions, (size_t)uMaxIndex + 1, Build.uPositionStride );
+
+    Build.Indices.reserve( uIndexCount );
+    for ( size_t m = 0; m < Build.Meshlets.size(); m++ )
+    {
+        const Meshlet& M = Build.Meshlets[m];
+        Build.Bounds.push_back( ComputeMeshletBounds( M, &MeshletVertices[0], &MeshletTriangles[0], Build.pPositions, Build.uPositionStride ) );
+
+        for ( unsigned int i = 0; i < M.uTriangleCount * 3; i++ )
+        {
+            Build.Indices.push_back( MeshletVertices[ M.uVertexOffset + MeshletTriangles[ M.uTriangleOffset + i ] ] );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+MeshletMesh::MeshletMesh() :
+    m_pMesh( nullptr ),
+    m_pIndexBuffer( nullptr ),
+    m_pCuller( nullptr )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+MeshletMesh::~MeshletMesh()
+{
+    OnDestroyDevice();
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT MeshletMesh::OnCreateDevice( ID3D11Device* pDevice, CDXUTSDKMesh* pMesh, unsigned int uThreadCount )
+{
+    HRESULT hr;
+
+    OnDestroyDevice();
+
+    m_pMesh = pMesh;
+    m_pCuller = new MeshletCuller( uThreadCount );
+
+    std::vector<SubsetMeshletBuild> Builds;
+    for ( UINT iMesh = 0; iMesh < pMesh->GetNumMeshes(); iMesh++ )
+    {
+        for ( UINT iSubset = 0; iSubset < pMesh->GetNumSubsets( iMesh ); iSubset++ )
+        {
+            SubsetMeshlets Subset = { iMesh, iSubset, 0, 0 };
+            m_Subsets.push_back( Subset );
+
+            const SDKMESH_SUBSET* pSubset = pMesh->GetSubset( iMesh, iSubset );
+            SubsetMeshletBuild Build;
+            Build.iMesh = iMesh;
+            Build.iSubset = iSubset;
+            if ( pSubset->PrimitiveType == PT_TRIANGLE_LIST && pSubset->IndexCount >= 3 &&
+                 FindPositions( pMesh, iMesh, pSubset, &Build.pPositions, &Build.uPositionStride ) )
+            {
+                Builds.push_back( Build );
+            }
+        }
+    }
+
+    m_pCuller->Dispatch( Builds.size(), [&]( size_t i ) { BuildSubsetMeshlets( pMesh, Builds[i] ); } );
+
+    // Concatenate the subsets, whose meshlets end up next to each other
+    std::vector<MeshletBounds> Bounds;
+    m_MeshletIndexOffsets.assign( 1, 0 );
+    size_t uBuild = 0;
+    for ( size_t i = 0; i < m_Subsets.size() && uBuild < Builds.size(); i++ )
+    {
+        const SubsetMeshletBuild& Build = Builds[uBuild];
+        if ( m_Subsets[i].iMesh != Build.iMesh || m_Subsets[i].iSubset != Build.iSubset )
+        {
+            continue;
+        }
+
+        m_Subsets[i].uFirstMeshlet = (UINT)Bounds.size();
+        m_Subsets[i].uMeshletCount = (UINT)Build.Meshlets.size();
+
+        for ( size_t m = 0; m < Build.Meshlets.size(); m++ )
+        {
+            m_MeshletIndexOffsets.push_back( m_MeshletIndexOffsets.back() + Build.Meshlets[m].uTriangleCount * 3 );
+        }
+        Bounds.insert( Bounds.end(), Build.Bounds.begin(), Build.Bounds.end() );
+        m_MeshletIndices.insert( m_MeshletIndices.end(), Build.Indices.begin(), Build.Indices.end() );
+        uBuild++;
+    }
+
+    if ( m_MeshletIndices.empty() )
+    {
+        return E_FAIL;
+    }
+
+    m_Bounds.Build( &Bounds[0], Bounds.size() );
+    m_DrawOffsets.assign( Bounds.size() + 1, 0 );
+
+    D3D11_BUFFER_DESC Desc;
+    ZeroMemory( &Desc, sizeof( Desc ) );
+    Desc.ByteWidth = (UINT)( m_MeshletIndices.size() * sizeof( unsigned int ) );
+    Desc.Usage = D3D11_USAGE_DYNAMIC;
+    Desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    V_RETURN( pDevice->CreateBuffer( &Desc, nullptr, &m_pIndexBuffer ) );
+    DXUT_SetDebugName( m_pIndexBuffer, "MeshletMesh" );
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletMesh::OnDestroyDevice()
+{
+    SAFE_RELEASE( m_pIndexBuffer );
+    SAFE_DELETE( m_pCuller );
+
+    m_pMesh = nullptr;
+    m_Subsets.clear();
+    m_Bounds = MeshletBoundsSoA();
+    m_MeshletIndexOffsets.clear();
+    m_MeshletIndices.clear();
+    m_DrawOffsets.clear();
+    m_Stats = MeshletCullStatistics();
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletMesh::Cull( ID3D11DeviceContext* pContext, const XMMATRIX& mWorld, const XMMATRIX& mViewProjection,
+                        const XMVECTOR& vCameraPosition )
+{
+    if ( !m_pIndexBuffer )
+    {
+        return;
+    }
+
+    // Cull in object space, so the bounds don't have to be transformed
+    XMFLOAT4X4 WorldViewProjection;
+    XMStoreFloat4x4( &WorldViewProjection, mWorld * mViewProjection );
+    XMFLOAT3 CameraPosition;
+    XMStoreFloat3( &CameraPosition, XMVector3TransformCoord( vCameraPosition, XMMatrixInverse( nullptr, mWorld ) ) );
+
+    MeshletCullView View;
+    SetupMeshletCullView( &View, &WorldViewProjection._11, &CameraPosition.x );
+
+    D3D11_MAPPED_SUBRESOURCE MappedResource;
+    if ( FAILED( pContext->Map( m_pIndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource ) ) )
+    {
+        return;
+    }
+
+    m_Stats = MeshletCullStatistics();
+    m_pCuller->CullAndCompact( View, m_Bounds, &m_MeshletIndexOffsets[0], &m_MeshletIndices[0],
+                               (unsigned int*)MappedResource.pData, &m_DrawOffsets[0], &m_Stats );
+
+    pContext->Unmap( m_pIndexBuffer, 0 );
+
+    COUNTER_Add( FRAME_COUNTER_BYTES_MAPPED, m_DrawOffsets.back() * sizeof( unsigned int ) )
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletMesh::Render( ID3D11DeviceContext* pContext, UINT iDiffuseSlot )
+{
+    RenderSubsets( pContext, iDiffuseSlot, false );
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletMesh::RenderPositionOnly( ID3D11DeviceContext* pContext )
+{
+    if ( m_pMesh && m_pMesh->HasPositionStreams() )
+    {
+        RenderSubsets( pContext, INVALID_SAMPLER_SLOT, true );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void MeshletMesh::RenderSubsets( ID3D11DeviceContext* pContext, UINT iDiffuseSlot, bool bPositionOnly )
+{
+    if ( !m_pIndexBuffer || m_pMesh->GetOutstandingBufferResources() > 0 )
+    {
+        return;
+    }
+
+    UINT iCurrentMesh = INVALID_MESH;
+    ID3D11Buffer* pBoundIB = nullptr;
+
+    for ( size_t i = 0; i < m_Subsets.size(); i++ )
+    {
+        const SubsetMeshlets& Subset = m_Subsets[i];
+        const SDKMESH_SUBSET* pSubset = m_pMesh->GetSubset( Subset.iMesh, Subset.iSubset );
+
+        if ( Subset.iMesh != iCurrentMesh )
+        {
+            const SDKMESH_MESH* pSDKMesh = m_pMesh->GetMesh( Subset.iMesh );
+            if ( pSDKMesh->NumVertexBuffers > D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT )
+            {
+                continue;
+            }
+
+            UINT Strides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+            UINT Offsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+            ID3D11Buffer* pVB[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+            UINT NumStreams = pSDKMesh->NumVertexBuffers;
+            if ( bPositionOnly )
+            {
+                NumStreams = 1;
+                pVB[0] = m_pMesh->GetPositionVB11( Subset.iMesh );
+                Strides[0] = sizeof( XMFLOAT3 );
+                Offsets[0] = 0;
+            }
+            else
+            {
+                for ( UINT iStream = 0; iStream < NumStreams; iStream++ )
+                {
+                    pVB[iStream] = m_pMesh->GetVB11( Subset.iMesh, iStream );
+                    Strides[iStream] = m_pMesh->GetVertexStride( Subset.iMesh, iStream );
+                    Offsets[iStream] = 0;
+                }
+            }
+            pContext->IASetVertexBuffers( 0, NumStreams, pVB, Strides, Offsets );
+            iCurrentMesh = Subset.iMesh;
+            pBoundIB = nullptr;
+        }
+
+        // Subsets without meshlets are drawn from the mesh's own index buffer
+        UINT IndexCount = (UINT)pSubset->IndexCount;
+        UINT IndexStart = (UINT)pSubset->IndexStart;
+        ID3D11Buffer* pIB = m_pMesh->GetIB11( Subset.iMesh );
+        DXGI_FORMAT IBFormat = m_pMesh->GetIBFormat11( Subset.iMesh );
+        if ( Subset.uMeshletCount > 0 )
+        {
+            IndexStart = m_DrawOffsets[ Subset.uFirstMeshlet ];
+            IndexCount = m_DrawOffsets[ Subset.uFirstMeshlet + Subset.uMeshletCount ] - IndexStart;
+            pIB = m_pIndexBuffer;
+            IBFormat = DXGI_FORMAT_R32_UINT;
+        }
+
+        if ( IndexCount == 0 )
+        {
+            continue;
+        }
+
+        if ( pIB != pBoundIB )
+        {
+            pContext->IASetIndexBuffer( pIB, IBFormat, 0 );
+            pBoundIB = pIB;
+        }
+
+        pContext->IASetPrimitiveTopology( CDXUTSDKMesh::GetPrimitiveType11( (SDKMESH_PRIMITIVE_TYPE)pSubset->PrimitiveType ) );
+
+        SDKMESH_MATERIAL* pMat = m_pMesh->GetMaterial( pSubset->MaterialID );
+        if ( iDiffuseSlot != INVALID_SAMPLER_SLOT && !IsErrorResource( pMat->pDiffuseRV11 ) )
+        {
+            pContext->PSSetShaderResources( iDiffuseSlot, 1, &pMat->pDiffuseRV11 );
+        }
+
+        pContext->DrawIndexed( IndexCount, IndexStart, (INT)pSubset->VertexStart );
+        COUNTER_Add( FRAME_COUNTER_DRAW_CALLS, 1 )
+    }
+}
+
+} // namespace AMD
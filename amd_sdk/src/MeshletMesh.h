@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MeshletMesh.h
+//
+// Draws a CDXUTSDKMesh as meshlets that are culled on the CPU every frame. The indices of
+// the meshlets that survive the frustum and normal cone tests are compacted into one
+// dynamic index buffer, which is then drawn with a single call per subset.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_MESHLET_MESH_H
+#define AMD_SDK_MESHLET_MESH_H
+
+#include "Meshlet.h"
+
+class CDXUTSDKMesh;
+
+namespace AMD
+{
+
+    class MeshletMesh
+    {
+    public:
+
+        MeshletMesh();
+        ~MeshletMesh();
+
+        // Splits every triangle list subset of the mesh into meshlets. The mesh has to stay
+        // loaded for as long as this object is used. uThreadCount is used for building and
+        // culling, 0 uses all cores.
+        HRESULT OnCreateDevice( ID3D11Device* pDevice, CDXUTSDKMesh* pMesh, unsigned int uThreadCount = 0 );
+        void OnDestroyDevice();
+
+        // Culls the meshlets and uploads the indices of the visible ones. mWorld must have
+        // a uniform, positive scale for the cone test, vCameraPosition is in world space,
+        // and back faces must be culled when drawing.
+        void Cull( ID3D11DeviceContext* pContext, const DirectX::XMMATRIX& mWorld, const DirectX::XMMATRIX& mViewProjection,
+                   const DirectX::XMVECTOR& vCameraPosition );
+
+        // Draws what survived the last Cull, binding each subset's diffuse texture to iDiffuseSlot
+        void Render( ID3D11DeviceContext* pContext, UINT iDiffuseSlot = 0 );
+
+        // Draws the same triangles as Render from the mesh's position streams, for a depth
+        // prepass. CDXUTSDKMesh::CreatePositionStreams must have been called.
+        void RenderPositionOnly( ID3D11DeviceContext* pContext );
+
+        bool IsCreated() const { return m_pIndexBuffer != nullptr; }
+        UINT GetNumMeshlets() const { return (UINT)m_Bounds.uCount; }
+        const MeshletCullStatistics& GetStatistics() const { return m_Stats; }
+
+    private:
+
+        MeshletMesh( const MeshletMesh& );
+        MeshletMesh& operator=( const MeshletMesh& );
+
+        void RenderSubsets( ID3D11DeviceContext* pContext, UINT iDiffuseSlot, bool bPositionOnly );
+
+        // The meshlets of one subset, or a subset drawn as it is if uMeshletCount is 0
+        struct SubsetMeshlets
+        {
+            UINT                        iMesh;
+            UINT                        iSubset;
+            UINT                        uFirstMeshlet;
+            UINT                        uMeshletCount;
+        };
+
+        CDXUTSDKMesh*                   m_pMesh;
+        ID3D11Buffer*                   m_pIndexBuffer;
+        MeshletCuller*                  m_pCuller;
+
+        std::vector<SubsetMeshlets>     m_Subsets;
+        MeshletBoundsSoA                m_Bounds;
+        std::vector<unsigned int>       m_MeshletIndexOffsets;      // One per meshlet plus one
+        std::vector<unsigned int>       m_MeshletIndices;           // Relative to the subset's VertexStart
+        std::vector<unsigned int>       m_DrawOffsets;              // Output of the last cull, one per meshlet plus one
+        MeshletCullStatistics           m_Stats;
+    };
+
+} // namespace AMD
+
+#endif // AMD_SDK_MESHLET_MESH_H
@@ -0,0 +1,321 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: PointLights.cpp
+//
+// Point light generation, projection, frustum culling and tile binning
+//--------------------------------------------------------------------------------------
+#include "PointLights.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    // Row vector (x, y, z, 1) times a row-major 4x4 matrix
+    //--------------------------------------------------------------------------------------
+    static void TransformPoint( float* pOut, const float* p, const float* pMatrix )
+    {
+        for ( int c = 0; c < 4; c++ )
+        {
+            pOut[c] = p[0] * pMatrix[0 * 4 + c] + p[1] * pMatrix[1 * 4 + c] + p[2] * pMatrix[2 * 4 + c] + pMatrix[3 * 4 + c];
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Calculates the bounding rectangle in normalized device coordinates of the view space
+    // sphere with center pCenter and radius r. fZoom holds the first two diagonal entries
+    // of the (perspective) projection matrix. The result is only tight for spheres that
+    // are at least partly inside the frustum.
+    // Taken from: http://blog.gmane.org/gmane.games.devel.algorithms/month=20100101
+    //--------------------------------------------------------------------------------------
+    static void CalcSphereBounds( const float* pCenter, float r, const float fZoom[2], float fMin[2], float fMax[2] )
+    {
+        // By default, assume that the full screen is covered
+        fMin[0] = fMin[1] = -1.0f;
+        fMax[0] = fMax[1] =  1.0f;
+
+        // Once for x, once for y
+        for ( int i = 0; i < 2; i++ )
+        {
+            const float x = pCenter[i];
+            const float z = pCenter[2];
+            const float ds = x * x + z * z;
+            float l = ds - r * r;
+
+            if ( l > 0.0f )
+            {
+                l = sqrtf( l );
+
+                float s = x * l - z * r;    // ds*sin(alpha)
+                float c = x * r + z * l;    // ds*cos(alpha)
+                if ( z * ds > -r * s )      // left/top intersection has positive z
+                {
+                    const float fBound = s * fZoom[i] / c;
+                    fMin[i] = ( fBound > -1.0f ) ? fBound : -1.0f;
+                }
+
+                s = z * r + x * l;          // ds*sin(beta)
+                c = z * l - x * r;          // ds*cos(beta)
+                if ( z * ds > r * s )       // right/bottom intersection has positive z
+                {
+                    const float fBound = s * fZoom[i] / c;
+                    fMax[i] = ( fBound < 1.0f ) ? fBound : 1.0f;
+                }
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GeneratePointLights( PointLight* pLights, unsigned int uCount, unsigned int uSeed,
+                              const float* pCenter, const float* pExtents, float fMaxRange, float fMaxIntensity )
+    {
+        LightRandom Random( uSeed );
+
+        // Same expressions and order of draws as the sample's original rand() based macros
+        const float fRandomMax = (float)LightRandom::MAX;
+        for ( unsigned int i = 0; i < uCount; i++ )
+        {
+            PointLight& Light = pLights[i];
+            memset( &Light, 0, sizeof( Light ) );
+
+            for ( int k = 0; k < 3; k++ )
+            {
+                Light.fPosition[k] = ( ( ( 2.0f * (float)Random.Next() ) / fRandomMax ) - 1.0f ) * pExtents[k] + pCenter[k];
+            }
+            Light.fRange = ( fMaxRange * (float)Random.Next() ) / fRandomMax;
+
+            for ( int k = 0; k < 3; k++ )
+            {
+                Light.fColor[k] = ( fMaxIntensity * (float)Random.Next() ) / fRandomMax;
+            }
+            Light.fColor[3] = 1.0f;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GetPointLightVolume( const float* pMeshCenters, const float* pMeshExtents, unsigned int uMeshes,
+                              float* pCenter, float* pExtents )
+    {
+        for ( int k = 0; k < 3; k++ )
+        {
+            pCenter[k] = 0.0f;
+            pExtents[k] = ( uMeshes > 0 ) ? -FLT_MAX : 0.0f;
+        }
+
+        for ( unsigned int i = 0; i < uMeshes; i++ )
+        {
+            for ( int k = 0; k < 3; k++ )
+            {
+                pCenter[k] += pMeshCenters[i * 3 + k];
+                pExtents[k] = ( pMeshExtents[i * 3 + k] > pExtents[k] ) ? pMeshExtents[i * 3 + k] : pExtents[k];
+            }
+        }
+
+        for ( int k = 0; k < 3 && uMeshes > 0; k++ )
+        {
+            pCenter[k] /= (float)uMeshes;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ProcessPointLights( PointLight* pLights, unsigned int uCount, const float* pView, const float* pProjection, float fNearClip )
+    {
+        const float fZoom[2] = { pProjection[0], pProjection[5] };
+
+        for ( unsigned int i = 0; i < uCount; i++ )
+        {
+            PointLight& Light = pLights[i];
+
+            float fView[4];
+            TransformPoint( fView, Light.fPosition, pView );
+            Light.fViewPosition[0] = fView[0];
+            Light.fViewPosition[1] = fView[1];
+            Light.fViewPosition[2] = fView[2];
+
+            // 2D screen extents of the sphere, correct even if the camera is close to it
+            CalcSphereBounds( Light.fViewPosition, Light.fRange, fZoom, Light.fTileMin, Light.fTileMax );
+
+            // Project the points of the sphere closest to and furthest from the camera for the depth range
+            const float fClosest[3] = { fView[0], fView[1], fView[2] - Light.fRange };
+            const float fFurthest[3] = { fView[0], fView[1], fView[2] + Light.fRange };
+            float fClip[4];
+            TransformPoint( fClip, fClosest, pProjection );
+            Light.fTileMin[2] = fClip[2] / fClip[3];
+            TransformPoint( fClip, fFurthest, pProjection );
+            Light.fTileMax[2] = fClip[2] / fClip[3];
+        }
+
+        (void)fNearClip;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ExtractFrustumPlanes( float fPlanes[6][4], const float* pViewProjection, bool bNormalize )
+    {
+        // With row vectors, clip space component k is the dot product with column k
+        for ( int r = 0; r < 4; r++ )
+        {
+            const float* pRow = pViewProjection + r * 4;
+            fPlanes[0][r] = pRow[3] + pRow[0];     // Left
+            fPlanes[1][r] = pRow[3] - pRow[0];     // Right
+            fPlanes[2][r] = pRow[3] - pRow[1];     // Top
+            fPlanes[3][r] = pRow[3] + pRow[1];     // Bottom
+            fPlanes[4][r] = pRow[2];               // Near
+            fPlanes[5][r] = pRow[3] - pRow[2];     // Far
+        }
+
+        for ( int i = 0; i < 6 && bNormalize; i++ )
+        {
+            float* pPlane = fPlanes[i];
+            const float fLength = sqrtf( pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2] );
+            const float fScale = ( fLength > 0.0f ) ? 1.0f / fLength : 0.0f;
+            for ( int k = 0; k < 4; k++ )
+            {
+                pPlane[k] *= fScale;
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool PointLightInFrustum( const PointLight& Light, const float fPlanes[6][4] )
+    {
+        for ( int i = 0; i < 6; i++ )
+        {
+            const float* pPlane = fPlanes[i];
+            const float fDistance = pPlane[0] * Light.fPosition[0] + pPlane[1] * Light.fPosition[1] + pPlane[2] * Light.fPosition[2] + pPlane[3];
+            if ( fDistance < -Light.fRange )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void GetPointLightDepthBounds( const PointLight& Light, const float* pViewDirection, const float* pViewProjection,
+                                   float* pNear, float* pFar )
+    {
+        float fNear[3], fFar[3];
+        for ( int k = 0; k < 3; k++ )
+        {
+            fNear[k] = Light.fPosition[k] + pViewDirection[k] * Light.fRange;
+            fFar[k] = Light.fPosition[k] - pViewDirection[k] * Light.fRange;
+        }
+
+        float fClip[4];
+        TransformPoint( fClip, fNear, pViewProjection );
+        const float fNearBound = fClip[2] / fClip[3];
+        TransformPoint( fClip, fFar, pViewProjection );
+        const float fFarBound = fClip[2] / fClip[3];
+
+        // A point behind the camera projects beyond 1, so it must not be clamped to 1
+        *pNear = ( fNearBound > 1.0f || fNearBound < 0.0f ) ? 0.0f : fNearBound;
+        *pFar = ( fFarBound > 1.0f || fFarBound < 0.0f ) ? 0.0f : fFarBound;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Tile coordinate clamped to [0, uTiles]
+    //--------------------------------------------------------------------------------------
+    static unsigned int ClampTile( float fTile, unsigned int uTiles )
+    {
+        if ( fTile <= 0.0f )
+        {
+            return 0;
+        }
+        return ( fTile < (float)uTiles ) ? (unsigned int)fTile : uTiles;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void BinPointLights( const PointLight* pLights, const unsigned char* pVisible, unsigned int uCount,
+                         unsigned int uTilesX, unsigned int uTilesY, unsigned int* pTileCounts, PointLightTileStatistics* pStats )
+    {
+        const unsigned int uTiles = uTilesX * uTilesY;
+        memset( pTileCounts, 0, uTiles * sizeof( unsigned int ) );
+
+        PointLightTileStatistics Stats;
+        Stats.uTiles = uTiles;
+
+        for ( unsigned int i = 0; i < uCount; i++ )
+        {
+            if ( pVisible && !pVisible[i] )
+            {
+                continue;
+            }
+
+            const PointLight& Light = pLights[i];
+            if ( Light.fTileMax[0] <= Light.fTileMin[0] || Light.fTileMax[1] <= Light.fTileMin[1] )
+            {
+                continue;
+            }
+
+            // NDC y points up, tile rows go down
+            const float fX0 = ( Light.fTileMin[0] * 0.5f + 0.5f ) * (float)uTilesX;
+            const float fX1 = ( Light.fTileMax[0] * 0.5f + 0.5f ) * (float)uTilesX;
+            const float fY0 = ( 0.5f - Light.fTileMax[1] * 0.5f ) * (float)uTilesY;
+            const float fY1 = ( 0.5f - Light.fTileMin[1] * 0.5f ) * (float)uTilesY;
+
+            const unsigned int uX0 = ClampTile( fX0, uTilesX );
+            const unsigned int uY0 = ClampTile( fY0, uTilesY );
+            const unsigned int uX1 = ClampTile( ceilf( fX1 ), uTilesX );
+            const unsigned int uY1 = ClampTile( ceilf( fY1 ), uTilesY );
+            if ( uX1 <= uX0 || uY1 <= uY0 )
+            {
+                continue;
+            }
+
+            for ( unsigned int y = uY0; y < uY1; y++ )
+            {
+                for ( unsigned int x = uX0; x < uX1; x++ )
+                {
+                    pTileCounts[y * uTilesX + x]++;
+                }
+            }
+
+            Stats.uLights++;
+            Stats.uTileLights += ( uX1 - uX0 ) * ( uY1 - uY0 );
+        }
+
+        for ( unsigned int i = 0; i < uTiles; i++ )
+        {
+            Stats.uOccupiedTiles += ( pTileCounts[i] > 0 ) ? 1 : 0;
+            Stats.uMaxTileLights = ( pTileCounts[i] > Stats.uMaxTileLights ) ? pTileCounts[i] : Stats.uMaxTileLights;
+        }
+
+        if ( pStats )
+        {
+            *pStats = Stats;
+        }
+    }
+}
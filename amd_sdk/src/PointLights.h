@@ -0,0 +1,116 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: PointLights.h
+//
+// The CPU side of the DepthBoundsTest11 point lights: generating them from a seed,
+// projecting each light's sphere to a screen-space rectangle and depth range, culling
+// the spheres against the view frustum and binning the rectangles into screen tiles.
+//
+// Matrices are 16 floats, row-major for row vectors, as stored by DirectXMath's
+// XMFLOAT4X4.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_POINT_LIGHTS_H
+#define AMD_SDK_POINT_LIGHTS_H
+
+namespace AMD
+{
+    struct PointLight
+    {
+        float           fColor[4];
+        float           fPosition[3];           // World space
+        float           fRange;
+
+        // Written by ProcessPointLights
+        float           fViewPosition[3];
+        float           fTileMin[3];            // Screen rectangle in NDC, projected depth of the nearest point, unused by the sample
+        float           fTileMax[3];            // Screen rectangle in NDC, projected depth of the furthest point
+    };
+
+    struct PointLightTileStatistics
+    {
+        unsigned int    uLights;                // Lights binned
+        unsigned int    uTiles;
+        unsigned int    uOccupiedTiles;         // Tiles touched by at least one light
+        unsigned int    uTileLights;            // Light/tile pairs
+        unsigned int    uMaxTileLights;         // Most lights in a single tile
+
+        PointLightTileStatistics() : uLights( 0 ), uTiles( 0 ), uOccupiedTiles( 0 ), uTileLights( 0 ), uMaxTileLights( 0 ) {}
+    };
+
+    // The random sequence of the Visual C++ runtime's rand(), so a seed gives the same
+    // lights on every platform and the same ones the sample always had on Windows
+    class LightRandom
+    {
+    public:
+
+        static const unsigned int MAX = 0x7FFF;
+
+        explicit LightRandom( unsigned int uSeed ) : m_uState( uSeed ) {}
+
+        unsigned int Next()
+        {
+            m_uState = m_uState * 214013u + 2531011u;
+            return ( m_uState >> 16 ) & MAX;
+        }
+
+    private:
+
+        unsigned int    m_uState;
+    };
+
+    // Places uCount lights uniformly in the box pCenter +/- pExtents, with ranges up to
+    // fMaxRange and colors up to fMaxIntensity per channel
+    void GeneratePointLights( PointLight* pLights, unsigned int uCount, unsigned int uSeed,
+                              const float* pCenter, const float* pExtents, float fMaxRange, float fMaxIntensity );
+
+    // The box lights are placed in for a scene: the average of the meshes' bounding box
+    // centers and the largest of their extents. pMeshCenters and pMeshExtents hold 3 floats
+    // per mesh.
+    void GetPointLightVolume( const float* pMeshCenters, const float* pMeshExtents, unsigned int uMeshes,
+                              float* pCenter, float* pExtents );
+
+    // Transforms the lights to view space and computes their screen rectangles and depth
+    // ranges. pProjection must be a perspective projection with near plane fNearClip.
+    void ProcessPointLights( PointLight* pLights, unsigned int uCount, const float* pView, const float* pProjection, float fNearClip );
+
+    // Left, right, top, bottom, near and far planes of a view-projection matrix, pointing inwards
+    void ExtractFrustumPlanes( float fPlanes[6][4], const float* pViewProjection, bool bNormalize = true );
+
+    // True unless the light's sphere is entirely behind one of the (normalized) planes
+    bool PointLightInFrustum( const PointLight& Light, const float fPlanes[6][4] );
+
+    // Depth range of the light's sphere along the view direction, for the depth bounds
+    // test. pViewDirection points from the camera's look-at point to its eye and is
+    // normalized. Depths outside [0, 1] are set to 0.
+    void GetPointLightDepthBounds( const PointLight& Light, const float* pViewDirection, const float* pViewProjection,
+                                   float* pNear, float* pFar );
+
+    // Counts the lights overlapping each of uTilesX * uTilesY screen tiles, using the
+    // rectangles from ProcessPointLights. pVisible (optional) skips lights set to 0.
+    // pTileCounts receives uTilesX * uTilesY counts, top row first.
+    void BinPointLights( const PointLight* pLights, const unsigned char* pVisible, unsigned int uCount,
+                         unsigned int uTilesX, unsigned int uTilesY, unsigned int* pTileCounts, PointLightTileStatistics* pStats );
+}
+
+#endif // AMD_SDK_POINT_LIGHTS_H
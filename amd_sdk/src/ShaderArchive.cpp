@@ -0,0 +1,433 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderArchive.cpp
+//
+// Single file archive of compiled shaders
+//--------------------------------------------------------------------------------------
+#include "ShaderArchive.h"
+#include "ShaderHash.h"
+#include "ShaderCompression.h"
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <list>
+#include <thread>
+
+namespace AMD
+{
+    static const unsigned int ARCHIVE_MAGIC = 0x52414353;     // "SCAR"
+    static const unsigned int ARCHIVE_VERSION = 2;       // 2 added compressed blobs
+    static const unsigned int BLOB_ALIGNMENT = 16;
+
+    struct ArchiveHeader
+    {
+        unsigned int            uMagic;
+        unsigned int            uVersion;
+        unsigned long long      uIndexOffset;
+        unsigned long long      uEntryCount;
+        unsigned long long      uIndexHash;     // Detects an index that wasn't fully written
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    static unsigned long long AlignUp( unsigned long long uOffset )
+    {
+        return ( uOffset + BLOB_ALIGNMENT - 1 ) & ~(unsigned long long)( BLOB_ALIGNMENT - 1 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool CompareKeys( const ShaderArchiveEntry& A, const ShaderArchiveEntry& B )
+    {
+        return A.uKey < B.uKey;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool Write( FILE* pFile, const void* pData, size_t uSize, unsigned long long& uOffset )
+    {
+        uOffset += uSize;
+        return uSize == 0 || fwrite( pData, 1, uSize, pFile ) == uSize;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool WritePadding( FILE* pFile, unsigned long long& uOffset )
+    {
+        static const char Zeros[BLOB_ALIGNMENT] = { 0 };
+        return Write( pFile, Zeros, (size_t)( AlignUp( uOffset ) - uOffset ), uOffset );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // A new blob to compress, and what it compressed to
+    //--------------------------------------------------------------------------------------
+    struct CompressJob
+    {
+        const ShaderArchiveBlob*    pBlob;
+        std::vector<char>           Compressed;     // Empty if it didn't get smaller
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    static void CompressBlob( void* pContext, size_t uIndex )
+    {
+        CompressJob& Job = ( *(std::vector<CompressJob>*)pContext )[uIndex];
+        const size_t uSize = Job.pBlob->uSize;
+
+        // Kept only if at least a byte smaller
+        Job.Compressed.resize( uSize );
+        const size_t uCompressed = ( uSize > 1 ) ? ShaderCompress( Job.pBlob->pData, uSize, &Job.Compressed[0], uSize - 1 ) : 0;
+        Job.Compressed.resize( uCompressed );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Writes the blobs, as stored, from uOffset on, adds their entries to the ones given,
+    // and writes the index of all of them after the blobs. Fills in the header that points
+    // to it.
+    //--------------------------------------------------------------------------------------
+    static bool WriteBlobsAndIndex( FILE* pFile, unsigned long long uOffset, const std::vector<ShaderArchiveEntry>& Blobs,
+        const std::vector<const void*>& Data, std::vector<ShaderArchiveEntry>& Entries, ArchiveHeader& Header )
+    {
+        bool bSuccess = true;
+
+        for ( size_t i = 0; i < Blobs.size(); i++ )
+        {
+            bSuccess = bSuccess && WritePadding( pFile, uOffset );
+
+            ShaderArchiveEntry Entry = Blobs[i];
+            Entry.uOffset = uOffset;
+            Entries.push_back( Entry );
+
+            bSuccess = bSuccess && Write( pFile, Data[i], (size_t)Blobs[i].uStoredSize, uOffset );
+        }
+
+        std::sort( Entries.begin(), Entries.end(), CompareKeys );
+
+        bSuccess = bSuccess && WritePadding( pFile, uOffset );
+
+        const size_t uIndexSize = Entries.size() * sizeof( ShaderArchiveEntry );
+        const void* pIndex = Entries.empty() ? NULL : &Entries[0];
+
+        Header.uMagic = ARCHIVE_MAGIC;
+        Header.uVersion = ARCHIVE_VERSION;
+        Header.uIndexOffset = uOffset;
+        Header.uEntryCount = Entries.size();
+        Header.uIndexHash = ShaderHasher::Hash( pIndex, uIndexSize );
+
+        return bSuccess && Write( pFile, pIndex, uIndexSize, uOffset );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderArchive::ShaderArchive()
+        : m_pEntries( NULL )
+        , m_uEntryCount( 0 )
+        , m_bCompress( false )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderArchive::Open( const wchar_t* szFileName )
+    {
+        Close();
+
+        m_FileName = szFileName;
+
+        if ( !m_File.Open( szFileName ) )
+        {
+            return false;
+        }
+
+        const char* pData = m_File.GetData();
+        const size_t uSize = m_File.GetSize();
+
+        ArchiveHeader Header;
+        if ( uSize < sizeof( Header ) )
+        {
+            Close();
+            return false;
+        }
+        memcpy( &Header, pData, sizeof( Header ) );
+
+        if ( Header.uMagic != ARCHIVE_MAGIC || Header.uVersion != ARCHIVE_VERSION ||
+             Header.uIndexOffset < sizeof( Header ) || ( Header.uIndexOffset % BLOB_ALIGNMENT ) != 0 || Header.uIndexOffset > uSize ||
+             Header.uEntryCount > ( uSize - Header.uIndexOffset ) / sizeof( ShaderArchiveEntry ) )
+        {
+            Close();
+            return false;
+        }
+
+        const ShaderArchiveEntry* pEntries = (const ShaderArchiveEntry*)( pData + Header.uIndexOffset );
+        const size_t uEntryCount = (size_t)Header.uEntryCount;
+
+        if ( ShaderHasher::Hash( pEntries, uEntryCount * sizeof( ShaderArchiveEntry ) ) != Header.uIndexHash )
+        {
+            Close();
+            return false;
+        }
+
+        // Blobs lie between the header and the index, and keys are sorted
+        for ( size_t i = 0; i < uEntryCount; i++ )
+        {
+            const ShaderArchiveEntry& Entry = pEntries[i];
+            if ( Entry.uOffset < sizeof( Header ) || Entry.uStoredSize > Header.uIndexOffset || Entry.uOffset > Header.uIndexOffset - Entry.uStoredSize ||
+                 Entry.uStoredSize > Entry.uSize || ( i > 0 && Entry.uKey <= pEntries[ i - 1 ].uKey ) )
+            {
+                Close();
+                return false;
+            }
+        }
+
+        m_pEntries = pEntries;
+        m_uEntryCount = uEntryCount;
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderArchive::Close()
+    {
+        m_File.Close();
+        m_pEntries = NULL;
+        m_uEntryCount = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const ShaderArchiveEntry* ShaderArchive::Find( unsigned long long uKey ) const
+    {
+        ShaderArchiveEntry Key = { uKey, 0, 0, 0, 0 };
+        const ShaderArchiveEntry* pEnd = m_pEntries + m_uEntryCount;
+        const ShaderArchiveEntry* pEntry = std::lower_bound( m_pEntries, pEnd, Key, CompareKeys );
+
+        return ( pEntry != pEnd && pEntry->uKey == uKey ) ? pEntry : NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const void* ShaderArchive::GetBlob( const ShaderArchiveEntry& Entry, std::vector<char>& Buffer ) const
+    {
+        if ( !IsCompressed( Entry ) )
+        {
+            return GetData( Entry );
+        }
+
+        Buffer.resize( (size_t)Entry.uSize );
+        return ShaderDecompress( GetData( Entry ), (size_t)Entry.uStoredSize, &Buffer[0], Buffer.size() ) ? &Buffer[0] : NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderArchive::GetBlobBytes() const
+    {
+        unsigned long long uBytes = 0;
+        for ( size_t i = 0; i < m_uEntryCount; i++ )
+        {
+            uBytes += m_pEntries[i].uSize;
+        }
+        return uBytes;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderArchive::Update( const ShaderArchiveBlob* pBlobs, size_t uCount )
+    {
+        return Update( pBlobs, uCount, false );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderArchive::Update( const ShaderArchiveBlob* pBlobs, size_t uCount, bool bCompact )
+    {
+        if ( m_FileName.empty() )
+        {
+            return false;
+        }
+
+        if ( uCount == 0 && !bCompact )
+        {
+            return true;
+        }
+
+        // Later blobs replace earlier ones of the same key
+        std::map<unsigned long long, const ShaderArchiveBlob*> NewBlobs;
+        for ( size_t i = 0; i < uCount; i++ )
+        {
+            NewBlobs[ pBlobs[i].uKey ] = &pBlobs[i];
+        }
+
+        std::vector<ShaderArchiveEntry> KeptEntries;
+        unsigned long long uLiveBytes = 0;
+        unsigned long long uNewBytes = 0;
+
+        for ( size_t i = 0; i < m_uEntryCount; i++ )
+        {
+            if ( NewBlobs.find( m_pEntries[i].uKey ) == NewBlobs.end() )
+            {
+                KeptEntries.push_back( m_pEntries[i] );
+                uLiveBytes += AlignUp( m_pEntries[i].uStoredSize );
+            }
+        }
+
+        std::vector<CompressJob> Jobs( NewBlobs.size() );
+        size_t uJob = 0;
+        for ( std::map<unsigned long long, const ShaderArchiveBlob*>::const_iterator it = NewBlobs.begin(); it != NewBlobs.end(); it++ )
+        {
+            Jobs[ uJob++ ].pBlob = it->second;
+        }
+
+        if ( m_bCompress )
+        {
+            ShaderParallelFor( Jobs.size(), std::thread::hardware_concurrency(), CompressBlob, &Jobs );
+        }
+
+        std::vector<ShaderArchiveEntry> Blobs;
+        std::vector<const void*> Data;
+        for ( size_t i = 0; i < Jobs.size(); i++ )
+        {
+            const ShaderArchiveBlob& Blob = *Jobs[i].pBlob;
+            const bool bCompressed = !Jobs[i].Compressed.empty();
+
+            ShaderArchiveEntry Entry = { Blob.uKey, Blob.uContentHash, 0, Blob.uSize, bCompressed ? Jobs[i].Compressed.size() : Blob.uSize };
+            Blobs.push_back( Entry );
+            Data.push_back( bCompressed ? (const void*)&Jobs[i].Compressed[0] : Blob.pData );
+            uNewBytes += AlignUp( Entry.uStoredSize );
+        }
+        uLiveBytes += uNewBytes;
+
+        // Appending leaves the replaced blobs and the old index behind
+        const unsigned long long uIndexBytes = ( KeptEntries.size() + Blobs.size() ) * sizeof( ShaderArchiveEntry );
+        const unsigned long long uAppendedSize = AlignUp( m_File.GetSize() ) + uNewBytes + uIndexBytes;
+        const unsigned long long uDeadBytes = uAppendedSize - sizeof( ArchiveHeader ) - uIndexBytes - uLiveBytes;
+
+        if ( !bCompact && IsOpen() && uDeadBytes <= uLiveBytes )
+        {
+            return Append( Blobs, Data, KeptEntries );
+        }
+
+        // The kept blobs are copied from the mapping into the new file, as they are stored
+        std::vector<const void*> AllData;
+        for ( size_t i = 0; i < KeptEntries.size(); i++ )
+        {
+            AllData.push_back( GetData( KeptEntries[i] ) );
+        }
+        KeptEntries.insert( KeptEntries.end(), Blobs.begin(), Blobs.end() );
+        AllData.insert( AllData.end(), Data.begin(), Data.end() );
+
+        return Rewrite( KeptEntries, AllData );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Adds blobs and a new index at the end of the file, and switches the header to the new
+    // index once they are on disk
+    //--------------------------------------------------------------------------------------
+    bool ShaderArchive::Append( const std::vector<ShaderArchiveEntry>& Blobs, const std::vector<const void*>& Data, std::vector<ShaderArchiveEntry>& Entries )
+    {
+        const std::wstring FileName = m_FileName;
+        const unsigned long long uFileSize = m_File.GetSize();
+
+        // Windows doesn't allow writing to a file while it is mapped
+        Close();
+
+        FILE* pFile = OpenFileStream( FileName.c_str(), "r+b" );
+        if ( !pFile )
+        {
+            Open( FileName.c_str() );
+            return false;
+        }
+
+        ArchiveHeader Header;
+        bool bSuccess = fseek( pFile, 0, SEEK_END ) == 0 &&
+            WriteBlobsAndIndex( pFile, uFileSize, Blobs, Data, Entries, Header ) &&
+            FlushFileToDisk( pFile );
+
+        bSuccess = bSuccess &&
+            fseek( pFile, 0, SEEK_SET ) == 0 &&
+            fwrite( &Header, sizeof( Header ), 1, pFile ) == 1 &&
+            FlushFileToDisk( pFile );
+
+        fclose( pFile );
+
+        return Open( FileName.c_str() ) && bSuccess;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Writes all blobs to a new file and renames it over the archive
+    //--------------------------------------------------------------------------------------
+    bool ShaderArchive::Rewrite( const std::vector<ShaderArchiveEntry>& Blobs, const std::vector<const void*>& Data )
+    {
+        const std::wstring FileName = m_FileName;
+        const std::wstring NewFileName = FileName + L".new";
+
+        FILE* pFile = OpenFileStream( NewFileName.c_str(), "wb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        // The header goes first, the index it points to after the blobs
+        ArchiveHeader Header;
+        memset( &Header, 0, sizeof( Header ) );
+        unsigned long long uOffset = 0;
+        std::vector<ShaderArchiveEntry> Entries;
+
+        bool bSuccess = Write( pFile, &Header, sizeof( Header ), uOffset ) &&
+            WriteBlobsAndIndex( pFile, uOffset, Blobs, Data, Entries, Header ) &&
+            fseek( pFile, 0, SEEK_SET ) == 0 &&
+            fwrite( &Header, sizeof( Header ), 1, pFile ) == 1 &&
+            FlushFileToDisk( pFile );
+
+        fclose( pFile );
+
+        // The blobs kept are read from the mapping until here
+        Close();
+
+        bSuccess = bSuccess && ReplaceFileWith( FileName.c_str(), NewFileName.c_str() );
+        if ( !bSuccess )
+        {
+            RemoveFile( NewFileName.c_str() );
+        }
+
+        return Open( FileName.c_str() ) && bSuccess;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderArchive::Remove()
+    {
+        Close();
+
+        if ( !m_FileName.empty() )
+        {
+            RemoveFile( m_FileName.c_str() );
+        }
+    }
+}
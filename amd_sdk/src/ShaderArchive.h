@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderArchive.h
+//
+// A single file holding the compiled shaders of a ShaderCache, so a cached start opens
+// one file instead of an object and a hash file per shader, and creates the shaders
+// straight from the mapped bytes.
+//
+// The file is a header, the blobs, and an index of the blobs sorted by key, with the
+// header pointing to the index. An update appends the new blobs and a new index, flushes
+// them to disk, and only then points the header at the new index, so an update that
+// doesn't finish leaves the archive as it was. Once less than half of the file is live,
+// an update writes the live blobs to a new file and renames it over the archive instead.
+//
+// With SetCompression, an update stores each new blob compressed with ShaderCompress when
+// that makes it smaller. Entries tell compressed blobs by a stored size below their size,
+// and GetBlob decompresses them, or returns the mapped bytes of those stored as they are.
+//
+// Values are stored little endian, as on every platform the SDK runs on.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_ARCHIVE_H
+#define AMD_SDK_SHADER_ARCHIVE_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace AMD
+{
+    // An entry of the index, as stored
+    struct ShaderArchiveEntry
+    {
+        unsigned long long      uKey;           // Identifies the shader, e.g. a hash of its name
+        unsigned long long      uContentHash;   // Of what the blob was made from, 0 if unknown
+        unsigned long long      uOffset;        // Of the blob, from the start of the file
+        unsigned long long      uSize;
+        unsigned long long      uStoredSize;    // In the file, less than uSize when compressed
+    };
+
+    // A blob to add
+    struct ShaderArchiveBlob
+    {
+        unsigned long long      uKey;
+        unsigned long long      uContentHash;
+        const void*             pData;
+        size_t                  uSize;
+    };
+
+    class ShaderArchive
+    {
+    public:
+
+        ShaderArchive();
+
+        // Maps the archive. False if it doesn't exist or isn't valid, in which case the
+        // archive is empty, and the first Update creates the file.
+        bool Open( const wchar_t* szFileName );
+        void Close();
+
+        bool IsOpen() const { return m_File.IsOpen(); }
+
+        // The entry of a key, or NULL. Entries and their data are valid until the archive
+        // is closed or updated.
+        const ShaderArchiveEntry* Find( unsigned long long uKey ) const;
+        const void* GetData( const ShaderArchiveEntry& Entry ) const { return m_File.GetData() + Entry.uOffset; }
+
+        // The uSize bytes of the blob: the mapped ones, or decompressed into Buffer. NULL if
+        // the blob doesn't decompress. Safe to call from several threads at once.
+        const void* GetBlob( const ShaderArchiveEntry& Entry, std::vector<char>& Buffer ) const;
+        static bool IsCompressed( const ShaderArchiveEntry& Entry ) { return Entry.uStoredSize < Entry.uSize; }
+
+        // Compresses the blobs of later updates; those in the archive stay as they are
+        void SetCompression( bool bCompress ) { m_bCompress = bCompress; }
+
+        size_t GetEntryCount() const { return m_uEntryCount; }
+        size_t GetFileSize() const { return m_File.GetSize(); }
+        unsigned long long GetBlobBytes() const;   // Of the live blobs, decompressed
+
+        // Adds the blobs, replacing the entries of their keys, and maps the result. Takes
+        // the archive's file name from Open, which must have been called.
+        bool Update( const ShaderArchiveBlob* pBlobs, size_t uCount );
+
+        // Writes the live blobs to a new file, in place of the archive
+        bool Compact() { return Update( NULL, 0, true ); }
+
+        // Deletes the file, leaving an empty archive
+        void Remove();
+
+    private:
+
+        ShaderArchive( const ShaderArchive& );
+        ShaderArchive& operator=( const ShaderArchive& );
+
+        bool Update( const ShaderArchiveBlob* pBlobs, size_t uCount, bool bCompact );
+        bool Append( const std::vector<ShaderArchiveEntry>& Blobs, const std::vector<const void*>& Data, std::vector<ShaderArchiveEntry>& Entries );
+        bool Rewrite( const std::vector<ShaderArchiveEntry>& Blobs, const std::vector<const void*>& Data );
+
+        std::wstring                m_FileName;
+        MappedFile                  m_File;
+        const ShaderArchiveEntry*   m_pEntries;     // In the mapping
+        size_t                      m_uEntryCount;
+        bool                        m_bCompress;
+    };
+}
+
+#endif // AMD_SDK_SHADER_ARCHIVE_H
@@ -37,6 +37,16 @@
 #include "..\\..\\DXUT\\Core\\DXUT.h"
 #include "..\\..\\DXUT\\Optional\\SDKmisc.h"
 #include "ShaderCache.h"
+#include "ShaderHash.h"
+#include "MappedFile.h"
+#include "ShaderArchive.h"
+#include "ShaderDependencies.h"
+#include "ShaderPermutations.h"
+#include "ShaderDirectoryWatcher.h"
+#include "ShaderRemoteCache.h"
+#include "ShaderCompression.h"
+#include "ShaderProfile.h"
+#include "Timer.h"
 #include "Process.h"
 
 #include <Shlwapi.h>
@@ -51,12 +61,96 @@ using namespace AMD;
 // The done event handle
 static HANDLE   s_hDoneEvent = 0;
 
+// Time per ShadersReady call for creating shaders the first frame doesn't need
+static const double LAZY_CREATION_BUDGET_MS = 2.0;
+
+// An editor's save is often several writes, renames and touches; they are recompiled once quiet for this long
+static const unsigned int SHADER_WATCH_DEBOUNCE_MS = 150;
+
 static const wchar_t *FXC_PATH_STRING_LOCAL = L"\\src\\Shaders\\fxc.exe";
 static const wchar_t *DEV_PATH_STRING_LOCAL = L"\\src\\Shaders\\Dev.exe";
 static const wchar_t *FXC_PATH_STRING_INSTALLED_WIN_10_SDK = L"\\Windows Kits\\10\\bin\\x64\\fxc.exe";
 static const wchar_t *FXC_PATH_STRING_INSTALLED_WIN_8_1_SDK = L"\\Windows Kits\\8.1\\bin\\x64\\fxc.exe";
 static const wchar_t *FXC_PATH_STRING_INSTALLED_WIN_8_0_SDK = L"\\Windows Kits\\8.0\\bin\\x64\\fxc.exe";
 static const wchar_t *DEV_PATH_STRING_INSTALLED = L"\\Dev.exe";
+#ifdef _DEBUG
+static const wchar_t *ARCHIVE_FILENAME = L"Shaders\\Cache\\Object\\Debug\\ShaderCache.sca";
+static const wchar_t *DEPENDENCIES_FILENAME = L"Shaders\\Cache\\Object\\Debug\\ShaderDependencies.sdg";
+#else
+static const wchar_t *ARCHIVE_FILENAME = L"Shaders\\Cache\\Object\\Release\\ShaderCache.sca";
+static const wchar_t *DEPENDENCIES_FILENAME = L"Shaders\\Cache\\Object\\Release\\ShaderDependencies.sdg";
+#endif
+
+// The startup profile's report, and the shaders it and RenderProgress list
+static const wchar_t *PROFILE_FILENAME = L"ShaderStartupProfile.txt";
+static const size_t PROFILE_SLOWEST_SHADERS = 25;
+static const size_t PROGRESS_SLOWEST_SHADERS = 3;
+
+
+//--------------------------------------------------------------------------------------
+// Reads a stored hash as the key it is in the archive and the dependency graph
+//--------------------------------------------------------------------------------------
+static unsigned long long HashToKey( const BYTE* pHash )
+{
+    unsigned long long uKey = 0;
+    for (int i = SHADER_HASH_SIZE - 1; i >= 0; i--)
+    {
+        uKey = (uKey << 8) | pHash[i];
+    }
+    return uKey;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Times a stage of a shader for the startup profile, and as a TimerEx block once the app
+// called TIMER_Init. The generation thread and the threads of CreateShaders record into
+// TimerEx's per-thread buffers and release them with TIMER_ReleaseThread before they exit.
+// The app calls TIMER_Init before GenerateShaders, and OnDestroyDevice, which waits for the
+// generation thread, before TIMER_Destroy, so GetDevice() can't change under a timer.
+//--------------------------------------------------------------------------------------
+class ShaderStageTimer
+{
+public:
+
+    ShaderStageTimer( ShaderStartupProfile& Profile, unsigned int uShader, SHADER_PROFILE_STAGE eStage, TimerSite& Site )
+        : m_Scope( Profile, uShader, eStage )
+        , m_bTimerEx( false )
+    {
+#if ENABLE_AMD_TIMER
+        m_bTimerEx = (NULL != TimerEx::Instance().GetDevice());
+        if (m_bTimerEx)
+        {
+            TimerEx::Instance().Start( Site );
+        }
+#endif
+        (void)Site;
+    }
+
+    ~ShaderStageTimer()
+    {
+        if (m_bTimerEx)
+        {
+            TIMER_End();
+        }
+    }
+
+private:
+
+    ShaderStageTimer( const ShaderStageTimer& );
+    ShaderStageTimer& operator=( const ShaderStageTimer& );
+
+    ShaderProfileScope  m_Scope;
+    bool                m_bTimerEx;
+};
+
+// Times the rest of the block as a stage of a shader, as TIMER_ProfileCodeBlockStatic does
+#define SHADER_PROFILE_BLOCK( uShader, eStage, name )                               \
+    static TimerSite __shader_profile_site = { name, 0, NULL, NULL, 0 };            \
+    ShaderStageTimer __shader_profile_timer( m_Profile, uShader, eStage, __shader_profile_site );
+
+// Times the rest of the block for TimerEx only
+#define SHADER_TIMER_BLOCK( name )                                                  \
+    SHADER_PROFILE_BLOCK( ShaderStartupProfile::NO_SHADER, SHADER_PROFILE_STAGE_COUNT, name )
 
 //--------------------------------------------------------------------------------------
 // Constructor
@@ -133,16 +227,25 @@ ShaderCache::Shader::Shader()
 
 
     m_bBeingProcessed = false;
-    m_hCompileProcessHandle = NULL;
-    m_hCompileThreadHandle = NULL;
     m_iCompileWaitCount = -1;
 
     m_pHash = NULL;
     m_uHashLength = 0;
+    m_uDependencyHash = 0;
+    m_uCompileOptionsHash = 0;
+    m_uRemoteKey = 0;
+    m_uProfileIndex = ShaderStartupProfile::NO_SHADER;
+    m_uProcessStartTime = 0;
 
     m_pFilenameHash = NULL;
     m_uFilenameHashLength = 0;
 
+    m_pPermutedShader = NULL;
+    m_uPermutationKey = 0;
+    m_pPermutation = NULL;
+
+    m_ePriority = SHADER_PRIORITY_FIRST_FRAME;
+    m_bAwaitedByFirstFrame = false;
 }
 
 
@@ -177,6 +280,23 @@ ShaderCache::Shader::~Shader()
     m_pInputLayoutDesc = NULL;
 }
 
+
+//--------------------------------------------------------------------------------------
+// Constructor
+//--------------------------------------------------------------------------------------
+ShaderCache::PermutedShader::PermutedShader()
+{
+    m_eShaderType = SHADER_TYPE_UNKNOWN;
+
+    memset( m_wsTarget, '\0', sizeof( m_wsTarget ) );
+    memset( m_wsEntryPoint, '\0', sizeof( m_wsEntryPoint ) );
+    memset( m_wsSourceFile, '\0', sizeof( m_wsSourceFile ) );
+
+    m_uOptionsHash = 0;
+    m_pInputLayout = NULL;
+    m_bInputLayoutRequested = false;
+}
+
 //--------------------------------------------------------------------------------------
 // Constructor
 //--------------------------------------------------------------------------------------
@@ -186,11 +306,21 @@ ShaderCache::ShaderCache( const SHADER_AUTO_RECOMPILE_TYPE i_keAutoRecompileTouc
     m_ShaderSourceList.clear();
     m_ShaderList.clear();
     m_PreprocessList.clear();
-    m_HashList.clear();
-    m_CompileList.clear();
-    m_CompileCheckList.clear();
     m_CreateList.clear();
     m_ErrorList.clear();
+    m_PermutedShaderList.clear();
+    m_PendingPermutationList.clear();
+    m_GeneratingPermutationList.clear();
+    m_bGeneratingPermutations = false;
+
+    m_bLazyCreation = false;
+    m_bCreatingLazily = false;
+    m_eShaderPriority = SHADER_PRIORITY_FIRST_FRAME;
+    m_ReadyList.clear();
+    m_lFirstFrameShadersLeft = 0;
+    m_GenerationStart.QuadPart = 0;
+    m_bReportFirstFrame = false;
+    m_uProfileCacheFiles = ShaderStartupProfile::NO_SHADER;
 
 #if AMD_SDK_INTERNAL_BUILD
     m_ISATargetList.clear();
@@ -205,6 +335,7 @@ ShaderCache::ShaderCache( const SHADER_AUTO_RECOMPILE_TYPE i_keAutoRecompileTouc
 
     InitializeCriticalSection( &m_CompileShaders_CriticalSection );
     InitializeCriticalSection( &m_GenISA_CriticalSection );
+    InitializeCriticalSection( &m_ReadyList_CriticalSection );
 
     // the working dir we want for ShaderCache is not necessarily the current directory,
     // so get the current directory and then specify our working dir relative to it
@@ -349,11 +480,13 @@ ShaderCache::ShaderCache( const SHADER_AUTO_RECOMPILE_TYPE i_keAutoRecompileTouc
 
     m_pProgressInfo = NULL;
     m_uProgressCounter = 0;
+    m_lShadersToPreprocess = 0;
+    m_lShadersToCompile = 0;
+    memset( &m_SchedulerStats, 0, sizeof( m_SchedulerStats ) );
 
     m_bForceDebugShaders = false;
 
-    m_watchHandle = NULL;
-    m_waitPoolHandle = NULL;
+    m_pFileChanges = NULL;
 
 #if AMD_SDK_INTERNAL_BUILD
     m_eTargetISA = DEFAULT_ISA_TARGET;
@@ -441,6 +574,17 @@ ShaderCache::ShaderCache( const SHADER_AUTO_RECOMPILE_TYPE i_keAutoRecompileTouc
 
     m_bShowShaderISA = m_bGenerateShaderISA;
 
+    // Missing until shaders were compiled once
+    wchar_t wsArchivePathName[m_uPATHNAME_MAX_LENGTH];
+    CreateFullPathFromOutputFilename( wsArchivePathName, ARCHIVE_FILENAME );
+    m_Archive.Open( wsArchivePathName );
+
+    wchar_t wsDependenciesPathName[m_uPATHNAME_MAX_LENGTH];
+    CreateFullPathFromOutputFilename( wsDependenciesPathName, DEPENDENCIES_FILENAME );
+    m_Dependencies.Load( wsDependenciesPathName );
+
+    m_uCompilerHash = 0;
+
     if (m_bRecompileTouchedShaders)
     {
 #if defined(DEBUG) || defined(_DEBUG)
@@ -474,6 +618,21 @@ ShaderCache::~ShaderCache()
         delete pShader;
     }
 
+    ReleasePermutations();
+
+    for (std::list<Shader*>::iterator it = m_GeneratingPermutationList.begin(); it != m_GeneratingPermutationList.end(); it++)
+    {
+        Shader* pShader = *it;
+        SAFE_RELEASE( pShader->m_pPermutation );
+        delete pShader;
+    }
+
+    for (std::list<PermutedShader*>::iterator it = m_PermutedShaderList.begin(); it != m_PermutedShaderList.end(); it++)
+    {
+        PermutedShader* pPermutedShader = *it;
+        delete pPermutedShader;
+    }
+
 #if AMD_SDK_INTERNAL_BUILD
     for (std::vector< std::vector<Shader*> * >::iterator it = m_ISATargetList.begin(); it != m_ISATargetList.end(); it++)
     {
@@ -486,11 +645,11 @@ ShaderCache::~ShaderCache()
     m_ShaderSourceList.clear();
     m_ShaderList.clear();
     m_PreprocessList.clear();
-    m_HashList.clear();
-    m_CompileList.clear();
-    m_CompileCheckList.clear();
     m_CreateList.clear();
     m_ErrorList.clear();
+    m_PermutedShaderList.clear();
+    m_GeneratingPermutationList.clear();
+    m_ReadyList.clear();
 
 #if AMD_SDK_INTERNAL_BUILD
     m_ISATargetList.clear();
@@ -502,18 +661,10 @@ ShaderCache::~ShaderCache()
         m_pProgressInfo = NULL;
     }
 
-    if (m_waitPoolHandle)
-    {
-        UnregisterWaitEx( m_waitPoolHandle, INVALID_HANDLE_VALUE );
-        m_waitPoolHandle = NULL;
-    }
-
-    if (m_watchHandle)
-    {
-        FindCloseChangeNotification( m_watchHandle );
-        m_watchHandle = NULL;
-    }
+    // Before anything a recompile it starts could use goes
+    m_DirectoryWatcher.Stop();
 
+    DeleteCriticalSection( &m_ReadyList_CriticalSection );
     DeleteCriticalSection( &m_GenISA_CriticalSection );
     DeleteCriticalSection( &m_CompileShaders_CriticalSection );
 
@@ -526,17 +677,28 @@ ShaderCache::~ShaderCache()
 //--------------------------------------------------------------------------------------
 void ShaderCache::OnDestroyDevice()
 {
+    // The generation thread times its stages with TimerEx, which the app destroys next
+    WaitForSingleObject( s_hDoneEvent, INFINITE );
+
     m_bShadersCreated = false;
     InvalidateShaders();
+
+    // The shaders created lazily are gone with the device, so create all of them as usual
+    m_bCreatingLazily = false;
+
+    // Permutations are created again as they are requested
+    ReleasePermutations();
 }
 
 
 //--------------------------------------------------------------------------------------
-// Called by app when WM_QUIT is posted, so that shader generation can be aborted
+// Called by app when WM_QUIT is posted, so that shader generation can be aborted.
+// Returns once the generation thread stopped.
 //--------------------------------------------------------------------------------------
 void ShaderCache::Abort()
 {
     m_bAbort = true;
+    WaitForSingleObject( s_hDoneEvent, INFINITE );
 }
 
 //--------------------------------------------------------------------------------------
@@ -697,6 +859,35 @@ bool ShaderCache::AddShader( ID3D11DeviceChild** ppShader,
 #endif
     }
 
+    Shader* pShader = NewShader( ppShader, ShaderType, pwsTarget, pwsEntryPoint, pwsSourceFile, uNumMacros, pMacros,
+        ppInputLayout, pInputLayoutDesc, uNumDescElements, pwsCanonicalName, i_iMaxVGPR, i_iMaxSGPR, i_kbIsApplicationShader );
+    pShader->m_ePriority = m_eShaderPriority;
+
+    m_ShaderList.push_back( pShader );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sets up a shader: its file names, and its command lines to preprocess and compile it
+//--------------------------------------------------------------------------------------
+ShaderCache::Shader* ShaderCache::NewShader( ID3D11DeviceChild** ppShader,
+    SHADER_TYPE ShaderType,
+    const wchar_t* pwsTarget,
+    const wchar_t* pwsEntryPoint,
+    const wchar_t* pwsSourceFile,
+    unsigned int uNumMacros,
+    Macro* pMacros,
+    ID3D11InputLayout** ppInputLayout,
+    const D3D11_INPUT_ELEMENT_DESC* pInputLayoutDesc,
+    unsigned int uNumDescElements,
+    const wchar_t* pwsCanonicalName,
+    const int i_iMaxVGPR,
+    const int i_iMaxSGPR,
+    const bool i_kbIsApplicationShader
+    )
+{
     Shader* pShader = new Shader();
     if (i_kbIsApplicationShader)
     { // Only copy this if this is an app shader; if we are cloning a shader, we won't render with it, so keep m_ppShader NULL.
@@ -842,6 +1033,10 @@ bool ShaderCache::AddShader( ID3D11DeviceChild** ppShader,
     }
 #endif
 
+    // Besides the preprocessed source, what the object file depends on, for the cache server
+    const std::wstring wsCompileOptions = std::wstring( pwsTarget ) + L" " + pwsEntryPoint + wsCompilationFlags;
+    pShader->m_uCompileOptionsHash = ShaderHasher::Hash( wsCompileOptions.c_str(), wsCompileOptions.size() * sizeof( wchar_t ) );
+
     // Command line
     wcscat_s( pShader->m_wsCommandLine, m_uCOMMAND_LINE_MAX_LENGTH, L" /T " );
     wcscat_s( pShader->m_wsCommandLine, m_uCOMMAND_LINE_MAX_LENGTH, pwsTarget );
@@ -914,9 +1109,7 @@ bool ShaderCache::AddShader( ID3D11DeviceChild** ppShader,
         wcscat_s( pShader->m_wsPreprocessCommandLine, m_uCOMMAND_LINE_MAX_LENGTH, wsValue );
     }
 
-    m_ShaderList.push_back( pShader );
-
-    return true;
+    return pShader;
 }
 
 
@@ -929,6 +1122,8 @@ DWORD WINAPI GenerateShaders_ThreadProc_( void* pParameter )
 
     pShaderCache->GenerateShadersThreadProc();
 
+    TIMER_ReleaseThread()
+
     SetEvent( s_hDoneEvent );
 
     return 0;
@@ -945,7 +1140,9 @@ HRESULT ShaderCache::GenerateShaders( CREATE_TYPE CreateType, const bool i_kbRec
 {
     DWORD dwRet = WaitForSingleObject( s_hDoneEvent, 0 );
 
-    if (dwRet == WAIT_OBJECT_0)
+    // Busy until the generated permutations are created, by the next GetShaderPermutation, and
+    // until the shaders created lazily are, by the next calls to ShadersReady
+    if ((dwRet == WAIT_OBJECT_0) && !m_bGeneratingPermutations && !m_bCreatingLazily)
     {
 #if !AMD_SDK_PREBUILT_RELEASE_EXE
         m_CreateType = CreateType;
@@ -958,37 +1155,112 @@ HRESULT ShaderCache::GenerateShaders( CREATE_TYPE CreateType, const bool i_kbRec
         m_bShadersCreated = false;
         m_bPrintedProgress = false;
 
+        m_bCreatingLazily = m_bLazyCreation;
+        m_ReadyList.clear();
+        m_lFirstFrameShadersLeft = 0;
+        QueryPerformanceCounter( &m_GenerationStart );
+        m_bReportFirstFrame = true;
+        BeginStartupProfile();
+
         if (i_kbRecreateShaders)
         {
             m_CreateList.clear();
         }
 
+        // Changes the watcher reported leave the other files as the last check found them
+        if ((NULL != m_pFileChanges) && !m_pFileChanges->bOverflow && (m_CreateType == CREATE_TYPE_COMPILE_CHANGES))
+        {
+            std::vector<std::wstring> ChangedFiles;
+            for (size_t i = 0; i < m_pFileChanges->Files.size(); i++)
+            {
+                wchar_t wsChangedPathName[m_uPATHNAME_MAX_LENGTH];
+                CreateFullPathFromInputFilename( wsChangedPathName, m_pFileChanges->Files[i].c_str() );
+                ChangedFiles.push_back( wsChangedPathName );
+            }
+            m_Dependencies.BeginCheck( ChangedFiles );
+        }
+        else
+        {
+            m_Dependencies.BeginCheck();
+        }
+
         for (std::list<Shader*>::iterator it = m_ShaderList.begin(); it != m_ShaderList.end(); it++)
         {
             Shader* pShader = *it;
+            bool bPreprocess = true;
+
+            // The first frame renders with the shaders the app already holds, e.g. while recompiling
+            pShader->m_bAwaitedByFirstFrame = m_bCreatingLazily && (pShader->m_ePriority == SHADER_PRIORITY_FIRST_FRAME) &&
+                (NULL != pShader->m_ppShader) && (NULL == *(pShader->m_ppShader));
+            if (pShader->m_bAwaitedByFirstFrame)
+            {
+                m_lFirstFrameShadersLeft++;
+            }
 
-            if ((m_CreateType == CREATE_TYPE_COMPILE_CHANGES) ||
-                (m_CreateType == CREATE_TYPE_FORCE_COMPILE) ||
-                (!CheckObjectFile( pShader )))
             {
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_DISK, L"ShaderCache: look up shader" )
+
+                if (m_CreateType == CREATE_TYPE_COMPILE_CHANGES)
+                {
+                    // Only shaders whose sources changed since they were built need the preprocessor
+                    pShader->m_uDependencyHash = GetDependencyHash( pShader );
+                    bPreprocess = !m_Dependencies.IsTargetUpToDate( HashToKey( pShader->m_pFilenameHash ), pShader->m_uDependencyHash ) ||
+                        (!FindArchiveEntry( pShader ) && !CheckObjectFile( pShader ));
+                }
+                else if (m_CreateType == CREATE_TYPE_FORCE_COMPILE)
+                {
+                    pShader->m_uDependencyHash = GetDependencyHash( pShader );
+                }
+                else
+                {
+                    bPreprocess = !FindArchiveEntry( pShader ) && !CheckObjectFile( pShader );
+                }
+            }
+
+            if (bPreprocess)
+            {
+                // Recorded as built again once it is ready to create
+                m_Dependencies.ForgetTarget( HashToKey( pShader->m_pFilenameHash ) );
                 m_PreprocessList.push_back( pShader );
             }
             else
             {
                 m_CreateList.push_back( pShader );
+
+                if (m_bCreatingLazily)
+                {
+                    QueueReadyShader( pShader );
+                }
             }
         }
 
+        if (m_CreateType != CREATE_TYPE_USE_CACHED)
+        {
+            wchar_t wsDependencies[m_uPATHNAME_MAX_LENGTH];
+            swprintf_s( wsDependencies, L"\n*** Shader Cache: %u of %u shaders changed, %u source files looked up, %u read ***\n",
+                (unsigned int)m_PreprocessList.size(), (unsigned int)m_ShaderList.size(), m_Dependencies.GetFilesLookedUp(), m_Dependencies.GetFilesRead() );
+            OutputDebugStringW( wsDependencies );
+        }
+
         if (m_PreprocessList.size())
         {
             m_pProgressInfo = new ProgressInfo[m_PreprocessList.size() * 2];
             m_uProgressCounter = 0;
+            m_lShadersToPreprocess = (LONG)m_PreprocessList.size();
+            m_lShadersToCompile = 0;
 
             ResetEvent( s_hDoneEvent );
             QueueUserWorkItem( GenerateShaders_ThreadProc_, this, WT_EXECUTELONGFUNCTION );
         }
         else
         {
+            // Keeps the times of files that were read but found unchanged
+            if ((m_CreateType != CREATE_TYPE_USE_CACHED) && m_Dependencies.GetFilesRead())
+            {
+                SHADER_PROFILE_BLOCK( m_uProfileCacheFiles, SHADER_PROFILE_DISK, L"ShaderCache: save dependencies" )
+                SaveDependencies();
+            }
+
             SetEvent( s_hDoneEvent );
         }
     }
@@ -1007,162 +1279,685 @@ HRESULT ShaderCache::GenerateShaders( CREATE_TYPE CreateType, const bool i_kbRec
 //--------------------------------------------------------------------------------------
 void ShaderCache::GenerateShadersThreadProc()
 {
-    DeleteErrorFiles();
-    DeleteAssemblyFiles();
-    DeletePreprocessFiles();
+    SHADER_TIMER_BLOCK( L"ShaderCache: generate shaders" )
 
-    if (m_CreateType == CREATE_TYPE_FORCE_COMPILE)
+    // Permutations are generated while the other shaders are in use, with their files
+    if (!m_bGeneratingPermutations)
     {
-        DeleteHashFiles();
-        DeleteObjectFiles();
+        SHADER_PROFILE_BLOCK( m_uProfileCacheFiles, SHADER_PROFILE_DISK, L"ShaderCache: delete files" )
+
+        DeleteErrorFiles();
+        DeleteAssemblyFiles();
+        DeletePreprocessFiles();
+
+        if (m_CreateType == CREATE_TYPE_FORCE_COMPILE)
+        {
+            DeleteHashFiles();
+            DeleteObjectFiles();
+            m_Archive.Remove();
+        }
+
+        // Remove Old Shader Errors from displaying over shader recompilation
+        m_bHasShaderErrorsToDisplay = false;
+        m_shaderErrorRenderedCount = 0;
     }
 
-    // Remove Old Shader Errors from displaying over shader recompilation
-    m_bHasShaderErrorsToDisplay = false;
-    m_shaderErrorRenderedCount = 0;
+    ProcessShaders();
 
-    PreprocessShaders();
-    CompileShaders();
+    m_Profile.Mark( L"generated" );
 }
 
+
 //--------------------------------------------------------------------------------------
-// Renders the progress of the shader generation process
+// User adds a shader with options to the cache
 //--------------------------------------------------------------------------------------
-void ShaderCache::RenderProgress( CDXUTTextHelper* g_pTxtHelper, int iFontHeight, DirectX::XMVECTOR FontColor )
+ShaderCache::PermutedShader* ShaderCache::AddPermutedShader( SHADER_TYPE ShaderType,
+    const wchar_t* pwsTarget,
+    const wchar_t* pwsEntryPoint,
+    const wchar_t* pwsSourceFile,
+    const ShaderOptions& Options,
+    const D3D11_INPUT_ELEMENT_DESC* pInputLayoutDesc,
+    unsigned int uNumDescElements
+    )
 {
-    wchar_t wsOverallProgress[m_uPATHNAME_MAX_LENGTH];
-    wchar_t wsCurrentLine[m_uCOMMAND_LINE_MAX_LENGTH];
-
-    g_pTxtHelper->Begin();
-    g_pTxtHelper->SetForegroundColor( FontColor );
-    g_pTxtHelper->SetInsertionPos( 5, 5 );
-
-    int iNumLines = (int)((DXUTGetDXGIBackBufferSurfaceDesc()->Height - (iFontHeight)) * 0.99f / iFontHeight);
+    assert( (ShaderType >= SHADER_TYPE_VERTEX) && (ShaderType <= SHADER_TYPE_COMPUTE) );
+    assert( (NULL != pwsTarget) && (wcslen( pwsTarget ) <= m_uTARGET_MAX_LENGTH) );
+    assert( (NULL != pwsEntryPoint) && (wcslen( pwsEntryPoint ) <= m_uENTRY_POINT_MAX_LENGTH) );
+    assert( (NULL != pwsSourceFile) && (wcslen( pwsSourceFile ) <= m_uFILENAME_MAX_LENGTH) );
+    assert( (uNumDescElements == 0) || ((ShaderType == SHADER_TYPE_VERTEX) && (NULL != pInputLayoutDesc)) );
 
-    if (!m_bPrintedProgress && !m_PreprocessList.size())
-    {
-        swprintf_s( wsOverallProgress, L"*** Shader Cache: Creating Shaders... ***" );
-        g_pTxtHelper->DrawTextLine( wsOverallProgress );
+    PermutedShader* pPermutedShader = new PermutedShader();
+    pPermutedShader->m_eShaderType = ShaderType;
+    wcscpy_s( pPermutedShader->m_wsTarget, m_uTARGET_MAX_LENGTH, pwsTarget );
+    wcscpy_s( pPermutedShader->m_wsEntryPoint, m_uENTRY_POINT_MAX_LENGTH, pwsEntryPoint );
+    wcscpy_s( pPermutedShader->m_wsSourceFile, m_uFILENAME_MAX_LENGTH, pwsSourceFile );
+    pPermutedShader->m_Options = Options;
 
-        m_bPrintedProgress = true;
-    }
-    else
+    for (unsigned int iElement = 0; iElement < uNumDescElements; iElement++)
     {
-        swprintf_s( wsOverallProgress, L"*** Shader Cache: Shaders to Preprocess = %d, Compile = %d ***", (int)m_PreprocessList.size(), (int)m_CompileList.size() );
-        g_pTxtHelper->DrawTextLine( wsOverallProgress );
+        pPermutedShader->m_SemanticNames.push_back( pInputLayoutDesc[iElement].SemanticName );
+        pPermutedShader->m_InputLayoutDesc.push_back( pInputLayoutDesc[iElement] );
+        pPermutedShader->m_InputLayoutDesc.back().SemanticName = pPermutedShader->m_SemanticNames.back().c_str();
     }
 
-    if (NULL != m_pProgressInfo)
+    // Permutations are named by key, which means other values once the options change
+    std::wstring wsOptions = std::wstring( pwsSourceFile ) + L" " + pwsTarget;
+    for (unsigned int iOption = 0; iOption < Options.GetOptionCount(); iOption++)
     {
-        g_pTxtHelper->SetInsertionPos( 5, 5 + iFontHeight );
-
-        int iCounter = m_uProgressCounter;
-        int iStrings = (iCounter < iNumLines) ? (iCounter) : (iNumLines);
-
-        for (int i = iCounter - iStrings; i < iCounter; i++)
-        {
-            if (m_pProgressInfo[i].m_pShader->m_iCompileWaitCount >= 0)
-            {
-                swprintf_s( wsCurrentLine, L"%s ... [%s][%i]", m_pProgressInfo[i].m_wsFilename, m_pProgressInfo[i].m_pShader->m_wsCompileStatus, m_pProgressInfo[i].m_pShader->m_iCompileWaitCount );
-            }
-            else
-            {
-                swprintf_s( wsCurrentLine, L"%s ... [%s]", m_pProgressInfo[i].m_wsFilename, m_pProgressInfo[i].m_pShader->m_wsCompileStatus/*m_pProgressInfo[i].m_wsStatus*/ );
-            }
-            g_pTxtHelper->DrawTextLine( wsCurrentLine );
-        }
+        wchar_t wsOption[m_uMACRO_MAX_LENGTH + 32];
+        swprintf_s( wsOption, L" %s:%u:%d", Options.GetOptionName( iOption ), Options.GetValueCount( iOption ), Options.GetFirstValue( iOption ) );
+        wsOptions += wsOption;
     }
+    pPermutedShader->m_uOptionsHash = (unsigned int)ShaderHasher::Hash( wsOptions.c_str(), wsOptions.size() * sizeof( wchar_t ) );
 
-    g_pTxtHelper->End();
+    m_PermutedShaderList.push_back( pPermutedShader );
 
-    if (ShowShaderErrors() && HasErrorsToDisplay())
-    {
-        RenderShaderErrors( g_pTxtHelper, iFontHeight, FontColor );
-    }
+    return pPermutedShader;
 }
 
 
 //--------------------------------------------------------------------------------------
-// boolean method to determine if the shaders are ready
+// Looks a permutation up, and requests it the first time
 //--------------------------------------------------------------------------------------
-bool ShaderCache::ShadersReady()
+ID3D11DeviceChild* ShaderCache::GetShaderPermutation( PermutedShader* pPermutedShader, ShaderPermutationKey uKey )
 {
-    if (TryEnterCriticalSection( &m_CompileShaders_CriticalSection ))
-    {
-
-        DWORD dwRet = WaitForSingleObject( s_hDoneEvent, 0 );
+    assert( (NULL != pPermutedShader) && pPermutedShader->m_Options.IsValidKey( uKey ) );
 
-        if (dwRet == WAIT_OBJECT_0)
-        {
-            if (m_bPrintedProgress)
-            {
-                if (!m_bShadersCreated)
-                {
-                    CreateShaders();
-                    m_bShadersCreated = true;
+    if (m_bGeneratingPermutations || m_PendingPermutationList.size())
+    {
+        UpdatePermutations();
+    }
 
-                    if (NULL != m_pProgressInfo)
-                    {
-                        delete [] m_pProgressInfo;
-                        m_pProgressInfo = NULL;
-                        m_uProgressCounter = 0;
-                    }
-                }
+    ShaderPermutationRecord* pRecord = pPermutedShader->m_Permutations.Find( uKey );
+    if (NULL == pRecord)
+    {
+        pPermutedShader->m_Permutations.Add( uKey, NULL );
+        m_PendingPermutationList.push_back( NewPermutation( pPermutedShader, uKey ) );
 
-                LeaveCriticalSection( &m_CompileShaders_CriticalSection );
-                return true;
-            }
-        }
-        LeaveCriticalSection( &m_CompileShaders_CriticalSection );
+        UpdatePermutations();
 
+        pRecord = pPermutedShader->m_Permutations.Find( uKey );
     }
 
-    return false;
+    return (ID3D11DeviceChild*)pRecord->pObject;
 }
 
 
 //--------------------------------------------------------------------------------------
-// public and private setter/getter methods:
+// Sets up the shader to generate a permutation with, named by its key
 //--------------------------------------------------------------------------------------
-
-const bool ShaderCache::HasErrorsToDisplay( void ) const
+ShaderCache::Shader* ShaderCache::NewPermutation( PermutedShader* pPermutedShader, ShaderPermutationKey uKey )
 {
-    return m_bHasShaderErrorsToDisplay;
-}
+    const ShaderOptions& Options = pPermutedShader->m_Options;
 
-const bool ShaderCache::ShowShaderErrors( void ) const
-{
-    return (m_ErrorDisplayType == ERROR_DISPLAY_ON_SCREEN) && m_bShowShaderErrors;
-}
+    std::vector<Macro> Macros( Options.GetOptionCount() );
+    for (unsigned int iOption = 0; iOption < Options.GetOptionCount(); iOption++)
+    {
+        wcscpy_s( Macros[iOption].m_wsName, m_uMACRO_MAX_LENGTH, Options.GetOptionName( iOption ) );
+        Macros[iOption].m_iValue = Options.GetValue( uKey, iOption );
+    }
 
-const int ShaderCache::ShaderErrorDisplayType( void ) const
-{
-    return m_ErrorDisplayType;
-}
+    wchar_t wsCanonicalName[m_uFILENAME_MAX_LENGTH];
+    swprintf_s( wsCanonicalName, L"%s_%08x_%llx", pPermutedShader->m_wsEntryPoint, pPermutedShader->m_uOptionsHash, uKey );
 
-const bool ShaderCache::RecompileTouchedShaders( void ) const
-{
-    return m_bRecompileTouchedShaders;
-}
+    // The input layout comes with the first permutation created
+    const bool bInputLayout = pPermutedShader->m_InputLayoutDesc.size() && !pPermutedShader->m_bInputLayoutRequested;
+    pPermutedShader->m_bInputLayoutRequested |= bInputLayout;
 
-const bool ShaderCache::GenerateISAGPRPressure( void ) const
-{
-    return m_bGenerateShaderISA;
-}
+    Shader* pShader = NewShader( NULL, pPermutedShader->m_eShaderType, pPermutedShader->m_wsTarget, pPermutedShader->m_wsEntryPoint, pPermutedShader->m_wsSourceFile,
+        (unsigned int)Macros.size(), Macros.size() ? &Macros[0] : NULL,
+        bInputLayout ? &pPermutedShader->m_pInputLayout : NULL, bInputLayout ? &pPermutedShader->m_InputLayoutDesc[0] : NULL,
+        bInputLayout ? (unsigned int)pPermutedShader->m_InputLayoutDesc.size() : 0,
+        wsCanonicalName, -1, -1, true );
 
-const bool ShaderCache::ShowISAGPRPressure( void ) const
-{
-    return m_bShowShaderISA;
+    pShader->m_ppShader = &pShader->m_pPermutation;
+    pShader->m_pPermutedShader = pPermutedShader;
+    pShader->m_uPermutationKey = uKey;
+
+    return pShader;
 }
 
-void ShaderCache::SetRecompileTouchedShadersFlag( const bool i_bRecompileWhenTouched )
+
+//--------------------------------------------------------------------------------------
+// Creates the permutations the generation thread finished, then creates the requested
+// ones the cache holds, and starts generating the rest. Does nothing while the thread is
+// busy, so the request waits for the next call.
+//--------------------------------------------------------------------------------------
+void ShaderCache::UpdatePermutations()
 {
-    m_bRecompileTouchedShaders = i_bRecompileWhenTouched;
+    if ((WaitForSingleObject( s_hDoneEvent, 0 ) != WAIT_OBJECT_0) || !TryEnterCriticalSection( &m_CompileShaders_CriticalSection ))
+    {
+        return;
+    }
 
-    if (m_bRecompileTouchedShaders)
+    if (m_bGeneratingPermutations)
+    {
+        for (std::list<Shader*>::iterator it = m_CreateList.begin(); it != m_CreateList.end();)
+        {
+            Shader* pShader = *it;
+            if (pShader->m_pPermutedShader)
+            {
+                // Unless the device went away meanwhile
+                if (pShader->m_pPermutedShader->m_Permutations.Find( pShader->m_uPermutationKey ))
+                {
+                    CreateShader( pShader );
+                }
+                it = m_CreateList.erase( it );
+            }
+            else
+            {
+                it++;
+            }
+        }
+
+        for (std::list<Shader*>::iterator it = m_GeneratingPermutationList.begin(); it != m_GeneratingPermutationList.end(); it++)
+        {
+            FinishPermutation( *it );
+        }
+        m_GeneratingPermutationList.clear();
+
+        if (NULL != m_pProgressInfo)
+        {
+            delete [] m_pProgressInfo;
+            m_pProgressInfo = NULL;
+            m_uProgressCounter = 0;
+        }
+
+        m_bGeneratingPermutations = false;
+    }
+
+    // Once the shaders that aren't permutations are created, which shares the generation thread
+    if (m_PendingPermutationList.size() && m_bShadersCreated)
+    {
+        m_Dependencies.BeginCheck();
+
+        for (std::list<Shader*>::iterator it = m_PendingPermutationList.begin(); it != m_PendingPermutationList.end(); it++)
+        {
+            Shader* pShader = *it;
+            bool bCached = FindArchiveEntry( pShader ) || CheckObjectFile( pShader );
+
+            // As GenerateShaders picks the shaders to preprocess
+            if (m_CreateType != CREATE_TYPE_USE_CACHED)
+            {
+                pShader->m_uDependencyHash = GetDependencyHash( pShader );
+                bCached = bCached && (m_CreateType == CREATE_TYPE_COMPILE_CHANGES) &&
+                    m_Dependencies.IsTargetUpToDate( HashToKey( pShader->m_pFilenameHash ), pShader->m_uDependencyHash );
+            }
+
+            if (bCached)
+            {
+                CreateShader( pShader );
+                FinishPermutation( pShader );
+            }
+            else
+            {
+                m_Dependencies.ForgetTarget( HashToKey( pShader->m_pFilenameHash ) );
+                DeleteErrorFile( pShader );
+                DeleteAssemblyFile( pShader );
+                DeletePreprocessFile( pShader );
+                m_PreprocessList.push_back( pShader );
+                m_GeneratingPermutationList.push_back( pShader );
+            }
+        }
+        m_PendingPermutationList.clear();
+
+        if (m_PreprocessList.size())
+        {
+            m_bGeneratingPermutations = true;
+
+            m_pProgressInfo = new ProgressInfo[m_PreprocessList.size() * 2];
+            m_uProgressCounter = 0;
+            m_lShadersToPreprocess = (LONG)m_PreprocessList.size();
+            m_lShadersToCompile = 0;
+
+            ResetEvent( s_hDoneEvent );
+            QueueUserWorkItem( GenerateShaders_ThreadProc_, this, WT_EXECUTELONGFUNCTION );
+        }
+    }
+
+    LeaveCriticalSection( &m_CompileShaders_CriticalSection );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Moves a permutation's shader to its record, NULL if it failed, and deletes the rest
+//--------------------------------------------------------------------------------------
+void ShaderCache::FinishPermutation( Shader* pShader )
+{
+    PermutedShader* pPermutedShader = pShader->m_pPermutedShader;
+
+    ShaderPermutationRecord* pRecord = pPermutedShader->m_Permutations.Find( pShader->m_uPermutationKey );
+    if (pRecord)
+    {
+        pRecord->pObject = pShader->m_pPermutation;
+    }
+    else
+    {
+        SAFE_RELEASE( pShader->m_pPermutation );
+    }
+
+    // Let the next permutation create the input layout
+    if ((NULL == pShader->m_pPermutation) && (NULL != pShader->m_ppInputLayout) && (NULL == pPermutedShader->m_pInputLayout))
+    {
+        pPermutedShader->m_bInputLayoutRequested = false;
+    }
+
+    m_ErrorList.erase( pShader );
+    delete pShader;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Releases the created permutations, and drops the requests not handed to the generation
+// thread. Permutations it generates meanwhile are dropped when they finish.
+//--------------------------------------------------------------------------------------
+void ShaderCache::ReleasePermutations()
+{
+    for (std::list<PermutedShader*>::iterator it = m_PermutedShaderList.begin(); it != m_PermutedShaderList.end(); it++)
+    {
+        PermutedShader* pPermutedShader = *it;
+
+        for (size_t uSlot = 0; uSlot < pPermutedShader->m_Permutations.GetSlotCount(); uSlot++)
+        {
+            ID3D11DeviceChild* pObject = (ID3D11DeviceChild*)pPermutedShader->m_Permutations.GetSlot( uSlot ).pObject;
+            SAFE_RELEASE( pObject );
+        }
+        pPermutedShader->m_Permutations.Clear();
+
+        SAFE_RELEASE( pPermutedShader->m_pInputLayout );
+        pPermutedShader->m_bInputLayoutRequested = false;
+    }
+
+    for (std::list<Shader*>::iterator it = m_PendingPermutationList.begin(); it != m_PendingPermutationList.end(); it++)
+    {
+        Shader* pShader = *it;
+        delete pShader;
+    }
+    m_PendingPermutationList.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Hands a shader that is ready over for lazy creation, the first frame's ahead of the rest.
+// Called by the generation thread, and by GenerateShaders for the shaders in the cache.
+//--------------------------------------------------------------------------------------
+void ShaderCache::QueueReadyShader( Shader* pShader )
+{
+    EnterCriticalSection( &m_ReadyList_CriticalSection );
+
+    if (pShader->m_bAwaitedByFirstFrame)
+    {
+        m_ReadyList.push_front( pShader );
+    }
+    else
+    {
+        m_ReadyList.push_back( pShader );
+    }
+
+    LeaveCriticalSection( &m_ReadyList_CriticalSection );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Creates the shaders handed over for lazy creation: all of them until the first frame's
+// are created, then only as many as fit in LAZY_CREATION_BUDGET_MS, so the frames that
+// render meanwhile don't stall. Returns true once none are left.
+//--------------------------------------------------------------------------------------
+bool ShaderCache::CreateReadyShaders()
+{
+    HRESULT hr = E_FAIL;
+    LARGE_INTEGER Frequency, Start, Now;
+
+    QueryPerformanceFrequency( &Frequency );
+    QueryPerformanceCounter( &Start );
+
+    EnterCriticalSection( &m_ReadyList_CriticalSection );
+
+    while (m_ReadyList.size())
+    {
+        if (m_lFirstFrameShadersLeft == 0)
+        {
+            QueryPerformanceCounter( &Now );
+            if ((double)(Now.QuadPart - Start.QuadPart) * 1000.0 / (double)Frequency.QuadPart >= LAZY_CREATION_BUDGET_MS)
+            {
+                break;
+            }
+        }
+
+        Shader* pShader = m_ReadyList.front();
+        m_ReadyList.pop_front();
+
+        // As CreateShaders, which skips cloned shaders and those unchanged
+        if (pShader->m_ppShader && (NULL == *(pShader->m_ppShader) || (!pShader->m_bShaderUpToDate)))
+        {
+            hr = CreateShader( pShader );
+            assert( S_OK == hr );
+        }
+
+        FinishFirstFrameShader( pShader );
+    }
+
+    const bool bAllCreated = m_ReadyList.empty();
+
+    LeaveCriticalSection( &m_ReadyList_CriticalSection );
+
+    return bAllCreated;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Stops the first frame waiting for a shader, once it is created or failed
+//--------------------------------------------------------------------------------------
+void ShaderCache::FinishFirstFrameShader( Shader* pShader )
+{
+    if (pShader->m_bAwaitedByFirstFrame)
+    {
+        pShader->m_bAwaitedByFirstFrame = false;
+        InterlockedDecrement( &m_lFirstFrameShadersLeft );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Prints the time from GenerateShaders until ShadersReady first returned true
+//--------------------------------------------------------------------------------------
+void ShaderCache::ReportFirstFrame()
+{
+    if (!m_bReportFirstFrame)
+    {
+        return;
+    }
+    m_bReportFirstFrame = false;
+
+    LARGE_INTEGER Frequency, Now;
+    QueryPerformanceFrequency( &Frequency );
+    QueryPerformanceCounter( &Now );
+
+    unsigned int uCreated = 0;
+    for (std::list<Shader*>::iterator it = m_ShaderList.begin(); it != m_ShaderList.end(); it++)
+    {
+        Shader* pShader = *it;
+        if (pShader->m_ppShader && (NULL != *(pShader->m_ppShader)))
+        {
+            uCreated++;
+        }
+    }
+
+    wchar_t wsFirstFrame[m_uPATHNAME_MAX_LENGTH];
+    swprintf_s( wsFirstFrame, L"\n*** Shader Cache: first frame ready after %.3f s, %u of %u shaders created %s ***\n",
+        (double)(Now.QuadPart - m_GenerationStart.QuadPart) / (double)Frequency.QuadPart, uCreated, (unsigned int)m_ShaderList.size(),
+        m_bLazyCreation ? L"lazily" : L"up front" );
+    OutputDebugStringW( wsFirstFrame );
+
+    m_Profile.Mark( L"first frame ready" );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Starts the startup profile of a generation with the shaders it may create, and a row for
+// the work on the cache files they share
+//--------------------------------------------------------------------------------------
+void ShaderCache::BeginStartupProfile()
+{
+    std::vector<std::wstring> Names;
+    Names.reserve( m_ShaderList.size() + 1 );
+
+    for (std::list<Shader*>::iterator it = m_ShaderList.begin(); it != m_ShaderList.end(); it++)
+    {
+        Shader* pShader = *it;
+        pShader->m_uProfileIndex = (unsigned int)Names.size();
+        Names.push_back( pShader->m_wsRawFileName );
+    }
+
+    m_uProfileCacheFiles = (unsigned int)Names.size();
+    Names.push_back( L"(cache files)" );
+
+    m_Profile.Begin( Names );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Ends the startup profile once the shaders of the generation are created, and writes its
+// report next to the object files
+//--------------------------------------------------------------------------------------
+void ShaderCache::ReportStartupProfile()
+{
+    if (m_Profile.IsEnded())
+    {
+        return;
+    }
+    m_Profile.End();
+
+    wchar_t wsProfilePathName[m_uPATHNAME_MAX_LENGTH];
+    CreateFullPathFromOutputFilename( wsProfilePathName, PROFILE_FILENAME );
+
+    const std::wstring Report = m_Profile.Report( PROFILE_SLOWEST_SHADERS );
+    OutputDebugStringW( L"\n*** Shader Cache: startup profile ***\n" );
+    OutputDebugStringW( Report.c_str() );
+
+    if (!m_Profile.WriteReport( wsProfilePathName, PROFILE_SLOWEST_SHADERS ))
+    {
+        wchar_t wsError[m_uPATHNAME_MAX_LENGTH * 2];
+        swprintf_s( wsError, L"\n*** Shader Cache: failed to write %s ***\n", wsProfilePathName );
+        OutputDebugStringW( wsError );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Renders the progress of the shader generation process
+//--------------------------------------------------------------------------------------
+void ShaderCache::RenderProgress( CDXUTTextHelper* g_pTxtHelper, int iFontHeight, DirectX::XMVECTOR FontColor )
+{
+    wchar_t wsOverallProgress[m_uPATHNAME_MAX_LENGTH];
+    wchar_t wsCurrentLine[m_uCOMMAND_LINE_MAX_LENGTH];
+
+    g_pTxtHelper->Begin();
+    g_pTxtHelper->SetForegroundColor( FontColor );
+    g_pTxtHelper->SetInsertionPos( 5, 5 );
+
+    int iNumLines = (int)((DXUTGetDXGIBackBufferSurfaceDesc()->Height - (iFontHeight)) * 0.99f / iFontHeight);
+
+    if (!m_bPrintedProgress && (m_lShadersToPreprocess == 0) && (m_lShadersToCompile == 0))
+    {
+        swprintf_s( wsOverallProgress, L"*** Shader Cache: Creating Shaders... ***" );
+        g_pTxtHelper->DrawTextLine( wsOverallProgress );
+
+        m_bPrintedProgress = true;
+    }
+    else
+    {
+        swprintf_s( wsOverallProgress, L"*** Shader Cache: Shaders to Preprocess = %d, Compile = %d ***", (int)m_lShadersToPreprocess, (int)m_lShadersToCompile );
+        g_pTxtHelper->DrawTextLine( wsOverallProgress );
+    }
+
+    // Where the time went so far, summed over shaders: the stages, longest first, then the slowest shaders
+    std::vector<ShaderProfileStage> Stages;
+    m_Profile.GetStages( Stages );
+
+    swprintf_s( wsCurrentLine, L"*** Shader Cache: so far" );
+    for (size_t i = 0; i < Stages.size(); i++)
+    {
+        wchar_t wsStage[m_uFILENAME_MAX_LENGTH];
+        swprintf_s( wsStage, L"%s %s %.2f s", i ? L"," : L"", GetShaderProfileStageName( Stages[i].eStage ), Stages[i].fTotalSeconds );
+        wcscat_s( wsCurrentLine, wsStage );
+    }
+    wcscat_s( wsCurrentLine, L" ***" );
+    g_pTxtHelper->DrawTextLine( wsCurrentLine );
+    int iLinesDrawn = 2;
+
+    std::vector<ShaderProfileEntry> Slowest;
+    m_Profile.GetSlowest( PROGRESS_SLOWEST_SHADERS, Slowest );
+
+    for (size_t i = 0; i < Slowest.size(); i++)
+    {
+        unsigned int uLongestStage = 0;
+        for (unsigned int s = 1; s < SHADER_PROFILE_STAGE_COUNT; s++)
+        {
+            if (Slowest[i].fStageSeconds[s] > Slowest[i].fStageSeconds[uLongestStage])
+            {
+                uLongestStage = s;
+            }
+        }
+
+        swprintf_s( wsCurrentLine, L"*** Slowest: %s %.0f ms, %s %.0f ms ***", Slowest[i].Name.c_str(), Slowest[i].fTotalSeconds * 1000.0,
+            GetShaderProfileStageName( (SHADER_PROFILE_STAGE)uLongestStage ), Slowest[i].fStageSeconds[uLongestStage] * 1000.0 );
+        g_pTxtHelper->DrawTextLine( wsCurrentLine );
+        iLinesDrawn++;
+    }
+    iNumLines -= iLinesDrawn - 1;
+
+    if (NULL != m_pProgressInfo)
+    {
+        g_pTxtHelper->SetInsertionPos( 5, 5 + iFontHeight * iLinesDrawn );
+
+        int iCounter = m_uProgressCounter;
+        int iStrings = (iCounter < iNumLines) ? (iCounter) : (iNumLines);
+
+        for (int i = iCounter - iStrings; i < iCounter; i++)
+        {
+            if (m_pProgressInfo[i].m_pShader->m_iCompileWaitCount >= 0)
+            {
+                swprintf_s( wsCurrentLine, L"%s ... [%s][%i]", m_pProgressInfo[i].m_wsFilename, m_pProgressInfo[i].m_pShader->m_wsCompileStatus, m_pProgressInfo[i].m_pShader->m_iCompileWaitCount );
+            }
+            else
+            {
+                swprintf_s( wsCurrentLine, L"%s ... [%s]", m_pProgressInfo[i].m_wsFilename, m_pProgressInfo[i].m_pShader->m_wsCompileStatus/*m_pProgressInfo[i].m_wsStatus*/ );
+            }
+            g_pTxtHelper->DrawTextLine( wsCurrentLine );
+        }
+    }
+
+    g_pTxtHelper->End();
+
+    if (ShowShaderErrors() && HasErrorsToDisplay())
+    {
+        RenderShaderErrors( g_pTxtHelper, iFontHeight, FontColor );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// boolean method to determine if the shaders are ready
+//--------------------------------------------------------------------------------------
+bool ShaderCache::ShadersReady()
+{
+    // Permutations requested while rendering don't hold up the shaders already created
+    if (m_bGeneratingPermutations && m_bShadersCreated)
+    {
+        return true;
+    }
+
+    // Lazily the first frame only waits for its own shaders
+    if (m_bCreatingLazily)
+    {
+        // Before creating, so nothing is handed over after the last of it
+        const bool bGenerated = (WaitForSingleObject( s_hDoneEvent, 0 ) == WAIT_OBJECT_0);
+        const bool bAllCreated = CreateReadyShaders();
+
+        if (m_lFirstFrameShadersLeft > 0)
+        {
+            return false;
+        }
+
+        if (bGenerated && bAllCreated && TryEnterCriticalSection( &m_CompileShaders_CriticalSection ))
+        {
+            m_bCreatingLazily = false;
+            m_bShadersCreated = true;
+            m_bPrintedProgress = true;
+            ReportStartupProfile();
+
+            if (NULL != m_pProgressInfo)
+            {
+                delete [] m_pProgressInfo;
+                m_pProgressInfo = NULL;
+                m_uProgressCounter = 0;
+            }
+
+            LeaveCriticalSection( &m_CompileShaders_CriticalSection );
+        }
+
+        ReportFirstFrame();
+        return true;
+    }
+
+    if (TryEnterCriticalSection( &m_CompileShaders_CriticalSection ))
+    {
+
+        DWORD dwRet = WaitForSingleObject( s_hDoneEvent, 0 );
+
+        if (dwRet == WAIT_OBJECT_0)
+        {
+            if (m_bPrintedProgress)
+            {
+                if (!m_bShadersCreated)
+                {
+                    CreateShaders();
+                    m_bShadersCreated = true;
+                    ReportStartupProfile();
+
+                    if (NULL != m_pProgressInfo)
+                    {
+                        delete [] m_pProgressInfo;
+                        m_pProgressInfo = NULL;
+                        m_uProgressCounter = 0;
+                    }
+                }
+
+                LeaveCriticalSection( &m_CompileShaders_CriticalSection );
+                ReportFirstFrame();
+                return true;
+            }
+        }
+        LeaveCriticalSection( &m_CompileShaders_CriticalSection );
+
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// public and private setter/getter methods:
+//--------------------------------------------------------------------------------------
+
+const bool ShaderCache::HasErrorsToDisplay( void ) const
+{
+    return m_bHasShaderErrorsToDisplay;
+}
+
+const bool ShaderCache::ShowShaderErrors( void ) const
+{
+    return (m_ErrorDisplayType == ERROR_DISPLAY_ON_SCREEN) && m_bShowShaderErrors;
+}
+
+const int ShaderCache::ShaderErrorDisplayType( void ) const
+{
+    return m_ErrorDisplayType;
+}
+
+const bool ShaderCache::RecompileTouchedShaders( void ) const
+{
+    return m_bRecompileTouchedShaders;
+}
+
+const bool ShaderCache::GenerateISAGPRPressure( void ) const
+{
+    return m_bGenerateShaderISA;
+}
+
+const bool ShaderCache::ShowISAGPRPressure( void ) const
+{
+    return m_bShowShaderISA;
+}
+
+void ShaderCache::SetRecompileTouchedShadersFlag( const bool i_bRecompileWhenTouched )
+{
+    m_bRecompileTouchedShaders = i_bRecompileWhenTouched;
+
+    if (m_bRecompileTouchedShaders)
     {
         // Create Directory Watcher
-        if ((m_waitPoolHandle == NULL) || (m_watchHandle == NULL))
+        if (!m_DirectoryWatcher.IsWatching())
         {
 #if defined(DEBUG) || defined(_DEBUG)
             const bool kb_Success = WatchDirectoryForChanges();
@@ -1225,6 +2020,33 @@ void ShaderCache::SetShowShaderISAFlag( const bool i_kbShowShaderISA )
     m_bShowShaderISA = i_kbShowShaderISA;
 }
 
+void ShaderCache::SetLazyCreationFlag( const bool i_kbLazyCreation )
+{
+    m_bLazyCreation = i_kbLazyCreation;
+}
+
+void ShaderCache::SetCompressArchiveFlag( const bool i_kbCompressArchive )
+{
+    // Not while the generation thread updates it
+    assert( WaitForSingleObject( s_hDoneEvent, 0 ) == WAIT_OBJECT_0 );
+
+    m_Archive.SetCompression( i_kbCompressArchive );
+}
+
+void ShaderCache::SetShaderPriority( const SHADER_PRIORITY i_keShaderPriority )
+{
+    m_eShaderPriority = i_keShaderPriority;
+    assert( (i_keShaderPriority >= SHADER_PRIORITY_FIRST_FRAME) && (i_keShaderPriority < SHADER_PRIORITY_MAX) );
+}
+
+void ShaderCache::SetRemoteCache( const char* i_szHost, const unsigned short i_kuPort )
+{
+    // Not while the generation thread uses it
+    assert( WaitForSingleObject( s_hDoneEvent, 0 ) == WAIT_OBJECT_0 );
+
+    m_RemoteCache.SetServer( i_szHost, i_kuPort );
+}
+
 #if AMD_SDK_INTERNAL_BUILD
 void ShaderCache::SetTargetISA( const ISA_TARGET i_eTargetISA )
 {
@@ -1243,48 +2065,17 @@ void ShaderCache::SetTargetISA( const ISA_TARGET i_eTargetISA )
 
 bool ShaderCache::WatchDirectoryForChanges( void )
 {
-    assert( !m_watchHandle );
-    assert( !m_waitPoolHandle );
-
-    if (m_waitPoolHandle)
-    {
-        UnregisterWaitEx( m_waitPoolHandle, INVALID_HANDLE_VALUE );
-        m_waitPoolHandle = NULL;
-    }
-
-    if (m_watchHandle)
-    {
-        FindCloseChangeNotification( m_watchHandle );
-        m_watchHandle = NULL;
-    }
-
-    assert( !m_watchHandle );
-    assert( !m_waitPoolHandle );
-
-    HANDLE watchHandle = FindFirstChangeNotification( m_wsShaderSourceDir, TRUE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE );
-    if (watchHandle == INVALID_HANDLE_VALUE)
-    {
-        wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
-        DWORD error = GetLastError();
-        swprintf_s( wsErrorString, L"\n\n*** Shader Cache: Error '%x' in FindFirstChangeNotification while attempting to watch directory '%s' ***\n\n", error, m_wsShaderSourceDir );
-        OutputDebugStringW( wsErrorString );
-        return false;
-    }
-
-    m_watchHandle = watchHandle;
+    assert( !m_DirectoryWatcher.IsWatching() );
 
-    HANDLE poolHandle;
-    if (!RegisterWaitForSingleObject( &poolHandle, watchHandle, onDirectoryChangeEventTriggered, (void*) this, INFINITE, WT_EXECUTEINWAITTHREAD ))
+    if (!m_DirectoryWatcher.Start( m_wsShaderSourceDir, SHADER_WATCH_DEBOUNCE_MS, onShaderFilesChanged, this ))
     {
         wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
         DWORD error = GetLastError();
-        swprintf_s( wsErrorString, L"\n\n*** Shader Cache: Error '%x' in RegisterWaitForSingleObject while attempting to watch directory '%s' ***\n\n", error, m_wsShaderSourceDir );
+        swprintf_s( wsErrorString, L"\n\n*** Shader Cache: Error '%x' in ReadDirectoryChangesW while attempting to watch directory '%s' ***\n\n", error, m_wsShaderSourceDir );
         OutputDebugStringW( wsErrorString );
         return false;
     }
 
-    m_waitPoolHandle = poolHandle;
-
     wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
     swprintf_s( wsErrorString, L"\n\n*** Shader Cache: Succesfully enabled watching of directory '%s' ***\n\n", m_wsShaderSourceDir );
     OutputDebugStringW( wsErrorString );
@@ -1293,31 +2084,42 @@ bool ShaderCache::WatchDirectoryForChanges( void )
 }
 
 
-void __stdcall ShaderCache::onDirectoryChangeEventTriggered( void* args, BOOLEAN /*timeout*/ )
+//--------------------------------------------------------------------------------------
+// Called on the watcher's thread once the source directory has been quiet for the
+// debounce window. Changes that arrive while shaders are being generated or created are
+// handed back, and delivered again after another window, rather than dropped.
+//--------------------------------------------------------------------------------------
+bool ShaderCache::onShaderFilesChanged( void* pContext, const ShaderFileChanges& Changes )
 {
-    ShaderCache* pShaderCache = reinterpret_cast<ShaderCache *>(args);
+    ShaderCache* pShaderCache = reinterpret_cast<ShaderCache *>(pContext);
 
-    if (pShaderCache->RecompileTouchedShaders())
+    if (!pShaderCache->RecompileTouchedShaders())
     {
-        // Don't recompile if shaders are currently compiling!
-        if (pShaderCache->ShadersReady())
-        {
-            pShaderCache->GenerateShaders( AMD::ShaderCache::CREATE_TYPE_COMPILE_CHANGES, true );
+        return true;
+    }
 
-            wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
-            swprintf_s( wsErrorString, L"\n\n*** ShaderCache::onDirectoryChangeEventTriggered! @ [%s] ***\n\n", pShaderCache->m_wsShaderSourceDir );
-            OutputDebugStringW( wsErrorString );
-        }
-        else
-        {
-            wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
-            swprintf_s( wsErrorString, L"\n\n*** ShaderCache::onDirectoryChangeEventTriggered! @ [%s] -- SKIPPED, because shaders are already compiling. ***\n\n", pShaderCache->m_wsShaderSourceDir );
-            OutputDebugStringW( wsErrorString );
-        }
+    // ShadersReady creates shaders, which is for the render thread only
+    const bool bBusy = (WaitForSingleObject( s_hDoneEvent, 0 ) != WAIT_OBJECT_0) || !pShaderCache->m_bShadersCreated ||
+        pShaderCache->m_bGeneratingPermutations || pShaderCache->m_bCreatingLazily;
+
+    wchar_t wsErrorString[m_uCOMMAND_LINE_MAX_LENGTH];
+
+    if (bBusy)
+    {
+        swprintf_s( wsErrorString, L"\n\n*** ShaderCache::onShaderFilesChanged! @ [%s] -- DEFERRED, because shaders are already compiling. ***\n\n", pShaderCache->m_wsShaderSourceDir );
+        OutputDebugStringW( wsErrorString );
+        return false;
     }
 
-    FindNextChangeNotification( pShaderCache->m_watchHandle );
-    FindNextChangeNotification( pShaderCache->m_watchHandle ); //twice
+    swprintf_s( wsErrorString, L"\n\n*** ShaderCache::onShaderFilesChanged! @ [%s] %u files%s ***\n\n", pShaderCache->m_wsShaderSourceDir,
+        (unsigned int)Changes.Files.size(), Changes.bOverflow ? L", too many to tell which" : L"" );
+    OutputDebugStringW( wsErrorString );
+
+    pShaderCache->m_pFileChanges = &Changes;
+    pShaderCache->GenerateShaders( AMD::ShaderCache::CREATE_TYPE_COMPILE_CHANGES, true );
+    pShaderCache->m_pFileChanges = NULL;
+
+    return true;
 }
 
 //--------------------------------------------------------------------------------------
@@ -2146,461 +2948,292 @@ bool ShaderCache::CreateHashDigest( const std::list<Shader*>& i_ShaderList )
 
 
 //--------------------------------------------------------------------------------------
-// Preprocesses shaders in the list, and generates a hash file, this is subsequently used to
-// determine if a shader has changed
+// Preprocesses, hashes and compiles the shaders in the list, as a stream of jobs. The hash
+// is subsequently used to determine if a shader has changed.
 //--------------------------------------------------------------------------------------
-void ShaderCache::PreprocessShaders()
+void ShaderCache::ProcessShaders()
 {
-    Shader* pShader = NULL;
-    unsigned int uNumWorkThreads = 0;
-
-    // Create Hash Digest File
-    bool compileStatusInitialized = false;
-    /*if( m_bCreateHashDigest )
-    {
-    compileStatusInitialized = CreateHashDigest( m_PreprocessList );
-    }*/
+    ShaderCompileScheduler Scheduler( *this, ShaderProcessPlatform::GetDefault() );
 
     // Setup Progress Info and Compile Status for all shaders
     for (std::list<Shader*>::iterator it = m_PreprocessList.begin(); it != m_PreprocessList.end(); it++)
     {
-        pShader = *it;
+        Shader* pShader = *it;
         pShader->m_wsCompileStatus = L"Preparing to pre-process . . ."; // Starting to Process the Shader
         pShader->m_bBeingProcessed = false;
-        if (!compileStatusInitialized) { m_pProgressInfo[m_uProgressCounter++] = pShader; } // Add this if Hash Digest hasn't already done it!
-    }
-
-    while (m_PreprocessList.size())
-    {
-        bool bRemove = false;
-
-        for (std::list<Shader*>::iterator it = m_PreprocessList.begin(); it != m_PreprocessList.end(); it++)
-        {
-            if (bRemove)
-            {
-                m_PreprocessList.remove( pShader );
-                bRemove = false;
-            }
+        pShader->m_iCompileWaitCount = -1;
+        m_pProgressInfo[m_uProgressCounter++] = pShader;
 
-            pShader = *it;
-
-            if (uNumWorkThreads < m_uNumCPUCoresToUse)
-            {
-                // LAYLAFIXED: If we have 0 worker threads, then it implies we can't be processing a shader (so when (uNumWorkThreads == 0 ) && (m_bBeingProcessed == true), we have a bug!)
-                assert( (pShader->m_bBeingProcessed == false) || (uNumWorkThreads > 0) );
-                if ((pShader->m_bBeingProcessed == false) /*|| (uNumWorkThreads == 0)*/)
-                {
-                    bRemove = true;
-                    pShader->m_wsCompileStatus = L"Finding Shader"; // Starting to PreProcess the Shader
-                    if (CheckShaderFile( pShader ))
-                    {
-                        PreprocessShader( pShader );
-                        pShader->m_wsCompileStatus = L"Preprocessing"; // Starting to PreProcess the Shader
-                        //pShader->m_wsPreprocessFile_with_ISA
-
-                        pShader->m_bBeingProcessed = true;
+        // Lazily the first frame's shaders get the compilers first
+        Scheduler.AddJob( pShader, SHADER_JOB_PREPROCESS, m_bCreatingLazily ? (unsigned int)pShader->m_ePriority : 0 );
+    }
+    m_PreprocessList.clear();
 
-                        m_HashList.push_back( pShader );
+    EnterCriticalSection( &m_CompileShaders_CriticalSection );
 
-                        uNumWorkThreads++;
-                    }
-                    else
-                    {
-                        pShader->m_wsCompileStatus = L"ERROR: Shader Not Found!";
-                        pShader->m_bBeingProcessed = false;
-                        --uNumWorkThreads;
-                        continue;
-                    }
-                }
-            }
-            else
-            {
-                // else break out of the for loop, and let this batch of work finish
-                break;
-            }
+    m_RemoteCache.ResetStats();
 
-            Sleep( 1 );
-        }
+    Scheduler.Run( m_uNumCPUCoresToUse, &m_bAbort );
+    m_SchedulerStats = Scheduler.GetStats();
 
-        if (bRemove)
-        {
-            m_PreprocessList.remove( pShader );
-            bRemove = false;
-        }
+    m_lShadersToPreprocess = 0;
+    m_lShadersToCompile = 0;
 
-        if (m_bAbort)
-        {
-            break;
-        }
+    // Shaders created lazily meanwhile read from the archive this maps again
+    {
+        SHADER_PROFILE_BLOCK( m_uProfileCacheFiles, SHADER_PROFILE_DISK, L"ShaderCache: update archive" )
 
-        // Wait for current batch of preprocessing to finish
-        {
-            HANDLE handles[MAXIMUM_WAIT_OBJECTS];
-            DWORD nHandleCount = 0;
-            for (std::list<Shader*>::iterator it = m_HashList.begin(); it != m_HashList.end(); it++)
-            {
-                pShader = *it;
-                if (nHandleCount < MAXIMUM_WAIT_OBJECTS)
-                {
-                    handles[nHandleCount++] = pShader->m_hCompileProcessHandle;
-                }
-                if (nHandleCount == MAXIMUM_WAIT_OBJECTS)
-                {
-                    WaitForMultipleObjects( nHandleCount, handles, TRUE, INFINITE );
-                    nHandleCount = 0;
-                }
-            }
-            if (nHandleCount > 0)
-            {
-                WaitForMultipleObjects( nHandleCount, handles, TRUE, INFINITE );
-            }
-        }
+        EnterCriticalSection( &m_ReadyList_CriticalSection );
+        UpdateArchive();
+        LeaveCriticalSection( &m_ReadyList_CriticalSection );
 
-        // Close handles for current batch of preprocessing that is now finished
+        if (m_CreateType != CREATE_TYPE_USE_CACHED)
         {
-            for (std::list<Shader*>::iterator it = m_HashList.begin(); it != m_HashList.end(); it++)
-            {
-                pShader = *it;
-                CloseHandle( pShader->m_hCompileProcessHandle );
-                CloseHandle( pShader->m_hCompileThreadHandle );
-                pShader->m_hCompileProcessHandle = NULL;
-                pShader->m_hCompileThreadHandle = NULL;
-            }
+            SaveDependencies();
         }
+    }
 
-        // Hash Preprocessed Shaders
-        while (m_HashList.size() && (!m_bAbort))
-        {
-            bRemove = false;
-
-            for (std::list<Shader*>::iterator it = m_HashList.begin(); it != m_HashList.end(); it++)
-            {
-                if (bRemove)
-                {
-                    pShader->m_iCompileWaitCount = -1;
-                    m_HashList.remove( pShader );
-                    bRemove = false;
-                }
-
-                pShader = *it;
-
-                assert( pShader->m_bBeingProcessed == true );
-                pShader->m_wsCompileStatus = L"Waiting for Preprocessor";
-                pShader->m_iCompileWaitCount++;
-
-                assert( pShader->m_hCompileProcessHandle == NULL );
-
-                /*pShader->m_iCompileWaitCount = 0;
-
-                bool bKeepLooping = true;
-                while( bKeepLooping )
-                {
-                unsigned long exitCode = 0;
-                int rValue = GetExitCodeProcess(pShader->m_hCompileProcessHandle, &exitCode );
-                bKeepLooping = ( (rValue != 0) && (exitCode == STILL_ACTIVE) );
-                pShader->m_iCompileWaitCount++;
-                }*/
-
-                if ((pShader->m_bBeingProcessed == true) && CreateHashFromPreprocessFile( pShader ))
-                {
-                    // Set Status to COMPARING HASH
-                    pShader->m_wsCompileStatus = L"Comparing Hash";
-                    //m_pProgressInfo[m_uProgressCounter++] = pShader;
-                    //m_pProgressInfo[m_uProgressCounter++].m_wsFilename = pShader->m_wsPreprocessFile_with_ISA;
-
-                    if (!CompareHash( pShader ))
-                    {
-                        DeleteObjectFile( pShader );
-
-                        WriteHashFile( pShader );
-
-                        m_CompileList.push_back( pShader );
-                    }
-                    else
-                    {
-                        if (CheckObjectFile( pShader ))
-                        {
-                            m_CreateList.push_back( pShader );
-                        }
-                        else
-                        {
-                            m_CompileList.push_back( pShader );
-                        }
-                    }
-
-                    // Set Status to FINISHED
-                    pShader->m_wsCompileStatus = L"Finished Preprocessing";
-                    //m_pProgressInfo[m_uProgressCounter++] = pShader;
-                    //m_pProgressInfo[m_uProgressCounter++].m_wsFilename = pShader->m_wsPreprocessFile_with_ISA;
-
-                    pShader->m_bBeingProcessed = false;
+    GenerateShaderGPRUsageFromISAForAllShaders(); // Generate GPR Usage for any shaders that still need updating
 
-                    if (uNumWorkThreads > 0)
-                    {
-                        uNumWorkThreads--;
-                    }
+    LeaveCriticalSection( &m_CompileShaders_CriticalSection );
 
-                    bRemove = true;
-                }
-                else
-                {
-                    Sleep( 1 );
-                }
-                /*else if( !bRemove )
-                {
-                // The Preprocess File Doesn't Exist; try again?
-                pShader->m_bBeingProcessed = false;
+    wchar_t wsStats[m_uPATHNAME_MAX_LENGTH];
+    swprintf_s( wsStats, L"\n*** Shader Cache: %u shaders in %.2f s, %u preprocessed, %u compiled, %u failed, first ready after %.2f s, up to %u compilers ***\n",
+        m_SchedulerStats.uJobs, m_SchedulerStats.fTotalSeconds, m_SchedulerStats.uStageRuns[SHADER_JOB_PREPROCESS], m_SchedulerStats.uStageRuns[SHADER_JOB_COMPILE],
+        m_SchedulerStats.uFailed, m_SchedulerStats.fFirstDoneSeconds, m_SchedulerStats.uMaxRunning );
+    OutputDebugStringW( wsStats );
 
-                if ( uNumWorkThreads > 0 )
-                uNumWorkThreads--;
+    const ShaderRemoteCacheStats& RemoteStats = m_RemoteCache.GetStats();
+    if (RemoteStats.uHits + RemoteStats.uMisses + RemoteStats.uErrors)
+    {
+        swprintf_s( wsStats, L"\n*** Shader Cache: cache server %u hits, %u misses, %u stored, %u errors, %.1f KB received, %.2f s waiting%s ***\n",
+            RemoteStats.uHits, RemoteStats.uMisses, RemoteStats.uStores, RemoteStats.uErrors, RemoteStats.uBytesReceived / 1024.0, RemoteStats.fSeconds,
+            m_RemoteCache.IsEnabled() ? L"" : L", unreachable" );
+        OutputDebugStringW( wsStats );
+    }
 
-                m_PreprocessList.push_back( pShader );
+    if (m_bCreateHashDigest && !m_bGeneratingPermutations)
+    {
+        CreateHashDigest( m_CreateList );
+    }
+}
 
-                // SET STATUS TO RETRY!
-                pShader->m_wsCompileStatus = L"Preprocessing: RETRY";
 
-                bRemove = true;
-                //m_pProgressInfo[m_uProgressCounter++] = pShader;
-                //m_pProgressInfo[m_uProgressCounter++].m_wsFilename = pShader->m_wsPreprocessFile_with_ISA;
-                }*/
-            }
+//--------------------------------------------------------------------------------------
+// Starts a stage of a shader: runs fxc to preprocess or compile it. Hashing and handing the
+// shader over for creation need no process, they run in FinishStage.
+//--------------------------------------------------------------------------------------
+bool ShaderCache::StartStage( void* pJob, SHADER_JOB_STAGE eStage, ShaderProcess& Process )
+{
+    Shader* pShader = (Shader*)pJob;
+    bool bStarted = false;
 
-            if (bRemove)
-            {
-                m_HashList.remove( pShader );
-            }
+    switch (eStage)
+    {
+    case SHADER_JOB_PREPROCESS:
+        {
+            SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_SPAWN, L"ShaderCache: start fxc" )
 
-            if (m_bAbort)
+            pShader->m_wsCompileStatus = L"Finding Shader";
+            if (!CheckShaderFile( pShader ))
             {
-                break;
+                pShader->m_wsCompileStatus = L"ERROR: Shader Not Found!";
+                return false;
             }
+            pShader->m_bBeingProcessed = true;
+            pShader->m_wsCompileStatus = L"Preprocessing"; // Starting to PreProcess the Shader
+            bStarted = PreprocessShader( pShader, Process ) != FALSE;
+        }
+        break;
 
-            Sleep( 1 );
+    case SHADER_JOB_COMPILE:
+        {
+            SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_SPAWN, L"ShaderCache: start fxc" )
 
+            pShader->m_wsCompileStatus = L"Compiling Shader";
+            bStarted = CompileShader( pShader, Process ) != FALSE;
         }
+        break;
 
+    default:
+        return true;
     }
 
+    // Until FinishStage, the stage is timed as fxc preprocessing or compiling
+    pShader->m_uProcessStartTime = ShaderStartupProfile::GetTime();
+    return bStarted;
 }
 
-// a binary predicate implemented as a function:
-bool shader_duplicate_ptr( AMD::ShaderCache::Shader* pFirst, AMD::ShaderCache::Shader* pSecond )
-{
-    return (pFirst == pSecond);
-}
 
 //--------------------------------------------------------------------------------------
-// Compiles the shaders in the list
+// Checks the outcome of a stage of a shader, and picks its next stage
 //--------------------------------------------------------------------------------------
-void ShaderCache::CompileShaders()
+SHADER_JOB_STAGE ShaderCache::FinishStage( void* pJob, SHADER_JOB_STAGE eStage, bool bStarted )
 {
-    Shader* pShader = NULL;
-    unsigned int uNumWorkThreads = 0;
-
-    EnterCriticalSection( &m_CompileShaders_CriticalSection );
+    Shader* pShader = (Shader*)pJob;
 
-    while (m_CompileList.size())
+    switch (eStage)
     {
-        bool bRemove = false;
-
-        Sleep( 1 );
-
-        for (std::list<Shader*>::iterator it = m_CompileList.begin(); it != m_CompileList.end(); it++)
+    case SHADER_JOB_PREPROCESS:
+        InterlockedDecrement( &m_lShadersToPreprocess );
+        if (bStarted)
         {
-
-            Sleep( 1 );
-            if (bRemove)
-            {
-                m_CompileList.remove( pShader );
-                bRemove = false;
-            }
-
-            pShader = *it;
-
-            pShader->m_wsCompileStatus = L"Waiting to Compile...";
-
-            if (uNumWorkThreads < m_uNumCPUCoresToUse)
-            {
-                if (pShader->m_bBeingProcessed == false)
-                {
-                    bRemove = true;
-                    pShader->m_wsCompileStatus = L"Compiling Shader";
-                    CompileShader( pShader );
-
-                    pShader->m_bBeingProcessed = true;
-
-                    m_CompileCheckList.push_back( pShader );
-
-                    uNumWorkThreads++;
-                }
-            }
-            else
-            {
-                // else break out of the for loop, and let this batch of work finish
-                break;
-            }
+            m_Profile.AddTime( pShader->m_uProfileIndex, SHADER_PROFILE_PREPROCESS, pShader->m_uProcessStartTime );
         }
-
-        if (bRemove)
+        else
         {
-            m_CompileList.remove( pShader );
-            bRemove = false;
+            pShader->m_bBeingProcessed = false;
+            FinishFirstFrameShader( pShader );
+            return SHADER_JOB_FAILED;
         }
+        return SHADER_JOB_HASH;
 
-        if (m_bAbort)
+    case SHADER_JOB_HASH:
         {
-            break;
-        }
+            SHADER_JOB_STAGE eNextStage = SHADER_JOB_COMPILE;
+            pShader->m_uRemoteKey = 0;
 
-        // Wait for current batch of compiling to finish
-        {
-            HANDLE handles[MAXIMUM_WAIT_OBJECTS];
-            DWORD nHandleCount = 0;
-            for (std::list<Shader*>::iterator it = m_CompileCheckList.begin(); it != m_CompileCheckList.end(); it++)
-            {
-                pShader = *it;
-                if (nHandleCount < MAXIMUM_WAIT_OBJECTS)
-                {
-                    handles[nHandleCount++] = pShader->m_hCompileProcessHandle;
-                }
-                if (nHandleCount == MAXIMUM_WAIT_OBJECTS)
-                {
-                    WaitForMultipleObjects( nHandleCount, handles, TRUE, INFINITE );
-                    nHandleCount = 0;
-                }
-            }
-            if (nHandleCount > 0)
+            bool bHashed = false;
             {
-                WaitForMultipleObjects( nHandleCount, handles, TRUE, INFINITE );
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_HASH, L"ShaderCache: hash shader" )
+                bHashed = CreateHashFromPreprocessFile( pShader ) != FALSE;
             }
-        }
 
-        // Close handles for current batch of compiling that is now finished
-        {
-            for (std::list<Shader*>::iterator it = m_CompileCheckList.begin(); it != m_CompileCheckList.end(); it++)
+            // Without a preprocess file, e.g. for a missing include, let the compiler report the error
+            if (bHashed)
             {
-                pShader = *it;
-                CloseHandle( pShader->m_hCompileProcessHandle );
-                CloseHandle( pShader->m_hCompileThreadHandle );
-                pShader->m_hCompileProcessHandle = NULL;
-                pShader->m_hCompileThreadHandle = NULL;
-            }
-        }
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_DISK, L"ShaderCache: look up hash" )
 
-        // Check Compiled Shaders
-        while (m_CompileCheckList.size() && (!m_bAbort))
-        {
-            bRemove = false;
+                // Set Status to COMPARING HASH
+                pShader->m_wsCompileStatus = L"Comparing Hash";
 
-            for (std::list<Shader*>::iterator it = m_CompileCheckList.begin(); it != m_CompileCheckList.end(); it++)
-            {
-                if (bRemove)
+                if (!CompareHash( pShader ))
                 {
-                    m_CompileCheckList.remove( pShader );
-                    bRemove = false;
-                }
+                    DeleteObjectFile( pShader );
 
-                pShader = *it;
-
-                bool bHasObjectFile = false;
-
-                //pShader->m_wsCompileStatus = L"Waiting for Object File . . .";
-                if (CheckObjectFile( pShader ))
+                    WriteHashFile( pShader );
+                }
+                else if (FindArchiveEntry( pShader ) || CheckObjectFile( pShader ))
                 {
-                    pShader->m_wsCompileStatus = L"Found Object File";
-                    //m_pProgressInfo[m_uProgressCounter++].m_wsFilename = pShader->m_wsObjectFile_with_ISA;
+                    eNextStage = SHADER_JOB_CREATE;
+                }
 
-                    m_CreateList.push_back( pShader );
+                // Compiled already, by another machine sharing the cache server
+                if ((eNextStage == SHADER_JOB_COMPILE) && FetchRemoteShader( pShader ))
+                {
+                    pShader->m_bShaderUpToDate = false;
+                    eNextStage = SHADER_JOB_CREATE;
+                }
+            }
 
-                    bHasObjectFile = true;
+            if (eNextStage == SHADER_JOB_COMPILE)
+            {
+                InterlockedIncrement( &m_lShadersToCompile );
+            }
 
-                    pShader->m_bBeingProcessed = false;
+            // Set Status to FINISHED
+            pShader->m_wsCompileStatus = L"Finished Preprocessing";
+            return eNextStage;
+        }
 
-                    if (uNumWorkThreads > 0)
-                    {
-                        uNumWorkThreads--;
-                    }
+    case SHADER_JOB_COMPILE:
+        {
+            InterlockedDecrement( &m_lShadersToCompile );
 
-                    bRemove = true;
-                }
+            bool bHasObjectFile = false;
+            bool bShaderHasCompilerError = false;
+            if (bStarted)
+            {
+                m_Profile.AddTime( pShader->m_uProfileIndex, SHADER_PROFILE_COMPILE, pShader->m_uProcessStartTime );
 
-                //pShader->m_wsCompileStatus = L"Checking For Errors . . .";
-                bool bShaderHasCompilerError = false;
-                if ( /*bHasObjectFile && */CheckErrorFile( pShader, bShaderHasCompilerError ))
-                {
-                    bRemove |= bShaderHasCompilerError;
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_DISK, L"ShaderCache: check object file" )
+                bHasObjectFile = CheckObjectFile( pShader ) != FALSE;
+                CheckErrorFile( pShader, bShaderHasCompilerError );
+            }
 
-                    if (bHasObjectFile && !bShaderHasCompilerError)
-                    {
-                        if (m_bGenerateShaderISA)
-                        {
-                            pShader->m_wsCompileStatus = L"Generating ISA";
-                            pShader->m_bShaderUpToDate = false; // Shader Has Been Updated
-                            if (GenerateShaderISA( pShader, false ))
-                            {
-                                pShader->m_wsCompileStatus = L"Done!";
-                            }
-                        }
-                        else
-                        {
-                            pShader->m_wsCompileStatus = L"Done!";
-                            pShader->m_bShaderUpToDate = false; // Shader Has Been Updated
-                        }
-                    }
-                    else if (bShaderHasCompilerError)
-                    {
-                        pShader->m_bShaderUpToDate = true;
-                        pShader->m_bGPRsUpToDate = true;
-                        m_ErrorList.insert( pShader );
-                        pShader->m_wsCompileStatus = L"Compiler Error!";
-                        if (uNumWorkThreads > 0)
-                        {
-                            uNumWorkThreads--;
-                        }
-                    }
-                    else
-                    {
-                        pShader->m_wsCompileStatus = L"Still Compiling . . .";
-                    }
-                }
-                else
-                {
-                    Sleep( 1 );
-                }
+            if (!bHasObjectFile || bShaderHasCompilerError)
+            {
+                pShader->m_bShaderUpToDate = true;
+                pShader->m_bGPRsUpToDate = true;
+                pShader->m_bBeingProcessed = false;
+                m_ErrorList.insert( pShader );
+                pShader->m_wsCompileStatus = L"Compiler Error!";
+                FinishFirstFrameShader( pShader );
+                return SHADER_JOB_FAILED;
             }
 
-            if (bRemove)
+            pShader->m_bShaderUpToDate = false; // Shader Has Been Updated
             {
-                m_CompileCheckList.remove( pShader );
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_DISK, L"ShaderCache: store shader" )
+                StoreRemoteShader( pShader );
             }
+            if (m_bGenerateShaderISA)
+            {
+                SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_COMPILE, L"ShaderCache: generate ISA" )
 
-            if (m_bAbort)
+                pShader->m_wsCompileStatus = L"Generating ISA";
+                if (GenerateShaderISA( pShader, false ))
+                {
+                    pShader->m_wsCompileStatus = L"Done!";
+                }
+            }
+            else
             {
-                break;
+                pShader->m_wsCompileStatus = L"Done!";
             }
+            return SHADER_JOB_CREATE;
+        }
 
-            Sleep( 1 );
+    case SHADER_JOB_CREATE:
+        // Built from the sources as they were when generation started
+        if (m_CreateType != CREATE_TYPE_USE_CACHED)
+        {
+            m_Dependencies.SetTarget( HashToKey( pShader->m_pFilenameHash ), pShader->m_uDependencyHash );
+        }
 
+        // Created on the device thread, once all shaders are ready, or lazily as soon as this one is
+        m_CreateList.push_back( pShader );
+        if (m_bCreatingLazily)
+        {
+            QueueReadyShader( pShader );
         }
+        pShader->m_bBeingProcessed = false;
+        return SHADER_JOB_DONE;
+
+    default:
+        return SHADER_JOB_FAILED;
     }
+}
 
-    GenerateShaderGPRUsageFromISAForAllShaders(); // Generate GPR Usage for any shaders that still need updating
+// a binary predicate implemented as a function:
+bool shader_duplicate_ptr( AMD::ShaderCache::Shader* pFirst, AMD::ShaderCache::Shader* pSecond )
+{
+    return (pFirst == pSecond);
+}
 
-    LeaveCriticalSection( &m_CompileShaders_CriticalSection );
 
-    if (m_bCreateHashDigest)
-    {
-        CreateHashDigest( m_CreateList );
-    }
+// The shaders CreateShaders creates on each core
+struct CreateShadersJob
+{
+    AMD::ShaderCache*           pShaderCache;
+    AMD::ShaderCache::Shader**  ppShaders;
+};
+
+
+// Hands the TimerEx recording buffer of a thread of CreateShaders to the next one
+static void releaseTimerThread( void* )
+{
+    TIMER_ReleaseThread()
 }
 
 
 //--------------------------------------------------------------------------------------
-// Creates the shaders in the list
+// Creates the shaders in the list. Reading them from the archive, decompressing them and
+// creating them runs on every core, as D3D11 devices create shaders from any thread.
 //--------------------------------------------------------------------------------------
 HRESULT ShaderCache::CreateShaders()
 {
-    HRESULT hr = E_FAIL;
+    std::vector<Shader*> Shaders;
     Shader* pShader = NULL;
 
     for (std::list<Shader*>::iterator it = m_CreateList.begin(); it != m_CreateList.end(); it++)
@@ -2612,15 +3245,53 @@ HRESULT ShaderCache::CreateShaders()
             if (NULL == *(pShader->m_ppShader) || (!pShader->m_bShaderUpToDate))
             {
                 assert( (!pShader->m_bShaderUpToDate) || (NULL != *(pShader->m_ppShader)) );
-                hr = CreateShader( pShader );
-                assert( S_OK == hr );
+                Shaders.push_back( pShader );
             }
         } // Else, this is a cloned shader, and we won't be using it for rendering, so don't initialize it.
     }
 
+    // No shader may be created twice at once
+    std::sort( Shaders.begin(), Shaders.end() );
+    Shaders.erase( std::unique( Shaders.begin(), Shaders.end() ), Shaders.end() );
+
+    if (Shaders.empty())
+    {
+        return S_OK;
+    }
+
+    SHADER_TIMER_BLOCK( L"ShaderCache: create shaders" )
+
+    LARGE_INTEGER Frequency, Start, Now;
+    QueryPerformanceFrequency( &Frequency );
+    QueryPerformanceCounter( &Start );
+
+    CreateShadersJob Job = { this, &Shaders[0] };
+    ShaderParallelFor( Shaders.size(), m_uNumCPUCores, createShaderJob, &Job, releaseTimerThread );
+
+    QueryPerformanceCounter( &Now );
+
+    wchar_t wsStats[m_uPATHNAME_MAX_LENGTH];
+    swprintf_s( wsStats, L"\n*** Shader Cache: created %u shaders in %.3f s on up to %u threads, archive of %.1f KB holds %.1f KB of shaders ***\n",
+        (unsigned int)Shaders.size(), (double)(Now.QuadPart - Start.QuadPart) / (double)Frequency.QuadPart, m_uNumCPUCores,
+        m_Archive.GetFileSize() / 1024.0, m_Archive.GetBlobBytes() / 1024.0 );
+    OutputDebugStringW( wsStats );
+
     return S_OK;
 }
 
+
+//--------------------------------------------------------------------------------------
+// Creates one of the shaders of CreateShaders, on one of its threads
+//--------------------------------------------------------------------------------------
+void ShaderCache::createShaderJob( void* pContext, size_t uIndex )
+{
+    const CreateShadersJob* pJob = (const CreateShadersJob*)pContext;
+
+    HRESULT hr = pJob->pShaderCache->CreateShader( pJob->ppShaders[uIndex] );
+    assert( S_OK == hr );
+    (void)hr;
+}
+
 //--------------------------------------------------------------------------------------
 // Invalidates the shaders in the list
 //--------------------------------------------------------------------------------------
@@ -2637,74 +3308,195 @@ void ShaderCache::InvalidateShaders( void )
 }
 
 //--------------------------------------------------------------------------------------
-// The preprocess file generated by fxc can have the full path to the source file in it.
-// Strip that out before you create the hash.
+// Looks a shader up in the archive. Once the shader has been hashed, only an entry compiled
+// from the same preprocessed source is returned.
 //--------------------------------------------------------------------------------------
-void ShaderCache::StripPathInfoFromPreprocessFile( Shader* pShader, FILE* pFile, char* pFileBufDst, int iFileSize )
+const ShaderArchiveEntry* ShaderCache::FindArchiveEntry( const Shader* pShader ) const
 {
-    // clear out the destination buffer
-    memset( pFileBufDst, '\0', iFileSize );
+    const ShaderArchiveEntry* pEntry = m_Archive.Find( HashToKey( pShader->m_pFilenameHash ) );
 
-    // make a plain old char version of our source filename
-    size_t i;
-    char szSourceFileWithBackSlashes[m_uFILENAME_MAX_LENGTH];
-    memset( szSourceFileWithBackSlashes, '\0', sizeof( char[m_uFILENAME_MAX_LENGTH] ) );
-    wcstombs_s( &i, szSourceFileWithBackSlashes, m_uFILENAME_MAX_LENGTH, pShader->m_wsSourceFile, m_uFILENAME_MAX_LENGTH );
+    if (pEntry && pShader->m_pHash && (pEntry->uContentHash != HashToKey( pShader->m_pHash )))
+    {
+        return NULL;
+    }
+
+    return pEntry;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adds the object files of hashed shaders that the archive doesn't hold yet, so the next
+// start from the cache only opens the archive
+//--------------------------------------------------------------------------------------
+void ShaderCache::UpdateArchive()
+{
+    std::list< std::vector<char> > ObjectFiles;
+    std::vector<ShaderArchiveBlob> Blobs;
+
+    for (std::list<Shader*>::iterator it = m_CreateList.begin(); it != m_CreateList.end(); it++)
+    {
+        Shader* pShader = *it;
+
+        // Cloned shaders aren't created, and shaders that weren't hashed are already in it
+        if (!pShader->m_ppShader || !pShader->m_pHash || FindArchiveEntry( pShader ))
+        {
+            continue;
+        }
+
+        FILE* pFile = NULL;
+        wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
+
+        CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsObjectFile );
+
+        _wfopen_s( &pFile, wsShaderPathName, L"rb" );
+
+        if (pFile)
+        {
+            fseek( pFile, 0, SEEK_END );
+            int iFileSize = ftell( pFile );
+            rewind( pFile );
+
+            ObjectFiles.push_back( std::vector<char>( iFileSize + 1 ) );
+            std::vector<char>& Data = ObjectFiles.back();
+            const size_t uRead = fread( &Data[0], 1, iFileSize, pFile );
+            fclose( pFile );
+
+            if (uRead > 0)
+            {
+                ShaderArchiveBlob Blob = { HashToKey( pShader->m_pFilenameHash ), HashToKey( pShader->m_pHash ), &Data[0], uRead };
+                Blobs.push_back( Blob );
+            }
+        }
+    }
 
-    // fxc accepts both forward and back slashes, so convert any forward
-    // slashes to back slashes for consistency
-    char* pForwardSlash = strchr( szSourceFileWithBackSlashes, L'/' );
-    while (pForwardSlash)
+    if (Blobs.size())
     {
-        *pForwardSlash = '\\';
-        pForwardSlash = strchr( szSourceFileWithBackSlashes, L'/' );
+        const bool bUpdated = m_Archive.Update( &Blobs[0], Blobs.size() );
+        assert( bUpdated );
+        (void)bUpdated;
     }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Hash of the shader's source file, everything it includes, and its command line, which
+// holds the target, entry point, macros and compiler flags
+//--------------------------------------------------------------------------------------
+unsigned long long ShaderCache::GetDependencyHash( const Shader* pShader )
+{
+    wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
+
+    CreateFullPathFromInputFilename( wsShaderPathName, pShader->m_wsSourceFile );
+
+    const unsigned long long uSeed = ShaderHasher::Hash( pShader->m_wsCommandLine, wcslen( pShader->m_wsCommandLine ) * sizeof( wchar_t ) );
+    return m_Dependencies.GetDependencyHash( wsShaderPathName, uSeed );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writes the dependency graph to disk, for the next start to check shaders against
+//--------------------------------------------------------------------------------------
+void ShaderCache::SaveDependencies()
+{
+    wchar_t wsDependenciesPathName[m_uPATHNAME_MAX_LENGTH];
+
+    CreateFullPathFromOutputFilename( wsDependenciesPathName, DEPENDENCIES_FILENAME );
+
+    const bool bSaved = m_Dependencies.Save( wsDependenciesPathName );
+    assert( bSaved );
+    (void)bSaved;
+}
 
-    // now that we know we have back slashes (if we have slashes at all),
-    // find the last one to strip off any path info
-    char* pFileName = strrchr( szSourceFileWithBackSlashes, '\\' );
 
-    // support the case where the source filename doesn't contain any path info
-    // (this would happen if shaders were in the project working directory instead of
-    // a subfolder)
-    if (!pFileName)
+//--------------------------------------------------------------------------------------
+// Key of a shader on the cache server: of what decides the compiler's output, which is the
+// preprocessed source, the target, entry point and flags, and the compiler itself
+//--------------------------------------------------------------------------------------
+unsigned long long ShaderCache::GetRemoteKey( const Shader* pShader )
+{
+    // Machines with different SDKs don't share what their compilers make
+    if (0 == m_uCompilerHash)
     {
-        pFileName = szSourceFileWithBackSlashes;
+        MappedFile Compiler;
+        m_uCompilerHash = Compiler.Open( m_wsFxcExePath ) ? ShaderHasher::Hash( Compiler.GetData(), Compiler.GetSize() ) :
+            ShaderHasher::Hash( m_wsFxcExePath, wcslen( m_wsFxcExePath ) * sizeof( wchar_t ) );
     }
-    else
+
+    ShaderHasher Hasher( m_uCompilerHash );
+    Hasher.Update( pShader->m_pHash, pShader->m_uHashLength );
+    Hasher.Update( &pShader->m_uCompileOptionsHash, sizeof( pShader->m_uCompileOptionsHash ) );
+
+    // 0 stands for not asked
+    const unsigned long long uKey = Hasher.Digest();
+    return uKey ? uKey : 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Asks the cache server for a shader that would otherwise be compiled, and writes it as the
+// shader's object file. False on a miss, or without a server.
+//--------------------------------------------------------------------------------------
+bool ShaderCache::FetchRemoteShader( Shader* pShader )
+{
+    if (!m_RemoteCache.IsEnabled())
     {
-        // if there was a slash, you are now pointing to it,
-        // so go one past it to get just the filename
-        pFileName++;
+        return false;
     }
 
+    pShader->m_uRemoteKey = GetRemoteKey( pShader );
 
-    char szLine[m_uCOMMAND_LINE_MAX_LENGTH];
-    char* pLine = szLine;
-    char szFxcLineDirective[32];
-    strcpy_s( szFxcLineDirective, 32, "#line" );
+    std::vector<char> Blob;
+    if (!m_RemoteCache.Get( pShader->m_uRemoteKey, Blob ) || Blob.empty())
+    {
+        return false;
+    }
 
-    while (fgets( pLine, m_uCOMMAND_LINE_MAX_LENGTH, pFile ))
+    FILE* pFile = NULL;
+    wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
+
+    CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsObjectFile );
+
+    _wfopen_s( &pFile, wsShaderPathName, L"wb" );
+
+    if (!pFile)
     {
-        // check if this is a line directive
-        char* pStartOfFxcLineDirective = strstr( pLine, szFxcLineDirective );
-        if (pStartOfFxcLineDirective)
-        {
-            // if it is, then check if the filename appears after #line
-            if (!strstr( pStartOfFxcLineDirective, pFileName ))
-            {
-                // if it is a line directive, but not one containing the filename,
-                // copy it over to the destination buffer
-                strcat_s( pFileBufDst, iFileSize, pLine );
-            }
-            // else, assume it is one of the problematic #line directives
-            // that contains full path info, and skip it
-        }
-        else
-        {
-            // else, not a line directive, so copy it over to the destination buffer
-            strcat_s( pFileBufDst, iFileSize, pLine );
-        }
+        return false;
+    }
+
+    const bool bWritten = (fwrite( &Blob[0], 1, Blob.size(), pFile ) == Blob.size());
+    fclose( pFile );
+
+    if (!bWritten)
+    {
+        DeleteObjectFile( pShader );
+        return false;
+    }
+
+    // The errors of an earlier compile no longer apply
+    DeleteErrorFile( pShader );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Hands a shader compiled here to the cache server
+//--------------------------------------------------------------------------------------
+void ShaderCache::StoreRemoteShader( const Shader* pShader )
+{
+    if (!m_RemoteCache.IsEnabled() || (0 == pShader->m_uRemoteKey))
+    {
+        return;
+    }
+
+    wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
+
+    CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsObjectFile );
+
+    MappedFile File;
+
+    if (File.Open( wsShaderPathName ) && File.GetSize())
+    {
+        m_RemoteCache.Put( pShader->m_uRemoteKey, File.GetData(), File.GetSize() );
     }
 }
 
@@ -2714,7 +3506,6 @@ void ShaderCache::StripPathInfoFromPreprocessFile( Shader* pShader, FILE* pFile,
 //--------------------------------------------------------------------------------------
 BOOL ShaderCache::CreateHashFromPreprocessFile( Shader* pShader )
 {
-    FILE* pFile = NULL;
     wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
 
     CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsPreprocessFile );
@@ -2729,20 +3520,10 @@ BOOL ShaderCache::CreateHashFromPreprocessFile( Shader* pShader )
         DebugBreak();
     }
 
-    _wfopen_s( &pFile, wsShaderPathName, L"rt" );
+    MappedFile File;
 
-    if (pFile)
+    if (File.Open( wsShaderPathName ))
     {
-        fseek( pFile, 0, SEEK_END );
-        int iFileSize = ftell( pFile );
-        rewind( pFile );
-        char* pFileBuf = new char[iFileSize];
-
-        // Strip path info from the preprocessed file, as otherwise this causes problems
-        // if you move a project on disk. Without this, it triggers a full rebuild of the
-        // shader cache, purely because the path has changed
-        StripPathInfoFromPreprocessFile( pShader, pFile, pFileBuf, iFileSize );
-
         if (NULL != pShader->m_pHash)
         {
             free( pShader->m_pHash );
@@ -2750,10 +3531,15 @@ BOOL ShaderCache::CreateHashFromPreprocessFile( Shader* pShader )
             pShader->m_uHashLength = 0;
         }
 
-        CreateHash( pFileBuf, iFileSize, &pShader->m_pHash, &pShader->m_uHashLength );
+        // Leave the directories of #line directives out of the hash, as otherwise moving
+        // the project on disk triggers a full rebuild of the shader cache, purely because
+        // the path has changed
+        ShaderHasher Hasher;
+        HashPreprocessedSource( File.GetData(), File.GetSize(), Hasher );
 
-        delete [] pFileBuf;
-        fclose( pFile );
+        pShader->m_pHash = (BYTE*)malloc( SHADER_HASH_SIZE );
+        pShader->m_uHashLength = SHADER_HASH_SIZE;
+        Hasher.Digest( *reinterpret_cast<unsigned char (*)[SHADER_HASH_SIZE]>(pShader->m_pHash) );
 
         return TRUE;
     }
@@ -2780,9 +3566,9 @@ void ShaderCache::Shader::SetupHashedFilename( void )
     char asciiString[m_uPATHNAME_MAX_LENGTH];
     memset( asciiString, '\0', sizeof( char[m_uPATHNAME_MAX_LENGTH] ) );
     wcstombs_s( &i, asciiString, m_uPATHNAME_MAX_LENGTH, m_wsRawFileName, m_uPATHNAME_MAX_LENGTH );
-    CreateHash( asciiString, 0, &m_pFilenameHash, &m_uFilenameHashLength );
+    CreateHash( asciiString, strlen( asciiString ), &m_pFilenameHash, &m_uFilenameHashLength );
     swprintf_s( m_wsHashedFileName, L"%x", *reinterpret_cast<unsigned long *>(m_pFilenameHash) );
-    assert( m_uFilenameHashLength == 16 );
+    assert( m_uFilenameHashLength == SHADER_HASH_SIZE );
 
 }
 
@@ -2790,88 +3576,20 @@ void ShaderCache::Shader::SetupHashedFilename( void )
 //--------------------------------------------------------------------------------------
 // Creates the hash
 //--------------------------------------------------------------------------------------
-void ShaderCache::CreateHash( const char* data, int iFileSize, BYTE** hash, long* len )
+void ShaderCache::CreateHash( const char* data, size_t uSize, BYTE** hash, long* len )
 {
-    HCRYPTPROV hProv = 0;
-    HCRYPTHASH hHash = 0;
-    BYTE *pbHash = NULL;
-    DWORD dwHashLen = 0;
-
-    BYTE * pbBuffer = NULL;
-    DWORD dwCount = 0;
-    DWORD i = 0;
-    size_t bufLen = 0;
-
-    // DwFlags is set to zero to attempt to open an existing key container.
-    if (!CryptAcquireContext( &hProv, NULL, NULL, PROV_RSA_FULL, 0 ))
-    {
-        // An error occurred in acquiring the context. This could mean that
-        // the key container requested does not exist. In this case, the
-        // function can be called again to attempt to create a new key container.
-        if (GetLastError() == NTE_BAD_KEYSET)
-        {
-            if (!CryptAcquireContext( &hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_NEWKEYSET ))
-            {
-                return;
-            }
-        }
-    }
-    if (!CryptCreateHash( hProv, CALG_MD5, 0, 0, &hHash ))
-    {
-        return;
-    }
-
-    bufLen = strlen( data );
-
-    pbBuffer = (BYTE*)malloc( bufLen + 1 );
-    memset( pbBuffer, 0, bufLen + 1 );
-
-    for (i = 0; i < bufLen; i++)
-    {
-        pbBuffer[i] = (BYTE)data[i];
-    }
-
-    if (!CryptHashData( hHash, pbBuffer, (DWORD)bufLen, 0 ))
-    {
-        return;
-    }
-
-    dwCount = sizeof( DWORD );
-    if (!CryptGetHashParam( hHash, HP_HASHSIZE, (BYTE *)&dwHashLen, &dwCount, 0 ))
-    {
-        return;
-    }
-
-    if ((pbHash = (unsigned char*)malloc( dwHashLen )) == NULL)
+    BYTE* pbHash = (BYTE*)malloc( SHADER_HASH_SIZE );
+    if (NULL == pbHash)
     {
         return;
     }
 
-    memset( pbHash, 0, dwHashLen );
-
-    if (!CryptGetHashParam( hHash, HP_HASHVAL, pbHash, &dwHashLen, 0 ))
-    {
-        return;
-    }
+    ShaderHasher Hasher;
+    Hasher.Update( data, uSize );
+    Hasher.Digest( *reinterpret_cast<unsigned char (*)[SHADER_HASH_SIZE]>(pbHash) );
 
     *hash = pbHash;
-    *len = dwHashLen;
-
-    if (hHash)
-    {
-        CryptDestroyHash( hHash );
-    }
-
-    if (hProv)
-    {
-        CryptReleaseContext( hProv, 0 );
-    }
-
-    if (NULL != pbBuffer)
-    {
-        free( pbBuffer );
-        pbBuffer = NULL;
-    }
+    *len = SHADER_HASH_SIZE;
 }
 
 
@@ -2919,7 +3637,8 @@ BOOL ShaderCache::CompareHash( Shader* pShader )
 
         fclose( pFile );
 
-        if (!memcmp( pShader->m_pHash, pFileBuf, pShader->m_uHashLength ))
+        // Hash files of another size are from an older hash function
+        if ((iFileSize == pShader->m_uHashLength) && !memcmp( pShader->m_pHash, pFileBuf, pShader->m_uHashLength ))
         {
             delete [] pFileBuf;
             return TRUE;
@@ -2937,6 +3656,8 @@ BOOL ShaderCache::CompareHash( Shader* pShader )
 //--------------------------------------------------------------------------------------
 HRESULT ShaderCache::CreateShader( Shader* pShader )
 {
+    SHADER_PROFILE_BLOCK( pShader->m_uProfileIndex, SHADER_PROFILE_CREATE, L"ShaderCache: create shader" )
+
     HRESULT hr = E_FAIL;
     FILE* pFile = NULL;
     wchar_t wsShaderPathName[m_uPATHNAME_MAX_LENGTH];
@@ -2945,18 +3666,38 @@ HRESULT ShaderCache::CreateShader( Shader* pShader )
     ID3D11DeviceChild* pTempD3DShader = *pShader->m_ppShader;
     *pShader->m_ppShader = NULL;
 
-    CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsObjectFile );
+    const char* pFileBuf = NULL;
+    SIZE_T iFileSize = 0;
+    std::vector<char> ObjectFile;
 
-    _wfopen_s( &pFile, wsShaderPathName, L"rb" );
+    // Straight from the mapped archive, without a copy unless it is compressed
+    const ShaderArchiveEntry* pEntry = FindArchiveEntry( pShader );
+    if (pEntry)
+    {
+        pFileBuf = (const char*)m_Archive.GetBlob( *pEntry, ObjectFile );
+        iFileSize = pFileBuf ? (SIZE_T)pEntry->uSize : 0;
+    }
 
-    if (pFile)
+    if (!pFileBuf)
     {
-        fseek( pFile, 0, SEEK_END );
-        int iFileSize = ftell( pFile );
-        rewind( pFile );
-        char* pFileBuf = new char[iFileSize];
-        fread( pFileBuf, 1, iFileSize, pFile );
+        CreateFullPathFromOutputFilename( wsShaderPathName, pShader->m_wsObjectFile );
+
+        _wfopen_s( &pFile, wsShaderPathName, L"rb" );
+
+        if (pFile)
+        {
+            fseek( pFile, 0, SEEK_END );
+            int iObjectFileSize = ftell( pFile );
+            rewind( pFile );
+            ObjectFile.resize( iObjectFileSize + 1 );
+            iFileSize = fread( &ObjectFile[0], 1, iObjectFileSize, pFile );
+            pFileBuf = &ObjectFile[0];
+            fclose( pFile );
+        }
+    }
 
+    if (iFileSize > 0)
+    {
         switch (pShader->m_eShaderType)
         {
         case SHADER_TYPE_VERTEX:
@@ -2988,9 +3729,6 @@ HRESULT ShaderCache::CreateShader( Shader* pShader )
             assert( S_OK == hr );
             break;
         }
-
-        delete [] pFileBuf;
-        fclose( pFile );
     }
 
     if (hr == S_OK)
@@ -3010,66 +3748,20 @@ HRESULT ShaderCache::CreateShader( Shader* pShader )
 //--------------------------------------------------------------------------------------
 // Compiles a shader
 //--------------------------------------------------------------------------------------
-BOOL ShaderCache::CompileShader( Shader* pShader )
+BOOL ShaderCache::CompileShader( Shader* pShader, ShaderProcess& Process )
 {
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-
-    ZeroMemory( &si, sizeof( si ) );
-    si.cb = sizeof( si );
-    ZeroMemory( &pi, sizeof( pi ) );
-
-    // Start the child process.
-    BOOL bSuccess = CreateProcess( m_wsFxcExePath,   // Application name
-        pShader->m_wsCommandLine, // Command line
-        NULL,             // Process handle not inheritable
-        NULL,             // Thread handle not inheritable
-        FALSE,            // Set handle inheritance to FALSE
-        CREATE_NO_WINDOW, // Don't make a console window
-        NULL,             // Use parent's environment block
-        NULL,             // Use parent's starting directory
-        &si,              // Pointer to STARTUPINFO structure
-        &pi );            // Pointer to PROCESS_INFORMATION structure
-
-    assert( pShader->m_hCompileProcessHandle == NULL );
-    assert( pShader->m_hCompileThreadHandle == NULL );
-    pShader->m_hCompileProcessHandle = pi.hProcess;
-    pShader->m_hCompileThreadHandle = pi.hThread;
-
-    return bSuccess;
+    // Start the child process, the scheduler waits for it
+    return ShaderProcessPlatform::GetDefault().Start( m_wsFxcExePath, pShader->m_wsCommandLine, Process ) ? TRUE : FALSE;
 }
 
 
 //--------------------------------------------------------------------------------------
 // Preprocesses a shader
 //--------------------------------------------------------------------------------------
-BOOL ShaderCache::PreprocessShader( Shader* pShader )
+BOOL ShaderCache::PreprocessShader( Shader* pShader, ShaderProcess& Process )
 {
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-
-    ZeroMemory( &si, sizeof( si ) );
-    si.cb = sizeof( si );
-    ZeroMemory( &pi, sizeof( pi ) );
-
-    // Start the child process.
-    BOOL bSuccess = CreateProcess( m_wsFxcExePath,   // Application name
-        pShader->m_wsPreprocessCommandLine, // Command line
-        NULL,             // Process handle not inheritable
-        NULL,             // Thread handle not inheritable
-        FALSE,            // Set handle inheritance to FALSE
-        CREATE_NO_WINDOW, // Don't make a console window
-        NULL,             // Use parent's environment block
-        NULL,             // Use parent's starting directory
-        &si,              // Pointer to STARTUPINFO structure
-        &pi );            // Pointer to PROCESS_INFORMATION structure
-
-    assert( pShader->m_hCompileProcessHandle == NULL );
-    assert( pShader->m_hCompileThreadHandle == NULL );
-    pShader->m_hCompileProcessHandle = pi.hProcess;
-    pShader->m_hCompileThreadHandle = pi.hThread;
-
-    return bSuccess;
+    // Start the child process, the scheduler waits for it
+    return ShaderProcessPlatform::GetDefault().Start( m_wsFxcExePath, pShader->m_wsPreprocessCommandLine, Process ) ? TRUE : FALSE;
 }
 
 //--------------------------------------------------------------------------------------
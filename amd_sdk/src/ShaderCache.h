@@ -28,6 +28,38 @@
 // will simply re-use the object files, making craetion time very fast. The option is there,
 // to force the regeneration of object files.
 //
+// Each shader is preprocessed, hashed, compiled and handed over for creation on its own,
+// by a ShaderCompileScheduler that starts the next compiler as soon as any finishes.
+//
+// Compiled shaders are also collected in a ShaderArchive, one file per configuration that
+// a start from the cache maps to create all shaders from, instead of opening their object
+// files one by one. Object files remain the fallback for shaders the archive lacks.
+//
+// In CREATE_TYPE_COMPILE_CHANGES mode, a ShaderDependencyGraph of the source files and
+// their includes picks the shaders whose sources changed since they were built. Only
+// these are preprocessed; the rest are created from the cache after looking up the time
+// and size of their files.
+//
+// Shaders added with AddPermutedShader declare options instead of macros. Each permutation
+// of the options is generated the first time GetShaderPermutation requests its key: created
+// straight from the archive if it holds the permutation, or else compiled in the background.
+// Once created, a permutation takes a 16 byte record in the shader's ShaderPermutationTable.
+//
+// With lazy creation, the shaders the first frame needs are preprocessed and compiled
+// ahead of the rest, and ShadersReady is true once they are created. The others keep
+// generating, and are created by later calls to ShadersReady as they become ready.
+//
+// With a cache server set by SetRemoteCache, a shader that must be compiled is first asked
+// for from the server, by a key of its preprocessed source, target, entry point, flags and
+// compiler, and what is compiled here is handed to the server for the next machine.
+//
+// SetCompressArchiveFlag stores the shaders added to the archive compressed with LZ4, to
+// read less from disk. Creating the shaders, which decompresses those, runs on every core.
+//
+// Each generation is profiled stage by stage, shader by shader, as a ShaderStartupProfile.
+// Once its shaders are created, the stages and the slowest shaders are written to
+// ShaderStartupProfile.txt next to the object files. RenderProgress draws them meanwhile.
+//
 // Assumption, relies on following directory structure:
 //
 // SolutionDir\..\src\Shaders
@@ -39,6 +71,14 @@
 #include <list>
 #include <vector>
 
+#include "ShaderCompileScheduler.h"
+#include "ShaderArchive.h"
+#include "ShaderDependencies.h"
+#include "ShaderPermutations.h"
+#include "ShaderDirectoryWatcher.h"
+#include "ShaderRemoteCache.h"
+#include "ShaderProfile.h"
+
 // The following two defines (AMD_SDK_INTERNAL_BUILD and AMD_SDK_PREBUILT_RELEASE_EXE) are for internal AMD use.
 // If you don't work for AMD, you shouldn't need to touch them.
 
@@ -75,7 +115,7 @@
 namespace AMD
 {
 
-    class ShaderCache
+    class ShaderCache : private ShaderJobClient
     {
     public:
 
@@ -155,6 +195,14 @@ namespace AMD
             MAXCORES_SINGLE_THREADED    =  1
         } MAXCORES_TYPE;
 
+        // Shader priority enumeration, for lazy creation
+        typedef enum SHADER_PRIORITY_t
+        {
+            SHADER_PRIORITY_FIRST_FRAME,    // Needed to render the first frame, ShadersReady waits for it
+            SHADER_PRIORITY_BACKGROUND,     // Generated and created while the first frames render
+            SHADER_PRIORITY_MAX
+        }SHADER_PRIORITY;
+
         // The Macro structure
         class Macro
         {
@@ -164,6 +212,8 @@ namespace AMD
             int                 m_iValue;
         };
 
+        class PermutedShader;
+
         // The shader class
         class Shader
         {
@@ -217,18 +267,50 @@ namespace AMD
             bool                        m_bShaderUpToDate;
             BYTE*                       m_pHash;
             long                        m_uHashLength;
+            unsigned long long          m_uDependencyHash;  // Of the sources when generation started
+            unsigned long long          m_uCompileOptionsHash;  // Of the target, entry point and flags
+            unsigned long long          m_uRemoteKey;       // On the cache server, 0 if not asked for
+            unsigned int                m_uProfileIndex;    // In the startup profile, NO_SHADER if not in it
+            unsigned long long          m_uProcessStartTime;    // Of its fxc process, for the startup profile
 
             BYTE*                       m_pFilenameHash;
             long                        m_uFilenameHashLength;
 
             const wchar_t*              m_wsCompileStatus;
             int                         m_iCompileWaitCount;
-            HANDLE                      m_hCompileProcessHandle;
-            HANDLE                      m_hCompileThreadHandle;
+
+            PermutedShader*             m_pPermutedShader;  // NULL unless a permutation
+            ShaderPermutationKey        m_uPermutationKey;
+            ID3D11DeviceChild*          m_pPermutation;     // Created here, before it goes in the table
+
+            SHADER_PRIORITY             m_ePriority;
+            bool                        m_bAwaitedByFirstFrame; // Until created or failed, in lazy creation
 
             void SetupHashedFilename( void );
         };
 
+        // A shader with options, see AddPermutedShader
+        class PermutedShader
+        {
+        public:
+
+            PermutedShader();
+
+            SHADER_TYPE                 m_eShaderType;
+            wchar_t                     m_wsTarget[m_uTARGET_MAX_LENGTH];
+            wchar_t                     m_wsEntryPoint[m_uENTRY_POINT_MAX_LENGTH];
+            wchar_t                     m_wsSourceFile[m_uFILENAME_MAX_LENGTH];
+            ShaderOptions               m_Options;
+            unsigned int                m_uOptionsHash;     // Part of the permutations' file names
+
+            std::vector<D3D11_INPUT_ELEMENT_DESC> m_InputLayoutDesc;
+            std::list<std::string>      m_SemanticNames;    // Of the input layout
+            ID3D11InputLayout*          m_pInputLayout;     // Created with the first permutation
+            bool                        m_bInputLayoutRequested;
+
+            ShaderPermutationTable      m_Permutations;     // The created ID3D11DeviceChild of each requested key
+        };
+
         // Construction / destruction
         ShaderCache( const SHADER_AUTO_RECOMPILE_TYPE i_keAutoRecompileTouchedShadersType = SHADER_AUTO_RECOMPILE_DISABLED,
             const ERROR_DISPLAY_TYPE i_keErrorDisplayType = ERROR_DISPLAY_IN_DEBUG_OUTPUT_AND_BREAK,
@@ -252,6 +334,22 @@ namespace AMD
             const int i_iMaxSGPRLimit = -1,
             const bool i_kbIsApplicationShader = true );
 
+        // Allows the user to add a shader with options, whose permutations are generated when first requested.
+        // The cache owns the shaders it creates for the permutations, and releases them in OnDestroyDevice.
+        PermutedShader* AddPermutedShader( SHADER_TYPE ShaderType,
+            const wchar_t* pwsTarget,
+            const wchar_t* pwsEntryPoint,
+            const wchar_t* pwsSourceFile,
+            const ShaderOptions& Options,
+            const D3D11_INPUT_ELEMENT_DESC* pLayout = NULL,
+            unsigned int uNumElements = 0 );
+
+        // Returns the shader of a permutation, made from the options' values with ShaderOptions::SetValue.
+        // The first request creates it from the cache, or queues it for compiling; until it is ready, and
+        // if it fails to compile, NULL is returned. Call from the thread that renders.
+        ID3D11DeviceChild* GetShaderPermutation( PermutedShader* pPermutedShader, ShaderPermutationKey uKey );
+        ID3D11InputLayout* GetPermutationInputLayout( const PermutedShader* pPermutedShader ) const { return pPermutedShader->m_pInputLayout; }
+
         // Allows the ShaderCache to add a new type of ISA Target version of all shaders to the cache
         bool CloneShaders( void );
 
@@ -269,6 +367,10 @@ namespace AMD
         void        SetShowShaderErrorsFlag( const bool i_kbShowShaderErrors );
         void        SetGenerateShaderISAFlag( const bool i_kbGenerateShaderISA );
         void        SetShowShaderISAFlag( const bool i_kbShowShaderISA );
+        void        SetLazyCreationFlag( const bool i_kbLazyCreation );
+        void        SetCompressArchiveFlag( const bool i_kbCompressArchive );
+        void        SetShaderPriority( const SHADER_PRIORITY i_keShaderPriority = SHADER_PRIORITY_FIRST_FRAME ); // Of shaders added next
+        void        SetRemoteCache( const char* i_szHost, const unsigned short i_kuPort = SHADER_REMOTE_DEFAULT_PORT ); // NULL host for none
 #if AMD_SDK_INTERNAL_BUILD
         void        SetTargetISA( const ISA_TARGET i_eTargetISA = DEFAULT_ISA_TARGET );
 #endif
@@ -276,19 +378,26 @@ namespace AMD
         // Renders runtime shader compiler errors from dynamically recompiled shaders
         void RenderShaderErrors( CDXUTTextHelper* g_pTxtHelper, int iFontHeight, DirectX::XMVECTOR FontColor, const unsigned int ki_FrameTimeout = 2500 );
 
-        // Renders the progress of the shader generation
+        // Renders the progress of the shader generation, and the stages and shaders that took longest so far
         void RenderProgress( CDXUTTextHelper* g_pTxtHelper, int iFontHeight, DirectX::XMVECTOR FontColor );
 
+        // Where the time of the last generation went, complete once ShadersReady created its shaders
+        const ShaderStartupProfile& GetStartupProfile() const { return m_Profile; }
+
         // Renders the GPR usage for the shaders
         void RenderISAInfo( CDXUTTextHelper* g_pTxtHelper, int iFontHeight, DirectX::XMVECTOR FontColor, const Shader *i_pShaderCmp = NULL, wchar_t *o_wsGPRInfo = NULL );
 
-        // User can enquire to see if shaders are ready
+        // User can enquire to see if shaders are ready. With lazy creation they are once the first frame's
+        // shaders are created, and each call creates a few milliseconds' worth of the others. Until a shader
+        // is created the pointer AddShader was given stays NULL, or keeps the old shader while recompiling.
         bool ShadersReady();
 
-        // DXUT framework hook method (flags the shaders as needing creating)
+        // DXUT framework hook method (flags the shaders as needing creating). Waits for the
+        // generation thread, so call it before TIMER_Destroy.
         void OnDestroyDevice();
 
-        // Called by app when WM_QUIT is posted, so that shader generation can be aborted
+        // Called by app when WM_QUIT is posted, so that shader generation can be aborted.
+        // Returns once the generation thread stopped.
         void Abort();
 
         // Called by the app to override optimizations when compiling shaders in release mode
@@ -299,27 +408,75 @@ namespace AMD
 
     private:
 
+        // Sets up a shader for AddShader and for permutations
+        Shader* NewShader( ID3D11DeviceChild** ppShader,
+            SHADER_TYPE ShaderType,
+            const wchar_t* pwsTarget,
+            const wchar_t* pwsEntryPoint,
+            const wchar_t* pwsSourceFile,
+            unsigned int uNumMacros,
+            Macro* pMacros,
+            ID3D11InputLayout** ppInputLayout,
+            const D3D11_INPUT_ELEMENT_DESC* pLayout,
+            unsigned int uNumElements,
+            const wchar_t* pwsCanonicalName,
+            const int i_iMaxVGPRLimit,
+            const int i_iMaxSGPRLimit,
+            const bool i_kbIsApplicationShader );
+
         // Preprocessing, compilation, and creation methods
-        void PreprocessShaders();
-        void CompileShaders();
+        void ProcessShaders();
         void InvalidateShaders();
 
         HRESULT CreateShaders();
-        BOOL PreprocessShader( Shader* pShader );
-        BOOL CompileShader( Shader* pShader );
+        BOOL PreprocessShader( Shader* pShader, ShaderProcess& Process );
+        BOOL CompileShader( Shader* pShader, ShaderProcess& Process );
         HRESULT CreateShader( Shader* pShader );
+        static void createShaderJob( void* pContext, size_t uIndex );
+
+        // ShaderJobClient methods, called by the scheduler on the generation thread
+        virtual bool StartStage( void* pJob, SHADER_JOB_STAGE eStage, ShaderProcess& Process );
+        virtual SHADER_JOB_STAGE FinishStage( void* pJob, SHADER_JOB_STAGE eStage, bool bStarted );
 
         // Hash methods
-        void StripPathInfoFromPreprocessFile( Shader* pShader, FILE* pFile, char* pFileBufDst, int iFileSize );
         BOOL CreateHashFromPreprocessFile( Shader* pShader );
-        static void CreateHash( const char* data, int iFileSize, BYTE** hash, long* len );
+        static void CreateHash( const char* data, size_t uSize, BYTE** hash, long* len );
         void WriteHashFile( Shader* pShader );
         BOOL CompareHash( Shader* pShader );
         bool CreateHashDigest( const std::list<Shader*>& i_ShaderList );
 
+        // Archive methods
+        const ShaderArchiveEntry* FindArchiveEntry( const Shader* pShader ) const;
+        void UpdateArchive();
+
+        // Dependency methods
+        unsigned long long GetDependencyHash( const Shader* pShader );
+        void SaveDependencies();
+
+        // Cache server methods
+        unsigned long long GetRemoteKey( const Shader* pShader );
+        bool FetchRemoteShader( Shader* pShader );
+        void StoreRemoteShader( const Shader* pShader );
+
+        // Permutation methods
+        Shader* NewPermutation( PermutedShader* pPermutedShader, ShaderPermutationKey uKey );
+        void UpdatePermutations();
+        void FinishPermutation( Shader* pShader );
+        void ReleasePermutations();
+
+        // Lazy creation methods
+        void QueueReadyShader( Shader* pShader );
+        bool CreateReadyShaders();
+        void FinishFirstFrameShader( Shader* pShader );
+        void ReportFirstFrame();
+
+        // Profile methods
+        void BeginStartupProfile();
+        void ReportStartupProfile();
+
         // Watch methods (for automatic shader recompilation when changed)
         bool WatchDirectoryForChanges( void );
-        static void __stdcall onDirectoryChangeEventTriggered( void* args, BOOLEAN /*timeout*/ );
+        static bool onShaderFilesChanged( void* pContext, const ShaderFileChanges& Changes );
 
         // Check methodss
         BOOL CheckFXC();
@@ -379,11 +536,28 @@ namespace AMD
         std::list<Shader*>      m_ShaderSourceList;
         std::list<Shader*>      m_ShaderList;
         std::list<Shader*>      m_PreprocessList;
-        std::list<Shader*>      m_HashList;
-        std::list<Shader*>      m_CompileList;
-        std::list<Shader*>      m_CompileCheckList;
         std::list<Shader*>      m_CreateList;
+        volatile LONG           m_lShadersToPreprocess; // Progress of the generation thread
+        volatile LONG           m_lShadersToCompile;
+        ShaderSchedulerStats    m_SchedulerStats;       // Of the last generation
+        ShaderArchive           m_Archive;              // Object files of the current configuration
+        ShaderDependencyGraph   m_Dependencies;         // Includes of the source files, and what shaders were built from
+        ShaderRemoteCacheClient m_RemoteCache;          // Used by the generation thread only
+        unsigned long long      m_uCompilerHash;        // Of fxc, 0 until first needed
         std::set<Shader*>       m_ErrorList;
+        std::list<PermutedShader*> m_PermutedShaderList;
+        std::list<Shader*>      m_PendingPermutationList;       // Requested, not looked up in the cache yet
+        std::list<Shader*>      m_GeneratingPermutationList;    // Handed to the generation thread
+        bool                    m_bGeneratingPermutations;      // Until the generated permutations are created
+        bool                    m_bLazyCreation;
+        bool                    m_bCreatingLazily;      // Until the shaders of this generation are created
+        SHADER_PRIORITY         m_eShaderPriority;      // Of shaders added next
+        std::list<Shader*>      m_ReadyList;            // Handed over for lazy creation, the first frame's first
+        volatile LONG           m_lFirstFrameShadersLeft;
+        LARGE_INTEGER           m_GenerationStart;      // To report the time until the first frame
+        bool                    m_bReportFirstFrame;
+        ShaderStartupProfile    m_Profile;              // Of the last generation
+        unsigned int            m_uProfileCacheFiles;   // Its row for the cache files the shaders share
 #if AMD_SDK_INTERNAL_BUILD
         std::vector< std::vector<Shader*> * > m_ISATargetList;
 #endif
@@ -425,8 +599,9 @@ namespace AMD
 #endif
         CRITICAL_SECTION        m_CompileShaders_CriticalSection;
         CRITICAL_SECTION        m_GenISA_CriticalSection;
-        HANDLE                  m_watchHandle;
-        HANDLE                  m_waitPoolHandle;
+        CRITICAL_SECTION        m_ReadyList_CriticalSection;    // Also keeps the archive mapped while shaders are created from it
+        ShaderDirectoryWatcher  m_DirectoryWatcher;
+        const ShaderFileChanges* m_pFileChanges;        // Those the watcher is recompiling, for the dependency check
         unsigned int            m_shaderErrorRenderedCount;
         bool                    m_bRecompileTouchedShaders;
         bool                    m_bShowShaderErrors;
@@ -0,0 +1,503 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderCompileScheduler.cpp
+//
+// Streams shader jobs through their stages, refilling compiler slots as processes exit
+//--------------------------------------------------------------------------------------
+#include "ShaderCompileScheduler.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <errno.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <string>
+#include <algorithm>
+
+extern char** environ;
+#endif
+
+namespace AMD
+{
+    static long long GetTicks()
+    {
+        return (long long)std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+
+    static double TicksToSeconds( long long iTicks )
+    {
+        return (double)iTicks * std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+    }
+
+
+#ifdef _WIN32
+
+    //--------------------------------------------------------------------------------------
+    // Windows: CreateProcess and WaitForMultipleObjects
+    //--------------------------------------------------------------------------------------
+    class WindowsProcessPlatform : public ShaderProcessPlatform
+    {
+    public:
+
+        virtual bool Start( const wchar_t* szApplication, const wchar_t* szCommandLine, ShaderProcess& Process )
+        {
+            // CreateProcess may write to the command line
+            std::vector<wchar_t> CommandLine( szCommandLine, szCommandLine + wcslen( szCommandLine ) + 1 );
+
+            STARTUPINFOW si;
+            PROCESS_INFORMATION pi;
+
+            ZeroMemory( &si, sizeof( si ) );
+            si.cb = sizeof( si );
+            ZeroMemory( &pi, sizeof( pi ) );
+
+            if ( !CreateProcessW( szApplication, &CommandLine[0], NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi ) )
+            {
+                Process = 0;
+                return false;
+            }
+
+            CloseHandle( pi.hThread );
+            Process = (ShaderProcess)pi.hProcess;
+            return true;
+        }
+
+        virtual int WaitAny( const ShaderProcess* pProcesses, unsigned int uCount, unsigned int uTimeoutMs )
+        {
+            HANDLE Handles[MAXIMUM_WAIT_OBJECTS];
+
+            if ( uCount == 0 || uCount > MAXIMUM_WAIT_OBJECTS )
+            {
+                return -1;
+            }
+
+            for ( unsigned int i = 0; i < uCount; i++ )
+            {
+                Handles[i] = (HANDLE)pProcesses[i];
+            }
+
+            DWORD dwRet = WaitForMultipleObjects( uCount, Handles, FALSE, ( uTimeoutMs == SHADER_WAIT_INFINITE ) ? INFINITE : uTimeoutMs );
+            if ( dwRet >= WAIT_OBJECT_0 && dwRet < WAIT_OBJECT_0 + uCount )
+            {
+                return (int)( dwRet - WAIT_OBJECT_0 );
+            }
+
+            return -1;
+        }
+
+        virtual void Close( ShaderProcess Process )
+        {
+            CloseHandle( (HANDLE)Process );
+        }
+
+        virtual unsigned int GetMaxProcesses() const { return MAXIMUM_WAIT_OBJECTS; }
+    };
+
+#else
+
+    //--------------------------------------------------------------------------------------
+    // POSIX: posix_spawn and waitpid. Waiting reaps any child of the process, so exits of
+    // processes WaitAny wasn't asked about are kept for later calls.
+    //--------------------------------------------------------------------------------------
+    class PosixProcessPlatform : public ShaderProcessPlatform
+    {
+    public:
+
+        virtual bool Start( const wchar_t* szApplication, const wchar_t* szCommandLine, ShaderProcess& Process )
+        {
+            Process = 0;
+
+            std::vector<std::string> Arguments;
+            Arguments.push_back( ToUtf8( szApplication, wcslen( szApplication ) ) );
+            SplitCommandLine( szCommandLine, Arguments );
+
+            std::vector<char*> Argv;
+            for ( size_t i = 0; i < Arguments.size(); i++ )
+            {
+                Argv.push_back( &Arguments[i][0] );
+            }
+            Argv.push_back( NULL );
+
+            pid_t Pid = 0;
+            if ( posix_spawn( &Pid, Argv[0], NULL, NULL, &Argv[0], environ ) != 0 )
+            {
+                return false;
+            }
+
+            Process = (ShaderProcess)Pid;
+            return true;
+        }
+
+        virtual int WaitAny( const ShaderProcess* pProcesses, unsigned int uCount, unsigned int uTimeoutMs )
+        {
+            if ( uCount == 0 )
+            {
+                return -1;
+            }
+
+            const long long iDeadline = GetTicks() + (long long)( uTimeoutMs / 1000.0 / TicksToSeconds( 1 ) );
+
+            for ( ;; )
+            {
+                for ( unsigned int i = 0; i < uCount; i++ )
+                {
+                    std::vector<pid_t>::iterator it = std::find( m_Exited.begin(), m_Exited.end(), (pid_t)pProcesses[i] );
+                    if ( it != m_Exited.end() )
+                    {
+                        m_Exited.erase( it );
+                        return (int)i;
+                    }
+                }
+
+                // Without a timeout block in waitpid, otherwise check every millisecond
+                const bool bBlock = ( uTimeoutMs == SHADER_WAIT_INFINITE );
+                int iStatus = 0;
+                pid_t Pid = waitpid( -1, &iStatus, bBlock ? 0 : WNOHANG );
+
+                if ( Pid > 0 )
+                {
+                    m_Exited.push_back( Pid );
+                }
+                else if ( Pid < 0 && errno != EINTR )
+                {
+                    // No children left to wait for
+                    return -1;
+                }
+                else if ( Pid == 0 )
+                {
+                    if ( GetTicks() >= iDeadline )
+                    {
+                        return -1;
+                    }
+
+                    struct timespec Delay = { 0, 1000000 };
+                    nanosleep( &Delay, NULL );
+                }
+            }
+        }
+
+        virtual void Close( ShaderProcess Process )
+        {
+            // WaitAny reaped the process if it exited; one closed while running is reaped
+            // by a later WaitAny
+            std::vector<pid_t>::iterator it = std::find( m_Exited.begin(), m_Exited.end(), (pid_t)Process );
+            if ( it != m_Exited.end() )
+            {
+                m_Exited.erase( it );
+            }
+        }
+
+        virtual unsigned int GetMaxProcesses() const { return 1024; }
+
+    private:
+
+        static std::string ToUtf8( const wchar_t* szText, size_t uLength )
+        {
+            std::string Text;
+            for ( size_t i = 0; i < uLength; i++ )
+            {
+                unsigned int c = (unsigned int)szText[i];
+                if ( c < 0x80 )
+                {
+                    Text += (char)c;
+                }
+                else if ( c < 0x800 )
+                {
+                    Text += (char)( 0xC0 | ( c >> 6 ) );
+                    Text += (char)( 0x80 | ( c & 0x3F ) );
+                }
+                else if ( c < 0x10000 )
+                {
+                    Text += (char)( 0xE0 | ( c >> 12 ) );
+                    Text += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                    Text += (char)( 0x80 | ( c & 0x3F ) );
+                }
+                else
+                {
+                    Text += (char)( 0xF0 | ( c >> 18 ) );
+                    Text += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                    Text += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                    Text += (char)( 0x80 | ( c & 0x3F ) );
+                }
+            }
+            return Text;
+        }
+
+        // Splits at spaces outside of double quotes, dropping the quotes
+        static void SplitCommandLine( const wchar_t* szCommandLine, std::vector<std::string>& Arguments )
+        {
+            std::wstring Argument;
+            bool bInArgument = false;
+            bool bQuoted = false;
+
+            for ( const wchar_t* p = szCommandLine; ; p++ )
+            {
+                if ( *p == L'\0' || ( !bQuoted && ( *p == L' ' || *p == L'\t' ) ) )
+                {
+                    if ( bInArgument )
+                    {
+                        Arguments.push_back( ToUtf8( Argument.c_str(), Argument.size() ) );
+                        Argument.clear();
+                        bInArgument = false;
+                    }
+                    if ( *p == L'\0' )
+                    {
+                        break;
+                    }
+                }
+                else if ( *p == L'"' )
+                {
+                    bQuoted = !bQuoted;
+                    bInArgument = true;
+                }
+                else
+                {
+                    Argument += *p;
+                    bInArgument = true;
+                }
+            }
+        }
+
+        std::vector<pid_t>      m_Exited;
+    };
+
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderProcessPlatform& ShaderProcessPlatform::GetDefault()
+    {
+#ifdef _WIN32
+        static WindowsProcessPlatform s_Platform;
+#else
+        static PosixProcessPlatform s_Platform;
+#endif
+        return s_Platform;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderCompileScheduler::ShaderCompileScheduler( ShaderJobClient& Client, ShaderProcessPlatform& Platform )
+        : m_Client( Client )
+        , m_Platform( Platform )
+        , m_iRunStart( 0 )
+        , m_uUrgentPriority( 0 )
+        , m_uUrgentLeft( 0 )
+    {
+        memset( &m_Stats, 0, sizeof( m_Stats ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderCompileScheduler::~ShaderCompileScheduler()
+    {
+        for ( size_t i = 0; i < m_Processes.size(); i++ )
+        {
+            m_Platform.Close( m_Processes[i] );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderCompileScheduler::AddJob( void* pJob, SHADER_JOB_STAGE eFirstStage, unsigned int uPriority )
+    {
+        Job J;
+        J.pJob = pJob;
+        J.eStage = eFirstStage;
+        J.iStageStart = 0;
+        J.uPriority = uPriority;
+        Queue( J, false );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // The ready queue is sorted by priority. Without priorities, which is the usual case,
+    // this is push_back and push_front.
+    //--------------------------------------------------------------------------------------
+    void ShaderCompileScheduler::Queue( const Job& J, bool bAhead )
+    {
+        if ( bAhead )
+        {
+            std::deque<Job>::iterator it = m_Ready.begin();
+            while ( it != m_Ready.end() && it->uPriority < J.uPriority )
+            {
+                ++it;
+            }
+            m_Ready.insert( it, J );
+        }
+        else
+        {
+            std::deque<Job>::iterator it = m_Ready.end();
+            while ( it != m_Ready.begin() && ( it - 1 )->uPriority > J.uPriority )
+            {
+                --it;
+            }
+            m_Ready.insert( it, J );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Jobs whose process exited go to the front of the queue, so a shader that is further
+    // along gets the next free slot and is ready sooner than if every shader was first
+    // preprocessed. They stay behind the ready jobs of a more urgent priority.
+    //--------------------------------------------------------------------------------------
+    bool ShaderCompileScheduler::Run( unsigned int uMaxProcesses, const volatile bool* pbAbort )
+    {
+        uMaxProcesses = ( uMaxProcesses < 1 ) ? 1 : uMaxProcesses;
+        uMaxProcesses = ( uMaxProcesses > m_Platform.GetMaxProcesses() ) ? m_Platform.GetMaxProcesses() : uMaxProcesses;
+
+        memset( &m_Stats, 0, sizeof( m_Stats ) );
+        m_Stats.uJobs = (unsigned int)m_Ready.size();
+        m_iRunStart = GetTicks();
+
+        // The queue is sorted, so the most urgent jobs are at its front
+        m_uUrgentPriority = m_Ready.empty() ? 0 : m_Ready.front().uPriority;
+        m_uUrgentLeft = 0;
+        for ( std::deque<Job>::const_iterator it = m_Ready.begin(); it != m_Ready.end() && it->uPriority == m_uUrgentPriority; ++it )
+        {
+            m_uUrgentLeft++;
+        }
+
+        // Wake up now and then to check for an abort
+        const unsigned int uTimeoutMs = pbAbort ? 50 : SHADER_WAIT_INFINITE;
+
+        while ( !m_Ready.empty() || !m_Running.empty() )
+        {
+            if ( pbAbort && *pbAbort )
+            {
+                for ( size_t i = 0; i < m_Processes.size(); i++ )
+                {
+                    m_Platform.Close( m_Processes[i] );
+                }
+                m_Processes.clear();
+                m_Running.clear();
+                m_Ready.clear();
+                m_Stats.fTotalSeconds = TicksToSeconds( GetTicks() - m_iRunStart );
+                return false;
+            }
+
+            while ( m_Running.size() < uMaxProcesses && !m_Ready.empty() )
+            {
+                Job J = m_Ready.front();
+                m_Ready.pop_front();
+                Advance( J );
+            }
+
+            if ( m_Running.empty() )
+            {
+                continue;
+            }
+
+            int iExited = m_Platform.WaitAny( &m_Processes[0], (unsigned int)m_Processes.size(), uTimeoutMs );
+            if ( iExited < 0 )
+            {
+                continue;
+            }
+
+            Job J = m_Running[iExited];
+            m_Platform.Close( m_Processes[iExited] );
+            m_Running.erase( m_Running.begin() + iExited );
+            m_Processes.erase( m_Processes.begin() + iExited );
+
+            FinishStage( J, true );
+            if ( J.eStage != SHADER_JOB_DONE && J.eStage != SHADER_JOB_FAILED )
+            {
+                Queue( J, true );
+            }
+        }
+
+        m_Stats.fTotalSeconds = TicksToSeconds( GetTicks() - m_iRunStart );
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderCompileScheduler::Advance( Job& J )
+    {
+        while ( J.eStage != SHADER_JOB_DONE && J.eStage != SHADER_JOB_FAILED )
+        {
+            J.iStageStart = GetTicks();
+
+            ShaderProcess Process = 0;
+            const bool bStarted = m_Client.StartStage( J.pJob, J.eStage, Process );
+
+            if ( bStarted && Process != 0 )
+            {
+                m_Running.push_back( J );
+                m_Processes.push_back( Process );
+                m_Stats.uMaxRunning = ( (unsigned int)m_Running.size() > m_Stats.uMaxRunning ) ? (unsigned int)m_Running.size() : m_Stats.uMaxRunning;
+                return true;
+            }
+
+            FinishStage( J, bStarted );
+        }
+
+        return false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderCompileScheduler::FinishStage( Job& J, bool bStarted )
+    {
+        const SHADER_JOB_STAGE eStage = J.eStage;
+
+        J.eStage = m_Client.FinishStage( J.pJob, eStage, bStarted );
+
+        const long long iNow = GetTicks();
+        m_Stats.fStageSeconds[eStage] += TicksToSeconds( iNow - J.iStageStart );
+        m_Stats.uStageRuns[eStage]++;
+
+        if ( J.eStage == SHADER_JOB_DONE )
+        {
+            if ( m_Stats.uDone == 0 )
+            {
+                m_Stats.fFirstDoneSeconds = TicksToSeconds( iNow - m_iRunStart );
+            }
+            m_Stats.uDone++;
+        }
+        else if ( J.eStage == SHADER_JOB_FAILED )
+        {
+            m_Stats.uFailed++;
+        }
+
+        if ( ( J.eStage == SHADER_JOB_DONE || J.eStage == SHADER_JOB_FAILED ) && J.uPriority == m_uUrgentPriority && m_uUrgentLeft > 0 )
+        {
+            if ( --m_uUrgentLeft == 0 )
+            {
+                m_Stats.fUrgentDoneSeconds = TicksToSeconds( iNow - m_iRunStart );
+            }
+        }
+    }
+}
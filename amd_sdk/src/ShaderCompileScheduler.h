@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderCompileScheduler.h
+//
+// Moves shaders through preprocess, hash, compile and create as a stream of jobs, each
+// at its own pace, rather than in batches that wait for their slowest shader.
+//
+// Stages that run the shader compiler start an external process. Up to a given number of
+// processes run at once, and as soon as any of them exits its job moves on to its next
+// stage and the free slot is refilled, jobs that are furthest along first. Stages without
+// a process, such as hashing the preprocessed source, run on the scheduler's thread
+// between waits. The scheduler blocks on the processes and never polls.
+//
+// Jobs may be given a priority, lower values first: a free slot always goes to a job of
+// the most urgent priority that is ready, so e.g. the shaders the first frame needs are
+// done before the rest get a compiler.
+//
+// Starting and waiting for processes goes through ShaderProcessPlatform, which has an
+// implementation for Windows and one for POSIX.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_COMPILE_SCHEDULER_H
+#define AMD_SDK_SHADER_COMPILE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+namespace AMD
+{
+    // Stages of a shader job, in the order a shader usually passes them
+    enum SHADER_JOB_STAGE
+    {
+        SHADER_JOB_PREPROCESS,                  // Expand includes and macros
+        SHADER_JOB_HASH,                        // Compare the preprocessed source with the cache
+        SHADER_JOB_COMPILE,
+        SHADER_JOB_CREATE,                      // Hand the object file over for creation
+        SHADER_JOB_DONE,
+        SHADER_JOB_FAILED,
+        SHADER_JOB_STAGE_COUNT
+    };
+
+    // Handle of a running process: a process handle on Windows, a pid on POSIX. 0 is none.
+    typedef intptr_t ShaderProcess;
+
+    // Starts external processes and waits for them
+    class ShaderProcessPlatform
+    {
+    public:
+
+        virtual ~ShaderProcessPlatform() {}
+
+        // Starts szApplication with the arguments in szCommandLine, which are separated by
+        // spaces and may be quoted. Returns false if the process didn't start.
+        virtual bool Start( const wchar_t* szApplication, const wchar_t* szCommandLine, ShaderProcess& Process ) = 0;
+
+        // Blocks until one of the processes exits, and returns its index. Returns -1 once
+        // uTimeoutMs passed, or right away for no processes.
+        virtual int WaitAny( const ShaderProcess* pProcesses, unsigned int uCount, unsigned int uTimeoutMs ) = 0;
+
+        // Releases a process; one that is still running is left to finish on its own
+        virtual void Close( ShaderProcess Process ) = 0;
+
+        // Most processes WaitAny can wait for
+        virtual unsigned int GetMaxProcesses() const = 0;
+
+        // Implementation for the platform this is built for
+        static ShaderProcessPlatform& GetDefault();
+    };
+
+    static const unsigned int SHADER_WAIT_INFINITE = 0xFFFFFFFF;
+
+    // What the scheduler calls to run the stages of its jobs
+    class ShaderJobClient
+    {
+    public:
+
+        virtual ~ShaderJobClient() {}
+
+        // Starts a stage of a job. A stage that runs the compiler starts it and returns the
+        // process; other stages leave Process 0 and do their work in FinishStage. Returning
+        // false fails the stage.
+        virtual bool StartStage( void* pJob, SHADER_JOB_STAGE eStage, ShaderProcess& Process ) = 0;
+
+        // Called when a stage is complete: once its process exited, right after StartStage
+        // for a stage without a process, or when StartStage failed (bStarted false).
+        // Returns the stage to run next, SHADER_JOB_DONE or SHADER_JOB_FAILED.
+        virtual SHADER_JOB_STAGE FinishStage( void* pJob, SHADER_JOB_STAGE eStage, bool bStarted ) = 0;
+    };
+
+    // Timing of a run, in seconds
+    struct ShaderSchedulerStats
+    {
+        double          fTotalSeconds;
+        double          fFirstDoneSeconds;                      // Until the first job was done
+        double          fUrgentDoneSeconds;                     // Until every job of the most urgent priority was done or failed
+        double          fStageSeconds[SHADER_JOB_STAGE_COUNT];  // Summed over the jobs, processes included
+        unsigned int    uStageRuns[SHADER_JOB_STAGE_COUNT];
+        unsigned int    uJobs;
+        unsigned int    uDone;
+        unsigned int    uFailed;
+        unsigned int    uMaxRunning;                            // Most processes running at once
+    };
+
+    class ShaderCompileScheduler
+    {
+    public:
+
+        ShaderCompileScheduler( ShaderJobClient& Client, ShaderProcessPlatform& Platform );
+        ~ShaderCompileScheduler();
+
+        // Queues a job, to start with the given stage. Jobs with a lower uPriority get free
+        // slots first; jobs of the same priority are started in the order they were added.
+        void AddJob( void* pJob, SHADER_JOB_STAGE eFirstStage = SHADER_JOB_PREPROCESS, unsigned int uPriority = 0 );
+
+        // Runs the queued jobs until every one is done or failed, keeping up to uMaxProcesses
+        // processes running. Returns false if it stopped early because *pbAbort was set;
+        // processes still running are then closed without waiting. Without pbAbort the
+        // scheduler waits without a timeout.
+        bool Run( unsigned int uMaxProcesses, const volatile bool* pbAbort = NULL );
+
+        const ShaderSchedulerStats& GetStats() const { return m_Stats; }
+
+    private:
+
+        ShaderCompileScheduler( const ShaderCompileScheduler& );
+        ShaderCompileScheduler& operator=( const ShaderCompileScheduler& );
+
+        struct Job
+        {
+            void*               pJob;
+            SHADER_JOB_STAGE    eStage;
+            long long           iStageStart;                // Ticks of the scheduler's clock
+            unsigned int        uPriority;
+        };
+
+        // Runs stages until the job waits for a process, is done or failed. False if it
+        // didn't end up running a process.
+        bool Advance( Job& J );
+        void FinishStage( Job& J, bool bStarted );
+
+        // Queues a job behind the ones of its priority, or ahead of them if it continues
+        void Queue( const Job& J, bool bAhead );
+
+        ShaderJobClient&                m_Client;
+        ShaderProcessPlatform&          m_Platform;
+        std::deque<Job>                 m_Ready;
+        std::vector<Job>                m_Running;          // Parallel to m_Processes
+        std::vector<ShaderProcess>      m_Processes;
+        long long                       m_iRunStart;
+        unsigned int                    m_uUrgentPriority;  // Lowest priority of the run
+        unsigned int                    m_uUrgentLeft;      // Jobs of it not done or failed
+        ShaderSchedulerStats            m_Stats;
+    };
+}
+
+#endif // AMD_SDK_SHADER_COMPILE_SCHEDULER_H
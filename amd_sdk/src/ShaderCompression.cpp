@@ -0,0 +1,394 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderCompression.cpp
+//
+// LZ4 block compression of compiled shaders
+//--------------------------------------------------------------------------------------
+#include "ShaderCompression.h"
+
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace AMD
+{
+    // From the LZ4 block format
+    static const size_t MIN_MATCH = 4;
+    static const size_t LAST_LITERALS = 5;     // The last bytes are always literals
+    static const size_t MATCH_LIMIT = 12;      // No match starts within this of the end
+    static const size_t MAX_OFFSET = 65535;
+
+    static const unsigned int HASH_BITS = 12;
+
+
+    //--------------------------------------------------------------------------------------
+    static unsigned int Read32( const unsigned char* p )
+    {
+        unsigned int uValue;
+        memcpy( &uValue, p, sizeof( uValue ) );
+        return uValue;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static unsigned int HashPosition( const unsigned char* p )
+    {
+        return ( Read32( p ) * 2654435761u ) >> ( 32 - HASH_BITS );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Writes a length's 15 in the token and the rest in bytes of up to 255
+    //--------------------------------------------------------------------------------------
+    static bool WriteLength( size_t uLength, unsigned char*& pOut, const unsigned char* pOutEnd )
+    {
+        for ( uLength -= 15; ; uLength -= 255 )
+        {
+            if ( pOut >= pOutEnd )
+            {
+                return false;
+            }
+            *pOut++ = (unsigned char)( ( uLength >= 255 ) ? 255 : uLength );
+            if ( uLength < 255 )
+            {
+                return true;
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Writes literals and the match after them, if uMatchLength isn't 0
+    //--------------------------------------------------------------------------------------
+    static bool WriteSequence( const unsigned char* pLiterals, size_t uLiterals, size_t uOffset, size_t uMatchLength,
+        unsigned char*& pOut, const unsigned char* pOutEnd )
+    {
+        if ( pOut >= pOutEnd )
+        {
+            return false;
+        }
+
+        unsigned char* pToken = pOut++;
+        *pToken = (unsigned char)( ( ( uLiterals >= 15 ) ? 15 : uLiterals ) << 4 );
+        if ( uLiterals >= 15 && !WriteLength( uLiterals, pOut, pOutEnd ) )
+        {
+            return false;
+        }
+
+        if ( uLiterals > (size_t)( pOutEnd - pOut ) )
+        {
+            return false;
+        }
+        if ( uLiterals > 0 )
+        {
+            memcpy( pOut, pLiterals, uLiterals );
+            pOut += uLiterals;
+        }
+
+        if ( uMatchLength == 0 )
+        {
+            return true;
+        }
+
+        if ( pOutEnd - pOut < 2 )
+        {
+            return false;
+        }
+        *pOut++ = (unsigned char)( uOffset & 0xFF );
+        *pOut++ = (unsigned char)( uOffset >> 8 );
+
+        const size_t uLength = uMatchLength - MIN_MATCH;
+        *pToken |= (unsigned char)( ( uLength >= 15 ) ? 15 : uLength );
+        return uLength < 15 || WriteLength( uLength, pOut, pOutEnd );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    size_t ShaderCompressBound( size_t uSize )
+    {
+        return uSize + uSize / 255 + 16;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    size_t ShaderCompress( const void* pSrc, size_t uSrcSize, void* pDst, size_t uDstCapacity )
+    {
+        const unsigned char* const pStart = (const unsigned char*)pSrc;
+        const unsigned char* const pEnd = pStart + uSrcSize;
+        unsigned char* pOut = (unsigned char*)pDst;
+        const unsigned char* const pOutEnd = pOut + uDstCapacity;
+
+        const unsigned char* pIn = pStart;
+        const unsigned char* pAnchor = pStart;
+
+        if ( uSrcSize > MATCH_LIMIT )
+        {
+            // Last position seen of each hash, from the start
+            std::vector<unsigned int> Table( 1 << HASH_BITS, 0 );
+
+            const unsigned char* const pMatchStartLimit = pEnd - MATCH_LIMIT;
+            const unsigned char* const pMatchEndLimit = pEnd - LAST_LITERALS;
+
+            Table[ HashPosition( pIn ) ] = 0;
+            pIn++;
+
+            while ( pIn <= pMatchStartLimit )
+            {
+                const unsigned int uHash = HashPosition( pIn );
+                const unsigned char* pCandidate = pStart + Table[uHash];
+                Table[uHash] = (unsigned int)( pIn - pStart );
+
+                if ( pCandidate >= pIn || (size_t)( pIn - pCandidate ) > MAX_OFFSET || Read32( pCandidate ) != Read32( pIn ) )
+                {
+                    // Skips faster through data that doesn't match
+                    pIn += 1 + ( ( pIn - pAnchor ) >> 6 );
+                    continue;
+                }
+
+                // Back over literals that match too
+                while ( pIn > pAnchor && pCandidate > pStart && pIn[-1] == pCandidate[-1] )
+                {
+                    pIn--;
+                    pCandidate--;
+                }
+
+                size_t uLength = MIN_MATCH;
+                while ( pIn + uLength < pMatchEndLimit && pIn[uLength] == pCandidate[uLength] )
+                {
+                    uLength++;
+                }
+
+                if ( !WriteSequence( pAnchor, pIn - pAnchor, pIn - pCandidate, uLength, pOut, pOutEnd ) )
+                {
+                    return 0;
+                }
+
+                pIn += uLength;
+                pAnchor = pIn;
+
+                // Where the match ended often starts the next one
+                if ( pIn <= pMatchStartLimit )
+                {
+                    Table[ HashPosition( pIn - 2 ) ] = (unsigned int)( pIn - 2 - pStart );
+                }
+            }
+        }
+
+        if ( !WriteSequence( pAnchor, pEnd - pAnchor, 0, 0, pOut, pOutEnd ) )
+        {
+            return 0;
+        }
+
+        return pOut - (unsigned char*)pDst;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Copies 8 bytes at a time, so up to 7 bytes past the end, where the caller left room.
+    // Also copies a match at least 8 bytes back, which repeats what it copies.
+    //--------------------------------------------------------------------------------------
+    static void WildCopy( unsigned char* pDst, const unsigned char* pSrc, size_t uSize )
+    {
+        unsigned char* const pEnd = pDst + uSize;
+        do
+        {
+            memcpy( pDst, pSrc, 8 );
+            pDst += 8;
+            pSrc += 8;
+        }
+        while ( pDst < pEnd );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Reads the bytes of a length after the token's 15, false if they run past the input
+    //--------------------------------------------------------------------------------------
+    static bool ReadLength( size_t& uLength, const unsigned char*& pIn, const unsigned char* pInEnd )
+    {
+        unsigned char uByte;
+        do
+        {
+            if ( pIn >= pInEnd )
+            {
+                return false;
+            }
+            uByte = *pIn++;
+            uLength += uByte;
+        }
+        while ( uByte == 255 );
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderDecompress( const void* pSrc, size_t uSrcSize, void* pDst, size_t uDstSize )
+    {
+        const unsigned char* pIn = (const unsigned char*)pSrc;
+        const unsigned char* const pInEnd = pIn + uSrcSize;
+        unsigned char* const pOutStart = (unsigned char*)pDst;
+        unsigned char* pOut = pOutStart;
+        unsigned char* const pOutEnd = pOut + uDstSize;
+
+        for ( ;; )
+        {
+            if ( pIn >= pInEnd )
+            {
+                return false;
+            }
+            const unsigned char uToken = *pIn++;
+
+            size_t uLiterals = uToken >> 4;
+            if ( uLiterals == 15 && !ReadLength( uLiterals, pIn, pInEnd ) )
+            {
+                return false;
+            }
+            if ( uLiterals > (size_t)( pInEnd - pIn ) || uLiterals > (size_t)( pOutEnd - pOut ) )
+            {
+                return false;
+            }
+            if ( uLiterals + 8 <= (size_t)( pInEnd - pIn ) && uLiterals + 8 <= (size_t)( pOutEnd - pOut ) )
+            {
+                WildCopy( pOut, pIn, uLiterals );
+            }
+            else
+            {
+                memcpy( pOut, pIn, uLiterals );
+            }
+            pIn += uLiterals;
+            pOut += uLiterals;
+
+            // The last sequence has no match
+            if ( pIn == pInEnd )
+            {
+                return pOut == pOutEnd;
+            }
+
+            if ( pInEnd - pIn < 2 )
+            {
+                return false;
+            }
+            const size_t uOffset = pIn[0] | ( pIn[1] << 8 );
+            pIn += 2;
+            if ( uOffset == 0 || uOffset > (size_t)( pOut - pOutStart ) )
+            {
+                return false;
+            }
+
+            size_t uLength = uToken & 15;
+            if ( uLength == 15 && !ReadLength( uLength, pIn, pInEnd ) )
+            {
+                return false;
+            }
+            uLength += MIN_MATCH;
+            if ( uLength > (size_t)( pOutEnd - pOut ) )
+            {
+                return false;
+            }
+
+            // A match closer than its length repeats what it copies
+            const unsigned char* pMatch = pOut - uOffset;
+            if ( uOffset >= 8 && uLength + 8 <= (size_t)( pOutEnd - pOut ) )
+            {
+                WildCopy( pOut, pMatch, uLength );
+                pOut += uLength;
+            }
+            else if ( uOffset >= uLength )
+            {
+                memcpy( pOut, pMatch, uLength );
+                pOut += uLength;
+            }
+            else
+            {
+                for ( size_t i = 0; i < uLength; i++ )
+                {
+                    *pOut++ = *pMatch++;
+                }
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    struct ParallelForState
+    {
+        std::atomic<size_t>     uNext;
+        size_t                  uCount;
+        void                    (*pFunction)( void* pContext, size_t uIndex );
+        void                    (*pThreadExit)( void* pContext );
+        void*                   pContext;
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    static void RunParallelFor( ParallelForState* pState )
+    {
+        for ( size_t i = pState->uNext++; i < pState->uCount; i = pState->uNext++ )
+        {
+            pState->pFunction( pState->pContext, i );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void RunParallelForThread( ParallelForState* pState )
+    {
+        RunParallelFor( pState );
+
+        if ( pState->pThreadExit )
+        {
+            pState->pThreadExit( pState->pContext );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderParallelFor( size_t uCount, unsigned int uThreads, void (*pFunction)( void* pContext, size_t uIndex ), void* pContext,
+                            void (*pThreadExit)( void* pContext ) )
+    {
+        ParallelForState State;
+        State.uNext = 0;
+        State.uCount = uCount;
+        State.pFunction = pFunction;
+        State.pThreadExit = pThreadExit;
+        State.pContext = pContext;
+
+        // One index per thread at least
+        const size_t uExtraThreads = ( uThreads > 1 && uCount > 1 ) ? ( ( uThreads < uCount ) ? uThreads : uCount ) - 1 : 0;
+
+        std::vector<std::thread> Threads;
+        for ( size_t i = 0; i < uExtraThreads; i++ )
+        {
+            Threads.push_back( std::thread( RunParallelForThread, &State ) );
+        }
+
+        RunParallelFor( &State );
+
+        for ( size_t i = 0; i < Threads.size(); i++ )
+        {
+            Threads[i].join();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderCompression.h
+//
+// Compression of compiled shaders in the LZ4 block format, which decompresses at several
+// GB/s per core, so a compressed ShaderArchive reads fewer bytes from disk at start-up
+// without the decompression showing up next to creating the shaders. Compression is the
+// greedy single-pass kind, as LZ4's fast mode, since it runs only after shaders compile.
+//
+// Any LZ4 block decompressor reads what ShaderCompress writes. ShaderDecompress checks
+// every length and offset against the buffers it was given, so a damaged blob fails to
+// decompress rather than reading or writing out of bounds.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_COMPRESSION_H
+#define AMD_SDK_SHADER_COMPRESSION_H
+
+#include <stddef.h>
+
+namespace AMD
+{
+    // Most bytes ShaderCompress writes for uSize bytes
+    size_t ShaderCompressBound( size_t uSize );
+
+    // Bytes written to pDst, or 0 if they wouldn't fit in uDstCapacity
+    size_t ShaderCompress( const void* pSrc, size_t uSrcSize, void* pDst, size_t uDstCapacity );
+
+    // Decompresses exactly uDstSize bytes, false if the blob is damaged or of another size
+    bool ShaderDecompress( const void* pSrc, size_t uSrcSize, void* pDst, size_t uDstSize );
+
+    // Calls pFunction for every index below uCount, on up to uThreads threads counting the
+    // calling one, and returns once all calls did. pThreadExit, if any, is called on each
+    // thread it started right before that thread exits.
+    void ShaderParallelFor( size_t uCount, unsigned int uThreads, void (*pFunction)( void* pContext, size_t uIndex ), void* pContext,
+                            void (*pThreadExit)( void* pContext ) = NULL );
+}
+
+#endif // AMD_SDK_SHADER_COMPRESSION_H
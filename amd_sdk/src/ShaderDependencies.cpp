@@ -0,0 +1,572 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderDependencies.cpp
+//
+// Include scanning and the include dependency graph of shader sources
+//--------------------------------------------------------------------------------------
+#include "ShaderDependencies.h"
+#include "ShaderHash.h"
+#include "MappedFile.h"
+
+#include <string.h>
+
+namespace AMD
+{
+    static const unsigned int GRAPH_MAGIC = 0x31474453;     // "SDG1"
+    static const unsigned int GRAPH_VERSION = 1;
+
+#ifdef _WIN32
+    static const wchar_t PATH_SEPARATOR = L'\\';
+#else
+    static const wchar_t PATH_SEPARATOR = L'/';
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    // Skips spaces, line continuations and block comments
+    //--------------------------------------------------------------------------------------
+    static const char* SkipSpace( const char* p, const char* pEnd )
+    {
+        while ( p < pEnd )
+        {
+            if ( *p == ' ' || *p == '\t' || *p == '\r' || *p == '\f' || *p == '\v' )
+            {
+                p++;
+            }
+            else if ( *p == '\\' && p + 1 < pEnd && p[1] == '\n' )
+            {
+                p += 2;
+            }
+            else if ( *p == '\\' && p + 2 < pEnd && p[1] == '\r' && p[2] == '\n' )
+            {
+                p += 3;
+            }
+            else if ( *p == '/' && p + 1 < pEnd && p[1] == '*' )
+            {
+                p += 2;
+                while ( p + 1 < pEnd && !( p[0] == '*' && p[1] == '/' ) )
+                {
+                    p++;
+                }
+                p = ( p + 1 < pEnd ) ? p + 2 : pEnd;
+            }
+            else
+            {
+                break;
+            }
+        }
+        return p;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ScanShaderIncludes( const char* pData, size_t uSize, std::vector<std::string>& Includes )
+    {
+        static const char szInclude[] = "include";
+        const size_t uIncludeLength = sizeof( szInclude ) - 1;
+
+        const char* p = pData;
+        const char* pEnd = pData + uSize;
+        bool bLineStart = true;
+
+        while ( ( p = SkipSpace( p, pEnd ) ) < pEnd )
+        {
+            if ( *p == '\n' )
+            {
+                bLineStart = true;
+                p++;
+            }
+            else if ( *p == '#' && bLineStart )
+            {
+                p = SkipSpace( p + 1, pEnd );
+                const char* pDirective = p;
+                while ( p < pEnd && ( ( *p >= 'a' && *p <= 'z' ) || ( *p >= 'A' && *p <= 'Z' ) || ( *p >= '0' && *p <= '9' ) || *p == '_' ) )
+                {
+                    p++;
+                }
+
+                if ( (size_t)( p - pDirective ) == uIncludeLength && memcmp( pDirective, szInclude, uIncludeLength ) == 0 )
+                {
+                    p = SkipSpace( p, pEnd );
+                    if ( p < pEnd && ( *p == '"' || *p == '<' ) )
+                    {
+                        const char cClose = ( *p == '"' ) ? '"' : '>';
+                        const char* pName = ++p;
+                        while ( p < pEnd && *p != cClose && *p != '\n' )
+                        {
+                            p++;
+                        }
+                        if ( p < pEnd && *p == cClose )
+                        {
+                            Includes.push_back( std::string( pName, p ) );
+                            p++;
+                        }
+                    }
+                }
+
+                // The rest of the line is scanned like any other
+                bLineStart = false;
+            }
+            else if ( *p == '/' && p + 1 < pEnd && p[1] == '/' )
+            {
+                // To the end of the line, which a continuation extends
+                while ( p < pEnd && *p != '\n' )
+                {
+                    p += ( *p == '\\' && p + 1 < pEnd ) ? 2 : 1;
+                }
+                bLineStart = false;
+            }
+            else if ( *p == '"' || *p == '\'' )
+            {
+                const char cQuote = *p++;
+                while ( p < pEnd && *p != cQuote && *p != '\n' )
+                {
+                    p += ( *p == '\\' && p + 1 < pEnd ) ? 2 : 1;
+                }
+                p = ( p < pEnd && *p == cQuote ) ? p + 1 : p;
+                bLineStart = false;
+            }
+            else
+            {
+                bLineStart = false;
+                p++;
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Directory of a path, with its separator
+    //--------------------------------------------------------------------------------------
+    static std::wstring GetDirectory( const std::wstring& Path )
+    {
+        const size_t uSeparator = Path.find_last_of( L"\\/" );
+        return ( uSeparator == std::wstring::npos ) ? std::wstring() : Path.substr( 0, uSeparator + 1 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Removes . and .. from a path, which Windows doesn't do for \\?\ paths, and uses one
+    // separator throughout, so each file has one name in the graph
+    //--------------------------------------------------------------------------------------
+    static std::wstring NormalizePath( const std::wstring& Path )
+    {
+        std::vector<std::wstring> Parts;
+        size_t uStart = 0;
+
+        for ( size_t i = 0; i <= Path.size(); i++ )
+        {
+            if ( i < Path.size() && Path[i] != L'\\' && Path[i] != L'/' )
+            {
+                continue;
+            }
+
+            const std::wstring Part = Path.substr( uStart, i - uStart );
+            uStart = i + 1;
+
+            if ( Part == L"." )
+            {
+                continue;
+            }
+            if ( Part == L".." && !Parts.empty() && !Parts.back().empty() && Parts.back() != L".." && Parts.back() != L"?" )
+            {
+                Parts.pop_back();
+                continue;
+            }
+            Parts.push_back( Part );
+        }
+
+        std::wstring Normalized;
+        for ( size_t i = 0; i < Parts.size(); i++ )
+        {
+            if ( i > 0 )
+            {
+                Normalized += PATH_SEPARATOR;
+            }
+            Normalized += Parts[i];
+        }
+        return Normalized;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderDependencyGraph::ShaderDependencyGraph()
+        : m_uFilesLookedUp( 0 )
+        , m_uFilesRead( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderDependencyGraph::BeginCheck()
+    {
+        for ( size_t i = 0; i < m_Files.size(); i++ )
+        {
+            m_Files[i].bChecked = false;
+        }
+        m_uFilesLookedUp = 0;
+        m_uFilesRead = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderDependencyGraph::BeginCheck( const std::vector<std::wstring>& ChangedFiles )
+    {
+        for ( size_t i = 0; i < ChangedFiles.size(); i++ )
+        {
+            std::map<std::wstring, unsigned int>::const_iterator it = m_FileIndices.find( NormalizePath( ChangedFiles[i] ) );
+            if ( it != m_FileIndices.end() )
+            {
+                m_Files[ it->second ].bChecked = false;
+            }
+        }
+        m_uFilesLookedUp = 0;
+        m_uFilesRead = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned int ShaderDependencyGraph::AddFile( const std::wstring& Name )
+    {
+        std::map<std::wstring, unsigned int>::const_iterator it = m_FileIndices.find( Name );
+        if ( it != m_FileIndices.end() )
+        {
+            return it->second;
+        }
+
+        File NewFile;
+        NewFile.Name = Name;
+        NewFile.uModifiedTime = 0;
+        NewFile.uSize = 0;
+        NewFile.uContentHash = 0;
+        NewFile.bExists = false;
+        NewFile.bChecked = false;
+
+        const unsigned int uFile = (unsigned int)m_Files.size();
+        m_Files.push_back( NewFile );
+        m_FileIndices[Name] = uFile;
+        return uFile;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    std::wstring ShaderDependencyGraph::FindInclude( const std::wstring& Including, const std::string& Include, const std::wstring& SourceDirectory ) const
+    {
+        // Include names are ASCII in practice
+        const std::wstring Name( Include.begin(), Include.end() );
+
+        const std::wstring NextToIncluding = NormalizePath( GetDirectory( Including ) + Name );
+        unsigned long long uModifiedTime, uSize;
+        if ( GetFileInfo( NextToIncluding.c_str(), uModifiedTime, uSize ) )
+        {
+            return NextToIncluding;
+        }
+
+        const std::wstring NextToSource = NormalizePath( SourceDirectory + Name );
+        if ( GetFileInfo( NextToSource.c_str(), uModifiedTime, uSize ) )
+        {
+            return NextToSource;
+        }
+
+        // Not found. A shader including it fails to compile, so isn't recorded as built,
+        // and is preprocessed again however the include appears.
+        return NextToIncluding;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Brings the record of a file up to date, reading it only if its time or size changed
+    //--------------------------------------------------------------------------------------
+    void ShaderDependencyGraph::CheckFile( unsigned int uFile, const std::wstring& SourceDirectory )
+    {
+        if ( m_Files[uFile].bChecked )
+        {
+            return;
+        }
+        m_Files[uFile].bChecked = true;
+        m_uFilesLookedUp++;
+
+        unsigned long long uModifiedTime = 0, uSize = 0;
+        const bool bExists = GetFileInfo( m_Files[uFile].Name.c_str(), uModifiedTime, uSize );
+
+        if ( bExists == m_Files[uFile].bExists && uModifiedTime == m_Files[uFile].uModifiedTime && uSize == m_Files[uFile].uSize )
+        {
+            return;
+        }
+
+        std::vector<std::string> Includes;
+        unsigned long long uContentHash = 0;
+
+        if ( bExists )
+        {
+            MappedFile Source;
+            if ( Source.Open( m_Files[uFile].Name.c_str() ) )
+            {
+                uContentHash = ShaderHasher::Hash( Source.GetData(), Source.GetSize() );
+                ScanShaderIncludes( Source.GetData(), Source.GetSize(), Includes );
+            }
+            m_uFilesRead++;
+        }
+
+        std::vector<unsigned int> IncludeIndices;
+        for ( size_t i = 0; i < Includes.size(); i++ )
+        {
+            // May grow m_Files
+            IncludeIndices.push_back( AddFile( FindInclude( m_Files[uFile].Name, Includes[i], SourceDirectory ) ) );
+        }
+
+        File& Record = m_Files[uFile];
+        Record.bExists = bExists;
+        Record.uModifiedTime = uModifiedTime;
+        Record.uSize = uSize;
+        Record.uContentHash = uContentHash;
+        Record.Includes.swap( IncludeIndices );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderDependencyGraph::GetDependencyHash( const wchar_t* szSourceFile, unsigned long long uSeed )
+    {
+        const std::wstring SourceFile = NormalizePath( szSourceFile );
+        const std::wstring SourceDirectory = GetDirectory( SourceFile );
+
+        ShaderHasher Hasher( uSeed );
+        std::vector<unsigned char> Visited;
+        std::vector<unsigned int> Stack( 1, AddFile( SourceFile ) );
+
+        while ( !Stack.empty() )
+        {
+            const unsigned int uFile = Stack.back();
+            Stack.pop_back();
+
+            if ( uFile < Visited.size() && Visited[uFile] )
+            {
+                continue;
+            }
+
+            CheckFile( uFile, SourceDirectory );
+
+            Visited.resize( m_Files.size(), 0 );
+            Visited[uFile] = 1;
+
+            const File& Record = m_Files[uFile];
+            const unsigned char bExists = Record.bExists ? 1 : 0;
+            Hasher.Update( Record.Name.data(), Record.Name.size() * sizeof( wchar_t ) );
+            Hasher.Update( &bExists, sizeof( bExists ) );
+            Hasher.Update( &Record.uContentHash, sizeof( Record.uContentHash ) );
+
+            // In reverse, so they are hashed in the order they are included
+            for ( size_t i = Record.Includes.size(); i > 0; i-- )
+            {
+                Stack.push_back( Record.Includes[ i - 1 ] );
+            }
+        }
+
+        return Hasher.Digest();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderDependencyGraph::IsTargetUpToDate( unsigned long long uTarget, unsigned long long uDependencyHash ) const
+    {
+        std::map<unsigned long long, unsigned long long>::const_iterator it = m_Targets.find( uTarget );
+        return it != m_Targets.end() && it->second == uDependencyHash;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderDependencyGraph::SetTarget( unsigned long long uTarget, unsigned long long uDependencyHash )
+    {
+        m_Targets[uTarget] = uDependencyHash;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderDependencyGraph::ForgetTarget( unsigned long long uTarget )
+    {
+        m_Targets.erase( uTarget );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    template< typename T >
+    static void Put( std::vector<char>& Data, const T& Value )
+    {
+        const char* p = (const char*)&Value;
+        Data.insert( Data.end(), p, p + sizeof( T ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    template< typename T >
+    static bool Get( const char*& p, const char* pEnd, T& Value )
+    {
+        if ( (size_t)( pEnd - p ) < sizeof( T ) )
+        {
+            return false;
+        }
+        memcpy( &Value, p, sizeof( T ) );
+        p += sizeof( T );
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // The file is a header, the files with their includes, the targets, and a hash of all
+    // of it. Names are stored as 32 bit code units, read back on the platform that wrote them.
+    //--------------------------------------------------------------------------------------
+    bool ShaderDependencyGraph::Save( const wchar_t* szFileName ) const
+    {
+        std::vector<char> Data;
+        Put( Data, GRAPH_MAGIC );
+        Put( Data, GRAPH_VERSION );
+        Put( Data, (unsigned int)m_Files.size() );
+        Put( Data, (unsigned int)m_Targets.size() );
+
+        for ( size_t i = 0; i < m_Files.size(); i++ )
+        {
+            const File& Record = m_Files[i];
+            Put( Data, Record.uModifiedTime );
+            Put( Data, Record.uSize );
+            Put( Data, Record.uContentHash );
+            Put( Data, (unsigned int)( Record.bExists ? 1 : 0 ) );
+            Put( Data, (unsigned int)Record.Name.size() );
+            Put( Data, (unsigned int)Record.Includes.size() );
+            for ( size_t c = 0; c < Record.Name.size(); c++ )
+            {
+                Put( Data, (unsigned int)Record.Name[c] );
+            }
+            for ( size_t c = 0; c < Record.Includes.size(); c++ )
+            {
+                Put( Data, Record.Includes[c] );
+            }
+        }
+
+        for ( std::map<unsigned long long, unsigned long long>::const_iterator it = m_Targets.begin(); it != m_Targets.end(); it++ )
+        {
+            Put( Data, it->first );
+            Put( Data, it->second );
+        }
+
+        Put( Data, ShaderHasher::Hash( &Data[0], Data.size() ) );
+
+        // Written to a new file that replaces the old one, so a crash leaves either
+        const std::wstring NewFileName = std::wstring( szFileName ) + L".new";
+        FILE* pFile = OpenFileStream( NewFileName.c_str(), "wb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        bool bSuccess = fwrite( &Data[0], 1, Data.size(), pFile ) == Data.size() && FlushFileToDisk( pFile );
+        fclose( pFile );
+
+        bSuccess = bSuccess && ReplaceFileWith( szFileName, NewFileName.c_str() );
+        if ( !bSuccess )
+        {
+            RemoveFile( NewFileName.c_str() );
+        }
+
+        return bSuccess;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderDependencyGraph::Load( const wchar_t* szFileName )
+    {
+        m_Files.clear();
+        m_FileIndices.clear();
+        m_Targets.clear();
+
+        MappedFile Graph;
+        if ( !Graph.Open( szFileName ) || Graph.GetSize() < sizeof( unsigned long long ) )
+        {
+            return false;
+        }
+
+        const char* p = Graph.GetData();
+        const char* pEnd = p + Graph.GetSize() - sizeof( unsigned long long );
+
+        unsigned long long uHash;
+        memcpy( &uHash, pEnd, sizeof( uHash ) );
+        if ( ShaderHasher::Hash( p, pEnd - p ) != uHash )
+        {
+            return false;
+        }
+
+        unsigned int uMagic, uVersion, uFileCount, uTargetCount;
+        bool bSuccess = Get( p, pEnd, uMagic ) && Get( p, pEnd, uVersion ) && Get( p, pEnd, uFileCount ) && Get( p, pEnd, uTargetCount ) &&
+            uMagic == GRAPH_MAGIC && uVersion == GRAPH_VERSION;
+
+        for ( unsigned int i = 0; bSuccess && i < uFileCount; i++ )
+        {
+            File Record;
+            unsigned int uExists, uNameLength, uIncludeCount;
+            bSuccess = Get( p, pEnd, Record.uModifiedTime ) && Get( p, pEnd, Record.uSize ) && Get( p, pEnd, Record.uContentHash ) &&
+                Get( p, pEnd, uExists ) && Get( p, pEnd, uNameLength ) && Get( p, pEnd, uIncludeCount );
+
+            for ( unsigned int c = 0; bSuccess && c < uNameLength; c++ )
+            {
+                unsigned int uChar = 0;
+                bSuccess = Get( p, pEnd, uChar );
+                Record.Name += (wchar_t)uChar;
+            }
+            for ( unsigned int c = 0; bSuccess && c < uIncludeCount; c++ )
+            {
+                unsigned int uInclude = 0;
+                bSuccess = Get( p, pEnd, uInclude ) && uInclude < uFileCount;
+                Record.Includes.push_back( uInclude );
+            }
+
+            Record.bExists = ( uExists != 0 );
+            Record.bChecked = false;
+
+            if ( bSuccess )
+            {
+                m_FileIndices[Record.Name] = (unsigned int)m_Files.size();
+                m_Files.push_back( Record );
+            }
+        }
+
+        for ( unsigned int i = 0; bSuccess && i < uTargetCount; i++ )
+        {
+            unsigned long long uTarget, uDependencyHash;
+            bSuccess = Get( p, pEnd, uTarget ) && Get( p, pEnd, uDependencyHash );
+            if ( bSuccess )
+            {
+                m_Targets[uTarget] = uDependencyHash;
+            }
+        }
+
+        if ( !bSuccess || p != pEnd || m_FileIndices.size() != m_Files.size() )
+        {
+            m_Files.clear();
+            m_FileIndices.clear();
+            m_Targets.clear();
+            return false;
+        }
+
+        return true;
+    }
+}
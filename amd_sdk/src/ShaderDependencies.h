@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderDependencies.h
+//
+// The files each shader source includes, directly or not, so the ShaderCache can tell
+// without running the preprocessor that a shader hasn't changed.
+//
+// ShaderDependencyGraph records the time, size and content hash of every source file it
+// has seen, with the files it includes. While a file's time and size stay the same, its
+// recorded hash and includes are used, so checking an unchanged shader only looks up its
+// files. A file that changed is read again, and its includes scanned again. A shader's
+// dependency hash covers all of its files, and is compared with the one recorded when it
+// was last built. The graph is saved next to the cache between runs.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_DEPENDENCIES_H
+#define AMD_SDK_SHADER_DEPENDENCIES_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace AMD
+{
+    // Appends the file names of the #include directives in HLSL or C source, in order.
+    // Comments, string literals and line continuations are followed. Conditionals aren't
+    // evaluated, so includes in every branch are returned, and includes named by a macro
+    // are skipped.
+    void ScanShaderIncludes( const char* pData, size_t uSize, std::vector<std::string>& Includes );
+
+    class ShaderDependencyGraph
+    {
+    public:
+
+        ShaderDependencyGraph();
+
+        // Replaces the graph with the one saved in the file. False if it doesn't exist or
+        // isn't valid, which leaves the graph empty.
+        bool Load( const wchar_t* szFileName );
+        bool Save( const wchar_t* szFileName ) const;
+
+        // Starts a new check, in which each file is looked up again the first time it is
+        // needed
+        void BeginCheck();
+
+        // Starts a check in which only the given files, full paths, are looked up again,
+        // the others keeping what an earlier check found. For when a watcher reported what
+        // changed since then. Files the graph hasn't seen are left out, as a full check
+        // wouldn't look for them either until a file including them changes.
+        void BeginCheck( const std::vector<std::wstring>& ChangedFiles );
+
+        // Hash of a source file, of everything it includes, and of uSeed, e.g. a hash of
+        // the compiler's command line. Includes are looked for next to the file that
+        // includes them, then next to the source file.
+        unsigned long long GetDependencyHash( const wchar_t* szSourceFile, unsigned long long uSeed );
+
+        // The dependency hash a target, e.g. a compiled shader, was last built from
+        bool IsTargetUpToDate( unsigned long long uTarget, unsigned long long uDependencyHash ) const;
+        void SetTarget( unsigned long long uTarget, unsigned long long uDependencyHash );
+        void ForgetTarget( unsigned long long uTarget );
+
+        // Since the last BeginCheck
+        unsigned int GetFilesLookedUp() const { return m_uFilesLookedUp; }
+        unsigned int GetFilesRead() const { return m_uFilesRead; }
+
+    private:
+
+        struct File
+        {
+            std::wstring                Name;
+            unsigned long long          uModifiedTime;
+            unsigned long long          uSize;
+            unsigned long long          uContentHash;
+            std::vector<unsigned int>   Includes;       // Indices of the files
+            bool                        bExists;
+            bool                        bChecked;       // Since BeginCheck
+        };
+
+        unsigned int AddFile( const std::wstring& Name );
+        void CheckFile( unsigned int uFile, const std::wstring& SourceDirectory );
+        std::wstring FindInclude( const std::wstring& Including, const std::string& Include, const std::wstring& SourceDirectory ) const;
+
+        std::vector<File>                                   m_Files;
+        std::map<std::wstring, unsigned int>                m_FileIndices;
+        std::map<unsigned long long, unsigned long long>    m_Targets;
+        unsigned int                                        m_uFilesLookedUp;
+        unsigned int                                        m_uFilesRead;
+    };
+}
+
+#endif // AMD_SDK_SHADER_DEPENDENCIES_H
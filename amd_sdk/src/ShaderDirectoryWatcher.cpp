@@ -0,0 +1,649 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderDirectoryWatcher.cpp
+//
+// Watching a directory tree for changed files, and debouncing the changes
+//--------------------------------------------------------------------------------------
+#include "ShaderDirectoryWatcher.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined( __linux__ )
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <map>
+#endif
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    ShaderChangeDebouncer::ShaderChangeDebouncer( unsigned int uDebounceMs )
+        : m_uDebounceMs( uDebounceMs )
+        , m_bOverflow( false )
+        , m_iLastChangeMs( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderChangeDebouncer::AddChange( const std::wstring& File, long long iNowMs )
+    {
+        m_Files.insert( File );
+        m_iLastChangeMs = iNowMs;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderChangeDebouncer::AddOverflow( long long iNowMs )
+    {
+        m_bOverflow = true;
+        m_iLastChangeMs = iNowMs;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderChangeDebouncer::AddChanges( const ShaderFileChanges& Changes, long long iNowMs )
+    {
+        for ( size_t i = 0; i < Changes.Files.size(); i++ )
+        {
+            AddChange( Changes.Files[i], iNowMs );
+        }
+
+        if ( Changes.bOverflow )
+        {
+            AddOverflow( iNowMs );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderChangeDebouncer::Collect( long long iNowMs, ShaderFileChanges& Changes )
+    {
+        if ( !HasChanges() || iNowMs - m_iLastChangeMs < (long long)m_uDebounceMs )
+        {
+            return false;
+        }
+
+        Changes.Files.assign( m_Files.begin(), m_Files.end() );
+        Changes.bOverflow = m_bOverflow;
+
+        m_Files.clear();
+        m_bOverflow = false;
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned int ShaderChangeDebouncer::GetWaitMs( long long iNowMs ) const
+    {
+        if ( !HasChanges() )
+        {
+            return SHADER_WATCH_INFINITE;
+        }
+
+        const long long iElapsedMs = iNowMs - m_iLastChangeMs;
+        return ( iElapsedMs >= (long long)m_uDebounceMs ) ? 0 : (unsigned int)( m_uDebounceMs - iElapsedMs );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // What the watcher waits on for changes, on its thread
+    //--------------------------------------------------------------------------------------
+    class ShaderDirectoryWatcher::Source
+    {
+    public:
+
+        virtual ~Source() {}
+
+        // Waits up to uTimeoutMs for changes, and appends them. Returns early when woken.
+        virtual void Wait( unsigned int uTimeoutMs, ShaderFileChanges& Changes ) = 0;
+
+        // Makes Wait return, from any thread
+        virtual void Wake() = 0;
+
+        // Implementation for the platform this is built for. NULL if the directory can't be
+        // watched.
+        static Source* Open( const wchar_t* szDirectory );
+    };
+
+
+#ifdef _WIN32
+
+    //--------------------------------------------------------------------------------------
+    // Windows: ReadDirectoryChangesW on the whole tree, with overlapped I/O so that waiting
+    // for changes can be woken
+    //--------------------------------------------------------------------------------------
+    class WindowsWatchSource : public ShaderDirectoryWatcher::Source
+    {
+    public:
+
+        WindowsWatchSource()
+            : m_hDirectory( INVALID_HANDLE_VALUE )
+            , m_hWake( NULL )
+            , m_bReading( false )
+            , m_Buffer( 16 * 1024 )     // 64 KB, the most a read over the network may ask for
+        {
+            ZeroMemory( &m_Overlapped, sizeof( m_Overlapped ) );
+        }
+
+        virtual ~WindowsWatchSource()
+        {
+            if ( m_bReading )
+            {
+                DWORD dwBytes = 0;
+                CancelIo( m_hDirectory );
+                GetOverlappedResult( m_hDirectory, &m_Overlapped, &dwBytes, TRUE );
+            }
+
+            if ( m_hDirectory != INVALID_HANDLE_VALUE )
+            {
+                CloseHandle( m_hDirectory );
+            }
+            if ( m_Overlapped.hEvent )
+            {
+                CloseHandle( m_Overlapped.hEvent );
+            }
+            if ( m_hWake )
+            {
+                CloseHandle( m_hWake );
+            }
+        }
+
+        bool Open( const wchar_t* szDirectory )
+        {
+            m_hDirectory = CreateFileW( szDirectory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL );
+            m_Overlapped.hEvent = CreateEventW( NULL, TRUE, FALSE, NULL );
+            m_hWake = CreateEventW( NULL, FALSE, FALSE, NULL );
+
+            return m_hDirectory != INVALID_HANDLE_VALUE && m_Overlapped.hEvent && m_hWake && Read();
+        }
+
+        virtual void Wait( unsigned int uTimeoutMs, ShaderFileChanges& Changes )
+        {
+            HANDLE Handles[2] = { m_Overlapped.hEvent, m_hWake };
+
+            DWORD dwRet = WaitForMultipleObjects( 2, Handles, FALSE, ( uTimeoutMs == SHADER_WATCH_INFINITE ) ? INFINITE : uTimeoutMs );
+            if ( dwRet != WAIT_OBJECT_0 || !m_bReading )
+            {
+                return;
+            }
+
+            DWORD dwBytes = 0;
+            m_bReading = false;
+
+            // No bytes when more changed than fit in the buffer
+            if ( !GetOverlappedResult( m_hDirectory, &m_Overlapped, &dwBytes, FALSE ) || dwBytes == 0 )
+            {
+                Changes.bOverflow = true;
+            }
+            else
+            {
+                const char* p = (const char*)&m_Buffer[0];
+                for ( ;; )
+                {
+                    const FILE_NOTIFY_INFORMATION* pInfo = (const FILE_NOTIFY_INFORMATION*)p;
+                    Changes.Files.push_back( std::wstring( pInfo->FileName, pInfo->FileNameLength / sizeof( wchar_t ) ) );
+
+                    if ( pInfo->NextEntryOffset == 0 )
+                    {
+                        break;
+                    }
+                    p += pInfo->NextEntryOffset;
+                }
+            }
+
+            // Changes made before the next read starts are kept by the system
+            Read();
+        }
+
+        virtual void Wake()
+        {
+            SetEvent( m_hWake );
+        }
+
+    private:
+
+        bool Read()
+        {
+            ResetEvent( m_Overlapped.hEvent );
+            m_bReading = ReadDirectoryChangesW( m_hDirectory, &m_Buffer[0], (DWORD)( m_Buffer.size() * sizeof( DWORD ) ), TRUE,
+                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                NULL, &m_Overlapped, NULL ) != FALSE;
+            return m_bReading;
+        }
+
+        HANDLE                  m_hDirectory;
+        HANDLE                  m_hWake;
+        OVERLAPPED              m_Overlapped;
+        bool                    m_bReading;
+        std::vector<DWORD>      m_Buffer;           // Aligned as the records in it need
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderDirectoryWatcher::Source* ShaderDirectoryWatcher::Source::Open( const wchar_t* szDirectory )
+    {
+        WindowsWatchSource* pSource = new WindowsWatchSource();
+        if ( !pSource->Open( szDirectory ) )
+        {
+            delete pSource;
+            return NULL;
+        }
+        return pSource;
+    }
+
+#elif defined( __linux__ )
+
+    //--------------------------------------------------------------------------------------
+    // Paths are UTF-8 on POSIX
+    //--------------------------------------------------------------------------------------
+    static std::string ToUtf8( const std::wstring& Text )
+    {
+        std::string Utf8;
+        for ( size_t i = 0; i < Text.size(); i++ )
+        {
+            const unsigned int c = (unsigned int)Text[i];
+            if ( c < 0x80 )
+            {
+                Utf8 += (char)c;
+            }
+            else if ( c < 0x800 )
+            {
+                Utf8 += (char)( 0xC0 | ( c >> 6 ) );
+                Utf8 += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else if ( c < 0x10000 )
+            {
+                Utf8 += (char)( 0xE0 | ( c >> 12 ) );
+                Utf8 += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Utf8 += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else
+            {
+                Utf8 += (char)( 0xF0 | ( c >> 18 ) );
+                Utf8 += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                Utf8 += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Utf8 += (char)( 0x80 | ( c & 0x3F ) );
+            }
+        }
+        return Utf8;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Invalid sequences are taken byte by byte
+    //--------------------------------------------------------------------------------------
+    static std::wstring FromUtf8( const std::string& Utf8 )
+    {
+        std::wstring Text;
+        for ( size_t i = 0; i < Utf8.size(); )
+        {
+            const unsigned char c = (unsigned char)Utf8[i];
+            const size_t uLength = ( c >= 0xF0 ) ? 4 : ( c >= 0xE0 ) ? 3 : ( c >= 0xC0 ) ? 2 : 1;
+
+            unsigned int uChar = ( uLength == 1 ) ? c : ( c & ( 0x3F >> ( uLength - 1 ) ) );
+            bool bValid = ( i + uLength <= Utf8.size() );
+            for ( size_t j = 1; bValid && j < uLength; j++ )
+            {
+                const unsigned char Next = (unsigned char)Utf8[ i + j ];
+                bValid = ( Next & 0xC0 ) == 0x80;
+                uChar = ( uChar << 6 ) | ( Next & 0x3F );
+            }
+
+            if ( bValid )
+            {
+                Text += (wchar_t)uChar;
+                i += uLength;
+            }
+            else
+            {
+                Text += (wchar_t)c;
+                i++;
+            }
+        }
+        return Text;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Linux: inotify, which watches single directories, so each directory in the tree gets
+    // a watch, and directories that appear get one as they do
+    //--------------------------------------------------------------------------------------
+    class InotifyWatchSource : public ShaderDirectoryWatcher::Source
+    {
+    public:
+
+        InotifyWatchSource()
+            : m_iNotify( -1 )
+        {
+            m_iWake[0] = -1;
+            m_iWake[1] = -1;
+        }
+
+        virtual ~InotifyWatchSource()
+        {
+            if ( m_iNotify >= 0 )
+            {
+                close( m_iNotify );
+            }
+            if ( m_iWake[0] >= 0 )
+            {
+                close( m_iWake[0] );
+                close( m_iWake[1] );
+            }
+        }
+
+        bool Open( const wchar_t* szDirectory )
+        {
+            m_Root = ToUtf8( szDirectory );
+            while ( m_Root.size() > 1 && m_Root[ m_Root.size() - 1 ] == '/' )
+            {
+                m_Root.erase( m_Root.size() - 1 );
+            }
+
+            m_iNotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+            if ( m_iNotify < 0 || pipe( m_iWake ) != 0 )
+            {
+                return false;
+            }
+            fcntl( m_iWake[0], F_SETFL, O_NONBLOCK );
+
+            return AddWatches( std::string(), NULL );
+        }
+
+        virtual void Wait( unsigned int uTimeoutMs, ShaderFileChanges& Changes )
+        {
+            struct pollfd Fds[2];
+            Fds[0].fd = m_iNotify;
+            Fds[0].events = POLLIN;
+            Fds[0].revents = 0;
+            Fds[1].fd = m_iWake[0];
+            Fds[1].events = POLLIN;
+            Fds[1].revents = 0;
+
+            const int iTimeout = ( uTimeoutMs == SHADER_WATCH_INFINITE ) ? -1 : ( uTimeoutMs > (unsigned int)INT_MAX ) ? INT_MAX : (int)uTimeoutMs;
+            if ( poll( Fds, 2, iTimeout ) <= 0 )
+            {
+                return;
+            }
+
+            if ( Fds[1].revents )
+            {
+                char Drain[64];
+                while ( read( m_iWake[0], Drain, sizeof( Drain ) ) > 0 )
+                {
+                }
+            }
+
+            if ( ( Fds[0].revents & POLLIN ) == 0 )
+            {
+                return;
+            }
+
+            // Aligned for the events in it
+            struct inotify_event Events[ 16384 / sizeof( struct inotify_event ) ];
+            for ( ;; )
+            {
+                const ssize_t iRead = read( m_iNotify, Events, sizeof( Events ) );
+                if ( iRead <= 0 )
+                {
+                    break;
+                }
+
+                for ( const char* p = (const char*)Events; p < (const char*)Events + iRead; )
+                {
+                    const struct inotify_event* pEvent = (const struct inotify_event*)p;
+                    p += sizeof( struct inotify_event ) + pEvent->len;
+
+                    if ( pEvent->mask & IN_Q_OVERFLOW )
+                    {
+                        Changes.bOverflow = true;
+                        continue;
+                    }
+
+                    std::map<int, std::string>::const_iterator it = m_Directories.find( pEvent->wd );
+                    if ( it == m_Directories.end() )
+                    {
+                        continue;
+                    }
+
+                    if ( pEvent->mask & IN_IGNORED )
+                    {
+                        m_Directories.erase( pEvent->wd );
+                        continue;
+                    }
+
+                    std::string Name = it->second;
+                    if ( pEvent->len > 0 )
+                    {
+                        Name += Name.empty() ? "" : "/";
+                        Name += pEvent->name;
+                    }
+
+                    if ( pEvent->mask & IN_ISDIR )
+                    {
+                        // Files written into it before its watch was added are reported as found
+                        if ( pEvent->mask & ( IN_CREATE | IN_MOVED_TO ) )
+                        {
+                            AddWatches( Name, &Changes );
+                        }
+                        continue;
+                    }
+
+                    Changes.Files.push_back( FromUtf8( Name ) );
+                }
+            }
+        }
+
+        virtual void Wake()
+        {
+            const ssize_t iWritten = write( m_iWake[1], "", 1 );
+            (void)iWritten;
+        }
+
+    private:
+
+        static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+        // Watches a directory, given relative to the root, and those under it. The files
+        // in it are added to pChanges if given.
+        bool AddWatches( const std::string& Relative, ShaderFileChanges* pChanges )
+        {
+            const std::string Path = Relative.empty() ? m_Root : m_Root + "/" + Relative;
+
+            const int iWatch = inotify_add_watch( m_iNotify, Path.c_str(), WATCH_MASK );
+            if ( iWatch < 0 )
+            {
+                return false;
+            }
+            m_Directories[iWatch] = Relative;
+
+            DIR* pDirectory = opendir( Path.c_str() );
+            if ( !pDirectory )
+            {
+                return true;
+            }
+
+            while ( struct dirent* pEntry = readdir( pDirectory ) )
+            {
+                if ( strcmp( pEntry->d_name, "." ) == 0 || strcmp( pEntry->d_name, ".." ) == 0 )
+                {
+                    continue;
+                }
+
+                const std::string Name = Relative.empty() ? std::string( pEntry->d_name ) : Relative + "/" + pEntry->d_name;
+
+                struct stat Stat;
+                const bool bDirectory = ( pEntry->d_type == DT_DIR ) ||
+                    ( pEntry->d_type == DT_UNKNOWN && stat( ( m_Root + "/" + Name ).c_str(), &Stat ) == 0 && S_ISDIR( Stat.st_mode ) );
+
+                if ( bDirectory )
+                {
+                    AddWatches( Name, pChanges );
+                }
+                else if ( pChanges )
+                {
+                    pChanges->Files.push_back( FromUtf8( Name ) );
+                }
+            }
+            closedir( pDirectory );
+
+            return true;
+        }
+
+        int                             m_iNotify;
+        int                             m_iWake[2];         // A pipe
+        std::string                     m_Root;
+        std::map<int, std::string>      m_Directories;      // Of each watch, relative to the root
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderDirectoryWatcher::Source* ShaderDirectoryWatcher::Source::Open( const wchar_t* szDirectory )
+    {
+        InotifyWatchSource* pSource = new InotifyWatchSource();
+        if ( !pSource->Open( szDirectory ) )
+        {
+            delete pSource;
+            return NULL;
+        }
+        return pSource;
+    }
+
+#else
+
+    //--------------------------------------------------------------------------------------
+    // Not implemented on other platforms
+    //--------------------------------------------------------------------------------------
+    ShaderDirectoryWatcher::Source* ShaderDirectoryWatcher::Source::Open( const wchar_t* szDirectory )
+    {
+        (void)szDirectory;
+        return NULL;
+    }
+
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    static long long GetMilliseconds()
+    {
+        return (long long)std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderDirectoryWatcher::ShaderDirectoryWatcher()
+        : m_pSource( NULL )
+        , m_bStop( false )
+        , m_pCallback( NULL )
+        , m_pContext( NULL )
+        , m_uDebounceMs( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderDirectoryWatcher::~ShaderDirectoryWatcher()
+    {
+        Stop();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderDirectoryWatcher::Start( const wchar_t* szDirectory, unsigned int uDebounceMs, Callback pCallback, void* pContext )
+    {
+        Stop();
+
+        m_pSource = Source::Open( szDirectory );
+        if ( !m_pSource )
+        {
+            return false;
+        }
+
+        m_pCallback = pCallback;
+        m_pContext = pContext;
+        m_uDebounceMs = uDebounceMs;
+        m_bStop = false;
+        m_Thread = std::thread( &ShaderDirectoryWatcher::Run, this );
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderDirectoryWatcher::Stop()
+    {
+        if ( m_Thread.joinable() )
+        {
+            m_bStop = true;
+            m_pSource->Wake();
+            m_Thread.join();
+        }
+
+        delete m_pSource;
+        m_pSource = NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // The watcher's thread: waits for changes, or for the debounce window to pass, and
+    // hands over the changes once it did
+    //--------------------------------------------------------------------------------------
+    void ShaderDirectoryWatcher::Run()
+    {
+        ShaderChangeDebouncer Debouncer( m_uDebounceMs );
+
+        while ( !m_bStop )
+        {
+            ShaderFileChanges Changes;
+            Changes.bOverflow = false;
+
+            m_pSource->Wait( Debouncer.GetWaitMs( GetMilliseconds() ), Changes );
+            if ( m_bStop )
+            {
+                break;
+            }
+
+            Debouncer.AddChanges( Changes, GetMilliseconds() );
+
+            ShaderFileChanges Quiet;
+            if ( Debouncer.Collect( GetMilliseconds(), Quiet ) && !m_pCallback( m_pContext, Quiet ) )
+            {
+                Debouncer.AddChanges( Quiet, GetMilliseconds() );
+            }
+        }
+    }
+}
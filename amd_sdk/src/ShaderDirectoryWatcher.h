@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderDirectoryWatcher.h
+//
+// Watches a shader directory and everything under it, and reports which files changed,
+// with ReadDirectoryChangesW on Windows and inotify on Linux.
+//
+// An editor saving a file typically writes, renames and touches it, and may save several
+// files at once, each step a change of its own. ShaderChangeDebouncer holds the changes
+// back until none came for a while, so they are reported once, as one set of files.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_DIRECTORY_WATCHER_H
+#define AMD_SDK_SHADER_DIRECTORY_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+
+namespace AMD
+{
+    // Files that changed under a watched directory, with paths relative to it
+    struct ShaderFileChanges
+    {
+        std::vector<std::wstring>   Files;
+        bool                        bOverflow;      // More changed than the platform could report, so any file may have
+    };
+
+    // Collects changes, and lets them through once uDebounceMs passed without another.
+    // Times are in milliseconds, from any start.
+    class ShaderChangeDebouncer
+    {
+    public:
+
+        explicit ShaderChangeDebouncer( unsigned int uDebounceMs );
+
+        void AddChange( const std::wstring& File, long long iNowMs );
+        void AddOverflow( long long iNowMs );
+        void AddChanges( const ShaderFileChanges& Changes, long long iNowMs );
+
+        // Moves the changes out once they are quiet. False if there are none yet.
+        bool Collect( long long iNowMs, ShaderFileChanges& Changes );
+
+        // Until Collect may let the changes through; SHADER_WATCH_INFINITE without any
+        unsigned int GetWaitMs( long long iNowMs ) const;
+
+        bool HasChanges() const { return m_bOverflow || !m_Files.empty(); }
+
+    private:
+
+        unsigned int                m_uDebounceMs;
+        std::set<std::wstring>      m_Files;
+        bool                        m_bOverflow;
+        long long                   m_iLastChangeMs;
+    };
+
+    static const unsigned int SHADER_WATCH_INFINITE = 0xFFFFFFFF;
+
+    class ShaderDirectoryWatcher
+    {
+    public:
+
+        // Called on the watcher's thread with debounced changes. Returning false hands the
+        // same changes over again, with any that came meanwhile, after another window,
+        // e.g. while the shaders are still being generated.
+        typedef bool (*Callback)( void* pContext, const ShaderFileChanges& Changes );
+
+        ShaderDirectoryWatcher();
+        ~ShaderDirectoryWatcher();
+
+        // Starts watching on a thread of its own, stopping a previous watch first. False if
+        // the directory can't be watched.
+        bool Start( const wchar_t* szDirectory, unsigned int uDebounceMs, Callback pCallback, void* pContext );
+
+        // Waits for the callback to return if it is running; changes not handed over yet
+        // are dropped
+        void Stop();
+
+        bool IsWatching() const { return m_Thread.joinable(); }
+
+        // Implemented for each platform
+        class Source;
+
+    private:
+
+        ShaderDirectoryWatcher( const ShaderDirectoryWatcher& );
+        ShaderDirectoryWatcher& operator=( const ShaderDirectoryWatcher& );
+
+        void Run();
+
+        Source*             m_pSource;
+        std::thread         m_Thread;
+        std::atomic<bool>   m_bStop;
+        Callback            m_pCallback;
+        void*               m_pContext;
+        unsigned int        m_uDebounceMs;
+    };
+}
+
+#endif // AMD_SDK_SHADER_DIRECTORY_WATCHER_H
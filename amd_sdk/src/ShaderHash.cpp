@@ -0,0 +1,287 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderHash.cpp
+//
+// XXH64 and path independent hashing of preprocessed shaders
+//--------------------------------------------------------------------------------------
+#include "ShaderHash.h"
+
+#include <string.h>
+
+namespace AMD
+{
+    static const unsigned long long PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    static const unsigned long long PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    static const unsigned long long PRIME64_3 = 0x165667B19E3779F9ULL;
+    static const unsigned long long PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    static const unsigned long long PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+
+    static inline unsigned long long RotateLeft( unsigned long long uValue, unsigned int uBits )
+    {
+        return ( uValue << uBits ) | ( uValue >> ( 64 - uBits ) );
+    }
+
+
+    // Little endian reads, as on every platform the samples run on
+    static inline unsigned long long Read64( const unsigned char* p )
+    {
+        unsigned long long uValue;
+        memcpy( &uValue, p, sizeof( uValue ) );
+        return uValue;
+    }
+
+
+    static inline unsigned long long Read32( const unsigned char* p )
+    {
+        unsigned int uValue;
+        memcpy( &uValue, p, sizeof( uValue ) );
+        return uValue;
+    }
+
+
+    static inline unsigned long long Round( unsigned long long uAcc, unsigned long long uInput )
+    {
+        uAcc += uInput * PRIME64_2;
+        uAcc = RotateLeft( uAcc, 31 );
+        return uAcc * PRIME64_1;
+    }
+
+
+    static inline unsigned long long MergeRound( unsigned long long uAcc, unsigned long long uLane )
+    {
+        uAcc ^= Round( 0, uLane );
+        return uAcc * PRIME64_1 + PRIME64_4;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderHasher::ShaderHasher( unsigned long long uSeed )
+    {
+        Reset( uSeed );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderHasher::Reset( unsigned long long uSeed )
+    {
+        m_uLanes[0] = uSeed + PRIME64_1 + PRIME64_2;
+        m_uLanes[1] = uSeed + PRIME64_2;
+        m_uLanes[2] = uSeed;
+        m_uLanes[3] = uSeed - PRIME64_1;
+        m_uTotalSize = 0;
+        m_uSeed = uSeed;
+        m_uBuffered = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderHasher::Update( const void* pData, size_t uSize )
+    {
+        const unsigned char* p = (const unsigned char*)pData;
+        const unsigned char* pEnd = p + uSize;
+
+        m_uTotalSize += uSize;
+
+        // Complete a buffered stripe first
+        if ( m_uBuffered > 0 )
+        {
+            const size_t uCopy = ( uSize < 32 - m_uBuffered ) ? uSize : 32 - m_uBuffered;
+            memcpy( m_Buffer + m_uBuffered, p, uCopy );
+            m_uBuffered += (unsigned int)uCopy;
+            p += uCopy;
+
+            if ( m_uBuffered < 32 )
+            {
+                return;
+            }
+
+            for ( unsigned int i = 0; i < 4; i++ )
+            {
+                m_uLanes[i] = Round( m_uLanes[i], Read64( m_Buffer + i * 8 ) );
+            }
+            m_uBuffered = 0;
+        }
+
+        // Whole stripes straight from the input
+        if ( pEnd - p >= 32 )
+        {
+            unsigned long long v0 = m_uLanes[0];
+            unsigned long long v1 = m_uLanes[1];
+            unsigned long long v2 = m_uLanes[2];
+            unsigned long long v3 = m_uLanes[3];
+
+            const unsigned char* pLimit = pEnd - 32;
+            do
+            {
+                v0 = Round( v0, Read64( p ) );
+                v1 = Round( v1, Read64( p + 8 ) );
+                v2 = Round( v2, Read64( p + 16 ) );
+                v3 = Round( v3, Read64( p + 24 ) );
+                p += 32;
+            } while ( p <= pLimit );
+
+            m_uLanes[0] = v0;
+            m_uLanes[1] = v1;
+            m_uLanes[2] = v2;
+            m_uLanes[3] = v3;
+        }
+
+        if ( p < pEnd )
+        {
+            memcpy( m_Buffer, p, pEnd - p );
+            m_uBuffered = (unsigned int)( pEnd - p );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderHasher::Digest() const
+    {
+        unsigned long long uHash;
+
+        if ( m_uTotalSize >= 32 )
+        {
+            uHash = RotateLeft( m_uLanes[0], 1 ) + RotateLeft( m_uLanes[1], 7 ) + RotateLeft( m_uLanes[2], 12 ) + RotateLeft( m_uLanes[3], 18 );
+            for ( unsigned int i = 0; i < 4; i++ )
+            {
+                uHash = MergeRound( uHash, m_uLanes[i] );
+            }
+        }
+        else
+        {
+            uHash = m_uSeed + PRIME64_5;
+        }
+
+        uHash += m_uTotalSize;
+
+        // The rest of the input, less than a stripe
+        const unsigned char* p = m_Buffer;
+        const unsigned char* pEnd = m_Buffer + m_uBuffered;
+
+        for ( ; p + 8 <= pEnd; p += 8 )
+        {
+            uHash ^= Round( 0, Read64( p ) );
+            uHash = RotateLeft( uHash, 27 ) * PRIME64_1 + PRIME64_4;
+        }
+
+        if ( p + 4 <= pEnd )
+        {
+            uHash ^= Read32( p ) * PRIME64_1;
+            uHash = RotateLeft( uHash, 23 ) * PRIME64_2 + PRIME64_3;
+            p += 4;
+        }
+
+        for ( ; p < pEnd; p++ )
+        {
+            uHash ^= (*p) * PRIME64_5;
+            uHash = RotateLeft( uHash, 11 ) * PRIME64_1;
+        }
+
+        uHash ^= uHash >> 33;
+        uHash *= PRIME64_2;
+        uHash ^= uHash >> 29;
+        uHash *= PRIME64_3;
+        uHash ^= uHash >> 32;
+
+        return uHash;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderHasher::Digest( unsigned char (&Bytes)[SHADER_HASH_SIZE] ) const
+    {
+        const unsigned long long uHash = Digest();
+        for ( unsigned int i = 0; i < SHADER_HASH_SIZE; i++ )
+        {
+            Bytes[i] = (unsigned char)( uHash >> ( i * 8 ) );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderHasher::Hash( const void* pData, size_t uSize, unsigned long long uSeed )
+    {
+        ShaderHasher Hasher( uSeed );
+        Hasher.Update( pData, uSize );
+        return Hasher.Digest();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // fxc writes directives like
+    //     #line 12 "C:\Projects\Sample\src\Shaders\Common.hlsl"
+    // Rather than going line by line, this looks for the '#' of each directive and hashes
+    // everything between the directories it leaves out in as few updates as it can.
+    //--------------------------------------------------------------------------------------
+    void HashPreprocessedSource( const char* pData, size_t uSize, ShaderHasher& Hasher )
+    {
+        static const char szDirective[] = "#line";
+        const size_t uDirectiveLength = sizeof( szDirective ) - 1;
+
+        const char* pEnd = pData + uSize;
+        const char* pUnhashed = pData;
+        const char* p = pData;
+
+        while ( ( p = (const char*)memchr( p, '#', pEnd - p ) ) != NULL )
+        {
+            if ( (size_t)( pEnd - p ) < uDirectiveLength || memcmp( p, szDirective, uDirectiveLength ) != 0 )
+            {
+                p++;
+                continue;
+            }
+
+            const char* pLineEnd = (const char*)memchr( p, '\n', pEnd - p );
+            pLineEnd = pLineEnd ? pLineEnd : pEnd;
+
+            const char* pPath = (const char*)memchr( p, '"', pLineEnd - p );
+            if ( pPath )
+            {
+                pPath++;
+                const char* pPathEnd = (const char*)memchr( pPath, '"', pLineEnd - pPath );
+                pPathEnd = pPathEnd ? pPathEnd : pLineEnd;
+
+                // Start of the file name
+                const char* pName = pPath;
+                for ( const char* c = pPath; c < pPathEnd; c++ )
+                {
+                    if ( *c == '\\' || *c == '/' )
+                    {
+                        pName = c + 1;
+                    }
+                }
+
+                if ( pName > pPath )
+                {
+                    Hasher.Update( pUnhashed, pPath - pUnhashed );
+                    pUnhashed = pName;
+                }
+            }
+
+            p = pLineEnd;
+        }
+
+        Hasher.Update( pUnhashed, pEnd - pUnhashed );
+    }
+}
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderHash.h
+//
+// Content hashing for the ShaderCache, which compares the hash of a shader's preprocessed
+// source with the one stored next to its object file to tell if it needs compiling.
+//
+// ShaderHasher is a streaming implementation of XXH64, so a file can be hashed straight
+// from a mapping, in pieces, without a copy. It is not a cryptographic hash, which change
+// detection doesn't need, and runs at several GB/s.
+//
+// HashPreprocessedSource hashes fxc's preprocess output in one linear pass, leaving out
+// the directories of the paths in #line directives, so moving a project on disk doesn't
+// change the hashes and rebuild the cache.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_HASH_H
+#define AMD_SDK_SHADER_HASH_H
+
+#include <stddef.h>
+
+namespace AMD
+{
+    // Bytes of a stored hash
+    static const unsigned int SHADER_HASH_SIZE = 8;
+
+    class ShaderHasher
+    {
+    public:
+
+        explicit ShaderHasher( unsigned long long uSeed = 0 );
+
+        void Reset( unsigned long long uSeed = 0 );
+
+        // Adds data; the digest is the same however the data is split between calls
+        void Update( const void* pData, size_t uSize );
+
+        // Hash of all data added since the last Reset; more may be added after
+        unsigned long long Digest() const;
+
+        // Digest in the byte order it is stored in
+        void Digest( unsigned char (&Bytes)[SHADER_HASH_SIZE] ) const;
+
+        static unsigned long long Hash( const void* pData, size_t uSize, unsigned long long uSeed = 0 );
+
+    private:
+
+        unsigned long long      m_uLanes[4];
+        unsigned long long      m_uTotalSize;
+        unsigned long long      m_uSeed;
+        unsigned char           m_Buffer[32];       // Input that doesn't fill a stripe yet
+        unsigned int            m_uBuffered;
+    };
+
+    // Adds fxc preprocess output to a hasher, with every path in a #line directive reduced
+    // to its file name
+    void HashPreprocessedSource( const char* pData, size_t uSize, ShaderHasher& Hasher );
+}
+
+#endif // AMD_SDK_SHADER_HASH_H
@@ -0,0 +1,201 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderPermutations.cpp
+//
+// Shader options packed into permutation keys, and a table of permutations by key
+//--------------------------------------------------------------------------------------
+#include "ShaderPermutations.h"
+
+#include <assert.h>
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    ShaderOptions::ShaderOptions() :
+    m_uKeyBits( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    int ShaderOptions::AddOption( const wchar_t* szName, unsigned int uValueCount, int iFirstValue )
+    {
+        assert( szName && szName[0] && uValueCount > 0 );
+
+        unsigned int uBits = 0;
+        while ( uBits < 32 && ( uValueCount - 1 ) >> uBits )
+        {
+            uBits++;
+        }
+
+        if ( m_uKeyBits + uBits > MAX_KEY_BITS )
+        {
+            return -1;
+        }
+
+        Option NewOption;
+        NewOption.Name = szName;
+        NewOption.uValueCount = uValueCount;
+        NewOption.iFirstValue = iFirstValue;
+        NewOption.uShift = m_uKeyBits;
+        NewOption.uBits = uBits;
+        m_Options.push_back( NewOption );
+
+        m_uKeyBits += uBits;
+
+        return (int)m_Options.size() - 1;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderOptions::GetPermutationCount() const
+    {
+        // No more than 2^63, as the values of each option fit its bits
+        unsigned long long uCount = 1;
+        for ( size_t i = 0; i < m_Options.size(); i++ )
+        {
+            uCount *= m_Options[i].uValueCount;
+        }
+
+        return uCount;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderPermutationKey ShaderOptions::SetValue( ShaderPermutationKey uKey, unsigned int uOption, int iValue ) const
+    {
+        assert( uOption < m_Options.size() );
+        const Option& O = m_Options[uOption];
+
+        const unsigned long long uValue = (unsigned long long)( (long long)iValue - O.iFirstValue );
+        assert( uValue < O.uValueCount );
+
+        const unsigned long long uMask = ( ( 1ULL << O.uBits ) - 1 ) << O.uShift;
+        return ( uKey & ~uMask ) | ( ( uValue << O.uShift ) & uMask );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    int ShaderOptions::GetValue( ShaderPermutationKey uKey, unsigned int uOption ) const
+    {
+        assert( uOption < m_Options.size() );
+        const Option& O = m_Options[uOption];
+
+        return O.iFirstValue + (int)( ( uKey >> O.uShift ) & ( ( 1ULL << O.uBits ) - 1 ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderOptions::IsValidKey( ShaderPermutationKey uKey ) const
+    {
+        if ( m_uKeyBits < 64 && ( uKey >> m_uKeyBits ) != 0 )
+        {
+            return false;
+        }
+
+        for ( size_t i = 0; i < m_Options.size(); i++ )
+        {
+            const Option& O = m_Options[i];
+            if ( ( ( uKey >> O.uShift ) & ( ( 1ULL << O.uBits ) - 1 ) ) >= O.uValueCount )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderPermutationTable::ShaderPermutationTable() :
+    m_uCount( 0 ),
+    m_uShift( 64 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderPermutationRecord* ShaderPermutationTable::Add( ShaderPermutationKey uKey, void* pObject )
+    {
+        assert( uKey != EMPTY_KEY && !Find( uKey ) );
+
+        // At most half full, so runs of taken slots stay short
+        if ( ( m_uCount + 1 ) * 2 > m_Records.size() )
+        {
+            Grow();
+        }
+
+        size_t i = Slot( uKey );
+        while ( m_Records[i].uKey != EMPTY_KEY )
+        {
+            i = ( i + 1 ) & ( m_Records.size() - 1 );
+        }
+
+        m_Records[i].uKey = uKey;
+        m_Records[i].pObject = pObject;
+        m_uCount++;
+
+        return &m_Records[i];
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderPermutationTable::Clear()
+    {
+        std::vector<ShaderPermutationRecord>().swap( m_Records );
+        m_uCount = 0;
+        m_uShift = 64;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderPermutationTable::Grow()
+    {
+        const ShaderPermutationRecord Empty = { EMPTY_KEY, NULL };
+
+        std::vector<ShaderPermutationRecord> Records;
+        Records.swap( m_Records );
+
+        const size_t uSlots = Records.empty() ? 16 : Records.size() * 2;
+        m_Records.assign( uSlots, Empty );
+        m_uShift = 64;
+        for ( size_t uSize = uSlots; uSize > 1; uSize >>= 1 )
+        {
+            m_uShift--;
+        }
+
+        for ( size_t i = 0; i < Records.size(); i++ )
+        {
+            if ( Records[i].uKey != EMPTY_KEY )
+            {
+                size_t j = Slot( Records[i].uKey );
+                while ( m_Records[j].uKey != EMPTY_KEY )
+                {
+                    j = ( j + 1 ) & ( m_Records.size() - 1 );
+                }
+                m_Records[j] = Records[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderPermutations.h
+//
+// Options of a shader that are compiled in, as macros, and a table of the permutations of
+// the shader that exist, looked up by a 64 bit key.
+//
+// ShaderOptions packs the value of each option into a few bits of the key: an option of
+// n values takes the bits to hold n - 1. Keys are limited to 63 bits, leaving a value no
+// key can take to mark the empty slots of ShaderPermutationTable. The table holds one
+// 16 byte record per permutation, in an open addressed array of at most twice as many
+// slots, so a lookup is a multiply and usually a single compare.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_PERMUTATIONS_H
+#define AMD_SDK_SHADER_PERMUTATIONS_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace AMD
+{
+    typedef unsigned long long ShaderPermutationKey;
+
+    class ShaderOptions
+    {
+    public:
+
+        static const unsigned int MAX_KEY_BITS = 63;
+
+        ShaderOptions();
+
+        // Adds an option taking uValueCount values from iFirstValue on, passed to the
+        // compiler as the macro szName. Returns the option's index, or -1 if the key has
+        // no room left for it.
+        int AddOption( const wchar_t* szName, unsigned int uValueCount, int iFirstValue = 0 );
+        int AddBoolOption( const wchar_t* szName ) { return AddOption( szName, 2 ); }
+
+        unsigned int GetOptionCount() const { return (unsigned int)m_Options.size(); }
+        const wchar_t* GetOptionName( unsigned int uOption ) const { return m_Options[uOption].Name.c_str(); }
+        unsigned int GetKeyBits() const { return m_uKeyBits; }
+
+        // Of every option
+        unsigned long long GetPermutationCount() const;
+
+        // The key with an option set to a value, which must be one the option takes
+        ShaderPermutationKey SetValue( ShaderPermutationKey uKey, unsigned int uOption, int iValue ) const;
+        int GetValue( ShaderPermutationKey uKey, unsigned int uOption ) const;
+
+        unsigned int GetValueCount( unsigned int uOption ) const { return m_Options[uOption].uValueCount; }
+        int GetFirstValue( unsigned int uOption ) const { return m_Options[uOption].iFirstValue; }
+
+        // True if the key only uses the bits of the options, and each of these values
+        // the option takes
+        bool IsValidKey( ShaderPermutationKey uKey ) const;
+
+    private:
+
+        struct Option
+        {
+            std::wstring        Name;
+            unsigned int        uValueCount;
+            int                 iFirstValue;
+            unsigned int        uShift;
+            unsigned int        uBits;
+        };
+
+        std::vector<Option>     m_Options;
+        unsigned int            m_uKeyBits;
+    };
+
+    struct ShaderPermutationRecord
+    {
+        ShaderPermutationKey    uKey;
+        void*                   pObject;        // E.g. the created shader, NULL until there is one
+    };
+
+    class ShaderPermutationTable
+    {
+    public:
+
+        ShaderPermutationTable();
+
+        // The record of a key, or NULL. Records move when one is added.
+        ShaderPermutationRecord* Find( ShaderPermutationKey uKey )
+        {
+            if ( m_uCount == 0 )
+            {
+                return NULL;
+            }
+
+            for ( size_t i = Slot( uKey ); ; i = ( i + 1 ) & ( m_Records.size() - 1 ) )
+            {
+                ShaderPermutationRecord& Record = m_Records[i];
+                if ( Record.uKey == uKey )
+                {
+                    return &Record;
+                }
+                if ( Record.uKey == EMPTY_KEY )
+                {
+                    return NULL;
+                }
+            }
+        }
+
+        // Adds the key, which mustn't be in the table yet, and returns its record
+        ShaderPermutationRecord* Add( ShaderPermutationKey uKey, void* pObject );
+
+        void Clear();
+
+        size_t GetCount() const { return m_uCount; }
+        size_t GetMemoryUsage() const { return m_Records.capacity() * sizeof( ShaderPermutationRecord ); }
+
+        // For visiting every record, e.g. to release the objects; empty slots have no object
+        size_t GetSlotCount() const { return m_Records.size(); }
+        ShaderPermutationRecord& GetSlot( size_t uSlot ) { return m_Records[uSlot]; }
+
+    private:
+
+        static const ShaderPermutationKey EMPTY_KEY = ~0ULL;
+
+        size_t Slot( ShaderPermutationKey uKey ) const
+        {
+            // Fibonacci hashing, the top bits of the product spread consecutive keys
+            return (size_t)( ( uKey * 0x9E3779B97F4A7C15ULL ) >> m_uShift );
+        }
+
+        void Grow();
+
+        std::vector<ShaderPermutationRecord>    m_Records;  // A power of two of them, or none
+        size_t                                  m_uCount;
+        unsigned int                            m_uShift;
+    };
+}
+
+#endif // AMD_SDK_SHADER_PERMUTATIONS_H
@@ -0,0 +1,368 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderProfile.cpp
+//
+// Stage by stage times of starting up with shaders, and their report
+//--------------------------------------------------------------------------------------
+#include "ShaderProfile.h"
+#include "MappedFile.h"
+
+#include <stdio.h>
+#include <wchar.h>
+#include <chrono>
+#include <algorithm>
+
+namespace AMD
+{
+    static const wchar_t* s_StageNames[SHADER_PROFILE_STAGE_COUNT] =
+    {
+        L"spawn",
+        L"preprocess",
+        L"hash",
+        L"disk",
+        L"compile",
+        L"create",
+    };
+
+    static const size_t NAME_COLUMN = 48;
+
+
+    //--------------------------------------------------------------------------------------
+    static std::string ToUtf8( const std::wstring& Text )
+    {
+        std::string Result;
+        for ( size_t i = 0; i < Text.size(); i++ )
+        {
+            const unsigned int c = (unsigned int)Text[i];
+            if ( c < 0x80 )
+            {
+                Result += (char)c;
+            }
+            else if ( c < 0x800 )
+            {
+                Result += (char)( 0xC0 | ( c >> 6 ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else if ( c < 0x10000 )
+            {
+                Result += (char)( 0xE0 | ( c >> 12 ) );
+                Result += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else
+            {
+                Result += (char)( 0xF0 | ( c >> 18 ) );
+                Result += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Result += (char)( 0x80 | ( c & 0x3F ) );
+            }
+        }
+        return Result;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Pads or cuts a name to the first column. Names are cut at the front, where paths
+    // differ least.
+    //--------------------------------------------------------------------------------------
+    static std::wstring NameColumn( const std::wstring& Name )
+    {
+        if ( Name.size() > NAME_COLUMN - 2 )
+        {
+            return L"..." + Name.substr( Name.size() - ( NAME_COLUMN - 5 ) ) + L"  ";
+        }
+        return Name + std::wstring( NAME_COLUMN - Name.size(), L' ' );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool IsSlower( const ShaderProfileEntry& First, const ShaderProfileEntry& Second )
+    {
+        if ( First.fTotalSeconds != Second.fTotalSeconds )
+        {
+            return First.fTotalSeconds > Second.fTotalSeconds;
+        }
+        return First.Name < Second.Name;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool IsStageSlower( const ShaderProfileStage& First, const ShaderProfileStage& Second )
+    {
+        if ( First.fTotalSeconds != Second.fTotalSeconds )
+        {
+            return First.fTotalSeconds > Second.fTotalSeconds;
+        }
+        return First.eStage < Second.eStage;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const wchar_t* GetShaderProfileStageName( SHADER_PROFILE_STAGE eStage )
+    {
+        return ( eStage < SHADER_PROFILE_STAGE_COUNT ) ? s_StageNames[eStage] : L"unknown";
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderStartupProfile::ShaderStartupProfile()
+        : m_uBeginTime( 0 )
+        , m_uEndTime( 0 )
+        , m_bEnded( true )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    unsigned long long ShaderStartupProfile::GetTime()
+    {
+        return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::Begin( const std::vector<std::wstring>& Names )
+    {
+        m_Names = Names;
+
+        std::vector< std::atomic<unsigned long long> > Nanoseconds( Names.size() * SHADER_PROFILE_STAGE_COUNT );
+        for ( size_t i = 0; i < Nanoseconds.size(); i++ )
+        {
+            Nanoseconds[i].store( 0, std::memory_order_relaxed );
+        }
+        m_Nanoseconds.swap( Nanoseconds );
+
+        {
+            std::lock_guard<std::mutex> Lock( m_MarksMutex );
+            m_Marks.clear();
+        }
+
+        m_uBeginTime = GetTime();
+        m_uEndTime = m_uBeginTime;
+        m_bEnded = false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::AddTime( unsigned int uShader, SHADER_PROFILE_STAGE eStage, unsigned long long uStartTime )
+    {
+        const unsigned long long uNow = GetTime();
+        AddDuration( uShader, eStage, ( uNow > uStartTime ) ? ( uNow - uStartTime ) : 0 );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::AddDuration( unsigned int uShader, SHADER_PROFILE_STAGE eStage, unsigned long long uNanoseconds )
+    {
+        if ( uShader >= m_Names.size() || eStage >= SHADER_PROFILE_STAGE_COUNT || m_bEnded )
+        {
+            return;
+        }
+
+        m_Nanoseconds[uShader * SHADER_PROFILE_STAGE_COUNT + eStage].fetch_add( uNanoseconds, std::memory_order_relaxed );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::Mark( const wchar_t* szName )
+    {
+        if ( m_bEnded )
+        {
+            return;
+        }
+
+        const double fSeconds = (double)( GetTime() - m_uBeginTime ) * 1e-9;
+
+        std::lock_guard<std::mutex> Lock( m_MarksMutex );
+        m_Marks.push_back( std::make_pair( std::wstring( szName ), fSeconds ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::End()
+    {
+        if ( !m_bEnded )
+        {
+            m_uEndTime = GetTime();
+            m_bEnded = true;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    double ShaderStartupProfile::GetSeconds( size_t uShader, SHADER_PROFILE_STAGE eStage ) const
+    {
+        if ( uShader >= m_Names.size() || eStage >= SHADER_PROFILE_STAGE_COUNT )
+        {
+            return 0.0;
+        }
+
+        return (double)m_Nanoseconds[uShader * SHADER_PROFILE_STAGE_COUNT + eStage].load( std::memory_order_relaxed ) * 1e-9;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::GetStages( std::vector<ShaderProfileStage>& Stages ) const
+    {
+        Stages.clear();
+
+        for ( unsigned int s = 0; s < SHADER_PROFILE_STAGE_COUNT; s++ )
+        {
+            ShaderProfileStage Stage = { (SHADER_PROFILE_STAGE)s, 0.0, 0, 0.0, 0 };
+
+            for ( size_t i = 0; i < m_Names.size(); i++ )
+            {
+                const double fSeconds = GetSeconds( i, Stage.eStage );
+                if ( fSeconds > 0.0 )
+                {
+                    Stage.fTotalSeconds += fSeconds;
+                    Stage.uShaders++;
+                    if ( fSeconds > Stage.fMaxSeconds )
+                    {
+                        Stage.fMaxSeconds = fSeconds;
+                        Stage.uMaxShader = i;
+                    }
+                }
+            }
+
+            Stages.push_back( Stage );
+        }
+
+        std::sort( Stages.begin(), Stages.end(), IsStageSlower );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderStartupProfile::GetSlowest( size_t uCount, std::vector<ShaderProfileEntry>& Slowest ) const
+    {
+        Slowest.clear();
+
+        for ( size_t i = 0; i < m_Names.size(); i++ )
+        {
+            ShaderProfileEntry Entry;
+            Entry.Name = m_Names[i];
+            Entry.fTotalSeconds = 0.0;
+            for ( unsigned int s = 0; s < SHADER_PROFILE_STAGE_COUNT; s++ )
+            {
+                Entry.fStageSeconds[s] = GetSeconds( i, (SHADER_PROFILE_STAGE)s );
+                Entry.fTotalSeconds += Entry.fStageSeconds[s];
+            }
+
+            if ( Entry.fTotalSeconds > 0.0 )
+            {
+                Slowest.push_back( Entry );
+            }
+        }
+
+        const size_t uKept = std::min( uCount, Slowest.size() );
+        std::partial_sort( Slowest.begin(), Slowest.begin() + uKept, Slowest.end(), IsSlower );
+        Slowest.resize( uKept );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Names are appended rather than printed, as the C library may refuse to print wide
+    // characters that the locale can't represent
+    //--------------------------------------------------------------------------------------
+    std::wstring ShaderStartupProfile::Report( size_t uSlowest ) const
+    {
+        std::wstring Text;
+        wchar_t szLine[512];
+
+        const unsigned long long uEndTime = m_bEnded ? m_uEndTime : GetTime();
+        swprintf( szLine, sizeof( szLine ) / sizeof( szLine[0] ), L"Shader startup profile: %u shaders, %.3f s from start to end\n",
+            (unsigned int)m_Names.size(), (double)( uEndTime - m_uBeginTime ) * 1e-9 );
+        Text += szLine;
+
+        {
+            std::lock_guard<std::mutex> Lock( m_MarksMutex );
+            for ( size_t i = 0; i < m_Marks.size(); i++ )
+            {
+                swprintf( szLine, sizeof( szLine ) / sizeof( szLine[0] ), L"%10.3f s\n", m_Marks[i].second );
+                Text += L"  " + NameColumn( m_Marks[i].first ) + szLine;
+            }
+        }
+
+        std::vector<ShaderProfileStage> Stages;
+        GetStages( Stages );
+
+        double fSummedSeconds = 0.0;
+        for ( size_t i = 0; i < Stages.size(); i++ )
+        {
+            fSummedSeconds += Stages[i].fTotalSeconds;
+        }
+
+        Text += L"\n" + NameColumn( L"Stages, summed over shaders" ) + L"     total s   share  shaders     max ms  slowest shader\n";
+
+        for ( size_t i = 0; i < Stages.size(); i++ )
+        {
+            const ShaderProfileStage& Stage = Stages[i];
+            swprintf( szLine, sizeof( szLine ) / sizeof( szLine[0] ), L"%10.3f%7.1f%%%9u%11.2f  ", Stage.fTotalSeconds,
+                ( fSummedSeconds > 0.0 ) ? Stage.fTotalSeconds * 100.0 / fSummedSeconds : 0.0, Stage.uShaders, Stage.fMaxSeconds * 1000.0 );
+            Text += L"  " + NameColumn( GetShaderProfileStageName( Stage.eStage ) ) + szLine + ( Stage.uShaders ? m_Names[Stage.uMaxShader] : L"-" ) + L"\n";
+        }
+
+        std::vector<ShaderProfileEntry> Slowest;
+        GetSlowest( uSlowest, Slowest );
+
+        Text += L"\n" + NameColumn( L"Slowest shaders, ms" ) + L"       total";
+        for ( unsigned int s = 0; s < SHADER_PROFILE_STAGE_COUNT; s++ )
+        {
+            const std::wstring Stage = s_StageNames[s];
+            Text += std::wstring( ( Stage.size() < 11 ) ? 11 - Stage.size() : 1, L' ' ) + Stage;
+        }
+        Text += L"\n";
+
+        for ( size_t i = 0; i < Slowest.size(); i++ )
+        {
+            swprintf( szLine, sizeof( szLine ) / sizeof( szLine[0] ), L"%10.2f", Slowest[i].fTotalSeconds * 1000.0 );
+            Text += L"  " + NameColumn( Slowest[i].Name ) + szLine;
+            for ( unsigned int s = 0; s < SHADER_PROFILE_STAGE_COUNT; s++ )
+            {
+                swprintf( szLine, sizeof( szLine ) / sizeof( szLine[0] ), L"%11.2f", Slowest[i].fStageSeconds[s] * 1000.0 );
+                Text += szLine;
+            }
+            Text += L"\n";
+        }
+
+        return Text;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderStartupProfile::WriteReport( const wchar_t* szFileName, size_t uSlowest ) const
+    {
+        FILE* pFile = OpenFileStream( szFileName, "wb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+
+        const std::string Text = ToUtf8( Report( uSlowest ) );
+        const bool bWritten = ( fwrite( Text.data(), 1, Text.size(), pFile ) == Text.size() );
+
+        return ( fclose( pFile ) == 0 ) && bWritten;
+    }
+}
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderProfile.h
+//
+// Where the time to start up with shaders goes, shader by shader: starting fxc, fxc
+// preprocessing and compiling, hashing the preprocessed source, reading and writing the
+// cache, and creating the D3D shader. ShaderCache adds the time of every stage as it runs
+// one, and once all shaders are created writes a report of the stages and of the slowest
+// shaders, so that a change that makes the cache miss, or a shader that got slow to
+// compile, shows in the report a CI run keeps.
+//
+// Stages of different shaders overlap, as fxc runs on every core and shaders are created
+// on several threads, so the time of a stage is summed over shaders rather than measured
+// from start to end.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_PROFILE_H
+#define AMD_SDK_SHADER_PROFILE_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace AMD
+{
+    enum SHADER_PROFILE_STAGE
+    {
+        SHADER_PROFILE_SPAWN,           // Starting fxc
+        SHADER_PROFILE_PREPROCESS,      // fxc preprocessing, until it was found to be done
+        SHADER_PROFILE_HASH,            // Reading and hashing the preprocessed source
+        SHADER_PROFILE_DISK,            // Reading and writing the cache: dependencies, hash and object files, archive, cache server
+        SHADER_PROFILE_COMPILE,         // fxc compiling, until it was found to be done, and generating ISA
+        SHADER_PROFILE_CREATE,          // Reading the compiled shader and creating it on the device
+        SHADER_PROFILE_STAGE_COUNT
+    };
+
+    const wchar_t* GetShaderProfileStageName( SHADER_PROFILE_STAGE eStage );
+
+    // The times of one shader, in seconds
+    struct ShaderProfileEntry
+    {
+        std::wstring            Name;
+        double                  fStageSeconds[SHADER_PROFILE_STAGE_COUNT];
+        double                  fTotalSeconds;
+    };
+
+    // The times of one stage over all shaders, in seconds
+    struct ShaderProfileStage
+    {
+        SHADER_PROFILE_STAGE    eStage;
+        double                  fTotalSeconds;
+        unsigned int            uShaders;       // That spent any time in it
+        double                  fMaxSeconds;
+        size_t                  uMaxShader;     // Index of the shader that spent fMaxSeconds
+    };
+
+    // The stage times of the shaders since Begin. Times are added from any thread, and read
+    // from any thread meanwhile, e.g. to draw them while shaders compile.
+    class ShaderStartupProfile
+    {
+    public:
+
+        // Adds nothing, for shaders that aren't part of the profile
+        static const unsigned int NO_SHADER = ~0u;
+
+        ShaderStartupProfile();
+
+        // Nanoseconds, from a clock that only moves forward
+        static unsigned long long GetTime();
+
+        // Starts over with the named shaders. A shader's index in Names identifies it from then
+        // on. Not while times are added.
+        void Begin( const std::vector<std::wstring>& Names );
+
+        // Adds to a stage of a shader the time since uStartTime, from GetTime, or a duration.
+        // The same shader may be added to from several threads at once. Nothing is added for
+        // NO_SHADER, or after End.
+        void AddTime( unsigned int uShader, SHADER_PROFILE_STAGE eStage, unsigned long long uStartTime );
+        void AddDuration( unsigned int uShader, SHADER_PROFILE_STAGE eStage, unsigned long long uNanoseconds );
+
+        // Notes the time since Begin under a name, e.g. when the first frame was ready
+        void Mark( const wchar_t* szName );
+
+        // Stops adding times, and notes the time since Begin
+        void End();
+        bool IsEnded() const { return m_bEnded; }
+
+        size_t GetShaderCount() const { return m_Names.size(); }
+        const std::wstring& GetShaderName( size_t uShader ) const { return m_Names[uShader]; }
+        double GetSeconds( size_t uShader, SHADER_PROFILE_STAGE eStage ) const;
+
+        // The stages that took longest first
+        void GetStages( std::vector<ShaderProfileStage>& Stages ) const;
+
+        // Up to uCount shaders that took longest over all stages, slowest first. Shaders that
+        // took as long are in the order of their names, so reports of the same times match.
+        void GetSlowest( size_t uCount, std::vector<ShaderProfileEntry>& Slowest ) const;
+
+        // The stages and the uSlowest slowest shaders, one per line, in columns
+        std::wstring Report( size_t uSlowest ) const;
+
+        // Writes Report as UTF-8, false if the file couldn't be written
+        bool WriteReport( const wchar_t* szFileName, size_t uSlowest ) const;
+
+    private:
+
+        ShaderStartupProfile( const ShaderStartupProfile& );
+        ShaderStartupProfile& operator=( const ShaderStartupProfile& );
+
+        std::vector<std::wstring>                       m_Names;
+        std::vector< std::atomic<unsigned long long> >  m_Nanoseconds;  // SHADER_PROFILE_STAGE_COUNT per shader
+        unsigned long long                              m_uBeginTime;
+        unsigned long long                              m_uEndTime;
+        std::atomic<bool>                               m_bEnded;
+        std::vector< std::pair<std::wstring, double> >  m_Marks;        // Seconds since Begin
+        mutable std::mutex                              m_MarksMutex;
+    };
+
+    // Adds the time from its construction to its destruction to a stage of a shader
+    class ShaderProfileScope
+    {
+    public:
+
+        ShaderProfileScope( ShaderStartupProfile& Profile, unsigned int uShader, SHADER_PROFILE_STAGE eStage )
+            : m_Profile( Profile ), m_uShader( uShader ), m_eStage( eStage ), m_uStartTime( ShaderStartupProfile::GetTime() )
+        {
+        }
+
+        ~ShaderProfileScope()
+        {
+            m_Profile.AddTime( m_uShader, m_eStage, m_uStartTime );
+        }
+
+    private:
+
+        ShaderProfileScope( const ShaderProfileScope& );
+        ShaderProfileScope& operator=( const ShaderProfileScope& );
+
+        ShaderStartupProfile&   m_Profile;
+        unsigned int            m_uShader;
+        SHADER_PROFILE_STAGE    m_eStage;
+        unsigned long long      m_uStartTime;
+    };
+}
+
+#endif // AMD_SDK_SHADER_PROFILE_H
@@ -0,0 +1,632 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderRemoteCache.cpp
+//
+// Client and reference server of the shader cache server protocol, over Winsock on
+// Windows and BSD sockets elsewhere
+//--------------------------------------------------------------------------------------
+#include "ShaderRemoteCache.h"
+#include "ShaderHash.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment( lib, "ws2_32.lib" )
+#endif
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+namespace AMD
+{
+    // A server that stops answering holds up the compile scheduler for at most this long
+    static const unsigned int SHADER_REMOTE_TIMEOUT_MS = 10000;
+
+#ifdef _WIN32
+    typedef SOCKET SocketHandle;
+    static const SocketHandle NO_SOCKET = INVALID_SOCKET;
+    static const int SEND_FLAGS = 0;
+    static const int SHUTDOWN_BOTH = SD_BOTH;
+
+    static void CloseSocket( SocketHandle Socket ) { closesocket( Socket ); }
+    static bool Interrupted() { return false; }
+
+    // Winsock counts its users
+    static bool StartSockets()
+    {
+        WSADATA Data;
+        return WSAStartup( MAKEWORD( 2, 2 ), &Data ) == 0;
+    }
+    static void StopSockets() { WSACleanup(); }
+#else
+    typedef int SocketHandle;
+    static const SocketHandle NO_SOCKET = -1;
+    static const int SEND_FLAGS = MSG_NOSIGNAL;    // A closed connection fails the call instead of raising SIGPIPE
+    static const int SHUTDOWN_BOTH = SHUT_RDWR;
+
+    static void CloseSocket( SocketHandle Socket ) { close( Socket ); }
+    static bool Interrupted() { return errno == EINTR; }
+    static bool StartSockets() { return true; }
+    static void StopSockets() {}
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    static bool SendAll( SocketHandle Socket, const char* p, size_t uSize )
+    {
+        while ( uSize > 0 )
+        {
+            const int iChunk = ( uSize > ( 1 << 20 ) ) ? ( 1 << 20 ) : (int)uSize;
+            const int iSent = (int)send( Socket, p, iChunk, SEND_FLAGS );
+            if ( iSent <= 0 )
+            {
+                if ( iSent < 0 && Interrupted() )
+                {
+                    continue;
+                }
+                return false;
+            }
+            p += iSent;
+            uSize -= iSent;
+        }
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool ReceiveAll( SocketHandle Socket, char* p, size_t uSize )
+    {
+        while ( uSize > 0 )
+        {
+            const int iChunk = ( uSize > ( 1 << 20 ) ) ? ( 1 << 20 ) : (int)uSize;
+            const int iReceived = (int)recv( Socket, p, iChunk, 0 );
+            if ( iReceived <= 0 )
+            {
+                if ( iReceived < 0 && Interrupted() )
+                {
+                    continue;
+                }
+                return false;
+            }
+            p += iReceived;
+            uSize -= iReceived;
+        }
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Sends the message and its payload with one call, so that neither waits for the
+    // other to be acknowledged
+    //--------------------------------------------------------------------------------------
+    static bool SendRemoteMessage( SocketHandle Socket, unsigned int uMagic, unsigned short uCode, unsigned long long uKey, const void* pData, size_t uSize )
+    {
+        if ( uSize > SHADER_REMOTE_MAX_PAYLOAD )
+        {
+            return false;
+        }
+
+        ShaderRemoteMessage Message;
+        Message.uMagic = uMagic;
+        Message.uVersion = SHADER_REMOTE_VERSION;
+        Message.uCode = uCode;
+        Message.uKey = uKey;
+        Message.uPayloadHash = ShaderHasher::Hash( pData, uSize );
+        Message.uLength = (unsigned int)uSize;
+        Message.uReserved = 0;
+
+        std::vector<char> Buffer( sizeof( Message ) + uSize );
+        memcpy( &Buffer[0], &Message, sizeof( Message ) );
+        if ( uSize > 0 )
+        {
+            memcpy( &Buffer[ sizeof( Message ) ], pData, uSize );
+        }
+
+        return SendAll( Socket, &Buffer[0], Buffer.size() );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // False if the connection closed, or what arrived isn't a message of the protocol, after
+    // which the connection can't be used any more
+    //--------------------------------------------------------------------------------------
+    static bool ReceiveRemoteMessage( SocketHandle Socket, unsigned int uMagic, ShaderRemoteMessage& Message, std::vector<char>& Payload )
+    {
+        if ( !ReceiveAll( Socket, (char*)&Message, sizeof( Message ) ) ||
+             Message.uMagic != uMagic || Message.uVersion != SHADER_REMOTE_VERSION || Message.uLength > SHADER_REMOTE_MAX_PAYLOAD )
+        {
+            return false;
+        }
+
+        Payload.resize( Message.uLength );
+        return Payload.empty() || ReceiveAll( Socket, &Payload[0], Payload.size() );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static bool IsIntact( const ShaderRemoteMessage& Message, const std::vector<char>& Payload )
+    {
+        return ShaderHasher::Hash( Payload.empty() ? NULL : &Payload[0], Payload.size() ) == Message.uPayloadHash;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Requests and responses are small and go one at a time, so aren't held back to be
+    // sent with more
+    //--------------------------------------------------------------------------------------
+    static void SetNoDelay( SocketHandle Socket )
+    {
+        int iNoDelay = 1;
+        setsockopt( Socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&iNoDelay, sizeof( iNoDelay ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static void SetTimeouts( SocketHandle Socket, unsigned int uMs )
+    {
+#ifdef _WIN32
+        DWORD dwTimeout = uMs;
+        setsockopt( Socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&dwTimeout, sizeof( dwTimeout ) );
+        setsockopt( Socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&dwTimeout, sizeof( dwTimeout ) );
+#else
+        struct timeval Timeout;
+        Timeout.tv_sec = uMs / 1000;
+        Timeout.tv_usec = ( uMs % 1000 ) * 1000;
+        setsockopt( Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof( Timeout ) );
+        setsockopt( Socket, SOL_SOCKET, SO_SNDTIMEO, &Timeout, sizeof( Timeout ) );
+#endif
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Addresses of a host, for connecting, or to listen on with bPassive
+    //--------------------------------------------------------------------------------------
+    static struct addrinfo* Resolve( const char* szHost, unsigned short uPort, bool bPassive )
+    {
+        struct addrinfo Hints;
+        memset( &Hints, 0, sizeof( Hints ) );
+        Hints.ai_family = AF_UNSPEC;
+        Hints.ai_socktype = SOCK_STREAM;
+        Hints.ai_protocol = IPPROTO_TCP;
+        Hints.ai_flags = bPassive ? AI_PASSIVE : 0;
+
+        struct addrinfo* pAddresses = NULL;
+        if ( getaddrinfo( szHost, std::to_string( (unsigned long long)uPort ).c_str(), &Hints, &pAddresses ) != 0 )
+        {
+            return NULL;
+        }
+        return pAddresses;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    static double SecondsSince( std::chrono::steady_clock::time_point Start )
+    {
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - Start ).count();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderRemoteCacheClient::ShaderRemoteCacheClient()
+        : m_uPort( 0 )
+        , m_Socket( -1 )
+        , m_bUnavailable( false )
+    {
+        ResetStats();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderRemoteCacheClient::~ShaderRemoteCacheClient()
+    {
+        Disconnect();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheClient::SetServer( const char* szHost, unsigned short uPort )
+    {
+        Disconnect();
+        m_Host = szHost ? szHost : "";
+        m_uPort = uPort;
+        m_bUnavailable = false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheClient::ResetStats()
+    {
+        memset( &m_Stats, 0, sizeof( m_Stats ) );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderRemoteCacheClient::Connect()
+    {
+        if ( m_Socket != -1 )
+        {
+            return true;
+        }
+
+        if ( !StartSockets() )
+        {
+            return false;
+        }
+
+        struct addrinfo* pAddresses = Resolve( m_Host.c_str(), m_uPort, false );
+
+        SocketHandle Socket = NO_SOCKET;
+        for ( struct addrinfo* p = pAddresses; p && Socket == NO_SOCKET; p = p->ai_next )
+        {
+            Socket = socket( p->ai_family, p->ai_socktype, p->ai_protocol );
+            if ( Socket != NO_SOCKET && connect( Socket, p->ai_addr, (int)p->ai_addrlen ) != 0 )
+            {
+                CloseSocket( Socket );
+                Socket = NO_SOCKET;
+            }
+        }
+
+        if ( pAddresses )
+        {
+            freeaddrinfo( pAddresses );
+        }
+
+        if ( Socket == NO_SOCKET )
+        {
+            StopSockets();
+            return false;
+        }
+
+        SetNoDelay( Socket );
+        SetTimeouts( Socket, SHADER_REMOTE_TIMEOUT_MS );
+        m_Socket = (intptr_t)Socket;
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheClient::Disconnect()
+    {
+        if ( m_Socket != -1 )
+        {
+            CloseSocket( (SocketHandle)m_Socket );
+            StopSockets();
+            m_Socket = -1;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Sends a request and waits for its response. A connection kept from an earlier request
+    // may have been closed by the server since, so failing on one tries a new connection.
+    // Failing on a new one turns the client off.
+    //--------------------------------------------------------------------------------------
+    bool ShaderRemoteCacheClient::Exchange( unsigned short uCode, unsigned long long uKey, const void* pData, size_t uSize, ShaderRemoteMessage& Response, std::vector<char>& Payload )
+    {
+        for ( ;; )
+        {
+            const bool bKept = ( m_Socket != -1 );
+            if ( !Connect() )
+            {
+                break;
+            }
+
+            const SocketHandle Socket = (SocketHandle)m_Socket;
+            if ( SendRemoteMessage( Socket, SHADER_REMOTE_REQUEST_MAGIC, uCode, uKey, pData, uSize ) &&
+                 ReceiveRemoteMessage( Socket, SHADER_REMOTE_RESPONSE_MAGIC, Response, Payload ) && Response.uKey == uKey )
+            {
+                m_Stats.uBytesSent += sizeof( ShaderRemoteMessage ) + uSize;
+                m_Stats.uBytesReceived += sizeof( ShaderRemoteMessage ) + Payload.size();
+                return true;
+            }
+
+            Disconnect();
+            if ( !bKept )
+            {
+                break;
+            }
+        }
+
+        m_bUnavailable = true;
+        return false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderRemoteCacheClient::Get( unsigned long long uKey, std::vector<char>& Blob )
+    {
+        Blob.clear();
+        if ( !IsEnabled() )
+        {
+            return false;
+        }
+
+        const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+        ShaderRemoteMessage Response;
+        const bool bExchanged = Exchange( SHADER_REMOTE_GET, uKey, NULL, 0, Response, Blob );
+        m_Stats.fSeconds += SecondsSince( Start );
+
+        if ( bExchanged && Response.uCode == SHADER_REMOTE_OK && IsIntact( Response, Blob ) )
+        {
+            m_Stats.uHits++;
+            return true;
+        }
+
+        if ( bExchanged && Response.uCode == SHADER_REMOTE_NOT_FOUND )
+        {
+            m_Stats.uMisses++;
+        }
+        else
+        {
+            m_Stats.uErrors++;
+        }
+
+        Blob.clear();
+        return false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderRemoteCacheClient::Put( unsigned long long uKey, const void* pData, size_t uSize )
+    {
+        if ( !IsEnabled() || uSize > SHADER_REMOTE_MAX_PAYLOAD )
+        {
+            return false;
+        }
+
+        const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+        ShaderRemoteMessage Response;
+        std::vector<char> Payload;
+        const bool bExchanged = Exchange( SHADER_REMOTE_PUT, uKey, pData, uSize, Response, Payload );
+        m_Stats.fSeconds += SecondsSince( Start );
+
+        if ( bExchanged && Response.uCode == SHADER_REMOTE_OK )
+        {
+            m_Stats.uStores++;
+            return true;
+        }
+
+        m_Stats.uErrors++;
+        return false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderRemoteCacheServer::ShaderRemoteCacheServer()
+        : m_Listener( -1 )
+        , m_uPort( 0 )
+        , m_bStop( false )
+        , m_uRequests( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ShaderRemoteCacheServer::~ShaderRemoteCacheServer()
+    {
+        Stop();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ShaderRemoteCacheServer::Start( unsigned short uPort, const char* szAddress )
+    {
+        Stop();
+
+        if ( !StartSockets() )
+        {
+            return false;
+        }
+
+        struct addrinfo* pAddresses = Resolve( szAddress, uPort, true );
+
+        SocketHandle Listener = NO_SOCKET;
+        for ( struct addrinfo* p = pAddresses; p && Listener == NO_SOCKET; p = p->ai_next )
+        {
+            Listener = socket( p->ai_family, p->ai_socktype, p->ai_protocol );
+            if ( Listener == NO_SOCKET )
+            {
+                continue;
+            }
+
+#ifndef _WIN32
+            // Restarting on the same port doesn't wait for the old connections to time out.
+            // On Windows this would let another process take the port.
+            int iReuse = 1;
+            setsockopt( Listener, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof( iReuse ) );
+#endif
+
+            if ( bind( Listener, p->ai_addr, (int)p->ai_addrlen ) != 0 || listen( Listener, SOMAXCONN ) != 0 )
+            {
+                CloseSocket( Listener );
+                Listener = NO_SOCKET;
+            }
+        }
+
+        if ( pAddresses )
+        {
+            freeaddrinfo( pAddresses );
+        }
+
+        if ( Listener == NO_SOCKET )
+        {
+            StopSockets();
+            return false;
+        }
+
+        struct sockaddr_storage Address;
+        socklen_t iLength = sizeof( Address );
+        memset( &Address, 0, sizeof( Address ) );
+        getsockname( Listener, (struct sockaddr*)&Address, &iLength );
+        m_uPort = ntohs( ( Address.ss_family == AF_INET6 ) ? ( (struct sockaddr_in6*)&Address )->sin6_port : ( (struct sockaddr_in*)&Address )->sin_port );
+
+        m_Listener = (intptr_t)Listener;
+        m_bStop = false;
+        m_AcceptThread = std::thread( &ShaderRemoteCacheServer::Accept, this );
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheServer::Stop()
+    {
+        if ( !m_AcceptThread.joinable() )
+        {
+            return;
+        }
+
+        m_bStop = true;
+        m_AcceptThread.join();
+
+        CloseSocket( (SocketHandle)m_Listener );
+        m_Listener = -1;
+
+        // Wakes the connections' threads, which close their sockets
+        {
+            std::lock_guard<std::mutex> Lock( m_Mutex );
+            for ( size_t i = 0; i < m_Connections.size(); i++ )
+            {
+                shutdown( (SocketHandle)m_Connections[i], SHUTDOWN_BOTH );
+            }
+        }
+
+        for ( size_t i = 0; i < m_Threads.size(); i++ )
+        {
+            m_Threads[i].join();
+        }
+        m_Threads.clear();
+        m_Blobs.clear();
+
+        StopSockets();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    size_t ShaderRemoteCacheServer::GetBlobCount() const
+    {
+        std::lock_guard<std::mutex> Lock( m_Mutex );
+        return m_Blobs.size();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // The listener's thread: waits for connections a little at a time, to notice Stop
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheServer::Accept()
+    {
+        const SocketHandle Listener = (SocketHandle)m_Listener;
+
+        while ( !m_bStop )
+        {
+            fd_set Readable;
+            FD_ZERO( &Readable );
+            FD_SET( Listener, &Readable );
+
+            struct timeval Timeout;
+            Timeout.tv_sec = 0;
+            Timeout.tv_usec = 100 * 1000;
+
+            if ( select( (int)Listener + 1, &Readable, NULL, NULL, &Timeout ) <= 0 )
+            {
+                continue;
+            }
+
+            const SocketHandle Connection = accept( Listener, NULL, NULL );
+            if ( Connection == NO_SOCKET )
+            {
+                continue;
+            }
+            SetNoDelay( Connection );
+
+            std::lock_guard<std::mutex> Lock( m_Mutex );
+            m_Connections.push_back( (intptr_t)Connection );
+            m_Threads.push_back( std::thread( &ShaderRemoteCacheServer::Serve, this, (intptr_t)Connection ) );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // A connection's thread: answers its requests until it closes, or sends something that
+    // isn't a request
+    //--------------------------------------------------------------------------------------
+    void ShaderRemoteCacheServer::Serve( intptr_t Connection )
+    {
+        const SocketHandle Socket = (SocketHandle)Connection;
+        ShaderRemoteMessage Request;
+        std::vector<char> Payload;
+
+        while ( ReceiveRemoteMessage( Socket, SHADER_REMOTE_REQUEST_MAGIC, Request, Payload ) )
+        {
+            m_uRequests++;
+
+            unsigned short uCode = SHADER_REMOTE_ERROR;
+            std::vector<char> Reply;
+
+            if ( Request.uCode == SHADER_REMOTE_GET )
+            {
+                std::lock_guard<std::mutex> Lock( m_Mutex );
+                std::map< unsigned long long, std::vector<char> >::const_iterator it = m_Blobs.find( Request.uKey );
+                if ( it != m_Blobs.end() )
+                {
+                    Reply = it->second;
+                    uCode = SHADER_REMOTE_OK;
+                }
+                else
+                {
+                    uCode = SHADER_REMOTE_NOT_FOUND;
+                }
+            }
+            else if ( Request.uCode == SHADER_REMOTE_PUT && IsIntact( Request, Payload ) )
+            {
+                std::lock_guard<std::mutex> Lock( m_Mutex );
+                m_Blobs[ Request.uKey ].swap( Payload );
+                uCode = SHADER_REMOTE_OK;
+            }
+
+            if ( !SendRemoteMessage( Socket, SHADER_REMOTE_RESPONSE_MAGIC, uCode, Request.uKey, Reply.empty() ? NULL : &Reply[0], Reply.size() ) )
+            {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> Lock( m_Mutex );
+        m_Connections.erase( std::find( m_Connections.begin(), m_Connections.end(), Connection ) );
+        CloseSocket( Socket );
+    }
+}
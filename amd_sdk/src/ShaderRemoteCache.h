@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderRemoteCache.h
+//
+// Compiled shaders shared through a cache server, so a shader compiled by one developer
+// or build agent isn't compiled again by the next. ShaderCache asks the server before it
+// runs fxc, with a key made from the hash of the preprocessed source, the target, entry
+// point and flags, and the compiler, and hands the server what it compiled.
+//
+// The protocol is a request and a response at a time over a TCP connection, usually to
+// the loopback address, each a ShaderRemoteMessage followed by its payload:
+//
+//   GET key            ->  OK with the blob, or NOT_FOUND
+//   PUT key, blob      ->  OK, or ERROR if the blob didn't arrive intact
+//
+// Every payload carries its hash, checked on arrival. The connection stays open between
+// requests. ShaderRemoteCacheServer is a reference server that keeps the blobs in memory,
+// for the headless ShaderCacheTool and for a team to run on a shared machine.
+//
+// Values are stored little endian, as on every platform the SDK runs on.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_SHADER_REMOTE_CACHE_H
+#define AMD_SDK_SHADER_REMOTE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace AMD
+{
+    enum SHADER_REMOTE_CODE
+    {
+        // Requests
+        SHADER_REMOTE_GET = 1,
+        SHADER_REMOTE_PUT = 2,
+
+        // Responses
+        SHADER_REMOTE_OK = 100,
+        SHADER_REMOTE_NOT_FOUND = 101,
+        SHADER_REMOTE_ERROR = 102,
+    };
+
+    static const unsigned int SHADER_REMOTE_REQUEST_MAGIC = 0x51435253;     // "SRCQ"
+    static const unsigned int SHADER_REMOTE_RESPONSE_MAGIC = 0x52435253;    // "SRCR"
+    static const unsigned short SHADER_REMOTE_VERSION = 1;
+    static const unsigned int SHADER_REMOTE_MAX_PAYLOAD = 64 * 1024 * 1024;
+    static const unsigned short SHADER_REMOTE_DEFAULT_PORT = 7439;
+
+    // A message as sent, followed by uLength bytes of payload
+    struct ShaderRemoteMessage
+    {
+        unsigned int            uMagic;
+        unsigned short          uVersion;
+        unsigned short          uCode;          // SHADER_REMOTE_CODE
+        unsigned long long      uKey;
+        unsigned long long      uPayloadHash;   // ShaderHasher::Hash of the payload
+        unsigned int            uLength;
+        unsigned int            uReserved;
+    };
+
+    struct ShaderRemoteCacheStats
+    {
+        unsigned int            uHits;
+        unsigned int            uMisses;
+        unsigned int            uStores;
+        unsigned int            uErrors;        // Requests that failed, or that the server refused
+        unsigned long long      uBytesReceived;
+        unsigned long long      uBytesSent;
+        double                  fSeconds;       // Waiting for the server
+    };
+
+    // One connection to a cache server, made on first use. Not thread safe: ShaderCache
+    // uses it from the thread that runs the compile scheduler.
+    class ShaderRemoteCacheClient
+    {
+    public:
+
+        ShaderRemoteCacheClient();
+        ~ShaderRemoteCacheClient();
+
+        // Host name or address, and port. NULL turns the cache off.
+        void SetServer( const char* szHost, unsigned short uPort );
+
+        // False when off, or after the server couldn't be reached, so that a missing
+        // server costs one timeout rather than one per shader. SetServer tries again.
+        bool IsEnabled() const { return !m_Host.empty() && !m_bUnavailable; }
+
+        // False on a miss, and when the server can't be reached or answers wrongly
+        bool Get( unsigned long long uKey, std::vector<char>& Blob );
+        bool Put( unsigned long long uKey, const void* pData, size_t uSize );
+
+        const ShaderRemoteCacheStats& GetStats() const { return m_Stats; }
+        void ResetStats();
+
+    private:
+
+        ShaderRemoteCacheClient( const ShaderRemoteCacheClient& );
+        ShaderRemoteCacheClient& operator=( const ShaderRemoteCacheClient& );
+
+        bool Connect();
+        void Disconnect();
+        bool Exchange( unsigned short uCode, unsigned long long uKey, const void* pData, size_t uSize, ShaderRemoteMessage& Response, std::vector<char>& Payload );
+
+        std::string                 m_Host;
+        unsigned short              m_uPort;
+        intptr_t                    m_Socket;       // -1 when not connected
+        bool                        m_bUnavailable;
+        ShaderRemoteCacheStats      m_Stats;
+    };
+
+    // Serves GET and PUT from memory, a thread per connection
+    class ShaderRemoteCacheServer
+    {
+    public:
+
+        ShaderRemoteCacheServer();
+        ~ShaderRemoteCacheServer();
+
+        // Listens on the address, by default the loopback one only. Port 0 picks a free
+        // port, which GetPort returns.
+        bool Start( unsigned short uPort, const char* szAddress = "127.0.0.1" );
+
+        // Closes every connection and waits for their threads
+        void Stop();
+
+        unsigned short GetPort() const { return m_uPort; }
+        size_t GetBlobCount() const;
+        unsigned int GetRequestCount() const { return m_uRequests; }
+
+    private:
+
+        ShaderRemoteCacheServer( const ShaderRemoteCacheServer& );
+        ShaderRemoteCacheServer& operator=( const ShaderRemoteCacheServer& );
+
+        void Accept();
+        void Serve( intptr_t Socket );
+
+        intptr_t                                            m_Listener;     // -1 when stopped
+        unsigned short                                      m_uPort;
+        std::atomic<bool>                                   m_bStop;
+        std::atomic<unsigned int>                           m_uRequests;
+        std::thread                                         m_AcceptThread;
+        std::vector<std::thread>                            m_Threads;      // Of the connections
+        std::vector<intptr_t>                               m_Connections;  // Open ones
+        std::map< unsigned long long, std::vector<char> >   m_Blobs;
+        mutable std::mutex                                  m_Mutex;        // Guards all but the listener
+    };
+}
+
+#endif // AMD_SDK_SHADER_REMOTE_CACHE_H
@@ -25,14 +25,6 @@
 
 //using namespace AMD;
 
-#if USE_RDTSC
-__declspec(naked) LONGLONG __cdecl rdtsc_time(void)
-{
-    __asm rdtsc
-    __asm ret
-}
-#endif
-
 //-----------------------------------------------------------------------------
 Timer::Timer() :
 m_LastTime( 0.0 ),
@@ -66,20 +58,9 @@ double Timer::GetTimeNumFrames()
 CpuTimer::CpuTimer() :
 Timer()
 {
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency( &freq );
-    m_freq = static_cast<double>(freq.QuadPart);
-
-#if USE_RDTSC
-    const double calibrationTime = 0.1;
-
-    LONGLONG start, stop;
-    start = rdtsc_time();
-    Delay(calibrationTime);
-    stop = rdtsc_time();
-
-    m_freqRdtsc = static_cast<double>(stop - start) / calibrationTime;
-#endif
+    // CDXUTClock reads the invariant TSC where available, else QueryPerformanceCounter
+    m_startTime = 0;
+    m_freq = static_cast<double>(CDXUTClock::GetFrequency());
 }
 
 CpuTimer::~CpuTimer()
@@ -102,114 +83,212 @@ void CpuTimer::Reset( bool bResetSum )
 
 void CpuTimer::Start()
 {
-#if USE_RDTSC
-    m_startTime.QuadPart = rdtsc_time();
-#else
-    QueryPerformanceCounter( &m_startTime );
-#endif
+    m_startTime = CDXUTClock::Now();
 }
 
 void CpuTimer::Stop()
 {
-    LARGE_INTEGER t;
-    double freq;
+    const double dt = static_cast<double>(CDXUTClock::Now() - m_startTime) / m_freq;
 
-#if USE_RDTSC
-    t.QuadPart = rdtsc_time();
-    freq = m_freqRdtsc;
-#else
-    QueryPerformanceCounter( &t );
-    freq = m_freq;
-#endif
+    m_LastTime += dt;
+    m_SumTime += dt;
+}
 
-    m_LastTime += static_cast<double>(t.QuadPart - m_startTime.QuadPart) / freq;
-    m_SumTime += static_cast<double>(t.QuadPart - m_startTime.QuadPart) / freq;
+void CpuTimer::Add( double sec )
+{
+    m_LastTime += sec;
+    m_SumTime += sec;
 }
 
 void CpuTimer::Delay( double sec )
 {
-    LARGE_INTEGER start, stop;
+    const LONGLONG start = CDXUTClock::Now();
     double t;
 
-    QueryPerformanceCounter( &start );
-
     do
     {
-        QueryPerformanceCounter( &stop );
-
-        t = static_cast<double>(stop.QuadPart - start.QuadPart) / m_freq;
+        t = static_cast<double>(CDXUTClock::Now() - start) / m_freq;
     } while (t < sec);
 }
 
 //-----------------------------------------------------------------------------
 
-GpuTimer::GpuTimer( ID3D11Device* pDev, UINT64 freq, UINT numTimeStamps ) :
-Timer(),
-m_pDevCtx( NULL ),
-m_numTimeStamps( numTimeStamps ),
-m_curIssueTs( m_numTimeStamps - 1 ),
-m_nextRetrTs( 0 ),
-m_FrameID( 0 ),
-
-m_CurTime( 0.0 )
+GpuQueryBackendD3D11::GpuQueryBackendD3D11( ID3D11Device* pDev ) :
+m_pDev( pDev ),
+m_pDevCtx( NULL )
 {
-    HRESULT hr;
-
     _ASSERT( pDev != NULL );
-    _ASSERT( numTimeStamps>0 );
 
     pDev->GetImmediateContext( &m_pDevCtx );
     _ASSERT( m_pDevCtx != NULL );
+}
+
+GpuQueryBackendD3D11::~GpuQueryBackendD3D11()
+{
+    Destroy();
+    SAFE_RELEASE( m_pDevCtx );
+}
+
+bool GpuQueryBackendD3D11::Create( unsigned int uFrames, unsigned int uTimestamps )
+{
+    Destroy();
 
     D3D11_QUERY_DESC qd;
     qd.MiscFlags = 0;
 
-    m_ts = new TsRecord[m_numTimeStamps];
-    for (UINT i = 0; i < m_numTimeStamps; i++)
+    qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    m_Disjoint.resize( uFrames, NULL );
+    for (UINT i = 0; i < uFrames; i++)
     {
-        qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+        if (FAILED( m_pDev->CreateQuery( &qd, &m_Disjoint[i] ) ))
+        {
+            Destroy();
+            return false;
+        }
+    }
 
-        hr = pDev->CreateQuery( &qd, &m_ts[i].pDisjointTS );
-        _ASSERT( (hr == S_OK) && (m_ts[i].pDisjointTS != NULL) );
+    qd.Query = D3D11_QUERY_TIMESTAMP;
+    m_Timestamps.resize( uTimestamps, NULL );
+    for (UINT i = 0; i < uTimestamps; i++)
+    {
+        if (FAILED( m_pDev->CreateQuery( &qd, &m_Timestamps[i] ) ))
+        {
+            Destroy();
+            return false;
+        }
+    }
 
-        qd.Query = D3D11_QUERY_TIMESTAMP;
+    return true;
+}
+
+void GpuQueryBackendD3D11::Destroy()
+{
+    for (size_t i = 0; i < m_Disjoint.size(); i++)
+    {
+        SAFE_RELEASE( m_Disjoint[i] );
+    }
+    m_Disjoint.clear();
+
+    for (size_t i = 0; i < m_Timestamps.size(); i++)
+    {
+        SAFE_RELEASE( m_Timestamps[i] );
+    }
+    m_Timestamps.clear();
+}
 
-        hr = pDev->CreateQuery( &qd, &m_ts[i].pStart );
-        _ASSERT( (hr == S_OK) && (m_ts[i].pStart != NULL) );
+void GpuQueryBackendD3D11::BeginDisjoint( unsigned int uFrame )
+{
+    m_pDevCtx->Begin( m_Disjoint[uFrame] );
+}
 
-        hr = pDev->CreateQuery( &qd, &m_ts[i].pStop );
-        _ASSERT( (hr == S_OK) && (m_ts[i].pStop != NULL) );
+void GpuQueryBackendD3D11::EndDisjoint( unsigned int uFrame )
+{
+    m_pDevCtx->End( m_Disjoint[uFrame] );
+}
 
-        m_ts[i].state.stateWord = 0;
+void GpuQueryBackendD3D11::EndTimestamp( unsigned int uTimestamp )
+{
+    m_pDevCtx->End( m_Timestamps[uTimestamp] );
+}
+
+bool GpuQueryBackendD3D11::GetDisjoint( unsigned int uFrame, unsigned long long& uFrequency, bool& bDisjoint )
+{
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT tsd;
+    if (S_OK != m_pDevCtx->GetData( m_Disjoint[uFrame], &tsd, sizeof( tsd ), 0 ))
+    {
+        return false;
     }
-    m_CurTimeFrame.id = 0;
-    m_CurTimeFrame.invalid = 1;
 
-    freq = 0;//prevent warning
+    uFrequency = tsd.Frequency;
+    bDisjoint = (FALSE != tsd.Disjoint);
+    return true;
 }
 
-GpuTimer::~GpuTimer()
+bool GpuQueryBackendD3D11::GetTimestamp( unsigned int uTimestamp, unsigned long long& uTicks )
 {
-    for (UINT i = 0; i < m_numTimeStamps; i++)
+    UINT64 ts;
+    if (S_OK != m_pDevCtx->GetData( m_Timestamps[uTimestamp], &ts, sizeof( ts ), 0 ))
     {
-        SAFE_RELEASE( m_ts[i].pDisjointTS );
-        SAFE_RELEASE( m_ts[i].pStart );
-        SAFE_RELEASE( m_ts[i].pStop );
+        return false;
     }
-    SAFE_DELETE_ARRAY( m_ts );
 
-    SAFE_RELEASE( m_pDevCtx );
+    uTicks = ts;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+GpuTimer::GpuTimer( ID3D11Device* pDev, UINT64 freq, UINT numTimeStamps ) :
+Timer(),
+m_pPool( NULL ),
+m_pOwnPool( NULL ),
+m_pOwnBackend( NULL ),
+m_CurScope( AMD::GPU_QUERY_POOL_INVALID_SCOPE ),
+m_pHistogram( NULL ),
+m_pListener( NULL ),
+m_NextCaptureId( 0 ),
+m_FirstFrame( 0 ),
+m_CurTimeFrame( 0xFFFFFFFF ),
+m_CurTimeValid( false ),
+m_CurTime( 0.0 ),
+m_LastTimelineValid( false )
+{
+    _ASSERT( pDev != NULL );
+    _ASSERT( numTimeStamps>0 );
+
+    m_pOwnBackend = new GpuQueryBackendD3D11( pDev );
+    m_pOwnPool = new AMD::GpuQueryPool();
+    if (!m_pOwnPool->Create( m_pOwnBackend, numTimeStamps ))
+    {
+        _ASSERT( false && "GpuTimer failed to create its queries" );
+    }
+    m_pPool = m_pOwnPool;
+
+    freq = 0;//prevent warning
+}
+
+GpuTimer::GpuTimer( AMD::GpuQueryPool* pPool ) :
+Timer(),
+m_pPool( pPool ),
+m_pOwnPool( NULL ),
+m_pOwnBackend( NULL ),
+m_CurScope( AMD::GPU_QUERY_POOL_INVALID_SCOPE ),
+m_pHistogram( NULL ),
+m_pListener( NULL ),
+m_NextCaptureId( 0 ),
+m_FirstFrame( pPool->GetFrame() ),
+m_CurTimeFrame( m_FirstFrame - 1 ),
+m_CurTimeValid( false ),
+m_CurTime( 0.0 ),
+m_LastTimelineValid( false )
+{
+    _ASSERT( pPool != NULL );
+}
+
+GpuTimer::~GpuTimer()
+{
+    m_pPool->RemoveClient( this );
+
+    SAFE_DELETE( m_pOwnPool );
+    SAFE_DELETE( m_pOwnBackend );
 }
 
 void GpuTimer::Reset( bool bResetSum )
 {
+    if (NULL != m_pOwnPool)
+    {
+        m_pOwnPool->NextFrame();
+    }
+
     FinishCollection();
-    m_FrameID = (m_FrameID + 1) & 0x3FFFFFFF;
 
     if (bResetSum)
     {
-        WaitIdle();
-        m_CurTimeFrame.invalid = 1;
+        // drop the frames still in flight rather than waiting for them
+        m_FirstFrame = m_pPool->GetFrame();
+        m_CurTimeFrame = m_FirstFrame - 1;
+        m_CurTimeValid = false;
+        m_LastTimelineValid = false;
         m_CurTime = 0.0;
         m_LastTime = 0.0;
         m_SumTime = 0.0;
@@ -219,173 +298,138 @@ void GpuTimer::Reset( bool bResetSum )
 
 void GpuTimer::Start()
 {
-    if (++m_curIssueTs == m_numTimeStamps)
-    {
-        m_curIssueTs = 0;
-    }
-
-    if (0 != m_ts[m_curIssueTs].state.data.startIssued)
-    {
-        _ASSERT( false && "CPU stall required! This should never happen. Please increase GpuTimer::NumTimeStamps in Timer.h" );
-        CollectData( m_curIssueTs, TRUE );
-    }
+    _ASSERT( "Stop() not called for every Start()" && (m_CurScope == AMD::GPU_QUERY_POOL_INVALID_SCOPE) );
 
-    m_ts[m_curIssueTs].state.data.frameID = m_FrameID;
-    m_ts[m_curIssueTs].state.data.startIssued = 1;
-    m_ts[m_curIssueTs].state.data.stopIssued = 0;
-    m_pDevCtx->Begin( m_ts[m_curIssueTs].pDisjointTS );
-    m_pDevCtx->End( m_ts[m_curIssueTs].pStart );
+    m_CurScope = m_pPool->BeginScope( this, m_NextCaptureId, CDXUTClock::Now() );
+    m_NextCaptureId = 0;
 }
 
 void GpuTimer::Stop()
 {
-    // check if timestamp start has been issued but no stop yet
-    _ASSERT( (m_ts[m_curIssueTs].state.data.startIssued == 1) && (m_ts[m_curIssueTs].state.data.stopIssued == 0) );
+    m_pPool->EndScope( m_CurScope );
+    m_CurScope = AMD::GPU_QUERY_POOL_INVALID_SCOPE;
+}
 
-    m_ts[m_curIssueTs].state.data.stopIssued = 1;
-    m_pDevCtx->End( m_ts[m_curIssueTs].pStop );
-    m_pDevCtx->End( m_ts[m_curIssueTs].pDisjointTS );
+void GpuTimer::SetCapture( GpuTimerListener* listener, UINT captureId )
+{
+    m_pListener = listener;
+    m_NextCaptureId = captureId;
 }
 
 void GpuTimer::WaitIdle()
 {
-    while (m_nextRetrTs != m_curIssueTs)
-    {
-        CollectData( m_nextRetrTs, true );
+    m_pPool->Flush();
 
-        if (++m_nextRetrTs == m_numTimeStamps)
-        {
-            m_nextRetrTs = 0;
-        }
-    }
+    FinishCollection();
+}
 
-    // retrieve the current Ts
-    CollectData( m_nextRetrTs, true );
-    if (++m_nextRetrTs == m_numTimeStamps)
+void GpuTimer::FinishFrame()
+{
+    m_FrameTimes[m_NumFrames % AMD::GPU_QUERY_POOL_FRAMES].frame = m_CurTimeFrame;
+    m_FrameTimes[m_NumFrames % AMD::GPU_QUERY_POOL_FRAMES].time = m_CurTime;
+
+    m_LastTime = m_CurTime;
+    m_SumTime += m_CurTime;
+    ++m_NumFrames;
+
+    if (NULL != m_pHistogram)
     {
-        m_nextRetrTs = 0;
+        m_pHistogram->Record( m_CurTime );
     }
 
-    if (0 == m_CurTimeFrame.invalid)
+    m_LastTimeline = m_CurTimeline;
+    m_LastTimelineValid = true;
+
+    m_CurTimeValid = false;
+}
+
+bool GpuTimer::GetTimeline( LONGLONG& submit, UINT64& begin, UINT64& end )
+{
+    FinishCollection();
+
+    if (!m_LastTimelineValid)
     {
-        m_LastTime = m_CurTime;
-        m_SumTime += m_CurTime;
-        ++m_NumFrames;
+        return false;
     }
+
+    submit = m_LastTimeline.submit;
+    begin = m_LastTimeline.begin;
+    end = m_LastTimeline.end;
+    return true;
 }
 
-void GpuTimer::FinishCollection()
+bool GpuTimer::GetFrameTime( UINT frame, double& time )
 {
-    // retrieve all available timestamps
-    while (CollectData( m_nextRetrTs ))
+    FinishCollection();
+
+    const UINT count = (m_NumFrames < AMD::GPU_QUERY_POOL_FRAMES) ? m_NumFrames : AMD::GPU_QUERY_POOL_FRAMES;
+    for (UINT i = 0; i < count; i++)
     {
-        if (++m_nextRetrTs == m_numTimeStamps)
+        if (m_FrameTimes[i].frame == frame)
         {
-            m_nextRetrTs = 0;
+            time = m_FrameTimes[i].time;
+            return true;
         }
     }
+
+    return false;
 }
 
-bool GpuTimer::CollectData( UINT idx, BOOL stall )
+void GpuTimer::FinishCollection()
 {
-    if (!m_ts[idx].state.data.stopIssued)
+    // retrieve all available timestamps, this never waits for the GPU
+    m_pPool->Resolve();
+
+    // once the pool is past the frame, no more scopes of it will arrive
+    if (m_CurTimeValid && static_cast<int>(m_pPool->GetResolvedFrame() - m_CurTimeFrame) > 0)
     {
-        return false;
+        FinishFrame();
     }
+}
 
-    // start collecting data from a new frame?
-    if (m_ts[idx].state.data.frameID != m_CurTimeFrame.id)
+void GpuTimer::OnGpuScope( const AMD::GpuScopeResult& result )
+{
+    // results of frames issued before a full reset
+    if (static_cast<int>(result.uFrame - m_FirstFrame) < 0)
     {
-        // if frametimes collected are valid: write them into m_time
-        // so m_time always contains the most recent valid timing data
-        if (0 == m_CurTimeFrame.invalid)
-        {
-            m_LastTime = m_CurTime;
-            m_SumTime += m_CurTime;
-            ++m_NumFrames;
-        }
-
-        // start collecting time data of the next frame
-        m_CurTime = 0.0;
-        m_CurTimeFrame.id = m_ts[idx].state.data.frameID;
-        m_CurTimeFrame.invalid = 0;
+        return;
     }
 
-    // if we want to retrieve the next timing data NOW the CPU will stall
-    // increase NumTimeStamps in Timer.h to prevent this from happening
-    if (stall)
+    // start collecting data from a new frame?
+    if (result.uFrame != m_CurTimeFrame)
     {
-        HRESULT hr;
-        UINT64 start, stop;
-
-        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT tsd;
-        do
-        {
-            hr = m_pDevCtx->GetData( m_ts[idx].pDisjointTS, &tsd, sizeof( D3D11_QUERY_DATA_TIMESTAMP_DISJOINT ), 0 );
-        } while (hr == S_FALSE);
-
-        _ASSERT( hr == S_OK );
-
-        do
+        if (m_CurTimeValid)
         {
-            hr = m_pDevCtx->GetData( m_ts[idx].pStart, &start, sizeof( UINT64 ), 0 );
-        } while (hr == S_FALSE);
-
-        _ASSERT( hr == S_OK );
-
-        do
-        {
-            hr = m_pDevCtx->GetData( m_ts[idx].pStop, &stop, sizeof( UINT64 ), 0 );
-        } while (hr == S_FALSE);
-
-        _ASSERT( hr == S_OK );
-
-        if (tsd.Disjoint || ((start & 0xFFFFFFFF) == 0xFFFFFFFF) || ((stop & 0xFFFFFFFF) == 0xFFFFFFFF))
-        {
-            // mark current frametime as invalid
-            m_CurTimeFrame.invalid = 1;
+            FinishFrame();
         }
-        else
-        {
-            m_CurTime += static_cast<double>(stop - start) / static_cast<double>(tsd.Frequency);
-        }
-
-        m_ts[idx].state.stateWord = 0;
-        return true;
-    }
 
-    // finally try collecting the available data, return false if it was not yet available
-    UINT64 start, stop;
-
-    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT tsd;
-    if (S_FALSE == m_pDevCtx->GetData( m_ts[idx].pDisjointTS, &tsd, sizeof( D3D11_QUERY_DATA_TIMESTAMP_DISJOINT ), 0 ))
-    {
-        return false;
-    }
-    if (S_FALSE == m_pDevCtx->GetData( m_ts[idx].pStart, &start, sizeof( UINT64 ), 0 ))
-    {
-        return false;
+        m_CurTime = 0.0;
+        m_CurTimeFrame = result.uFrame;
+        m_CurTimeValid = true;
+        m_CurTimeline.submit = result.iCpuTicks;
+        m_CurTimeline.begin = result.uStart;
     }
-
-    if (S_FALSE == m_pDevCtx->GetData( m_ts[idx].pStop, &stop, sizeof( UINT64 ), 0 ))
+    else if (!m_CurTimeValid)
     {
-        return false;
+        // an earlier scope of this frame was disjoint
+        return;
     }
 
-    // all data was available, so evaluate times
-    if (tsd.Disjoint || ((start & 0xFFFFFFFF) == 0xFFFFFFFF) || ((stop & 0xFFFFFFFF) == 0xFFFFFFFF))
+    if (!result.bValid)
     {
         // mark current frametime as invalid
-        m_CurTimeFrame.invalid = 1;
+        m_CurTimeValid = false;
+        return;
     }
-    else
+
+    UINT64 dt = (result.uStop - result.uStart);
+    m_CurTime += static_cast<double>(dt) / static_cast<double>(result.uFrequency);
+    m_CurTimeline.end = result.uStop;
+
+    if (0 != result.uUserData && NULL != m_pListener)
     {
-        UINT64 dt = (stop - start);
-        m_CurTime += static_cast<double>(dt) / static_cast<double>(tsd.Frequency);
+        m_pListener->OnGpuTimestamps( result.uUserData, result.uStart, result.uStop, result.uFrequency );
     }
-
-    m_ts[idx].state.stateWord = 0;
-    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -451,9 +495,13 @@ m_nameLen( 0 ),
 m_used( false ),
 m_parent( NULL ),
 m_firstChild( NULL ),
-m_next( NULL )
+m_next( NULL ),
+m_nameId( 0 ),
+m_captureBegin( 0 )
 {
-    m_gpu = (NULL != TimerEx::Instance().GetDevice()) ? new GpuTimer( TimerEx::Instance().GetDevice(), 0, 16 ) : NULL;
+    AMD::GpuQueryPool* pool = TimerEx::Instance().GetGpuQueryPool();
+    m_gpu = (NULL != pool) ? new GpuTimer( pool ) : NULL;
+    if (NULL != m_gpu) { m_gpu->SetHistogram( &m_gpuHistogram ); }
 }
 
 TimingEvent::~TimingEvent()
@@ -515,6 +563,11 @@ double TimingEvent::GetTime( TimerType type, bool stall )
     }
 }
 
+bool TimingEvent::GetGpuFrameTime( UINT frame, double& time )
+{
+    return (NULL != m_gpu) && m_gpu->GetFrameTime( frame, time );
+}
+
 double TimingEvent::GetAvgTime( TimerType type, bool stall )
 {
     switch (type)
@@ -536,6 +589,17 @@ double TimingEvent::GetAvgTime( TimerType type, bool stall )
     }
 }
 
+void TimingEvent::GetPercentiles( TimerType type, AMD::LatencyPercentiles& percentiles )
+{
+    if (ttGpu == type && NULL != m_gpu)
+    {
+        // pick up the frames that completed since the last reset
+        m_gpu->GetTime();
+    }
+
+    ((ttGpu == type) ? m_gpuHistogram : m_cpuHistogram).GetPercentiles( percentiles );
+}
+
 TimingEvent* TimingEvent::GetTimer( LPCWSTR timerId )
 {
     size_t len = wcslen( timerId );
@@ -637,9 +701,22 @@ TimingEvent* TimingEvent::FindLastChildUsed()
 
 TimerEx::TimerEx() :
 m_pDev( NULL ),
+m_pGpuQueryBackend( NULL ),
+m_Root( NULL ),
 m_Current( NULL ),
-m_Unused( NULL )
+m_Unused( NULL ),
+m_OwnerThreadId( 0 ),
+m_TreeGeneration( 1 ),
+m_CaptureFrames( 0 ),
+m_CaptureFrame( 0 ),
+m_CaptureStartTicks( 0 ),
+m_CaptureFrameTicks( 0 ),
+m_CaptureThreadTracks( 0 ),
+m_CaptureCounterFrame( 0 ),
+m_GpuClock( CDXUTClock::GetFrequency() ),
+m_GpuClockRequested( false )
 {
+    m_TicksPerSecond = static_cast<double>(CDXUTClock::GetFrequency());
 };
 
 TimerEx::~TimerEx()
@@ -665,6 +742,18 @@ void TimerEx::DeleteTimerTree( TimingEvent* te )
 void TimerEx::Init( ID3D11Device* pDev )
 {
     m_pDev = pDev;
+    m_OwnerThreadId = GetCurrentThreadId();
+
+    if (NULL != pDev && NULL == m_pGpuQueryBackend)
+    {
+        // shared by the GPU timers of all TimingEvents
+        m_pGpuQueryBackend = new GpuQueryBackendD3D11( pDev );
+        if (!m_GpuQueries.Create( m_pGpuQueryBackend ))
+        {
+            _ASSERT( false && "TimerEx failed to create its GPU queries" );
+            SAFE_DELETE( m_pGpuQueryBackend );
+        }
+    }
 }
 
 void TimerEx::Destroy()
@@ -683,6 +772,18 @@ void TimerEx::Destroy()
     DeleteTimerTree( m_Root );
     m_Root = NULL;
 
+    // drop the timers cached by the call sites
+    ++m_TreeGeneration;
+
+    m_ThreadContexts.Destroy();
+
+    StopCapture();
+
+    m_GpuQueries.Destroy();
+    SAFE_DELETE( m_pGpuQueryBackend );
+    m_GpuClock.Clear();
+    m_GpuClockRequested = false;
+
     m_pDev = NULL;
 }
 
@@ -695,6 +796,15 @@ void TimerEx::Reset( TimingEvent* te, bool bResetSum )
         Reset( te->m_firstChild, bResetSum );
 
         // reset the timer event
+        if (bResetSum)
+        {
+            te->m_cpuHistogram.Clear();
+            te->m_gpuHistogram.Clear();
+        }
+        else if (te->m_used)
+        {
+            te->m_cpuHistogram.Record( te->m_cpu.GetTime() );
+        }
         te->m_cpu.Reset( bResetSum );
         if (NULL != te->m_gpu) { te->m_gpu->Reset( bResetSum ); }
 
@@ -744,17 +854,73 @@ void TimerEx::Reset( bool bResetSum )
     _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
     _ASSERT( "Stop() not called for every Start(...)" && (m_Current == NULL) );
 
+    // end the frame of the GPU timers and pick up the results that came back
+    m_GpuQueries.NextFrame();
+
     if (NULL != m_Root)
     {
         Reset( m_Root, bResetSum );
     }
+
+    // a full reset moves unused timers out of the tree, which the call sites may have cached
+    if (bResetSum)
+    {
+        ++m_TreeGeneration;
+    }
+
+    // scopes that other threads finished since the last reset
+    MergeThreadScopes();
+
+    UpdateGpuClock();
+
+    if (m_Trace.IsOpen())
+    {
+        CaptureFrame();
+    }
 }
 
-void TimerEx::Start( LPCWSTR timerId )
+// adds each scope drained from a thread's ring buffer to the timer at the same path
+struct TimerEx::ThreadScopeMerger
 {
-    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+    TimerEx* timer;
+
+    void operator()( const AMD::ThreadTimingContext& ctx, const wchar_t* const* path, unsigned int depth, long long begin, long long end )
+    {
+        timer->AddThreadScope( path, depth, static_cast<double>(end - begin) / timer->m_TicksPerSecond );
+
+        if (timer->IsCapturingFrame())
+        {
+            timer->NameThreadTracks( ctx.GetThreadIndex() + 1 );
+            timer->AddCaptureEvent( CAPTURE_TRACK_THREADS + ctx.GetThreadIndex(), path[depth - 1], begin, end );
+        }
+    }
+};
+
+void TimerEx::AddThreadScope( const wchar_t* const* path, unsigned int depth, double sec )
+{
+    TimingEvent* te = NULL;
+    for (unsigned int i = 0; i < depth; ++i)
+    {
+        te = GetOrCreateTimer( te, path[i] );
+        te->m_used = true;
+    }
+    te->m_cpu.Add( sec );
+}
+
+void TimerEx::MergeThreadScopes()
+{
+    ThreadScopeMerger merger = { this };
+
+    for (AMD::ThreadTimingContext* ctx = m_ThreadContexts.GetFirst(); NULL != ctx; ctx = ctx->GetNext())
+    {
+        ctx->Drain( merger );
+    }
+}
+
+TimingEvent* TimerEx::GetOrCreateTimer( TimingEvent* parent, LPCWSTR timerId )
+{
+    TimingEvent* te = (NULL == parent) ? GetTimer( timerId ) : parent->GetTimer( timerId );
 
-    TimingEvent* te = (NULL == m_Current) ? GetTimer( timerId ) : m_Current->GetTimer( timerId );
     if (NULL == te)
     {
         // create new timer event
@@ -770,11 +936,14 @@ void TimerEx::Start( LPCWSTR timerId )
         }
 
         te->SetName( timerId );
-        te->m_parent = m_Current;
+        te->m_nameId = m_Names.Intern( timerId );
+        te->m_parent = parent;
+        te->m_cpuHistogram.Clear();
+        te->m_gpuHistogram.Clear();
 
         // now look where to insert it
         TimingEvent* lu = NULL;
-        if (NULL == m_Current)
+        if (NULL == parent)
         {
             TimingEvent* tmp = m_Root;
             while (tmp)
@@ -788,7 +957,7 @@ void TimerEx::Start( LPCWSTR timerId )
         }
         else
         {
-            lu = m_Current->FindLastChildUsed();
+            lu = parent->FindLastChildUsed();
         }
 
         if (NULL != lu)
@@ -798,33 +967,409 @@ void TimerEx::Start( LPCWSTR timerId )
         }
         else
         {
-            if (NULL == m_Current)
+            if (NULL == parent)
             {
                 te->m_next = m_Root;
                 m_Root = te;
             }
             else
             {
-                te->m_next = m_Current->m_firstChild;
-                m_Current->m_firstChild = te;
+                te->m_next = parent->m_firstChild;
+                parent->m_firstChild = te;
             }
 
         }
     }
 
+    return te;
+}
+
+void TimerEx::Start( LPCWSTR timerId )
+{
+    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    if (GetCurrentThreadId() != m_OwnerThreadId)
+    {
+        m_ThreadContexts.GetContext()->Begin( timerId, CDXUTClock::Now() );
+        return;
+    }
+
+    StartTimer( GetOrCreateTimer( m_Current, timerId ) );
+}
+
+void TimerEx::Start( TimerSite& site )
+{
+    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    if (GetCurrentThreadId() != m_OwnerThreadId)
+    {
+        // other threads don't touch the tree, so they can't use the cached timer either
+        Start( site.name );
+        return;
+    }
+
+    // the same call site usually runs under the same parent every frame
+    TimingEvent* te = site.event;
+    if (NULL == te || site.parent != m_Current || site.generation != m_TreeGeneration)
+    {
+        if (0 == site.id)
+        {
+            site.id = m_Names.Intern( site.name );
+        }
+
+        te = FindTimer( m_Current, site.id );
+        if (NULL == te)
+        {
+            te = GetOrCreateTimer( m_Current, site.name );
+        }
+
+        site.parent = m_Current;
+        site.event = te;
+        site.generation = m_TreeGeneration;
+    }
+
+    StartTimer( te );
+}
+
+TimingEvent* TimerEx::FindTimer( TimingEvent* parent, UINT nameId )
+{
+    TimingEvent* te = (NULL == parent) ? m_Root : parent->m_firstChild;
+    while (NULL != te && te->m_nameId != nameId)
+    {
+        te = te->m_next;
+    }
+    return te;
+}
+
+void TimerEx::StartTimer( TimingEvent* te )
+{
     m_Current = te;
+
+    if (IsCapturingFrame())
+    {
+        if (NULL != m_Current->m_gpu)
+        {
+            AMD::TraceEvent ev;
+            AMD::SetTraceEventName( ev, m_Current->GetName() );
+            ev.uTrack = CAPTURE_TRACK_GPU;
+            ev.uFrame = m_CaptureFrame;
+            m_CaptureGpuScopes.push_back( ev );
+            m_Current->m_gpu->SetCapture( this, static_cast<UINT>(m_CaptureGpuScopes.size()) );
+        }
+
+        m_Current->Start();
+
+        m_Current->m_captureBegin = CDXUTClock::Now();
+        return;
+    }
+
     m_Current->Start();
 }
 
 void TimerEx::Stop()
 {
     _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    if (GetCurrentThreadId() != m_OwnerThreadId)
+    {
+        m_ThreadContexts.GetContext()->End( CDXUTClock::Now() );
+        return;
+    }
+
     _ASSERT( "Start(...) not called before Stop()" && (m_Current != NULL) );
 
+    if (0 != m_Current->m_captureBegin)
+    {
+        const LONGLONG t = CDXUTClock::Now();
+        m_Current->Stop();
+
+        if (IsCapturingFrame())
+        {
+            AddCaptureEvent( CAPTURE_TRACK_CPU, m_Current->GetName(), m_Current->m_captureBegin, t );
+        }
+        m_Current->m_captureBegin = 0;
+        m_Current = m_Current->m_parent;
+        return;
+    }
+
     m_Current->Stop();
     m_Current = m_Current->m_parent;
 }
 
+void TimerEx::ReleaseThread()
+{
+    if (GetCurrentThreadId() != m_OwnerThreadId)
+    {
+        m_ThreadContexts.ReleaseContext( CDXUTClock::Now() );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// trace capture
+//-----------------------------------------------------------------------------
+
+// frames to keep the trace open after the last captured frame, so the GPU results of that frame
+// arrive before the file is closed. The query pool returns a frame's results before it reuses its
+// slot, GPU_QUERY_POOL_FRAMES frames later, or drops the frame.
+static const UINT CAPTURE_GPU_LATENCY_FRAMES = AMD::GPU_QUERY_POOL_FRAMES;
+
+// seconds between GPU clock calibration samples, each one waits for the GPU to go idle
+static const double GPU_CLOCK_CALIBRATION_INTERVAL = 1.0;
+
+bool TimerEx::StartCapture( LPCWSTR fileName, UINT numFrames )
+{
+    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    if (m_Trace.IsOpen() || 0 == numFrames || !m_Trace.Open( fileName ))
+    {
+        return false;
+    }
+
+    m_Trace.SetTrackName( CAPTURE_TRACK_FRAMES, "Frames" );
+    m_Trace.SetTrackName( CAPTURE_TRACK_CPU, "CPU" );
+    m_Trace.SetTrackName( CAPTURE_TRACK_GPU, "GPU" );
+
+    const LONGLONG t = CDXUTClock::Now();
+    m_CaptureStartTicks = t;
+    m_CaptureFrameTicks = t;
+    m_CaptureFrames = numFrames;
+    m_CaptureFrame = 0;
+    m_CaptureThreadTracks = 0;
+    m_CaptureCounterFrame = AMD::FrameCounterRegistry::Instance().GetFrameCount();
+    m_CaptureGpuScopes.clear();
+    m_CaptureGpuScopes.reserve( 64 * numFrames );
+
+    CalibrateGpuClock();
+
+    return true;
+}
+
+bool TimerEx::IsCapturing() const
+{
+    return m_Trace.IsOpen();
+}
+
+bool TimerEx::GetGpuTimeline( LPCWSTR timerId, GpuTimeline& timeline )
+{
+    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    // keep the GPU clock calibrated while the timeline is in use
+    m_GpuClockRequested = true;
+
+    TimingEvent* te = NULL;
+
+    if (NULL != m_Current)
+    {
+        te = m_Current->GetTimer( timerId );
+    }
+
+    if (NULL == te)
+    {
+        te = GetTimer( timerId );
+    }
+
+    LONGLONG submit;
+    UINT64 begin, end;
+    if (NULL == te || NULL == te->m_gpu || !m_GpuClock.IsCalibrated() || !te->m_gpu->GetTimeline( submit, begin, end ))
+    {
+        return false;
+    }
+
+    timeline.submit = submit;
+    timeline.gpuBegin = m_GpuClock.GpuToCpu( begin );
+    timeline.gpuEnd = m_GpuClock.GpuToCpu( end );
+    return true;
+}
+
+bool TimerEx::IsCapturingFrame() const
+{
+    return m_Trace.IsOpen() && m_CaptureFrame >= 1 && m_CaptureFrame <= m_CaptureFrames;
+}
+
+void TimerEx::CaptureFrame()
+{
+    const LONGLONG t = CDXUTClock::Now();
+
+    if (IsCapturingFrame())
+    {
+        WCHAR name[32];
+        swprintf_s( name, 32, L"Frame %u", m_CaptureFrame );
+        AddCaptureEvent( CAPTURE_TRACK_FRAMES, name, m_CaptureFrameTicks, t );
+        AddCaptureCounters( m_CaptureFrameTicks );
+    }
+
+    ++m_CaptureFrame;
+    m_CaptureFrameTicks = t;
+
+    if (m_CaptureFrame > m_CaptureFrames + CAPTURE_GPU_LATENCY_FRAMES)
+    {
+        StopCapture();
+    }
+}
+
+// finds the GPU timestamp that matches a point on the trace timeline, by waiting for a timestamp
+// query on an idle queue. Good to within the GetData polling latency.
+void TimerEx::CalibrateGpuClock()
+{
+    if (NULL == m_pDev)
+    {
+        return;
+    }
+
+    ID3D11DeviceContext* pCtx = NULL;
+    ID3D11Query* pDisjoint = NULL;
+    ID3D11Query* pTimestamp = NULL;
+
+    D3D11_QUERY_DESC qd;
+    qd.MiscFlags = 0;
+    qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    HRESULT hr = m_pDev->CreateQuery( &qd, &pDisjoint );
+    if (SUCCEEDED( hr ))
+    {
+        qd.Query = D3D11_QUERY_TIMESTAMP;
+        hr = m_pDev->CreateQuery( &qd, &pTimestamp );
+    }
+
+    if (SUCCEEDED( hr ))
+    {
+        m_pDev->GetImmediateContext( &pCtx );
+
+        // the GPU writes the timestamp somewhere between the flush and the CPU seeing it. The
+        // first try also waits for the work already queued, the next ones find the GPU idle and
+        // bracket the timestamp much tighter, so keep the tightest.
+        LONGLONG bestBefore = 0;
+        LONGLONG bestAfter = 0;
+        UINT64 bestTs = 0;
+        for (UINT i = 0; i < 3 && S_OK == hr; i++)
+        {
+            pCtx->Begin( pDisjoint );
+            pCtx->End( pTimestamp );
+            pCtx->End( pDisjoint );
+
+            const LONGLONG before = CDXUTClock::Now();
+            pCtx->Flush();
+
+            UINT64 ts = 0;
+            while (S_FALSE == (hr = pCtx->GetData( pTimestamp, &ts, sizeof( UINT64 ), 0 )))
+            {
+            }
+
+            const LONGLONG after = CDXUTClock::Now();
+
+            if (S_OK == hr && (0 == i || after - before < bestAfter - bestBefore))
+            {
+                bestBefore = before;
+                bestAfter = after;
+                bestTs = ts;
+            }
+
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT tsd;
+            while (S_OK == hr && S_FALSE == (hr = pCtx->GetData( pDisjoint, &tsd, sizeof( D3D11_QUERY_DATA_TIMESTAMP_DISJOINT ), 0 )))
+            {
+            }
+
+            if (S_OK == hr && tsd.Disjoint)
+            {
+                // the GPU clock changed, the samples so far can't be trusted
+                m_GpuClock.Clear();
+                bestBefore = bestAfter = 0;
+                break;
+            }
+
+            if (S_OK == hr && 2 == i)
+            {
+                m_GpuClock.AddSample( bestBefore, bestAfter, bestTs, tsd.Frequency );
+            }
+        }
+    }
+
+    SAFE_RELEASE( pTimestamp );
+    SAFE_RELEASE( pDisjoint );
+    SAFE_RELEASE( pCtx );
+}
+
+void TimerEx::UpdateGpuClock()
+{
+    if (!m_Trace.IsOpen() && !m_GpuClockRequested)
+    {
+        return;
+    }
+
+    const LONGLONG interval = static_cast<LONGLONG>(GPU_CLOCK_CALIBRATION_INTERVAL * m_TicksPerSecond);
+    if (!m_GpuClock.IsCalibrated() || CDXUTClock::Now() - m_GpuClock.GetLastSampleTicks() > interval)
+    {
+        CalibrateGpuClock();
+        m_GpuClockRequested = false;
+    }
+}
+
+void TimerEx::AddCaptureEvent( UINT track, LPCWSTR name, LONGLONG begin, LONGLONG end )
+{
+    AMD::TraceEvent ev;
+    AMD::SetTraceEventName( ev, name );
+    ev.uTrack = track;
+    ev.uFrame = m_CaptureFrame;
+    ev.fBeginUs = static_cast<double>(begin - m_CaptureStartTicks) * 1000000.0 / m_TicksPerSecond;
+    ev.fDurationUs = static_cast<double>(end - begin) * 1000000.0 / m_TicksPerSecond;
+
+    m_Trace.Add( ev );
+}
+
+// the frame counters of the frame that just ended, if the application ended one with COUNTER_EndFrame
+void TimerEx::AddCaptureCounters( LONGLONG begin )
+{
+    const AMD::FrameCounterRegistry& counters = AMD::FrameCounterRegistry::Instance();
+    if (counters.GetFrameCount() == m_CaptureCounterFrame)
+    {
+        return;
+    }
+    m_CaptureCounterFrame = counters.GetFrameCount();
+
+    const double beginUs = static_cast<double>(begin - m_CaptureStartTicks) * 1000000.0 / m_TicksPerSecond;
+    for (UINT i = 0; i < counters.GetCount(); ++i)
+    {
+        m_Trace.AddCounter( counters.GetName( i ), m_CaptureFrame, beginUs, static_cast<double>(counters.GetFrameValue( i )) );
+    }
+}
+
+void TimerEx::NameThreadTracks( UINT numThreads )
+{
+    for (; m_CaptureThreadTracks < numThreads; ++m_CaptureThreadTracks)
+    {
+        char name[32];
+        sprintf_s( name, 32, "CPU thread %u", m_CaptureThreadTracks );
+        m_Trace.SetTrackName( CAPTURE_TRACK_THREADS + m_CaptureThreadTracks, name );
+    }
+}
+
+void TimerEx::OnGpuTimestamps( UINT captureId, UINT64 start, UINT64 stop, UINT64 frequency )
+{
+    (void)&frequency;   // the clock mapper keeps the frequency of its samples
+
+    if (!m_Trace.IsOpen() || !m_GpuClock.IsCalibrated() || captureId > m_CaptureGpuScopes.size())
+    {
+        return;
+    }
+
+    // the timestamps may be older or newer than the calibration samples
+    const LONGLONG begin = m_GpuClock.GpuToCpu( start );
+    const LONGLONG end = m_GpuClock.GpuToCpu( stop );
+
+    AMD::TraceEvent& ev = m_CaptureGpuScopes[captureId - 1];
+    ev.fBeginUs = static_cast<double>(begin - m_CaptureStartTicks) * 1000000.0 / m_TicksPerSecond;
+    ev.fDurationUs = static_cast<double>(end - begin) * 1000000.0 / m_TicksPerSecond;
+
+    m_Trace.Add( ev );
+}
+
+void TimerEx::StopCapture()
+{
+    m_Trace.Close();
+    m_CaptureGpuScopes.clear();
+    m_CaptureFrames = 0;
+    m_CaptureFrame = 0;
+}
+
 double TimerEx::GetTime( TimerType type, LPCWSTR timerId, bool stall )
 {
     _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
@@ -863,6 +1408,31 @@ double TimerEx::GetAvgTime( TimerType type, LPCWSTR timerId, bool stall )
     return (NULL != te) ? te->GetAvgTime( type, stall ) : 0.0;
 }
 
+bool TimerEx::GetPercentiles( TimerType type, LPCWSTR timerId, AMD::LatencyPercentiles& percentiles )
+{
+    _ASSERT( "init not called or called with NULL" && (m_pDev != NULL) );
+
+    TimingEvent* te = NULL;
+
+    if (NULL != m_Current)
+    {
+        te = m_Current->GetTimer( timerId );
+    }
+
+    if (NULL == te)
+    {
+        te = GetTimer( timerId );
+    }
+
+    if (NULL == te)
+    {
+        memset( &percentiles, 0, sizeof( percentiles ) );
+        return false;
+    }
+
+    te->GetPercentiles( type, percentiles );
+    return true;
+}
 
 TimingEvent* TimerEx::GetTimer( LPCWSTR timerId )
 {
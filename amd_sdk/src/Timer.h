@@ -69,12 +69,44 @@
 *   (similar to a file system). If a timer with the same name is started in the same context the
 *   existing timer with that name will be restarted. See examples for details.
 *
+* TIMER_BeginStatic( col, name )
+*   Same as TIMER_Begin for a name that never changes, usually a string literal. The call site
+*   keeps its name interned and remembers the timer it found under the current parent, so after
+*   the first frame starting the timer costs a few pointer compares instead of walking the tree
+*   and comparing strings. Use it for timers in inner loops. It opens a block scope.
+*
 * TIMER_End( )
-*   This ends a timer which was previously started with TIMER_Begin.
+*   This ends a timer which was previously started with TIMER_Begin or TIMER_BeginStatic.
+*
+*   TIMER_Begin/TIMER_End may be called from any thread. The thread that called TIMER_Init owns
+*   the timer tree and times CPU and GPU as described here. Other threads (job system workers,
+*   threads recording deferred contexts) only time the CPU: their scopes are written without
+*   locking into a ring buffer per thread and merged into the tree by the next TIMER_Reset,
+*   so their times show up one frame late. Scopes from other threads are placed relative to
+*   the root of the tree, nested only in scopes of the same thread, and scopes with the same
+*   path add up across threads. Query the times (TIMER_GetTime etc.) on the owning thread.
+*
+* TIMER_StartCapture( fileName, numFrames )
+*   Records every scope of the next numFrames frames, starting with the next TIMER_Reset, and
+*   writes them to fileName as a Chrome trace (JSON), which chrome://tracing and the Perfetto UI
+*   open. CPU scopes of the owning thread, GPU scopes and the scopes of other threads are put on
+*   separate tracks of one timeline. The file is written by a background thread while the
+*   capture runs and closed a few frames after the last captured frame, once the GPU results of
+*   that frame are in. GPU scopes are placed where the GPU actually ran them on the CPU timeline,
+*   see TIMER_GetGpuTimeline, so gaps between passes on the GPU track are GPU bubbles. The
+*   values of the frame counters (FrameCounters.h) of every frame that called COUNTER_EndFrame
+*   are written as counter graphs.
+*   Returns false if a capture is already running or the file can't be created.
+*
+* TIMER_IsCapturing( )
+*   True from TIMER_StartCapture until the trace file has been closed.
 *
 * TIMER_ProfileCodeBlock( col, name )
 *   Convenience macro. Add this inside a code block to add profiling to it. See examples for details.
 *
+* TIMER_ProfileCodeBlockStatic( col, name )
+*   TIMER_ProfileCodeBlock for a name that never changes, see TIMER_BeginStatic.
+*
 * TIMER_GetTime( Cpu_Gpu, name )
 *   Retrieve the timing value of a timer in microseconds.
 *   The parameter Cpu_Gpu can either be Cpu or Gpu depending what time you want to retrieve.
@@ -82,6 +114,25 @@
 *   structure. Valid path seperators are \, / or |
 *   See Examples for more details.
 *
+* TIMER_GetPercentiles( Cpu_Gpu, name, percentiles )
+*   Fills an AMD::LatencyPercentiles with the p50, p90, p99 and maximum of the timer's time per
+*   frame over the last frames (see LatencyHistogram.h), in seconds. Unlike TIMER_GetAvgTime this
+*   shows the occasional slow frame. Returns false if there is no timer with that name.
+*
+* TIMER_GetGpuTimeline( name, timeline )
+*   Fills a GpuTimeline with when the CPU started a timer in its last complete frame and when
+*   the GPU started and finished its work, all in CDXUTClock ticks. gpuBegin - submit is how
+*   long the work waited in the queue; idle time between the gpuEnd of a pass and the gpuBegin
+*   of the next is a bubble. The GPU clock is mapped to the CPU clock by calibration samples
+*   (see GpuClockMapper.h) taken about once a second while this is used or a capture runs.
+*   A sample waits for the GPU to go idle, so expect a short hitch each time. Returns false
+*   if there is no such timer, no GPU result yet or no calibration yet.
+*
+* TIMER_ReleaseThread( )
+*   Call on a thread other than the one that called TIMER_Init before it exits, if it used
+*   TIMER_Begin. Ends the scopes it left open and lets the next thread reuse its recording
+*   buffer, which otherwise stays allocated and is drained every frame until TIMER_Destroy.
+*
 * TIMER_WaitForGpuAndGetTime( name )
 *   This macro stalls the CPU until the result of a GPU timer is available.
 *   Since it forces the CPU to idle, this macro should not be used in time critical parts of your app.
@@ -101,12 +152,18 @@
 *     - GetDevice       : get the device passed to TimerEx at Init
 *     - Init            : initialize TimerEx, pass ID3D11Device* if GPU profiling should be used
 *     - Destroy         : uninitialize TimerEx and release resources so the ID3D11Device* can be destroyed
-*     - Reset           : notify all timers that a new frame starts, remove unused timer events
-*     - Start           : start a timer
-*     - Stop            : stop a timer
+*     - Reset           : notify all timers that a new frame starts, remove unused timer events,
+*                         merge the scopes recorded by other threads
+*     - Start           : start a timer, from any thread. Takes a name or a TimerSite
+*     - Stop            : stop a timer, from any thread
+*     - ReleaseThread   : free the recording buffer of a thread that is about to exit
 *     - GetTime         : retrieve the timing result of a timer
+*     - GetPercentiles  : retrieve percentiles of the timing results of a timer over the last frames
 *     - GetTimer        : retrieve a TimerEvent*. This ptr should not be kept past a reset.
 *                         it can be used to manually iterate through the timer tree
+*     - StartCapture    : write the scopes of the next frames to a trace file
+*     - IsCapturing     : check if a trace capture is still running
+*     - GetGpuTimeline  : retrieve when the GPU ran the work of a timer, on the CPU clock
 *
 * TimerEvent
 *   Manages one CpuTimer and one GpuTimer (if ID3D11Device is specified) plus the name of
@@ -114,6 +171,9 @@
 *   Functions:
 *     - GetTime       : retrieve the timing result for either gpu or cpu.
 *                       Specify if the cpu should wait to the latest gpu time to be available
+*     - GetPercentiles: retrieve percentiles of the timing results of the last frames
+*     - GetGpuFrameTime: retrieve the GPU time of a given frame of the GPU query pool, to match
+*                       GPU results, which come back a few frames late, with their own frame
 *     - GetTimer      : retrieve a nested TimerEvent* by name or relative path
 *     - GetParent     : retrieve the parental TimerEvent*
 *     - GetFirstChild : retrieve the first child-TimerEvent*
@@ -125,17 +185,20 @@
 *   The times measured by Timer will add up when starting/stopping the timer multiple times without
 *   resetting the timer.
 *   Create an instance of either of the derived classes for each event you want to profile:
-*     - CpuTimer    : measures the time taken on the CPU to execute from Start to Stop
+*     - CpuTimer    : measures the time taken on the CPU to execute from Start to Stop.
+*                     It reads CDXUTClock (DXUTClock.h), the invariant TSC where available,
+*                     which CDXUTTimer and TimerEx share
 *     - GpuTimer    : measures the time taken on the GPU to execute from Start to Stop
-*                     When using GpuTimer please note that the timing results may only be available
-*                     several frames later, so numTimeStamps should specify enough space for at least
-*                     numTimesTimerStartedPerFrame*maxNumFramesLag timing values. Please also keep in mind
-*                     that Crossfire configurations are likely to increase the number of frames until a result
-*                     is ready.
-*                     If numTimeStamps is chosen too small this will result in the CPU stalling.
+*                     When using GpuTimer please note that the timing results are only available
+*                     two or three frames later. The queries come from a GpuQueryPool (GpuQueryPool.h),
+*                     either one shared by many timers, as TimerEx does, or one of the timer's own
+*                     with room for numTimeStamps scopes per frame. The pool never stalls the CPU:
+*                     a frame the GPU hasn't finished after GPU_QUERY_POOL_FRAMES frames is dropped,
+*                     and so are the scopes that don't fit into a frame.
 *     - GpuCpuTimer : Measure the time the GPU takes to execute the commands beeing issued between Start and Stop
 *                     by measuring the time on the CPU.
-*                     This will stall the CPU twice, once at Start and once at Stop.
+*                     This will stall the CPU twice, once at Start and once at Stop. TIMER_GetGpuTimeline
+*                     places GPU work on the CPU timeline without serializing CPU and GPU.
 *
 *
 * Usage examples:
@@ -350,8 +413,8 @@
 *   Timer* gpuTimer1 = new GpuTimer( pDev );
 *   GpuTimer gpuTimer2( pDev );
 *   GpuTimer gpuTimer3( pDev);
-*   GpuTimer gpuTimer4( pDev, 0, 1 ); // <- we only need space for one event because we'll retrieve this data stalling the CPU
-*                                     // choosing the numTimeStamps too low will result in the CPU stalling
+*   GpuTimer gpuTimer4( pDev, 0, 1 ); // <- we only need space for one event per frame
+*                                     // scopes beyond numTimeStamps in a frame are not timed
 *
 *   gpuTimer1->Start();
 *   gpuTimer3.Start();
@@ -408,10 +471,17 @@
 #ifndef AMD_SDK_TIMER_H
 #define AMD_SDK_TIMER_H
 
+#include "TimerThreadContext.h"
+#include "TimerTrace.h"
+#include "LatencyHistogram.h"
+#include "TimerNameTable.h"
+#include "GpuQueryPool.h"
+#include "GpuClockMapper.h"
+#include "FrameCounters.h"
+
 //namespace AMD
 //{
 
-#define USE_RDTSC 0
 #define WATCH_BAD_TS_VAL 0
 #define CHECK_DISJOINT   0
 
@@ -462,68 +532,120 @@ public:
 
     void Delay(double sec);
 
+    // add a duration measured elsewhere, e.g. on another thread
+    void Add( double sec );
+
 private:
-    LARGE_INTEGER m_startTime;
+    LONGLONG m_startTime;   // CDXUTClock ticks
     double m_freq;
+};
 
-#if USE_RDTSC
-    double m_freqRdtsc;
-#endif
+//-----------------------------------------------------------------------------
+
+// Receives the raw timestamps of the GpuTimer scopes tagged with GpuTimer::SetCapture,
+// once they are available
+class GpuTimerListener
+{
+public:
+    virtual void OnGpuTimestamps( UINT captureId, UINT64 start, UINT64 stop, UINT64 frequency ) = 0;
 };
 
 //-----------------------------------------------------------------------------
 
-class GpuTimer : public Timer
+// The D3D11 queries of a GpuQueryPool
+class GpuQueryBackendD3D11 : public AMD::GpuQueryBackend
 {
+public:
+    GpuQueryBackendD3D11( ID3D11Device* pDev );
+    virtual ~GpuQueryBackendD3D11();
+
+    virtual bool Create( unsigned int uFrames, unsigned int uTimestamps );
+    virtual void Destroy();
+
+    virtual void BeginDisjoint( unsigned int uFrame );
+    virtual void EndDisjoint( unsigned int uFrame );
+    virtual void EndTimestamp( unsigned int uTimestamp );
+
+    virtual bool GetDisjoint( unsigned int uFrame, unsigned long long& uFrequency, bool& bDisjoint );
+    virtual bool GetTimestamp( unsigned int uTimestamp, unsigned long long& uTicks );
+
 private:
-    struct TsRecord
-    {
-        union TsRecordState
-        {
-            struct TsRecordData
-            {
-                unsigned frameID        :30;
-                unsigned startIssued    : 1;
-                unsigned stopIssued     : 1;
-            } data;
-            UINT stateWord;
-        } state;
-        ID3D11Query* pStart;
-        ID3D11Query* pStop;
-        ID3D11Query* pDisjointTS;
-    };
+    ID3D11Device*               m_pDev;
+    ID3D11DeviceContext*        m_pDevCtx;
+    std::vector<ID3D11Query*>   m_Disjoint;
+    std::vector<ID3D11Query*>   m_Timestamps;
+};
+
+//-----------------------------------------------------------------------------
 
+class GpuTimer : public Timer, private AMD::GpuQueryClient
+{
 public:
+    // with a pool of its own, advanced by Reset
     GpuTimer(ID3D11Device* pDev, UINT64 freq = 27000000, UINT numTimeStamps = 8);
+    // with a shared pool, advanced once per frame by its owner before the timers are reset
+    GpuTimer(AMD::GpuQueryPool* pPool);
     virtual ~GpuTimer();
 
     virtual void Reset( bool bResetSum );
     virtual void Start();
     virtual void Stop();
 
+    // stalls the CPU until the GPU has finished all scopes so far, ending the pool's frame
     void WaitIdle();
 
+    // tag the next Start/Stop pair, its timestamps are passed to the listener when collected
+    void SetCapture( GpuTimerListener* listener, UINT captureId );
+
+    // record the time of every completed frame into histogram, NULL to stop
+    void SetHistogram( AMD::LatencyHistogram* histogram ) { m_pHistogram = histogram; }
+
+    // CPU ticks when the first Start of the last completed frame was called, GPU ticks of that
+    // scope's start and of the last scope's stop. False until a frame completed.
+    bool GetTimeline( LONGLONG& submit, UINT64& begin, UINT64& end );
+
+    // time of a frame of the pool (GpuQueryPool::GetFrame when it was open). The last
+    // GPU_QUERY_POOL_FRAMES completed frames are kept, as many as can complete between two
+    // frames. False if the frame isn't complete yet, was dropped or disjoint, or didn't time anything.
+    bool GetFrameTime( UINT frame, double& time );
+
 private:
 
-    ID3D11DeviceContext*    m_pDevCtx;
+    AMD::GpuQueryPool*      m_pPool;
+    AMD::GpuQueryPool*      m_pOwnPool;         // m_pPool if the timer created it
+    GpuQueryBackendD3D11*   m_pOwnBackend;
+    UINT                    m_CurScope;         // scope of the current Start/Stop pair
 
-    UINT                    m_numTimeStamps;
-    TsRecord*               m_ts;
+    AMD::LatencyHistogram*  m_pHistogram;
+    GpuTimerListener*       m_pListener;
+    UINT                    m_NextCaptureId;
 
-    UINT                    m_curIssueTs;
-    UINT                    m_nextRetrTs;
-    UINT                    m_FrameID;
+    UINT                    m_FirstFrame;       // pool frames before this one were discarded by a full reset
+    UINT                    m_CurTimeFrame;     // pool frame m_CurTime is collected for
+    bool                    m_CurTimeValid;     // m_CurTime holds results of m_CurTimeFrame, none disjoint
+    double                  m_CurTime;
 
-    struct CurTimeFrameBits
+    struct Timeline
     {
-        UINT        id      :30;
-        UINT        invalid : 1;
-    } m_CurTimeFrame;
-    double                  m_CurTime;
+        LONGLONG    submit;
+        UINT64      begin;
+        UINT64      end;
+    };
+    Timeline                m_CurTimeline;
+    Timeline                m_LastTimeline;
+    bool                    m_LastTimelineValid;
+
+    struct FrameTime
+    {
+        UINT        frame;
+        double      time;
+    };
+    FrameTime               m_FrameTimes[AMD::GPU_QUERY_POOL_FRAMES];   // last completed frames, by m_NumFrames
 
 
     virtual void FinishCollection();
-    bool CollectData(UINT idx, BOOL stall = FALSE);
+    void FinishFrame();
+    virtual void OnGpuScope( const AMD::GpuScopeResult& result );
 };
 
 //-----------------------------------------------------------------------------
@@ -545,6 +667,27 @@ private:
 };
 
 
+class TimingEvent;
+
+// where the GPU work of a timer ran in its last complete frame, in CDXUTClock ticks
+struct GpuTimeline
+{
+    LONGLONG    submit;     // the CPU started the timer
+    LONGLONG    gpuBegin;   // the GPU started its work
+    LONGLONG    gpuEnd;     // the GPU finished its work
+};
+
+// a call site of TIMER_BeginStatic. Constant initialized, so it is set up before any thread
+// can run it; only the thread that owns TimerEx writes the other members.
+struct TimerSite
+{
+    LPCWSTR         name;
+    UINT            id;         // interned name, 0 until first used
+    TimingEvent*    parent;     // timer found under parent when the site last ran
+    TimingEvent*    event;
+    UINT            generation; // TimerEx tree generation the cached timer belongs to
+};
+
 // TimingEvent:     one timing event managed by TimerEx
 // TimerEx:         extended timer singleton to provide instrumentalization similar to PIX
 // TimerExHelper:   convenience class to provide easy profiling of function calls
@@ -554,6 +697,8 @@ class TimingEvent
 public:
     double          GetTime         ( TimerType type, bool stall = false );
     double          GetAvgTime      ( TimerType type, bool stall = false );
+    void            GetPercentiles  ( TimerType type, AMD::LatencyPercentiles& percentiles );
+    bool            GetGpuFrameTime ( UINT frame, double& time );   // see GpuTimer::GetFrameTime
 
     TimingEvent*    GetTimer        ( LPCWSTR timerId );    // get a child-timer by name
     TimingEvent*    GetParent       ( );                    // walk through timer tree
@@ -585,12 +730,19 @@ private:
     GpuTimer*       m_gpu;
     bool            m_used;
 
+    AMD::LatencyHistogram   m_cpuHistogram; // time per frame over the last frames
+    AMD::LatencyHistogram   m_gpuHistogram;
+
     TimingEvent*    m_parent;
     TimingEvent*    m_firstChild;
     TimingEvent*    m_next;
+
+    UINT            m_nameId;       // interned m_name
+
+    LONGLONG        m_captureBegin; // CPU start of the scope while capturing a trace, else 0
 };
 
-class TimerEx
+class TimerEx : private GpuTimerListener
 {
 public:
     static TimerEx& Instance()
@@ -604,14 +756,26 @@ public:
         return m_pDev;
     }
 
+    // NULL without a device
+    AMD::GpuQueryPool*  GetGpuQueryPool()
+    {
+        return m_GpuQueries.IsCreated() ? &m_GpuQueries : NULL;
+    }
+
     void            Init            ( ID3D11Device* pDev );     // to be called before any timing is done
     void            Destroy         ( );                        // to be called when the ID3D11Device* gets destroyed
     void            Reset           ( bool bResetSum );         // to be called one a frame, preferably on frame switch (flip)
     void            Start           ( LPCWSTR timerId );        // looks for the child in the tree structure, if not found adds another child
+    void            Start           ( TimerSite& site );        // same, but reuses the timer the call site found last time
     void            Stop            ( );
+    void            ReleaseThread   ( );                        // to be called by a thread other than the owner before it exits
     double          GetTime         ( TimerType type, LPCWSTR timerId, bool stall = false );
     double          GetAvgTime      ( TimerType type, LPCWSTR timerId, bool stall = false );
+    bool            GetPercentiles  ( TimerType type, LPCWSTR timerId, AMD::LatencyPercentiles& percentiles );
     TimingEvent*    GetTimer        ( LPCWSTR timerId = NULL ); // returns the first child of root if NULL, else searches childnodes for timer with that name
+    bool            StartCapture    ( LPCWSTR fileName, UINT numFrames ); // write the scopes of the next numFrames frames to a Chrome trace file
+    bool            IsCapturing     ( ) const;
+    bool            GetGpuTimeline  ( LPCWSTR timerId, GpuTimeline& timeline );
 
 private:
     TimerEx             ( );
@@ -620,11 +784,58 @@ private:
     void Reset          ( TimingEvent* te, bool bResetSum );
     void DeleteTimerTree( TimingEvent* te );
 
+    TimingEvent*    GetOrCreateTimer    ( TimingEvent* parent, LPCWSTR timerId );
+    TimingEvent*    FindTimer           ( TimingEvent* parent, UINT nameId );
+    void            StartTimer          ( TimingEvent* te );
+    void            MergeThreadScopes   ( );
+    void            AddThreadScope      ( const wchar_t* const* path, unsigned int depth, double sec );
+
+    struct ThreadScopeMerger;
+
+    // trace capture
+    enum CaptureTrack
+    {
+        CAPTURE_TRACK_FRAMES,
+        CAPTURE_TRACK_CPU,
+        CAPTURE_TRACK_GPU,
+        CAPTURE_TRACK_THREADS,  // one track per thread from here
+    };
+
+    bool            IsCapturingFrame    ( ) const;
+    void            CaptureFrame        ( );
+    void            CalibrateGpuClock   ( );
+    void            UpdateGpuClock      ( );
+    void            AddCaptureEvent     ( UINT track, LPCWSTR name, LONGLONG begin, LONGLONG end );
+    void            AddCaptureCounters  ( LONGLONG begin );
+    void            NameThreadTracks    ( UINT numThreads );
+    void            StopCapture         ( );
+    virtual void    OnGpuTimestamps     ( UINT captureId, UINT64 start, UINT64 stop, UINT64 frequency );
+
 protected:
     ID3D11Device*   m_pDev;
+    GpuQueryBackendD3D11*   m_pGpuQueryBackend;
+    AMD::GpuQueryPool       m_GpuQueries;       // queries of all GPU timers, one frame per Reset
     TimingEvent*    m_Root;     // timer tree
     TimingEvent*    m_Current;  // current position in timer tree
     TimingEvent*    m_Unused;   // unused timers (for faster reuse)
+
+    std::atomic<DWORD>          m_OwnerThreadId;    // thread that called Init, owns the tree; read by all threads
+    AMD::ThreadTimingRegistry   m_ThreadContexts;   // scopes recorded by all other threads
+    double                      m_TicksPerSecond;
+
+    AMD::TimerNameTable         m_Names;            // ids stay valid for the lifetime of the process
+    UINT                        m_TreeGeneration;   // changes whenever timers are removed from the tree
+
+    AMD::TraceWriter                m_Trace;                // open while capturing
+    UINT                            m_CaptureFrames;        // frames to capture
+    UINT                            m_CaptureFrame;         // resets since StartCapture, frames 1 to m_CaptureFrames are captured
+    LONGLONG                        m_CaptureStartTicks;    // start of the trace timeline
+    LONGLONG                        m_CaptureFrameTicks;    // start of the current frame
+    UINT                            m_CaptureThreadTracks;  // tracks named for other threads so far
+    UINT                            m_CaptureCounterFrame;  // frame of the frame counters last written
+    AMD::GpuClockMapper             m_GpuClock;             // GPU timestamps to CDXUTClock ticks
+    bool                            m_GpuClockRequested;    // GetGpuTimeline was called since the last calibration
+    std::vector<AMD::TraceEvent>    m_CaptureGpuScopes;     // name and frame of the tagged GPU scopes, by capture id - 1
 };
 
 #if ENABLE_AMD_TIMER
@@ -649,12 +860,30 @@ protected:
 #define TIMER_GetAvgTime( Cpu_Gpu, name )               \
     TimerEx::Instance( ).GetAvgTime( tt##Cpu_Gpu, name )
 
+#define TIMER_GetPercentiles( Cpu_Gpu, name, percentiles ) \
+    TimerEx::Instance( ).GetPercentiles( tt##Cpu_Gpu, name, percentiles )
+
+#define TIMER_StartCapture( fileName, numFrames )   \
+    TimerEx::Instance( ).StartCapture( fileName, numFrames )
+
+#define TIMER_IsCapturing( )                        \
+    TimerEx::Instance( ).IsCapturing( )
+
+#define TIMER_GetGpuTimeline( name, timeline )      \
+    TimerEx::Instance( ).GetGpuTimeline( name, timeline )
+
+#define TIMER_ReleaseThread( )                      \
+    TimerEx::Instance( ).ReleaseThread( );
+
 // makros, analogue to PIX
 #define TIMER_Begin( col, name )                    \
     TimerEx::Instance( ).Start( name );
 //  DXUT_BeginPerfEvent( col, name );
 //  D3DPERF_BeginEvent( col, name );
 
+#define TIMER_BeginStatic( col, name )              \
+    { static TimerSite __timer_site = { name, 0, NULL, NULL, 0 }; TimerEx::Instance( ).Start( __timer_site ); }
+
 #define TIMER_End( )                                \
     TimerEx::Instance( ).Stop( );
 //      DXUT_EndPerfEvent( );
@@ -666,7 +895,13 @@ protected:
 #define TIMER_GetTime( Cpu_Gpu, name )          0
 #define TIMER_WaitForGpuAndGetTime( name )      0
 #define TIMER_GetAvgTime( Cpu_Gpu, name )       0
+#define TIMER_GetPercentiles( Cpu_Gpu, name, percentiles ) false
+#define TIMER_StartCapture( fileName, numFrames ) false
+#define TIMER_IsCapturing( )                    false
+#define TIMER_GetGpuTimeline( name, timeline )  false
+#define TIMER_ReleaseThread( )
 #define TIMER_Begin( col, name )
+#define TIMER_BeginStatic( col, name )
 #define TIMER_End( )
 #endif
 
@@ -678,6 +913,14 @@ public:
         (void)&col;
         TIMER_Begin( col, name );
     }
+    TimerExHelper( unsigned int col, TimerSite& site )
+    {
+        (void)&col;
+        (void)&site;
+#if ENABLE_AMD_TIMER
+        TimerEx::Instance( ).Start( site );
+#endif
+    }
     virtual ~TimerExHelper( )
     {
         TIMER_End( );
@@ -687,8 +930,13 @@ public:
 #if ENABLE_AMD_TIMER
 #define TIMER_ProfileCodeBlock( col, name )         \
     TimerExHelper __codeblock_timer( col, name );
+
+#define TIMER_ProfileCodeBlockStatic( col, name )   \
+    static TimerSite __codeblock_site = { name, 0, NULL, NULL, 0 }; \
+    TimerExHelper __codeblock_timer( col, __codeblock_site );
 #else
 #define TIMER_ProfileCodeBlock( col, name )
+#define TIMER_ProfileCodeBlockStatic( col, name )
 #endif
 //} // namespace AMD
 
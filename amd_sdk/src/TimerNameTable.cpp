@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerNameTable.cpp
+//
+// Interns timer names
+//--------------------------------------------------------------------------------------
+#include "TimerNameTable.h"
+
+namespace AMD
+{
+    //--------------------------------------------------------------------------------------
+    unsigned int TimerNameTable::Intern( const wchar_t* szName )
+    {
+        std::pair<std::unordered_map<std::wstring, unsigned int>::iterator, bool> Result =
+            m_Ids.insert( std::make_pair( std::wstring( szName ), (unsigned int)m_Names.size() + 1 ) );
+
+        if ( Result.second )
+        {
+            // Keys of an unordered_map don't move when it rehashes
+            m_Names.push_back( &Result.first->first );
+        }
+
+        return Result.first->second;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const wchar_t* TimerNameTable::GetName( unsigned int uId ) const
+    {
+        return ( uId >= 1 && uId <= m_Names.size() ) ? m_Names[uId - 1]->c_str() : NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TimerNameTable::Clear()
+    {
+        m_Ids.clear();
+        m_Names.clear();
+    }
+}
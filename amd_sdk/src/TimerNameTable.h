@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerNameTable.h
+//
+// Interns timer names: every distinct name gets a small integer id once, so TimerEx can
+// compare ids instead of strings when it looks for a timer among its siblings.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_TIMER_NAME_TABLE_H
+#define AMD_SDK_TIMER_NAME_TABLE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace AMD
+{
+    class TimerNameTable
+    {
+    public:
+
+        // Id of the name, starting at 1. The same name always gets the same id.
+        unsigned int Intern( const wchar_t* szName );
+
+        // Name of an id returned by Intern, NULL for any other id
+        const wchar_t* GetName( unsigned int uId ) const;
+
+        unsigned int GetCount() const { return (unsigned int)m_Names.size(); }
+
+        void Clear();
+
+    private:
+
+        std::unordered_map<std::wstring, unsigned int>  m_Ids;
+        std::vector<const std::wstring*>                m_Names;    // Keys of m_Ids, by id - 1
+    };
+}
+
+#endif // AMD_SDK_TIMER_NAME_TABLE_H
@@ -0,0 +1,247 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerThreadContext.cpp
+//
+// Per-thread recording of CPU timing scopes for TimerEx
+//--------------------------------------------------------------------------------------
+#include "TimerThreadContext.h"
+
+#if defined( _MSC_VER )
+#define AMD_THREAD_LOCAL __declspec( thread )
+#else
+#define AMD_THREAD_LOCAL __thread
+#endif
+
+namespace AMD
+{
+    // Every registry gets a new generation, so a thread's cached context is never used
+    // with a registry that was destroyed and recreated at the same address
+    static std::atomic<unsigned int> s_uRegistryGeneration( 0 );
+
+    static AMD_THREAD_LOCAL unsigned int         s_uCachedGeneration = 0;
+    static AMD_THREAD_LOCAL ThreadTimingContext* s_pCachedContext = NULL;
+
+    // Identifies the owner of a context. Unlike std::thread::id it is never given to another
+    // thread, and it can be compared atomically while contexts change hands.
+    static std::atomic<unsigned int> s_uThreadTokens( 0 );
+    static AMD_THREAD_LOCAL unsigned int         s_uThreadToken = 0;
+
+
+    //--------------------------------------------------------------------------------------
+    static unsigned int GetThreadToken()
+    {
+        if ( s_uThreadToken == 0 )
+        {
+            s_uThreadToken = ++s_uThreadTokens;
+        }
+        return s_uThreadToken;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadTimingContext::ThreadTimingContext( unsigned int uThreadIndex, unsigned int uOwner ) :
+        m_uHead( 0 ),
+        m_uTail( 0 ),
+        m_uDroppedScopes( 0 ),
+        m_uDepth( 0 ),
+        m_uDroppedDepth( 0 ),
+        m_uOpenDepth( 0 ),
+        m_uThreadIndex( uThreadIndex ),
+        m_uOwner( uOwner ),
+        m_pNext( NULL )
+    {
+        for ( unsigned int i = 0; i < TIMER_THREAD_MAX_DEPTH; i++ )
+        {
+            m_szOpenNames[i][0] = 0;
+            m_pOpenPath[i] = m_szOpenNames[i];
+            m_iOpenTicks[i] = 0;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool ThreadTimingContext::Push( const wchar_t* szName, long long iTicks, unsigned int uRequiredSlots )
+    {
+        const unsigned int uHead = m_uHead.load( std::memory_order_relaxed );
+        const unsigned int uTail = m_uTail.load( std::memory_order_acquire );
+
+        if ( TIMER_THREAD_EVENT_CAPACITY - ( uHead - uTail ) < uRequiredSlots )
+        {
+            return false;
+        }
+
+        ThreadTimingEvent& Event = m_Events[uHead & ( TIMER_THREAD_EVENT_CAPACITY - 1 )];
+        Event.iTicks = iTicks;
+        Event.bBegin = ( szName != NULL );
+        if ( szName )
+        {
+            CopyTimerName( Event.szName, szName );
+        }
+
+        m_uHead.store( uHead + 1, std::memory_order_release );
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ThreadTimingContext::Begin( const wchar_t* szName, long long iTicks )
+    {
+        // Keep room for this scope's end event and those of all open scopes, so that
+        // End() never fails once Begin() succeeded
+        if ( m_uDroppedDepth == 0 && m_uDepth < TIMER_THREAD_MAX_DEPTH && Push( szName ? szName : L"", iTicks, m_uDepth + 2 ) )
+        {
+            m_uDepth++;
+        }
+        else
+        {
+            m_uDroppedDepth++;
+            m_uDroppedScopes.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ThreadTimingContext::End( long long iTicks )
+    {
+        if ( m_uDroppedDepth > 0 )
+        {
+            m_uDroppedDepth--;
+        }
+        else if ( m_uDepth > 0 )
+        {
+            Push( NULL, iTicks, 1 );
+            m_uDepth--;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ThreadTimingContext::Close( long long iTicks )
+    {
+        // Begin() kept room for the end events of all open scopes
+        for ( ; m_uDepth > 0; m_uDepth-- )
+        {
+            Push( NULL, iTicks, 1 );
+        }
+        m_uDroppedDepth = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadTimingRegistry::ThreadTimingRegistry() :
+        m_pHead( NULL ),
+        m_uThreadCount( 0 ),
+        m_uGeneration( ++s_uRegistryGeneration )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadTimingRegistry::~ThreadTimingRegistry()
+    {
+        Destroy();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    ThreadTimingContext* ThreadTimingRegistry::GetContext()
+    {
+        if ( s_uCachedGeneration == m_uGeneration )
+        {
+            return s_pCachedContext;
+        }
+
+        // The thread may already have a context if it used another registry in between
+        const unsigned int uToken = GetThreadToken();
+        ThreadTimingContext* pContext = GetFirst();
+        while ( pContext && pContext->m_uOwner.load( std::memory_order_relaxed ) != uToken )
+        {
+            pContext = pContext->GetNext();
+        }
+
+        // Take over the context of a thread that exited, acquiring the producer state it left
+        for ( ThreadTimingContext* pFree = GetFirst(); !pContext && pFree; pFree = pFree->GetNext() )
+        {
+            unsigned int uFree = 0;
+            if ( pFree->m_uOwner.compare_exchange_strong( uFree, uToken, std::memory_order_acquire, std::memory_order_relaxed ) )
+            {
+                pContext = pFree;
+            }
+        }
+
+        if ( !pContext )
+        {
+            pContext = new ThreadTimingContext( m_uThreadCount.fetch_add( 1 ), uToken );
+
+            ThreadTimingContext* pHead = m_pHead.load( std::memory_order_relaxed );
+            do
+            {
+                pContext->m_pNext = pHead;
+            } while ( !m_pHead.compare_exchange_weak( pHead, pContext, std::memory_order_release, std::memory_order_relaxed ) );
+        }
+
+        s_uCachedGeneration = m_uGeneration;
+        s_pCachedContext = pContext;
+
+        return pContext;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ThreadTimingRegistry::ReleaseContext( long long iTicks )
+    {
+        const unsigned int uToken = GetThreadToken();
+        for ( ThreadTimingContext* pContext = GetFirst(); pContext; pContext = pContext->GetNext() )
+        {
+            if ( pContext->m_uOwner.load( std::memory_order_relaxed ) == uToken )
+            {
+                pContext->Close( iTicks );
+                pContext->m_uOwner.store( 0, std::memory_order_release );
+                break;
+            }
+        }
+
+        if ( s_uCachedGeneration == m_uGeneration )
+        {
+            s_uCachedGeneration = 0;
+            s_pCachedContext = NULL;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void ThreadTimingRegistry::Destroy()
+    {
+        ThreadTimingContext* pContext = m_pHead.exchange( NULL );
+        while ( pContext )
+        {
+            ThreadTimingContext* pNext = pContext->m_pNext;
+            delete pContext;
+            pContext = pNext;
+        }
+
+        m_uThreadCount = 0;
+        m_uGeneration = ++s_uRegistryGeneration;
+    }
+}
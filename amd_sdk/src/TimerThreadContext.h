@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerThreadContext.h
+//
+// Per-thread recording of CPU timing scopes for TimerEx.
+//
+// TimerEx keeps one cursor into its timer tree, so only the thread that owns it may walk
+// the tree. Every other thread gets a ThreadTimingContext, a single-producer single-consumer
+// ring buffer that the thread writes begin/end events into without taking a lock. Once per
+// frame the owner drains all contexts and receives the completed scopes, each with the
+// path of scope names it was nested in on its thread.
+//
+// A thread that is about to exit releases its context, which closes the scopes it left
+// open and hands the context to the next thread that starts recording. Threads that come
+// and go, like the workers of a shader build, so don't grow the list the owner drains.
+//
+// Timestamps are opaque ticks supplied by the caller.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_TIMER_THREAD_CONTEXT_H
+#define AMD_SDK_TIMER_THREAD_CONTEXT_H
+
+#include <stddef.h>
+#include <atomic>
+
+namespace AMD
+{
+    static const unsigned int TIMER_THREAD_EVENT_CAPACITY = 4096;  // Events per thread between two drains, power of 2
+    static const unsigned int TIMER_THREAD_MAX_DEPTH = 16;         // Deeper scopes are dropped
+    static const unsigned int TIMER_THREAD_NAME_LENGTH = 32;       // Longer names are truncated
+
+    // Copies at most TIMER_THREAD_NAME_LENGTH - 1 characters and terminates the copy
+    inline void CopyTimerName( wchar_t* szDst, const wchar_t* szSrc )
+    {
+        unsigned int i = 0;
+        for ( ; i < TIMER_THREAD_NAME_LENGTH - 1 && szSrc[i]; i++ )
+        {
+            szDst[i] = szSrc[i];
+        }
+        szDst[i] = 0;
+    }
+
+    struct ThreadTimingEvent
+    {
+        long long       iTicks;
+        unsigned int    bBegin;
+        wchar_t         szName[TIMER_THREAD_NAME_LENGTH];           // Begin events only
+    };
+
+    class ThreadTimingContext
+    {
+    public:
+
+        ThreadTimingContext( unsigned int uThreadIndex, unsigned int uOwner );
+
+        // Producer side, only called by the thread the context belongs to. A scope is dropped
+        // as a whole, including everything nested in it, if the ring buffer can't hold it.
+        void Begin( const wchar_t* szName, long long iTicks );
+        void End( long long iTicks );
+
+        // Consumer side, only called by one thread at a time. Calls
+        //   Visitor( const ThreadTimingContext& Context, const wchar_t* const* ppPath, unsigned int uDepth,
+        //            long long iBeginTicks, long long iEndTicks )
+        // for every scope that ended since the last drain. ppPath[0] is the outermost scope and
+        // ppPath[uDepth - 1] the scope itself. Scopes still open are reported by a later drain.
+        template <class Visitor>
+        void Drain( Visitor& Visit );
+
+        // Sequential index of the context in its registry, starting at 0. A thread that reuses
+        // the context of one that exited takes over its index.
+        unsigned int GetThreadIndex() const { return m_uThreadIndex; }
+
+        // Number of scopes dropped so far because the ring buffer was full or nesting too deep
+        unsigned int GetDroppedScopes() const { return m_uDroppedScopes.load( std::memory_order_relaxed ); }
+
+        ThreadTimingContext* GetNext() const { return m_pNext; }
+
+    private:
+
+        friend class ThreadTimingRegistry;
+
+        ThreadTimingContext( const ThreadTimingContext& );
+        ThreadTimingContext& operator=( const ThreadTimingContext& );
+
+        bool Push( const wchar_t* szName, long long iTicks, unsigned int uRequiredSlots );
+        void Close( long long iTicks );
+
+        ThreadTimingEvent               m_Events[TIMER_THREAD_EVENT_CAPACITY];
+        std::atomic<unsigned int>       m_uHead;                        // Written by the producer
+        std::atomic<unsigned int>       m_uTail;                        // Written by the consumer
+        std::atomic<unsigned int>       m_uDroppedScopes;
+
+        // Producer state
+        unsigned int                    m_uDepth;                       // Scopes recorded and still open
+        unsigned int                    m_uDroppedDepth;                // Scopes dropped and still open
+
+        // Consumer state, kept across drains for scopes that span them
+        unsigned int                    m_uOpenDepth;
+        long long                       m_iOpenTicks[TIMER_THREAD_MAX_DEPTH];
+        wchar_t                         m_szOpenNames[TIMER_THREAD_MAX_DEPTH][TIMER_THREAD_NAME_LENGTH];
+        const wchar_t*                  m_pOpenPath[TIMER_THREAD_MAX_DEPTH];
+
+        unsigned int                    m_uThreadIndex;
+        std::atomic<unsigned int>       m_uOwner;                       // Token of the recording thread, 0 if free
+        ThreadTimingContext*            m_pNext;
+    };
+
+    // Lock-free list of the contexts of all threads that recorded scopes
+    class ThreadTimingRegistry
+    {
+    public:
+
+        ThreadTimingRegistry();
+        ~ThreadTimingRegistry();
+
+        // Context of the calling thread, on first use taken over from a thread that released
+        // its context or else created
+        ThreadTimingContext* GetContext();
+
+        // Called by a thread before it exits. Ends the scopes it left open at iTicks and frees
+        // its context for reuse. Contexts of threads that exit without this are kept until Destroy.
+        void ReleaseContext( long long iTicks );
+
+        // Walk all contexts, e.g. to drain them
+        ThreadTimingContext* GetFirst() const { return m_pHead.load( std::memory_order_acquire ); }
+
+        // Deletes all contexts. No thread may be recording scopes while this runs.
+        void Destroy();
+
+    private:
+
+        ThreadTimingRegistry( const ThreadTimingRegistry& );
+        ThreadTimingRegistry& operator=( const ThreadTimingRegistry& );
+
+        std::atomic<ThreadTimingContext*>   m_pHead;
+        std::atomic<unsigned int>           m_uThreadCount;
+        unsigned int                        m_uGeneration;              // Invalidates the per-thread context caches
+    };
+
+
+    //--------------------------------------------------------------------------------------
+    template <class Visitor>
+    void ThreadTimingContext::Drain( Visitor& Visit )
+    {
+        unsigned int uTail = m_uTail.load( std::memory_order_relaxed );
+        const unsigned int uHead = m_uHead.load( std::memory_order_acquire );
+
+        for ( ; uTail != uHead; uTail++ )
+        {
+            const ThreadTimingEvent& Event = m_Events[uTail & ( TIMER_THREAD_EVENT_CAPACITY - 1 )];
+            if ( Event.bBegin )
+            {
+                CopyTimerName( m_szOpenNames[m_uOpenDepth], Event.szName );
+                m_iOpenTicks[m_uOpenDepth] = Event.iTicks;
+                m_uOpenDepth++;
+            }
+            else if ( m_uOpenDepth > 0 )
+            {
+                Visit( *this, m_pOpenPath, m_uOpenDepth, m_iOpenTicks[m_uOpenDepth - 1], Event.iTicks );
+                m_uOpenDepth--;
+            }
+        }
+
+        m_uTail.store( uTail, std::memory_order_release );
+    }
+}
+
+#endif // AMD_SDK_TIMER_THREAD_CONTEXT_H
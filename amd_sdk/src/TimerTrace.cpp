@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerTrace.cpp
+//
+// Streams timing scopes to a Chrome trace file
+//--------------------------------------------------------------------------------------
+#include "TimerTrace.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+
+namespace AMD
+{
+    // The writer thread wakes up at least this often, and whenever this many events are queued
+    static const unsigned int TRACE_WRITE_INTERVAL_MS = 100;
+    static const size_t TRACE_WAKE_EVENTS = 4096;
+
+    // Pseudo tracks that hold the track names and the counter values
+    static const unsigned int TRACE_METADATA_TRACK = 0xFFFFFFFF;
+    static const unsigned int TRACE_COUNTER_TRACK = 0xFFFFFFFE;
+
+
+    //--------------------------------------------------------------------------------------
+    void SetTraceEventName( TraceEvent& Event, const wchar_t* szName )
+    {
+        unsigned int i = 0;
+        for ( ; *szName; szName++ )
+        {
+            const unsigned int c = (unsigned int)*szName;
+            const unsigned int uBytes = ( c < 0x80 ) ? 1 : ( c < 0x800 ) ? 2 : ( c < 0x10000 ) ? 3 : 4;
+            if ( i + uBytes >= TRACE_NAME_LENGTH )
+            {
+                break;
+            }
+
+            // JSON needs quotes and backslashes escaped and control characters removed; replace them
+            if ( c < 0x20 || c == '"' || c == '\\' )
+            {
+                Event.szName[i++] = '_';
+            }
+            else if ( uBytes == 1 )
+            {
+                Event.szName[i++] = (char)c;
+            }
+            else if ( uBytes == 2 )
+            {
+                Event.szName[i++] = (char)( 0xC0 | ( c >> 6 ) );
+                Event.szName[i++] = (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else if ( uBytes == 3 )
+            {
+                Event.szName[i++] = (char)( 0xE0 | ( c >> 12 ) );
+                Event.szName[i++] = (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Event.szName[i++] = (char)( 0x80 | ( c & 0x3F ) );
+            }
+            else
+            {
+                Event.szName[i++] = (char)( 0xF0 | ( c >> 18 ) );
+                Event.szName[i++] = (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+                Event.szName[i++] = (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+                Event.szName[i++] = (char)( 0x80 | ( c & 0x3F ) );
+            }
+        }
+        Event.szName[i] = 0;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    TraceWriter::TraceWriter() :
+        m_pFile( NULL ),
+        m_bFirstEvent( true ),
+        m_bClosing( false ),
+        m_uWrittenEvents( 0 )
+    {
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    TraceWriter::~TraceWriter()
+    {
+        Close();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool TraceWriter::Open( const wchar_t* szFileName )
+    {
+        Close();
+
+#if defined( _WIN32 )
+        if ( _wfopen_s( &m_pFile, szFileName, L"wb" ) != 0 )
+        {
+            m_pFile = NULL;
+        }
+#else
+        char szNarrowName[1024];
+        if ( wcstombs( szNarrowName, szFileName, sizeof( szNarrowName ) ) < sizeof( szNarrowName ) )
+        {
+            m_pFile = fopen( szNarrowName, "wb" );
+        }
+#endif
+        if ( !m_pFile )
+        {
+            return false;
+        }
+
+        fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", m_pFile );
+        m_bFirstEvent = true;
+        m_bClosing = false;
+        m_uWrittenEvents = 0;
+        m_Thread = std::thread( &TraceWriter::WriterThread, this );
+
+        return true;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::Close()
+    {
+        if ( !m_pFile )
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock( m_Mutex );
+            m_bClosing = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+
+        fputs( "\n]}\n", m_pFile );
+        fclose( m_pFile );
+        m_pFile = NULL;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::SetTrackName( unsigned int uTrack, const char* szName )
+    {
+        TraceEvent Event;
+        memset( &Event, 0, sizeof( Event ) );
+        for ( unsigned int i = 0; i < TRACE_NAME_LENGTH - 1 && szName[i]; i++ )
+        {
+            Event.szName[i] = szName[i];
+        }
+        Event.uTrack = TRACE_METADATA_TRACK;
+        Event.uFrame = uTrack;
+
+        Add( Event );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::Add( const TraceEvent& Event )
+    {
+        bool bWake;
+        {
+            std::lock_guard<std::mutex> Lock( m_Mutex );
+            m_Pending.push_back( Event );
+            bWake = ( m_Pending.size() == TRACE_WAKE_EVENTS );
+        }
+
+        if ( bWake )
+        {
+            m_Wake.notify_one();
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::AddCounter( const wchar_t* szName, unsigned int uFrame, double fTimeUs, double fValue )
+    {
+        TraceEvent Event;
+        SetTraceEventName( Event, szName );
+        Event.uTrack = TRACE_COUNTER_TRACK;
+        Event.uFrame = uFrame;
+        Event.fBeginUs = fTimeUs;
+        Event.fDurationUs = fValue;
+
+        Add( Event );
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::WriterThread()
+    {
+        bool bClosing = false;
+        while ( !bClosing )
+        {
+            {
+                std::unique_lock<std::mutex> Lock( m_Mutex );
+                m_Wake.wait_for( Lock, std::chrono::milliseconds( TRACE_WRITE_INTERVAL_MS ),
+                    [this]() { return m_bClosing || m_Pending.size() >= TRACE_WAKE_EVENTS; } );
+
+                // Take the queued events and leave the producers an empty list with capacity
+                m_Writing.swap( m_Pending );
+                bClosing = m_bClosing;
+            }
+
+            for ( size_t i = 0; i < m_Writing.size(); i++ )
+            {
+                Write( m_Writing[i] );
+            }
+            m_uWrittenEvents.fetch_add( (unsigned int)m_Writing.size(), std::memory_order_relaxed );
+            m_Writing.clear();
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    void TraceWriter::Write( const TraceEvent& Event )
+    {
+        fputs( m_bFirstEvent ? "" : ",\n", m_pFile );
+        m_bFirstEvent = false;
+
+        if ( Event.uTrack == TRACE_METADATA_TRACK )
+        {
+            fprintf( m_pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n"
+                "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}",
+                Event.uFrame, Event.szName, Event.uFrame, Event.uFrame );
+        }
+        else if ( Event.uTrack == TRACE_COUNTER_TRACK )
+        {
+            fprintf( m_pFile, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+                Event.szName, Event.fBeginUs, Event.fDurationUs );
+        }
+        else
+        {
+            fprintf( m_pFile, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                Event.szName, Event.uTrack, Event.fBeginUs, Event.fDurationUs, Event.uFrame );
+        }
+    }
+}
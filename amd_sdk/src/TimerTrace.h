@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerTrace.h
+//
+// Streams timing scopes to a Chrome trace file (JSON trace event format), which can be
+// opened in chrome://tracing or the Perfetto UI.
+//
+// TimerEx uses this for TIMER_StartCapture. Add() only copies the event into a list under
+// a short lock; a background thread formats the events and writes them to disk, so a
+// long capture costs the rendering thread little more than the copy.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDK_TIMER_TRACE_H
+#define AMD_SDK_TIMER_TRACE_H
+
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace AMD
+{
+    static const unsigned int TRACE_NAME_LENGTH = 48;              // Longer names are truncated
+
+    // One scope on one track. Tracks show up as threads in the trace viewer. Counter
+    // values (see AddCounter) use the same event, with the value in fDurationUs.
+    struct TraceEvent
+    {
+        char            szName[TRACE_NAME_LENGTH];                  // UTF-8
+        unsigned int    uTrack;
+        unsigned int    uFrame;
+        double          fBeginUs;                                   // Microseconds since the capture started
+        double          fDurationUs;
+    };
+
+    // Fills the name of a trace event from a wide string, encoded as UTF-8
+    void SetTraceEventName( TraceEvent& Event, const wchar_t* szName );
+
+    class TraceWriter
+    {
+    public:
+
+        TraceWriter();
+        ~TraceWriter();
+
+        // Creates the file and starts the writer thread. Returns false if the file can't be created.
+        bool Open( const wchar_t* szFileName );
+
+        // Waits until all events are written and closes the file
+        void Close();
+
+        bool IsOpen() const { return m_pFile != NULL; }
+
+        // Name shown for a track, call before adding its events
+        void SetTrackName( unsigned int uTrack, const char* szName );
+
+        // Queues an event for the writer thread. Thread safe.
+        void Add( const TraceEvent& Event );
+
+        // Queues the value of a counter from fTimeUs on, shown as a graph above the tracks. Thread safe.
+        void AddCounter( const wchar_t* szName, unsigned int uFrame, double fTimeUs, double fValue );
+
+        // Events written to disk so far
+        unsigned int GetWrittenEvents() const { return m_uWrittenEvents.load( std::memory_order_relaxed ); }
+
+    private:
+
+        TraceWriter( const TraceWriter& );
+        TraceWriter& operator=( const TraceWriter& );
+
+        void WriterThread();
+        void Write( const TraceEvent& Event );
+
+        FILE*                           m_pFile;
+        bool                            m_bFirstEvent;              // Writer thread only
+
+        std::thread                     m_Thread;
+        std::mutex                      m_Mutex;
+        std::condition_variable         m_Wake;
+        std::vector<TraceEvent>         m_Pending;                  // Guarded by m_Mutex
+        std::vector<TraceEvent>         m_Writing;                  // Writer thread only
+        bool                            m_bClosing;                 // Guarded by m_Mutex
+
+        std::atomic<unsigned int>       m_uWrittenEvents;
+    };
+}
+
+#endif // AMD_SDK_TIMER_TRACE_H
@@ -0,0 +1,69 @@
+dofile ("../../../../premake/amd_premake_util.lua")
+
+-- The tool also builds without DirectX (e.g. "premake5 gmake" on Linux), in which
+-- case the sdkmesh files are read with the portable reader in SDKMeshFormat.h.
+
+workspace "SDKMeshTool"
+   configurations { "Debug", "Release" }
+   platforms { "x64" }
+   location "../build"
+   filename ("SDKMeshTool" .. _AMD_VS_SUFFIX)
+   startproject "SDKMeshTool"
+
+   filter "platforms:x64"
+      architecture "x64"
+
+   filter { "platforms:x64", "action:vs*" }
+      system "Windows"
+
+if _ACTION:find("vs") then
+externalproject "DXUT"
+   kind "StaticLib"
+   language "C++"
+   location "../../../../DXUT/Core"
+   filename ("DXUT" .. _AMD_VS_SUFFIX)
+   uuid "85344B7F-5AA0-4E12-A065-D1333D11F6CA"
+
+externalproject "DXUTOpt"
+   kind "StaticLib"
+   language "C++"
+   location "../../../../DXUT/Optional"
+   filename ("DXUTOpt" .. _AMD_VS_SUFFIX)
+   uuid "61B333C2-C4F7-4CC1-A9BF-83F6D95588EB"
+end
+
+project "SDKMeshTool"
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename ("SDKMeshTool" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   files { "../src/**.h", "../src/**.cpp", "../../../src/MeshOptimizer.h", "../../../src/MeshOptimizer.cpp", "../../../src/MeshSimplifier.h", "../../../src/MeshSimplifier.cpp",
+           "../../../src/Meshlet.h", "../../../src/Meshlet.cpp", "../../../src/PointLights.h", "../../../src/PointLights.cpp",
+           "../../../src/CameraPath.h", "../../../src/CameraPath.cpp", "../../../src/BenchmarkReport.h", "../../../src/BenchmarkReport.cpp" }
+   includedirs { "../../../src" }
+
+   filter "action:vs*"
+      -- Specify WindowsTargetPlatformVersion here for VS2015
+      windowstarget (_AMD_WIN_SDK_VERSION)
+      defines { "WIN32", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS", "_WIN32_WINNT=0x0601" }
+      links { "DXUT", "DXUTOpt", "d3d11", "d3dcompiler", "dxguid", "winmm", "comctl32", "Usp10", "Shlwapi" }
+
+   filter "action:not vs*"
+      buildoptions { "-std=c++11", "-pthread" }
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "_DEBUG", "DEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "NDEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
@@ -0,0 +1,456 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: SDKMeshFile.cpp
+//
+// Loads an sdkmesh file into memory for editing in place, and writes it back out.
+//--------------------------------------------------------------------------------------
+#include "SDKMeshFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace AMD
+{
+
+#ifdef _WIN32
+
+//--------------------------------------------------------------------------------------
+// Gives access to the parsed headers of CDXUTSDKMesh. The mesh is created with bCopyStatic
+// set, so the pointer fixups are applied to a private copy and the loaded file stays a
+// valid sdkmesh, while the vertex and index pointers still refer to the file data.
+//--------------------------------------------------------------------------------------
+class SDKMeshLoader : public CDXUTSDKMesh
+{
+public:
+
+    HRESULT Load( BYTE* pData, size_t DataBytes )
+    {
+        return CreateFromMemory( nullptr, pData, DataBytes, true );
+    }
+
+    const SDKMESH_HEADER*               GetHeader() const           { return m_pMeshHeader; }
+    const SDKMESH_VERTEX_BUFFER_HEADER* GetVertexBufferArray() const { return m_pVertexBufferArray; }
+    const SDKMESH_INDEX_BUFFER_HEADER*  GetIndexBufferArray() const  { return m_pIndexBufferArray; }
+    const SDKMESH_MESH*                 GetMeshArray() const         { return m_pMeshArray; }
+    const SDKMESH_SUBSET*               GetSubsetArray() const       { return m_pSubsetArray; }
+};
+
+#endif
+
+
+//--------------------------------------------------------------------------------------
+SDKMeshFile::SDKMeshFile() :
+m_pMeshHeader( nullptr ),
+m_pVertexBufferArray( nullptr ),
+m_pIndexBufferArray( nullptr ),
+m_pMeshArray( nullptr ),
+m_pSubsetArray( nullptr )
+#ifdef _WIN32
+, m_pLoader( nullptr )
+#endif
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+SDKMeshFile::~SDKMeshFile()
+{
+    Destroy();
+}
+
+
+//--------------------------------------------------------------------------------------
+void SDKMeshFile::Destroy()
+{
+#ifdef _WIN32
+    if ( m_pLoader )
+    {
+        m_pLoader->Destroy();
+        delete m_pLoader;
+        m_pLoader = nullptr;
+    }
+#endif
+
+    m_Data.clear();
+    m_Vertices.clear();
+    m_Indices.clear();
+    m_Extension.clear();
+#ifndef _WIN32
+    m_SubsetLODs.clear();
+    m_SubsetLODFirst.clear();
+    m_SubsetLODCount.clear();
+#endif
+    m_pMeshHeader = nullptr;
+    m_pVertexBufferArray = nullptr;
+    m_pIndexBufferArray = nullptr;
+    m_pMeshArray = nullptr;
+    m_pSubsetArray = nullptr;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool SDKMeshFile::Load( const char* szFileName )
+{
+    Destroy();
+
+    FILE* pFile = fopen( szFileName, "rb" );
+    if ( !pFile )
+    {
+        fprintf( stderr, "Unable to open %s\n", szFileName );
+        return false;
+    }
+
+    fseek( pFile, 0, SEEK_END );
+    const long lSize = ftell( pFile );
+    fseek( pFile, 0, SEEK_SET );
+
+    if ( lSize > 0 )
+    {
+        m_Data.resize( (size_t)lSize );
+        if ( fread( &m_Data[0], 1, m_Data.size(), pFile ) != m_Data.size() )
+        {
+            m_Data.clear();
+        }
+    }
+    fclose( pFile );
+
+    if ( m_Data.empty() || !Parse() )
+    {
+        fprintf( stderr, "%s is not a valid sdkmesh file\n", szFileName );
+        Destroy();
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool SDKMeshFile::Save( const char* szFileName ) const
+{
+    FILE* pFile = fopen( szFileName, "wb" );
+    if ( !pFile )
+    {
+        fprintf( stderr, "Unable to create %s\n", szFileName );
+        return false;
+    }
+
+    // Any LOD chain loaded with the file is dropped, as it may no longer match the buffers
+    const size_t uCoreSize = (size_t)( m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize + m_pMeshHeader->BufferDataSize );
+    bool bResult = fwrite( &m_Data[0], 1, uCoreSize, pFile ) == uCoreSize;
+
+    if ( bResult && !m_Extension.empty() )
+    {
+        const BYTE Padding[8] = {};
+        const size_t uPadding = (size_t)GetExtensionOffset() - uCoreSize;
+
+        bResult = fwrite( Padding, 1, uPadding, pFile ) == uPadding &&
+                  fwrite( &m_Extension[0], 1, m_Extension.size(), pFile ) == m_Extension.size();
+    }
+    fclose( pFile );
+
+    if ( !bResult )
+    {
+        fprintf( stderr, "Error writing %s\n", szFileName );
+    }
+
+    return bResult;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool SDKMeshFile::Parse()
+{
+    if ( m_Data.size() < sizeof( SDKMESH_HEADER ) )
+    {
+        return false;
+    }
+
+    const SDKMESH_HEADER* pHeader = (const SDKMESH_HEADER*)&m_Data[0];
+    if ( pHeader->Version != SDKMESH_FILE_VERSION ||
+         pHeader->HeaderSize + pHeader->NonBufferDataSize + pHeader->BufferDataSize > m_Data.size() )
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+
+    m_pLoader = new SDKMeshLoader();
+    if ( FAILED( m_pLoader->Load( &m_Data[0], m_Data.size() ) ) )
+    {
+        return false;
+    }
+
+    m_pMeshHeader = m_pLoader->GetHeader();
+    m_pVertexBufferArray = m_pLoader->GetVertexBufferArray();
+    m_pIndexBufferArray = m_pLoader->GetIndexBufferArray();
+    m_pMeshArray = m_pLoader->GetMeshArray();
+    m_pSubsetArray = m_pLoader->GetSubsetArray();
+
+    for ( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+    {
+        m_Vertices.push_back( m_pLoader->GetRawVerticesAt( i ) );
+    }
+    for ( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+    {
+        m_Indices.push_back( m_pLoader->GetRawIndicesAt( i ) );
+    }
+
+    return true;
+
+#else
+
+    const size_t uStaticSize = (size_t)( pHeader->HeaderSize + pHeader->NonBufferDataSize );
+
+    if ( pHeader->VertexStreamHeadersOffset + pHeader->NumVertexBuffers * sizeof( SDKMESH_VERTEX_BUFFER_HEADER ) > uStaticSize ||
+         pHeader->IndexStreamHeadersOffset + pHeader->NumIndexBuffers * sizeof( SDKMESH_INDEX_BUFFER_HEADER ) > uStaticSize ||
+         pHeader->MeshDataOffset + pHeader->NumMeshes * sizeof( SDKMESH_MESH ) > uStaticSize ||
+         pHeader->SubsetDataOffset + pHeader->NumTotalSubsets * sizeof( SDKMESH_SUBSET ) > uStaticSize )
+    {
+        return false;
+    }
+
+    m_pMeshHeader = pHeader;
+    m_pVertexBufferArray = (const SDKMESH_VERTEX_BUFFER_HEADER*)&m_Data[ (size_t)pHeader->VertexStreamHeadersOffset ];
+    m_pIndexBufferArray = (const SDKMESH_INDEX_BUFFER_HEADER*)&m_Data[ (size_t)pHeader->IndexStreamHeadersOffset ];
+    m_pMeshArray = (const SDKMESH_MESH*)&m_Data[ (size_t)pHeader->MeshDataOffset ];
+    m_pSubsetArray = (const SDKMESH_SUBSET*)&m_Data[ (size_t)pHeader->SubsetDataOffset ];
+
+    for ( UINT i = 0; i < pHeader->NumVertexBuffers; i++ )
+    {
+        const SDKMESH_VERTEX_BUFFER_HEADER& VB = m_pVertexBufferArray[i];
+        if ( VB.DataOffset + VB.SizeBytes > m_Data.size() )
+        {
+            return false;
+        }
+        m_Vertices.push_back( &m_Data[ (size_t)VB.DataOffset ] );
+    }
+
+    for ( UINT i = 0; i < pHeader->NumIndexBuffers; i++ )
+    {
+        const SDKMESH_INDEX_BUFFER_HEADER& IB = m_pIndexBufferArray[i];
+        if ( IB.DataOffset + IB.SizeBytes > m_Data.size() )
+        {
+            return false;
+        }
+        m_Indices.push_back( &m_Data[ (size_t)IB.DataOffset ] );
+    }
+
+    for ( UINT i = 0; i < pHeader->NumMeshes; i++ )
+    {
+        const SDKMESH_MESH& Mesh = m_pMeshArray[i];
+        if ( Mesh.SubsetOffset + Mesh.NumSubsets * sizeof( UINT ) > uStaticSize )
+        {
+            return false;
+        }
+    }
+
+    return ParseLODs();
+
+#endif
+}
+
+
+#ifndef _WIN32
+
+//--------------------------------------------------------------------------------------
+// Reads the optional LOD chain, as CDXUTSDKMesh::LoadLODs does
+//--------------------------------------------------------------------------------------
+bool SDKMeshFile::ParseLODs()
+{
+    const UINT64 uLODOffset = GetExtensionOffset();
+    if ( uLODOffset + sizeof( SDKMESH_LOD_HEADER ) > m_Data.size() )
+    {
+        return true;
+    }
+
+    const SDKMESH_LOD_HEADER* pLODHeader = (const SDKMESH_LOD_HEADER*)&m_Data[ (size_t)uLODOffset ];
+    if ( pLODHeader->Magic != SDKMESH_LOD_MAGIC )
+    {
+        return true;
+    }
+
+    if ( pLODHeader->Version != SDKMESH_LOD_VERSION ||
+         pLODHeader->NumIndexBuffers != m_pMeshHeader->NumIndexBuffers ||
+         pLODHeader->SubsetLODOffset + pLODHeader->NumSubsetLODs * sizeof( SDKMESH_SUBSET_LOD ) > m_Data.size() ||
+         pLODHeader->IndexStreamHeadersOffset + pLODHeader->NumIndexBuffers * sizeof( SDKMESH_INDEX_BUFFER_HEADER ) > m_Data.size() )
+    {
+        return false;
+    }
+
+    const SDKMESH_SUBSET_LOD* pSubsetLODs = (const SDKMESH_SUBSET_LOD*)&m_Data[ (size_t)pLODHeader->SubsetLODOffset ];
+    m_SubsetLODs.assign( pSubsetLODs, pSubsetLODs + pLODHeader->NumSubsetLODs );
+    m_SubsetLODFirst.assign( m_pMeshHeader->NumTotalSubsets, 0 );
+    m_SubsetLODCount.assign( m_pMeshHeader->NumTotalSubsets, 0 );
+
+    for ( UINT i = 0; i < pLODHeader->NumSubsetLODs; i++ )
+    {
+        const SDKMESH_SUBSET_LOD& LOD = m_SubsetLODs[i];
+        if ( LOD.Mesh >= m_pMeshHeader->NumMeshes || LOD.Subset >= m_pMeshArray[ LOD.Mesh ].NumSubsets )
+        {
+            return false;
+        }
+
+        const UINT* pSubsets = (const UINT*)&m_Data[ (size_t)m_pMeshArray[ LOD.Mesh ].SubsetOffset ];
+        const UINT iSubset = pSubsets[ LOD.Subset ];
+        if ( iSubset >= m_pMeshHeader->NumTotalSubsets )
+        {
+            return false;
+        }
+
+        if ( m_SubsetLODCount[iSubset] == 0 )
+        {
+            m_SubsetLODFirst[iSubset] = i;
+        }
+        if ( LOD.Level != m_SubsetLODCount[iSubset] + 1 || m_SubsetLODFirst[iSubset] + m_SubsetLODCount[iSubset] != i ||
+             LOD.Level > MAX_SUBSET_LODS )
+        {
+            return false;
+        }
+
+        m_SubsetLODCount[iSubset]++;
+    }
+
+    return true;
+}
+
+#endif
+
+
+//--------------------------------------------------------------------------------------
+UINT SDKMeshFile::GetNumMeshes() const
+{
+    return m_pMeshHeader ? m_pMeshHeader->NumMeshes : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT SDKMeshFile::GetNumVBs() const
+{
+    return m_pMeshHeader ? m_pMeshHeader->NumVertexBuffers : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT SDKMeshFile::GetNumIBs() const
+{
+    return m_pMeshHeader ? m_pMeshHeader->NumIndexBuffers : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_MESH* SDKMeshFile::GetMesh( UINT iMesh ) const
+{
+    return &m_pMeshArray[ iMesh ];
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET* SDKMeshFile::GetSubset( UINT iMesh, UINT iSubset ) const
+{
+#ifdef _WIN32
+    return m_pLoader->GetSubset( iMesh, iSubset );
+#else
+    const UINT* pSubsets = (const UINT*)&m_Data[ (size_t)m_pMeshArray[ iMesh ].SubsetOffset ];
+    return &m_pSubsetArray[ pSubsets[ iSubset ] ];
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_VERTEX_BUFFER_HEADER* SDKMeshFile::GetVBHeader( UINT iVB ) const
+{
+    return &m_pVertexBufferArray[ iVB ];
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_INDEX_BUFFER_HEADER* SDKMeshFile::GetIBHeader( UINT iIB ) const
+{
+    return &m_pIndexBufferArray[ iIB ];
+}
+
+
+//--------------------------------------------------------------------------------------
+BYTE* SDKMeshFile::GetRawVerticesAt( UINT iVB ) const
+{
+    return m_Vertices[ iVB ];
+}
+
+
+//--------------------------------------------------------------------------------------
+BYTE* SDKMeshFile::GetRawIndicesAt( UINT iIB ) const
+{
+    return m_Indices[ iIB ];
+}
+
+//--------------------------------------------------------------------------------------
+UINT SDKMeshFile::GetNumSubsetLODs( UINT iMesh, UINT iSubset ) const
+{
+#ifdef _WIN32
+    return m_pLoader->GetNumSubsetLODs( iMesh, iSubset );
+#else
+    if ( m_SubsetLODCount.empty() )
+    {
+        return 0;
+    }
+
+    const UINT* pSubsets = (const UINT*)&m_Data[ (size_t)m_pMeshArray[ iMesh ].SubsetOffset ];
+    return m_SubsetLODCount[ pSubsets[ iSubset ] ];
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET_LOD* SDKMeshFile::GetSubsetLOD( UINT iMesh, UINT iSubset, UINT iLevel ) const
+{
+#ifdef _WIN32
+    return m_pLoader->GetSubsetLOD( iMesh, iSubset, iLevel );
+#else
+    if ( iLevel == 0 || iLevel > GetNumSubsetLODs( iMesh, iSubset ) )
+    {
+        return nullptr;
+    }
+
+    const UINT* pSubsets = (const UINT*)&m_Data[ (size_t)m_pMeshArray[ iMesh ].SubsetOffset ];
+    return &m_SubsetLODs[ m_SubsetLODFirst[ pSubsets[ iSubset ] ] + iLevel - 1 ];
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT64 SDKMeshFile::GetExtensionOffset() const
+{
+    const UINT64 uCoreSize = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize + m_pMeshHeader->BufferDataSize;
+    return ( uCoreSize + 7 ) & ~(UINT64)7;
+}
+
+
+//--------------------------------------------------------------------------------------
+void SDKMeshFile::SetExtensionData( const std::vector<BYTE>& Data )
+{
+    m_Extension = Data;
+}
+
+} // namespace AMD
@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: SDKMeshFile.h
+//
+// Loads an sdkmesh file into memory for editing in place, and writes it back out.
+// On Windows the file is parsed by CDXUTSDKMesh::CreateFromMemory (without a device),
+// elsewhere by a minimal reader using the same structure layouts.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDKMESH_FILE_H
+#define AMD_SDKMESH_FILE_H
+
+#ifdef _WIN32
+#include "..\\..\\..\\..\\DXUT\\Core\\DXUT.h"
+#include "..\\..\\..\\..\\DXUT\\Optional\\SDKmesh.h"
+#else
+#include "SDKMeshFormat.h"
+#endif
+
+#include <vector>
+
+namespace AMD
+{
+    class SDKMeshFile
+    {
+    public:
+
+        SDKMeshFile();
+        ~SDKMeshFile();
+
+        bool Load( const char* szFileName );
+        bool Save( const char* szFileName ) const;
+        void Destroy();
+
+        UINT GetNumMeshes() const;
+        UINT GetNumVBs() const;
+        UINT GetNumIBs() const;
+
+        const SDKMESH_MESH*                 GetMesh( UINT iMesh ) const;
+        const SDKMESH_SUBSET*               GetSubset( UINT iMesh, UINT iSubset ) const;
+        const SDKMESH_VERTEX_BUFFER_HEADER* GetVBHeader( UINT iVB ) const;
+        const SDKMESH_INDEX_BUFFER_HEADER*  GetIBHeader( UINT iIB ) const;
+
+        // Buffer data points into the loaded file, so edits are picked up by Save
+        BYTE* GetRawVerticesAt( UINT iVB ) const;
+        BYTE* GetRawIndicesAt( UINT iIB ) const;
+
+        // LOD chain loaded with the file (see SDKMESH_LOD_HEADER), iLevel starts at 1
+        UINT                                GetNumSubsetLODs( UINT iMesh, UINT iSubset ) const;
+        const SDKMESH_SUBSET_LOD*           GetSubsetLOD( UINT iMesh, UINT iSubset, UINT iLevel ) const;
+
+        // Data to store after the buffer data, replacing any LOD chain loaded with the file.
+        // Offsets in it are from the start of the file, GetExtensionOffset gives its position.
+        UINT64 GetExtensionOffset() const;
+        void   SetExtensionData( const std::vector<BYTE>& Data );
+
+    private:
+
+        bool Parse();
+#ifndef _WIN32
+        bool ParseLODs();
+#endif
+
+        std::vector<BYTE>                   m_Data;
+
+        const SDKMESH_HEADER*               m_pMeshHeader;
+        const SDKMESH_VERTEX_BUFFER_HEADER* m_pVertexBufferArray;
+        const SDKMESH_INDEX_BUFFER_HEADER*  m_pIndexBufferArray;
+        const SDKMESH_MESH*                 m_pMeshArray;
+        const SDKMESH_SUBSET*               m_pSubsetArray;
+        std::vector<BYTE*>                  m_Vertices;
+        std::vector<BYTE*>                  m_Indices;
+        std::vector<BYTE>                   m_Extension;
+
+#ifndef _WIN32
+        std::vector<SDKMESH_SUBSET_LOD>     m_SubsetLODs;
+        std::vector<UINT>                   m_SubsetLODFirst;
+        std::vector<UINT>                   m_SubsetLODCount;
+#endif
+
+#ifdef _WIN32
+        class SDKMeshLoader*                       m_pLoader;
+#endif
+    };
+
+} // namespace AMD
+
+#endif // AMD_SDKMESH_FILE_H
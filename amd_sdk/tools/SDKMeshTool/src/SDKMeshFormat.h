@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: SDKMeshFormat.h
+//
+// Stand-alone copy of the sdkmesh file structures from DXUT's SDKmesh.h, for building
+// the mesh tools on platforms without the DirectX headers. The layouts must match
+// SDKmesh.h exactly; the size checks below are the same ones used there.
+//--------------------------------------------------------------------------------------
+#ifndef AMD_SDKMESH_FORMAT_H
+#define AMD_SDKMESH_FORMAT_H
+
+#ifdef _WIN32
+#error "Use DXUT's SDKmesh.h on Windows"
+#endif
+
+#include <stdint.h>
+
+typedef uint8_t     BYTE;
+typedef uint16_t    WORD;
+typedef uint32_t    UINT;
+typedef uint64_t    UINT64;
+
+#define SDKMESH_FILE_VERSION 101
+#define MAX_VERTEX_ELEMENTS 32
+#define MAX_VERTEX_STREAMS 16
+#define MAX_FRAME_NAME 100
+#define MAX_MESH_NAME 100
+#define MAX_SUBSET_NAME 100
+#define MAX_MATERIAL_NAME 100
+#define MAX_TEXTURE_NAME 260
+#define MAX_MATERIAL_PATH 260
+#define INVALID_FRAME ((UINT)-1)
+#define INVALID_MESH ((UINT)-1)
+#define INVALID_MATERIAL ((UINT)-1)
+#define INVALID_SUBSET ((UINT)-1)
+#define SDKMESH_LOD_MAGIC 0x444F4C53 // 'SLOD'
+#define SDKMESH_LOD_VERSION 1
+#define MAX_SUBSET_LODS 8
+
+enum SDKMESH_PRIMITIVE_TYPE
+{
+    PT_TRIANGLE_LIST = 0,
+    PT_TRIANGLE_STRIP,
+    PT_LINE_LIST,
+    PT_LINE_STRIP,
+    PT_POINT_LIST,
+    PT_TRIANGLE_LIST_ADJ,
+    PT_TRIANGLE_STRIP_ADJ,
+    PT_LINE_LIST_ADJ,
+    PT_LINE_STRIP_ADJ,
+    PT_QUAD_PATCH_LIST,
+    PT_TRIANGLE_PATCH_LIST,
+};
+
+enum SDKMESH_INDEX_TYPE
+{
+    IT_16BIT = 0,
+    IT_32BIT,
+};
+
+// The subset of d3d9types.h used by the vertex declarations
+struct D3DVERTEXELEMENT9
+{
+    WORD Stream;
+    WORD Offset;
+    BYTE Type;
+    BYTE Method;
+    BYTE Usage;
+    BYTE UsageIndex;
+};
+
+#define D3DDECLTYPE_FLOAT3      2
+#define D3DDECLTYPE_FLOAT4      3
+#define D3DDECLTYPE_UNUSED      17
+#define D3DDECLUSAGE_POSITION   0
+
+#pragma pack(push,8)
+
+struct SDKMESH_HEADER
+{
+    //Basic Info and sizes
+    UINT Version;
+    BYTE IsBigEndian;
+    UINT64 HeaderSize;
+    UINT64 NonBufferDataSize;
+    UINT64 BufferDataSize;
+
+    //Stats
+    UINT NumVertexBuffers;
+    UINT NumIndexBuffers;
+    UINT NumMeshes;
+    UINT NumTotalSubsets;
+    UINT NumFrames;
+    UINT NumMaterials;
+
+    //Offsets to Data
+    UINT64 VertexStreamHeadersOffset;
+    UINT64 IndexStreamHeadersOffset;
+    UINT64 MeshDataOffset;
+    UINT64 SubsetDataOffset;
+    UINT64 FrameDataOffset;
+    UINT64 MaterialDataOffset;
+};
+
+struct SDKMESH_VERTEX_BUFFER_HEADER
+{
+    UINT64 NumVertices;
+    UINT64 SizeBytes;
+    UINT64 StrideBytes;
+    D3DVERTEXELEMENT9 Decl[MAX_VERTEX_ELEMENTS];
+    UINT64 DataOffset;
+};
+
+struct SDKMESH_INDEX_BUFFER_HEADER
+{
+    UINT64 NumIndices;
+    UINT64 SizeBytes;
+    UINT IndexType;
+    UINT64 DataOffset;
+};
+
+struct SDKMESH_MESH
+{
+    char Name[MAX_MESH_NAME];
+    BYTE NumVertexBuffers;
+    UINT VertexBuffers[MAX_VERTEX_STREAMS];
+    UINT IndexBuffer;
+    UINT NumSubsets;
+    UINT NumFrameInfluences; //aka bones
+
+    float BoundingBoxCenter[3];
+    float BoundingBoxExtents[3];
+
+    UINT64 SubsetOffset;
+    UINT64 FrameInfluenceOffset;
+};
+
+struct SDKMESH_SUBSET
+{
+    char Name[MAX_SUBSET_NAME];
+    UINT MaterialID;
+    UINT PrimitiveType;
+    UINT64 IndexStart;
+    UINT64 IndexCount;
+    UINT64 VertexStart;
+    UINT64 VertexCount;
+};
+
+struct SDKMESH_FRAME
+{
+    char Name[MAX_FRAME_NAME];
+    UINT Mesh;
+    UINT ParentFrame;
+    UINT ChildFrame;
+    UINT SiblingFrame;
+    float Matrix[16];
+    UINT AnimationDataIndex;
+};
+
+struct SDKMESH_MATERIAL
+{
+    char    Name[MAX_MATERIAL_NAME];
+    char    MaterialInstancePath[MAX_MATERIAL_PATH];
+    char    DiffuseTexture[MAX_TEXTURE_NAME];
+    char    NormalTexture[MAX_TEXTURE_NAME];
+    char    SpecularTexture[MAX_TEXTURE_NAME];
+
+    float Diffuse[4];
+    float Ambient[4];
+    float Specular[4];
+    float Emissive[4];
+    float Power;
+
+    UINT64 Force64_1;
+    UINT64 Force64_2;
+    UINT64 Force64_3;
+    UINT64 Force64_4;
+    UINT64 Force64_5;
+    UINT64 Force64_6;
+};
+
+struct SDKMESH_LOD_HEADER
+{
+    UINT Magic;
+    UINT Version;
+    UINT NumSubsetLODs;
+    UINT NumIndexBuffers;
+    UINT64 SubsetLODOffset;
+    UINT64 IndexStreamHeadersOffset;
+};
+
+struct SDKMESH_SUBSET_LOD
+{
+    UINT Mesh;
+    UINT Subset;
+    UINT Level;
+    float Error;
+    float BoundingBoxCenter[3];
+    float BoundingBoxExtents[3];
+    UINT64 IndexStart;
+    UINT64 IndexCount;
+};
+
+#pragma pack(pop)
+
+static_assert( sizeof(D3DVERTEXELEMENT9) == 8, "Direct3D9 Decl structure size incorrect" );
+static_assert( sizeof(SDKMESH_HEADER)== 104, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_VERTEX_BUFFER_HEADER) == 288, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_INDEX_BUFFER_HEADER) == 32, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_MESH) == 224, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_SUBSET) == 144, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_FRAME) == 184, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_MATERIAL) == 1256, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_LOD_HEADER) == 32, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_SUBSET_LOD) == 56, "SDK Mesh structure size incorrect" );
+
+#endif // AMD_SDKMESH_FORMAT_H
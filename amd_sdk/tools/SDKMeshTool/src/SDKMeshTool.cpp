@@ -0,0 +1,1624 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: SDKMeshTool.cpp
+//
+// Command line tool for preparing sdkmesh files offline.
+//
+//   SDKMeshTool stats <input.sdkmesh>
+//   SDKMeshTool optimize <input.sdkmesh> <output.sdkmesh>
+//   SDKMeshTool lod <input.sdkmesh> <output.sdkmesh> [-levels n] [-ratio r] [-error e] [-threads n]
+//   SDKMeshTool meshlets <input.sdkmesh> [-poses n] [-iterations n] [-threads n]
+//   SDKMeshTool benchmark <input.sdkmesh> [-frames n] [-seed n] [-lights n,n,...] [-path file]
+//                         [-csv file] [-json file] [-width n] [-height n] [-threads n]
+//   SDKMeshTool path <input path> [-fps n] [-out file] [-format binary|text]
+//
+// optimize reorders the triangles of every triangle list subset for the post-transform
+// vertex cache and for overdraw, then reorders the subset's vertices in all streams for
+// fetch locality. Vertex ranges shared between subsets are only reindexed, not reordered.
+// Statistics are printed per subset before and after.
+//
+// lod generates a chain of simplified index lists for every subset and stores it after
+// the buffer data (see SDKMESH_LOD_HEADER), for CDXUTSDKMesh to select at runtime. Each
+// level aims for ratio times the triangles of the previous one, as long as the error stays
+// below the given fraction of the subset's bounding box diagonal. Subsets are processed in
+// parallel. Run optimize first, as it drops the LOD chain.
+//
+// meshlets is a benchmark for the meshlet culling used by the sample. It splits every
+// subset into meshlets, then culls them from a ring of camera poses around the mesh and
+// from inside it, printing build and cull times and how many meshlets and triangles were
+// removed by the frustum and normal cone tests. Every culled triangle is checked to be
+// outside the frustum or back-facing.
+//
+// benchmark is the headless half of DepthBoundsTest11's -benchmark mode. It generates the
+// sample's point lights from a fixed seed and replays a camera path for a number of frames
+// per light count, running the CPU work of each frame without a device: light projection,
+// frustum culling and depth bounds, binning into screen tiles and meshlet culling. Counters
+// and per-stage times are written with AMD::BenchmarkReport, in the same CSV and JSON
+// layout as the sample's, so CI can track both without a GPU.
+//
+// path plays a camera path (text, or binary as recorded by DepthBoundsTest11) back at a
+// fixed frame rate, printing its length and the largest step between frames. With -out
+// it saves the frames as a new path, e.g. to convert a recording to text or to resample
+// it, and checks that the file reads back identically.
+//--------------------------------------------------------------------------------------
+#include "SDKMeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "PointLights.h"
+#include "CameraPath.h"
+#include "BenchmarkReport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <wchar.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+using namespace AMD;
+
+// Statistics for one subset
+struct SubsetStatistics
+{
+    VertexCacheStatistics   Cache;
+    OverdrawStatistics      Overdraw;
+    float                   fOverfetch;
+};
+
+// Settings for the lod command
+struct LODOptions
+{
+    unsigned int    uLevels;        // Number of levels below full detail
+    float           fRatio;         // Triangle count of a level relative to the previous one
+    float           fMaxError;      // Relative to the bounding box diagonal of the subset
+    unsigned int    uThreads;
+};
+
+// The LOD chain generated for one subset
+struct SubsetLODChain
+{
+    UINT                                    iMesh;
+    UINT                                    iSubset;
+    size_t                                  uTriangles;
+    float                                   fDiagonal;
+    float                                   fCenter[3];
+    float                                   fExtents[3];
+    std::vector< std::vector<unsigned int> > Levels;
+    std::vector<float>                      Errors;
+};
+
+// Settings for the meshlets command
+struct MeshletOptions
+{
+    unsigned int    uPoses;         // Camera poses on the ring around the mesh
+    unsigned int    uIterations;    // Culls per pose, to average the timings
+    unsigned int    uThreads;
+};
+
+// Settings for the benchmark command
+struct BenchmarkOptions
+{
+    unsigned int                uFrames;        // Per light count
+    unsigned int                uSeed;
+    std::vector<unsigned int>   LightCounts;
+    const char*                 szPath;         // Camera path file, NULL to orbit through the light volume
+    const char*                 szCsv;
+    const char*                 szJson;
+    unsigned int                uWidth;
+    unsigned int                uHeight;
+    unsigned int                uThreads;
+};
+
+// Meshlets of all subsets of a mesh, with the indices of each meshlet for drawing and checking
+struct PathOptions
+{
+    float           fFrameRate;
+    const char*     szOutput;
+    bool            bText;
+};
+
+struct SceneMeshlets
+{
+    std::vector<Meshlet>        Meshlets;
+    std::vector<unsigned int>   MeshletVertices;
+    std::vector<unsigned char>  MeshletTriangles;
+    std::vector<MeshletBounds>  Bounds;
+    std::vector<unsigned int>   IndexOffsets;       // Into Indices, per meshlet plus one at the end
+    std::vector<unsigned int>   Indices;
+    std::vector<const float*>   MeshletPositions;
+    std::vector<size_t>         MeshletStrides;
+    float                       fMin[3];            // Bounds of all vertices
+    float                       fMax[3];
+    double                      fBuildSeconds;
+    size_t                      uTriangles;
+    size_t                      uSubsets;
+};
+
+// The data of one triangle list subset, with indices relative to VertexStart
+struct SubsetData
+{
+    std::vector<unsigned int>   Indices;
+    size_t                      uVertexCount;
+    const float*                pPositions;
+    size_t                      uPositionStride;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Finds the first float3 or float4 POSITION element in the streams of a mesh
+//--------------------------------------------------------------------------------------
+static bool FindPositionElement( const SDKMeshFile& Mesh, UINT iMesh, UINT* pVBIndex, UINT* pOffset )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+
+    for ( UINT iStream = 0; iStream < pMesh->NumVertexBuffers; iStream++ )
+    {
+        const SDKMESH_VERTEX_BUFFER_HEADER* pVB = Mesh.GetVBHeader( pMesh->VertexBuffers[iStream] );
+
+        for ( UINT i = 0; i < MAX_VERTEX_ELEMENTS && pVB->Decl[i].Stream != 0xFF; i++ )
+        {
+            const D3DVERTEXELEMENT9& Element = pVB->Decl[i];
+            if ( Element.Usage == D3DDECLUSAGE_POSITION && Element.UsageIndex == 0 &&
+                 ( Element.Type == D3DDECLTYPE_FLOAT3 || Element.Type == D3DDECLTYPE_FLOAT4 ) )
+            {
+                *pVBIndex = pMesh->VertexBuffers[iStream];
+                *pOffset = Element.Offset;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reads the indices of a subset. Returns false if the subset can't be processed.
+//--------------------------------------------------------------------------------------
+static bool ReadSubset( const SDKMeshFile& Mesh, UINT iMesh, UINT iSubset, SubsetData* pData )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+    const SDKMESH_SUBSET* pSubset = Mesh.GetSubset( iMesh, iSubset );
+    const SDKMESH_INDEX_BUFFER_HEADER* pIB = Mesh.GetIBHeader( pMesh->IndexBuffer );
+
+    if ( pSubset->PrimitiveType != PT_TRIANGLE_LIST || pSubset->IndexCount < 3 ||
+         pSubset->IndexStart + pSubset->IndexCount > pIB->NumIndices )
+    {
+        return false;
+    }
+
+    const size_t uIndexCount = (size_t)( pSubset->IndexCount / 3 * 3 );
+    pData->Indices.resize( uIndexCount );
+
+    const BYTE* pIndices = Mesh.GetRawIndicesAt( pMesh->IndexBuffer );
+    unsigned int uMaxIndex = 0;
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const size_t uIndex = (size_t)pSubset->IndexStart + i;
+        pData->Indices[i] = ( pIB->IndexType == IT_32BIT ) ? ( (const UINT*)pIndices )[uIndex] : ( (const WORD*)pIndices )[uIndex];
+        uMaxIndex = ( pData->Indices[i] > uMaxIndex ) ? pData->Indices[i] : uMaxIndex;
+    }
+
+    // Some exporters leave VertexCount at zero, so trust the indices over the header
+    pData->uVertexCount = (size_t)pSubset->VertexCount;
+    if ( pData->uVertexCount <= uMaxIndex )
+    {
+        pData->uVertexCount = (size_t)uMaxIndex + 1;
+    }
+
+    for ( UINT iStream = 0; iStream < pMesh->NumVertexBuffers; iStream++ )
+    {
+        if ( pSubset->VertexStart + pData->uVertexCount > Mesh.GetVBHeader( pMesh->VertexBuffers[iStream] )->NumVertices )
+        {
+            return false;
+        }
+    }
+
+    pData->pPositions = nullptr;
+    pData->uPositionStride = 0;
+
+    UINT iPositionVB = 0, uPositionOffset = 0;
+    if ( FindPositionElement( Mesh, iMesh, &iPositionVB, &uPositionOffset ) )
+    {
+        const SDKMESH_VERTEX_BUFFER_HEADER* pVB = Mesh.GetVBHeader( iPositionVB );
+        pData->pPositions = (const float*)( Mesh.GetRawVerticesAt( iPositionVB ) + pSubset->VertexStart * pVB->StrideBytes + uPositionOffset );
+        pData->uPositionStride = (size_t)pVB->StrideBytes;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writes the indices of a subset back to the index buffer
+//--------------------------------------------------------------------------------------
+static void WriteSubsetIndices( const SDKMeshFile& Mesh, UINT iMesh, UINT iSubset, const SubsetData& Data )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+    const SDKMESH_SUBSET* pSubset = Mesh.GetSubset( iMesh, iSubset );
+    const SDKMESH_INDEX_BUFFER_HEADER* pIB = Mesh.GetIBHeader( pMesh->IndexBuffer );
+
+    BYTE* pIndices = Mesh.GetRawIndicesAt( pMesh->IndexBuffer );
+    for ( size_t i = 0; i < Data.Indices.size(); i++ )
+    {
+        const size_t uIndex = (size_t)pSubset->IndexStart + i;
+        if ( pIB->IndexType == IT_32BIT )
+        {
+            ( (UINT*)pIndices )[uIndex] = Data.Indices[i];
+        }
+        else
+        {
+            ( (WORD*)pIndices )[uIndex] = (WORD)Data.Indices[i];
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Returns true if another subset references any of this subset's vertices
+//--------------------------------------------------------------------------------------
+static bool IsVertexRangeShared( const SDKMeshFile& Mesh, UINT iMesh, UINT iSubset, size_t uVertexCount )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+    const SDKMESH_SUBSET* pSubset = Mesh.GetSubset( iMesh, iSubset );
+    const UINT64 uStart = pSubset->VertexStart;
+    const UINT64 uEnd = uStart + uVertexCount;
+
+    for ( UINT iOtherMesh = 0; iOtherMesh < Mesh.GetNumMeshes(); iOtherMesh++ )
+    {
+        const SDKMESH_MESH* pOtherMesh = Mesh.GetMesh( iOtherMesh );
+
+        bool bSharesStream = false;
+        for ( UINT i = 0; i < pMesh->NumVertexBuffers; i++ )
+        {
+            for ( UINT j = 0; j < pOtherMesh->NumVertexBuffers; j++ )
+            {
+                bSharesStream |= ( pMesh->VertexBuffers[i] == pOtherMesh->VertexBuffers[j] );
+            }
+        }
+        if ( !bSharesStream )
+        {
+            continue;
+        }
+
+        for ( UINT iOtherSubset = 0; iOtherSubset < pOtherMesh->NumSubsets; iOtherSubset++ )
+        {
+            if ( iOtherMesh == iMesh && iOtherSubset == iSubset )
+            {
+                continue;
+            }
+
+            const SDKMESH_SUBSET* pOther = Mesh.GetSubset( iOtherMesh, iOtherSubset );
+            const UINT64 uOtherStart = pOther->VertexStart;
+            const UINT64 uOtherEnd = uOtherStart + ( pOther->VertexCount ? pOther->VertexCount : 1 );
+
+            if ( uOtherStart < uEnd && uStart < uOtherEnd )
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Gathers the statistics for one subset. Overfetch is weighted over all vertex streams.
+//--------------------------------------------------------------------------------------
+static SubsetStatistics Analyze( const SDKMeshFile& Mesh, UINT iMesh, const SubsetData& Data )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+    const unsigned int* pIndices = &Data.Indices[0];
+    const size_t uIndexCount = Data.Indices.size();
+
+    SubsetStatistics Stats;
+    memset( &Stats, 0, sizeof( Stats ) );
+
+    Stats.Cache = AnalyzeVertexCache( pIndices, uIndexCount, Data.uVertexCount );
+
+    if ( Data.pPositions )
+    {
+        Stats.Overdraw = AnalyzeOverdraw( pIndices, uIndexCount, Data.pPositions, Data.uVertexCount, Data.uPositionStride );
+    }
+
+    double fFetched = 0.0, fReferenced = 0.0;
+    for ( UINT iStream = 0; iStream < pMesh->NumVertexBuffers; iStream++ )
+    {
+        const size_t uStride = (size_t)Mesh.GetVBHeader( pMesh->VertexBuffers[iStream] )->StrideBytes;
+        const VertexFetchStatistics Fetch = AnalyzeVertexFetch( pIndices, uIndexCount, Data.uVertexCount, uStride );
+        if ( Fetch.fOverfetch > 0.0f )
+        {
+            fFetched += (double)Fetch.uBytesFetched;
+            fReferenced += (double)Fetch.uBytesFetched / Fetch.fOverfetch;
+        }
+    }
+    Stats.fOverfetch = ( fReferenced > 0.0 ) ? (float)( fFetched / fReferenced ) : 0.0f;
+
+    return Stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintStatistics( const char* szLabel, const SubsetStatistics& Stats, bool bHasPositions )
+{
+    if ( bHasPositions )
+    {
+        printf( "    %-8s ACMR %5.3f  ATVR %5.3f  overdraw %5.3f  overfetch %5.3f\n",
+                szLabel, Stats.Cache.fACMR, Stats.Cache.fATVR, Stats.Overdraw.fOverdraw, Stats.fOverfetch );
+    }
+    else
+    {
+        printf( "    %-8s ACMR %5.3f  ATVR %5.3f  overdraw   n/a  overfetch %5.3f\n",
+                szLabel, Stats.Cache.fACMR, Stats.Cache.fATVR, Stats.fOverfetch );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Optimizes one subset in place
+//--------------------------------------------------------------------------------------
+static void OptimizeSubset( SDKMeshFile& Mesh, UINT iMesh, UINT iSubset, SubsetData& Data )
+{
+    const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+    const SDKMESH_SUBSET* pSubset = Mesh.GetSubset( iMesh, iSubset );
+    const size_t uIndexCount = Data.Indices.size();
+
+    std::vector<unsigned int> Reordered( uIndexCount );
+    OptimizeVertexCache( &Reordered[0], &Data.Indices[0], uIndexCount, Data.uVertexCount );
+
+    if ( Data.pPositions )
+    {
+        OptimizeOverdraw( &Data.Indices[0], &Reordered[0], uIndexCount, Data.pPositions, Data.uVertexCount, Data.uPositionStride );
+    }
+    else
+    {
+        Data.Indices.swap( Reordered );
+    }
+
+    if ( IsVertexRangeShared( Mesh, iMesh, iSubset, Data.uVertexCount ) )
+    {
+        printf( "    vertex range shared with another subset, vertex order kept\n" );
+    }
+    else
+    {
+        std::vector<unsigned int> Remap( Data.uVertexCount );
+        OptimizeVertexFetchRemap( &Remap[0], &Data.Indices[0], uIndexCount, Data.uVertexCount );
+        RemapIndices( &Data.Indices[0], &Data.Indices[0], uIndexCount, &Remap[0] );
+
+        std::vector<BYTE> Vertices;
+        for ( UINT iStream = 0; iStream < pMesh->NumVertexBuffers; iStream++ )
+        {
+            const UINT iVB = pMesh->VertexBuffers[iStream];
+            const size_t uStride = (size_t)Mesh.GetVBHeader( iVB )->StrideBytes;
+            BYTE* pVertices = Mesh.GetRawVerticesAt( iVB ) + pSubset->VertexStart * uStride;
+
+            Vertices.assign( pVertices, pVertices + Data.uVertexCount * uStride );
+            RemapVertices( pVertices, &Vertices[0], Data.uVertexCount, uStride, &Remap[0] );
+        }
+    }
+
+    WriteSubsetIndices( Mesh, iMesh, iSubset, Data );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs over all subsets, printing statistics and optionally optimizing
+//--------------------------------------------------------------------------------------
+static void ProcessMesh( SDKMeshFile& Mesh, bool bOptimize )
+{
+    SubsetStatistics Total[2];
+    memset( Total, 0, sizeof( Total ) );
+    size_t uTotalTriangles = 0;
+
+    for ( UINT iMesh = 0; iMesh < Mesh.GetNumMeshes(); iMesh++ )
+    {
+        const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+
+        for ( UINT iSubset = 0; iSubset < pMesh->NumSubsets; iSubset++ )
+        {
+            const SDKMESH_SUBSET* pSubset = Mesh.GetSubset( iMesh, iSubset );
+
+            printf( "Mesh %u \"%s\", subset %u \"%s\"", iMesh, pMesh->Name, iSubset, pSubset->Name );
+
+            SubsetData Data;
+            if ( !ReadSubset( Mesh, iMesh, iSubset, &Data ) )
+            {
+                printf( ": skipped (not an indexed triangle list)\n" );
+                continue;
+            }
+
+            const size_t uTriangles = Data.Indices.size() / 3;
+            const float fTriangles = (float)uTriangles;
+            printf( ": %u triangles, %u vertices\n", (unsigned int)uTriangles, (unsigned int)Data.uVertexCount );
+
+            const SubsetStatistics Before = Analyze( Mesh, iMesh, Data );
+            PrintStatistics( "before", Before, Data.pPositions != nullptr );
+
+            SubsetStatistics After = Before;
+            if ( bOptimize )
+            {
+                OptimizeSubset( Mesh, iMesh, iSubset, Data );
+                After = Analyze( Mesh, iMesh, Data );
+                PrintStatistics( "after", After, Data.pPositions != nullptr );
+            }
+            else
+            {
+                for ( UINT iLevel = 1; iLevel <= Mesh.GetNumSubsetLODs( iMesh, iSubset ); iLevel++ )
+                {
+                    const SDKMESH_SUBSET_LOD* pLOD = Mesh.GetSubsetLOD( iMesh, iSubset, iLevel );
+                    printf( "    LOD %u    %u triangles, error %g\n", iLevel, (unsigned int)( pLOD->IndexCount / 3 ), pLOD->Error );
+                }
+            }
+
+            // Triangle weighted totals
+            const SubsetStatistics* pStats[2] = { &Before, &After };
+            for ( int i = 0; i < 2; i++ )
+            {
+                Total[i].Cache.fACMR += pStats[i]->Cache.fACMR * fTriangles;
+                Total[i].Cache.fATVR += pStats[i]->Cache.fATVR * fTriangles;
+                Total[i].Overdraw.fOverdraw += pStats[i]->Overdraw.fOverdraw * fTriangles;
+                Total[i].fOverfetch += pStats[i]->fOverfetch * fTriangles;
+            }
+            uTotalTriangles += uTriangles;
+        }
+    }
+
+    if ( uTotalTriangles > 0 )
+    {
+        printf( "Total: %u triangles\n", (unsigned int)uTotalTriangles );
+        for ( int i = 0; i < ( bOptimize ? 2 : 1 ); i++ )
+        {
+            Total[i].Cache.fACMR /= (float)uTotalTriangles;
+            Total[i].Cache.fATVR /= (float)uTotalTriangles;
+            Total[i].Overdraw.fOverdraw /= (float)uTotalTriangles;
+            Total[i].fOverfetch /= (float)uTotalTriangles;
+            PrintStatistics( i ? "after" : "before", Total[i], true );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Simplifies one subset into a chain of LODs. Each level is simplified from the full
+// detail mesh, so the error reported is always against the original surface.
+//--------------------------------------------------------------------------------------
+static void GenerateSubsetLODs( const SDKMeshFile& Mesh, const LODOptions& Options, SubsetLODChain& Chain )
+{
+    SubsetData Data;
+    if ( !ReadSubset( Mesh, Chain.iMesh, Chain.iSubset, &Data ) || !Data.pPositions )
+    {
+        return;
+    }
+
+    const size_t uIndexCount = Data.Indices.size();
+    Chain.uTriangles = uIndexCount / 3;
+
+    float fMin[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+    float fMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( size_t i = 0; i < uIndexCount; i++ )
+    {
+        const float* p = (const float*)( (const BYTE*)Data.pPositions + Data.Indices[i] * Data.uPositionStride );
+        for ( int k = 0; k < 3; k++ )
+        {
+            fMin[k] = ( p[k] < fMin[k] ) ? p[k] : fMin[k];
+            fMax[k] = ( p[k] > fMax[k] ) ? p[k] : fMax[k];
+        }
+    }
+
+    float fDiagonalSquared = 0.0f;
+    for ( int k = 0; k < 3; k++ )
+    {
+        Chain.fCenter[k] = ( fMin[k] + fMax[k] ) * 0.5f;
+        Chain.fExtents[k] = ( fMax[k] - fMin[k] ) * 0.5f;
+        fDiagonalSquared += ( fMax[k] - fMin[k] ) * ( fMax[k] - fMin[k] );
+    }
+    Chain.fDiagonal = sqrtf( fDiagonalSquared );
+
+    std::vector<unsigned int> Simplified( uIndexCount );
+    size_t uPreviousCount = uIndexCount;
+    float fPreviousError = 0.0f;
+    double fTarget = (double)uIndexCount;
+
+    for ( unsigned int uLevel = 1; uLevel <= Options.uLevels; uLevel++ )
+    {
+        fTarget *= Options.fRatio;
+
+        float fError = 0.0f;
+        const size_t uCount = SimplifyMesh( &Simplified[0], &Data.Indices[0], uIndexCount,
+                                            Data.pPositions, Data.uVertexCount, Data.uPositionStride,
+                                            (size_t)fTarget, Options.fMaxError * Chain.fDiagonal, &fError );
+
+        // Stop once the error limit stalls the simplification; a level saving less
+        // than a tenth of the triangles isn't worth switching to
+        if ( uCount == 0 || uCount > uPreviousCount * 9 / 10 )
+        {
+            break;
+        }
+
+        std::vector<unsigned int> Level( uCount );
+        OptimizeVertexCache( &Level[0], &Simplified[0], uCount, Data.uVertexCount );
+
+        // The runtime expects the error to grow with the level
+        fPreviousError = ( fError > fPreviousError ) ? fError : fPreviousError;
+
+        Chain.Levels.push_back( Level );
+        Chain.Errors.push_back( fPreviousError );
+        uPreviousCount = uCount;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Lays out the LOD chunk: header, subset LODs, one index buffer header per index buffer of
+// the file, then the index data. Offsets are from the start of the file.
+//--------------------------------------------------------------------------------------
+static std::vector<BYTE> BuildLODChunk( const SDKMeshFile& Mesh, const std::vector<SubsetLODChain>& Chains )
+{
+    const UINT uNumIBs = Mesh.GetNumIBs();
+
+    std::vector<SDKMESH_SUBSET_LOD> SubsetLODs;
+    std::vector< std::vector<BYTE> > IndexData( uNumIBs );
+
+    for ( size_t i = 0; i < Chains.size(); i++ )
+    {
+        const SubsetLODChain& Chain = Chains[i];
+        const UINT iIB = Mesh.GetMesh( Chain.iMesh )->IndexBuffer;
+        const bool b32Bit = ( Mesh.GetIBHeader( iIB )->IndexType == IT_32BIT );
+        const size_t uIndexSize = b32Bit ? sizeof( UINT ) : sizeof( WORD );
+
+        for ( size_t uLevel = 0; uLevel < Chain.Levels.size(); uLevel++ )
+        {
+            const std::vector<unsigned int>& Indices = Chain.Levels[uLevel];
+            std::vector<BYTE>& Data = IndexData[iIB];
+
+            SDKMESH_SUBSET_LOD LOD;
+            memset( &LOD, 0, sizeof( LOD ) );
+            LOD.Mesh = Chain.iMesh;
+            LOD.Subset = Chain.iSubset;
+            LOD.Level = (UINT)uLevel + 1;
+            LOD.Error = Chain.Errors[uLevel];
+            memcpy( &LOD.BoundingBoxCenter, Chain.fCenter, sizeof( Chain.fCenter ) );
+            memcpy( &LOD.BoundingBoxExtents, Chain.fExtents, sizeof( Chain.fExtents ) );
+            LOD.IndexStart = Data.size() / uIndexSize;
+            LOD.IndexCount = Indices.size();
+            SubsetLODs.push_back( LOD );
+
+            const size_t uOffset = Data.size();
+            Data.resize( uOffset + Indices.size() * uIndexSize );
+            for ( size_t j = 0; j < Indices.size(); j++ )
+            {
+                if ( b32Bit )
+                {
+                    const UINT uIndex = Indices[j];
+                    memcpy( &Data[ uOffset + j * uIndexSize ], &uIndex, uIndexSize );
+                }
+                else
+                {
+                    const WORD uIndex = (WORD)Indices[j];
+                    memcpy( &Data[ uOffset + j * uIndexSize ], &uIndex, uIndexSize );
+                }
+            }
+        }
+    }
+
+    const UINT64 uBase = Mesh.GetExtensionOffset();
+
+    SDKMESH_LOD_HEADER Header;
+    memset( &Header, 0, sizeof( Header ) );
+    Header.Magic = SDKMESH_LOD_MAGIC;
+    Header.Version = SDKMESH_LOD_VERSION;
+    Header.NumSubsetLODs = (UINT)SubsetLODs.size();
+    Header.NumIndexBuffers = uNumIBs;
+    Header.SubsetLODOffset = uBase + sizeof( Header );
+    Header.IndexStreamHeadersOffset = Header.SubsetLODOffset + SubsetLODs.size() * sizeof( SDKMESH_SUBSET_LOD );
+
+    std::vector<SDKMESH_INDEX_BUFFER_HEADER> IBHeaders( uNumIBs );
+    UINT64 uDataOffset = Header.IndexStreamHeadersOffset + uNumIBs * sizeof( SDKMESH_INDEX_BUFFER_HEADER );
+    for ( UINT i = 0; i < uNumIBs; i++ )
+    {
+        const UINT uIndexType = Mesh.GetIBHeader( i )->IndexType;
+
+        memset( &IBHeaders[i], 0, sizeof( SDKMESH_INDEX_BUFFER_HEADER ) );
+        IBHeaders[i].NumIndices = IndexData[i].size() / ( uIndexType == IT_32BIT ? sizeof( UINT ) : sizeof( WORD ) );
+        IBHeaders[i].SizeBytes = IndexData[i].size();
+        IBHeaders[i].IndexType = uIndexType;
+        IBHeaders[i].DataOffset = uDataOffset;
+
+        // Keep every buffer 16 byte aligned, like the converter does
+        uDataOffset += ( IndexData[i].size() + 15 ) & ~(size_t)15;
+    }
+
+    std::vector<BYTE> Chunk( (size_t)( uDataOffset - uBase ), 0 );
+    memcpy( &Chunk[0], &Header, sizeof( Header ) );
+    if ( !SubsetLODs.empty() )
+    {
+        memcpy( &Chunk[ (size_t)( Header.SubsetLODOffset - uBase ) ], &SubsetLODs[0], SubsetLODs.size() * sizeof( SDKMESH_SUBSET_LOD ) );
+    }
+    if ( uNumIBs > 0 )
+    {
+        memcpy( &Chunk[ (size_t)( Header.IndexStreamHeadersOffset - uBase ) ], &IBHeaders[0], uNumIBs * sizeof( SDKMESH_INDEX_BUFFER_HEADER ) );
+    }
+    for ( UINT i = 0; i < uNumIBs; i++ )
+    {
+        if ( !IndexData[i].empty() )
+        {
+            memcpy( &Chunk[ (size_t)( IBHeaders[i].DataOffset - uBase ) ], &IndexData[i][0], IndexData[i].size() );
+        }
+    }
+
+    return Chunk;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Generates LODs for all subsets on a pool of threads and prints the error report
+//--------------------------------------------------------------------------------------
+static void GenerateLODs( SDKMeshFile& Mesh, const LODOptions& Options )
+{
+    std::vector<SubsetLODChain> Chains;
+    for ( UINT iMesh = 0; iMesh < Mesh.GetNumMeshes(); iMesh++ )
+    {
+        for ( UINT iSubset = 0; iSubset < Mesh.GetMesh( iMesh )->NumSubsets; iSubset++ )
+        {
+            SubsetLODChain Chain;
+            Chain.iMesh = iMesh;
+            Chain.iSubset = iSubset;
+            Chain.uTriangles = 0;
+            Chain.fDiagonal = 0.0f;
+            Chains.push_back( Chain );
+        }
+    }
+
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+
+    std::atomic<size_t> NextChain( 0 );
+    std::vector<std::thread> Threads;
+    for ( unsigned int i = 0; i < Options.uThreads; i++ )
+    {
+        Threads.push_back( std::thread( [&]()
+        {
+            for ( size_t uChain = NextChain++; uChain < Chains.size(); uChain = NextChain++ )
+            {
+                GenerateSubsetLODs( Mesh, Options, Chains[uChain] );
+            }
+        } ) );
+    }
+    for ( size_t i = 0; i < Threads.size(); i++ )
+    {
+        Threads[i].join();
+    }
+
+    const double fSeconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - StartTime ).count();
+
+    std::vector<size_t> LevelTriangles( Options.uLevels + 1, 0 );
+
+    for ( size_t i = 0; i < Chains.size(); i++ )
+    {
+        const SubsetLODChain& Chain = Chains[i];
+        const SDKMESH_MESH* pMesh = Mesh.GetMesh( Chain.iMesh );
+
+        printf( "Mesh %u \"%s\", subset %u \"%s\"", Chain.iMesh, pMesh->Name, Chain.iSubset, Mesh.GetSubset( Chain.iMesh, Chain.iSubset )->Name );
+        if ( Chain.uTriangles == 0 )
+        {
+            printf( ": skipped (not an indexed triangle list with positions)\n" );
+            continue;
+        }
+        printf( ": %u triangles, bounds diagonal %g\n", (unsigned int)Chain.uTriangles, Chain.fDiagonal );
+
+        for ( size_t uLevel = 0; uLevel <= Options.uLevels; uLevel++ )
+        {
+            // Subsets with fewer levels are drawn at their coarsest level beyond that
+            const size_t uClamped = ( uLevel < Chain.Levels.size() ) ? uLevel : Chain.Levels.size();
+            LevelTriangles[uLevel] += uClamped ? Chain.Levels[ uClamped - 1 ].size() / 3 : Chain.uTriangles;
+        }
+
+        for ( size_t uLevel = 0; uLevel < Chain.Levels.size(); uLevel++ )
+        {
+            const size_t uTriangles = Chain.Levels[uLevel].size() / 3;
+            printf( "    LOD %u    %7u triangles (%5.1f%%)  error %-10g (%.4f%% of bounds)\n",
+                    (unsigned int)uLevel + 1, (unsigned int)uTriangles, 100.0 * (double)uTriangles / (double)Chain.uTriangles,
+                    Chain.Errors[uLevel], Chain.fDiagonal > 0.0f ? 100.0 * Chain.Errors[uLevel] / Chain.fDiagonal : 0.0 );
+        }
+    }
+
+    printf( "Total:\n" );
+    for ( size_t uLevel = 0; uLevel <= Options.uLevels; uLevel++ )
+    {
+        printf( "    LOD %u    %7u triangles (%5.1f%%)\n", (unsigned int)uLevel, (unsigned int)LevelTriangles[uLevel],
+                LevelTriangles[0] ? 100.0 * (double)LevelTriangles[uLevel] / (double)LevelTriangles[0] : 0.0 );
+    }
+    printf( "Simplified %u subsets in %.3f s on %u threads\n", (unsigned int)Chains.size(), fSeconds, Options.uThreads );
+
+    Mesh.SetExtensionData( BuildLODChunk( Mesh, Chains ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Row-vector matrix helpers for the meshlet benchmark, matching DirectXMath's conventions
+//--------------------------------------------------------------------------------------
+static void MatrixMultiply( float* pOut, const float* pA, const float* pB )
+{
+    for ( int r = 0; r < 4; r++ )
+    {
+        for ( int c = 0; c < 4; c++ )
+        {
+            pOut[r * 4 + c] = pA[r * 4 + 0] * pB[0 * 4 + c] + pA[r * 4 + 1] * pB[1 * 4 + c] +
+                              pA[r * 4 + 2] * pB[2 * 4 + c] + pA[r * 4 + 3] * pB[3 * 4 + c];
+        }
+    }
+}
+
+static void Normalize( float* v )
+{
+    const float fLength = sqrtf( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+    v[0] /= fLength;
+    v[1] /= fLength;
+    v[2] /= fLength;
+}
+
+static void Cross( float* pOut, const float* a, const float* b )
+{
+    pOut[0] = a[1] * b[2] - a[2] * b[1];
+    pOut[1] = a[2] * b[0] - a[0] * b[2];
+    pOut[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float Dot( const float* a, const float* b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Left-handed look-at view times perspective projection, as XMMatrixLookAtLH * XMMatrixPerspectiveFovLH
+static void BuildViewProjection( float* pOut, const float* pEye, const float* pAt, float fNear, float fFar )
+{
+    float z[3] = { pAt[0] - pEye[0], pAt[1] - pEye[1], pAt[2] - pEye[2] };
+    Normalize( z );
+    float Up[3] = { 0.0f, 1.0f, 0.0f };
+    if ( fabsf( z[1] ) > 0.99f )
+    {
+        Up[1] = 0.0f;
+        Up[2] = 1.0f;
+    }
+    float x[3], y[3];
+    Cross( x, Up, z );
+    Normalize( x );
+    Cross( y, z, x );
+
+    const float View[16] =
+    {
+        x[0], y[0], z[0], 0.0f,
+        x[1], y[1], z[1], 0.0f,
+        x[2], y[2], z[2], 0.0f,
+        -Dot( x, pEye ), -Dot( y, pEye ), -Dot( z, pEye ), 1.0f
+    };
+
+    const float fHeight = 1.0f / tanf( 0.5f * 3.14159265f / 3.0f );
+    const float fWidth = fHeight / ( 16.0f / 9.0f );
+    const float fRange = fFar / ( fFar - fNear );
+    const float Projection[16] =
+    {
+        fWidth, 0.0f, 0.0f, 0.0f,
+        0.0f, fHeight, 0.0f, 0.0f,
+        0.0f, 0.0f, fRange, 1.0f,
+        0.0f, 0.0f, -fRange * fNear, 0.0f
+    };
+
+    MatrixMultiply( pOut, View, Projection );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Counts the triangles of culled meshlets that are neither back-facing nor entirely
+// outside one frustum plane. Any such triangle would be missing from the image.
+//--------------------------------------------------------------------------------------
+static size_t CountWronglyCulledTriangles( const MeshletCullView& View, const std::vector<unsigned char>& Visible,
+                                           const std::vector<unsigned int>& IndexOffsets, const std::vector<unsigned int>& Indices,
+                                           const std::vector<const float*>& MeshletPositions, const std::vector<size_t>& MeshletStrides )
+{
+    size_t uWrong = 0;
+
+    for ( size_t m = 0; m < Visible.size(); m++ )
+    {
+        if ( Visible[m] )
+        {
+            continue;
+        }
+
+        for ( unsigned int i = IndexOffsets[m]; i < IndexOffsets[m + 1]; i += 3 )
+        {
+            const float* p[3];
+            for ( int k = 0; k < 3; k++ )
+            {
+                p[k] = (const float*)( (const BYTE*)MeshletPositions[m] + Indices[i + k] * MeshletStrides[m] );
+            }
+
+            const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            const float d[3] = { p[0][0] - View.fCameraPosition[0], p[0][1] - View.fCameraPosition[1], p[0][2] - View.fCameraPosition[2] };
+            float n[3];
+            Cross( n, e1, e2 );
+            if ( Dot( n, d ) >= 0.0f )
+            {
+                continue;
+            }
+
+            bool bOutside = false;
+            for ( int iPlane = 0; iPlane < 6 && !bOutside; iPlane++ )
+            {
+                const float* pPlane = View.fPlanes[iPlane];
+                bOutside = Dot( pPlane, p[0] ) + pPlane[3] < 0.0f &&
+                           Dot( pPlane, p[1] ) + pPlane[3] < 0.0f &&
+                           Dot( pPlane, p[2] ) + pPlane[3] < 0.0f;
+            }
+            uWrong += bOutside ? 0 : 1;
+        }
+    }
+
+    return uWrong;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Splits all triangle list subsets with positions into meshlets
+//--------------------------------------------------------------------------------------
+static void BuildSceneMeshlets( const SDKMeshFile& Mesh, SceneMeshlets& Scene )
+{
+    for ( int k = 0; k < 3; k++ )
+    {
+        Scene.fMin[k] =  FLT_MAX;
+        Scene.fMax[k] = -FLT_MAX;
+    }
+    Scene.IndexOffsets.assign( 1, 0 );
+    Scene.fBuildSeconds = 0.0;
+    Scene.uTriangles = 0;
+    Scene.uSubsets = 0;
+
+    for ( UINT iMesh = 0; iMesh < Mesh.GetNumMeshes(); iMesh++ )
+    {
+        for ( UINT iSubset = 0; iSubset < Mesh.GetMesh( iMesh )->NumSubsets; iSubset++ )
+        {
+            SubsetData Data;
+            if ( !ReadSubset( Mesh, iMesh, iSubset, &Data ) || !Data.pPositions )
+            {
+                continue;
+            }
+
+            const size_t uFirst = Scene.Meshlets.size();
+            const auto StartTime = std::chrono::high_resolution_clock::now();
+
+            BuildMeshlets( Scene.Meshlets, Scene.MeshletVertices, Scene.MeshletTriangles, &Data.Indices[0], Data.Indices.size(),
+                           Data.pPositions, Data.uVertexCount, Data.uPositionStride );
+            for ( size_t m = uFirst; m < Scene.Meshlets.size(); m++ )
+            {
+                Scene.Bounds.push_back( ComputeMeshletBounds( Scene.Meshlets[m], &Scene.MeshletVertices[0], &Scene.MeshletTriangles[0],
+                                                              Data.pPositions, Data.uPositionStride ) );
+            }
+
+            Scene.fBuildSeconds += std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - StartTime ).count();
+
+            for ( size_t m = uFirst; m < Scene.Meshlets.size(); m++ )
+            {
+                const Meshlet& M = Scene.Meshlets[m];
+                for ( unsigned int i = 0; i < M.uTriangleCount * 3; i++ )
+                {
+                    Scene.Indices.push_back( Scene.MeshletVertices[ M.uVertexOffset + Scene.MeshletTriangles[ M.uTriangleOffset + i ] ] );
+                }
+                Scene.IndexOffsets.push_back( (unsigned int)Scene.Indices.size() );
+                Scene.MeshletPositions.push_back( Data.pPositions );
+                Scene.MeshletStrides.push_back( Data.uPositionStride );
+            }
+
+            for ( size_t i = 0; i < Data.uVertexCount; i++ )
+            {
+                const float* p = (const float*)( (const BYTE*)Data.pPositions + i * Data.uPositionStride );
+                for ( int k = 0; k < 3; k++ )
+                {
+                    Scene.fMin[k] = ( p[k] < Scene.fMin[k] ) ? p[k] : Scene.fMin[k];
+                    Scene.fMax[k] = ( p[k] > Scene.fMax[k] ) ? p[k] : Scene.fMax[k];
+                }
+            }
+
+            Scene.uTriangles += Data.Indices.size() / 3;
+            Scene.uSubsets++;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Builds meshlets for all subsets and benchmarks culling them from a set of camera poses
+//--------------------------------------------------------------------------------------
+static void BenchmarkMeshlets( const SDKMeshFile& Mesh, const MeshletOptions& Options )
+{
+    SceneMeshlets Scene;
+    BuildSceneMeshlets( Mesh, Scene );
+
+    const std::vector<Meshlet>& Meshlets = Scene.Meshlets;
+    const std::vector<MeshletBounds>& Bounds = Scene.Bounds;
+    const std::vector<unsigned int>& IndexOffsets = Scene.IndexOffsets;
+    const std::vector<unsigned int>& Indices = Scene.Indices;
+    const float* fMin = Scene.fMin;
+    const float* fMax = Scene.fMax;
+    const double fBuildSeconds = Scene.fBuildSeconds;
+    const size_t uTriangles = Scene.uTriangles;
+    const size_t uSubsets = Scene.uSubsets;
+
+    if ( Meshlets.empty() )
+    {
+        printf( "No triangle list subsets with positions found\n" );
+        return;
+    }
+
+    size_t uMeshletVertices = 0, uConeCullable = 0;
+    for ( size_t m = 0; m < Meshlets.size(); m++ )
+    {
+        uMeshletVertices += Meshlets[m].uVertexCount;
+        uConeCullable += ( Bounds[m].fConeCutoff < 1.0f ) ? 1 : 0;
+    }
+
+    printf( "%u subsets, %u triangles in %u meshlets\n", (unsigned int)uSubsets, (unsigned int)uTriangles, (unsigned int)Meshlets.size() );
+    printf( "    %.1f vertices, %.1f triangles per meshlet on average, %.1f%% with a usable normal cone\n",
+            (double)uMeshletVertices / (double)Meshlets.size(), (double)uTriangles / (double)Meshlets.size(),
+            100.0 * (double)uConeCullable / (double)Meshlets.size() );
+    printf( "    built in %.1f ms (%.1f ns per triangle)\n", fBuildSeconds * 1000.0, fBuildSeconds * 1e9 / (double)uTriangles );
+
+    MeshletBoundsSoA BoundsSoA;
+    BoundsSoA.Build( &Bounds[0], Bounds.size() );
+
+    MeshletCuller SingleThreaded( 1 );
+    MeshletCuller MultiThreaded( Options.uThreads );
+
+    std::vector<unsigned int> DstIndices( Indices.size() );
+    std::vector<unsigned int> DstOffsets( Meshlets.size() + 1 );
+
+    const float fCenter[3] = { ( fMin[0] + fMax[0] ) * 0.5f, ( fMin[1] + fMax[1] ) * 0.5f, ( fMin[2] + fMax[2] ) * 0.5f };
+    const float fRadius = 0.5f * sqrtf( ( fMax[0] - fMin[0] ) * ( fMax[0] - fMin[0] ) + ( fMax[1] - fMin[1] ) * ( fMax[1] - fMin[1] ) +
+                                        ( fMax[2] - fMin[2] ) * ( fMax[2] - fMin[2] ) );
+
+    printf( "Culling with 1 and %u threads, %u iterations per pose:\n", MultiThreaded.GetThreadCount(), Options.uIterations );
+    printf( "    pose          visible   frustum      cone   triangles drawn      1 thread   %2u threads\n", MultiThreaded.GetThreadCount() );
+
+    MeshletCullStatistics Total;
+    double fTotalSingle = 0.0, fTotalMulti = 0.0;
+    size_t uWrong = 0;
+
+    // A ring of poses looking at the mesh from outside, then two from its centre
+    const unsigned int uPoses = Options.uPoses + 2;
+    for ( unsigned int uPose = 0; uPose < uPoses; uPose++ )
+    {
+        float fEye[3], fAt[3];
+        char szPose[32];
+        if ( uPose < Options.uPoses )
+        {
+            const float fAngle = 2.0f * 3.14159265f * (float)uPose / (float)Options.uPoses;
+            fEye[0] = fCenter[0] + 1.5f * fRadius * cosf( fAngle );
+            fEye[1] = fCenter[1] + 0.5f * fRadius;
+            fEye[2] = fCenter[2] + 1.5f * fRadius * sinf( fAngle );
+            memcpy( fAt, fCenter, sizeof( fAt ) );
+            snprintf( szPose, sizeof( szPose ), "orbit %3u deg", (unsigned int)( 360 * uPose / Options.uPoses ) );
+        }
+        else
+        {
+            memcpy( fEye, fCenter, sizeof( fEye ) );
+            fAt[0] = fCenter[0] + ( uPose == Options.uPoses ? 1.0f : 0.0f );
+            fAt[1] = fCenter[1];
+            fAt[2] = fCenter[2] + ( uPose == Options.uPoses ? 0.0f : 1.0f );
+            snprintf( szPose, sizeof( szPose ), "inside %s", uPose == Options.uPoses ? "+x" : "+z" );
+        }
+
+        float fViewProjection[16];
+        BuildViewProjection( fViewProjection, fEye, fAt, fRadius * 0.001f, fRadius * 4.0f );
+
+        MeshletCullView View;
+        SetupMeshletCullView( &View, fViewProjection, fEye );
+
+        double fSeconds[2] = { 0.0, 0.0 };
+        MeshletCullStatistics Stats;
+        for ( int iCuller = 0; iCuller < 2; iCuller++ )
+        {
+            MeshletCuller& Culler = iCuller ? MultiThreaded : SingleThreaded;
+            const auto StartTime = std::chrono::high_resolution_clock::now();
+            for ( unsigned int i = 0; i < Options.uIterations; i++ )
+            {
+                Stats = MeshletCullStatistics();
+                Culler.CullAndCompact( View, BoundsSoA, &IndexOffsets[0], &Indices[0], &DstIndices[0], &DstOffsets[0], &Stats );
+            }
+            fSeconds[iCuller] = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - StartTime ).count() / (double)Options.uIterations;
+        }
+
+        std::vector<unsigned char> Visible( Meshlets.size() );
+        CullMeshlets( View, BoundsSoA, 0, Meshlets.size(), &Visible[0], nullptr );
+        uWrong += CountWronglyCulledTriangles( View, Visible, IndexOffsets, Indices, Scene.MeshletPositions, Scene.MeshletStrides );
+
+        printf( "    %-13s %7u   %7u   %7u   %9u (%5.1f%%)   %8.1f us   %8.1f us\n", szPose,
+                Stats.uVisible, Stats.uFrustumCulled, Stats.uConeCulled, Stats.uTrianglesVisible,
+                100.0 * (double)Stats.uTrianglesVisible / (double)Stats.uTriangles, fSeconds[0] * 1e6, fSeconds[1] * 1e6 );
+
+        Total.Add( Stats );
+        fTotalSingle += fSeconds[0];
+        fTotalMulti += fSeconds[1];
+    }
+
+    printf( "    %-13s %7u   %7u   %7u   %9u (%5.1f%%)   %8.1f us   %8.1f us\n", "average",
+            Total.uVisible / uPoses, Total.uFrustumCulled / uPoses, Total.uConeCulled / uPoses, Total.uTrianglesVisible / uPoses,
+            100.0 * (double)Total.uTrianglesVisible / (double)Total.uTriangles, fTotalSingle * 1e6 / uPoses, fTotalMulti * 1e6 / uPoses );
+
+    if ( uWrong > 0 )
+    {
+        printf( "Error: %u front-facing triangles inside the frustum were culled\n", (unsigned int)uWrong );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// DepthBoundsTest11's light and camera setup, so the benchmark processes the same lights
+// from the same views as the sample's -benchmark mode
+//--------------------------------------------------------------------------------------
+static const unsigned int BENCHMARK_SAMPLE_LIGHTS = 150;
+static const float BENCHMARK_LIGHT_MAX_RANGE = 40.0f;
+static const float BENCHMARK_LIGHT_MAX_INTENSITY = 0.25f;
+static const float BENCHMARK_NEAR_PLANE = 1.0f;
+static const float BENCHMARK_FAR_PLANE = 10000.0f;
+static const float BENCHMARK_FOV = 3.14159265f / 4.0f;
+static const float BENCHMARK_FRAME_TIME = 1.0f / 60.0f;     // Camera path time per frame
+static const unsigned int BENCHMARK_TILE_SIZE = 32;         // Pixels per screen tile for binning
+
+
+//--------------------------------------------------------------------------------------
+// Parses a comma separated list of light counts
+//--------------------------------------------------------------------------------------
+static bool ParseLightCounts( const char* szList, std::vector<unsigned int>& Counts )
+{
+    Counts.clear();
+    while ( *szList )
+    {
+        char* pEnd;
+        const unsigned long uCount = strtoul( szList, &pEnd, 10 );
+        if ( pEnd == szList || uCount == 0 || ( *pEnd != ',' && *pEnd != 0 ) )
+        {
+            return false;
+        }
+        Counts.push_back( (unsigned int)uCount );
+        szList = ( *pEnd == ',' ) ? pEnd + 1 : pEnd;
+    }
+    return !Counts.empty();
+}
+
+
+//--------------------------------------------------------------------------------------
+static std::wstring ToWide( const char* szText )
+{
+    std::wstring Result;
+    for ( ; *szText; szText++ )
+    {
+        Result += (wchar_t)(unsigned char)*szText;
+    }
+    return Result;
+}
+
+
+//--------------------------------------------------------------------------------------
+static double MillisecondsSince( const std::chrono::high_resolution_clock::time_point& StartTime )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - StartTime ).count();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Replays a camera path through the sample's scene for each light count and runs the CPU
+// work of a frame: light processing, light and meshlet culling, and binning the lights
+// into screen tiles. Counters depend only on the mesh, the path and the seed, so they
+// can be compared between runs and against the sample; times are per stage.
+//--------------------------------------------------------------------------------------
+static bool RunBenchmark( const SDKMeshFile& Mesh, const char* szMeshFileName, const BenchmarkOptions& Options )
+{
+    // Lights are placed in the meshes' bounding boxes, as the sample does
+    std::vector<float> MeshCenters, MeshExtents;
+    for ( UINT iMesh = 0; iMesh < Mesh.GetNumMeshes(); iMesh++ )
+    {
+        const SDKMESH_MESH* pMesh = Mesh.GetMesh( iMesh );
+        MeshCenters.insert( MeshCenters.end(), pMesh->BoundingBoxCenter, pMesh->BoundingBoxCenter + 3 );
+        MeshExtents.insert( MeshExtents.end(), pMesh->BoundingBoxExtents, pMesh->BoundingBoxExtents + 3 );
+    }
+
+    float fCenter[3], fExtents[3];
+    GetPointLightVolume( MeshCenters.empty() ? NULL : &MeshCenters[0], MeshExtents.empty() ? NULL : &MeshExtents[0],
+                         Mesh.GetNumMeshes(), fCenter, fExtents );
+
+    // Generating the sample's full set first keeps the lights the same as in the sample for any count
+    unsigned int uMaxLights = BENCHMARK_SAMPLE_LIGHTS;
+    for ( size_t i = 0; i < Options.LightCounts.size(); i++ )
+    {
+        uMaxLights = ( Options.LightCounts[i] > uMaxLights ) ? Options.LightCounts[i] : uMaxLights;
+    }
+    std::vector<PointLight> Lights( uMaxLights );
+    GeneratePointLights( &Lights[0], uMaxLights, Options.uSeed, fCenter, fExtents, BENCHMARK_LIGHT_MAX_RANGE, BENCHMARK_LIGHT_MAX_INTENSITY );
+
+    CameraPath Path;
+    if ( Options.szPath )
+    {
+        if ( !Path.Load( ToWide( Options.szPath ).c_str() ) )
+        {
+            printf( "Failed to load camera path %s\n", Options.szPath );
+            return false;
+        }
+    }
+    else
+    {
+        Path.SetOrbit( fCenter, fExtents, (float)Options.uFrames * BENCHMARK_FRAME_TIME );
+    }
+
+    SceneMeshlets Scene;
+    BuildSceneMeshlets( Mesh, Scene );
+    MeshletBoundsSoA BoundsSoA;
+    if ( !Scene.Bounds.empty() )
+    {
+        BoundsSoA.Build( &Scene.Bounds[0], Scene.Bounds.size() );
+    }
+    MeshletCuller Culler( Options.uThreads );
+    std::vector<unsigned int> DstIndices( Scene.Indices.size() + 1 );
+    std::vector<unsigned int> DstOffsets( Scene.Meshlets.size() + 1 );
+
+    const unsigned int uTilesX = ( Options.uWidth + BENCHMARK_TILE_SIZE - 1 ) / BENCHMARK_TILE_SIZE;
+    const unsigned int uTilesY = ( Options.uHeight + BENCHMARK_TILE_SIZE - 1 ) / BENCHMARK_TILE_SIZE;
+    std::vector<unsigned int> TileCounts( uTilesX * uTilesY );
+    std::vector<unsigned char> Visible( uMaxLights );
+
+    printf( "%u meshlets, light volume (%.1f %.1f %.1f) +/- (%.1f %.1f %.1f), %u path keys over %.1f s, %u frames per run\n",
+            (unsigned int)Scene.Meshlets.size(), fCenter[0], fCenter[1], fCenter[2], fExtents[0], fExtents[1], fExtents[2],
+            (unsigned int)Path.GetKeyCount(), Path.GetDuration(), Options.uFrames );
+
+    BenchmarkReport Report;
+    wchar_t szText[64];
+    Report.SetInfo( L"mesh", ToWide( szMeshFileName ).c_str() );
+    Report.SetInfo( L"path", Options.szPath ? ToWide( Options.szPath ).c_str() : L"orbit" );
+    swprintf( szText, 64, L"%u", Options.uSeed );
+    Report.SetInfo( L"seed", szText );
+    swprintf( szText, 64, L"%ux%u", Options.uWidth, Options.uHeight );
+    Report.SetInfo( L"resolution", szText );
+    Report.SetInfo( L"device", L"none" );
+
+    printf( "    lights   in frustum   depth bounds   tiles per light   max per tile   meshlets   process   cull lights   bin   cull meshlets (ms)\n" );
+
+    const float fUp[3] = { 0.0f, 1.0f, 0.0f };
+    const float fAspect = (float)Options.uWidth / (float)Options.uHeight;
+    float fProjection[16];
+    BuildPerspectiveMatrix( fProjection, BENCHMARK_FOV, fAspect, BENCHMARK_NEAR_PLANE, BENCHMARK_FAR_PLANE );
+
+    for ( size_t uRun = 0; uRun < Options.LightCounts.size(); uRun++ )
+    {
+        const unsigned int uLights = Options.LightCounts[uRun];
+        swprintf( szText, 64, L"lights=%u", uLights );
+        Report.BeginRun( szText );
+        Report.SetRunParameter( L"lights", uLights );
+
+        for ( unsigned int uFrame = 0; uFrame < Options.uFrames; uFrame++ )
+        {
+            CameraKey Key;
+            Path.Evaluate( (float)uFrame * BENCHMARK_FRAME_TIME, Key );
+            const float* fEye = Key.fEye;
+            const float* fAt = Key.fAt;
+
+            // A recorded projection replaces the sample's, the aspect ratio stays the screen's
+            float fNearClip = BENCHMARK_NEAR_PLANE;
+            if ( Key.HasProjection() )
+            {
+                fNearClip = Key.fNearClip;
+                BuildPerspectiveMatrix( fProjection, Key.fFovY, fAspect, Key.fNearClip, Key.fFarClip );
+            }
+
+            float fView[16], fViewProjection[16];
+            BuildLookAtMatrix( fView, fEye, fAt, fUp );
+            MultiplyMatrix( fViewProjection, fView, fProjection );
+
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            ProcessPointLights( &Lights[0], uLights, fView, fProjection, fNearClip );
+            const double fProcessMs = MillisecondsSince( StartTime );
+
+            // Frustum culling and depth bounds, as for the sample's depth bounds test path
+            StartTime = std::chrono::high_resolution_clock::now();
+            float fPlanes[6][4];
+            ExtractFrustumPlanes( fPlanes, fViewProjection );
+            float fViewDirection[3] = { fEye[0] - fAt[0], fEye[1] - fAt[1], fEye[2] - fAt[2] };
+            const float fLength = sqrtf( fViewDirection[0] * fViewDirection[0] + fViewDirection[1] * fViewDirection[1] + fViewDirection[2] * fViewDirection[2] );
+            for ( int k = 0; k < 3; k++ )
+            {
+                fViewDirection[k] /= fLength;
+            }
+            unsigned int uInFrustum = 0, uDepthBounds = 0;
+            for ( unsigned int i = 0; i < uLights; i++ )
+            {
+                Visible[i] = PointLightInFrustum( Lights[i], fPlanes ) ? 1 : 0;
+                if ( Visible[i] )
+                {
+                    float fNear, fFar;
+                    GetPointLightDepthBounds( Lights[i], fViewDirection, fViewProjection, &fNear, &fFar );
+                    uInFrustum++;
+                    uDepthBounds += ( fFar > fNear ) ? 1 : 0;
+                }
+            }
+            const double fCullMs = MillisecondsSince( StartTime );
+
+            StartTime = std::chrono::high_resolution_clock::now();
+            PointLightTileStatistics TileStats;
+            BinPointLights( &Lights[0], &Visible[0], uLights, uTilesX, uTilesY, &TileCounts[0], &TileStats );
+            const double fBinMs = MillisecondsSince( StartTime );
+
+            StartTime = std::chrono::high_resolution_clock::now();
+            MeshletCullStatistics MeshletStats;
+            if ( !Scene.Meshlets.empty() )
+            {
+                MeshletCullView View;
+                SetupMeshletCullView( &View, fViewProjection, fEye );
+                Culler.CullAndCompact( View, BoundsSoA, &Scene.IndexOffsets[0], &Scene.Indices[0], &DstIndices[0], &DstOffsets[0], &MeshletStats );
+            }
+            const double fMeshletMs = MillisecondsSince( StartTime );
+
+            Report.BeginFrame();
+            Report.SetValue( L"cpu/Process Lights", fProcessMs );
+            Report.SetValue( L"cpu/Cull Lights", fCullMs );
+            Report.SetValue( L"cpu/Bin Lights", fBinMs );
+            Report.SetValue( L"cpu/Cull Meshlets", fMeshletMs );
+            Report.SetValue( L"lights in frustum", uInFrustum );
+            Report.SetValue( L"depth bounds ranges", uDepthBounds );
+            Report.SetValue( L"light tiles", TileStats.uTileLights );
+            Report.SetValue( L"occupied tiles", TileStats.uOccupiedTiles );
+            Report.SetValue( L"max lights per tile", TileStats.uMaxTileLights );
+            Report.SetValue( L"meshlets visible", MeshletStats.uVisible );
+            Report.SetValue( L"triangles visible", MeshletStats.uTrianglesVisible );
+        }
+
+        BenchmarkSummary InFrustum, DepthBounds, TileLights, MaxTile, Meshlets, Process, Cull, Bin, CullMeshlets;
+        Report.GetSummary( uRun, L"lights in frustum", InFrustum );
+        Report.GetSummary( uRun, L"depth bounds ranges", DepthBounds );
+        Report.GetSummary( uRun, L"light tiles", TileLights );
+        Report.GetSummary( uRun, L"max lights per tile", MaxTile );
+        Report.GetSummary( uRun, L"meshlets visible", Meshlets );
+        Report.GetSummary( uRun, L"cpu/Process Lights", Process );
+        Report.GetSummary( uRun, L"cpu/Cull Lights", Cull );
+        Report.GetSummary( uRun, L"cpu/Bin Lights", Bin );
+        Report.GetSummary( uRun, L"cpu/Cull Meshlets", CullMeshlets );
+
+        printf( "    %6u   %10.1f   %12.1f   %15.1f   %12.0f   %8.0f   %7.4f   %11.4f   %.4f   %13.4f\n", uLights,
+                InFrustum.fMean, DepthBounds.fMean, ( InFrustum.fMean > 0.0 ) ? TileLights.fMean / InFrustum.fMean : 0.0,
+                MaxTile.fMax, Meshlets.fMean, Process.fMean, Cull.fMean, Bin.fMean, CullMeshlets.fMean );
+    }
+
+    bool bWritten = true;
+    if ( Options.szCsv && !Report.WriteCsv( ToWide( Options.szCsv ).c_str() ) )
+    {
+        printf( "Failed to write %s\n", Options.szCsv );
+        bWritten = false;
+    }
+    if ( Options.szJson && !Report.WriteJson( ToWide( Options.szJson ).c_str() ) )
+    {
+        printf( "Failed to write %s\n", Options.szJson );
+        bWritten = false;
+    }
+
+    return bWritten;
+}
+
+
+//--------------------------------------------------------------------------------------
+static float Distance( const float* a, const float* b )
+{
+    const float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    return sqrtf( Dot( d, d ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Evaluates a path once per frame at a fixed frame rate, as the sample's replay does
+//--------------------------------------------------------------------------------------
+static bool ResamplePath( const char* szInput, const PathOptions& Options )
+{
+    CameraPath Path;
+    if ( !Path.Load( ToWide( szInput ).c_str() ) )
+    {
+        printf( "Failed to load the camera path %s\n", szInput );
+        return false;
+    }
+
+    printf( "%s: %u keys over %.2f s, %s projection\n", szInput, (unsigned int)Path.GetKeyCount(), Path.GetDuration(),
+            Path.HasProjection() ? "with" : "without" );
+
+    const unsigned int uFrames = (unsigned int)floorf( Path.GetDuration() * Options.fFrameRate ) + 1;
+    CameraPath Frames;
+    CameraKey Previous = {};
+    float fEyeTravel = 0.0f;
+    float fMaxEyeStep = 0.0f;
+    float fMaxAtStep = 0.0f;
+    for ( unsigned int i = 0; i < uFrames; i++ )
+    {
+        CameraKey Key;
+        Path.Evaluate( (float)i / Options.fFrameRate, Key );
+        Frames.AddKey( Key );
+
+        if ( i > 0 )
+        {
+            const float fEyeStep = Distance( Key.fEye, Previous.fEye );
+            fEyeTravel += fEyeStep;
+            fMaxEyeStep = std::max( fMaxEyeStep, fEyeStep );
+            fMaxAtStep = std::max( fMaxAtStep, Distance( Key.fAt, Previous.fAt ) );
+        }
+        Previous = Key;
+    }
+
+    printf( "%u frames at %.2f fps, eye travels %.2f, largest step per frame %.3f (eye) %.3f (look-at)\n",
+            uFrames, Options.fFrameRate, fEyeTravel, fMaxEyeStep, fMaxAtStep );
+
+    if ( !Options.szOutput )
+    {
+        return true;
+    }
+
+    const std::wstring OutputName = ToWide( Options.szOutput );
+    if ( !Frames.Save( OutputName.c_str(), Options.bText ) )
+    {
+        printf( "Failed to write %s\n", Options.szOutput );
+        return false;
+    }
+
+    // Both forms keep every bit of the keys
+    CameraPath Check;
+    bool bIdentical = Check.Load( OutputName.c_str() ) && Check.GetKeyCount() == Frames.GetKeyCount();
+    for ( size_t i = 0; i < Frames.GetKeyCount() && bIdentical; i++ )
+    {
+        const CameraKey& Written = Frames.GetKey( i );
+        const CameraKey& Read = Check.GetKey( i );
+        bIdentical = Written.fTime == Read.fTime && Distance( Written.fEye, Read.fEye ) == 0.0f && Distance( Written.fAt, Read.fAt ) == 0.0f &&
+                     Written.fFovY == Read.fFovY && Written.fAspect == Read.fAspect &&
+                     Written.fNearClip == Read.fNearClip && Written.fFarClip == Read.fFarClip;
+    }
+
+    printf( "Wrote %u frames to %s, %s\n", uFrames, Options.szOutput, bIdentical ? "reads back identically" : "READS BACK DIFFERENTLY" );
+    return bIdentical;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf( "Usage:\n" );
+    printf( "  SDKMeshTool stats <input.sdkmesh>\n" );
+    printf( "  SDKMeshTool optimize <input.sdkmesh> <output.sdkmesh>\n" );
+    printf( "  SDKMeshTool lod <input.sdkmesh> <output.sdkmesh> [-levels n] [-ratio r] [-error e] [-threads n]\n" );
+    printf( "    -levels   number of levels below full detail (default 3, at most %u)\n", MAX_SUBSET_LODS );
+    printf( "    -ratio    triangles of each level relative to the previous (default 0.5)\n" );
+    printf( "    -error    maximum error relative to the subset bounds (default 0.02)\n" );
+    printf( "    -threads  worker threads (default: all cores)\n" );
+    printf( "  SDKMeshTool meshlets <input.sdkmesh> [-poses n] [-iterations n] [-threads n]\n" );
+    printf( "    -poses       camera poses around the mesh (default 8)\n" );
+    printf( "    -iterations  culls per pose (default 100)\n" );
+    printf( "    -threads     threads for the multithreaded cull (default: all cores)\n" );
+    printf( "  SDKMeshTool benchmark <input.sdkmesh> [-frames n] [-seed n] [-lights n,n,...] [-path file] [-csv file] [-json file]\n" );
+    printf( "                        [-width n] [-height n] [-threads n]\n" );
+    printf( "    -frames   frames per light count (default 600)\n" );
+    printf( "    -seed     light seed (default 1, as in the sample)\n" );
+    printf( "    -lights   light counts to sweep (default 25,50,100,150)\n" );
+    printf( "    -path     camera path file (default: an orbit through the light volume)\n" );
+    printf( "    -csv      write every frame's values to a CSV file\n" );
+    printf( "    -json     write per-run summaries and every frame's values to a JSON file\n" );
+    printf( "    -width    screen width for the aspect ratio and tiles (default 1920)\n" );
+    printf( "    -height   screen height (default 1080)\n" );
+    printf( "    -threads  threads for meshlet culling (default: all cores)\n" );
+    printf( "  SDKMeshTool path <input path> [-fps n] [-out file] [-format binary|text]\n" );
+    printf( "    -fps      playback frame rate (default 60)\n" );
+    printf( "    -out      save one key per frame to a new path file\n" );
+    printf( "    -format   of the new file (default binary)\n" );
+}
+
+
+//--------------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    if ( argc < 3 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    SDKMeshFile Mesh;
+
+    if ( strcmp( argv[1], "stats" ) == 0 && argc == 3 )
+    {
+        if ( !Mesh.Load( argv[2] ) )
+        {
+            return 1;
+        }
+        ProcessMesh( Mesh, false );
+        return 0;
+    }
+
+    if ( strcmp( argv[1], "optimize" ) == 0 && argc == 4 )
+    {
+        if ( !Mesh.Load( argv[2] ) )
+        {
+            return 1;
+        }
+        ProcessMesh( Mesh, true );
+
+        for ( UINT iMesh = 0; iMesh < Mesh.GetNumMeshes(); iMesh++ )
+        {
+            if ( Mesh.GetNumSubsetLODs( iMesh, 0 ) > 0 )
+            {
+                printf( "The LOD chain no longer matches the vertices and was removed, run lod again\n" );
+                break;
+            }
+        }
+
+        return Mesh.Save( argv[3] ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "lod" ) == 0 && argc >= 4 && ( argc % 2 ) == 0 )
+    {
+        LODOptions Options;
+        Options.uLevels = 3;
+        Options.fRatio = 0.5f;
+        Options.fMaxError = 0.02f;
+        Options.uThreads = std::thread::hardware_concurrency();
+
+        for ( int i = 4; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-levels" ) == 0 )        Options.uLevels = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-ratio" ) == 0 )    Options.fRatio = (float)atof( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-error" ) == 0 )    Options.fMaxError = (float)atof( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-threads" ) == 0 )  Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uLevels < 1 || Options.uLevels > MAX_SUBSET_LODS || Options.fRatio <= 0.0f || Options.fRatio >= 1.0f )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uThreads = ( Options.uThreads > 0 ) ? Options.uThreads : 1;
+
+        if ( !Mesh.Load( argv[2] ) )
+        {
+            return 1;
+        }
+        GenerateLODs( Mesh, Options );
+        return Mesh.Save( argv[3] ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "meshlets" ) == 0 && ( argc % 2 ) == 1 )
+    {
+        MeshletOptions Options;
+        Options.uPoses = 8;
+        Options.uIterations = 100;
+        Options.uThreads = 0;
+
+        for ( int i = 3; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-poses" ) == 0 )             Options.uPoses = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-iterations" ) == 0 )   Options.uIterations = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-threads" ) == 0 )      Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uPoses < 1 || Options.uIterations < 1 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        if ( !Mesh.Load( argv[2] ) )
+        {
+            return 1;
+        }
+        BenchmarkMeshlets( Mesh, Options );
+        return 0;
+    }
+
+    if ( strcmp( argv[1], "benchmark" ) == 0 && ( argc % 2 ) == 1 )
+    {
+        BenchmarkOptions Options;
+        Options.uFrames = 600;
+        Options.uSeed = 1;
+        ParseLightCounts( "25,50,100,150", Options.LightCounts );
+        Options.szPath = NULL;
+        Options.szCsv = NULL;
+        Options.szJson = NULL;
+        Options.uWidth = 1920;
+        Options.uHeight = 1080;
+        Options.uThreads = 0;
+
+        bool bValid = true;
+        for ( int i = 3; i < argc && bValid; i += 2 )
+        {
+            if ( strcmp( argv[i], "-frames" ) == 0 )        Options.uFrames = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-seed" ) == 0 )     Options.uSeed = (unsigned int)strtoul( argv[ i + 1 ], NULL, 10 );
+            else if ( strcmp( argv[i], "-lights" ) == 0 )   bValid = ParseLightCounts( argv[ i + 1 ], Options.LightCounts );
+            else if ( strcmp( argv[i], "-path" ) == 0 )     Options.szPath = argv[ i + 1 ];
+            else if ( strcmp( argv[i], "-csv" ) == 0 )      Options.szCsv = argv[ i + 1 ];
+            else if ( strcmp( argv[i], "-json" ) == 0 )     Options.szJson = argv[ i + 1 ];
+            else if ( strcmp( argv[i], "-width" ) == 0 )    Options.uWidth = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-height" ) == 0 )   Options.uHeight = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-threads" ) == 0 )  Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else                                            bValid = false;
+        }
+
+        if ( !bValid || Options.uFrames < 1 || Options.uWidth < 1 || Options.uHeight < 1 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        if ( !Mesh.Load( argv[2] ) )
+        {
+            return 1;
+        }
+        return RunBenchmark( Mesh, argv[2], Options ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "path" ) == 0 && ( argc % 2 ) == 1 )
+    {
+        PathOptions Options;
+        Options.fFrameRate = 60.0f;
+        Options.szOutput = NULL;
+        Options.bText = false;
+
+        bool bValid = true;
+        for ( int i = 3; i < argc && bValid; i += 2 )
+        {
+            if ( strcmp( argv[i], "-fps" ) == 0 )           Options.fFrameRate = (float)atof( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-out" ) == 0 )      Options.szOutput = argv[ i + 1 ];
+            else if ( strcmp( argv[i], "-format" ) == 0 )
+            {
+                Options.bText = strcmp( argv[ i + 1 ], "text" ) == 0;
+                bValid = Options.bText || strcmp( argv[ i + 1 ], "binary" ) == 0;
+            }
+            else                                            bValid = false;
+        }
+
+        if ( !bValid || Options.fFrameRate <= 0.0f || Options.fFrameRate > 10000.0f )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return ResamplePath( argv[2], Options ) ? 0 : 1;
+    }
+
+    PrintUsage();
+    return 1;
+}
@@ -0,0 +1,56 @@
+dofile ("../../../../premake/amd_premake_util.lua")
+
+-- Headless benchmarks for the parts of the ShaderCache in AMD_SDK that have no DirectX
+-- dependency. Builds on Windows and, with e.g. "premake5 gmake", on Linux.
+
+workspace "ShaderCacheTool"
+   configurations { "Debug", "Release" }
+   platforms { "x64" }
+   location "../build"
+   filename ("ShaderCacheTool" .. _AMD_VS_SUFFIX)
+   startproject "ShaderCacheTool"
+
+   filter "platforms:x64"
+      architecture "x64"
+
+   filter { "platforms:x64", "action:vs*" }
+      system "Windows"
+
+project "ShaderCacheTool"
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename ("ShaderCacheTool" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}"
+   warnings "Extra"
+
+   files { "../src/**.h", "../src/**.cpp", "../../../src/ShaderCompileScheduler.h", "../../../src/ShaderCompileScheduler.cpp",
+           "../../../src/ShaderHash.h", "../../../src/ShaderHash.cpp", "../../../src/MappedFile.h", "../../../src/MappedFile.cpp",
+           "../../../src/ShaderArchive.h", "../../../src/ShaderArchive.cpp", "../../../src/ShaderDependencies.h", "../../../src/ShaderDependencies.cpp",
+           "../../../src/ShaderPermutations.h", "../../../src/ShaderPermutations.cpp",
+           "../../../src/ShaderDirectoryWatcher.h", "../../../src/ShaderDirectoryWatcher.cpp",
+           "../../../src/ShaderRemoteCache.h", "../../../src/ShaderRemoteCache.cpp",
+           "../../../src/ShaderCompression.h", "../../../src/ShaderCompression.cpp",
+           "../../../src/ShaderProfile.h", "../../../src/ShaderProfile.cpp" }
+   includedirs { "../../../src" }
+
+   filter "action:vs*"
+      -- Specify WindowsTargetPlatformVersion here for VS2015
+      windowstarget (_AMD_WIN_SDK_VERSION)
+      defines { "WIN32", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS", "_WIN32_WINNT=0x0601" }
+
+   filter "action:not vs*"
+      buildoptions { "-std=c++11", "-pthread" }
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "_DEBUG", "DEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "NDEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
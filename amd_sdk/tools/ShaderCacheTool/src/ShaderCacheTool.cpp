@@ -0,0 +1,3363 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: ShaderCacheTool.cpp
+//
+// Headless benchmarks for the ShaderCache code that has no DirectX dependency.
+//
+//   ShaderCacheTool schedule [-shaders n] [-processes n] [-compile ms] [-slow n] [-cached n] [-first n]
+//   ShaderCacheTool hash [-kb n]
+//   ShaderCacheTool archive [-shaders n] [-kb n]
+//   ShaderCacheTool deps [-shaders n] [-headers n]
+//   ShaderCacheTool perms [-permutations n]
+//   ShaderCacheTool watch [-shaders n] [-headers n]
+//   ShaderCacheTool remote [-shaders n] [-processes n] [-compile ms]
+//   ShaderCacheTool compress [-shaders n] [-kb n] [-threads n]
+//   ShaderCacheTool profile [-shaders n] [-processes n] [-compile ms]
+//
+// schedule measures the start-up time of generating a shader cache with a fake compiler:
+// this tool started again as a process that sleeps for the time the shader asks for and
+// writes its output file. Every shader is preprocessed, hashed and compiled, except that
+// every cached-th one finds its hash unchanged and skips compiling, every slow-th one
+// takes ten times as long to compile, and one shader fails to compile. The jobs are run
+// through the ShaderCompileScheduler that ShaderCache uses, and through batches that wait
+// for their slowest process before starting the next, as ShaderCache did before. Every
+// shader must pass each of its stages once and end up created, or failed for the one.
+// It then takes every first-th shader to be needed by the first frame, and times until
+// these are ready with a cold cache, where every shader compiles, and a warm one, where
+// none does: once with all shaders queued alike, as ShaderCache creates them all before
+// the first frame, and once with the first frame's shaders at a more urgent priority.
+//
+// hash checks ShaderHasher against known XXH64 values and for input split at random, then
+// generates a preprocessed shader of the given size, with #line directives like fxc
+// writes, at two different locations on disk. Both must hash the same, and any edit must
+// change the hash. It prints the time to hash the file through a mapping, as ShaderCache
+// now does, next to reading it line by line and appending to one buffer, as it did before,
+// each at the size given and twice that, and the throughput of the hash alone.
+//
+// archive writes a ShaderArchive of the given number of shaders of about the given size,
+// and the same shaders as object files. It times loading all of them from the object
+// files, which ShaderCache opens twice, to check for and to read them, next to mapping
+// the archive and finding each shader in it. It then replaces some shaders at a time,
+// checking every shader's data each time, until the archive has been compacted, undoes
+// the header of an update to stand in for a crash in the middle of one, and damages the
+// index, which must make the archive fail to open.
+//
+// deps runs ScanShaderIncludes over a list of tricky sources, then builds a few shaders
+// on disk whose includes are nested, found next to the source rather than the including
+// file, named with .., and circular. It checks which shaders a ShaderDependencyGraph
+// finds changed after editing, touching, adding and deleting files, and after saving and
+// loading the graph. Last it creates the given number of shaders, each including some of
+// the given number of headers, and times checking them all with a loaded graph, which
+// only looks files up, next to reading every file each shader includes, which is the
+// least the preprocessor would do.
+//
+// perms checks how ShaderOptions packs values into keys, including options that don't
+// fit, and finding, growing and clearing a ShaderPermutationTable. It then adds the given
+// number of permutations of a shader with two dozen options, and prints the memory they
+// take next to what a ShaderCache::Shader per permutation takes, and the time to look
+// them up in the table next to a std::map.
+//
+// watch checks that ShaderChangeDebouncer waits for the window after the last change,
+// merges changes to a file and keeps changes handed back. It then watches a directory
+// with a ShaderDirectoryWatcher, saves a file as an editor does, through a temporary file,
+// which must be reported once, hands a change back, which must be reported again, and
+// writes a file in a new directory, which must be reported too. The changes reported are
+// checked with a ShaderDependencyGraph, which must look up only those files. Last it
+// creates the given number of shaders, each including some of the given number of
+// headers, edits a header and times a full check next to checking only that header.
+//
+// remote starts a ShaderRemoteCacheServer on a free loopback port, checks getting and
+// putting blobs, from two clients, and that a client stops asking once the server is gone
+// and asks again when it is set again. It then generates the shaders with the fake
+// compiler as schedule does: without a server, with one that is empty and filled as
+// shaders compile, from a second client that finds all but the failing shader there, and
+// with the server stopped. It prints the times and each client's hits and misses.
+//
+// compress round-trips data of awkward sizes and kinds through ShaderCompress, checks
+// that the wrong size, a truncated blob and too little room fail, and decompresses random
+// bytes, which must stay in bounds. It then writes the given number of stand-in shaders
+// of about the given size to a raw and a compressed archive, and prints their sizes and
+// the time to load every shader from each, on one thread and on the given number. On
+// Linux it drops the archives from the file cache to time a cold load from this disk; for
+// other disks it adds the time to read each archive at the disk's rate.
+//
+// profile checks the order in which a ShaderStartupProfile reports stages and shaders,
+// that times added for no shader, from many threads at once, or after the end are dealt
+// with, and the report file. It prints what timing a stage costs, then generates the
+// shaders with the fake compiler as schedule does, every eighth compiling ten times as
+// long and every third cached, profiled as ShaderCache profiles them. The slow ones that
+// compile must be the slowest shaders in the report, which it prints and writes to
+// ShaderStartupProfile.txt.
+//--------------------------------------------------------------------------------------
+#include "ShaderCompileScheduler.h"
+#include "ShaderHash.h"
+#include "MappedFile.h"
+#include "ShaderArchive.h"
+#include "ShaderDependencies.h"
+#include "ShaderPermutations.h"
+#include "ShaderDirectoryWatcher.h"
+#include "ShaderRemoteCache.h"
+#include "ShaderCompression.h"
+#include "ShaderProfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <wchar.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <map>
+#include <set>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+using namespace AMD;
+
+// Settings for the schedule command
+struct ScheduleOptions
+{
+    unsigned int    uShaders;
+    unsigned int    uProcesses;
+    unsigned int    uCompileMs;
+    unsigned int    uSlowEvery;     // Every n-th shader compiles ten times as long, 0 for none
+    unsigned int    uCachedEvery;   // Every n-th shader skips compiling, 0 for none
+    unsigned int    uFirstEvery;    // Every n-th shader is needed by the first frame
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static const unsigned int PREPROCESS_MS = 5;
+
+// Path of this executable, which is also the fake compiler
+static wchar_t g_szToolPath[1024];
+
+
+//--------------------------------------------------------------------------------------
+static double ElapsedSeconds( Clock::time_point Start )
+{
+    return std::chrono::duration<double>( Clock::now() - Start ).count();
+}
+
+
+//--------------------------------------------------------------------------------------
+static std::wstring Widen( const std::string& Text )
+{
+    return std::wstring( Text.begin(), Text.end() );
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool FindToolPath( const char* szArgv0 )
+{
+#ifdef _WIN32
+    (void)szArgv0;
+    return GetModuleFileNameW( NULL, g_szToolPath, sizeof( g_szToolPath ) / sizeof( g_szToolPath[0] ) ) > 0;
+#else
+    char szPath[1024];
+    ssize_t iLength = readlink( "/proc/self/exe", szPath, sizeof( szPath ) - 1 );
+    if ( iLength > 0 )
+    {
+        szPath[iLength] = '\0';
+    }
+    else
+    {
+        strncpy( szPath, szArgv0, sizeof( szPath ) - 1 );
+        szPath[ sizeof( szPath ) - 1 ] = '\0';
+    }
+    return mbstowcs( g_szToolPath, szPath, sizeof( g_szToolPath ) / sizeof( g_szToolPath[0] ) ) != (size_t)-1;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// The fake compiler: sleeps, then writes the output file, or fails without it
+//--------------------------------------------------------------------------------------
+static int RunFakeCompiler( unsigned int uMs, const char* szOutput, bool bFail )
+{
+    std::this_thread::sleep_for( std::chrono::milliseconds( uMs ) );
+
+    if ( bFail )
+    {
+        return 1;
+    }
+
+    FILE* pFile = fopen( szOutput, "wb" );
+    if ( !pFile )
+    {
+        return 1;
+    }
+    fprintf( pFile, "%s\n", szOutput );
+    fclose( pFile );
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs the stages of fake shaders like ShaderCache runs those of real ones
+//--------------------------------------------------------------------------------------
+class FakeShaderClient : public ShaderJobClient
+{
+public:
+
+    struct Shader
+    {
+        unsigned int        uIndex;
+        unsigned int        uCompileMs;
+        bool                bCached;
+        bool                bFails;
+        unsigned int        uRuns[SHADER_JOB_STAGE_COUNT];
+        SHADER_JOB_STAGE    eLast;
+        bool                bFirstFrame;
+        bool                bFetched;       // From the cache server, so not compiled
+        double              fDoneSeconds;   // Since the client was made, once done or failed
+        unsigned long long  uProcessStart;  // Of its fake compiler, for the startup profile
+    };
+
+    FakeShaderClient( const ScheduleOptions& Options )
+        : m_Start( Clock::now() )
+        , m_pRemoteCache( NULL )
+        , m_pProfile( NULL )
+    {
+        m_Shaders.resize( Options.uShaders );
+        for ( unsigned int i = 0; i < Options.uShaders; i++ )
+        {
+            Shader& S = m_Shaders[i];
+            memset( &S, 0, sizeof( S ) );
+            S.uIndex = i;
+            S.uCompileMs = Options.uCompileMs;
+            if ( Options.uSlowEvery > 0 && ( i % Options.uSlowEvery ) == Options.uSlowEvery / 2 )
+            {
+                S.uCompileMs *= 10;
+            }
+            S.bCached = Options.uCachedEvery > 0 && ( i % Options.uCachedEvery ) == 0;
+            S.bFirstFrame = Options.uFirstEvery > 0 && ( i % Options.uFirstEvery ) == Options.uFirstEvery - 1;
+            S.eLast = SHADER_JOB_PREPROCESS;
+        }
+
+        // The first shader from the middle on that is compiled fails
+        for ( unsigned int i = Options.uShaders / 2; i < Options.uShaders; i++ )
+        {
+            if ( !m_Shaders[i].bCached )
+            {
+                m_Shaders[i].bFails = true;
+                break;
+            }
+        }
+    }
+
+    ~FakeShaderClient()
+    {
+        for ( size_t i = 0; i < m_Shaders.size(); i++ )
+        {
+            remove( GetFileName( m_Shaders[i], SHADER_JOB_PREPROCESS ).c_str() );
+            remove( GetFileName( m_Shaders[i], SHADER_JOB_COMPILE ).c_str() );
+        }
+    }
+
+    Shader& GetShader( size_t i ) { return m_Shaders[i]; }
+    size_t GetShaderCount() const { return m_Shaders.size(); }
+
+    // Asks the cache server for shaders before compiling them, and hands it those compiled
+    void SetRemoteCache( ShaderRemoteCacheClient* pRemoteCache ) { m_pRemoteCache = pRemoteCache; }
+
+    // Times the stages of every shader as ShaderCache does, the shader's index being its own
+    void SetProfile( ShaderStartupProfile* pProfile ) { m_pProfile = pProfile; }
+
+    virtual bool StartStage( void* pJob, SHADER_JOB_STAGE eStage, ShaderProcess& Process )
+    {
+        Shader& S = *(Shader*)pJob;
+
+        if ( eStage != SHADER_JOB_PREPROCESS && eStage != SHADER_JOB_COMPILE )
+        {
+            return true;
+        }
+
+        const std::string Output = GetFileName( S, eStage );
+        remove( Output.c_str() );
+
+        wchar_t szCommandLine[1024];
+        swprintf( szCommandLine, sizeof( szCommandLine ) / sizeof( szCommandLine[0] ), L"fakefxc %u \"%hs\"%ls",
+            ( eStage == SHADER_JOB_PREPROCESS ) ? PREPROCESS_MS : S.uCompileMs, Output.c_str(),
+            ( eStage == SHADER_JOB_COMPILE && S.bFails ) ? L" -fail" : L"" );
+
+        const unsigned long long uSpawnStart = ShaderStartupProfile::GetTime();
+        const bool bStarted = ShaderProcessPlatform::GetDefault().Start( g_szToolPath, szCommandLine, Process );
+        AddTime( S, SHADER_PROFILE_SPAWN, uSpawnStart );
+
+        S.uProcessStart = ShaderStartupProfile::GetTime();
+        return bStarted;
+    }
+
+    virtual SHADER_JOB_STAGE FinishStage( void* pJob, SHADER_JOB_STAGE eStage, bool bStarted )
+    {
+        Shader& S = *(Shader*)pJob;
+
+        S.uRuns[eStage]++;
+        S.eLast = eStage;
+
+        if ( bStarted && ( eStage == SHADER_JOB_PREPROCESS || eStage == SHADER_JOB_COMPILE ) )
+        {
+            AddTime( S, ( eStage == SHADER_JOB_PREPROCESS ) ? SHADER_PROFILE_PREPROCESS : SHADER_PROFILE_COMPILE, S.uProcessStart );
+        }
+
+        const unsigned long long uStart = ShaderStartupProfile::GetTime();
+        SHADER_JOB_STAGE eNext = SHADER_JOB_FAILED;
+        switch ( eStage )
+        {
+        case SHADER_JOB_PREPROCESS:
+            eNext = ( bStarted && HasOutput( S, eStage ) ) ? SHADER_JOB_HASH : SHADER_JOB_FAILED;
+            AddTime( S, SHADER_PROFILE_DISK, uStart );
+            break;
+        case SHADER_JOB_HASH:
+            if ( m_pProfile )
+            {
+                // As ShaderCache hashes the preprocessed source
+                (void)GetRemoteKey( S );
+                AddTime( S, SHADER_PROFILE_HASH, uStart );
+            }
+            eNext = S.bCached ? SHADER_JOB_CREATE : SHADER_JOB_COMPILE;
+            if ( eNext == SHADER_JOB_COMPILE && FetchOutput( S ) )
+            {
+                S.bFetched = true;
+                eNext = SHADER_JOB_CREATE;
+            }
+            break;
+        case SHADER_JOB_COMPILE:
+            eNext = ( bStarted && HasOutput( S, eStage ) ) ? SHADER_JOB_CREATE : SHADER_JOB_FAILED;
+            if ( eNext == SHADER_JOB_CREATE )
+            {
+                StoreOutput( S );
+            }
+            AddTime( S, SHADER_PROFILE_DISK, uStart );
+            break;
+        case SHADER_JOB_CREATE:
+            eNext = SHADER_JOB_DONE;
+            break;
+        default:
+            break;
+        }
+
+        if ( eNext == SHADER_JOB_DONE || eNext == SHADER_JOB_FAILED )
+        {
+            S.fDoneSeconds = ElapsedSeconds( m_Start );
+        }
+        return eNext;
+    }
+
+    // Until every shader of the first frame was done or failed
+    double GetFirstFrameSeconds() const
+    {
+        double fSeconds = 0.0;
+        for ( size_t i = 0; i < m_Shaders.size(); i++ )
+        {
+            if ( m_Shaders[i].bFirstFrame && m_Shaders[i].fDoneSeconds > fSeconds )
+            {
+                fSeconds = m_Shaders[i].fDoneSeconds;
+            }
+        }
+        return fSeconds;
+    }
+
+    // Checks that every shader ran each of its stages once, and ended where it should
+    bool Check( const char* szName )
+    {
+        bool bOk = true;
+
+        for ( size_t i = 0; i < m_Shaders.size(); i++ )
+        {
+            const Shader& S = m_Shaders[i];
+            const unsigned int uExpected[SHADER_JOB_STAGE_COUNT] =
+            {
+                1, 1, ( S.bCached || S.bFetched ) ? 0u : 1u, S.bFails ? 0u : 1u, 0, 0
+            };
+            const SHADER_JOB_STAGE eLast = S.bFails ? SHADER_JOB_COMPILE : SHADER_JOB_CREATE;
+
+            if ( memcmp( S.uRuns, uExpected, sizeof( uExpected ) ) != 0 || S.eLast != eLast )
+            {
+                printf( "Error: %s: shader %u ran preprocess %u, hash %u, compile %u, create %u times\n", szName, S.uIndex,
+                    S.uRuns[SHADER_JOB_PREPROCESS], S.uRuns[SHADER_JOB_HASH], S.uRuns[SHADER_JOB_COMPILE], S.uRuns[SHADER_JOB_CREATE] );
+                bOk = false;
+            }
+        }
+
+        return bOk;
+    }
+
+private:
+
+    void AddTime( const Shader& S, SHADER_PROFILE_STAGE eStage, unsigned long long uStart )
+    {
+        if ( m_pProfile )
+        {
+            m_pProfile->AddTime( S.uIndex, eStage, uStart );
+        }
+    }
+
+    static std::string GetFileName( const Shader& S, SHADER_JOB_STAGE eStage )
+    {
+        char szName[64];
+        snprintf( szName, sizeof( szName ), "ShaderCacheTool_%u.%s", S.uIndex, ( eStage == SHADER_JOB_PREPROCESS ) ? "i" : "o" );
+        return szName;
+    }
+
+    static bool HasOutput( const Shader& S, SHADER_JOB_STAGE eStage )
+    {
+        FILE* pFile = fopen( GetFileName( S, eStage ).c_str(), "rb" );
+        if ( pFile )
+        {
+            fclose( pFile );
+            return true;
+        }
+        return false;
+    }
+
+    // As ShaderCache keys shaders on the server: by the hash of the preprocessed source
+    static unsigned long long GetRemoteKey( const Shader& S )
+    {
+        MappedFile File;
+        const unsigned long long uKey = File.Open( Widen( GetFileName( S, SHADER_JOB_PREPROCESS ) ).c_str() ) ? ShaderHasher::Hash( File.GetData(), File.GetSize() ) : 0;
+        return uKey ? uKey : 1;
+    }
+
+    bool FetchOutput( const Shader& S )
+    {
+        std::vector<char> Blob;
+        if ( !m_pRemoteCache || !m_pRemoteCache->IsEnabled() || !m_pRemoteCache->Get( GetRemoteKey( S ), Blob ) )
+        {
+            return false;
+        }
+        return WriteOutput( S, Blob );
+    }
+
+    void StoreOutput( const Shader& S )
+    {
+        if ( !m_pRemoteCache || !m_pRemoteCache->IsEnabled() )
+        {
+            return;
+        }
+
+        MappedFile File;
+        if ( File.Open( Widen( GetFileName( S, SHADER_JOB_COMPILE ) ).c_str() ) )
+        {
+            m_pRemoteCache->Put( GetRemoteKey( S ), File.GetData(), File.GetSize() );
+        }
+    }
+
+    static bool WriteOutput( const Shader& S, const std::vector<char>& Blob )
+    {
+        FILE* pFile = fopen( GetFileName( S, SHADER_JOB_COMPILE ).c_str(), "wb" );
+        if ( !pFile )
+        {
+            return false;
+        }
+        const bool bOk = Blob.empty() || fwrite( &Blob[0], 1, Blob.size(), pFile ) == Blob.size();
+        fclose( pFile );
+        return bOk;
+    }
+
+    Clock::time_point           m_Start;
+    std::vector<Shader>         m_Shaders;
+    ShaderRemoteCacheClient*    m_pRemoteCache;
+    ShaderStartupProfile*       m_pProfile;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Runs the stages of a shader that need no process, returns the stage it stops at
+//--------------------------------------------------------------------------------------
+static SHADER_JOB_STAGE RunInPlace( FakeShaderClient& Client, FakeShaderClient::Shader* pShader, SHADER_JOB_STAGE eStage )
+{
+    while ( eStage == SHADER_JOB_HASH || eStage == SHADER_JOB_CREATE )
+    {
+        ShaderProcess Process = 0;
+        const bool bStarted = Client.StartStage( pShader, eStage, Process );
+        eStage = Client.FinishStage( pShader, eStage, bStarted );
+    }
+    return eStage;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The scheme ShaderCache used before the scheduler: start a batch of processes, wait for
+// all of them, then start the next batch. Every shader is preprocessed before the first
+// one is compiled.
+//--------------------------------------------------------------------------------------
+static double RunBatches( FakeShaderClient& Client, unsigned int uProcesses, double& fFirstDoneSeconds )
+{
+    ShaderProcessPlatform& Platform = ShaderProcessPlatform::GetDefault();
+    Clock::time_point Start = Clock::now();
+    fFirstDoneSeconds = 0.0;
+
+    std::vector<FakeShaderClient::Shader*> Pending;
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        Pending.push_back( &Client.GetShader( i ) );
+    }
+
+    const SHADER_JOB_STAGE eStages[] = { SHADER_JOB_PREPROCESS, SHADER_JOB_COMPILE };
+    for ( unsigned int uStage = 0; uStage < 2; uStage++ )
+    {
+        std::vector<FakeShaderClient::Shader*> Next;
+
+        for ( size_t uFirst = 0; uFirst < Pending.size(); uFirst += uProcesses )
+        {
+            const size_t uEnd = ( Pending.size() < uFirst + uProcesses ) ? Pending.size() : uFirst + uProcesses;
+
+            std::vector<ShaderProcess> Processes;
+            std::vector<FakeShaderClient::Shader*> Running;
+            std::vector<FakeShaderClient::Shader*> Finished;
+
+            for ( size_t i = uFirst; i < uEnd; i++ )
+            {
+                ShaderProcess Process = 0;
+                if ( Client.StartStage( Pending[i], eStages[uStage], Process ) && Process != 0 )
+                {
+                    Processes.push_back( Process );
+                    Running.push_back( Pending[i] );
+                }
+                else
+                {
+                    Client.FinishStage( Pending[i], eStages[uStage], false );
+                }
+            }
+
+            // The barrier
+            while ( !Processes.empty() )
+            {
+                int iExited = Platform.WaitAny( &Processes[0], (unsigned int)Processes.size(), SHADER_WAIT_INFINITE );
+                if ( iExited < 0 )
+                {
+                    break;
+                }
+                Platform.Close( Processes[iExited] );
+                Finished.push_back( Running[iExited] );
+                Processes.erase( Processes.begin() + iExited );
+                Running.erase( Running.begin() + iExited );
+            }
+
+            // Hash and hand over as the batch ends
+            for ( size_t i = 0; i < Finished.size(); i++ )
+            {
+                SHADER_JOB_STAGE eNext = RunInPlace( Client, Finished[i], Client.FinishStage( Finished[i], eStages[uStage], true ) );
+                if ( eNext == SHADER_JOB_COMPILE )
+                {
+                    Next.push_back( Finished[i] );
+                }
+                else if ( eNext == SHADER_JOB_DONE && fFirstDoneSeconds == 0.0 )
+                {
+                    fFirstDoneSeconds = ElapsedSeconds( Start );
+                }
+            }
+        }
+
+        Pending.swap( Next );
+    }
+
+    return ElapsedSeconds( Start );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Streams the shaders, those of the first frame more urgent than the rest if bPrioritize.
+// Returns the time until the first frame's shaders were ready, and until all were.
+//--------------------------------------------------------------------------------------
+static bool RunFirstFrame( const ScheduleOptions& Options, bool bPrioritize, double& fFirstFrameSeconds, double& fTotalSeconds )
+{
+    FakeShaderClient Client( Options );
+    ShaderCompileScheduler Scheduler( Client, ShaderProcessPlatform::GetDefault() );
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        FakeShaderClient::Shader& S = Client.GetShader( i );
+        Scheduler.AddJob( &S, SHADER_JOB_PREPROCESS, ( bPrioritize && !S.bFirstFrame ) ? 1 : 0 );
+    }
+
+    bool bSuccess = Scheduler.Run( Options.uProcesses );
+    bSuccess &= Client.Check( bPrioritize ? "prioritized" : "unprioritized" );
+
+    const ShaderSchedulerStats& Stats = Scheduler.GetStats();
+    fFirstFrameSeconds = Client.GetFirstFrameSeconds();
+    fTotalSeconds = Stats.fTotalSeconds;
+
+    // Without priorities every job is of the most urgent one
+    const double fUrgentSeconds = bPrioritize ? fFirstFrameSeconds : fTotalSeconds;
+    if ( Stats.fUrgentDoneSeconds <= 0.0 || fabs( Stats.fUrgentDoneSeconds - fUrgentSeconds ) > 0.005 )
+    {
+        printf( "Error: the scheduler had the urgent jobs done after %.3f s, expected %.3f s\n", Stats.fUrgentDoneSeconds, fUrgentSeconds );
+        bSuccess = false;
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkSchedule( const ScheduleOptions& Options )
+{
+    bool bSuccess = true;
+
+    printf( "%u shaders, %u processes, compiling for %u ms (%u ms for every %u-th), every %u-th cached\n",
+        Options.uShaders, Options.uProcesses, Options.uCompileMs, Options.uCompileMs * 10, Options.uSlowEvery, Options.uCachedEvery );
+
+    // Lower bound: all process time spread evenly over the processes
+    {
+        FakeShaderClient Client( Options );
+        double fWork = 0.0;
+        for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+        {
+            const FakeShaderClient::Shader& S = Client.GetShader( i );
+            fWork += PREPROCESS_MS + ( S.bCached ? 0 : S.uCompileMs );
+        }
+        printf( "  ideal:            %7.3f s\n", fWork / 1000.0 / Options.uProcesses );
+    }
+
+    double fBatchSeconds = 0.0;
+    {
+        FakeShaderClient Client( Options );
+        double fFirstDone = 0.0;
+        fBatchSeconds = RunBatches( Client, Options.uProcesses, fFirstDone );
+        printf( "  batches:          %7.3f s, first shader ready after %.3f s\n", fBatchSeconds, fFirstDone );
+        bSuccess &= Client.Check( "batches" );
+    }
+
+    double fStreamSeconds = 0.0;
+    {
+        FakeShaderClient Client( Options );
+        ShaderCompileScheduler Scheduler( Client, ShaderProcessPlatform::GetDefault() );
+        for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+        {
+            Scheduler.AddJob( &Client.GetShader( i ) );
+        }
+
+        if ( !Scheduler.Run( Options.uProcesses ) )
+        {
+            printf( "Error: the scheduler stopped early\n" );
+            bSuccess = false;
+        }
+
+        const ShaderSchedulerStats& Stats = Scheduler.GetStats();
+        fStreamSeconds = Stats.fTotalSeconds;
+        printf( "  streaming:        %7.3f s, first shader ready after %.3f s, %.2fx faster\n", fStreamSeconds, Stats.fFirstDoneSeconds, fBatchSeconds / fStreamSeconds );
+        printf( "    preprocess:     %5u runs, %7.3f s\n", Stats.uStageRuns[SHADER_JOB_PREPROCESS], Stats.fStageSeconds[SHADER_JOB_PREPROCESS] );
+        printf( "    hash:           %5u runs, %7.3f s\n", Stats.uStageRuns[SHADER_JOB_HASH], Stats.fStageSeconds[SHADER_JOB_HASH] );
+        printf( "    compile:        %5u runs, %7.3f s\n", Stats.uStageRuns[SHADER_JOB_COMPILE], Stats.fStageSeconds[SHADER_JOB_COMPILE] );
+        printf( "    create:         %5u runs\n", Stats.uStageRuns[SHADER_JOB_CREATE] );
+        printf( "    done %u, failed %u, at most %u processes at once\n", Stats.uDone, Stats.uFailed, Stats.uMaxRunning );
+
+        bSuccess &= Client.Check( "streaming" );
+
+        unsigned int uFailed = 0;
+        for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+        {
+            uFailed += Client.GetShader( i ).bFails ? 1 : 0;
+        }
+        if ( Stats.uDone + Stats.uFailed != Options.uShaders || Stats.uFailed != uFailed )
+        {
+            printf( "Error: %u shaders done and %u failed, expected %u failed\n", Stats.uDone, Stats.uFailed, uFailed );
+            bSuccess = false;
+        }
+        if ( Stats.uMaxRunning > Options.uProcesses )
+        {
+            printf( "Error: %u processes ran at once\n", Stats.uMaxRunning );
+            bSuccess = false;
+        }
+    }
+
+    // Eagerly the first frame waits for every shader, lazily only for its own
+    if ( Options.uFirstEvery > 0 )
+    {
+        printf( "  first frame, needing every %u-th shader:\n", Options.uFirstEvery );
+
+        const char* szCaches[] = { "cold", "warm" };
+        for ( unsigned int uWarm = 0; uWarm < 2; uWarm++ )
+        {
+            ScheduleOptions CacheOptions = Options;
+            CacheOptions.uCachedEvery = uWarm;
+
+            double fEager = 0.0;
+            double fLazy = 0.0;
+            double fPrioritized = 0.0;
+            double fTotal = 0.0;
+            bSuccess &= RunFirstFrame( CacheOptions, false, fLazy, fEager );
+            bSuccess &= RunFirstFrame( CacheOptions, true, fPrioritized, fTotal );
+
+            printf( "    %s: eager %7.3f s, lazy %7.3f s, lazy with priority %7.3f s, %.2fx sooner, all shaders after %.3f s\n",
+                szCaches[uWarm], fEager, fLazy, fPrioritized, fEager / fPrioritized, fTotal );
+        }
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writes a preprocessed shader of about 100 bytes per line, with its includes under
+// szDirectory
+//--------------------------------------------------------------------------------------
+static std::string MakePreprocessedShader( size_t uLines, const char* szDirectory )
+{
+    static const char* szIncludes[] = { "Common.hlsl", "Lighting.hlsl", "GBuffer.hlsl", "Shadows.hlsl" };
+    std::string Source;
+    char szLine[512];
+
+    for ( unsigned int uLine = 0; uLine < uLines; uLine++ )
+    {
+        if ( ( uLine % 12 ) == 0 )
+        {
+            snprintf( szLine, sizeof( szLine ), "#line %u \"%s%s\"\n", uLine, szDirectory, szIncludes[ ( uLine / 12 ) % 4 ] );
+        }
+        else
+        {
+            snprintf( szLine, sizeof( szLine ), "    float4 vColor%u = g_txDiffuse.Sample( g_Sampler, Input.vTexCoord * %u.0f ) * g_vLightColor[%u];\n", uLine, uLine % 7, uLine % 16 );
+        }
+        Source += szLine;
+    }
+
+    return Source;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool WriteFile( const char* szFileName, const std::string& Data )
+{
+    FILE* pFile = fopen( szFileName, "wb" );
+    if ( !pFile )
+    {
+        return false;
+    }
+    const bool bOk = fwrite( Data.data(), 1, Data.size(), pFile ) == Data.size();
+    fclose( pFile );
+    return bOk;
+}
+
+
+//--------------------------------------------------------------------------------------
+// What ShaderCache did before: read line by line, append the lines to keep to one buffer,
+// then hash the buffer
+//--------------------------------------------------------------------------------------
+static unsigned long long HashByLines( const char* szFileName )
+{
+    FILE* pFile = fopen( szFileName, "rt" );
+    if ( !pFile )
+    {
+        return 0;
+    }
+
+    fseek( pFile, 0, SEEK_END );
+    const long iFileSize = ftell( pFile );
+    rewind( pFile );
+
+    char* pBuffer = new char[ iFileSize + 1 ];
+    memset( pBuffer, 0, iFileSize + 1 );
+
+    char szLine[2048];
+    while ( fgets( szLine, sizeof( szLine ), pFile ) )
+    {
+        if ( !strstr( szLine, "#line" ) )
+        {
+            strcat( pBuffer, szLine );
+        }
+    }
+    fclose( pFile );
+
+    const unsigned long long uHash = ShaderHasher::Hash( pBuffer, strlen( pBuffer ) );
+    delete [] pBuffer;
+    return uHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+static unsigned long long HashMapped( const wchar_t* szFileName )
+{
+    MappedFile File;
+    if ( !File.Open( szFileName ) )
+    {
+        return 0;
+    }
+
+    ShaderHasher Hasher;
+    HashPreprocessedSource( File.GetData(), File.GetSize(), Hasher );
+    return Hasher.Digest();
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkHash( unsigned int uKB )
+{
+    bool bSuccess = true;
+
+    // Known XXH64 values
+    struct Vector { const char* pData; size_t uSize; unsigned long long uSeed; unsigned long long uHash; };
+    unsigned char Bytes[1024];
+    for ( unsigned int i = 0; i < sizeof( Bytes ); i++ )
+    {
+        Bytes[i] = (unsigned char)i;
+    }
+    const Vector Vectors[] =
+    {
+        { "", 0, 0, 0xEF46DB3751D8E999ULL },
+        { "abc", 3, 0, 0x44BC2CF5AD770999ULL },
+        { "The quick brown fox jumps over the lazy dog", 43, 0, 0x0B242D361FDA71BCULL },
+        { (const char*)Bytes, sizeof( Bytes ), 2654435761ULL, 0xB05AF54D5F68BFF7ULL },
+    };
+    for ( unsigned int i = 0; i < sizeof( Vectors ) / sizeof( Vectors[0] ); i++ )
+    {
+        const unsigned long long uHash = ShaderHasher::Hash( Vectors[i].pData, Vectors[i].uSize, Vectors[i].uSeed );
+        if ( uHash != Vectors[i].uHash )
+        {
+            printf( "Error: XXH64 of test %u is %016llx, expected %016llx\n", i, uHash, Vectors[i].uHash );
+            bSuccess = false;
+        }
+    }
+
+    // Input split at random
+    {
+        std::mt19937 Random( 7 );
+        std::vector<unsigned char> Data( 100000 );
+        for ( size_t i = 0; i < Data.size(); i++ )
+        {
+            Data[i] = (unsigned char)Random();
+        }
+        const unsigned long long uWhole = ShaderHasher::Hash( &Data[0], Data.size() );
+
+        for ( unsigned int uRun = 0; uRun < 100; uRun++ )
+        {
+            ShaderHasher Hasher;
+            for ( size_t i = 0; i < Data.size(); )
+            {
+                const size_t uSize = std::min<size_t>( Random() % 100, Data.size() - i );
+                Hasher.Update( &Data[i], uSize );
+                i += uSize;
+            }
+            if ( Hasher.Digest() != uWhole )
+            {
+                printf( "Error: hashing in pieces gives %016llx, at once %016llx\n", Hasher.Digest(), uWhole );
+                bSuccess = false;
+                break;
+            }
+        }
+    }
+
+    // The same shader at two locations, and edited
+    const size_t uLines = (size_t)uKB * 1024 / 100;
+    const std::string Original = MakePreprocessedShader( uLines, "C:\\Projects\\Sample\\AMD_SDK\\src\\Shaders\\" );
+    const std::string Moved = MakePreprocessedShader( uLines, "D:/Moved/Elsewhere/Shaders/" );
+    std::string Edited = Original;
+    Edited[ Edited.size() / 2 ] ^= 1;
+
+    {
+        ShaderHasher A, B, C;
+        HashPreprocessedSource( Original.data(), Original.size(), A );
+        HashPreprocessedSource( Moved.data(), Moved.size(), B );
+        HashPreprocessedSource( Edited.data(), Edited.size(), C );
+
+        if ( A.Digest() != B.Digest() )
+        {
+            printf( "Error: moving the shader's includes changes its hash\n" );
+            bSuccess = false;
+        }
+        if ( A.Digest() == C.Digest() )
+        {
+            printf( "Error: editing the shader doesn't change its hash\n" );
+            bSuccess = false;
+        }
+    }
+
+    printf( "preprocessed shader of %u KB, %u lines\n", (unsigned int)( Original.size() / 1024 ), (unsigned int)uLines );
+
+    for ( unsigned int uScale = 1; uScale <= 2; uScale++ )
+    {
+        const std::string Source = MakePreprocessedShader( uLines * uScale, "C:\\Projects\\Sample\\AMD_SDK\\src\\Shaders\\" );
+        if ( !WriteFile( "ShaderCacheTool_hash.i", Source ) )
+        {
+            printf( "Error: can't write ShaderCacheTool_hash.i\n" );
+            return false;
+        }
+
+        // Warm the file cache, then take the best of a few runs
+        unsigned long long uChecksum = HashMapped( L"ShaderCacheTool_hash.i" );
+        double fMapped = 1e9;
+        for ( unsigned int uRun = 0; uRun < 5; uRun++ )
+        {
+            Clock::time_point Start = Clock::now();
+            uChecksum ^= HashMapped( L"ShaderCacheTool_hash.i" );
+            fMapped = std::min( fMapped, ElapsedSeconds( Start ) );
+        }
+
+        Clock::time_point Start = Clock::now();
+        uChecksum ^= HashByLines( "ShaderCacheTool_hash.i" );
+        const double fLines = ElapsedSeconds( Start );
+
+        printf( "  %5u KB: mapped %8.3f ms, by lines %9.3f ms, %6.0fx faster (checksum %02llx)\n", (unsigned int)( Source.size() / 1024 ), fMapped * 1e3, fLines * 1e3, fLines / fMapped, uChecksum & 0xFF );
+
+        if ( uChecksum == 0 )
+        {
+            printf( "Error: can't read ShaderCacheTool_hash.i\n" );
+            bSuccess = false;
+        }
+    }
+    remove( "ShaderCacheTool_hash.i" );
+
+    // The hash alone
+    {
+        std::vector<unsigned char> Data( 64 << 20, 0x5A );
+        unsigned long long uSum = 0;
+        double fBest = 1e9;
+        for ( unsigned int uRun = 0; uRun < 5; uRun++ )
+        {
+            Clock::time_point Start = Clock::now();
+            uSum += ShaderHasher::Hash( &Data[0], Data.size(), uRun );
+            fBest = std::min( fBest, ElapsedSeconds( Start ) );
+        }
+        printf( "  hash:        %6.2f GB/s (checksum %02llx)\n", Data.size() / fBest / 1e9, uSum & 0xFF );
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data of a shader for the archive command, different for each version of it
+//--------------------------------------------------------------------------------------
+static std::vector<char> MakeObject( unsigned int uShader, unsigned int uVersion, unsigned int uKB )
+{
+    std::mt19937 Random( uShader * 7919 + uVersion );
+    std::vector<char> Data( uKB * 512 + Random() % ( uKB * 1024 ) + 1 );
+    for ( size_t i = 0; i < Data.size(); i++ )
+    {
+        Data[i] = (char)Random();
+    }
+    return Data;
+}
+
+
+//--------------------------------------------------------------------------------------
+static unsigned long long ShaderKey( unsigned int uShader )
+{
+    return ShaderHasher::Hash( &uShader, sizeof( uShader ), 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Checks that the archive holds the expected version of every shader
+//--------------------------------------------------------------------------------------
+static bool CheckArchive( const ShaderArchive& Archive, const std::vector<unsigned int>& Versions, unsigned int uKB, const char* szWhen )
+{
+    if ( Archive.GetEntryCount() != Versions.size() )
+    {
+        printf( "Error: %s, the archive holds %u shaders, expected %u\n", szWhen, (unsigned int)Archive.GetEntryCount(), (unsigned int)Versions.size() );
+        return false;
+    }
+
+    for ( unsigned int i = 0; i < Versions.size(); i++ )
+    {
+        const std::vector<char> Expected = MakeObject( i, Versions[i], uKB );
+        const ShaderArchiveEntry* pEntry = Archive.Find( ShaderKey( i ) );
+
+        if ( !pEntry || pEntry->uContentHash != Versions[i] || pEntry->uSize != Expected.size() ||
+             memcmp( Archive.GetData( *pEntry ), &Expected[0], Expected.size() ) != 0 )
+        {
+            printf( "Error: %s, shader %u doesn't hold version %u\n", szWhen, i, Versions[i] );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static std::vector<char> ReadWholeFile( const char* szFileName )
+{
+    std::vector<char> Data;
+    FILE* pFile = fopen( szFileName, "rb" );
+    if ( pFile )
+    {
+        fseek( pFile, 0, SEEK_END );
+        Data.resize( ftell( pFile ) );
+        rewind( pFile );
+        if ( !Data.empty() && fread( &Data[0], 1, Data.size(), pFile ) != Data.size() )
+        {
+            Data.clear();
+        }
+        fclose( pFile );
+    }
+    return Data;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkArchive( unsigned int uShaders, unsigned int uKB )
+{
+    const wchar_t* szArchive = L"ShaderCacheTool_archive.sca";
+    bool bSuccess = true;
+
+    std::vector<unsigned int> Versions( uShaders, 1 );
+    std::vector< std::vector<char> > Objects( uShaders );
+    std::vector<ShaderArchiveBlob> Blobs( uShaders );
+    unsigned long long uTotalBytes = 0;
+
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        Objects[i] = MakeObject( i, Versions[i], uKB );
+        ShaderArchiveBlob Blob = { ShaderKey( i ), Versions[i], &Objects[i][0], Objects[i].size() };
+        Blobs[i] = Blob;
+        uTotalBytes += Objects[i].size();
+
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_archive_%u.obj", i );
+        if ( !WriteFile( szFileName, std::string( Objects[i].begin(), Objects[i].end() ) ) )
+        {
+            printf( "Error: can't write %s\n", szFileName );
+            return false;
+        }
+    }
+
+    ShaderArchive Archive;
+    RemoveFile( szArchive );
+    Archive.Open( szArchive );
+    if ( !Archive.Update( &Blobs[0], Blobs.size() ) )
+    {
+        printf( "Error: can't write the archive\n" );
+        bSuccess = false;
+    }
+    bSuccess = bSuccess && CheckArchive( Archive, Versions, uKB, "after writing it" );
+    Archive.Close();
+
+    printf( "%u shaders, %.1f MB\n", uShaders, uTotalBytes / ( 1024.0 * 1024.0 ) );
+
+    // Loading, with the files in the file cache; best of a few runs
+    double fFiles = 1e9;
+    double fArchive = 1e9;
+    unsigned long long uChecksum = 0;
+    for ( unsigned int uRun = 0; uRun < 3; uRun++ )
+    {
+        Clock::time_point Start = Clock::now();
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            char szFileName[64];
+            snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_archive_%u.obj", i );
+
+            // Checked for when generating, then read when creating
+            FILE* pFile = fopen( szFileName, "rb" );
+            if ( pFile )
+            {
+                fseek( pFile, 0, SEEK_END );
+                uChecksum += ftell( pFile );
+                fclose( pFile );
+            }
+            const std::vector<char> Data = ReadWholeFile( szFileName );
+            uChecksum += Data.empty() ? 0 : (unsigned char)Data[ Data.size() / 2 ];
+        }
+        fFiles = std::min( fFiles, ElapsedSeconds( Start ) );
+
+        Start = Clock::now();
+        ShaderArchive Loaded;
+        Loaded.Open( szArchive );
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            const ShaderArchiveEntry* pEntry = Loaded.Find( ShaderKey( i ) );
+            if ( pEntry )
+            {
+                uChecksum += pEntry->uSize + ( (const unsigned char*)Loaded.GetData( *pEntry ) )[ pEntry->uSize / 2 ];
+            }
+        }
+        fArchive = std::min( fArchive, ElapsedSeconds( Start ) );
+    }
+    printf( "  load: object files %8.2f ms, archive %8.2f ms, %.0fx faster (checksum %02llx)\n", fFiles * 1e3, fArchive * 1e3, fFiles / fArchive, uChecksum & 0xFF );
+
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_archive_%u.obj", i );
+        remove( szFileName );
+    }
+
+    // Replace a tenth of the shaders at a time, until the archive is compacted
+    bSuccess = bSuccess && Archive.Open( szArchive );
+    std::mt19937 Random( 11 );
+    size_t uLargestSize = Archive.GetFileSize();
+    unsigned int uAppends = 0;
+    bool bCompacted = false;
+
+    for ( unsigned int uUpdate = 0; bSuccess && !bCompacted && uUpdate < 100; uUpdate++ )
+    {
+        Blobs.clear();
+        for ( unsigned int j = 0; j < ( uShaders + 9 ) / 10; j++ )
+        {
+            const unsigned int i = Random() % uShaders;
+            Objects[i] = MakeObject( i, ++Versions[i], uKB );
+            ShaderArchiveBlob Blob = { ShaderKey( i ), Versions[i], &Objects[i][0], Objects[i].size() };
+            Blobs.push_back( Blob );
+        }
+
+        if ( !Archive.Update( &Blobs[0], Blobs.size() ) )
+        {
+            printf( "Error: can't update the archive\n" );
+            bSuccess = false;
+        }
+        bSuccess = bSuccess && CheckArchive( Archive, Versions, uKB, "after an update" );
+
+        if ( Archive.GetFileSize() < uLargestSize )
+        {
+            bCompacted = true;
+        }
+        else
+        {
+            uLargestSize = Archive.GetFileSize();
+            uAppends++;
+        }
+    }
+    if ( bSuccess && !bCompacted )
+    {
+        printf( "Error: the archive was never compacted\n" );
+        bSuccess = false;
+    }
+    printf( "  update: %u appends, growing to %.1f MB, then compacted to %.1f MB\n", uAppends, uLargestSize / ( 1024.0 * 1024.0 ), Archive.GetFileSize() / ( 1024.0 * 1024.0 ) );
+
+    // An update interrupted before its header was written
+    if ( bSuccess )
+    {
+        Archive.Close();
+        std::vector<char> Header = ReadWholeFile( "ShaderCacheTool_archive.sca" );
+        Header.resize( 32 );
+        bSuccess = Archive.Open( szArchive );
+
+        const std::vector<unsigned int> OldVersions = Versions;
+        const unsigned int i = uShaders / 2;
+        Objects[i] = MakeObject( i, ++Versions[i], uKB );
+        ShaderArchiveBlob Blob = { ShaderKey( i ), Versions[i], &Objects[i][0], Objects[i].size() };
+        bSuccess = bSuccess && Archive.Update( &Blob, 1 );
+        Archive.Close();
+
+        FILE* pFile = OpenFileStream( szArchive, "r+b" );
+        bSuccess = bSuccess && pFile && fwrite( &Header[0], 1, Header.size(), pFile ) == Header.size();
+        if ( pFile )
+        {
+            fclose( pFile );
+        }
+
+        if ( !bSuccess || !Archive.Open( szArchive ) )
+        {
+            printf( "Error: the archive doesn't open after an interrupted update\n" );
+            bSuccess = false;
+        }
+        bSuccess = bSuccess && CheckArchive( Archive, OldVersions, uKB, "after an interrupted update" );
+
+        // And the next update goes on from there
+        bSuccess = bSuccess && Archive.Update( &Blob, 1 );
+        bSuccess = bSuccess && CheckArchive( Archive, Versions, uKB, "after updating an interrupted archive" );
+    }
+
+    // A damaged index
+    if ( bSuccess )
+    {
+        Archive.Close();
+        std::vector<char> Data = ReadWholeFile( "ShaderCacheTool_archive.sca" );
+        Data[ Data.size() - 1 ] ^= 1;
+        WriteFile( "ShaderCacheTool_archive.sca", std::string( Data.begin(), Data.end() ) );
+
+        if ( Archive.Open( szArchive ) || Archive.GetEntryCount() != 0 )
+        {
+            printf( "Error: an archive with a damaged index opens\n" );
+            bSuccess = false;
+        }
+    }
+
+    Archive.Remove();
+    if ( bSuccess )
+    {
+        printf( "  interrupted update and damaged index: ok\n" );
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void MakeDirectory( const char* szDirectory )
+{
+#ifdef _WIN32
+    _mkdir( szDirectory );
+#else
+    mkdir( szDirectory, 0777 );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+static void RemoveEmptyDirectory( const char* szDirectory )
+{
+#ifdef _WIN32
+    _rmdir( szDirectory );
+#else
+    rmdir( szDirectory );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckIncludeScanner()
+{
+    struct Case { const char* szSource; const char* szIncludes; };
+    static const Case Cases[] =
+    {
+        { "#include \"a.hlsl\"\n",                          "a.hlsl" },
+        { "  #  include <b.h>",                             "b.h" },
+        { "// #include \"c\"\n",                            "" },
+        { "/* #include \"d\" */",                           "" },
+        { "/*\n#include \"e\"\n*/",                         "" },
+        { "s = \"\\\"#include \\\"f\\\"\";",                "" },
+        { "#define X 1 // \\\n#include \"g\"\n",            "" },
+        { "#include \\\n \"h\"\n",                          "h" },
+        { "/* c */ #include \"i\"",                         "i" },
+        { "x = 1; #include \"j\"",                          "" },
+        { "#if 0\n#include \"k\"\n#endif\n",                "k" },
+        { "#include \"l\"\r\n#include \"m\"\r\n",           "l m" },
+        { "#includex \"n\"\n",                              "" },
+        { "#include \"unterminated\n#include \"o\"\n",      "o" },
+        { "c = '\"';\n#include \"p\"\n",                    "p" },
+        { "#include MACRO\n#include \"q\"",                 "q" },
+        { "#pragma once\n\t#include\t\"dir/r.hlsl\"",       "dir/r.hlsl" },
+    };
+
+    bool bSuccess = true;
+    for ( unsigned int i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        std::vector<std::string> Includes;
+        ScanShaderIncludes( Cases[i].szSource, strlen( Cases[i].szSource ), Includes );
+
+        std::string Found;
+        for ( size_t j = 0; j < Includes.size(); j++ )
+        {
+            Found += ( j ? " " : "" ) + Includes[j];
+        }
+
+        if ( Found != Cases[i].szIncludes )
+        {
+            printf( "Error: includes of case %u are \"%s\", expected \"%s\"\n", i, Found.c_str(), Cases[i].szIncludes );
+            bSuccess = false;
+        }
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Which of the shaders changed since the hashes given, checking with the graph
+//--------------------------------------------------------------------------------------
+static std::string ChangedShaders( ShaderDependencyGraph& Graph, const char* szShaders, std::vector<unsigned long long>& Hashes )
+{
+    std::string Changed;
+    Graph.BeginCheck();
+
+    for ( unsigned int i = 0; szShaders[i]; i++ )
+    {
+        const std::string FileName = std::string( "ShaderCacheTool_deps/" ) + szShaders[i] + ".hlsl";
+        const unsigned long long uHash = Graph.GetDependencyHash( Widen( FileName ).c_str(), 1 );
+
+        if ( !Graph.IsTargetUpToDate( i, uHash ) )
+        {
+            Changed += szShaders[i];
+        }
+        Graph.SetTarget( i, uHash );
+
+        if ( i < Hashes.size() )
+        {
+            Hashes[i] = uHash;
+        }
+    }
+
+    return Changed;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckGraph( const char* szStep, ShaderDependencyGraph& Graph, const char* szExpected, int iFilesRead = -1 )
+{
+    std::vector<unsigned long long> Hashes;
+    const std::string Changed = ChangedShaders( Graph, "ABC", Hashes );
+
+    if ( Changed != szExpected || ( iFilesRead >= 0 && Graph.GetFilesRead() != (unsigned int)iFilesRead ) )
+    {
+        printf( "Error: %s, shaders \"%s\" changed with %u files read, expected \"%s\"", szStep, Changed.c_str(), Graph.GetFilesRead(), szExpected );
+        if ( iFilesRead >= 0 )
+        {
+            printf( " with %d", iFilesRead );
+        }
+        printf( "\n" );
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkDependencies( unsigned int uShaders, unsigned int uHeaders )
+{
+    bool bSuccess = CheckIncludeScanner();
+
+    MakeDirectory( "ShaderCacheTool_deps" );
+    MakeDirectory( "ShaderCacheTool_deps/Inc" );
+
+    // A includes Inc/Common, which includes Lighting next to it, which includes Shared,
+    // found next to A. B includes Shared and Other. C and Cycle include each other.
+    const char* Files[][2] =
+    {
+        { "ShaderCacheTool_deps/A.hlsl",            "#include \"Inc/Common.hlsl\"\nfloat4 A() { return Common(); }\n" },
+        { "ShaderCacheTool_deps/Inc/Common.hlsl",   "#include \"Lighting.hlsl\"\nfloat4 Common() { return Lighting(); }\n" },
+        { "ShaderCacheTool_deps/Inc/Lighting.hlsl", "#include \"Shared.h\"\nfloat4 Lighting() { return SHARED; }\n" },
+        { "ShaderCacheTool_deps/Shared.h",          "#define SHARED float4( 1, 1, 1, 1 )\n" },
+        { "ShaderCacheTool_deps/B.hlsl",            "#include \"Shared.h\"\n#include \"Inc/../Other.hlsl\"\n" },
+        { "ShaderCacheTool_deps/Other.hlsl",        "float4 Other() { return SHARED; }\n" },
+        { "ShaderCacheTool_deps/C.hlsl",            "#pragma once\n#include \"Cycle.hlsl\"\n" },
+        { "ShaderCacheTool_deps/Cycle.hlsl",        "#pragma once\n#include \"C.hlsl\"\n" },
+    };
+    const unsigned int uFiles = sizeof( Files ) / sizeof( Files[0] );
+    for ( unsigned int i = 0; i < uFiles; i++ )
+    {
+        bSuccess = WriteFile( Files[i][0], Files[i][1] ) && bSuccess;
+    }
+
+    const std::wstring GraphFile = L"ShaderCacheTool_deps/Graph.sdg";
+    {
+        ShaderDependencyGraph Graph;
+        bSuccess = CheckGraph( "at first", Graph, "ABC", uFiles ) && bSuccess;
+        bSuccess = CheckGraph( "checking again", Graph, "", 0 ) && bSuccess;
+        if ( !Graph.Save( GraphFile.c_str() ) )
+        {
+            printf( "Error: can't save the graph\n" );
+            bSuccess = false;
+        }
+    }
+
+    ShaderDependencyGraph Graph;
+    if ( !Graph.Load( GraphFile.c_str() ) )
+    {
+        printf( "Error: can't load the graph\n" );
+        bSuccess = false;
+    }
+    bSuccess = CheckGraph( "after loading", Graph, "", 0 ) && bSuccess;
+    if ( Graph.GetFilesLookedUp() != uFiles )
+    {
+        printf( "Error: %u files looked up, expected %u\n", Graph.GetFilesLookedUp(), uFiles );
+        bSuccess = false;
+    }
+
+    WriteFile( "ShaderCacheTool_deps/Inc/Lighting.hlsl", "#include \"Shared.h\"\nfloat4 Lighting() { return SHARED * 2; }\n" );
+    bSuccess = CheckGraph( "after editing Lighting", Graph, "A", 1 ) && bSuccess;
+
+    WriteFile( Files[3][0], Files[3][1] );
+    bSuccess = CheckGraph( "after touching Shared", Graph, "" ) && bSuccess;
+
+    WriteFile( "ShaderCacheTool_deps/Other.hlsl", "#include \"New.hlsl\"\nfloat4 Other() { return SHARED; }\n" );
+    bSuccess = CheckGraph( "after including a missing file in Other", Graph, "B" ) && bSuccess;
+
+    WriteFile( "ShaderCacheTool_deps/New.hlsl", "float4 New() { return 0; }\n" );
+    bSuccess = CheckGraph( "after adding the missing file", Graph, "B" ) && bSuccess;
+
+    WriteFile( "ShaderCacheTool_deps/Cycle.hlsl", "#pragma once\n#include \"C.hlsl\"\n// Edited\n" );
+    bSuccess = CheckGraph( "after editing Cycle", Graph, "C" ) && bSuccess;
+
+    remove( Files[3][0] );
+    bSuccess = CheckGraph( "after deleting Shared", Graph, "AB" ) && bSuccess;
+
+    Graph.BeginCheck();
+    if ( Graph.GetDependencyHash( L"ShaderCacheTool_deps/A.hlsl", 1 ) == Graph.GetDependencyHash( L"ShaderCacheTool_deps/A.hlsl", 2 ) )
+    {
+        printf( "Error: the seed doesn't change the dependency hash\n" );
+        bSuccess = false;
+    }
+
+    // A damaged graph
+    {
+        Graph.Save( GraphFile.c_str() );
+        std::vector<char> Data = ReadWholeFile( "ShaderCacheTool_deps/Graph.sdg" );
+        Data[ Data.size() / 2 ] ^= 1;
+        WriteFile( "ShaderCacheTool_deps/Graph.sdg", std::string( Data.begin(), Data.end() ) );
+
+        ShaderDependencyGraph Damaged;
+        if ( Damaged.Load( GraphFile.c_str() ) || !CheckGraph( "with a damaged graph", Damaged, "ABC" ) )
+        {
+            printf( "Error: a damaged graph loads\n" );
+            bSuccess = false;
+        }
+    }
+
+    for ( unsigned int i = 0; i < uFiles; i++ )
+    {
+        remove( Files[i][0] );
+    }
+    remove( "ShaderCacheTool_deps/New.hlsl" );
+    remove( "ShaderCacheTool_deps/Graph.sdg" );
+    RemoveEmptyDirectory( "ShaderCacheTool_deps/Inc" );
+
+    if ( bSuccess )
+    {
+        printf( "include scanner and dependency checks: ok\n" );
+    }
+
+    // Shaders each including a few headers, which include a few more
+    std::mt19937 Random( 3 );
+    std::vector< std::vector<unsigned int> > HeaderIncludes( uHeaders );
+    for ( unsigned int i = 0; i < uHeaders; i++ )
+    {
+        std::string Source = "#pragma once\n";
+        for ( unsigned int j = 0; j < 2 && i + 1 < uHeaders; j++ )
+        {
+            const unsigned int uInclude = i + 1 + Random() % ( uHeaders - i - 1 );
+            char szLine[64];
+            snprintf( szLine, sizeof( szLine ), "#include \"Header%u.hlsl\"\n", uInclude );
+            Source += szLine;
+            HeaderIncludes[i].push_back( uInclude );
+        }
+        Source += MakePreprocessedShader( 200, "" );
+
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_deps/Header%u.hlsl", i );
+        WriteFile( szFileName, Source );
+    }
+
+    std::vector< std::vector<std::string> > ShaderFiles( uShaders );
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        std::string Source;
+        std::vector<unsigned int> Stack;
+        for ( unsigned int j = 0; j < 4; j++ )
+        {
+            const unsigned int uInclude = Random() % uHeaders;
+            char szLine[64];
+            snprintf( szLine, sizeof( szLine ), "#include \"Header%u.hlsl\"\n", uInclude );
+            Source += szLine;
+            Stack.push_back( uInclude );
+        }
+        Source += MakePreprocessedShader( 100, "" );
+
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_deps/Shader%u.hlsl", i );
+        WriteFile( szFileName, Source );
+
+        // Every file the preprocessor opens for the shader
+        std::vector<unsigned char> Seen( uHeaders, 0 );
+        ShaderFiles[i].push_back( szFileName );
+        while ( !Stack.empty() )
+        {
+            const unsigned int uHeader = Stack.back();
+            Stack.pop_back();
+            if ( !Seen[uHeader] )
+            {
+                Seen[uHeader] = 1;
+                snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_deps/Header%u.hlsl", uHeader );
+                ShaderFiles[i].push_back( szFileName );
+                Stack.insert( Stack.end(), HeaderIncludes[uHeader].begin(), HeaderIncludes[uHeader].end() );
+            }
+        }
+    }
+
+    {
+        ShaderDependencyGraph First;
+        First.BeginCheck();
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            First.SetTarget( i, First.GetDependencyHash( Widen( ShaderFiles[i][0] ).c_str(), 1 ) );
+        }
+        First.Save( GraphFile.c_str() );
+    }
+
+    double fChecked = 1e9;
+    double fRead = 1e9;
+    unsigned int uChanged = 0, uLookedUp = 0, uRead = 0;
+    size_t uPreprocessFiles = 0;
+    unsigned long long uChecksum = 0;
+
+    for ( unsigned int uRun = 0; uRun < 3; uRun++ )
+    {
+        Clock::time_point Start = Clock::now();
+        ShaderDependencyGraph Warm;
+        Warm.Load( GraphFile.c_str() );
+        Warm.BeginCheck();
+        uChanged = 0;
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            uChanged += Warm.IsTargetUpToDate( i, Warm.GetDependencyHash( Widen( ShaderFiles[i][0] ).c_str(), 1 ) ) ? 0 : 1;
+        }
+        fChecked = std::min( fChecked, ElapsedSeconds( Start ) );
+        uLookedUp = Warm.GetFilesLookedUp();
+        uRead = Warm.GetFilesRead();
+
+        Start = Clock::now();
+        uPreprocessFiles = 0;
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            for ( size_t j = 0; j < ShaderFiles[i].size(); j++ )
+            {
+                const std::vector<char> Data = ReadWholeFile( ShaderFiles[i][j].c_str() );
+                uChecksum += Data.size();
+                uPreprocessFiles++;
+            }
+        }
+        fRead = std::min( fRead, ElapsedSeconds( Start ) );
+    }
+
+    if ( uChanged != 0 || uRead != 0 )
+    {
+        printf( "Error: %u shaders changed and %u files read without changes\n", uChanged, uRead );
+        bSuccess = false;
+    }
+    printf( "%u shaders including %u headers\n", uShaders, uHeaders );
+    printf( "  warm check: %8.2f ms, %u files looked up, %u read\n", fChecked * 1e3, uLookedUp, uRead );
+    printf( "  reading what the preprocessor would: %8.2f ms, %u files, not counting starting fxc for each shader (checksum %02llx)\n", fRead * 1e3, (unsigned int)uPreprocessFiles, uChecksum & 0xFF );
+
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        remove( ShaderFiles[i][0].c_str() );
+    }
+    for ( unsigned int i = 0; i < uHeaders; i++ )
+    {
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_deps/Header%u.hlsl", i );
+        remove( szFileName );
+    }
+    remove( "ShaderCacheTool_deps/Graph.sdg" );
+    RemoveEmptyDirectory( "ShaderCacheTool_deps" );
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckOptions()
+{
+    bool bSuccess = true;
+
+    ShaderOptions Options;
+    const int iLights = Options.AddOption( L"LIGHTS", 3, -1 );
+    const int iShadows = Options.AddBoolOption( L"SHADOWS" );
+    const int iQuality = Options.AddOption( L"QUALITY", 5, 10 );
+    const int iAlways = Options.AddOption( L"ALWAYS", 1, 7 );
+
+    if ( iLights != 0 || iShadows != 1 || iQuality != 2 || iAlways != 3 || Options.GetKeyBits() != 2 + 1 + 3 || Options.GetPermutationCount() != 3 * 2 * 5 )
+    {
+        printf( "Error: options take %u bits for %llu permutations, expected 6 bits for 30\n", Options.GetKeyBits(), Options.GetPermutationCount() );
+        bSuccess = false;
+    }
+
+    std::set<ShaderPermutationKey> Keys;
+    for ( int iLight = -1; iLight <= 1; iLight++ )
+    {
+        for ( int iShadow = 0; iShadow <= 1; iShadow++ )
+        {
+            for ( int iLevel = 10; iLevel <= 14; iLevel++ )
+            {
+                // Set over a key with other values, which must be replaced
+                ShaderPermutationKey uKey = Options.SetValue( Options.SetValue( 0, iQuality, 14 ), iLights, 1 );
+                uKey = Options.SetValue( uKey, iLights, iLight );
+                uKey = Options.SetValue( uKey, iShadows, iShadow );
+                uKey = Options.SetValue( uKey, iQuality, iLevel );
+                uKey = Options.SetValue( uKey, iAlways, 7 );
+
+                if ( Options.GetValue( uKey, iLights ) != iLight || Options.GetValue( uKey, iShadows ) != iShadow ||
+                    Options.GetValue( uKey, iQuality ) != iLevel || Options.GetValue( uKey, iAlways ) != 7 || !Options.IsValidKey( uKey ) )
+                {
+                    printf( "Error: key %llx doesn't hold LIGHTS=%d SHADOWS=%d QUALITY=%d\n", uKey, iLight, iShadow, iLevel );
+                    bSuccess = false;
+                }
+                Keys.insert( uKey );
+            }
+        }
+    }
+
+    if ( Keys.size() != 30 )
+    {
+        printf( "Error: %u different keys for 30 permutations\n", (unsigned int)Keys.size() );
+        bSuccess = false;
+    }
+
+    // A value past the option's, and a bit past the options
+    if ( Options.IsValidKey( 3 ) || Options.IsValidKey( 7 << 3 ) || Options.IsValidKey( 1 << 6 ) || Options.IsValidKey( ~0ULL ) )
+    {
+        printf( "Error: invalid keys pass\n" );
+        bSuccess = false;
+    }
+
+    // Up to 63 bits
+    ShaderOptions Full;
+    for ( unsigned int i = 0; i < 62; i++ )
+    {
+        wchar_t szName[32];
+        swprintf( szName, sizeof( szName ) / sizeof( szName[0] ), L"FEATURE_%u", i );
+        Full.AddBoolOption( szName );
+    }
+    if ( Full.AddOption( L"TOO_WIDE", 3 ) != -1 || Full.AddBoolOption( L"LAST" ) != 62 || Full.AddBoolOption( L"NO_ROOM" ) != -1 ||
+        Full.AddOption( L"ONE_VALUE", 1 ) != 63 || Full.GetKeyBits() != 63 || Full.GetPermutationCount() != 1ULL << 63 )
+    {
+        printf( "Error: options past 63 bits aren't refused\n" );
+        bSuccess = false;
+    }
+    if ( !Full.IsValidKey( ~0ULL >> 1 ) || Full.IsValidKey( ~0ULL ) )
+    {
+        printf( "Error: keys of 63 bit options are checked wrong\n" );
+        bSuccess = false;
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckPermutationTable()
+{
+    bool bSuccess = true;
+
+    std::mt19937_64 Random( 5 );
+    std::vector<ShaderPermutationKey> Keys;
+    std::set<ShaderPermutationKey> Added;
+    for ( ShaderPermutationKey uKey = 0; uKey < 1000; uKey++ )
+    {
+        Keys.push_back( uKey );
+        Added.insert( uKey );
+    }
+    while ( Keys.size() < 100000 )
+    {
+        const ShaderPermutationKey uKey = Random() >> 1;
+        if ( Added.insert( uKey ).second )
+        {
+            Keys.push_back( uKey );
+        }
+    }
+
+    ShaderPermutationTable Table;
+    for ( unsigned int uPass = 0; uPass < 2; uPass++ )
+    {
+        if ( Table.Find( 0 ) || Table.Find( 12345 ) )
+        {
+            printf( "Error: an empty table finds keys\n" );
+            bSuccess = false;
+        }
+
+        for ( size_t i = 0; i < Keys.size(); i++ )
+        {
+            ShaderPermutationRecord* pRecord = Table.Add( Keys[i], (void*)( i + 1 ) );
+            if ( pRecord->uKey != Keys[i] || pRecord->pObject != (void*)( i + 1 ) )
+            {
+                printf( "Error: adding key %llx returned another record\n", Keys[i] );
+                bSuccess = false;
+                break;
+            }
+        }
+
+        size_t uFound = 0, uSlotsUsed = 0;
+        for ( size_t i = 0; i < Keys.size(); i++ )
+        {
+            const ShaderPermutationRecord* pRecord = Table.Find( Keys[i] );
+            uFound += ( pRecord && pRecord->pObject == (void*)( i + 1 ) ) ? 1 : 0;
+        }
+        for ( size_t i = 0; i < Table.GetSlotCount(); i++ )
+        {
+            uSlotsUsed += Table.GetSlot( i ).pObject ? 1 : 0;
+        }
+
+        size_t uFalse = 0;
+        for ( unsigned int i = 0; i < 100000; i++ )
+        {
+            const ShaderPermutationKey uKey = Random() >> 1;
+            uFalse += ( Table.Find( uKey ) && !Added.count( uKey ) ) ? 1 : 0;
+        }
+
+        if ( uFound != Keys.size() || uSlotsUsed != Keys.size() || Table.GetCount() != Keys.size() || uFalse != 0 ||
+            Table.GetMemoryUsage() > 4 * Keys.size() * sizeof( ShaderPermutationRecord ) )
+        {
+            printf( "Error: of %u keys, %u found, %u in slots, %u counted, %u keys that weren't added found, %u bytes\n", (unsigned int)Keys.size(),
+                (unsigned int)uFound, (unsigned int)uSlotsUsed, (unsigned int)Table.GetCount(), (unsigned int)uFalse, (unsigned int)Table.GetMemoryUsage() );
+            bSuccess = false;
+        }
+
+        Table.Clear();
+        if ( Table.GetCount() != 0 || Table.GetMemoryUsage() != 0 || Table.Find( Keys[0] ) )
+        {
+            printf( "Error: a cleared table isn't empty\n" );
+            bSuccess = false;
+        }
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkPermutations( unsigned int uPermutations )
+{
+    bool bSuccess = CheckOptions();
+    bSuccess = CheckPermutationTable() && bSuccess;
+
+    if ( bSuccess )
+    {
+        printf( "options and permutation table checks: ok\n" );
+    }
+
+    // A shader with two dozen options
+    ShaderOptions Options;
+    Options.AddOption( L"LIGHT_COUNT", 9 );
+    Options.AddOption( L"MSAA_SAMPLES", 8, 1 );
+    Options.AddOption( L"TEXTURE_MODE", 3 );
+    Options.AddOption( L"DEBUG_VIEW", 6 );
+    for ( unsigned int i = 0; i < 20; i++ )
+    {
+        wchar_t szName[32];
+        swprintf( szName, sizeof( szName ) / sizeof( szName[0] ), L"FEATURE_%u", i );
+        Options.AddBoolOption( szName );
+    }
+
+    std::mt19937 Random( 7 );
+    std::vector<ShaderPermutationKey> Keys;
+    std::set<ShaderPermutationKey> Added;
+    while ( Keys.size() < uPermutations )
+    {
+        ShaderPermutationKey uKey = 0;
+        for ( unsigned int i = 0; i < Options.GetOptionCount(); i++ )
+        {
+            uKey = Options.SetValue( uKey, i, Options.GetFirstValue( i ) + (int)( Random() % Options.GetValueCount( i ) ) );
+        }
+        if ( Added.insert( uKey ).second )
+        {
+            Keys.push_back( uKey );
+        }
+    }
+
+    ShaderPermutationTable Table;
+    std::map<ShaderPermutationKey, void*> Map;
+    for ( size_t i = 0; i < Keys.size(); i++ )
+    {
+        Table.Add( Keys[i], (void*)( i + 1 ) );
+        Map[Keys[i]] = (void*)( i + 1 );
+    }
+
+    // Requests in a random order, as a frame's draws would make them
+    std::vector<ShaderPermutationKey> Requests( 1 << 16 );
+    for ( size_t i = 0; i < Requests.size(); i++ )
+    {
+        Requests[i] = Keys[Random() % Keys.size()];
+    }
+
+    const unsigned int uLookups = 10000000;
+    double fTable = 1e9, fMap = 1e9;
+    size_t uChecksum = 0;
+    for ( unsigned int uRun = 0; uRun < 3; uRun++ )
+    {
+        Clock::time_point Start = Clock::now();
+        for ( unsigned int i = 0; i < uLookups; i++ )
+        {
+            uChecksum += (size_t)Table.Find( Requests[i & ( Requests.size() - 1 )] )->pObject;
+        }
+        fTable = std::min( fTable, ElapsedSeconds( Start ) );
+
+        Start = Clock::now();
+        for ( unsigned int i = 0; i < uLookups; i++ )
+        {
+            uChecksum -= (size_t)Map.find( Requests[i & ( Requests.size() - 1 )] )->second;
+        }
+        fMap = std::min( fMap, ElapsedSeconds( Start ) );
+    }
+
+    if ( uChecksum != 0 )
+    {
+        printf( "Error: the table and the map found different permutations\n" );
+        bSuccess = false;
+    }
+
+    // The fixed buffers of a ShaderCache::Shader, in UTF-16 as on Windows: target, entry
+    // point, 13 file names and 3 command lines. AddShader keeps a second Shader per call.
+    const size_t uShaderBytes = ( 16 + 128 + 13 * 256 + 3 * 2048 ) * 2;
+
+    printf( "%u permutations of %u options in %u key bits\n", uPermutations, Options.GetOptionCount(), Options.GetKeyBits() );
+    printf( "  table: %8u bytes, %5.1f per permutation\n", (unsigned int)Table.GetMemoryUsage(), (double)Table.GetMemoryUsage() / uPermutations );
+    printf( "  Shader objects from AddShader: %8u KB, %u bytes per permutation\n", (unsigned int)( uPermutations * uShaderBytes * 2 / 1024 ), (unsigned int)( uShaderBytes * 2 ) );
+    printf( "  lookup: table %6.2f ns, std::map %6.2f ns\n", fTable * 1e9 / uLookups, fMap * 1e9 / uLookups );
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckDebouncer()
+{
+    bool bSuccess = true;
+    ShaderChangeDebouncer Debouncer( 100 );
+    ShaderFileChanges Changes;
+
+    if ( Debouncer.GetWaitMs( 0 ) != SHADER_WATCH_INFINITE || Debouncer.Collect( 1000, Changes ) )
+    {
+        printf( "Error: the debouncer has changes before any were added\n" );
+        bSuccess = false;
+    }
+
+    Debouncer.AddChange( L"a", 0 );
+    Debouncer.AddChange( L"b", 50 );
+    Debouncer.AddChange( L"a", 80 );
+    if ( Debouncer.Collect( 150, Changes ) || Debouncer.GetWaitMs( 150 ) != 30 )
+    {
+        printf( "Error: changes are collected before the window after the last one passed\n" );
+        bSuccess = false;
+    }
+    if ( !Debouncer.Collect( 180, Changes ) || Changes.Files.size() != 2 || Changes.bOverflow || Debouncer.HasChanges() )
+    {
+        printf( "Error: three changes to two files aren't collected as one of each\n" );
+        bSuccess = false;
+    }
+
+    Debouncer.AddOverflow( 200 );
+    if ( !Debouncer.Collect( 300, Changes ) || !Changes.Files.empty() || !Changes.bOverflow )
+    {
+        printf( "Error: an overflow isn't collected\n" );
+        bSuccess = false;
+    }
+
+    // Handed back, as ShaderCache does while busy
+    Debouncer.AddChanges( Changes, 400 );
+    if ( Debouncer.Collect( 450, Changes ) || !Debouncer.Collect( 500, Changes ) || !Changes.bOverflow )
+    {
+        printf( "Error: changes handed back aren't collected after another window\n" );
+        bSuccess = false;
+    }
+
+    return bSuccess;
+}
+
+
+// What the watch command's callback was given
+struct WatchLog
+{
+    std::mutex                      Mutex;
+    std::vector<ShaderFileChanges>  Batches;
+    std::vector<Clock::time_point>  Times;
+    unsigned int                    uRefuse;        // Batches to hand back, as ShaderCache does while busy
+};
+
+static const unsigned int WATCH_DEBOUNCE_MS = 100;
+
+
+//--------------------------------------------------------------------------------------
+static bool OnWatchedFilesChanged( void* pContext, const ShaderFileChanges& Changes )
+{
+    WatchLog* pLog = (WatchLog*)pContext;
+    std::lock_guard<std::mutex> Lock( pLog->Mutex );
+
+    pLog->Batches.push_back( Changes );
+    pLog->Times.push_back( Clock::now() );
+
+    if ( pLog->uRefuse > 0 )
+    {
+        pLog->uRefuse--;
+        return false;
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Waits, for a few seconds at most, until the log has the given number of batches, then
+// for a few more debounce windows, so that a batch too many would show
+//--------------------------------------------------------------------------------------
+static size_t WaitForBatches( WatchLog& Log, size_t uBatches )
+{
+    const Clock::time_point Start = Clock::now();
+    for ( ;; )
+    {
+        {
+            std::lock_guard<std::mutex> Lock( Log.Mutex );
+            if ( Log.Batches.size() >= uBatches )
+            {
+                break;
+            }
+        }
+        if ( ElapsedSeconds( Start ) > 5.0 )
+        {
+            break;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 3 * WATCH_DEBOUNCE_MS ) );
+
+    std::lock_guard<std::mutex> Lock( Log.Mutex );
+    return Log.Batches.size();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Whether a batch has the file, given relative to the watched directory
+//--------------------------------------------------------------------------------------
+static bool HasFile( const ShaderFileChanges& Changes, const char* szFile )
+{
+    for ( size_t i = 0; i < Changes.Files.size(); i++ )
+    {
+        std::wstring Name = Changes.Files[i];
+        std::replace( Name.begin(), Name.end(), L'\\', L'/' );
+        if ( Name == Widen( szFile ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Which of shaders A and B changed, looking up only the files of the batch again if one
+// is given, as ShaderCache does with what its watcher reports
+//--------------------------------------------------------------------------------------
+static std::string ChangedWatchedShaders( ShaderDependencyGraph& Graph, const ShaderFileChanges* pChanges )
+{
+    if ( pChanges )
+    {
+        std::vector<std::wstring> ChangedFiles;
+        for ( size_t i = 0; i < pChanges->Files.size(); i++ )
+        {
+            ChangedFiles.push_back( L"ShaderCacheTool_watch/" + pChanges->Files[i] );
+        }
+        Graph.BeginCheck( ChangedFiles );
+    }
+    else
+    {
+        Graph.BeginCheck();
+    }
+
+    std::string Changed;
+    const char* szShaders = "AB";
+    for ( unsigned int i = 0; szShaders[i]; i++ )
+    {
+        const std::string FileName = std::string( "ShaderCacheTool_watch/" ) + szShaders[i] + ".hlsl";
+        const unsigned long long uHash = Graph.GetDependencyHash( Widen( FileName ).c_str(), 1 );
+
+        if ( !Graph.IsTargetUpToDate( i, uHash ) )
+        {
+            Changed += szShaders[i];
+        }
+        Graph.SetTarget( i, uHash );
+    }
+
+    return Changed;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckWatchedGraph( const char* szStep, ShaderDependencyGraph& Graph, const ShaderFileChanges* pChanges, const char* szExpected, unsigned int uFilesLookedUp )
+{
+    const std::string Changed = ChangedWatchedShaders( Graph, pChanges );
+
+    if ( Changed != szExpected || Graph.GetFilesLookedUp() != uFilesLookedUp )
+    {
+        printf( "Error: %s, shaders \"%s\" changed with %u files looked up, expected \"%s\" with %u\n",
+            szStep, Changed.c_str(), Graph.GetFilesLookedUp(), szExpected, uFilesLookedUp );
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkWatch( unsigned int uShaders, unsigned int uHeaders )
+{
+    bool bSuccess = CheckDebouncer();
+
+    MakeDirectory( "ShaderCacheTool_watch" );
+    MakeDirectory( "ShaderCacheTool_watch/Inc" );
+
+    // A includes Inc/Common, which includes Shared, found next to A. B includes Shared.
+    const char* Files[][2] =
+    {
+        { "ShaderCacheTool_watch/A.hlsl",           "#include \"Inc/Common.hlsl\"\nfloat4 A() { return Common(); }\n" },
+        { "ShaderCacheTool_watch/Inc/Common.hlsl",  "#include \"Shared.h\"\nfloat4 Common() { return SHARED; }\n" },
+        { "ShaderCacheTool_watch/Shared.h",         "#define SHARED float4( 1, 1, 1, 1 )\n" },
+        { "ShaderCacheTool_watch/B.hlsl",           "#include \"Shared.h\"\nfloat4 B() { return SHARED; }\n" },
+    };
+    const unsigned int uFiles = sizeof( Files ) / sizeof( Files[0] );
+    for ( unsigned int i = 0; i < uFiles; i++ )
+    {
+        bSuccess = WriteFile( Files[i][0], Files[i][1] ) && bSuccess;
+    }
+
+    ShaderDependencyGraph Graph;
+    bSuccess = CheckWatchedGraph( "at first", Graph, NULL, "AB", uFiles ) && bSuccess;
+
+    WatchLog Log;
+    Log.uRefuse = 0;
+    double fReportedMs = 0.0;
+
+    ShaderDirectoryWatcher Watcher;
+    if ( !Watcher.Start( L"ShaderCacheTool_watch", WATCH_DEBOUNCE_MS, OnWatchedFilesChanged, &Log ) )
+    {
+        printf( "Error: can't watch ShaderCacheTool_watch\n" );
+        bSuccess = false;
+    }
+    else
+    {
+        // An editor saving: to a temporary file that replaces the original, then once more
+        WriteFile( "ShaderCacheTool_watch/Inc/Common.hlsl.tmp", "#include \"Shared.h\"\nfloat4 Common() { return SHARED * 2; }\n" );
+        remove( Files[1][0] );
+        rename( "ShaderCacheTool_watch/Inc/Common.hlsl.tmp", Files[1][0] );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+        WriteFile( Files[1][0], "#include \"Shared.h\"\nfloat4 Common() { return SHARED * 0.5f; }\n" );
+        const Clock::time_point LastWrite = Clock::now();
+
+        if ( WaitForBatches( Log, 1 ) != 1 || !HasFile( Log.Batches[0], "Inc/Common.hlsl" ) )
+        {
+            printf( "Error: an editor's save isn't reported as one change to Inc/Common.hlsl, %u batches\n", (unsigned int)Log.Batches.size() );
+            bSuccess = false;
+        }
+        else
+        {
+            fReportedMs = std::chrono::duration<double>( Log.Times[0] - LastWrite ).count() * 1e3;
+            bSuccess = CheckWatchedGraph( "after the save", Graph, &Log.Batches[0], "A", 1 ) && bSuccess;
+        }
+
+        // Handed back once, then delivered again
+        Log.uRefuse = 1;
+        WriteFile( Files[3][0], "#include \"Shared.h\"\nfloat4 B() { return SHARED * 3; }\n" );
+
+        if ( WaitForBatches( Log, 3 ) != 3 || !HasFile( Log.Batches[1], "B.hlsl" ) || !HasFile( Log.Batches[2], "B.hlsl" ) ||
+             Log.Times[2] - Log.Times[1] < std::chrono::milliseconds( WATCH_DEBOUNCE_MS ) )
+        {
+            printf( "Error: changes handed back aren't delivered again after a window, %u batches\n", (unsigned int)Log.Batches.size() );
+            bSuccess = false;
+        }
+        else
+        {
+            bSuccess = CheckWatchedGraph( "after editing B", Graph, &Log.Batches[2], "B", 1 ) && bSuccess;
+        }
+
+        // A file the graph hasn't seen isn't looked up, nor is anything else
+        {
+            ShaderFileChanges Unrelated;
+            Unrelated.Files.push_back( L"Notes.txt" );
+            Unrelated.bOverflow = false;
+            bSuccess = CheckWatchedGraph( "after an unrelated change", Graph, &Unrelated, "", 0 ) && bSuccess;
+        }
+
+        // In a directory made after watching started
+        MakeDirectory( "ShaderCacheTool_watch/New" );
+        WriteFile( "ShaderCacheTool_watch/New/D.hlsl", "float4 D() { return 0; }\n" );
+
+        if ( WaitForBatches( Log, 4 ) != 4 || !HasFile( Log.Batches[3], "New/D.hlsl" ) )
+        {
+            printf( "Error: a file in a new directory isn't reported, %u batches\n", (unsigned int)Log.Batches.size() );
+            bSuccess = false;
+        }
+
+        Watcher.Stop();
+        WriteFile( "ShaderCacheTool_watch/New/D.hlsl", "float4 D() { return 1; }\n" );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 3 * WATCH_DEBOUNCE_MS ) );
+        if ( Watcher.IsWatching() || Log.Batches.size() != 4 )
+        {
+            printf( "Error: changes are reported after stopping\n" );
+            bSuccess = false;
+        }
+    }
+
+    for ( unsigned int i = 0; i < uFiles; i++ )
+    {
+        remove( Files[i][0] );
+    }
+    remove( "ShaderCacheTool_watch/New/D.hlsl" );
+    RemoveEmptyDirectory( "ShaderCacheTool_watch/New" );
+    RemoveEmptyDirectory( "ShaderCacheTool_watch/Inc" );
+
+    if ( bSuccess )
+    {
+        printf( "debouncer and directory watcher checks: ok\n" );
+        printf( "  an editor's save reported once, %.0f ms after its last write, with a %u ms window\n", fReportedMs, WATCH_DEBOUNCE_MS );
+    }
+
+    // Shaders each including a few headers, one of which is edited
+    std::mt19937 Random( 5 );
+    for ( unsigned int i = 0; i < uHeaders; i++ )
+    {
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_watch/Header%u.hlsl", i );
+        WriteFile( szFileName, "#pragma once\n" + MakePreprocessedShader( 200, "" ) );
+    }
+
+    std::vector<std::wstring> ShaderFiles;
+    unsigned int uEdited = 0;
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        std::string Source;
+        for ( unsigned int j = 0; j < 4; j++ )
+        {
+            const unsigned int uInclude = Random() % uHeaders;
+            char szLine[64];
+            snprintf( szLine, sizeof( szLine ), "#include \"Header%u.hlsl\"\n", uInclude );
+            Source += szLine;
+            uEdited = ( i == 0 && j == 0 ) ? uInclude : uEdited;
+        }
+        Source += MakePreprocessedShader( 100, "" );
+
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_watch/Shader%u.hlsl", i );
+        WriteFile( szFileName, Source );
+        ShaderFiles.push_back( Widen( szFileName ) );
+    }
+
+    char szEdited[64];
+    snprintf( szEdited, sizeof( szEdited ), "ShaderCacheTool_watch/Header%u.hlsl", uEdited );
+    std::vector<std::wstring> ChangedFiles( 1, Widen( szEdited ) );
+
+    ShaderDependencyGraph Bench;
+    Bench.BeginCheck();
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        Bench.SetTarget( i, Bench.GetDependencyHash( ShaderFiles[i].c_str(), 1 ) );
+    }
+
+    double fSeconds[2] = { 1e9, 1e9 };
+    unsigned int uLookedUp[2] = { 0, 0 };
+    unsigned int uChanged[2] = { 0, 0 };
+    std::string Edited = "#pragma once\n" + MakePreprocessedShader( 200, "" );
+
+    for ( unsigned int uRun = 0; uRun < 6; uRun++ )
+    {
+        // Alternately a full check, and one of only the file the watcher would report
+        const unsigned int uRestricted = uRun % 2;
+
+        Edited += "// Edited\n";
+        WriteFile( szEdited, Edited );
+
+        const Clock::time_point Start = Clock::now();
+        if ( uRestricted )
+        {
+            Bench.BeginCheck( ChangedFiles );
+        }
+        else
+        {
+            Bench.BeginCheck();
+        }
+        uChanged[uRestricted] = 0;
+        for ( unsigned int i = 0; i < uShaders; i++ )
+        {
+            const unsigned long long uHash = Bench.GetDependencyHash( ShaderFiles[i].c_str(), 1 );
+            uChanged[uRestricted] += Bench.IsTargetUpToDate( i, uHash ) ? 0 : 1;
+            Bench.SetTarget( i, uHash );
+        }
+        fSeconds[uRestricted] = std::min( fSeconds[uRestricted], ElapsedSeconds( Start ) );
+        uLookedUp[uRestricted] = Bench.GetFilesLookedUp();
+    }
+
+    if ( uChanged[0] != uChanged[1] || uChanged[0] == 0 || uLookedUp[1] != 1 )
+    {
+        printf( "Error: %u shaders changed with a full check and %u with %u files looked up\n", uChanged[0], uChanged[1], uLookedUp[1] );
+        bSuccess = false;
+    }
+    printf( "%u shaders including %u headers, one header edited\n", uShaders, uHeaders );
+    printf( "  full check:                 %8.2f ms, %u files looked up, %u shaders changed\n", fSeconds[0] * 1e3, uLookedUp[0], uChanged[0] );
+    printf( "  check of the changed files: %8.2f ms, %u files looked up, %u shaders changed\n", fSeconds[1] * 1e3, uLookedUp[1], uChanged[1] );
+
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_watch/Shader%u.hlsl", i );
+        remove( szFileName );
+    }
+    for ( unsigned int i = 0; i < uHeaders; i++ )
+    {
+        char szFileName[64];
+        snprintf( szFileName, sizeof( szFileName ), "ShaderCacheTool_watch/Header%u.hlsl", i );
+        remove( szFileName );
+    }
+    RemoveEmptyDirectory( "ShaderCacheTool_watch" );
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckRemoteGet( const char* szStep, ShaderRemoteCacheClient& Client, unsigned long long uKey, const std::string& Expected )
+{
+    std::vector<char> Blob;
+    if ( !Client.Get( uKey, Blob ) || std::string( Blob.begin(), Blob.end() ) != Expected )
+    {
+        printf( "Error: %s: got %u bytes for key %llu, expected %u\n", szStep, (unsigned int)Blob.size(), uKey, (unsigned int)Expected.size() );
+        return false;
+    }
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Checks getting and putting blobs through the reference server, from two clients, and
+// what a client does when the server goes away and comes back
+//--------------------------------------------------------------------------------------
+static bool CheckRemoteProtocol()
+{
+    bool bSuccess = true;
+
+    ShaderRemoteCacheServer Server;
+    if ( !Server.Start( 0 ) || Server.GetPort() == 0 )
+    {
+        printf( "Error: can't start the cache server\n" );
+        return false;
+    }
+
+    ShaderRemoteCacheClient Client;
+    if ( Client.IsEnabled() )
+    {
+        printf( "Error: a client without a server is enabled\n" );
+        bSuccess = false;
+    }
+    Client.SetServer( "127.0.0.1", Server.GetPort() );
+
+    std::vector<char> Blob;
+    if ( Client.Get( 1, Blob ) || !Blob.empty() )
+    {
+        printf( "Error: an empty server had key 1\n" );
+        bSuccess = false;
+    }
+
+    const std::string First = "first blob";
+    const std::string Second = "second, longer blob";
+    bSuccess &= Client.Put( 1, First.data(), First.size() );
+    bSuccess &= CheckRemoteGet( "put", Client, 1, First );
+    bSuccess &= Client.Put( 1, Second.data(), Second.size() );
+    bSuccess &= CheckRemoteGet( "replace", Client, 1, Second );
+
+    std::string Large( 1024 * 1024, '\0' );
+    std::mt19937 Random( 7 );
+    for ( size_t i = 0; i < Large.size(); i++ )
+    {
+        Large[i] = (char)Random();
+    }
+    bSuccess &= Client.Put( 2, Large.data(), Large.size() );
+    bSuccess &= CheckRemoteGet( "1 MB", Client, 2, Large );
+
+    // Another developer's machine
+    {
+        ShaderRemoteCacheClient Other;
+        Other.SetServer( "localhost", Server.GetPort() );
+        bSuccess &= CheckRemoteGet( "other client", Other, 1, Second );
+        bSuccess &= CheckRemoteGet( "other client", Other, 2, Large );
+    }
+
+    const ShaderRemoteCacheStats& Stats = Client.GetStats();
+    if ( Stats.uHits != 3 || Stats.uMisses != 1 || Stats.uStores != 3 || Stats.uErrors != 0 || Stats.uBytesReceived < Large.size() || Server.GetBlobCount() != 2 )
+    {
+        printf( "Error: %u hits, %u misses, %u stored, %u errors, %llu bytes received, %u blobs on the server\n",
+            Stats.uHits, Stats.uMisses, Stats.uStores, Stats.uErrors, Stats.uBytesReceived, (unsigned int)Server.GetBlobCount() );
+        bSuccess = false;
+    }
+
+    // A server gone away costs one failed request, then the client stops asking
+    Server.Stop();
+    Client.ResetStats();
+    const Clock::time_point Start = Clock::now();
+    const bool bGot = Client.Get( 1, Blob );
+    const bool bPut = Client.Put( 1, First.data(), First.size() );
+    const double fSeconds = ElapsedSeconds( Start );
+    if ( bGot || bPut || Client.IsEnabled() || Client.GetStats().uErrors != 1 || fSeconds > 1.0 )
+    {
+        printf( "Error: after the server stopped the client got %d, put %d, is %s, with %u errors in %.3f s\n",
+            bGot, bPut, Client.IsEnabled() ? "enabled" : "disabled", Client.GetStats().uErrors, fSeconds );
+        bSuccess = false;
+    }
+
+    // Setting the server again tries again
+    if ( !Server.Start( 0 ) )
+    {
+        printf( "Error: can't restart the cache server\n" );
+        return false;
+    }
+    Client.SetServer( "127.0.0.1", Server.GetPort() );
+    if ( Client.Get( 1, Blob ) || !Client.IsEnabled() )
+    {
+        printf( "Error: the restarted server had key 1, or the client was disabled\n" );
+        bSuccess = false;
+    }
+    bSuccess &= Client.Put( 3, First.data(), First.size() );
+    bSuccess &= CheckRemoteGet( "restarted", Client, 3, First );
+
+    Client.SetServer( NULL, 0 );
+    if ( Client.IsEnabled() || Client.Get( 3, Blob ) )
+    {
+        printf( "Error: a client set to no server still got key 3\n" );
+        bSuccess = false;
+    }
+
+    Server.Stop();
+
+    printf( "  protocol:         %s\n", bSuccess ? "ok" : "FAILED" );
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Generates the shaders with the fake compiler, asking pRemoteCache for them first if any
+//--------------------------------------------------------------------------------------
+static bool RunWithRemoteCache( const ScheduleOptions& Options, ShaderRemoteCacheClient* pRemoteCache, const char* szName,
+    unsigned int uExpectedFetched, double& fSeconds )
+{
+    FakeShaderClient Client( Options );
+    Client.SetRemoteCache( pRemoteCache );
+
+    ShaderCompileScheduler Scheduler( Client, ShaderProcessPlatform::GetDefault() );
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        Scheduler.AddJob( &Client.GetShader( i ) );
+    }
+
+    if ( pRemoteCache )
+    {
+        pRemoteCache->ResetStats();
+    }
+
+    bool bSuccess = Scheduler.Run( Options.uProcesses );
+    fSeconds = Scheduler.GetStats().fTotalSeconds;
+    bSuccess &= Client.Check( szName );
+
+    unsigned int uFetched = 0;
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        uFetched += Client.GetShader( i ).bFetched ? 1 : 0;
+    }
+    if ( uFetched != uExpectedFetched )
+    {
+        printf( "Error: %s: %u shaders came from the cache server, expected %u\n", szName, uFetched, uExpectedFetched );
+        bSuccess = false;
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintRemoteStats( const ShaderRemoteCacheClient& RemoteCache )
+{
+    const ShaderRemoteCacheStats& Stats = RemoteCache.GetStats();
+    printf( "    %u hits, %u misses, %u stored, %u errors, %.1f KB sent, %.1f KB received, %.3f s waiting for the server\n",
+        Stats.uHits, Stats.uMisses, Stats.uStores, Stats.uErrors, Stats.uBytesSent / 1024.0, Stats.uBytesReceived / 1024.0, Stats.fSeconds );
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkRemote( const ScheduleOptions& Options )
+{
+    bool bSuccess = CheckRemoteProtocol();
+
+    printf( "%u shaders, %u processes, compiling for %u ms\n", Options.uShaders, Options.uProcesses, Options.uCompileMs );
+
+    ShaderRemoteCacheServer Server;
+    if ( !Server.Start( 0 ) )
+    {
+        printf( "Error: can't start the cache server\n" );
+        return false;
+    }
+
+    double fLocalSeconds = 0.0;
+    bSuccess &= RunWithRemoteCache( Options, NULL, "local", 0, fLocalSeconds );
+    printf( "  local only:       %7.3f s\n", fLocalSeconds );
+
+    // The first machine compiles everything and fills the server
+    double fFirstSeconds = 0.0;
+    {
+        ShaderRemoteCacheClient RemoteCache;
+        RemoteCache.SetServer( "127.0.0.1", Server.GetPort() );
+        bSuccess &= RunWithRemoteCache( Options, &RemoteCache, "filling the server", 0, fFirstSeconds );
+        printf( "  filling server:   %7.3f s\n", fFirstSeconds );
+        PrintRemoteStats( RemoteCache );
+
+        const ShaderRemoteCacheStats& Stats = RemoteCache.GetStats();
+        if ( Stats.uHits != 0 || Stats.uMisses != Options.uShaders || Stats.uStores != Options.uShaders - 1 || Stats.uErrors != 0 )
+        {
+            printf( "Error: filling the server, expected %u misses and %u stored\n", Options.uShaders, Options.uShaders - 1 );
+            bSuccess = false;
+        }
+    }
+
+    // The next one compiles only the shader that fails
+    double fNextSeconds = 0.0;
+    {
+        ShaderRemoteCacheClient RemoteCache;
+        RemoteCache.SetServer( "127.0.0.1", Server.GetPort() );
+        bSuccess &= RunWithRemoteCache( Options, &RemoteCache, "from the server", Options.uShaders - 1, fNextSeconds );
+        printf( "  from the server:  %7.3f s, %.2fx faster than local only\n", fNextSeconds, fLocalSeconds / fNextSeconds );
+        PrintRemoteStats( RemoteCache );
+
+        const ShaderRemoteCacheStats& Stats = RemoteCache.GetStats();
+        if ( Stats.uHits != Options.uShaders - 1 || Stats.uMisses != 1 || Stats.uStores != 0 || Stats.uErrors != 0 )
+        {
+            printf( "Error: from the server, expected %u hits and 1 miss\n", Options.uShaders - 1 );
+            bSuccess = false;
+        }
+    }
+
+    // A server that isn't there costs one refused connection
+    const unsigned short uPort = Server.GetPort();
+    Server.Stop();
+
+    double fMissingSeconds = 0.0;
+    {
+        ShaderRemoteCacheClient RemoteCache;
+        RemoteCache.SetServer( "127.0.0.1", uPort );
+        bSuccess &= RunWithRemoteCache( Options, &RemoteCache, "without the server", 0, fMissingSeconds );
+        printf( "  server stopped:   %7.3f s\n", fMissingSeconds );
+        PrintRemoteStats( RemoteCache );
+
+        if ( RemoteCache.IsEnabled() || RemoteCache.GetStats().uErrors != 1 )
+        {
+            printf( "Error: without the server, expected 1 error and the client disabled\n" );
+            bSuccess = false;
+        }
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Compresses and decompresses Data, which must come back the same, and checks that the
+// decompressor refuses the wrong size and a truncated blob
+//--------------------------------------------------------------------------------------
+static bool CheckRoundTrip( const char* szName, const std::vector<char>& Data )
+{
+    std::vector<char> Compressed( ShaderCompressBound( Data.size() ) );
+    const size_t uCompressed = ShaderCompress( Data.empty() ? NULL : &Data[0], Data.size(), &Compressed[0], Compressed.size() );
+    if ( uCompressed == 0 )
+    {
+        printf( "Error: %s: %u bytes didn't compress within the bound\n", szName, (unsigned int)Data.size() );
+        return false;
+    }
+
+    std::vector<char> Decompressed( Data.size() + 1 );
+    if ( !ShaderDecompress( &Compressed[0], uCompressed, &Decompressed[0], Data.size() ) ||
+         !std::equal( Data.begin(), Data.end(), Decompressed.begin() ) )
+    {
+        printf( "Error: %s: %u bytes didn't come back from %u compressed\n", szName, (unsigned int)Data.size(), (unsigned int)uCompressed );
+        return false;
+    }
+
+    if ( ShaderDecompress( &Compressed[0], uCompressed, &Decompressed[0], Data.size() + 1 ) ||
+         ( !Data.empty() && ShaderDecompress( &Compressed[0], uCompressed, &Decompressed[0], Data.size() - 1 ) ) ||
+         ShaderDecompress( &Compressed[0], uCompressed - 1, &Decompressed[0], Data.size() ) )
+    {
+        printf( "Error: %s: decompressed to the wrong size, or truncated\n", szName );
+        return false;
+    }
+
+    // Too little room fails rather than writing past it
+    if ( uCompressed > 1 && ShaderCompress( &Data[0], Data.size(), &Compressed[0], uCompressed - 1 ) != 0 )
+    {
+        printf( "Error: %s: compressed into less room than it needs\n", szName );
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void CountIndex( void* pContext, size_t uIndex )
+{
+    std::vector< std::atomic<unsigned int> >& Counts = *(std::vector< std::atomic<unsigned int> >*)pContext;
+    Counts[uIndex]++;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CheckCompression()
+{
+    bool bSuccess = true;
+    std::mt19937 Random( 5 );
+
+    const size_t uSizes[] = { 0, 1, 4, 11, 12, 13, 14, 16, 100, 4095, 65536 + 300, 300 * 1024 };
+    for ( size_t s = 0; s < sizeof( uSizes ) / sizeof( uSizes[0] ); s++ )
+    {
+        const size_t uSize = uSizes[s];
+        std::vector<char> Zeros( uSize, 0 );
+        std::vector<char> Noise( uSize );
+        std::vector<char> Pattern( uSize );
+        std::vector<char> Text( uSize );
+        for ( size_t i = 0; i < uSize; i++ )
+        {
+            Noise[i] = (char)Random();
+            Pattern[i] = (char)( "abc"[ i % 3 ] );
+            Text[i] = "float4 vColor = g_txDiffuse.Sample( g_Sampler, vTexCoord );\n"[ ( i * 7 / 5 ) % 61 ];
+        }
+
+        bSuccess &= CheckRoundTrip( "zeros", Zeros );
+        bSuccess &= CheckRoundTrip( "noise", Noise );
+        bSuccess &= CheckRoundTrip( "pattern", Pattern );
+        bSuccess &= CheckRoundTrip( "text", Text );
+    }
+
+    // Literal runs and matches of the lengths that need extra bytes, and matches just out of reach
+    std::vector<char> Runs;
+    const size_t uRunLengths[] = { 14, 15, 16, 269, 270, 271, 530, 70000 };
+    for ( size_t r = 0; r < sizeof( uRunLengths ) / sizeof( uRunLengths[0] ); r++ )
+    {
+        std::vector<char> Run( uRunLengths[r] );
+        for ( size_t i = 0; i < Run.size(); i++ )
+        {
+            Run[i] = (char)Random();
+        }
+        Runs.insert( Runs.end(), Run.begin(), Run.end() );
+        Runs.insert( Runs.end(), Run.begin(), Run.begin() + std::min<size_t>( Run.size(), 300 ) );
+    }
+    bSuccess &= CheckRoundTrip( "runs", Runs );
+
+    // Damaged blobs must fail or decompress within bounds, which ASan builds check
+    std::vector<char> Garbage( 256 );
+    std::vector<char> Output( 1024 );
+    unsigned int uDecompressed = 0;
+    for ( unsigned int i = 0; i < 20000; i++ )
+    {
+        const size_t uSize = Random() % Garbage.size() + 1;
+        for ( size_t j = 0; j < uSize; j++ )
+        {
+            Garbage[j] = (char)Random();
+        }
+        uDecompressed += ShaderDecompress( &Garbage[0], uSize, &Output[0], Random() % Output.size() ) ? 1 : 0;
+    }
+
+    // Every index once, whatever the threads
+    const unsigned int uThreads[] = { 1, 3, 64 };
+    const size_t uCounts[] = { 0, 1, 1000 };
+    for ( size_t t = 0; t < 3; t++ )
+    {
+        for ( size_t c = 0; c < 3; c++ )
+        {
+            std::vector< std::atomic<unsigned int> > Counts( uCounts[c] );
+            for ( size_t i = 0; i < Counts.size(); i++ )
+            {
+                Counts[i] = 0;
+            }
+            ShaderParallelFor( Counts.size(), uThreads[t], CountIndex, &Counts );
+            for ( size_t i = 0; i < Counts.size(); i++ )
+            {
+                if ( Counts[i] != 1 )
+                {
+                    printf( "Error: %u threads ran index %u of %u %u times\n", uThreads[t], (unsigned int)i, (unsigned int)uCounts[c], (unsigned int)Counts[i] );
+                    bSuccess = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    printf( "  compression:      %s, %u of 20000 damaged blobs decompressed\n", bSuccess ? "ok" : "FAILED", uDecompressed );
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// A stand-in for a compiled shader: a DXBC container with resource names, signatures and
+// an instruction stream of common opcodes and operands, about uKB in size. Real shaders
+// vary; the ratio this compresses at is only a guide.
+//--------------------------------------------------------------------------------------
+static std::vector<char> MakeShaderObject( unsigned int uShader, unsigned int uKB )
+{
+    static const char* szNames[] = { "g_mWorldViewProjection", "g_mWorld", "g_vLightDirection", "g_vLightColor", "g_vEyePosition",
+        "g_txDiffuse", "g_txNormal", "g_txShadowMap", "g_SamplerLinear", "g_SamplerPoint", "cbPerFrame", "cbPerObject",
+        "POSITION", "NORMAL", "TEXCOORD", "SV_POSITION", "SV_Target", "Microsoft (R) HLSL Shader Compiler 10.1" };
+    static const unsigned int uOpcodes[] = { 0x00, 0x0e, 0x10, 0x11, 0x32, 0x35, 0x36, 0x38, 0x3e, 0x45, 0x4b, 0x1f, 0x15, 0x16, 0x1b, 0x2b };
+    static const unsigned int uOperands[] = { 0x00100072, 0x001000f2, 0x00100012, 0x00101072, 0x00102032, 0x00208e46, 0x00106000, 0x00107e46, 0x00100ff2, 0x0010000a };
+
+    std::mt19937 Random( uShader * 104729 + 3 );
+    std::vector<char> Data;
+    const char szHeader[] = "DXBC";
+    Data.insert( Data.end(), szHeader, szHeader + 4 );
+    for ( unsigned int i = 0; i < 16; i++ )
+    {
+        Data.push_back( (char)Random() );
+    }
+
+    // Resource names and signatures
+    for ( unsigned int i = 0; i < 24; i++ )
+    {
+        const char* szName = szNames[ Random() % ( sizeof( szNames ) / sizeof( szNames[0] ) ) ];
+        Data.insert( Data.end(), szName, szName + strlen( szName ) + 1 );
+        const unsigned int uValues[] = { (unsigned int)Data.size(), (unsigned int)( Random() % 16 ), 3, (unsigned int)( Random() % 64 * 16 ) };
+        Data.insert( Data.end(), (const char*)uValues, (const char*)uValues + sizeof( uValues ) );
+    }
+
+    // Instructions, each an opcode token and a few operands with a register index, or a constant
+    const size_t uSize = uKB * 1024;
+    while ( Data.size() < uSize )
+    {
+        const unsigned int uOperandCount = 1 + Random() % 3;
+        unsigned int uTokens[16];
+        unsigned int uLength = 0;
+        uTokens[ uLength++ ] = uOpcodes[ Random() % ( sizeof( uOpcodes ) / sizeof( uOpcodes[0] ) ) ] | ( ( 1 + uOperandCount * 2 ) << 24 );
+        for ( unsigned int i = 0; i < uOperandCount; i++ )
+        {
+            if ( Random() % 8 == 0 )
+            {
+                uTokens[ uLength++ ] = 0x00004001;
+                uTokens[ uLength++ ] = Random();
+            }
+            else
+            {
+                uTokens[ uLength++ ] = uOperands[ Random() % ( sizeof( uOperands ) / sizeof( uOperands[0] ) ) ];
+                uTokens[ uLength++ ] = Random() % 24;
+            }
+        }
+        Data.insert( Data.end(), (const char*)uTokens, (const char*)( uTokens + uLength ) );
+    }
+
+    return Data;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Evicts a file from the file cache, so the next read comes from the disk. Only on Linux.
+//--------------------------------------------------------------------------------------
+static bool DropFromFileCache( const char* szFileName )
+{
+#if defined( __linux__ )
+    const int iFile = open( szFileName, O_RDONLY );
+    if ( iFile < 0 )
+    {
+        return false;
+    }
+    const bool bDropped = fdatasync( iFile ) == 0 && posix_fadvise( iFile, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+    close( iFile );
+    return bDropped;
+#else
+    (void)szFileName;
+    return false;
+#endif
+}
+
+
+// What the threads of LoadShaders share
+struct LoadShadersJob
+{
+    const ShaderArchive*                pArchive;
+    unsigned int                        uShaders;
+    std::vector<unsigned long long>     Created;    // Stand-in for the created shader
+};
+
+
+//--------------------------------------------------------------------------------------
+// Reads a shader as CreateShader does, and hashes it where it would create the shader
+//--------------------------------------------------------------------------------------
+static void LoadShader( void* pContext, size_t uIndex )
+{
+    LoadShadersJob& Job = *(LoadShadersJob*)pContext;
+    const ShaderArchiveEntry* pEntry = Job.pArchive->Find( ShaderKey( (unsigned int)uIndex ) );
+
+    std::vector<char> Buffer;
+    const void* pBlob = pEntry ? Job.pArchive->GetBlob( *pEntry, Buffer ) : NULL;
+    Job.Created[uIndex] = pBlob ? ShaderHasher::Hash( pBlob, (size_t)pEntry->uSize ) : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Opens the archive and loads every shader on the threads, returns the seconds taken, or
+// a negative number if a shader didn't load as expected
+//--------------------------------------------------------------------------------------
+static double LoadShaders( const wchar_t* szArchive, unsigned int uShaders, unsigned int uThreads, const std::vector<unsigned long long>& Expected )
+{
+    const Clock::time_point Start = Clock::now();
+
+    ShaderArchive Archive;
+    Archive.Open( szArchive );
+
+    LoadShadersJob Job;
+    Job.pArchive = &Archive;
+    Job.uShaders = uShaders;
+    Job.Created.resize( uShaders, 0 );
+    ShaderParallelFor( uShaders, uThreads, LoadShader, &Job );
+
+    const double fSeconds = ElapsedSeconds( Start );
+    return ( Job.Created == Expected ) ? fSeconds : -1.0;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkCompression( unsigned int uShaders, unsigned int uKB, unsigned int uThreads )
+{
+    bool bSuccess = CheckCompression();
+
+    std::vector< std::vector<char> > Objects( uShaders );
+    std::vector<ShaderArchiveBlob> Blobs( uShaders );
+    std::vector<unsigned long long> Expected( uShaders );
+    for ( unsigned int i = 0; i < uShaders; i++ )
+    {
+        Objects[i] = MakeShaderObject( i, uKB );
+        ShaderArchiveBlob Blob = { ShaderKey( i ), i + 1, &Objects[i][0], Objects[i].size() };
+        Blobs[i] = Blob;
+        Expected[i] = ShaderHasher::Hash( &Objects[i][0], Objects[i].size() );
+    }
+
+    // Raw and compressed archives; one incompressible shader stays raw
+    const char* szFileNames[] = { "ShaderCacheTool_raw.sca", "ShaderCacheTool_lz4.sca" };
+    const wchar_t* szArchives[] = { L"ShaderCacheTool_raw.sca", L"ShaderCacheTool_lz4.sca" };
+    const std::vector<char> Noise = MakeObject( 0, 1, uKB );
+    size_t uFileSizes[2] = { 0, 0 };
+    double fWriteSeconds[2] = { 0.0, 0.0 };
+    for ( unsigned int uCompressed = 0; uCompressed < 2; uCompressed++ )
+    {
+        ShaderArchive Archive;
+        RemoveFile( szArchives[uCompressed] );
+        Archive.Open( szArchives[uCompressed] );
+        Archive.SetCompression( uCompressed != 0 );
+
+        const Clock::time_point Start = Clock::now();
+        bSuccess &= Archive.Update( &Blobs[0], Blobs.size() );
+        fWriteSeconds[uCompressed] = ElapsedSeconds( Start );
+
+        ShaderArchiveBlob NoiseBlob = { ShaderKey( uShaders ), 1, &Noise[0], Noise.size() };
+        bSuccess &= Archive.Update( &NoiseBlob, 1 );
+        const ShaderArchiveEntry* pNoise = Archive.Find( ShaderKey( uShaders ) );
+        const ShaderArchiveEntry* pFirst = Archive.Find( ShaderKey( 0 ) );
+        if ( !pNoise || ShaderArchive::IsCompressed( *pNoise ) || !pFirst || ShaderArchive::IsCompressed( *pFirst ) != ( uCompressed != 0 ) )
+        {
+            printf( "Error: %s archive stored a shader %s\n", uCompressed ? "a compressed" : "a raw", ( pFirst && ShaderArchive::IsCompressed( *pFirst ) ) ? "compressed" : "raw" );
+            bSuccess = false;
+        }
+        uFileSizes[uCompressed] = Archive.GetFileSize();
+    }
+
+    // Compacting keeps blobs as stored, whether compression is on or off
+    {
+        ShaderArchive Archive;
+        bSuccess &= Archive.Open( szArchives[1] );
+        std::vector<char> Buffer;
+        const ShaderArchiveEntry* pEntry = NULL;
+        bSuccess = bSuccess && Archive.Compact() && ( pEntry = Archive.Find( ShaderKey( 1 ) ) ) != NULL && ShaderArchive::IsCompressed( *pEntry ) &&
+            Archive.GetBlob( *pEntry, Buffer ) && Buffer == Objects[1] && Archive.GetEntryCount() == uShaders + 1;
+        if ( !bSuccess )
+        {
+            printf( "Error: compacting the compressed archive changed it\n" );
+        }
+    }
+
+    const double fRawMB = uFileSizes[0] / ( 1024.0 * 1024.0 );
+    const double fCompressedMB = uFileSizes[1] / ( 1024.0 * 1024.0 );
+    printf( "%u shaders of about %u KB, %u threads\n", uShaders, uKB, uThreads );
+    printf( "  archive:          raw %.2f MB, LZ4 %.2f MB, %.1f%% smaller, compressed on update in %.3f s (raw %.3f s)\n",
+        fRawMB, fCompressedMB, 100.0 * ( 1.0 - fCompressedMB / fRawMB ), fWriteSeconds[1], fWriteSeconds[0] );
+
+    // From the file cache, best of a few runs: the CPU time of reading and decompressing
+    const unsigned int uThreadCounts[] = { 1, uThreads };
+    double fWarm[2][2] = { { 1e9, 1e9 }, { 1e9, 1e9 } };
+    for ( unsigned int uRun = 0; uRun < 5; uRun++ )
+    {
+        for ( unsigned int uCompressed = 0; uCompressed < 2; uCompressed++ )
+        {
+            for ( unsigned int t = 0; t < 2; t++ )
+            {
+                const double fSeconds = LoadShaders( szArchives[uCompressed], uShaders, uThreadCounts[t], Expected );
+                if ( fSeconds < 0.0 )
+                {
+                    printf( "Error: the %s archive didn't load every shader\n", uCompressed ? "compressed" : "raw" );
+                    return false;
+                }
+                fWarm[uCompressed][t] = std::min( fWarm[uCompressed][t], fSeconds );
+            }
+        }
+    }
+    printf( "  cached load:      raw %7.2f ms, LZ4 %7.2f ms on 1 thread; raw %7.2f ms, LZ4 %7.2f ms on %u\n",
+        fWarm[0][0] * 1e3, fWarm[1][0] * 1e3, fWarm[0][1] * 1e3, fWarm[1][1] * 1e3, uThreads );
+
+    // Cold, from this machine's disk, where the file cache can be dropped
+    if ( DropFromFileCache( szFileNames[0] ) && DropFromFileCache( szFileNames[1] ) )
+    {
+        double fCold[2];
+        for ( unsigned int uCompressed = 0; uCompressed < 2; uCompressed++ )
+        {
+            DropFromFileCache( szFileNames[uCompressed] );
+            fCold[uCompressed] = LoadShaders( szArchives[uCompressed], uShaders, uThreads, Expected );
+        }
+        printf( "  cold, this disk:  raw %7.2f ms, LZ4 %7.2f ms, %.2fx\n", fCold[0] * 1e3, fCold[1] * 1e3, fCold[0] / fCold[1] );
+    }
+
+    // Cold elsewhere: the file read at the disk's rate, then loaded as from the file cache
+    const char* szDisks[] = { "cold, hard disk:", "cold, SATA SSD:", "cold, NVMe:" };
+    const double fDiskMBps[] = { 150.0, 550.0, 3000.0 };
+    for ( unsigned int d = 0; d < 3; d++ )
+    {
+        const double fRaw = fRawMB / fDiskMBps[d] + fWarm[0][1];
+        const double fCompressed = fCompressedMB / fDiskMBps[d] + fWarm[1][1];
+        printf( "  %-18sraw %7.2f ms, LZ4 %7.2f ms, %.2fx, reading %.0f MB/s\n", szDisks[d], fRaw * 1e3, fCompressed * 1e3, fRaw / fCompressed, fDiskMBps[d] );
+    }
+
+    RemoveFile( szArchives[0] );
+    RemoveFile( szArchives[1] );
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adds a nanosecond to the first stage of the first shader, from one of many threads
+//--------------------------------------------------------------------------------------
+static void AddNanosecond( void* pContext, size_t uIndex )
+{
+    ( (ShaderStartupProfile*)pContext )->AddDuration( 0, SHADER_PROFILE_SPAWN, 1 );
+    (void)uIndex;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Checks the order of the stages and shaders a ShaderStartupProfile reports, that it adds
+// nothing it shouldn't, that adds from many threads at once all count, and its report file
+//--------------------------------------------------------------------------------------
+static bool CheckProfile()
+{
+    bool bSuccess = true;
+    const unsigned long long MS = 1000000;
+
+    std::vector<std::wstring> Names;
+    Names.push_back( L"b" );
+    Names.push_back( L"a" );
+    Names.push_back( L"c" );
+    Names.push_back( L"Shaders\\Idle.hlsl" );
+    Names.push_back( L"Shaders\\\u00DCberblick.hlsl" );
+    Names.push_back( L"Shaders\\AVeryLongDirectoryName\\AndAnotherOne\\DeferredLighting_PS_MSAA_8x.hlsl" );
+
+    ShaderStartupProfile Profile;
+    Profile.Begin( Names );
+    Profile.AddDuration( 0, SHADER_PROFILE_COMPILE, 30 * MS );
+    Profile.AddDuration( 0, SHADER_PROFILE_PREPROCESS, 5 * MS );
+    Profile.AddDuration( 1, SHADER_PROFILE_COMPILE, 20 * MS );
+    Profile.AddDuration( 1, SHADER_PROFILE_CREATE, 15 * MS );
+    Profile.AddDuration( 2, SHADER_PROFILE_HASH, 1 * MS );
+    Profile.AddDuration( 4, SHADER_PROFILE_DISK, 60 * MS );
+    Profile.AddDuration( 5, SHADER_PROFILE_CREATE, 2 * MS );
+
+    // None of these count
+    Profile.AddDuration( ShaderStartupProfile::NO_SHADER, SHADER_PROFILE_COMPILE, 1000 * MS );
+    Profile.AddDuration( (unsigned int)Names.size(), SHADER_PROFILE_COMPILE, 1000 * MS );
+    Profile.AddDuration( 3, SHADER_PROFILE_STAGE_COUNT, 1000 * MS );
+
+    Profile.Mark( L"first frame ready" );
+    Profile.End();
+    Profile.AddDuration( 3, SHADER_PROFILE_COMPILE, 1000 * MS );
+    Profile.Mark( L"too late" );
+
+    // Stages by their total, shaders by theirs and then by name; a shader without times isn't listed
+    const SHADER_PROFILE_STAGE eExpectedStages[] =
+    {
+        SHADER_PROFILE_DISK, SHADER_PROFILE_COMPILE, SHADER_PROFILE_CREATE, SHADER_PROFILE_PREPROCESS, SHADER_PROFILE_HASH, SHADER_PROFILE_SPAWN
+    };
+    const size_t uExpectedSlowest[] = { 4, 1, 0, 5, 2 };
+
+    std::vector<ShaderProfileStage> Stages;
+    Profile.GetStages( Stages );
+    for ( size_t i = 0; i < Stages.size(); i++ )
+    {
+        if ( Stages.size() != SHADER_PROFILE_STAGE_COUNT || Stages[i].eStage != eExpectedStages[i] )
+        {
+            printf( "Error: profile: stage %u is %ls, expected %ls\n", (unsigned int)i, GetShaderProfileStageName( Stages[i].eStage ), GetShaderProfileStageName( eExpectedStages[i] ) );
+            bSuccess = false;
+        }
+    }
+    if ( Stages[1].uShaders != 2 || Stages[1].uMaxShader != 0 || fabs( Stages[1].fTotalSeconds - 0.050 ) > 1e-9 || fabs( Stages[1].fMaxSeconds - 0.030 ) > 1e-9 ||
+        Stages[5].uShaders != 0 || Stages[5].fTotalSeconds != 0.0 )
+    {
+        printf( "Error: profile: compile took %.3f s over %u shaders, at most %.3f s by shader %u\n",
+            Stages[1].fTotalSeconds, Stages[1].uShaders, Stages[1].fMaxSeconds, (unsigned int)Stages[1].uMaxShader );
+        bSuccess = false;
+    }
+
+    std::vector<ShaderProfileEntry> Slowest;
+    Profile.GetSlowest( 100, Slowest );
+    bool bOrdered = ( Slowest.size() == sizeof( uExpectedSlowest ) / sizeof( uExpectedSlowest[0] ) );
+    for ( size_t i = 0; bOrdered && i < Slowest.size(); i++ )
+    {
+        bOrdered = ( Slowest[i].Name == Names[uExpectedSlowest[i]] );
+    }
+    Profile.GetSlowest( 2, Slowest );
+    if ( !bOrdered || Slowest.size() != 2 || Slowest[1].Name != L"a" || fabs( Slowest[1].fTotalSeconds - 0.035 ) > 1e-9 )
+    {
+        printf( "Error: profile: the slowest shaders aren't in order\n" );
+        bSuccess = false;
+    }
+
+    // Adds to the same shader from several threads at once
+    {
+        ShaderStartupProfile Shared;
+        Shared.Begin( std::vector<std::wstring>( 1, L"shared" ) );
+        ShaderParallelFor( 400000, 4, AddNanosecond, &Shared );
+        if ( Shared.GetSeconds( 0, SHADER_PROFILE_SPAWN ) != 400000 * 1e-9 )
+        {
+            printf( "Error: profile: %.0f ns added from 4 threads, expected 400000\n", Shared.GetSeconds( 0, SHADER_PROFILE_SPAWN ) * 1e9 );
+            bSuccess = false;
+        }
+    }
+
+    // The report lists the stages, then the shaders, slowest first, and is written as UTF-8
+    const std::wstring Report = Profile.Report( 10 );
+    const size_t uDisk = Report.find( L"\n  disk " );
+    const size_t uCompile = Report.find( L"\n  compile " );
+    const size_t uFirst = Report.find( L"\n  Shaders\\\u00DCberblick.hlsl " );
+    const size_t uSecond = Report.find( L"\n  a " );
+    if ( Report.find( L"Shader startup profile: 6 shaders" ) != 0 || Report.find( L"first frame ready" ) == std::wstring::npos ||
+        Report.find( L"too late" ) != std::wstring::npos || Report.find( L"Idle" ) != std::wstring::npos ||
+        Report.find( L"...AnotherOne\\DeferredLighting_PS_MSAA_8x.hlsl" ) == std::wstring::npos ||
+        uDisk == std::wstring::npos || uCompile == std::wstring::npos || uDisk > uCompile || uFirst == std::wstring::npos || uSecond == std::wstring::npos ||
+        uCompile > uFirst || uFirst > uSecond )
+    {
+        printf( "Error: profile: the report isn't as expected:\n%ls\n", Report.c_str() );
+        bSuccess = false;
+    }
+
+    const wchar_t* szReportFile = L"ShaderCacheTool_profile.txt";
+    if ( Profile.WriteReport( szReportFile, 10 ) )
+    {
+        const std::vector<char> Written = ReadWholeFile( "ShaderCacheTool_profile.txt" );
+        const std::string Text = Written.empty() ? std::string() : std::string( &Written[0], Written.size() );
+        if ( Text.find( "Shader startup profile: 6 shaders" ) != 0 || Text.find( "Shaders\\\xC3\x9C" "berblick.hlsl" ) == std::string::npos )
+        {
+            printf( "Error: profile: the report file isn't as expected\n" );
+            bSuccess = false;
+        }
+        remove( "ShaderCacheTool_profile.txt" );
+    }
+    else
+    {
+        printf( "Error: profile: can't write the report\n" );
+        bSuccess = false;
+    }
+
+    printf( "  profile:          %s\n", bSuccess ? "ok" : "FAILED" );
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkProfile( const ScheduleOptions& Options )
+{
+    bool bSuccess = CheckProfile();
+
+    // What timing a stage costs, twice per stage of every shader
+    {
+        ShaderStartupProfile Profile;
+        Profile.Begin( std::vector<std::wstring>( 64, L"shader" ) );
+
+        const unsigned int uTimes = 1000000;
+        const Clock::time_point Start = Clock::now();
+        for ( unsigned int i = 0; i < uTimes; i++ )
+        {
+            ShaderProfileScope Scope( Profile, i & 63, (SHADER_PROFILE_STAGE)( i % SHADER_PROFILE_STAGE_COUNT ) );
+        }
+        printf( "  timing a stage:   %.1f ns\n", ElapsedSeconds( Start ) * 1e9 / uTimes );
+    }
+
+    printf( "%u shaders, %u processes, compiling for %u ms, every %u-th ten times as long\n", Options.uShaders, Options.uProcesses, Options.uCompileMs, Options.uSlowEvery );
+
+    FakeShaderClient Client( Options );
+    std::vector<std::wstring> Names;
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        wchar_t szName[64];
+        swprintf( szName, sizeof( szName ) / sizeof( szName[0] ), L"Shaders\\Fake_%03u.hlsl", (unsigned int)i );
+        Names.push_back( szName );
+    }
+
+    ShaderStartupProfile Profile;
+    Profile.Begin( Names );
+    Client.SetProfile( &Profile );
+
+    ShaderCompileScheduler Scheduler( Client, ShaderProcessPlatform::GetDefault() );
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        Scheduler.AddJob( &Client.GetShader( i ) );
+    }
+    bSuccess &= Scheduler.Run( Options.uProcesses );
+    bSuccess &= Client.Check( "profile" );
+    Profile.Mark( L"generated" );
+    Profile.End();
+
+    // The shaders that compile ten times as long must be the slowest, and compiling the longest stage
+    std::set<std::wstring> SlowShaders;
+    for ( size_t i = 0; i < Client.GetShaderCount(); i++ )
+    {
+        if ( Client.GetShader( i ).uCompileMs > Options.uCompileMs && !Client.GetShader( i ).bCached )
+        {
+            SlowShaders.insert( Names[i] );
+        }
+    }
+
+    std::vector<ShaderProfileEntry> Slowest;
+    Profile.GetSlowest( SlowShaders.size(), Slowest );
+    for ( size_t i = 0; i < Slowest.size(); i++ )
+    {
+        if ( !SlowShaders.count( Slowest[i].Name ) )
+        {
+            printf( "Error: profile: %ls is among the slowest shaders, but compiles quickly\n", Slowest[i].Name.c_str() );
+            bSuccess = false;
+        }
+    }
+
+    std::vector<ShaderProfileStage> Stages;
+    Profile.GetStages( Stages );
+    if ( Stages[0].eStage != SHADER_PROFILE_COMPILE )
+    {
+        printf( "Error: profile: %ls took longer than compiling\n", GetShaderProfileStageName( Stages[0].eStage ) );
+        bSuccess = false;
+    }
+
+    // As ShaderCache leaves it next to the object files, for CI to keep
+    const wchar_t* szReportFile = L"ShaderStartupProfile.txt";
+    if ( !Profile.WriteReport( szReportFile, 10 ) )
+    {
+        printf( "Error: profile: can't write %ls\n", szReportFile );
+        bSuccess = false;
+    }
+
+    printf( "\n%ls", Profile.Report( 10 ).c_str() );
+    printf( "\nwritten to %ls\n", szReportFile );
+
+    return bSuccess;
+}
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf( "Usage:\n" );
+    printf( "  ShaderCacheTool schedule [-shaders n] [-processes n] [-compile ms] [-slow n] [-cached n] [-first n]\n" );
+    printf( "    start-up time of compiling shaders with a fake compiler, streamed and in batches\n" );
+    printf( "    -shaders    shaders to generate (default 64)\n" );
+    printf( "    -processes  compiler processes at once (default: all cores)\n" );
+    printf( "    -compile    time a shader takes to compile (default 40 ms)\n" );
+    printf( "    -slow       every n-th shader compiles ten times as long (default 8, 0 for none)\n" );
+    printf( "    -cached     every n-th shader is unchanged and not compiled (default 4, 0 for none)\n" );
+    printf( "    -first      every n-th shader is needed by the first frame (default 8, 0 to skip timing the first frame)\n" );
+    printf( "  ShaderCacheTool hash [-kb n]\n" );
+    printf( "    checks the shader hash and times hashing a preprocessed shader (default 512 KB)\n" );
+    printf( "  ShaderCacheTool archive [-shaders n] [-kb n]\n" );
+    printf( "    checks the shader archive and times loading shaders of about n KB from it (default 2000 shaders, 8 KB)\n" );
+    printf( "  ShaderCacheTool deps [-shaders n] [-headers n]\n" );
+    printf( "    checks include scanning and the dependency graph, and times checking unchanged shaders (default 500 shaders, 40 headers)\n" );
+    printf( "  ShaderCacheTool perms [-permutations n]\n" );
+    printf( "    checks shader options and the permutation table, and times looking permutations up (default 4096)\n" );
+    printf( "  ShaderCacheTool watch [-shaders n] [-headers n]\n" );
+    printf( "    checks the directory watcher, and times checking only the files it reports (default 500 shaders, 40 headers)\n" );
+    printf( "  ShaderCacheTool remote [-shaders n] [-processes n] [-compile ms]\n" );
+    printf( "    checks the cache server protocol, and times compiling with a fake compiler against fetching from a server (default 64 shaders, 40 ms)\n" );
+    printf( "  ShaderCacheTool compress [-shaders n] [-kb n] [-threads n]\n" );
+    printf( "    checks LZ4 compression and compressed archives, and times loading them against raw ones (default 2000 shaders, 16 KB, all cores)\n" );
+    printf( "  ShaderCacheTool profile [-shaders n] [-processes n] [-compile ms]\n" );
+    printf( "    checks the startup profile, and reports the stages and slowest shaders of compiling with a fake compiler (default 64 shaders, 40 ms)\n" );
+}
+
+
+//--------------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    // Started by the schedule command as the fake compiler
+    if ( argc >= 4 && strcmp( argv[1], "fakefxc" ) == 0 )
+    {
+        return RunFakeCompiler( (unsigned int)atoi( argv[2] ), argv[3], argc >= 5 && strcmp( argv[4], "-fail" ) == 0 );
+    }
+
+    if ( argc < 2 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if ( strcmp( argv[1], "schedule" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        ScheduleOptions Options;
+        Options.uShaders = 64;
+        Options.uProcesses = std::thread::hardware_concurrency();
+        Options.uCompileMs = 40;
+        Options.uSlowEvery = 8;
+        Options.uCachedEvery = 4;
+        Options.uFirstEvery = 8;
+
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )           Options.uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-processes" ) == 0 )    Options.uProcesses = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-compile" ) == 0 )      Options.uCompileMs = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-slow" ) == 0 )         Options.uSlowEvery = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-cached" ) == 0 )       Options.uCachedEvery = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-first" ) == 0 )        Options.uFirstEvery = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uShaders == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uProcesses = ( Options.uProcesses > 0 ) ? Options.uProcesses : 1;
+        Options.uProcesses = ( Options.uProcesses > ShaderProcessPlatform::GetDefault().GetMaxProcesses() ) ? ShaderProcessPlatform::GetDefault().GetMaxProcesses() : Options.uProcesses;
+
+        if ( !FindToolPath( argv[0] ) )
+        {
+            printf( "Error: can't find the path of the tool, to start it as the fake compiler\n" );
+            return 1;
+        }
+
+        return BenchmarkSchedule( Options ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "hash" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uKB = 512;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-kb" ) == 0 )    uKB = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uKB == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkHash( uKB ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "archive" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uShaders = 2000;
+        unsigned int uKB = 8;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )   uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-kb" ) == 0 )   uKB = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uShaders == 0 || uKB == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkArchive( uShaders, uKB ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "deps" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uShaders = 500;
+        unsigned int uHeaders = 40;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )       uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-headers" ) == 0 )  uHeaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uShaders == 0 || uHeaders == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkDependencies( uShaders, uHeaders ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "perms" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uPermutations = 4096;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-permutations" ) == 0 )  uPermutations = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uPermutations == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkPermutations( uPermutations ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "watch" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uShaders = 500;
+        unsigned int uHeaders = 40;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )       uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-headers" ) == 0 )  uHeaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uShaders == 0 || uHeaders == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkWatch( uShaders, uHeaders ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "remote" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        ScheduleOptions Options;
+        Options.uShaders = 64;
+        Options.uProcesses = std::thread::hardware_concurrency();
+        Options.uCompileMs = 40;
+        Options.uSlowEvery = 0;
+        Options.uCachedEvery = 0;
+        Options.uFirstEvery = 0;
+
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )           Options.uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-processes" ) == 0 )    Options.uProcesses = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-compile" ) == 0 )      Options.uCompileMs = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uShaders < 2 )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uProcesses = ( Options.uProcesses > 0 ) ? Options.uProcesses : 1;
+        Options.uProcesses = ( Options.uProcesses > ShaderProcessPlatform::GetDefault().GetMaxProcesses() ) ? ShaderProcessPlatform::GetDefault().GetMaxProcesses() : Options.uProcesses;
+
+        if ( !FindToolPath( argv[0] ) )
+        {
+            printf( "Error: can't find the path of the tool, to start it as the fake compiler\n" );
+            return 1;
+        }
+
+        return BenchmarkRemote( Options ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "compress" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uShaders = 2000;
+        unsigned int uKB = 16;
+        unsigned int uThreads = std::thread::hardware_concurrency();
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )       uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-kb" ) == 0 )       uKB = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-threads" ) == 0 )  uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uShaders < 2 || uKB == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkCompression( uShaders, uKB, ( uThreads > 0 ) ? uThreads : 1 ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "profile" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        ScheduleOptions Options;
+        Options.uShaders = 64;
+        Options.uProcesses = std::thread::hardware_concurrency();
+        Options.uCompileMs = 40;
+        Options.uSlowEvery = 8;
+        Options.uCachedEvery = 3;     // Not 4, which would leave none of the slow shaders to compile
+        Options.uFirstEvery = 0;
+
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-shaders" ) == 0 )           Options.uShaders = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-processes" ) == 0 )    Options.uProcesses = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-compile" ) == 0 )      Options.uCompileMs = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uShaders < 2 )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uProcesses = ( Options.uProcesses > 0 ) ? Options.uProcesses : 1;
+        Options.uProcesses = ( Options.uProcesses > ShaderProcessPlatform::GetDefault().GetMaxProcesses() ) ? ShaderProcessPlatform::GetDefault().GetMaxProcesses() : Options.uProcesses;
+
+        if ( !FindToolPath( argv[0] ) )
+        {
+            printf( "Error: can't find the path of the tool, to start it as the fake compiler\n" );
+            return 1;
+        }
+
+        return BenchmarkProfile( Options ) ? 0 : 1;
+    }
+
+    PrintUsage();
+    return 1;
+}
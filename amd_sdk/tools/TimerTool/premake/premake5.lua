@@ -0,0 +1,56 @@
+dofile ("../../../../premake/amd_premake_util.lua")
+
+-- Headless benchmarks for the timing code in AMD_SDK that has no DirectX dependency.
+-- Builds on Windows and, with e.g. "premake5 gmake", on Linux.
+
+workspace "TimerTool"
+   configurations { "Debug", "Release" }
+   platforms { "x64" }
+   location "../build"
+   filename ("TimerTool" .. _AMD_VS_SUFFIX)
+   startproject "TimerTool"
+
+   filter "platforms:x64"
+      architecture "x64"
+
+   filter { "platforms:x64", "action:vs*" }
+      system "Windows"
+
+project "TimerTool"
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename ("TimerTool" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}"
+   warnings "Extra"
+
+   files { "../src/**.h", "../src/**.cpp", "../../../src/TimerThreadContext.h", "../../../src/TimerThreadContext.cpp",
+           "../../../src/TimerTrace.h", "../../../src/TimerTrace.cpp",
+           "../../../src/LatencyHistogram.h", "../../../src/LatencyHistogram.cpp",
+           "../../../src/TimerNameTable.h", "../../../src/TimerNameTable.cpp",
+           "../../../src/GpuQueryPool.h", "../../../src/GpuQueryPool.cpp",
+           "../../../src/GpuClockMapper.h", "../../../src/GpuClockMapper.cpp",
+           "../../../src/FrameCounters.h", "../../../src/FrameCounters.cpp",
+           "../../../../dxut/Core/DXUTClock.h" }
+   includedirs { "../../../src", "../../../../dxut/Core" }
+
+   filter "action:vs*"
+      -- Specify WindowsTargetPlatformVersion here for VS2015
+      windowstarget (_AMD_WIN_SDK_VERSION)
+      defines { "WIN32", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS", "_WIN32_WINNT=0x0601" }
+
+   filter "action:not vs*"
+      buildoptions { "-std=c++11", "-pthread" }
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "_DEBUG", "DEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "NDEBUG" }
+      flags { "Symbols", "FatalWarnings", "Unicode" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
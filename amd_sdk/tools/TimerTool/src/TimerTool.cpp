@@ -0,0 +1,1559 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: TimerTool.cpp
+//
+// Headless benchmarks for the timing code shared with TimerEx.
+//
+//   TimerTool threads [-threads n] [-frames n] [-scopes n] [-depth n]
+//   TimerTool trace <output.json> [-threads n] [-frames n] [-scopes n]
+//   TimerTool histogram [-samples n]
+//   TimerTool lookup [-siblings n] [-scopes n]
+//   TimerTool clock [-seconds s]
+//   TimerTool gpupool [-frames n] [-scopes n]
+//   TimerTool gpuclock [-seconds n] [-drift ppm]
+//   TimerTool counters [-threads n] [-frames n] [-adds n]
+//
+// threads measures the cost of recording a begin/end pair into a ThreadTimingContext,
+// the path TimerEx takes for TIMER_Begin/TIMER_End on any thread but its owner. Every
+// producer thread records the given number of scopes per frame, nested depth deep, and
+// the main thread drains all contexts between frames like TIMER_Reset does. The cost per
+// scope is compared with reading the clock alone and with appending to a shared vector
+// under a mutex. Every recorded scope is checked to be drained exactly once. Then rounds of
+// short-lived threads release their contexts with a scope left open, which is checked to be
+// closed and the contexts to be reused by the next round.
+//
+// trace writes synthetic scopes from several threads through the TraceWriter that
+// TIMER_StartCapture uses, and prints what queuing an event costs the recording thread,
+// while the writer thread streams the file. The file is read back and its events counted.
+//
+// histogram feeds frame times with occasional spikes into a LatencyHistogram, prints the
+// cost of recording a sample and checks its percentiles against the exact percentiles of
+// the same window of samples.
+//
+// lookup compares the ways TimerEx finds the timer to start among the children of the
+// current timer: comparing names as TIMER_Begin does, comparing ids interned by a
+// TimerNameTable, and the timer cached by a TIMER_BeginStatic call site. TimerEx itself
+// needs a D3D11 device, so this runs the same loops on a list of nodes laid out like its tree.
+//
+// clock prints the source CDXUTClock picked, its calibrated frequency and the cost of a
+// read next to std::chrono::steady_clock, and how far it drifts from steady_clock.
+//
+// gpupool drives the GpuQueryPool behind GpuTimer with a fake backend whose GPU finishes
+// frames a few frames late, and checks that every scope comes back once, to its client,
+// with its frame and duration, without the pool ever waiting. It also runs a GPU too far
+// behind, where frames have to be dropped, and more scopes than fit into a frame.
+//
+// gpuclock checks the GpuClockMapper that places GPU timestamps on the CPU timeline
+// against synthetic clocks that drift apart, and compares it with a single calibration.
+//
+// counters adds to the frame counters of a FrameCounterRegistry from several threads and
+// ends a frame between the threads' frames, checking every frame's values. The cost of an
+// add is compared with an atomic add to counters shared by all threads. Then the frames
+// are ended while the threads keep adding, and the values must still add up.
+//--------------------------------------------------------------------------------------
+#include "TimerThreadContext.h"
+#include "TimerTrace.h"
+#include "LatencyHistogram.h"
+#include "TimerNameTable.h"
+#include "GpuQueryPool.h"
+#include "GpuClockMapper.h"
+#include "FrameCounters.h"
+#include "DXUTClock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+using namespace AMD;
+
+// Settings for the threads command
+struct ThreadsOptions
+{
+    unsigned int    uThreads;
+    unsigned int    uFrames;
+    unsigned int    uScopes;        // Per thread and frame
+    unsigned int    uDepth;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+
+//--------------------------------------------------------------------------------------
+static long long GetTicks()
+{
+    return (long long)Clock::now().time_since_epoch().count();
+}
+
+
+//--------------------------------------------------------------------------------------
+static double ElapsedSeconds( Clock::time_point Start )
+{
+    return std::chrono::duration<double>( Clock::now() - Start ).count();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Counts the drained scopes and checks that they are well formed
+struct ScopeCounter
+{
+    unsigned long long  uScopes;
+    unsigned long long  uErrors;
+
+    void operator()( const ThreadTimingContext&, const wchar_t* const* ppPath, unsigned int uDepth, long long iBegin, long long iEnd )
+    {
+        uScopes++;
+        if ( iEnd < iBegin || uDepth == 0 || uDepth > TIMER_THREAD_MAX_DEPTH || wcscmp( ppPath[0], L"Scope 0" ) != 0 )
+        {
+            uErrors++;
+        }
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Lets the producers run one frame at a time, so the main thread can drain in between
+class FrameGate
+{
+public:
+
+    FrameGate( unsigned int uThreads ) : m_uThreads( uThreads ), m_uDone( 0 ), m_uFrame( 0 ) {}
+
+    // Producer: wait until frame uFrame may start
+    void WaitForFrame( unsigned int uFrame ) const
+    {
+        while ( m_uFrame.load( std::memory_order_acquire ) < uFrame )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void FinishFrame() { m_uDone.fetch_add( 1, std::memory_order_acq_rel ); }
+
+    // Main thread: wait for all producers to finish the current frame, then start the next one
+    void WaitForProducers()
+    {
+        while ( m_uDone.load( std::memory_order_acquire ) < m_uThreads )
+        {
+            std::this_thread::yield();
+        }
+        m_uDone.store( 0, std::memory_order_relaxed );
+    }
+
+    void StartFrame() { m_uFrame.fetch_add( 1, std::memory_order_acq_rel ); }
+
+private:
+
+    const unsigned int          m_uThreads;
+    std::atomic<unsigned int>   m_uDone;
+    std::atomic<unsigned int>   m_uFrame;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Records uScopes scopes in groups nested uDepth deep
+static void RecordScopes( ThreadTimingContext* pContext, const ThreadsOptions& Options )
+{
+    static const wchar_t* s_szNames[] = { L"Scope 0", L"Scope 1", L"Scope 2", L"Scope 3" };
+
+    for ( unsigned int i = 0; i + Options.uDepth <= Options.uScopes; i += Options.uDepth )
+    {
+        for ( unsigned int d = 0; d < Options.uDepth; d++ )
+        {
+            pContext->Begin( s_szNames[d & 3], GetTicks() );
+        }
+        for ( unsigned int d = 0; d < Options.uDepth; d++ )
+        {
+            pContext->End( GetTicks() );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs Record( Seconds ) on every producer thread once per frame and Drain() on the main
+// thread in between. Returns the recording time summed over all threads.
+template <class RecordFunc, class DrainFunc>
+static double RunFrames( const ThreadsOptions& Options, RecordFunc Record, DrainFunc Drain )
+{
+    FrameGate Gate( Options.uThreads );
+    std::vector<double> Seconds( Options.uThreads, 0.0 );
+
+    std::vector<std::thread> Producers;
+    for ( unsigned int t = 0; t < Options.uThreads; t++ )
+    {
+        Producers.push_back( std::thread( [&, t]()
+        {
+            for ( unsigned int f = 1; f <= Options.uFrames; f++ )
+            {
+                Gate.WaitForFrame( f );
+                Clock::time_point Start = Clock::now();
+                Record();
+                Seconds[t] += ElapsedSeconds( Start );
+                Gate.FinishFrame();
+            }
+        } ) );
+    }
+
+    for ( unsigned int f = 1; f <= Options.uFrames; f++ )
+    {
+        Gate.StartFrame();
+        Gate.WaitForProducers();
+        Drain();
+    }
+
+    double fTotal = 0.0;
+    for ( unsigned int t = 0; t < Options.uThreads; t++ )
+    {
+        Producers[t].join();
+        fTotal += Seconds[t];
+    }
+    return fTotal;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkThreads( const ThreadsOptions& Options )
+{
+    const unsigned int uScopesPerFrame = Options.uScopes / Options.uDepth * Options.uDepth;
+    const double fTotalScopes = (double)Options.uThreads * Options.uFrames * uScopesPerFrame;
+    bool bSuccess = true;
+
+    printf( "%u threads, %u frames, %u scopes per thread and frame, nested %u deep\n",
+        Options.uThreads, Options.uFrames, uScopesPerFrame, Options.uDepth );
+
+    // Reading the clock alone, twice per scope
+    {
+        const unsigned int uReads = 1000000;
+        Clock::time_point Start = Clock::now();
+        long long iSum = 0;
+        for ( unsigned int i = 0; i < uReads; i++ )
+        {
+            iSum += GetTicks();
+            iSum -= GetTicks();
+        }
+        double fSeconds = ElapsedSeconds( Start );
+        printf( "  clock only:       %7.1f ns/scope%s\n", fSeconds * 1e9 / uReads, ( iSum > 0 ) ? " " : "" );
+    }
+
+    // Per-thread contexts, drained between frames
+    {
+        ThreadTimingRegistry Registry;
+        ScopeCounter Counter = { 0, 0 };
+
+        double fSeconds = RunFrames( Options,
+            [&]() { RecordScopes( Registry.GetContext(), Options ); },
+            [&]()
+            {
+                for ( ThreadTimingContext* pContext = Registry.GetFirst(); pContext; pContext = pContext->GetNext() )
+                {
+                    pContext->Drain( Counter );
+                }
+            } );
+
+        unsigned long long uDropped = 0;
+        for ( ThreadTimingContext* pContext = Registry.GetFirst(); pContext; pContext = pContext->GetNext() )
+        {
+            uDropped += pContext->GetDroppedScopes();
+        }
+
+        printf( "  thread contexts:  %7.1f ns/scope, %llu drained, %llu dropped\n",
+            fSeconds * 1e9 / fTotalScopes, Counter.uScopes, uDropped );
+
+        if ( (double)( Counter.uScopes + uDropped ) != fTotalScopes || Counter.uErrors > 0 )
+        {
+            printf( "Error: %.0f scopes recorded, %llu drained, %llu dropped, %llu malformed\n",
+                fTotalScopes, Counter.uScopes, uDropped, Counter.uErrors );
+            bSuccess = false;
+        }
+    }
+
+    // Short-lived threads, each leaving a scope open when it releases its context
+    {
+        ThreadTimingRegistry Registry;
+        ScopeCounter Counter = { 0, 0 };
+        const unsigned int uRounds = 4;
+
+        for ( unsigned int r = 0; r < uRounds; r++ )
+        {
+            std::vector<std::thread> Workers;
+            for ( unsigned int t = 0; t < Options.uThreads; t++ )
+            {
+                Workers.push_back( std::thread( [&]()
+                {
+                    ThreadTimingContext* pContext = Registry.GetContext();
+                    pContext->Begin( L"Scope 0", GetTicks() );
+                    pContext->Begin( L"Scope 1", GetTicks() );
+                    pContext->End( GetTicks() );
+                    Registry.ReleaseContext( GetTicks() );
+                } ) );
+            }
+            for ( unsigned int t = 0; t < Options.uThreads; t++ )
+            {
+                Workers[t].join();
+            }
+
+            for ( ThreadTimingContext* pContext = Registry.GetFirst(); pContext; pContext = pContext->GetNext() )
+            {
+                pContext->Drain( Counter );
+            }
+        }
+
+        unsigned int uContexts = 0;
+        for ( ThreadTimingContext* pContext = Registry.GetFirst(); pContext; pContext = pContext->GetNext() )
+        {
+            uContexts++;
+        }
+
+        printf( "  released threads: %u contexts for %u threads, %llu scopes drained\n",
+            uContexts, uRounds * Options.uThreads, Counter.uScopes );
+
+        if ( uContexts > Options.uThreads || Counter.uScopes != 2ull * uRounds * Options.uThreads || Counter.uErrors > 0 )
+        {
+            printf( "Error: expected at most %u contexts and %u scopes, %llu malformed\n",
+                Options.uThreads, 2 * uRounds * Options.uThreads, Counter.uErrors );
+            bSuccess = false;
+        }
+    }
+
+    // Baseline: one shared list under a mutex
+    {
+        struct Scope { const wchar_t* szName; long long iBegin, iEnd; };
+        std::vector<Scope> Scopes;
+        std::mutex Mutex;
+
+        double fSeconds = RunFrames( Options,
+            [&]()
+            {
+                for ( unsigned int i = 0; i < uScopesPerFrame; i++ )
+                {
+                    Scope S = { L"Scope", GetTicks(), 0 };
+                    S.iEnd = GetTicks();
+                    std::lock_guard<std::mutex> Lock( Mutex );
+                    Scopes.push_back( S );
+                }
+            },
+            [&]() { Scopes.clear(); } );
+
+        printf( "  mutex + vector:   %7.1f ns/scope\n", fSeconds * 1e9 / fTotalScopes );
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Counts the complete events in a trace file and checks that the file was closed
+static bool CountTraceEvents( const char* szFileName, unsigned long long& uEvents )
+{
+    FILE* pFile = fopen( szFileName, "rb" );
+    if ( !pFile )
+    {
+        return false;
+    }
+
+    std::vector<char> Text;
+    char Buffer[65536];
+    size_t uRead;
+    while ( ( uRead = fread( Buffer, 1, sizeof( Buffer ), pFile ) ) > 0 )
+    {
+        Text.insert( Text.end(), Buffer, Buffer + uRead );
+    }
+    fclose( pFile );
+    Text.push_back( 0 );
+
+    uEvents = 0;
+    for ( const char* p = strstr( &Text[0], "\"ph\":\"X\"" ); p; p = strstr( p + 1, "\"ph\":\"X\"" ) )
+    {
+        uEvents++;
+    }
+
+    return Text.size() >= 4 && strcmp( &Text[Text.size() - 4], "]}\n" ) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkTrace( const char* szFileName, const ThreadsOptions& Options )
+{
+    wchar_t szWideName[1024];
+    if ( mbstowcs( szWideName, szFileName, 1024 ) >= 1024 )
+    {
+        printf( "Error: file name too long\n" );
+        return false;
+    }
+
+    AMD::TraceWriter Writer;
+    if ( !Writer.Open( szWideName ) )
+    {
+        printf( "Error: can't create %s\n", szFileName );
+        return false;
+    }
+
+    printf( "%u threads, %u frames, %u scopes per thread and frame\n", Options.uThreads, Options.uFrames, Options.uScopes );
+
+    for ( unsigned int t = 0; t < Options.uThreads; t++ )
+    {
+        char szTrack[32];
+        snprintf( szTrack, sizeof( szTrack ), "Thread %u", t );
+        Writer.SetTrackName( t, szTrack );
+    }
+
+    const Clock::time_point Start = Clock::now();
+    const double fTotalEvents = (double)Options.uThreads * Options.uFrames * Options.uScopes;
+
+    // Each frame a thread queues its scopes back to back, so it takes roughly as long as queuing them
+    std::vector<double> Seconds( Options.uThreads, 0.0 );
+    std::vector<std::thread> Producers;
+    for ( unsigned int t = 0; t < Options.uThreads; t++ )
+    {
+        Producers.push_back( std::thread( [&, t]()
+        {
+            AMD::TraceEvent Event;
+            AMD::SetTraceEventName( Event, L"Scope" );
+            Event.uTrack = t;
+
+            for ( unsigned int f = 0; f < Options.uFrames; f++ )
+            {
+                Clock::time_point FrameStart = Clock::now();
+                for ( unsigned int i = 0; i < Options.uScopes; i++ )
+                {
+                    Event.uFrame = f;
+                    Event.fBeginUs = std::chrono::duration<double, std::micro>( Clock::now() - Start ).count();
+                    Event.fDurationUs = 1.0;
+                    Writer.Add( Event );
+                }
+                Seconds[t] += ElapsedSeconds( FrameStart );
+            }
+        } ) );
+    }
+
+    double fSeconds = 0.0;
+    for ( unsigned int t = 0; t < Options.uThreads; t++ )
+    {
+        Producers[t].join();
+        fSeconds += Seconds[t];
+    }
+    const unsigned int uWrittenBeforeClose = Writer.GetWrittenEvents();
+    const double fRecordSeconds = ElapsedSeconds( Start );
+
+    Writer.Close();
+    const double fTotalSeconds = ElapsedSeconds( Start );
+
+    printf( "  queue event:      %7.1f ns/event\n", fSeconds * 1e9 / fTotalEvents );
+    printf( "  recording:        %7.1f ms, %u events written meanwhile\n", fRecordSeconds * 1e3, uWrittenBeforeClose );
+    printf( "  closing:          %7.1f ms\n", ( fTotalSeconds - fRecordSeconds ) * 1e3 );
+
+    unsigned long long uEvents = 0;
+    if ( !CountTraceEvents( szFileName, uEvents ) || (double)uEvents != fTotalEvents )
+    {
+        printf( "Error: %.0f events queued, %llu found in %s\n", fTotalEvents, uEvents, szFileName );
+        return false;
+    }
+    printf( "  %llu events in %s\n", uEvents, szFileName );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Exact percentile of a sorted list, with the same rank rule as LatencyHistogram
+static double ExactPercentile( const std::vector<double>& Sorted, double fPercentile )
+{
+    double fRank = fPercentile * 0.01 * Sorted.size();
+    size_t uRank = ( fRank < 1.0 ) ? 1 : (size_t)fRank;
+    uRank += ( uRank < fRank ) ? 1 : 0;
+    uRank = ( uRank < Sorted.size() ) ? uRank : Sorted.size();
+
+    return Sorted[uRank - 1];
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkHistogram( unsigned int uSamples )
+{
+    // Frame times around 2 ms, with a spike of 5 to 15 times that every hundred frames or so
+    std::mt19937 Random( 1 );
+    std::normal_distribution<double> FrameTime( 2e-3, 0.2e-3 );
+    std::uniform_real_distribution<double> Uniform( 0.0, 1.0 );
+
+    std::vector<double> Samples( uSamples );
+    for ( unsigned int i = 0; i < uSamples; i++ )
+    {
+        Samples[i] = std::max( FrameTime( Random ), 0.0 );
+        if ( Uniform( Random ) < 0.01 )
+        {
+            Samples[i] *= 5.0 + 10.0 * Uniform( Random );
+        }
+    }
+
+    printf( "%u samples, window of %u, %u buckets (%u bytes)\n", uSamples, AMD::LATENCY_HISTOGRAM_WINDOW,
+        AMD::LATENCY_HISTOGRAM_BUCKETS, (unsigned int)sizeof( AMD::LatencyHistogram ) );
+
+    // Cost of a sample
+    {
+        AMD::LatencyHistogram Histogram;
+        Clock::time_point Start = Clock::now();
+        for ( unsigned int i = 0; i < uSamples; i++ )
+        {
+            Histogram.Record( Samples[i] );
+        }
+        double fSeconds = ElapsedSeconds( Start );
+
+        Start = Clock::now();
+        AMD::LatencyPercentiles Percentiles;
+        Histogram.GetPercentiles( Percentiles );
+        double fQuerySeconds = ElapsedSeconds( Start );
+
+        printf( "  record:           %7.1f ns/sample\n", fSeconds * 1e9 / uSamples );
+        printf( "  p50/p90/p99/max:  %7.1f us\n", fQuerySeconds * 1e6 );
+    }
+
+    // Accuracy, checked at many points of the sliding window
+    AMD::LatencyHistogram Histogram;
+    std::vector<double> Window;
+    const double fPercentiles[] = { 50.0, 90.0, 99.0, 100.0 };
+    double fMaxError = 0.0;
+
+    for ( unsigned int i = 0; i < uSamples; i++ )
+    {
+        Histogram.Record( Samples[i] );
+        if ( ( i % 97 ) != 0 && i != uSamples - 1 )
+        {
+            continue;
+        }
+
+        const unsigned int uFirst = ( i + 1 > AMD::LATENCY_HISTOGRAM_WINDOW ) ? i + 1 - AMD::LATENCY_HISTOGRAM_WINDOW : 0;
+        Window.assign( Samples.begin() + uFirst, Samples.begin() + i + 1 );
+        std::sort( Window.begin(), Window.end() );
+
+        for ( size_t p = 0; p < sizeof( fPercentiles ) / sizeof( fPercentiles[0] ); p++ )
+        {
+            const double fExact = ExactPercentile( Window, fPercentiles[p] );
+            const double fApprox = Histogram.GetPercentile( fPercentiles[p] );
+            const double fError = ( fApprox - fExact ) / fExact;
+
+            // The histogram rounds up to the end of the bucket, and truncates to whole nanoseconds
+            if ( fError < -1e-9 / fExact || fError > 1.0 / ( 1 << AMD::LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) )
+            {
+                printf( "Error: p%.0f after %u samples is %.6f ms, exactly %.6f ms\n", fPercentiles[p], i + 1, fApprox * 1e3, fExact * 1e3 );
+                return false;
+            }
+            fMaxError = std::max( fMaxError, fError );
+        }
+    }
+
+    AMD::LatencyPercentiles Percentiles;
+    Histogram.GetPercentiles( Percentiles );
+    printf( "  last window:      p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        Percentiles.fP50 * 1e3, Percentiles.fP90 * 1e3, Percentiles.fP99 * 1e3, Percentiles.fMax * 1e3 );
+    printf( "  max error:        %7.2f %%\n", fMaxError * 100.0 );
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The part of TimingEvent that the lookups touch
+struct LookupNode
+{
+    wchar_t*        szName;
+    unsigned int    uNameId;
+    LookupNode*     pParent;
+    LookupNode*     pNext;
+};
+
+// Same fields as TimerSite
+struct LookupSite
+{
+    const wchar_t*  szName;
+    unsigned int    uId;
+    LookupNode*     pParent;
+    LookupNode*     pNode;
+};
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkLookup( unsigned int uSiblings, unsigned int uScopes )
+{
+    AMD::TimerNameTable Names;
+    LookupNode Parent = { NULL, 0, NULL, NULL };
+
+    // Names with a common prefix, as in "Light Batch 12", so that comparing them isn't free
+    std::vector<LookupNode> Nodes( uSiblings );
+    std::vector<std::wstring> SiteNames( uSiblings );
+    for ( unsigned int i = 0; i < uSiblings; i++ )
+    {
+        wchar_t szName[32];
+        swprintf( szName, 32, L"Light Batch %u", i );
+        SiteNames[i] = szName;
+
+        Nodes[i].szName = new wchar_t[wcslen( szName ) + 1];
+        wcscpy( Nodes[i].szName, szName );
+        Nodes[i].uNameId = Names.Intern( szName );
+        Nodes[i].pParent = &Parent;
+        Nodes[i].pNext = ( i + 1 < uSiblings ) ? &Nodes[i + 1] : NULL;
+    }
+
+    std::vector<LookupSite> Sites( uSiblings );
+    for ( unsigned int i = 0; i < uSiblings; i++ )
+    {
+        LookupSite Site = { SiteNames[i].c_str(), 0, NULL, NULL };
+        Sites[i] = Site;
+    }
+
+    printf( "%u siblings, %u scopes\n", uSiblings, uScopes );
+
+    // Each scope starts the next sibling in turn, like a loop over light batches
+    size_t uFound = 0;
+    Clock::time_point Start = Clock::now();
+    for ( unsigned int i = 0; i < uScopes; i++ )
+    {
+        const wchar_t* szName = Sites[i % uSiblings].szName;
+        LookupNode* pNode = &Nodes[0];
+        while ( pNode && wcscmp( pNode->szName, szName ) != 0 )
+        {
+            pNode = pNode->pNext;
+        }
+        uFound += ( pNode != NULL );
+    }
+    const double fStringSeconds = ElapsedSeconds( Start );
+
+    Start = Clock::now();
+    for ( unsigned int i = 0; i < uScopes; i++ )
+    {
+        LookupSite& Site = Sites[i % uSiblings];
+        if ( Site.uId == 0 )
+        {
+            Site.uId = Names.Intern( Site.szName );
+        }
+        LookupNode* pNode = &Nodes[0];
+        while ( pNode && pNode->uNameId != Site.uId )
+        {
+            pNode = pNode->pNext;
+        }
+        uFound += ( pNode != NULL );
+    }
+    const double fIdSeconds = ElapsedSeconds( Start );
+
+    Start = Clock::now();
+    for ( unsigned int i = 0; i < uScopes; i++ )
+    {
+        LookupSite& Site = Sites[i % uSiblings];
+        LookupNode* pNode = Site.pNode;
+        if ( pNode == NULL || Site.pParent != &Parent )
+        {
+            pNode = &Nodes[0];
+            while ( pNode && pNode->uNameId != Site.uId )
+            {
+                pNode = pNode->pNext;
+            }
+            Site.pParent = &Parent;
+            Site.pNode = pNode;
+        }
+        uFound += ( pNode != NULL );
+    }
+    const double fSiteSeconds = ElapsedSeconds( Start );
+
+    Start = Clock::now();
+    unsigned int uIdSum = 0;
+    for ( unsigned int i = 0; i < uScopes; i++ )
+    {
+        uIdSum += Names.Intern( Sites[i % uSiblings].szName );
+    }
+    const double fInternSeconds = ElapsedSeconds( Start );
+
+    printf( "  compare names:    %7.1f ns/scope (TIMER_Begin)\n", fStringSeconds * 1e9 / uScopes );
+    printf( "  compare ids:      %7.1f ns/scope (first run of a TIMER_BeginStatic site under a parent)\n", fIdSeconds * 1e9 / uScopes );
+    printf( "  cached timer:     %7.1f ns/scope (TIMER_BeginStatic)\n", fSiteSeconds * 1e9 / uScopes );
+    printf( "  intern a name:    %7.1f ns\n", fInternSeconds * 1e9 / uScopes );
+
+    for ( unsigned int i = 0; i < uSiblings; i++ )
+    {
+        delete[] Nodes[i].szName;
+    }
+
+    if ( uFound != 3 * (size_t)uScopes || Names.GetCount() != uSiblings || uIdSum == 0 )
+    {
+        printf( "Error: %llu of %llu lookups found their timer\n", (unsigned long long)uFound, 3ull * uScopes );
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkClock( double fSeconds )
+{
+    printf( "source:             %s\n", CDXUTClock::GetSourceName() );
+    printf( "frequency:          %lld Hz\n", CDXUTClock::GetFrequency() );
+    printf( "read overhead:      %7.1f ns (measured at startup)\n", CDXUTClock::GetReadOverhead() * 1e9 );
+
+    const unsigned int uReads = 10000000;
+    long long llLast = 0;
+    Clock::time_point Start = Clock::now();
+    for ( unsigned int i = 0; i < uReads; i++ )
+    {
+        llLast = CDXUTClock::Now();
+    }
+    const double fClockSeconds = ElapsedSeconds( Start );
+
+    Clock::time_point Last = Start;
+    Start = Clock::now();
+    for ( unsigned int i = 0; i < uReads; i++ )
+    {
+        Last = Clock::now();
+    }
+    const double fSteadySeconds = std::chrono::duration<double>( Last - Start ).count();
+
+    printf( "  CDXUTClock::Now:  %7.1f ns/read\n", fClockSeconds * 1e9 / uReads );
+    printf( "  steady_clock:     %7.1f ns/read\n", fSteadySeconds * 1e9 / uReads );
+
+    // Both clocks over the same interval
+    const long long llStart = CDXUTClock::Now();
+    Start = Clock::now();
+    do
+    {
+        llLast = CDXUTClock::Now();
+    } while ( ElapsedSeconds( Start ) < fSeconds );
+    const double fSteady = ElapsedSeconds( Start );
+    const double fMeasured = CDXUTClock::TicksToSeconds( llLast - llStart );
+    const double fDriftPpm = ( fMeasured - fSteady ) / fSteady * 1e6;
+
+    printf( "  over %.3f s:      %+.1f ppm against steady_clock\n", fSteady, fDriftPpm );
+
+    // A TSC calibrated 10x too fast or slow would be off by far more than this
+    if ( fDriftPpm < -1000.0 || fDriftPpm > 1000.0 )
+    {
+        printf( "Error: the clock runs at the wrong rate\n" );
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// A GPU that finishes frames a few frames after the CPU ended them. Now and then the
+// first poll of a finished frame finds only part of its timestamps readable, to exercise
+// partial resolves.
+class FakeGpuQueryBackend : public AMD::GpuQueryBackend
+{
+public:
+
+    FakeGpuQueryBackend() : m_uClock( 1000 ), m_uFrame( 0 ), m_uFinished( 0 ), m_uFailedGets( 0 ), m_uUnreadableFrom( 0xFFFFFFFF ), m_Random( 1 ) {}
+
+    virtual bool Create( unsigned int uFrames, unsigned int uTimestamps )
+    {
+        m_Disjoint.assign( uFrames, Query() );
+        m_Timestamps.assign( uTimestamps, Query() );
+        return true;
+    }
+
+    virtual void Destroy()
+    {
+        m_Disjoint.clear();
+        m_Timestamps.clear();
+    }
+
+    virtual void BeginDisjoint( unsigned int uFrame )
+    {
+        m_Disjoint[uFrame].uFrame = m_uFrame;
+        m_Disjoint[uFrame].bEnded = false;
+        m_Disjoint[uFrame].bPolled = false;
+    }
+
+    // Ends the CPU frame
+    virtual void EndDisjoint( unsigned int uFrame )
+    {
+        m_Disjoint[uFrame].bEnded = true;
+        m_Disjoint[uFrame].uTicks = ( ( m_uFrame % 50 ) == 49 ) ? 1 : 0;     // Every 50th frame is disjoint
+        m_uFrame++;
+    }
+
+    virtual void EndTimestamp( unsigned int uTimestamp )
+    {
+        m_Timestamps[uTimestamp].uFrame = m_uFrame;
+        m_Timestamps[uTimestamp].uTicks = m_uClock;
+        m_Timestamps[uTimestamp].bEnded = true;
+    }
+
+    virtual bool GetDisjoint( unsigned int uFrame, unsigned long long& uFrequency, bool& bDisjoint )
+    {
+        m_uUnreadableFrom = 0xFFFFFFFF;
+        if ( !IsReady( m_Disjoint[uFrame] ) )
+        {
+            return false;
+        }
+        if ( !m_Disjoint[uFrame].bPolled )
+        {
+            m_Disjoint[uFrame].bPolled = true;
+            if ( ( m_Random() % 8 ) == 0 )
+            {
+                const unsigned int uTimestamps = (unsigned int)( m_Timestamps.size() / m_Disjoint.size() );
+                m_uUnreadableFrom = uFrame * uTimestamps + m_Random() % uTimestamps;
+            }
+        }
+        uFrequency = FREQUENCY;
+        bDisjoint = ( 0 != m_Disjoint[uFrame].uTicks );
+        return true;
+    }
+
+    virtual bool GetTimestamp( unsigned int uTimestamp, unsigned long long& uTicks )
+    {
+        if ( !IsReady( m_Timestamps[uTimestamp] ) || uTimestamp >= m_uUnreadableFrom )
+        {
+            m_uFailedGets++;
+            return false;
+        }
+        uTicks = m_Timestamps[uTimestamp].uTicks;
+        return true;
+    }
+
+    // The GPU work between two timestamps. Skips ticks the pool would take for unwritten timestamps.
+    void Advance( unsigned long long uTicks )
+    {
+        m_uClock += uTicks;
+        if ( ( m_uClock & 0xFFFFFFFF ) == 0xFFFFFFFF )
+        {
+            m_uClock++;
+        }
+    }
+
+    // The GPU finished the frames before uFinished
+    void Finish( unsigned int uFinished )
+    {
+        m_uFinished = std::max( m_uFinished, uFinished );
+    }
+
+    unsigned long long GetFailedGets() const { return m_uFailedGets; }
+
+    static const unsigned long long FREQUENCY = 100000000;
+
+private:
+
+    struct Query
+    {
+        unsigned int        uFrame;
+        unsigned long long  uTicks;
+        bool                bEnded;
+        bool                bPolled;
+
+        Query() : uFrame( 0 ), uTicks( 0 ), bEnded( false ), bPolled( false ) {}
+    };
+
+    bool IsReady( const Query& Q ) const { return Q.bEnded && Q.uFrame < m_uFinished; }
+
+    std::vector<Query>  m_Disjoint;
+    std::vector<Query>  m_Timestamps;
+    unsigned long long  m_uClock;
+    unsigned int        m_uFrame;
+    unsigned int        m_uFinished;
+    unsigned long long  m_uFailedGets;
+    unsigned int        m_uUnreadableFrom;  // Timestamps not readable until the next GetDisjoint
+    std::mt19937        m_Random;
+};
+
+
+//--------------------------------------------------------------------------------------
+// What a scope is expected to resolve to, indexed by its user data - 1
+struct ExpectedGpuScope
+{
+    unsigned int        uFrame;
+    unsigned long long  uTicks;
+    unsigned int        uClient;
+    unsigned int        uResolved;
+};
+
+// Checks every result against the scope it came from, like a GpuTimer would receive it
+class CheckingGpuClient : public AMD::GpuQueryClient
+{
+public:
+
+    CheckingGpuClient( unsigned int uClient, std::vector<ExpectedGpuScope>& Expected ) :
+        m_uClient( uClient ), m_uLastUserData( 0 ), m_uInvalid( 0 ), m_uErrors( 0 ), m_Expected( Expected ) {}
+
+    virtual void OnGpuScope( const AMD::GpuScopeResult& Result )
+    {
+        if ( Result.uUserData == 0 || Result.uUserData > m_Expected.size() || Result.uUserData <= m_uLastUserData )
+        {
+            m_uErrors++;
+            return;
+        }
+        m_uLastUserData = Result.uUserData;
+
+        ExpectedGpuScope& E = m_Expected[Result.uUserData - 1];
+        E.uResolved++;
+        if ( !Result.bValid )
+        {
+            m_uInvalid++;
+        }
+        if ( E.uClient != m_uClient || E.uFrame != Result.uFrame || Result.uFrequency != FakeGpuQueryBackend::FREQUENCY ||
+             ( Result.bValid && Result.uStop - Result.uStart != E.uTicks ) )
+        {
+            m_uErrors++;
+        }
+    }
+
+    unsigned int                    m_uClient;
+    unsigned int                    m_uLastUserData;    // Scopes arrive in the order they began
+    unsigned int                    m_uInvalid;
+    unsigned int                    m_uErrors;
+    std::vector<ExpectedGpuScope>&  m_Expected;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Runs uFrames frames of uScopes scopes spread over a few clients on a GPU that lags
+// 1 to uMaxLag frames behind, and checks what came back
+static bool RunGpuPool( const char* szName, unsigned int uFrames, unsigned int uScopes, unsigned int uMaxLag,
+                        unsigned int uExpectedMaxLatency, bool bExpectDrops )
+{
+    static const unsigned int CLIENTS = 8;
+    static const unsigned int REMOVED_CLIENT = 0xFFFFFFFF;
+
+    FakeGpuQueryBackend Backend;
+    AMD::GpuQueryPool Pool;
+    if ( !Pool.Create( &Backend ) )
+    {
+        printf( "Error: failed to create the pool\n" );
+        return false;
+    }
+
+    std::vector<ExpectedGpuScope> Expected;
+    Expected.reserve( (size_t)uFrames * uScopes );
+    std::vector<CheckingGpuClient*> Clients;
+    for ( unsigned int i = 0; i < CLIENTS; i++ )
+    {
+        Clients.push_back( new CheckingGpuClient( i, Expected ) );
+    }
+
+    std::mt19937 Random( 2 );
+    unsigned int uBegun = 0;
+    unsigned int uRemoved = 0;
+    bool bRemoved = false;
+
+    Clock::time_point Start = Clock::now();
+    for ( unsigned int uFrame = 0; uFrame < uFrames; uFrame++ )
+    {
+        for ( unsigned int i = 0; i < uScopes; i++ )
+        {
+            ExpectedGpuScope E;
+            E.uFrame = Pool.GetFrame();
+            E.uTicks = 1 + Random() % 100000;
+            E.uClient = i % ( bRemoved ? CLIENTS - 1 : CLIENTS );
+            E.uResolved = 0;
+
+            const unsigned int uScope = Pool.BeginScope( Clients[E.uClient], (unsigned int)Expected.size() + 1 );
+            Backend.Advance( E.uTicks );
+            Pool.EndScope( uScope );
+            Backend.Advance( 100 );
+
+            if ( uScope != AMD::GPU_QUERY_POOL_INVALID_SCOPE )
+            {
+                Expected.push_back( E );
+                uBegun++;
+            }
+        }
+
+        // A timer destroyed halfway through, with scopes in flight that must not reach it
+        if ( uFrame == uFrames / 2 )
+        {
+            Pool.RemoveClient( Clients[CLIENTS - 1] );
+            bRemoved = true;
+
+            for ( size_t i = 0; i < Expected.size(); i++ )
+            {
+                if ( Expected[i].uClient == CLIENTS - 1 && Expected[i].uResolved == 0 )
+                {
+                    Expected[i].uClient = REMOVED_CLIENT;
+                    uRemoved++;
+                }
+            }
+        }
+
+        // Lagging 1 frame behind, the GPU is still working on the frame the CPU ends
+        const unsigned int uLag = 1 + Random() % uMaxLag;
+        Backend.Finish( ( uFrame + 1 > uLag ) ? uFrame + 1 - uLag : 0 );
+
+        Pool.NextFrame();
+    }
+    const double fSeconds = ElapsedSeconds( Start );
+
+    // Let the GPU catch up
+    Backend.Finish( Pool.GetFrame() + 1 );
+    Pool.Flush();
+
+    AMD::GpuQueryPoolStats Stats;
+    Pool.GetStats( Stats );
+
+    unsigned int uResolved = 0, uMissing = 0, uDuplicates = 0, uInvalid = 0, uErrors = 0;
+    for ( size_t i = 0; i < Expected.size(); i++ )
+    {
+        uResolved += ( Expected[i].uResolved > 0 ) ? 1 : 0;
+        uDuplicates += ( Expected[i].uResolved > 1 ) ? 1 : 0;
+        uMissing += ( Expected[i].uResolved == 0 && Expected[i].uClient != REMOVED_CLIENT ) ? 1 : 0;
+    }
+    for ( unsigned int i = 0; i < CLIENTS; i++ )
+    {
+        uInvalid += Clients[i]->m_uInvalid;
+        uErrors += Clients[i]->m_uErrors;
+        delete Clients[i];
+    }
+
+    printf( "%s: %u frames of %u scopes, GPU 1 to %u frames behind\n", szName, uFrames, uScopes, uMaxLag );
+    printf( "  per scope:        %7.1f ns, with the fake backend and the bookkeeping of this test\n", fSeconds * 1e9 / ( (double)uFrames * uScopes ) );
+    printf( "  resolved:         %u of %u scopes, %u of removed client dropped, %u invalid\n", uResolved, uBegun, uRemoved, uInvalid );
+    printf( "  frames:           %u resolved, %u dropped, at most %u frames late\n", Stats.uFramesResolved, Stats.uFramesDropped, Stats.uMaxLatency );
+    printf( "  scopes dropped:   %u, results not ready when polled: %llu\n", Stats.uScopesDropped, Backend.GetFailedGets() );
+
+    // Frames dropped by the pool lose their scopes, all others must come back once
+    bool bOk = ( uErrors == 0 && uDuplicates == 0 );
+    if ( bExpectDrops )
+    {
+        bOk = bOk && Stats.uFramesDropped > 0;
+    }
+    else
+    {
+        bOk = bOk && uMissing == 0 && Stats.uFramesDropped == 0 && Stats.uMaxLatency <= uExpectedMaxLatency;
+    }
+    if ( uScopes > Pool.GetScopesPerFrame() )
+    {
+        bOk = bOk && Stats.uScopesDropped == uFrames * ( uScopes - Pool.GetScopesPerFrame() );
+    }
+
+    if ( !bOk )
+    {
+        printf( "Error: %u missing, %u resolved twice, %u wrong results\n", uMissing, uDuplicates, uErrors );
+    }
+
+    return bOk;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkGpuPool( unsigned int uFrames, unsigned int uScopes )
+{
+    // A GPU 1 or 2 frames behind comes back 2 or 3 frames late, one more for a timestamp
+    // that wasn't readable on the first try
+    if ( !RunGpuPool( "in time", uFrames, uScopes, 2, AMD::GPU_QUERY_POOL_FRAMES, false ) )
+    {
+        return false;
+    }
+
+    // Further behind, the pool drops frames rather than waiting
+    if ( !RunGpuPool( "GPU behind", uFrames, uScopes, AMD::GPU_QUERY_POOL_FRAMES + 2, 0, true ) )
+    {
+        return false;
+    }
+
+    // More scopes than fit into a frame
+    return RunGpuPool( "overflow", uFrames, AMD::GPU_QUERY_POOL_SCOPES + 100, 2, AMD::GPU_QUERY_POOL_FRAMES, false );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Synthetic CPU and GPU clocks: the GPU clock runs fDriftPpm fast against its nominal
+// frequency and starts close to wrapping around. Calibration samples are taken once per
+// second like TimerEx does, bracketed by 5 to 40 us with an occasional 2 ms outlier,
+// and GPU timestamps of the second that follows each sample are mapped back.
+static bool BenchmarkGpuClock( unsigned int uSeconds, double fDriftPpm )
+{
+    const long long iCpuFrequency = 3000000000ll;
+    const unsigned long long uGpuFrequency = 27000000ull;
+    const long long iCpuStart = 1000000000000ll;
+    const unsigned long long uGpuStart = ~0ull - uGpuFrequency * 5;    // Wraps after 5 s
+
+    // Truth: CPU seconds to either clock
+    struct Clocks
+    {
+        long long           iCpuStart;
+        unsigned long long  uGpuStart;
+        double              fCpuFrequency;
+        double              fGpuRate;
+
+        long long Cpu( double fSeconds ) const { return iCpuStart + (long long)floor( fSeconds * fCpuFrequency + 0.5 ); }
+        unsigned long long Gpu( double fSeconds ) const { return uGpuStart + (unsigned long long)floor( fSeconds * fGpuRate + 0.5 ); }
+    };
+    const Clocks Truth = { iCpuStart, uGpuStart, (double)iCpuFrequency, (double)uGpuFrequency * ( 1.0 + fDriftPpm * 1e-6 ) };
+
+    std::mt19937 Random( 3 );
+    std::uniform_real_distribution<double> Uniform( 0.0, 1.0 );
+
+    AMD::GpuClockMapper Mapper( iCpuFrequency );
+    AMD::GpuClockMapper SinglePoint( iCpuFrequency );    // Calibrated once, as a trace capture used to be
+
+    double fMaxError = 0.0, fMaxEarlyError = 0.0, fMaxSinglePointError = 0.0, fSumError = 0.0;
+    unsigned int uMapped = 0;
+
+    for ( unsigned int uSecond = 0; uSecond < uSeconds; uSecond++ )
+    {
+        const double fWidth = ( uSecond % 7 == 3 ) ? 2e-3 : 5e-6 + 35e-6 * Uniform( Random );
+        const double fWritten = uSecond + 0.5 + Uniform( Random ) * 0.1;
+        const double fBefore = fWritten - fWidth * Uniform( Random );
+
+        Mapper.AddSample( Truth.Cpu( fBefore ), Truth.Cpu( fBefore + fWidth ), Truth.Gpu( fWritten ), uGpuFrequency );
+        if ( uSecond == 0 )
+        {
+            SinglePoint.AddSample( Truth.Cpu( fBefore ), Truth.Cpu( fBefore + fWidth ), Truth.Gpu( fWritten ), uGpuFrequency );
+        }
+
+        // The timestamps resolved until the next sample
+        for ( unsigned int i = 0; i < 10000; i++ )
+        {
+            const double fSeconds = fWritten + Uniform( Random );
+            const unsigned long long uGpu = Truth.Gpu( fSeconds );
+            const long long iCpu = Mapper.GpuToCpu( uGpu );
+
+            const double fError = fabs( (double)( iCpu - Truth.Cpu( fSeconds ) ) ) / (double)iCpuFrequency;
+            const double fSinglePointError = fabs( (double)( SinglePoint.GpuToCpu( uGpu ) - Truth.Cpu( fSeconds ) ) ) / (double)iCpuFrequency;
+
+            // One sample can't tell the drift, and a few noisy ones only roughly
+            if ( uSecond >= AMD::GPU_CLOCK_MAPPER_SAMPLES )
+            {
+                fMaxError = std::max( fMaxError, fError );
+            }
+            else
+            {
+                fMaxEarlyError = std::max( fMaxEarlyError, fError );
+            }
+            fMaxSinglePointError = std::max( fMaxSinglePointError, fSinglePointError );
+            fSumError += fError;
+            uMapped++;
+        }
+    }
+
+    // Cost of a mapping alone
+    Clock::time_point Start = Clock::now();
+    long long iSum = 0;
+    for ( unsigned int i = 0; i < 10000000; i++ )
+    {
+        iSum += Mapper.GpuToCpu( uGpuStart + i * 97ull );
+    }
+    const double fSeconds = ElapsedSeconds( Start );
+
+    printf( "gpuclock: %u s, GPU clock %+.1f ppm off its nominal frequency, wrapping after 5 s\n", uSeconds, fDriftPpm );
+    printf( "  map:              %7.1f ns/timestamp (checksum %lld)\n", fSeconds * 1e9 / 10000000.0, iSum & 0xFF );
+    printf( "  estimated drift:  %+7.2f ppm from the last %u samples\n", Mapper.GetDriftPpm(), Mapper.GetSampleCount() );
+    printf( "  error:            %7.2f us mean over %u timestamps\n", fSumError / uMapped * 1e6, uMapped );
+    printf( "  max error:        %7.2f us in the first %u s, %7.2f us after\n", fMaxEarlyError * 1e6, AMD::GPU_CLOCK_MAPPER_SAMPLES, fMaxError * 1e6 );
+    printf( "  single sample:    %7.2f us max\n", fMaxSinglePointError * 1e6 );
+
+    bool bOk = true;
+
+    // The tightest samples are bracketed by a few us, drift correction must keep the error
+    // close to that however long the run, where a single sample drifts off
+    if ( fMaxError > 20e-6 )
+    {
+        printf( "Error: mapped timestamps are off by up to %.2f us\n", fMaxError * 1e6 );
+        bOk = false;
+    }
+    if ( fabs( Mapper.GetDriftPpm() - fDriftPpm ) > 2.0 )
+    {
+        printf( "Error: the drift was estimated at %+.2f ppm\n", Mapper.GetDriftPpm() );
+        bOk = false;
+    }
+
+    // A new GPU frequency invalidates the samples
+    Mapper.AddSample( iCpuStart, iCpuStart + 1000, 12345, uGpuFrequency * 2 );
+    if ( Mapper.GetSampleCount() != 1 || Mapper.GpuToCpu( 12345 ) != iCpuStart + 500 )
+    {
+        printf( "Error: a change of GPU frequency kept the old samples\n" );
+        bOk = false;
+    }
+
+    return bOk;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool BenchmarkCounters( const ThreadsOptions& Options )
+{
+    const unsigned int uCounters = FRAME_COUNTER_BUILTIN_COUNT;
+    const long long iFrameAdds = (long long)Options.uThreads * Options.uScopes;
+    const double fTotalAdds = (double)iFrameAdds * Options.uFrames;
+    bool bSuccess = true;
+
+    printf( "%u threads, %u frames, %u adds per thread and frame\n", Options.uThreads, Options.uFrames, Options.uScopes );
+
+    // Per-thread blocks, with a frame ended between the threads' frames
+    {
+        FrameCounterRegistry Registry;
+        unsigned int uBadFrames = 0;
+
+        double fSeconds = RunFrames( Options,
+            [&]()
+            {
+                for ( unsigned int i = 0; i < Options.uScopes; i++ )
+                {
+                    Registry.Add( i % uCounters, 1 );
+                }
+            },
+            [&]()
+            {
+                Registry.EndFrame();
+                long long iSum = 0;
+                for ( unsigned int c = 0; c < uCounters; c++ )
+                {
+                    iSum += Registry.GetFrameValue( c );
+                }
+                uBadFrames += ( iSum != iFrameAdds ) ? 1 : 0;
+            } );
+
+        printf( "  thread blocks:    %7.1f ns/add, %u frames ended\n", fSeconds * 1e9 / fTotalAdds, Registry.GetFrameCount() );
+
+        if ( uBadFrames > 0 )
+        {
+            printf( "Error: %u of %u frames don't count %lld adds\n", uBadFrames, Options.uFrames, iFrameAdds );
+            bSuccess = false;
+        }
+    }
+
+    // Baseline: atomic adds to counters shared by all threads
+    {
+        std::vector< std::atomic<long long> > Shared( uCounters );
+        for ( unsigned int c = 0; c < uCounters; c++ )
+        {
+            Shared[c].store( 0 );
+        }
+
+        double fSeconds = RunFrames( Options,
+            [&]()
+            {
+                for ( unsigned int i = 0; i < Options.uScopes; i++ )
+                {
+                    Shared[i % uCounters].fetch_add( 1, std::memory_order_relaxed );
+                }
+            },
+            [&]()
+            {
+                for ( unsigned int c = 0; c < uCounters; c++ )
+                {
+                    Shared[c].exchange( 0 );
+                }
+            } );
+
+        printf( "  shared atomics:   %7.1f ns/add\n", fSeconds * 1e9 / fTotalAdds );
+    }
+
+    // Frames ended while the threads keep adding. Adds that race EndFrame are counted by
+    // the next frame, so the values of all frames add up to every add.
+    {
+        FrameCounterRegistry Registry;
+        std::atomic<unsigned int> uFinished( 0 );
+
+        std::vector<std::thread> Producers;
+        for ( unsigned int t = 0; t < Options.uThreads; t++ )
+        {
+            Producers.push_back( std::thread( [&]()
+            {
+                for ( unsigned int f = 0; f < Options.uFrames; f++ )
+                {
+                    for ( unsigned int i = 0; i < Options.uScopes; i++ )
+                    {
+                        Registry.Add( i % uCounters, 1 );
+                    }
+                }
+                uFinished.fetch_add( 1 );
+            } ) );
+        }
+
+        long long iSum = 0;
+        bool bLast = false;
+        while ( !bLast )
+        {
+            bLast = ( uFinished.load() == Options.uThreads );
+            Registry.EndFrame();
+            for ( unsigned int c = 0; c < uCounters; c++ )
+            {
+                iSum += Registry.GetFrameValue( c );
+            }
+        }
+
+        for ( unsigned int t = 0; t < Options.uThreads; t++ )
+        {
+            Producers[t].join();
+        }
+
+        printf( "  racing frames:    %u frames ended, %lld adds counted\n", Registry.GetFrameCount(), iSum );
+
+        if ( (double)iSum != fTotalAdds )
+        {
+            printf( "Error: %.0f adds, %lld counted\n", fTotalAdds, iSum );
+            bSuccess = false;
+        }
+    }
+
+    return bSuccess;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf( "Usage:\n" );
+    printf( "  TimerTool threads [-threads n] [-frames n] [-scopes n] [-depth n]\n" );
+    printf( "    -threads  producer threads (default: all cores)\n" );
+    printf( "    -frames   frames to record (default 1000)\n" );
+    printf( "    -scopes   scopes recorded per thread and frame (default 1000)\n" );
+    printf( "    -depth    nesting depth of the scopes (default 2, at most %u)\n", TIMER_THREAD_MAX_DEPTH );
+    printf( "  TimerTool trace <output.json> [-threads n] [-frames n] [-scopes n]\n" );
+    printf( "    writes a Chrome trace of synthetic scopes through the background trace writer\n" );
+    printf( "  TimerTool histogram [-samples n]\n" );
+    printf( "    checks latency histogram percentiles against exact ones (default 100000 samples)\n" );
+    printf( "  TimerTool lookup [-siblings n] [-scopes n]\n" );
+    printf( "    cost of finding the timer to start among n siblings (default 32, 1000000 scopes)\n" );
+    printf( "  TimerTool clock [-seconds s]\n" );
+    printf( "    source, read cost and drift of the shared high resolution clock (default 0.5 s)\n" );
+    printf( "  TimerTool gpupool [-frames n] [-scopes n]\n" );
+    printf( "    checks the GPU query pool on a fake GPU that lags behind (default 1000 frames of 300 scopes)\n" );
+    printf( "  TimerTool gpuclock [-seconds n] [-drift ppm]\n" );
+    printf( "    checks mapping GPU timestamps to CPU time on drifting synthetic clocks (default 60 s, 50 ppm)\n" );
+    printf( "  TimerTool counters [-threads n] [-frames n] [-adds n]\n" );
+    printf( "    cost and exactness of per-thread frame counters (default all cores, 1000 frames of 10000 adds)\n" );
+}
+
+
+//--------------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    if ( argc < 2 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if ( strcmp( argv[1], "threads" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        ThreadsOptions Options;
+        Options.uThreads = std::thread::hardware_concurrency();
+        Options.uFrames = 1000;
+        Options.uScopes = 1000;
+        Options.uDepth = 2;
+
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-threads" ) == 0 )       Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-frames" ) == 0 )   Options.uFrames = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-scopes" ) == 0 )   Options.uScopes = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-depth" ) == 0 )    Options.uDepth = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uFrames == 0 || Options.uDepth == 0 || Options.uDepth > TIMER_THREAD_MAX_DEPTH || Options.uScopes < Options.uDepth )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uThreads = ( Options.uThreads > 0 ) ? Options.uThreads : 1;
+
+        return BenchmarkThreads( Options ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "trace" ) == 0 && argc >= 3 && ( argc % 2 ) == 1 )
+    {
+        ThreadsOptions Options;
+        Options.uThreads = 4;
+        Options.uFrames = 300;
+        Options.uScopes = 200;
+        Options.uDepth = 1;
+
+        for ( int i = 3; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-threads" ) == 0 )       Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-frames" ) == 0 )   Options.uFrames = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-scopes" ) == 0 )   Options.uScopes = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        Options.uThreads = ( Options.uThreads > 0 ) ? Options.uThreads : 1;
+
+        return BenchmarkTrace( argv[2], Options ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "histogram" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uSamples = 100000;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-samples" ) == 0 )       uSamples = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uSamples == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkHistogram( uSamples ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "lookup" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uSiblings = 32;
+        unsigned int uScopes = 1000000;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-siblings" ) == 0 )      uSiblings = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-scopes" ) == 0 )   uScopes = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uSiblings == 0 || uScopes == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkLookup( uSiblings, uScopes ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "clock" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        double fSeconds = 0.5;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-seconds" ) == 0 )       fSeconds = atof( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( fSeconds <= 0.0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkClock( fSeconds ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "gpupool" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uFrames = 1000;
+        unsigned int uScopes = 300;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-frames" ) == 0 )        uFrames = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-scopes" ) == 0 )   uScopes = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( uFrames < 2 || uScopes == 0 || uScopes > AMD::GPU_QUERY_POOL_SCOPES )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkGpuPool( uFrames, uScopes ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "gpuclock" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        unsigned int uSeconds = 60;
+        double fDriftPpm = 50.0;
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-seconds" ) == 0 )       uSeconds = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-drift" ) == 0 )    fDriftPpm = atof( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        // Beyond GPU_CLOCK_MAPPER_MAX_DRIFT the mapper falls back to the nominal rates
+        if ( uSeconds <= AMD::GPU_CLOCK_MAPPER_SAMPLES || fabs( fDriftPpm ) >= AMD::GPU_CLOCK_MAPPER_MAX_DRIFT * 1e6 )
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        return BenchmarkGpuClock( uSeconds, fDriftPpm ) ? 0 : 1;
+    }
+
+    if ( strcmp( argv[1], "counters" ) == 0 && ( argc % 2 ) == 0 )
+    {
+        ThreadsOptions Options;
+        Options.uThreads = std::thread::hardware_concurrency();
+        Options.uFrames = 1000;
+        Options.uScopes = 10000;
+        Options.uDepth = 1;
+
+        for ( int i = 2; i < argc; i += 2 )
+        {
+            if ( strcmp( argv[i], "-threads" ) == 0 )       Options.uThreads = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-frames" ) == 0 )   Options.uFrames = (unsigned int)atoi( argv[ i + 1 ] );
+            else if ( strcmp( argv[i], "-adds" ) == 0 )     Options.uScopes = (unsigned int)atoi( argv[ i + 1 ] );
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if ( Options.uFrames == 0 || Options.uScopes == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+        Options.uThreads = ( Options.uThreads > 0 ) ? Options.uThreads : 1;
+
+        return BenchmarkCounters( Options ) ? 0 : 1;
+    }
+
+    PrintUsage();
+    return 1;
+}
@@ -24,6 +24,11 @@
 // File: DepthBoundsTest11.cpp
 //
 // Sample showing how to use driver extensions, with the Depth Bounds Test as an example. 
+//
+// Run with -benchmark to replay a camera path over a sweep of light counts and write
+// the timers and counters of every frame to CSV and JSON (see ParseCommandLine). F7
+// records the camera to a path file and F8 replays it, or a canned path through the
+// powerplant, at a fixed frame rate.
 //--------------------------------------------------------------------------------------
 
 // DXUT now sits one directory up
@@ -61,14 +66,13 @@ using namespace DirectX;
 #define MAX_NUMBER_OF_LIGHTS                        150
 #define POINT_LIGHT_MAX_RANGE                       40.0f
 #define POINT_LIGHT_MAX_INTENSITY					0.25f
-//--------------------------------------------------------------------------------------
-// Macros
-//--------------------------------------------------------------------------------------
-#define FLOAT_POSITIVE_RANDOM(x)    ( ((x)*rand()) / RAND_MAX )
-#define FLOAT_RANDOM(x)             ((((2.0f*rand())/RAND_MAX) - 1.0f)*(x))
-#define CLIP(x)						( ( (x) > 1 || (x) < 0 ) ? 0 : (x) )
-#define MAX(x,y)					( ( (x) > (y) ) ? (x) : (y) )
-#define MIN(x,y)					( ( (x) < (y) ) ? (x) : (y) )
+#define TRACE_CAPTURE_FRAMES                        300
+#define BENCHMARK_FRAME_TIME                        ( 1.0f / 60.0f )
+#define BENCHMARK_WARMUP_FRAMES                     30
+#define BENCHMARK_GPU_LATENCY_FRAMES                AMD::GPU_QUERY_POOL_FRAMES  // Frames after a run until its last GPU times are back
+#define BENCHMARK_MAX_RUNS                          16
+#define CAMERA_RECORDING_FILENAME                   L"DepthBoundsTest11_Camera.campath"
+#define CAMERA_REPLAY_FRAME_RATE                    60.0f
 
 
 // Constant buffers
@@ -97,7 +101,10 @@ struct MAIN_CB_STRUCT
 
 	// visualization
 	float			fShowDiscardedPixels;
-	float			fPadding[3];
+
+	// reduced resolution lighting
+	float			fLightingDownsample;
+	float			fPadding[2];
 };     
 
 struct PARTICLE_DESCRIPTOR
@@ -112,21 +119,6 @@ struct QUAD_DESCRIPTOR
     XMFLOAT3 NDCPosition;    // NDC position
 };
 
-struct LIGHT_DESCRIPTOR
-{
-    // Point Light properties
-    XMVECTOR     vColor;
-
-    // Pre-transformed data
-    XMFLOAT3     vWorldSpacePosition;
-    float        fRange;
-
-    // Post-transformed data
-    XMFLOAT3     vViewSpacePosition;
-    XMFLOAT3     vNDCTile2DCoordinatesMin;
-    XMFLOAT3     vNDCTile2DCoordinatesMax;
-};
-
 struct POINT_LIGHT_STRUCTURE
 {
     XMFLOAT4     vColor;                         // Light color
@@ -165,13 +157,44 @@ ID3D11Texture2D*					g_pGBuffer[2] = { NULL, NULL };
 ID3D11RenderTargetView*				g_pGBufferRTV[2] = { NULL, NULL };
 ID3D11ShaderResourceView*			g_pGBufferSRV[2] = { NULL, NULL };
 
+// Reduced resolution lighting
+enum LIGHTING_RESOLUTION
+{
+	LIGHTING_RESOLUTION_FULL = 0,
+	LIGHTING_RESOLUTION_HALF,
+	LIGHTING_RESOLUTION_QUARTER,
+	LIGHTING_RESOLUTION_COUNT
+};
+
+struct LOW_RES_LIGHTING_BUFFERS
+{
+	UINT								uWidth;
+	UINT								uHeight;
+	ID3D11Texture2D*					pDepthStencil;			// Depth of the kept full resolution samples
+	ID3D11ShaderResourceView*			pDepthStencilSRV;
+	ID3D11DepthStencilView*				pDSV;
+	ID3D11DepthStencilView*				pReadOnlyDSV;
+	ID3D11Texture2D*					pNormal;				// Normal of the kept samples, sample index in alpha
+	ID3D11ShaderResourceView*			pNormalSRV;
+	ID3D11RenderTargetView*				pNormalRTV;
+	ID3D11Texture2D*					pLight;					// Accumulated point light
+	ID3D11ShaderResourceView*			pLightSRV;
+	ID3D11RenderTargetView*				pLightRTV;
+};
+
+LOW_RES_LIGHTING_BUFFERS			g_LowResLighting[LIGHTING_RESOLUTION_COUNT];	// Unused for LIGHTING_RESOLUTION_FULL
+
 // Shaders
 ID3D11VertexShader*                 g_pBuildingPass_StoreVS = NULL;
+ID3D11VertexShader*                 g_pDepthPrepassVS = NULL;
 ID3D11PixelShader*                  g_pBuildingPass_StorePS = NULL;
 ID3D11VertexShader*                 g_pShadingPass_FullscreenQuadVS = NULL;
 ID3D11PixelShader*                  g_pShadingPass_FullscreenLightPS = NULL;
 ID3D11VertexShader*                 g_pShadingPass_PointLightFromTileVS = NULL;
 ID3D11PixelShader*                  g_pShadingPass_PointLightFromTilePS = NULL;
+ID3D11PixelShader*                  g_pShadingPass_PointLightLowResPS = NULL;
+ID3D11PixelShader*                  g_pShadingPass_DownsampleDepthNormalPS = NULL;
+ID3D11PixelShader*                  g_pShadingPass_UpsampleLightingPS = NULL;
 ID3D11VertexShader*                 g_pParticleVS = NULL;
 ID3D11GeometryShader*               g_pParticleGS = NULL;
 ID3D11PixelShader*                  g_pParticlePS = NULL;
@@ -183,11 +206,13 @@ ID3D11ShaderResourceView*           g_pDefaultSpecularTextureRV = NULL;
 
 // The mesh
 CDXUTSDKMesh						g_SceneMesh;
+AMD::MeshletMesh					g_SceneMeshlets;			// CPU culled meshlets of g_SceneMesh
 XMFLOAT3							g_vMeshCentre(0.0f, 0.0f, 0.0f);
 ID3D11Buffer*                       g_pMainCB = NULL;
 ID3D11Buffer*                       g_pMeshCB = NULL;
 ID3D11Buffer*                       g_pPointLightArrayCB = NULL;
 ID3D11InputLayout*                  g_pMeshLayout = NULL;
+ID3D11InputLayout*                  g_pPositionOnlyLayout = NULL;
 ID3D11InputLayout*                  g_pFSQuadVertexLayout = NULL;
 ID3D11InputLayout*                  g_pQuadVertexLayout = NULL;
 ID3D11InputLayout*                  g_pParticleVertexLayout = NULL;
@@ -208,17 +233,19 @@ ID3D11DepthStencilState*            g_pLessEqualDSS = NULL;
 ID3D11DepthStencilState*            g_pGreaterDSS = NULL;
 ID3D11DepthStencilState*            g_pLessEqualNoDepthWritesDSS = NULL;
 ID3D11DepthStencilState*            g_pAlwaysDSS = NULL;
+ID3D11DepthStencilState*            g_pEqualNoDepthWritesDSS = NULL;
+ID3D11DepthStencilState*            g_pAlwaysDepthWritesDSS = NULL;
 
 // Camera and light parameters
 XMVECTOR							g_vecEye;
 XMVECTOR							g_vecAt;
 XMVECTOR							g_LightPosition;
 float                               g_fLightMaxRadius = 500.0f;
-XMFLOAT4							g_pWorldSpaceFrustumPlaneEquation[6];
+float								g_fWorldSpaceFrustumPlanes[6][4];
 
 // Point Lights
 UINT                                g_uNumberOfLights = MAX_NUMBER_OF_LIGHTS/2;
-LIGHT_DESCRIPTOR                    g_pLightArray[MAX_NUMBER_OF_LIGHTS];
+AMD::PointLight                     g_pLightArray[MAX_NUMBER_OF_LIGHTS];
 
 // Render settings
 UINT                                g_uRenderWidth;
@@ -232,6 +259,39 @@ bool								g_bDepthBoundsTest = true;
 bool								g_bShowLights = true;
 bool								g_bShowDiscardedPixels = false;
 bool								g_bRenderText = true;
+bool								g_bMeshLOD = false;
+bool								g_bMeshletCulling = false;
+bool								g_bDepthPrepass = false;
+int									g_iLightingResolution = LIGHTING_RESOLUTION_FULL;
+
+// Camera path recording (F7) and replay (F8 or -camerapath)
+AMD::CameraPath						g_CameraRecording;
+bool								g_bRecordingCamera = false;
+double								g_fRecordingStartTime = 0.0;
+AMD::CameraPath						g_CameraReplay;
+bool								g_bReplayingCamera = false;
+UINT								g_uReplayFrame = 0;
+float								g_fReplayTime = 0.0f;
+float								g_fReplayFrameRate = CAMERA_REPLAY_FRAME_RATE;	// Path time advances 1 / rate per frame, whatever the frame took
+
+// Benchmark mode, set up from the command line by ParseCommandLine
+struct BENCHMARK_SETTINGS
+{
+	bool		bEnabled;
+	UINT		uFrames;								// Measured frames per light count, after the warmup
+	UINT		uLightCounts[BENCHMARK_MAX_RUNS];		// One run per light count
+	UINT		uRuns;
+	WCHAR		szPath[MAX_PATH];						// Camera path file, orbits the lights if empty
+	WCHAR		szOutput[MAX_PATH];						// Writes <szOutput>.csv and <szOutput>.json
+	UINT		uRun;
+	UINT		uFrame;									// Frame of the current run, counting the warmup
+	UINT		uGpuFrames[BENCHMARK_GPU_LATENCY_FRAMES];	// GPU query pool frame of the last measured frames, by their row
+	LONGLONG	llFrameStart;							// QueryPerformanceCounter at the end of the previous frame
+	int			iExitCode;
+};
+BENCHMARK_SETTINGS					g_Benchmark;
+AMD::CameraPath						g_BenchmarkPath;
+AMD::BenchmarkReport				g_BenchmarkReport;
 
 
 // AGS - AMD's helper library
@@ -256,6 +316,11 @@ enum
 	IDC_DEPTHBOUNDS,
 	IDC_SHOWLIGHTS,
 	IDC_SHOWDISCARDEDPIXELS,
+	IDC_MESHLOD,
+	IDC_MESHLETCULLING,
+	IDC_DEPTHPREPASS,
+	IDC_LIGHTINGRESOLUTION_STATIC,
+	IDC_LIGHTINGRESOLUTION,
 	IDC_LIGHTCOUNTSLIDER,
 };
 
@@ -287,13 +352,23 @@ void CloseAMDExtensionInterfaces();
 HRESULT AddShadersToCache();
 void CreateGBuffers(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc );
 void DestroyGBuffers();
+HRESULT CreateSceneMeshlets( ID3D11Device* pd3dDevice );
+UINT GetLightingDownsampleFactor( int iLightingResolution );
 void BuildGBuffers(ID3D11DeviceContext* pd3dContext);
 void ShadingPasses(ID3D11DeviceContext* pd3dContext);
 void ProcessRandomLights(XMMATRIX *pViewMatrix, XMMATRIX *pProjectionMatrix);
 void PostProcessParticles(ID3D11DeviceContext* pd3dContext);
-void SetDepthBoundsFromLightRadius(UINT i, XMVECTOR *pViewVec, XMMATRIX *pViewProjection);
-void ExtractPlanesFromFrustum( XMFLOAT4* pPlaneEquation, const XMMATRIX* pMatrix, bool bNormalize=TRUE );
+void SetDepthBoundsFromLightRadius(UINT i, const XMFLOAT3* pViewVec, const XMFLOAT4X4* pViewProjection);
 bool LightInFrustum(UINT i);
+bool ParseCommandLine();
+bool LoadCameraPath( const WCHAR* szName, AMD::CameraPath& Path );
+void SetCameraRecording( bool bRecord );
+void SetCameraReplay( bool bReplay );
+void RecordCameraFrame( double fTime );
+void ReplayCameraFrameMove();
+void EndFrameCounters();
+void BenchmarkFrameMove();
+void BenchmarkEndFrame();
 
 
 //--------------------------------------------------------------------------------------
@@ -326,6 +401,12 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdL
     agsInit( &g_pAGSContext, nullptr, nullptr );
 
     InitApp();
+    if ( !ParseCommandLine() )
+    {
+        agsDeInit( g_pAGSContext );
+        return 1;
+    }
+
     DXUTInit( true, true, NULL ); // Parse the command line, show msgboxes on error, no extra command line params
     DXUTSetCursorSettings( true, true );
     DXUTCreateWindow( L"DepthBoundsTest11 v1.2" );
@@ -343,7 +424,20 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdL
     agsDeInit( g_pAGSContext );
     g_pAGSContext = nullptr;
 
-    return DXUTGetExitCode();
+    return g_Benchmark.bEnabled ? g_Benchmark.iExitCode : DXUTGetExitCode();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Builds the meshlets of the scene and starts their culling threads the first time
+// meshlet culling is on for this device, so they cost nothing while it is off
+//--------------------------------------------------------------------------------------
+HRESULT CreateSceneMeshlets( ID3D11Device* pd3dDevice )
+{
+	if ( !g_bMeshletCulling || g_SceneMeshlets.IsCreated() )
+		return S_OK;
+
+	return g_SceneMeshlets.OnCreateDevice( pd3dDevice, &g_SceneMesh );
 }
 
 
@@ -352,18 +446,7 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdL
 //--------------------------------------------------------------------------------------
 void GenerateRandomLights(XMFLOAT3* pReferencePoint, XMFLOAT3* pMaxExtents, float fMaxRange, float fMaxIntensity)
 {
-    srand(g_uRandomSeed);
-    for (UINT i=0; i<MAX_NUMBER_OF_LIGHTS; i++)
-    {
-        g_pLightArray[i].vWorldSpacePosition.x = FLOAT_RANDOM( pMaxExtents->x ) + pReferencePoint->x;
-        g_pLightArray[i].vWorldSpacePosition.y = FLOAT_RANDOM( pMaxExtents->y ) + pReferencePoint->y;
-        g_pLightArray[i].vWorldSpacePosition.z = FLOAT_RANDOM( pMaxExtents->z ) + pReferencePoint->z;
-        g_pLightArray[i].fRange = FLOAT_POSITIVE_RANDOM( fMaxRange );
-		float r = FLOAT_POSITIVE_RANDOM( fMaxIntensity );
-		float g = FLOAT_POSITIVE_RANDOM( fMaxIntensity );
-		float b = FLOAT_POSITIVE_RANDOM( fMaxIntensity );
-		g_pLightArray[i].vColor = XMVectorSet(r, g, b, 1.0f);
-    }
+	AMD::GeneratePointLights( g_pLightArray, MAX_NUMBER_OF_LIGHTS, g_uRandomSeed, &pReferencePoint->x, &pMaxExtents->x, fMaxRange, fMaxIntensity );
 }
 
 //--------------------------------------------------------------------------------------
@@ -405,6 +488,32 @@ void InitApp()
 		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight, g_bShowDiscardedPixels);
     iY += AMD::HUD::iElementDelta;
 
+ 	g_HUD.m_GUI.AddCheckBox( IDC_MESHLOD, L"Enable Mesh LOD", AMD::HUD::iElementOffset, 
+		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight, g_bMeshLOD);
+    iY += AMD::HUD::iElementDelta;
+
+ 	g_HUD.m_GUI.AddCheckBox( IDC_MESHLETCULLING, L"Enable Meshlet Culling", AMD::HUD::iElementOffset, 
+		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight, g_bMeshletCulling);
+    iY += AMD::HUD::iElementDelta;
+
+ 	g_HUD.m_GUI.AddCheckBox( IDC_DEPTHPREPASS, L"Enable Depth Prepass", AMD::HUD::iElementOffset, 
+		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight, g_bDepthPrepass);
+    iY += AMD::HUD::iElementDelta;
+
+	g_HUD.m_GUI.AddStatic( IDC_LIGHTINGRESOLUTION_STATIC, L"Point Light Resolution:", AMD::HUD::iElementOffset,
+		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight );
+	CDXUTComboBox* pCombo = NULL;
+	g_HUD.m_GUI.AddComboBox( IDC_LIGHTINGRESOLUTION, AMD::HUD::iElementOffset,
+		iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth, AMD::HUD::iElementHeight, 0, false, &pCombo );
+	if ( pCombo )
+	{
+		pCombo->AddItem( L"Full", NULL );
+		pCombo->AddItem( L"Half", NULL );
+		pCombo->AddItem( L"Quarter", NULL );
+		pCombo->SetSelectedByIndex( g_iLightingResolution );
+	}
+    iY += AMD::HUD::iElementDelta;
+
 	g_NumPointLightsSlider = new AMD::Slider( g_HUD.m_GUI, IDC_LIGHTCOUNTSLIDER, iY, L"Light Count", 1, MAX_NUMBER_OF_LIGHTS, (int&)g_uNumberOfLights );
 }
 
@@ -426,11 +535,96 @@ void RenderText()
 
     float fEffectTime = (float)TIMER_GetTime( Gpu, L"Deferred Shading" ) * 1000.0f;
 	WCHAR wcbuf[256];
+	if ( g_Benchmark.bEnabled && g_Benchmark.uRun < g_Benchmark.uRuns )
+	{
+		swprintf_s( wcbuf, 256, L"Benchmark: run %u of %u( %u lights ), frame %u of %u", g_Benchmark.uRun + 1, g_Benchmark.uRuns,
+			g_Benchmark.uLightCounts[g_Benchmark.uRun], g_Benchmark.uFrame, BENCHMARK_WARMUP_FRAMES + g_Benchmark.uFrames );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
 	swprintf_s( wcbuf, 256, L"Deferred shading cost in milliseconds( Total = %.3f )", fEffectTime );
 	g_pTxtHelper->DrawTextLine( wcbuf );
 
+	float fPointLightsTime = (float)TIMER_GetTime( Gpu, L"Deferred Shading|Point Lights" ) * 1000.0f;
+	if ( g_iLightingResolution != LIGHTING_RESOLUTION_FULL )
+	{
+		float fDownsampleTime = (float)TIMER_GetTime( Gpu, L"Deferred Shading|Downsample" ) * 1000.0f;
+		float fUpsampleTime = (float)TIMER_GetTime( Gpu, L"Deferred Shading|Upsample" ) * 1000.0f;
+		swprintf_s( wcbuf, 256, L"Point lights at 1/%u resolution( Downsample = %.3f, Lights = %.3f, Upsample = %.3f )", 
+			GetLightingDownsampleFactor( g_iLightingResolution ), fDownsampleTime, fPointLightsTime, fUpsampleTime );
+	}
+	else
+		swprintf_s( wcbuf, 256, L"Point lights at full resolution( Lights = %.3f )", fPointLightsTime );
+	g_pTxtHelper->DrawTextLine( wcbuf );
+
+	float fDepthPrepassTime = (float)TIMER_GetTime( Gpu, L"Depth Prepass" ) * 1000.0f;
+	float fGBufferTime = (float)TIMER_GetTime( Gpu, L"G-Buffer" ) * 1000.0f;
+	if ( g_bDepthPrepass && g_SceneMesh.HasPositionStreams() )
+		swprintf_s( wcbuf, 256, L"G-Buffer cost in milliseconds( Depth Prepass = %.3f, G-Buffer = %.3f )", fDepthPrepassTime, fGBufferTime );
+	else
+		swprintf_s( wcbuf, 256, L"G-Buffer cost in milliseconds( G-Buffer = %.3f )", fGBufferTime );
+	g_pTxtHelper->DrawTextLine( wcbuf );
+
+	// Percentiles show the stutters that the averages above hide
+	AMD::LatencyPercentiles Percentiles;
+	if ( TIMER_GetPercentiles( Gpu, L"Deferred Shading", Percentiles ) )
+	{
+		swprintf_s( wcbuf, 256, L"Deferred shading over %u frames( p50 = %.3f, p90 = %.3f, p99 = %.3f, max = %.3f )", 
+			Percentiles.uSamples, Percentiles.fP50 * 1000.0, Percentiles.fP90 * 1000.0, Percentiles.fP99 * 1000.0, Percentiles.fMax * 1000.0 );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+	if ( TIMER_GetPercentiles( Gpu, L"G-Buffer", Percentiles ) )
+	{
+		swprintf_s( wcbuf, 256, L"G-Buffer over %u frames( p50 = %.3f, p90 = %.3f, p99 = %.3f, max = %.3f )", 
+			Percentiles.uSamples, Percentiles.fP50 * 1000.0, Percentiles.fP90 * 1000.0, Percentiles.fP99 * 1000.0, Percentiles.fMax * 1000.0 );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+
+	if ( g_bMeshletCulling && g_SceneMeshlets.IsCreated() )
+	{
+		const AMD::MeshletCullStatistics& Stats = g_SceneMeshlets.GetStatistics();
+		swprintf_s( wcbuf, 256, L"Meshlets: %u visible, %u frustum culled, %u cone culled of %u", Stats.uVisible, Stats.uFrustumCulled, Stats.uConeCulled, Stats.uMeshlets );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+		swprintf_s( wcbuf, 256, L"Scene triangles( meshlets ) = %u of %u", Stats.uTrianglesVisible, Stats.uTriangles );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+	else if ( g_SceneMesh.HasLODs() )
+	{
+		swprintf_s( wcbuf, 256, L"Scene triangles( LOD %s ) = %llu", g_bMeshLOD ? L"on" : L"off", g_SceneMesh.GetNumTrianglesRendered() );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+
+	// What the last frame did, see EndFrameCounters
+	swprintf_s( wcbuf, 256, L"Lights: %lld drawn, %lld frustum culled of %lld( %lld depth bounds calls )", COUNTER_Get( AMD::FRAME_COUNTER_LIGHTS_DRAWN ),
+		COUNTER_Get( AMD::FRAME_COUNTER_LIGHTS_CULLED ), COUNTER_Get( AMD::FRAME_COUNTER_LIGHTS ), COUNTER_Get( AMD::FRAME_COUNTER_DEPTH_BOUNDS ) );
+	g_pTxtHelper->DrawTextLine( wcbuf );
+	swprintf_s( wcbuf, 256, L"Draw calls = %lld, state changes = %lld, mapped = %.1f KB, sprites = %lld", COUNTER_Get( AMD::FRAME_COUNTER_DRAW_CALLS ),
+		COUNTER_Get( AMD::FRAME_COUNTER_STATE_CHANGES ), COUNTER_Get( AMD::FRAME_COUNTER_BYTES_MAPPED ) / 1024.0, COUNTER_Get( AMD::FRAME_COUNTER_SPRITES_FLUSHED ) );
+	g_pTxtHelper->DrawTextLine( wcbuf );
+
     g_pTxtHelper->SetInsertionPos( 5, DXUTGetDXGIBackBufferSurfaceDesc()->Height - AMD::HUD::iElementDelta );
 	g_pTxtHelper->DrawTextLine( L"Toggle GUI    : F1" );
+	g_pTxtHelper->SetInsertionPos( 5, DXUTGetDXGIBackBufferSurfaceDesc()->Height - 2 * AMD::HUD::iElementDelta );
+	g_pTxtHelper->DrawTextLine( TIMER_IsCapturing() ? L"Capturing trace to DepthBoundsTest11_Trace.json..." : L"Capture trace : F6" );
+	g_pTxtHelper->SetInsertionPos( 5, DXUTGetDXGIBackBufferSurfaceDesc()->Height - 3 * AMD::HUD::iElementDelta );
+	if ( g_bRecordingCamera )
+	{
+		swprintf_s( wcbuf, 256, L"Recording camera to %s( %u frames ), F7 to stop", CAMERA_RECORDING_FILENAME, (UINT)g_CameraRecording.GetKeyCount() );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+	else
+	{
+		g_pTxtHelper->DrawTextLine( L"Record camera : F7" );
+	}
+	g_pTxtHelper->SetInsertionPos( 5, DXUTGetDXGIBackBufferSurfaceDesc()->Height - 4 * AMD::HUD::iElementDelta );
+	if ( g_bReplayingCamera )
+	{
+		swprintf_s( wcbuf, 256, L"Replaying camera path at %.0f fps( %.1f of %.1f s ), F8 to stop", g_fReplayFrameRate, g_fReplayTime, g_CameraReplay.GetDuration() );
+		g_pTxtHelper->DrawTextLine( wcbuf );
+	}
+	else
+	{
+		g_pTxtHelper->DrawTextLine( L"Replay camera : F8" );
+	}
 
     g_pTxtHelper->End();
 }
@@ -478,33 +672,41 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
     }
 
 	g_SceneMesh.Create( pd3dDevice, L"powerplant\\powerplant.sdkmesh", false );
+	V( CreateSceneMeshlets( pd3dDevice ) );
 
-	// Initialize point lights array
+	// The depth prepass needs a position-only stream for every mesh, disable the UI without one
+	cbPtr = g_HUD.m_GUI.GetCheckBox( IDC_DEPTHPREPASS );
+	if ( SUCCEEDED( g_SceneMesh.CreatePositionStreams( pd3dDevice ) ) )
+	{
+		cbPtr->SetEnabled( true );
+		cbPtr->SetChecked( g_bDepthPrepass );
+	}
+	else
+	{
+		cbPtr->SetChecked( false );
+		cbPtr->SetEnabled( false );
+	}
+
+	// Initialize point lights array, in the box around the meshes
 	UINT numMeshes = g_SceneMesh.GetNumMeshes();
-	XMFLOAT3 LightExtents(-D3D11_FLOAT32_MAX,-D3D11_FLOAT32_MAX,-D3D11_FLOAT32_MAX);
-	XMFLOAT3 meshExtents;
-	XMFLOAT3 meshCenter;
-	XMFLOAT3 center(0,0,0);
+	std::vector<XMFLOAT3> meshCenters( numMeshes );
+	std::vector<XMFLOAT3> meshExtents( numMeshes );
 	for (UINT i = 0; i < numMeshes; i++)
 	{
-		XMStoreFloat3(&meshExtents, g_SceneMesh.GetMeshBBoxExtents(i));
-		meshExtents.x = meshExtents.x * BACKGROUND_MESH_SCALE;
-		meshExtents.y = meshExtents.y * BACKGROUND_MESH_SCALE;
-		meshExtents.z = meshExtents.z * BACKGROUND_MESH_SCALE;
-		LightExtents.x = MAX(LightExtents.x, meshExtents.x);
-		LightExtents.y = MAX(LightExtents.y, meshExtents.y);
-		LightExtents.z = MAX(LightExtents.z, meshExtents.z);
-		XMStoreFloat3(&meshCenter, g_SceneMesh.GetMeshBBoxCenter(i));
-		center.x += meshCenter.x;
-		center.x += meshCenter.x;
-		center.x += meshCenter.x;
+		XMStoreFloat3( &meshCenters[i], g_SceneMesh.GetMeshBBoxCenter(i) );
+		XMStoreFloat3( &meshExtents[i], g_SceneMesh.GetMeshBBoxExtents(i) * BACKGROUND_MESH_SCALE );
 	}
-	// average of mesh centers
-	center.x /= (float)numMeshes;
-	center.y /= (float)numMeshes;
-	center.z /= (float)numMeshes;
+	XMFLOAT3 center;
+	XMFLOAT3 LightExtents;
+	AMD::GetPointLightVolume( &meshCenters.data()->x, &meshExtents.data()->x, numMeshes, &center.x, &LightExtents.x );
 
     GenerateRandomLights(&center, &LightExtents, POINT_LIGHT_MAX_RANGE, POINT_LIGHT_MAX_INTENSITY);
+
+	// Without a path file the benchmark orbits the lights once per run
+	if ( g_Benchmark.bEnabled && g_BenchmarkPath.GetKeyCount() == 0 )
+	{
+		g_BenchmarkPath.SetOrbit( &center.x, &LightExtents.x, g_Benchmark.uFrames * BENCHMARK_FRAME_TIME );
+	}
 	
 
 	// Create main constant buffer
@@ -532,15 +734,15 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
 	for (UINT i = 0; i < MAX_NUMBER_OF_LIGHTS; i++)
 	{
 		POINT_LIGHT_ARRAY_CB_STRUCT *pLightData = (POINT_LIGHT_ARRAY_CB_STRUCT *)lightData.pSysMem;
-        pLightData->PointLight[i].vWorldSpacePositionAndRange.x = g_pLightArray[i].vWorldSpacePosition.x;
-        pLightData->PointLight[i].vWorldSpacePositionAndRange.y = g_pLightArray[i].vWorldSpacePosition.y;
-        pLightData->PointLight[i].vWorldSpacePositionAndRange.z = g_pLightArray[i].vWorldSpacePosition.z;
+        pLightData->PointLight[i].vWorldSpacePositionAndRange.x = g_pLightArray[i].fPosition[0];
+        pLightData->PointLight[i].vWorldSpacePositionAndRange.y = g_pLightArray[i].fPosition[1];
+        pLightData->PointLight[i].vWorldSpacePositionAndRange.z = g_pLightArray[i].fPosition[2];
         pLightData->PointLight[i].vWorldSpacePositionAndRange.w = g_pLightArray[i].fRange;
 
-        pLightData->PointLight[i].vColor.x  = XMVectorGetX(g_pLightArray[i].vColor);
-        pLightData->PointLight[i].vColor.y  = XMVectorGetY(g_pLightArray[i].vColor);
-        pLightData->PointLight[i].vColor.z  = XMVectorGetZ(g_pLightArray[i].vColor);
-        pLightData->PointLight[i].vColor.w  = XMVectorGetW(g_pLightArray[i].vColor);
+        pLightData->PointLight[i].vColor.x  = g_pLightArray[i].fColor[0];
+        pLightData->PointLight[i].vColor.y  = g_pLightArray[i].fColor[1];
+        pLightData->PointLight[i].vColor.z  = g_pLightArray[i].fColor[2];
+        pLightData->PointLight[i].vColor.w  = g_pLightArray[i].fColor[3];
 	}
 
     hr = pd3dDevice->CreateBuffer( &bd, &lightData, &g_pPointLightArrayCB );
@@ -682,10 +884,18 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
     hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &g_pAlwaysDSS );
     DSDesc.DepthFunc =          D3D11_COMPARISON_GREATER;
     hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &g_pGreaterDSS );
+    DSDesc.DepthFunc =          D3D11_COMPARISON_EQUAL;
+    hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &g_pEqualNoDepthWritesDSS );
+    DSDesc.DepthFunc =          D3D11_COMPARISON_ALWAYS;
+    DSDesc.DepthWriteMask =     D3D11_DEPTH_WRITE_MASK_ALL;
+    hr = pd3dDevice->CreateDepthStencilState( &DSDesc, &g_pAlwaysDepthWritesDSS );
 
     
 	static bool bFirstPass = true;
 
+    // Before GenerateShaders, which times its stages with TimerEx
+    TIMER_Init( pd3dDevice )
+
     // One-time setup
     if( bFirstPass )
     {
@@ -706,7 +916,6 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
 
     // Create AMD_SDK resources here
     g_HUD.OnCreateDevice( pd3dDevice );
-    TIMER_Init( pd3dDevice )
 
 #ifdef MEM_DEBUG
 	g_pMemDebugDevice = pd3dDevice;
@@ -768,6 +977,26 @@ void CreateGBuffers(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBuff
 						pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height, 1 );
 	AMD::CreateSurface( &g_pGBuffer[1],  &g_pGBufferSRV[1], &g_pGBufferRTV[1], NULL, DXGI_FORMAT_R8G8B8A8_UNORM, 
 						pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height, 1 );
+
+	// Create the reduced resolution lighting buffers
+	for ( int i = LIGHTING_RESOLUTION_HALF; i < LIGHTING_RESOLUTION_COUNT; i++ )
+	{
+		LOW_RES_LIGHTING_BUFFERS& Buffers = g_LowResLighting[i];
+		UINT uFactor = GetLightingDownsampleFactor( i );
+		Buffers.uWidth  = ( pBackBufferSurfaceDesc->Width + uFactor - 1 ) / uFactor;
+		Buffers.uHeight = ( pBackBufferSurfaceDesc->Height + uFactor - 1 ) / uFactor;
+
+		AMD::CreateDepthStencilSurface( &Buffers.pDepthStencil, &Buffers.pDepthStencilSRV, &Buffers.pDSV, DXGI_FORMAT_D32_FLOAT, DXGI_FORMAT_R32_FLOAT, 
+									   Buffers.uWidth, Buffers.uHeight, 1 );
+
+		descDSV.Format = DXGI_FORMAT_D32_FLOAT;
+		pd3dDevice->CreateDepthStencilView( (ID3D11Resource*)Buffers.pDepthStencil, &descDSV, &Buffers.pReadOnlyDSV );
+
+		AMD::CreateSurface( &Buffers.pNormal, &Buffers.pNormalSRV, &Buffers.pNormalRTV, NULL, DXGI_FORMAT_R8G8B8A8_UNORM, 
+							Buffers.uWidth, Buffers.uHeight, 1 );
+		AMD::CreateSurface( &Buffers.pLight, &Buffers.pLightSRV, &Buffers.pLightRTV, NULL, DXGI_FORMAT_R16G16B16A16_FLOAT, 
+							Buffers.uWidth, Buffers.uHeight, 1 );
+	}
 }
 
 
@@ -790,6 +1019,30 @@ void DestroyGBuffers()
     SAFE_RELEASE(g_pMainDSV);
     SAFE_RELEASE(g_pMainReadOnlyDSV);
 
+    // Destroy reduced resolution lighting buffers
+	for ( int i = LIGHTING_RESOLUTION_HALF; i < LIGHTING_RESOLUTION_COUNT; i++ )
+	{
+		LOW_RES_LIGHTING_BUFFERS& Buffers = g_LowResLighting[i];
+		SAFE_RELEASE(Buffers.pDepthStencil);
+		SAFE_RELEASE(Buffers.pDepthStencilSRV);
+		SAFE_RELEASE(Buffers.pDSV);
+		SAFE_RELEASE(Buffers.pReadOnlyDSV);
+		SAFE_RELEASE(Buffers.pNormal);
+		SAFE_RELEASE(Buffers.pNormalSRV);
+		SAFE_RELEASE(Buffers.pNormalRTV);
+		SAFE_RELEASE(Buffers.pLight);
+		SAFE_RELEASE(Buffers.pLightSRV);
+		SAFE_RELEASE(Buffers.pLightRTV);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Full resolution pixels per point light pixel, in x and y
+//--------------------------------------------------------------------------------------
+UINT GetLightingDownsampleFactor( int iLightingResolution )
+{
+	return 1u << iLightingResolution;
 }
 
 //--------------------------------------------------------------------------------------
@@ -807,6 +1060,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     if( g_SettingsDlg.IsActive() )
     {
         g_SettingsDlg.OnRender( fElapsedTime );
+        EndFrameCounters();
         return;
     }       
        
@@ -823,12 +1077,12 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     pSS[0] = g_pSamplerStateLinear;
     pSS[1] = g_pSamplerStatePoint;
     pSS[2] = g_pSamplerStateAnisotropic;
-    pd3dImmediateContext->VSSetSamplers(0, 3, pSS);
-    pd3dImmediateContext->PSSetSamplers(0, 3, pSS);
+    COUNTER_State( pd3dImmediateContext->VSSetSamplers(0, 3, pSS) )
+    COUNTER_State( pd3dImmediateContext->PSSetSamplers(0, 3, pSS) )
 
     // Set states
-    pd3dImmediateContext->OMSetBlendState( g_pNoBlendBS, 0, 0xffffffff );
-    pd3dImmediateContext->OMSetDepthStencilState( g_pLessEqualDSS, 0 );
+    COUNTER_State( pd3dImmediateContext->OMSetBlendState( g_pNoBlendBS, 0, 0xffffffff ) )
+    COUNTER_State( pd3dImmediateContext->OMSetDepthStencilState( g_pLessEqualDSS, 0 ) )
 
 
     //
@@ -838,9 +1092,9 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     pBuffers[0] = g_pMainCB;
     pBuffers[1] = g_pMeshCB;
     pBuffers[2] = g_pPointLightArrayCB;
-    pd3dImmediateContext->VSSetConstantBuffers( 0, 3, pBuffers );
-    pd3dImmediateContext->GSSetConstantBuffers( 0, 3, pBuffers );
-    pd3dImmediateContext->PSSetConstantBuffers( 0, 3, pBuffers );  
+    COUNTER_State( pd3dImmediateContext->VSSetConstantBuffers( 0, 3, pBuffers ) )
+    COUNTER_State( pd3dImmediateContext->GSSetConstantBuffers( 0, 3, pBuffers ) )
+    COUNTER_State( pd3dImmediateContext->PSSetConstantBuffers( 0, 3, pBuffers ) )
 
     if( g_ShaderCache.ShadersReady() )
     {
@@ -849,7 +1103,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 		//
 		BuildGBuffers(pd3dImmediateContext);
 
-		TIMER_Begin( 0, L"Deferred Shading" )
+		TIMER_BeginStatic( 0, L"Deferred Shading" )
 
 		//
 		// Shading passes
@@ -883,7 +1137,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
         // Set render target to the back buffer
         ID3D11RenderTargetView* pRTV[1];
         pRTV[0] = DXUTGetD3D11RenderTargetView();
-        pd3dImmediateContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV);
+        COUNTER_State( pd3dImmediateContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV) )
         float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
         pd3dImmediateContext->ClearRenderTargetView( pRTV[0], ClearColor );
 
@@ -893,6 +1147,13 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     
     DXUT_EndPerfEvent();
 
+    EndFrameCounters();
+
+    if ( g_Benchmark.bEnabled && g_ShaderCache.ShadersReady() )
+    {
+        BenchmarkEndFrame();
+    }
+
     static DWORD dwTimefirst = GetTickCount();
     if ( GetTickCount() - dwTimefirst > 5000 )
     {    
@@ -959,13 +1220,15 @@ void BuildGBuffers(ID3D11DeviceContext* pd3dContext)
 	mTWorld = XMMatrixTranspose(mWorld);
 
     // Calculate plane equations of frustum in world space
-    ExtractPlanesFromFrustum( g_pWorldSpaceFrustumPlaneEquation, &mViewProjection );
+    XMFLOAT4X4 mViewProjectionRows;
+    XMStoreFloat4x4( &mViewProjectionRows, mViewProjection );
+    AMD::ExtractFrustumPlanes( g_fWorldSpaceFrustumPlanes, &mViewProjectionRows.m[0][0] );
 
     // Set render targets to GBuffer RTs
     ID3D11RenderTargetView* RTViews[2];
     RTViews[0] = g_pGBufferRTV[0];
     RTViews[1] = g_pGBufferRTV[1];
-    pd3dContext->OMSetRenderTargets(2, RTViews, g_pMainDSV);
+    COUNTER_State( pd3dContext->OMSetRenderTargets(2, RTViews, g_pMainDSV) )
 
  	float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 	pd3dContext->ClearRenderTargetView( RTViews[0], ClearColor );
@@ -978,14 +1241,14 @@ void BuildGBuffers(ID3D11DeviceContext* pd3dContext)
     ID3D11ShaderResourceView* pSRV[4];
     pSRV[0] = g_pDefaultDiffuseTextureRV;
     pSRV[1] = g_pDefaultSpecularTextureRV;
-    pd3dContext->VSSetShaderResources( 0, 2, pSRV );
-    pd3dContext->PSSetShaderResources( 0, 2, pSRV );
+    COUNTER_State( pd3dContext->VSSetShaderResources( 0, 2, pSRV ) )
+    COUNTER_State( pd3dContext->PSSetShaderResources( 0, 2, pSRV ) )
 
     // Set Depth Stencil state
-	pd3dContext->OMSetDepthStencilState(g_pLessEqualDSS, 0);
+	COUNTER_State( pd3dContext->OMSetDepthStencilState(g_pLessEqualDSS, 0) )
     
     // Set blend state
-    pd3dContext->OMSetBlendState(g_pNoBlendBS, 0, 0xffffffff);
+    COUNTER_State( pd3dContext->OMSetBlendState(g_pNoBlendBS, 0, 0xffffffff) )
 
     //
     // Update main constant buffer
@@ -1029,26 +1292,83 @@ void BuildGBuffers(ID3D11DeviceContext* pd3dContext)
 	((MAIN_CB_STRUCT *)MappedSubResource.pData)->g_vLightAmbient.w = 0.0f; 
 	
     ((MAIN_CB_STRUCT *)MappedSubResource.pData)->fShowDiscardedPixels = g_bShowDiscardedPixels;
+    ((MAIN_CB_STRUCT *)MappedSubResource.pData)->fLightingDownsample = (float)GetLightingDownsampleFactor( g_iLightingResolution );
     
     pd3dContext->Unmap( g_pMainCB, 0 );
+    COUNTER_Add( AMD::FRAME_COUNTER_BYTES_MAPPED, sizeof( MAIN_CB_STRUCT ) )
 
     //
     // Render background model
     //
         
+    // Select the scene geometry once, so the depth prepass and the G-Buffer pass draw the same
+	// triangles: either meshlets culled against the frustum and camera (the cone test relies on
+	// back faces being culled), or the LODs picked from the mesh's projected size
+	bool bMeshlets = g_bMeshletCulling && g_SceneMeshlets.IsCreated();
+	if ( bMeshlets )
+	{
+		COUNTER_State( pd3dContext->RSSetState( g_pRasterizerStateSolid_BFCOn ) )
+		g_SceneMeshlets.Cull( pd3dContext, mWorld, mViewProjection, g_vCameraFrom );
+	}
+	else if ( g_bMeshLOD )
+		g_SceneMesh.SetLODView( mWorld * mViewProjection, (float)g_uRenderHeight );
+	else
+		g_SceneMesh.DisableLOD();
+
     // Set shaders
-    pd3dContext->VSSetShader( g_pBuildingPass_StoreVS, NULL, 0 );
-    pd3dContext->HSSetShader( NULL, NULL, 0);
-    pd3dContext->DSSetShader( NULL, NULL, 0);
-    pd3dContext->GSSetShader( NULL, NULL, 0 );
-    pd3dContext->PSSetShader( g_pBuildingPass_StorePS, NULL, 0 ); 
+    COUNTER_State( pd3dContext->HSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->DSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->GSSetShader( NULL, NULL, 0 ) )
+
+	// Depth prepass: lay down depth from the position-only vertex stream, then let the
+	// G-Buffer pass test for EQUAL depth so each pixel is filled only once
+	bool bDepthPrepass = g_bDepthPrepass && g_SceneMesh.HasPositionStreams();
+	if ( bDepthPrepass )
+	{
+		TIMER_BeginStatic( 0, L"Depth Prepass" )
+
+		COUNTER_State( pd3dContext->OMSetRenderTargets( 0, NULL, g_pMainDSV ) )
+		COUNTER_State( pd3dContext->VSSetShader( g_pDepthPrepassVS, NULL, 0 ) )
+		COUNTER_State( pd3dContext->PSSetShader( NULL, NULL, 0 ) )
+		COUNTER_State( pd3dContext->IASetInputLayout( g_pPositionOnlyLayout ) )
+
+		// The meshlets count their own draws
+		if ( bMeshlets )
+			g_SceneMeshlets.RenderPositionOnly( pd3dContext );
+		else
+		{
+			g_SceneMesh.RenderPositionOnly( pd3dContext );
+			COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, g_SceneMesh.GetNumDrawCalls() )
+		}
+
+		TIMER_End()
+
+		COUNTER_State( pd3dContext->OMSetRenderTargets( 2, RTViews, g_pMainDSV ) )
+		COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pEqualNoDepthWritesDSS, 0 ) )
+	}
+
+	TIMER_BeginStatic( 0, L"G-Buffer" )
+
+    COUNTER_State( pd3dContext->VSSetShader( g_pBuildingPass_StoreVS, NULL, 0 ) )
+    COUNTER_State( pd3dContext->PSSetShader( g_pBuildingPass_StorePS, NULL, 0 ) )
 
     // Set input layout 
-    pd3dContext->IASetInputLayout( g_pMeshLayout );
+    COUNTER_State( pd3dContext->IASetInputLayout( g_pMeshLayout ) )
 
-    // Render the scene mesh 
-	g_SceneMesh.Render( pd3dContext, 0 );	
+	if ( bMeshlets )
+		g_SceneMeshlets.Render( pd3dContext, 0 );
+	else
+	{
+		g_SceneMesh.Render( pd3dContext, 0 );
+		COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, g_SceneMesh.GetNumDrawCalls() )
+	}
 
+	TIMER_End()
+
+	if ( bDepthPrepass )
+	{
+		COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pLessEqualDSS, 0 ) )
+	}
 }
 
 
@@ -1062,7 +1382,7 @@ void ShadingPasses(ID3D11DeviceContext* pd3dContext)
  	// Set render target to the back buffer
     ID3D11RenderTargetView* pRTV[1];
 	pRTV[0] = DXUTGetD3D11RenderTargetView();
-    pd3dContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV);
+    COUNTER_State( pd3dContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV) )
 	float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 	pd3dContext->ClearRenderTargetView( pRTV[0], ClearColor );
 
@@ -1074,52 +1394,92 @@ void ShadingPasses(ID3D11DeviceContext* pd3dContext)
 	UINT stride = 0;
 	UINT offset = 0;
 	ID3D11Buffer* pBuffer[1] = { NULL };
-	pd3dContext->IASetVertexBuffers( 0, 1, pBuffer, &stride, &offset );
-	pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-	pd3dContext->IASetInputLayout( NULL );
+	COUNTER_State( pd3dContext->IASetVertexBuffers( 0, 1, pBuffer, &stride, &offset ) )
+	COUNTER_State( pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP) )
+	COUNTER_State( pd3dContext->IASetInputLayout( NULL ) )
 
 	// Set shaders
-	pd3dContext->VSSetShader( g_pShadingPass_FullscreenQuadVS, NULL, 0 );
-	pd3dContext->HSSetShader( NULL, NULL, 0 );
-	pd3dContext->DSSetShader( NULL, NULL, 0 );
-	pd3dContext->GSSetShader( NULL, NULL, 0 );
-	pd3dContext->PSSetShader( g_pShadingPass_FullscreenLightPS, NULL, 0 ); 
+	COUNTER_State( pd3dContext->VSSetShader( g_pShadingPass_FullscreenQuadVS, NULL, 0 ) )
+	COUNTER_State( pd3dContext->HSSetShader( NULL, NULL, 0 ) )
+	COUNTER_State( pd3dContext->DSSetShader( NULL, NULL, 0 ) )
+	COUNTER_State( pd3dContext->GSSetShader( NULL, NULL, 0 ) )
+	COUNTER_State( pd3dContext->PSSetShader( g_pShadingPass_FullscreenLightPS, NULL, 0 ) )
 
 	// Set texture inputs
 	ID3D11ShaderResourceView*   pSRV[3];
 	pSRV[0] = g_pGBufferSRV[0];
 	pSRV[1] = g_pGBufferSRV[1];
 	pSRV[2] = g_pMainDepthStencilSRV;
-	pd3dContext->PSSetShaderResources(0, 3, pSRV);
+	COUNTER_State( pd3dContext->PSSetShaderResources(0, 3, pSRV) )
 
 	// Set Depth Stencil state
-	pd3dContext->OMSetDepthStencilState(g_pLessEqualNoDepthWritesDSS, 0);
+	COUNTER_State( pd3dContext->OMSetDepthStencilState(g_pLessEqualNoDepthWritesDSS, 0) )
 
 	// Set blend state
-	pd3dContext->OMSetBlendState(g_pNoBlendBS, 0, 0xffffffff);
+	COUNTER_State( pd3dContext->OMSetBlendState(g_pNoBlendBS, 0, 0xffffffff) )
     
 	// Draw fullscreen quad
 	pd3dContext->Draw( 3, 0);
+	COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, 1 )
 
 	//
 	// Random Point Lights
 	//
 
+	// At half or quarter resolution the lights are accumulated into a smaller target, 
+	// depth tested (and depth bounds tested) against a downsampled depth buffer
+	bool bLowResLighting = ( g_iLightingResolution != LIGHTING_RESOLUTION_FULL );
+	const LOW_RES_LIGHTING_BUFFERS& LowRes = g_LowResLighting[g_iLightingResolution];
+	D3D11_VIEWPORT Viewport = { 0.0f, 0.0f, (float)g_uRenderWidth, (float)g_uRenderHeight, 0.0f, 1.0f };
+
+	if ( bLowResLighting )
+	{
+		TIMER_BeginStatic( 0, L"Downsample" )
+
+		// Keep one full resolution depth and normal per low resolution pixel
+		ID3D11RenderTargetView* pLowResRTV[1] = { LowRes.pNormalRTV };
+		COUNTER_State( pd3dContext->OMSetRenderTargets( 1, pLowResRTV, LowRes.pDSV ) )
+		COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pAlwaysDepthWritesDSS, 0 ) )
+		COUNTER_State( pd3dContext->OMSetBlendState( g_pNoBlendBS, 0, 0xffffffff ) )
+
+		D3D11_VIEWPORT LowResViewport = { 0.0f, 0.0f, (float)LowRes.uWidth, (float)LowRes.uHeight, 0.0f, 1.0f };
+		COUNTER_State( pd3dContext->RSSetViewports( 1, &LowResViewport ) )
+
+		COUNTER_State( pd3dContext->PSSetShader( g_pShadingPass_DownsampleDepthNormalPS, NULL, 0 ) )
+		pd3dContext->Draw( 3, 0 );
+		COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, 1 )
+
+		TIMER_End() // Downsample
+
+		// Accumulate the lights into the low resolution target, testing against its depth
+		pLowResRTV[0] = LowRes.pLightRTV;
+		COUNTER_State( pd3dContext->OMSetRenderTargets( 1, pLowResRTV, LowRes.pReadOnlyDSV ) )
+		pd3dContext->ClearRenderTargetView( LowRes.pLightRTV, ClearColor );
+	}
+
     // Set shaders
-    pd3dContext->VSSetShader( g_pShadingPass_PointLightFromTileVS, NULL, 0 );
-    pd3dContext->HSSetShader( NULL, NULL, 0);
-    pd3dContext->DSSetShader( NULL, NULL, 0);
-    pd3dContext->GSSetShader( NULL, NULL, 0 );
-    pd3dContext->PSSetShader( g_pShadingPass_PointLightFromTilePS, NULL, 0 ); 
+    COUNTER_State( pd3dContext->VSSetShader( g_pShadingPass_PointLightFromTileVS, NULL, 0 ) )
+    COUNTER_State( pd3dContext->HSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->DSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->GSSetShader( NULL, NULL, 0 ) )
+    COUNTER_State( pd3dContext->PSSetShader( bLowResLighting ? g_pShadingPass_PointLightLowResPS : g_pShadingPass_PointLightFromTilePS, NULL, 0 ) )
 
     // Set primitive topology
-    pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    COUNTER_State( pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ) )
 
     // Set texture inputs
-    pSRV[0] = g_pGBufferSRV[0];
-    pSRV[1] = g_pGBufferSRV[1];
-    pSRV[2] = g_pMainDepthStencilSRV;
-    pd3dContext->PSSetShaderResources(0, 3, pSRV);
+	if ( bLowResLighting )
+	{
+		ID3D11ShaderResourceView* pLowResSRV[2] = { LowRes.pNormalSRV, LowRes.pDepthStencilSRV };
+		COUNTER_State( pd3dContext->PSSetShaderResources(4, 2, pLowResSRV) )
+	}
+	else
+	{
+		pSRV[0] = g_pGBufferSRV[0];
+		pSRV[1] = g_pGBufferSRV[1];
+		pSRV[2] = g_pMainDepthStencilSRV;
+		COUNTER_State( pd3dContext->PSSetShaderResources(0, 3, pSRV) )
+	}
 
     // Process lights
     ProcessRandomLights( &g_mView, &g_mProjection );
@@ -1129,46 +1489,50 @@ void ShadingPasses(ID3D11DeviceContext* pd3dContext)
     pd3dContext->Map( g_pQuadVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubresource );
     for (UINT i=0; i<g_uNumberOfLights; i++)
     {
-        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+0].NDCPosition = XMFLOAT3(g_pLightArray[i].vNDCTile2DCoordinatesMin.x, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMin.y, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.z);
-        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+1].NDCPosition = XMFLOAT3(g_pLightArray[i].vNDCTile2DCoordinatesMin.x, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.y, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.z);
-        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+2].NDCPosition = XMFLOAT3(g_pLightArray[i].vNDCTile2DCoordinatesMax.x, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMin.y, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.z);
-        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+3].NDCPosition = XMFLOAT3(g_pLightArray[i].vNDCTile2DCoordinatesMax.x, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.y, 
-                                                                                        g_pLightArray[i].vNDCTile2DCoordinatesMax.z);
+        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+0].NDCPosition = XMFLOAT3(g_pLightArray[i].fTileMin[0], 
+                                                                                        g_pLightArray[i].fTileMin[1], 
+                                                                                        g_pLightArray[i].fTileMax[2]);
+        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+1].NDCPosition = XMFLOAT3(g_pLightArray[i].fTileMin[0], 
+                                                                                        g_pLightArray[i].fTileMax[1], 
+                                                                                        g_pLightArray[i].fTileMax[2]);
+        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+2].NDCPosition = XMFLOAT3(g_pLightArray[i].fTileMax[0], 
+                                                                                        g_pLightArray[i].fTileMin[1], 
+                                                                                        g_pLightArray[i].fTileMax[2]);
+        ((QUAD_DESCRIPTOR*)MappedSubresource.pData)[4*i+3].NDCPosition = XMFLOAT3(g_pLightArray[i].fTileMax[0], 
+                                                                                        g_pLightArray[i].fTileMax[1], 
+                                                                                        g_pLightArray[i].fTileMax[2]);
     }
     pd3dContext->Unmap( g_pQuadVB, 0 );
+    COUNTER_Add( AMD::FRAME_COUNTER_BYTES_MAPPED, 4 * sizeof( QUAD_DESCRIPTOR ) * g_uNumberOfLights )
 
     // Set vertex buffer
     stride = sizeof(QUAD_DESCRIPTOR);
     offset = 0;
-    pd3dContext->IASetVertexBuffers( 0, 1, &g_pQuadVB, &stride, &offset );
+    COUNTER_State( pd3dContext->IASetVertexBuffers( 0, 1, &g_pQuadVB, &stride, &offset ) )
 
     // Set index buffer
-    pd3dContext->IASetIndexBuffer( g_pQuadIB, DXGI_FORMAT_R16_UINT, 0 );
+    COUNTER_State( pd3dContext->IASetIndexBuffer( g_pQuadIB, DXGI_FORMAT_R16_UINT, 0 ) )
 
     // Set input layout
-    pd3dContext->IASetInputLayout( g_pQuadVertexLayout );
+    COUNTER_State( pd3dContext->IASetInputLayout( g_pQuadVertexLayout ) )
         
     // Additive blending
-    pd3dContext->OMSetBlendState( g_pAdditiveBS, 0, 0xffffffff );
+    COUNTER_State( pd3dContext->OMSetBlendState( g_pAdditiveBS, 0, 0xffffffff ) )
 
     // Solid rendering (not affected by global wireframe toggle)
-    pd3dContext->RSSetState( g_pRasterizerStateSolid_BFCOn );
+    COUNTER_State( pd3dContext->RSSetState( g_pRasterizerStateSolid_BFCOn ) )
 
 	// Set depth test to greater so that light tiles are only rendered if something is in front of them
-	pd3dContext->OMSetDepthStencilState( g_pGreaterDSS, 0 );
+	COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pGreaterDSS, 0 ) )
 
+	TIMER_BeginStatic( 0, L"Point Lights" )
 
     // Draw point lights
 	if (!g_bDepthBoundsTest || !(g_ExtensionsSupported & AGS_DX11_EXTENSION_DEPTH_BOUNDS_TEST ))
 	{
 		pd3dContext->DrawIndexed( 6*g_uNumberOfLights, 0, 0 );
+		COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, 1 )
+		COUNTER_Add( AMD::FRAME_COUNTER_LIGHTS_DRAWN, g_uNumberOfLights )
 	}
 	else
 	{
@@ -1176,29 +1540,63 @@ void ShadingPasses(ID3D11DeviceContext* pd3dContext)
 		// to avoid drawing unecssary pixels. Since the hardware depth bounds
 		// test can only have one range per draw call, we need to draw the
 		// lights one at a time instead of in one big batch.
-		XMMATRIX mViewProjection = g_mView * g_mProjection;
-		XMVECTOR viewVec = XMVectorSubtract(g_vCameraFrom,g_vCameraTo);
-		viewVec = XMVector3Normalize(viewVec);
+		XMFLOAT4X4 mViewProjection;
+		XMStoreFloat4x4( &mViewProjection, g_mView * g_mProjection );
+		XMFLOAT3 viewVec;
+		XMStoreFloat3( &viewVec, XMVector3Normalize( XMVectorSubtract(g_vCameraFrom,g_vCameraTo) ) );
 
+		UINT uLightsDrawn = 0;
 		for (UINT i=0; i<g_uNumberOfLights; i++)
 		{
 			if (!LightInFrustum(i))
 				continue;
 			SetDepthBoundsFromLightRadius(i, &viewVec, &mViewProjection);
 			pd3dContext->DrawIndexed( 6, i*6, 0 );
+			uLightsDrawn++;
 		}
 		// disable the depth bounds test
 		if (g_bDepthBoundsTest)
             agsDriverExtensionsDX11_SetDepthBounds( g_pAGSContext, false, 0.0f, 1.0f );
+
+		COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, uLightsDrawn )
+		COUNTER_Add( AMD::FRAME_COUNTER_LIGHTS_DRAWN, uLightsDrawn )
+		COUNTER_Add( AMD::FRAME_COUNTER_LIGHTS_CULLED, g_uNumberOfLights - uLightsDrawn )
+		COUNTER_Add( AMD::FRAME_COUNTER_DEPTH_BOUNDS, uLightsDrawn + 1 )
 	}
+	COUNTER_Add( AMD::FRAME_COUNTER_LIGHTS, g_uNumberOfLights )
 
-	pd3dContext->OMSetDepthStencilState( g_pLessEqualDSS, 0 );
+	TIMER_End() // Point Lights
+
+	if ( bLowResLighting )
+	{
+		TIMER_BeginStatic( 0, L"Upsample" )
+
+		// Depth and normal aware upsample, added to the back buffer with the full resolution albedo
+		COUNTER_State( pd3dContext->OMSetRenderTargets( 1, pRTV, g_pMainReadOnlyDSV ) )
+		COUNTER_State( pd3dContext->RSSetViewports( 1, &Viewport ) )
+		COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pLessEqualNoDepthWritesDSS, 0 ) )
+
+		COUNTER_State( pd3dContext->IASetVertexBuffers( 0, 1, pBuffer, &stride, &offset ) )
+		COUNTER_State( pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP ) )
+		COUNTER_State( pd3dContext->IASetInputLayout( NULL ) )
+		COUNTER_State( pd3dContext->VSSetShader( g_pShadingPass_FullscreenQuadVS, NULL, 0 ) )
+		COUNTER_State( pd3dContext->PSSetShader( g_pShadingPass_UpsampleLightingPS, NULL, 0 ) )
+
+		ID3D11ShaderResourceView* pUpsampleSRV[6] = { g_pGBufferSRV[0], g_pGBufferSRV[1], g_pMainDepthStencilSRV, 
+													  LowRes.pLightSRV, LowRes.pNormalSRV, LowRes.pDepthStencilSRV };
+		COUNTER_State( pd3dContext->PSSetShaderResources( 0, 6, pUpsampleSRV ) )
+
+		pd3dContext->Draw( 3, 0 );
+		COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, 1 )
+
+		TIMER_End() // Upsample
+	}
+
+	COUNTER_State( pd3dContext->OMSetDepthStencilState( g_pLessEqualDSS, 0 ) )
 
     // To avoid debug problems
-    pSRV[0] = NULL;
-    pSRV[1] = NULL;
-    pSRV[2] = NULL;
-    pd3dContext->PSSetShaderResources(0, 3, pSRV);
+	ID3D11ShaderResourceView* pNullSRV[6] = { NULL, NULL, NULL, NULL, NULL, NULL };
+    COUNTER_State( pd3dContext->PSSetShaderResources(0, 6, pNullSRV) )
 }
 
 
@@ -1210,29 +1608,7 @@ void ShadingPasses(ID3D11DeviceContext* pd3dContext)
 //--------------------------------------------------------------------------------------
 bool LightInFrustum(UINT lightIndex)
 {
-	XMVECTOR center = XMVectorSet(g_pLightArray[lightIndex].vWorldSpacePosition.x, 
-						g_pLightArray[lightIndex].vWorldSpacePosition.y,
-						g_pLightArray[lightIndex].vWorldSpacePosition.z,
-						1.0f);
-	float radius = g_pLightArray[lightIndex].fRange;
-	float distance;
-
-	for (int i = 0; i < 6; i++)
-	{
-		XMVECTOR planeEqn = XMVectorSet(g_pWorldSpaceFrustumPlaneEquation[i].x, g_pWorldSpaceFrustumPlaneEquation[i].y,
-			g_pWorldSpaceFrustumPlaneEquation[i].z, g_pWorldSpaceFrustumPlaneEquation[i].w);
-		XMVECTOR vDistance = XMVector4Dot(center, planeEqn);
-		distance = XMVectorGetX(vDistance);
-		// see if light is completely behind the frustum plane
-		if ( distance < -radius)
-			return false;
-		// see if the light intersects the plane
-		if (fabs(distance) < radius)
-			return true;
-	}
-
-	// must be inside the frustum
-	return true;
+	return AMD::PointLightInFrustum( g_pLightArray[lightIndex], g_fWorldSpaceFrustumPlanes );
 }
 
 
@@ -1244,34 +1620,11 @@ bool LightInFrustum(UINT lightIndex)
 // pixels outside the range to be culled.
 //
 //--------------------------------------------------------------------------------------
-void SetDepthBoundsFromLightRadius(UINT i, XMVECTOR *pViewVec, XMMATRIX *pViewProjection)
+void SetDepthBoundsFromLightRadius(UINT i, const XMFLOAT3* pViewVec, const XMFLOAT4X4* pViewProjection)
 {
-	XMVECTOR center = XMVectorSet(g_pLightArray[i].vWorldSpacePosition.x, g_pLightArray[i].vWorldSpacePosition.y, g_pLightArray[i].vWorldSpacePosition.z, 1.0);
-	XMVECTOR pos, radiusVec;
-	XMVECTOR tfmNear, tfmFar;
-
-	// scale the view vector by the radius
-	radiusVec = *pViewVec * g_pLightArray[i].fRange;
-
-	// calculate the near z
-	pos = center + radiusVec;
-	pos = XMVectorSet(XMVectorGetX(pos), XMVectorGetY(pos), XMVectorGetZ(pos), 1.0f);
-
-	// project the near coordinate into screen space
-	tfmNear = XMVector4Transform(pos, *pViewProjection);
-	float nearBound = XMVectorGetZ(tfmNear) / XMVectorGetW(tfmNear);
-
-	// calculate the far z
-	pos = center - radiusVec;
-	pos = XMVectorSet(XMVectorGetX(pos), XMVectorGetY(pos), XMVectorGetZ(pos), 1.0f);
-
-	// project the far coordinate into screen space
-	tfmFar =  XMVector4Transform(pos, *pViewProjection);
-	float farBound =  XMVectorGetZ(tfmFar) / XMVectorGetW(tfmFar);
-
-	// clip values outside the frustum
-	nearBound = CLIP(nearBound);
-	farBound = CLIP(farBound);
+	// project the points of the sphere nearest to and furthest from the camera
+	float nearBound, farBound;
+	AMD::GetPointLightDepthBounds( g_pLightArray[i], &pViewVec->x, &pViewProjection->m[0][0], &nearBound, &farBound );
 
 	// set the depth bounds based on the near and far z of the light
 	agsDriverExtensionsDX11_SetDepthBounds( g_pAGSContext, true, nearBound, farBound );
@@ -1286,21 +1639,21 @@ void PostProcessParticles(ID3D11DeviceContext* pd3dContext)
 	// Set render target to the back buffer
     ID3D11RenderTargetView* pRTV[1];
 	pRTV[0] = DXUTGetD3D11RenderTargetView();
-    pd3dContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV);
+    COUNTER_State( pd3dContext->OMSetRenderTargets(1, pRTV, g_pMainReadOnlyDSV) )
 
     // Draw Point light sources
 
 	// Set shaders
-    pd3dContext->VSSetShader( g_pParticleVS, NULL, 0 );
-    pd3dContext->HSSetShader( NULL, NULL, 0);
-    pd3dContext->DSSetShader( NULL, NULL, 0);
-    pd3dContext->GSSetShader( g_pParticleGS, NULL, 0 );
-    pd3dContext->PSSetShader( g_pParticlePS, NULL, 0 ); 
+    COUNTER_State( pd3dContext->VSSetShader( g_pParticleVS, NULL, 0 ) )
+    COUNTER_State( pd3dContext->HSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->DSSetShader( NULL, NULL, 0) )
+    COUNTER_State( pd3dContext->GSSetShader( g_pParticleGS, NULL, 0 ) )
+    COUNTER_State( pd3dContext->PSSetShader( g_pParticlePS, NULL, 0 ) )
 
     // Set shader resources
     ID3D11ShaderResourceView* pSRV[4];
     pSRV[0] = g_pLightTextureRV;
-    pd3dContext->PSSetShaderResources( 0, 1, pSRV );
+    COUNTER_State( pd3dContext->PSSetShaderResources( 0, 1, pSRV ) )
 
 	// Store point light positions into particle's VB
     D3D11_MAPPED_SUBRESOURCE MappedSubresource;
@@ -1308,35 +1661,36 @@ void PostProcessParticles(ID3D11DeviceContext* pd3dContext)
 	float increase = 1.0 / POINT_LIGHT_MAX_INTENSITY;
     for (UINT i=0; i<g_uNumberOfLights; i++)
     {
-        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].WSPos   = g_pLightArray[i].vWorldSpacePosition;
+        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].WSPos   = XMFLOAT3( g_pLightArray[i].fPosition );
         ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].fRadius = g_pLightArray[i].fRange / 64.0f;
-		XMVECTOR vColor = g_pLightArray[i].vColor * increase;
-        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.x = XMVectorGetX(vColor);
-        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.y = XMVectorGetY(vColor);
-        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.z = XMVectorGetZ(vColor);
-        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.w = XMVectorGetW(vColor);
+        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.x = g_pLightArray[i].fColor[0] * increase;
+        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.y = g_pLightArray[i].fColor[1] * increase;
+        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.z = g_pLightArray[i].fColor[2] * increase;
+        ((PARTICLE_DESCRIPTOR*)MappedSubresource.pData)[i].vColor.w = g_pLightArray[i].fColor[3] * increase;
     }
     pd3dContext->Unmap( g_pParticleVB, 0 );
+    COUNTER_Add( AMD::FRAME_COUNTER_BYTES_MAPPED, sizeof( PARTICLE_DESCRIPTOR ) * g_uNumberOfLights )
 
     // Set vertex buffer
     UINT stride = sizeof(PARTICLE_DESCRIPTOR);
     UINT offset = 0;
-	pd3dContext->IASetVertexBuffers( 0, 1, &g_pParticleVB, &stride, &offset );
+	COUNTER_State( pd3dContext->IASetVertexBuffers( 0, 1, &g_pParticleVB, &stride, &offset ) )
 
     // Set primitive topology
-    pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_POINTLIST );
+    COUNTER_State( pd3dContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_POINTLIST ) )
 
 	// Set input layout
-    pd3dContext->IASetInputLayout( g_pParticleVertexLayout );
+    COUNTER_State( pd3dContext->IASetInputLayout( g_pParticleVertexLayout ) )
 
     // Additive blending
-    pd3dContext->OMSetBlendState( g_pAdditiveBS, 0, 0xffffffff );
+    COUNTER_State( pd3dContext->OMSetBlendState( g_pAdditiveBS, 0, 0xffffffff ) )
 
     // Solid rendering (not affected by global wireframe toggle)
-    pd3dContext->RSSetState( g_pRasterizerStateSolid_BFCOn );
+    COUNTER_State( pd3dContext->RSSetState( g_pRasterizerStateSolid_BFCOn ) )
 
     // Draw light
 	pd3dContext->Draw( g_uNumberOfLights, 0 );
+	COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, 1 )
 }
 
 //--------------------------------------------------------------------------------------
@@ -1374,13 +1728,18 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
     SAFE_RELEASE( g_pQuadVertexLayout );
     SAFE_RELEASE( g_pParticleVertexLayout );
     SAFE_RELEASE( g_pMeshLayout );
+    SAFE_RELEASE( g_pPositionOnlyLayout );
 
     SAFE_RELEASE( g_pBuildingPass_StorePS );
     SAFE_RELEASE( g_pBuildingPass_StoreVS );
+    SAFE_RELEASE( g_pDepthPrepassVS );
     SAFE_RELEASE( g_pShadingPass_FullscreenLightPS );
     SAFE_RELEASE( g_pShadingPass_FullscreenQuadVS );
     SAFE_RELEASE( g_pShadingPass_PointLightFromTileVS );
     SAFE_RELEASE( g_pShadingPass_PointLightFromTilePS );
+    SAFE_RELEASE( g_pShadingPass_PointLightLowResPS );
+    SAFE_RELEASE( g_pShadingPass_DownsampleDepthNormalPS );
+    SAFE_RELEASE( g_pShadingPass_UpsampleLightingPS );
     SAFE_RELEASE( g_pParticleVS ); 
     SAFE_RELEASE( g_pParticleGS ); 
     SAFE_RELEASE( g_pParticlePS );
@@ -1392,6 +1751,8 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
 
     SAFE_RELEASE( g_pAlwaysDSS );
     SAFE_RELEASE( g_pLessEqualNoDepthWritesDSS );
+    SAFE_RELEASE( g_pEqualNoDepthWritesDSS );
+    SAFE_RELEASE( g_pAlwaysDepthWritesDSS );
     SAFE_RELEASE( g_pLessEqualDSS );
     SAFE_RELEASE( g_pGreaterDSS );
 
@@ -1405,6 +1766,7 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
     SAFE_RELEASE( g_pSamplerStateLinear );
     SAFE_RELEASE( g_pSamplerStateAnisotropic );
 
+	g_SceneMeshlets.OnDestroyDevice();
 	g_SceneMesh.Destroy();
 
     // Destroy AMD_SDK resources here
@@ -1462,8 +1824,26 @@ bool CALLBACK ModifyDeviceSettings( DXUTDeviceSettings* pDeviceSettings, void* p
 //--------------------------------------------------------------------------------------
 void CALLBACK OnFrameMove( double fTime, float fElapsedTime, void* pUserContext )
 {
+    if ( g_Benchmark.bEnabled )
+    {
+        // The camera follows the benchmark's path instead
+        BenchmarkFrameMove();
+        return;
+    }
+
+    if ( g_bReplayingCamera )
+    {
+        ReplayCameraFrameMove();
+        return;
+    }
+
     // Update the camera's position based on user input 
     g_Camera.FrameMove( fElapsedTime );
+
+    if ( g_bRecordingCamera )
+    {
+        RecordCameraFrame( fTime );
+    }
 }
 
 
@@ -1512,6 +1892,17 @@ void CALLBACK OnKeyboard( UINT nChar, bool bKeyDown, bool bAltDown, void* pUserC
 			case VK_F5:
 				g_bRenderText = !g_bRenderText;
 				break;
+			case VK_F6:
+				TIMER_StartCapture( L"DepthBoundsTest11_Trace.json", TRACE_CAPTURE_FRAMES );
+				break;
+			case VK_F7:
+				if ( !g_Benchmark.bEnabled )
+					SetCameraRecording( !g_bRecordingCamera );
+				break;
+			case VK_F8:
+				if ( !g_Benchmark.bEnabled )
+					SetCameraReplay( !g_bReplayingCamera );
+				break;
 		}
     }
 }
@@ -1542,6 +1933,19 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
 		case IDC_SHOWDISCARDEDPIXELS:
 			g_bShowDiscardedPixels = ((CDXUTCheckBox*)pControl)->GetChecked();
 			break;
+		case IDC_MESHLOD:
+			g_bMeshLOD = ((CDXUTCheckBox*)pControl)->GetChecked();
+			break;
+		case IDC_MESHLETCULLING:
+			g_bMeshletCulling = ((CDXUTCheckBox*)pControl)->GetChecked();
+			CreateSceneMeshlets( DXUTGetD3D11Device() );
+			break;
+		case IDC_DEPTHPREPASS:
+			g_bDepthPrepass = ((CDXUTCheckBox*)pControl)->GetChecked();
+			break;
+		case IDC_LIGHTINGRESOLUTION:
+			g_iLightingResolution = ((CDXUTComboBox*)pControl)->GetSelectedIndex();
+			break;
 		case IDC_LIGHTCOUNTSLIDER:
 			g_NumPointLightsSlider->OnGuiEvent();
 			break;
@@ -1565,6 +1969,16 @@ HRESULT AddShadersToCache()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
 
+     // Depth prepass Layout (position-only vertex stream)
+    const D3D11_INPUT_ELEMENT_DESC positiononlylayout[] =
+    {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+	// Depth prepass shader
+    g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pDepthPrepassVS, AMD::ShaderCache::SHADER_TYPE_VERTEX, L"vs_5_0", L"VS_DepthOnly",
+        L"BuildGBuffers.hlsl", 0, NULL, &g_pPositionOnlyLayout, positiononlylayout, ARRAYSIZE( positiononlylayout ) );
+
 	// G-buffer building shaders
     g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pBuildingPass_StoreVS, AMD::ShaderCache::SHADER_TYPE_VERTEX, L"vs_5_0", L"VS_FillGBuffers",
         L"BuildGBuffers.hlsl", 0, NULL, &g_pMeshLayout, meshvertexlayout, ARRAYSIZE( meshvertexlayout ) );
@@ -1592,6 +2006,16 @@ HRESULT AddShadersToCache()
     g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pShadingPass_PointLightFromTilePS, AMD::ShaderCache::SHADER_TYPE_PIXEL, L"ps_5_0", L"PS_PointLight",
         L"ShadingPasses.hlsl", 0, NULL, NULL, NULL, 0 );
 
+	// Reduced resolution lighting shaders
+    g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pShadingPass_DownsampleDepthNormalPS, AMD::ShaderCache::SHADER_TYPE_PIXEL, L"ps_5_0", L"PS_DownsampleDepthNormal",
+        L"ShadingPasses.hlsl", 0, NULL, NULL, NULL, 0 );
+
+    g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pShadingPass_PointLightLowResPS, AMD::ShaderCache::SHADER_TYPE_PIXEL, L"ps_5_0", L"PS_PointLightLowRes",
+        L"ShadingPasses.hlsl", 0, NULL, NULL, NULL, 0 );
+
+    g_ShaderCache.AddShader( (ID3D11DeviceChild**)&g_pShadingPass_UpsampleLightingPS, AMD::ShaderCache::SHADER_TYPE_PIXEL, L"ps_5_0", L"PS_UpsampleLighting",
+        L"ShadingPasses.hlsl", 0, NULL, NULL, NULL, 0 );
+
     // Particle input layout
     const D3D11_INPUT_ELEMENT_DESC particlevertexlayout[] =
     {
@@ -1616,112 +2040,524 @@ HRESULT AddShadersToCache()
 
 
 //--------------------------------------------------------------------------------------
-// Calculates bounding rectangle in normalized device coordinates for
-// the view-space sphere with center "center" and radius "r". "zoom"
-// contains the first two diagonal entries of your projection matrix
-// (which is assumed to be perspective). You should do a rough rejection
-// test of the sphere against the frustum first.
-// Taken from: http://blog.gmane.org/gmane.games.devel.algorithms/month=20100101
+// Transform all point lights to tile coordinates
 //--------------------------------------------------------------------------------------
-static void CalcSphereBounds(const XMFLOAT3 center, float r, const float zoom[2], 
-                             float minb[2], float maxb[2])
+void ProcessRandomLights(XMMATRIX *pViewMatrix, XMMATRIX *pProjectionMatrix)
 {
-    // By default, assume that the full screen is covered
-    minb[0] = minb[1] = -1.0f;
-    maxb[0] = maxb[1] =  1.0f;
+	XMFLOAT4X4 mView;
+	XMFLOAT4X4 mProjection;
+	XMStoreFloat4x4( &mView, *pViewMatrix );
+	XMStoreFloat4x4( &mProjection, *pProjectionMatrix );
 
-    // Once for x, once for y
-    for (int i=0; i<2; i++)
-    {
-		float x;
-		if (i == 0)
-			x = center.x;
-		else
-			x = center.y;
+	// Screen rectangles and depth ranges of the light spheres, correct even if the camera is close to a sphere
+	AMD::ProcessPointLights( g_pLightArray, MAX_NUMBER_OF_LIGHTS, &mView.m[0][0], &mProjection.m[0][0], FRONT_CLIP_PLANE );
+}
 
-        float z = center.z;
-        float ds = x*x + z*z;
-        float l = ds - r * r;
 
-        if (l > 0.0f)
-        {
-            float s,c;
-            l = sqrt(l);
-
-            s = x * l - z * r;  // ds*sin(alpha)
-            c = x * r + z * l;  // ds*cos(alpha)
-            if (z*ds > -r*s)    // left/top intersection has positive z
-                minb[i] = MAX(-1.0f, s*zoom[i]/c);
-
-            s = z * r + x * l;  // ds*sin(beta)
-            c = z * l - x * r;  // ds*cos(beta)
-            if (z*ds > r*s)     // right/bottom intersection has positive z
-                maxb[i] = MIN(1.0f, s*zoom[i]/c);
-        }
-    }
+//--------------------------------------------------------------------------------------
+// Points the camera along a path key, with the key's projection if it has one. The
+// aspect ratio always stays the window's.
+//--------------------------------------------------------------------------------------
+static void SetCameraFromKey( const AMD::CameraKey& Key )
+{
+	g_Camera.SetViewParams( XMVectorSet( Key.fEye[0], Key.fEye[1], Key.fEye[2], 1.0f ), XMVectorSet( Key.fAt[0], Key.fAt[1], Key.fAt[2], 1.0f ) );
+	if ( Key.HasProjection() )
+	{
+		g_Camera.SetProjParams( Key.fFovY, g_Camera.GetAspect(), Key.fNearClip, Key.fFarClip );
+	}
 }
 
+
 //--------------------------------------------------------------------------------------
-// Transform all point lights to tile coordinates
+// Loads a text or binary camera path file, or one of the canned paths through the
+// powerplant by name: orbit, walkthrough or flyover
 //--------------------------------------------------------------------------------------
-void ProcessRandomLights(XMMATRIX *pViewMatrix, XMMATRIX *pProjectionMatrix)
+bool LoadCameraPath( const WCHAR* szName, AMD::CameraPath& Path )
 {
-    // Transform point light position from world space to view space
-    for (UINT i=0; i<MAX_NUMBER_OF_LIGHTS; i++)
-    {
-        // Transform point light position from world space to view space
-		XMVECTOR pos = XMVectorSet(g_pLightArray[i].vWorldSpacePosition.x, g_pLightArray[i].vWorldSpacePosition.y, 
-			g_pLightArray[i].vWorldSpacePosition.z, 1.0f);
-        XMVECTOR TransformedVertex = XMVector4Transform(pos, *pViewMatrix);
-        g_pLightArray[i].vViewSpacePosition.x = XMVectorGetX(TransformedVertex);
-        g_pLightArray[i].vViewSpacePosition.y = XMVectorGetY(TransformedVertex);
-        g_pLightArray[i].vViewSpacePosition.z = XMVectorGetZ(TransformedVertex);
-
-        // Calculate 2D screen coordinate extents of sphere
-        // This uses a correct method which works even if the camera is close to the sphere
-        float zoom[2];
-        zoom[0] = XMVectorGetX(pProjectionMatrix->r[0]);
-        zoom[1] = XMVectorGetY(pProjectionMatrix->r[1]);
-        float minb[2];
-        float maxb[2];
-        CalcSphereBounds(g_pLightArray[i].vViewSpacePosition, g_pLightArray[i].fRange, zoom, minb, maxb);
-
-        // Write min and max 2D tile coordinates into light array
-        g_pLightArray[i].vNDCTile2DCoordinatesMin.x = minb[0];
-        g_pLightArray[i].vNDCTile2DCoordinatesMin.y = minb[1];
-        
-        g_pLightArray[i].vNDCTile2DCoordinatesMax.x = maxb[0];
-        g_pLightArray[i].vNDCTile2DCoordinatesMax.y = maxb[1];
-
-
-        // Transform the point on the sphere closest to the camera to retrieve MinZ
-        XMVECTOR vClosest = XMVectorSet(g_pLightArray[i].vViewSpacePosition.x,
-                              g_pLightArray[i].vViewSpacePosition.y,
-                              g_pLightArray[i].vViewSpacePosition.z - g_pLightArray[i].fRange, 1.0f );
-        XMVECTOR vTransformedClosest = XMVector4Transform(vClosest, *pProjectionMatrix);
-		vTransformedClosest = vTransformedClosest / XMVectorGetW(vTransformedClosest);
-
-        // Transform the point on the sphere furthest to the camera to retrieve MaxZ
-        XMVECTOR vFurthest = XMVectorSet( g_pLightArray[i].vViewSpacePosition.x,
-                               g_pLightArray[i].vViewSpacePosition.y,
-                               g_pLightArray[i].vViewSpacePosition.z + g_pLightArray[i].fRange, 1.0f );
-        XMVECTOR vTransformedFurthest = XMVector4Transform(vFurthest, *pProjectionMatrix);
-		vTransformedFurthest = vTransformedFurthest / XMVectorGetW(vTransformedFurthest);
-
-        // Check if sphere intersects the front clip plane
-        if ( ( (g_pLightArray[i].vViewSpacePosition.z - g_pLightArray[i].fRange) < FRONT_CLIP_PLANE ) &&
-             ( (g_pLightArray[i].vViewSpacePosition.z + g_pLightArray[i].fRange) > FRONT_CLIP_PLANE ) )
-        {
-            // Closest sphere point is behind clip plane but furthest point is not
-            // We therefore need to clamp the closest sphere point
-			vTransformedClosest = XMVectorSet(XMVectorGetX(vTransformedClosest), XMVectorGetY(vTransformedClosest),
-				XMVectorGetZ(vTransformedClosest), 0.0f);
-        }
+	static const WCHAR* szCannedPaths[][2] =
+	{
+		{ L"orbit",			L"camerapaths\\PowerplantOrbit.txt" },
+		{ L"walkthrough",	L"camerapaths\\PowerplantWalkthrough.txt" },
+		{ L"flyover",		L"camerapaths\\PowerplantFlyover.txt" },
+	};
 
-        // Set min and max in tile coordinates
-        g_pLightArray[i].vNDCTile2DCoordinatesMin.z = XMVectorGetZ(vTransformedClosest);
-        g_pLightArray[i].vNDCTile2DCoordinatesMax.z = XMVectorGetZ(vTransformedFurthest);
-    }
+	for ( UINT i = 0; i < ARRAYSIZE( szCannedPaths ); i++ )
+	{
+		if ( _wcsicmp( szName, szCannedPaths[i][0] ) == 0 )
+		{
+			WCHAR szFileName[MAX_PATH];
+			return SUCCEEDED( DXUTFindDXSDKMediaFileCch( szFileName, MAX_PATH, szCannedPaths[i][1] ) ) && Path.Load( szFileName );
+		}
+	}
+
+	return Path.Load( szName );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Starts recording the camera, or stops and saves the recording, which F8 then replays
+//--------------------------------------------------------------------------------------
+void SetCameraRecording( bool bRecord )
+{
+	if ( bRecord )
+	{
+		SetCameraReplay( false );
+		g_CameraRecording.Clear();
+		g_fRecordingStartTime = DXUTGetTime();
+		g_bRecordingCamera = true;
+		return;
+	}
+
+	if ( !g_bRecordingCamera )
+		return;
+
+	g_bRecordingCamera = false;
+	if ( g_CameraRecording.GetKeyCount() == 0 )
+		return;
+
+	if ( !g_CameraRecording.Save( CAMERA_RECORDING_FILENAME ) )
+	{
+		OutputDebugString( L"Failed to save the camera recording.\n" );
+	}
+	g_CameraReplay = g_CameraRecording;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Starts replaying the last recording or -camerapath (the orbit if there's neither)
+// from its start, or stops replaying and gives the camera back to the user
+//--------------------------------------------------------------------------------------
+void SetCameraReplay( bool bReplay )
+{
+	if ( bReplay == g_bReplayingCamera )
+		return;
+
+	if ( bReplay )
+	{
+		SetCameraRecording( false );
+		if ( g_CameraReplay.GetKeyCount() == 0 && !LoadCameraPath( L"orbit", g_CameraReplay ) )
+		{
+			OutputDebugString( L"Failed to load a camera path to replay.\n" );
+			return;
+		}
+
+		// Anything else animated by the frame time advances with the path too
+		g_uReplayFrame = 0;
+		g_bReplayingCamera = true;
+		DXUTSetConstantFrameTime( true, 1.0f / g_fReplayFrameRate );
+		return;
+	}
+
+	g_bReplayingCamera = false;
+	DXUTSetConstantFrameTime( false );
+
+	// A recorded projection stays until the user's one is restored
+	if ( g_CameraReplay.HasProjection() )
+	{
+		g_Camera.SetProjParams( XM_PI / 4, g_Camera.GetAspect(), FRONT_CLIP_PLANE, FAR_CLIP_PLANE );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Appends the camera's state for this frame to the recording
+//--------------------------------------------------------------------------------------
+void RecordCameraFrame( double fTime )
+{
+	AMD::CameraKey Key;
+	Key.fTime = (float)( fTime - g_fRecordingStartTime );
+
+	// Keys must move forward in time, e.g. not while DXUT is paused
+	size_t uKeys = g_CameraRecording.GetKeyCount();
+	if ( uKeys > 0 && Key.fTime <= g_CameraRecording.GetKey( uKeys - 1 ).fTime )
+		return;
+
+	XMFLOAT3 vEye;
+	XMFLOAT3 vAt;
+	XMStoreFloat3( &vEye, g_Camera.GetEyePt() );
+	XMStoreFloat3( &vAt, g_Camera.GetLookAtPt() );
+	Key.fEye[0] = vEye.x;
+	Key.fEye[1] = vEye.y;
+	Key.fEye[2] = vEye.z;
+	Key.fAt[0] = vAt.x;
+	Key.fAt[1] = vAt.y;
+	Key.fAt[2] = vAt.z;
+	Key.fFovY = g_Camera.GetFOV();
+	Key.fAspect = g_Camera.GetAspect();
+	Key.fNearClip = g_Camera.GetNearClip();
+	Key.fFarClip = g_Camera.GetFarClip();
+
+	g_CameraRecording.AddKey( Key );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Moves the camera to the next frame of the replayed path, looping at its end. Frame n
+// shows the path at n / g_fReplayFrameRate seconds, interpolated between the keys, so a
+// replay sees the same views at any frame rate.
+//--------------------------------------------------------------------------------------
+void ReplayCameraFrameMove()
+{
+	g_fReplayTime = g_uReplayFrame / g_fReplayFrameRate;
+	if ( g_CameraReplay.GetDuration() > 0.0f )
+	{
+		g_fReplayTime = fmodf( g_fReplayTime, g_CameraReplay.GetDuration() );
+	}
+
+	AMD::CameraKey Key;
+	if ( g_CameraReplay.Evaluate( g_fReplayTime, Key ) )
+	{
+		SetCameraFromKey( Key );
+	}
+	g_uReplayFrame++;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Returns the value of a "-name:value" argument, or NULL if szArg is not that argument
+//--------------------------------------------------------------------------------------
+static const WCHAR* GetArgumentValue( const WCHAR* szArg, const WCHAR* szName )
+{
+	size_t uLength = wcslen( szName );
+	if ( _wcsnicmp( szArg, szName, uLength ) != 0 || szArg[uLength] != L':' )
+		return NULL;
+
+	return szArg + uLength + 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Parses a decimal number followed by szEnd, returns the character after it or NULL
+//--------------------------------------------------------------------------------------
+static const WCHAR* ParseUInt( const WCHAR* sz, const WCHAR* szEnd, UINT* pValue )
+{
+	WCHAR* pEnd = NULL;
+	unsigned long ulValue = wcstoul( sz, &pEnd, 10 );
+	if ( pEnd == sz || ( *pEnd != 0 && wcschr( szEnd, *pEnd ) == NULL ) )
+		return NULL;
+
+	*pValue = (UINT)ulValue;
+	return pEnd;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reads the benchmark settings from the command line, DXUT ignores the arguments:
+//
+//   -benchmark                   replay a camera path and exit when done
+//   -benchmarkframes:600         measured frames per light count
+//   -benchmarkseed:1             seed of the random lights
+//   -benchmarklights:25,50,150   light counts to sweep, one run each
+//   -benchmarkpath:file          camera path (see LoadCameraPath), orbits the lights by default
+//   -benchmarkout:name           writes name.csv and name.json
+//   -camerapath:file             replay a camera path from the start, as F8 does
+//   -camerapathfps:60            frames per second of path time during replays
+//
+// Returns false if an argument is invalid.
+//--------------------------------------------------------------------------------------
+bool ParseCommandLine()
+{
+	g_Benchmark.bEnabled = false;
+	g_Benchmark.uFrames = 600;
+	g_Benchmark.uRuns = 0;
+	g_Benchmark.szPath[0] = 0;
+	wcscpy_s( g_Benchmark.szOutput, MAX_PATH, L"DepthBoundsTest11_Benchmark" );
+	g_Benchmark.uRun = 0;
+	g_Benchmark.uFrame = 0;
+	g_Benchmark.llFrameStart = 0;
+	g_Benchmark.iExitCode = 0;
+
+	int iArgs = 0;
+	LPWSTR* pArgs = CommandLineToArgvW( GetCommandLineW(), &iArgs );
+	if ( pArgs == NULL )
+		return true;
+
+	bool bValid = true;
+	bool bReplay = false;
+	for ( int i = 1; i < iArgs && bValid; i++ )
+	{
+		const WCHAR* szArg = pArgs[i];
+		const WCHAR* szValue = NULL;
+		if ( *szArg == L'-' || *szArg == L'/' )
+			szArg++;
+
+		if ( _wcsicmp( szArg, L"benchmark" ) == 0 )
+		{
+			g_Benchmark.bEnabled = true;
+		}
+		else if ( _wcsicmp( szArg, L"meshlod" ) == 0 )
+		{
+			g_bMeshLOD = true;
+		}
+		else if ( _wcsicmp( szArg, L"meshletculling" ) == 0 )
+		{
+			g_bMeshletCulling = true;
+		}
+		else if ( _wcsicmp( szArg, L"depthprepass" ) == 0 )
+		{
+			g_bDepthPrepass = true;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"benchmarkframes" ) ) )
+		{
+			bValid = ParseUInt( szValue, L"", &g_Benchmark.uFrames ) != NULL && g_Benchmark.uFrames > 0;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"benchmarkseed" ) ) )
+		{
+			bValid = ParseUInt( szValue, L"", &g_uRandomSeed ) != NULL;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"benchmarklights" ) ) )
+		{
+			g_Benchmark.uRuns = 0;
+			while ( bValid && *szValue )
+			{
+				UINT uLights = 0;
+				szValue = ParseUInt( szValue, L",", &uLights );
+				bValid = szValue != NULL && uLights > 0 && uLights <= MAX_NUMBER_OF_LIGHTS && g_Benchmark.uRuns < BENCHMARK_MAX_RUNS;
+				if ( bValid )
+				{
+					g_Benchmark.uLightCounts[g_Benchmark.uRuns++] = uLights;
+					szValue += ( *szValue == L',' ) ? 1 : 0;
+				}
+			}
+			bValid = bValid && g_Benchmark.uRuns > 0;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"benchmarkpath" ) ) )
+		{
+			bValid = wcscpy_s( g_Benchmark.szPath, MAX_PATH, szValue ) == 0;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"benchmarkout" ) ) )
+		{
+			bValid = wcscpy_s( g_Benchmark.szOutput, MAX_PATH, szValue ) == 0 && *szValue;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"camerapath" ) ) )
+		{
+			bValid = LoadCameraPath( szValue, g_CameraReplay );
+			bReplay = bValid;
+		}
+		else if ( NULL != ( szValue = GetArgumentValue( szArg, L"camerapathfps" ) ) )
+		{
+			UINT uFrameRate = 0;
+			bValid = ParseUInt( szValue, L"", &uFrameRate ) != NULL && uFrameRate > 0;
+			g_fReplayFrameRate = (float)uFrameRate;
+		}
+
+		if ( !bValid )
+		{
+			WCHAR wcbuf[MAX_PATH + 64];
+			swprintf_s( wcbuf, MAX_PATH + 64, L"Invalid benchmark argument: %s\n", pArgs[i] );
+			OutputDebugString( wcbuf );
+		}
+	}
+	LocalFree( pArgs );
+
+	if ( !bValid )
+		return false;
+
+	// The HUD was created with the defaults, show what the command line turned on
+	g_HUD.m_GUI.GetCheckBox( IDC_MESHLOD )->SetChecked( g_bMeshLOD );
+	g_HUD.m_GUI.GetCheckBox( IDC_MESHLETCULLING )->SetChecked( g_bMeshletCulling );
+	g_HUD.m_GUI.GetCheckBox( IDC_DEPTHPREPASS )->SetChecked( g_bDepthPrepass );
+
+	// The benchmark drives the camera itself
+	if ( !g_Benchmark.bEnabled )
+	{
+		SetCameraReplay( bReplay );
+		return true;
+	}
+
+	if ( g_Benchmark.uRuns == 0 )
+	{
+		const UINT uDefaultLights[] = { 25, 50, 100, MAX_NUMBER_OF_LIGHTS };
+		for ( UINT i = 0; i < ARRAYSIZE( uDefaultLights ); i++ )
+		{
+			g_Benchmark.uLightCounts[g_Benchmark.uRuns++] = uDefaultLights[i];
+		}
+	}
+
+	if ( g_Benchmark.szPath[0] && !LoadCameraPath( g_Benchmark.szPath, g_BenchmarkPath ) )
+	{
+		OutputDebugString( L"Failed to load the benchmark camera path.\n" );
+		return false;
+	}
+
+	// Every frame advances the path by the same time, however long it took
+	DXUTSetConstantFrameTime( true, BENCHMARK_FRAME_TIME );
+
+	WCHAR wcbuf[64];
+	g_BenchmarkReport.Clear();
+	g_BenchmarkReport.SetInfo( L"sample", L"DepthBoundsTest11" );
+	g_BenchmarkReport.SetInfo( L"path", g_Benchmark.szPath[0] ? g_Benchmark.szPath : L"orbit" );
+	swprintf_s( wcbuf, 64, L"%u", g_uRandomSeed );
+	g_BenchmarkReport.SetInfo( L"seed", wcbuf );
+	swprintf_s( wcbuf, 64, L"%u", g_Benchmark.uFrames );
+	g_BenchmarkReport.SetInfo( L"frames", wcbuf );
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adds what the DXUT GUI drew this frame to the frame counters and ends their frame. The
+// benchmark and the trace capture record the frame, RenderText shows it the next frame.
+//--------------------------------------------------------------------------------------
+void EndFrameCounters()
+{
+	const DXUTSpriteStats& SpriteStats = g_DialogResourceManager.GetSpriteStats();
+	COUNTER_Add( AMD::FRAME_COUNTER_SPRITES_FLUSHED, SpriteStats.nSprites )
+	COUNTER_Add( AMD::FRAME_COUNTER_DRAW_CALLS, SpriteStats.nDrawCalls )
+	COUNTER_Add( AMD::FRAME_COUNTER_BYTES_MAPPED, SpriteStats.nBytesMapped )
+	g_DialogResourceManager.ResetSpriteStats();
+
+	COUNTER_EndFrame()
+}
+
+
+//--------------------------------------------------------------------------------------
+// Moves the camera along the benchmark path and starts each run
+//--------------------------------------------------------------------------------------
+void BenchmarkFrameMove()
+{
+	if ( !g_ShaderCache.ShadersReady() || g_Benchmark.uRun >= g_Benchmark.uRuns )
+		return;
+
+	if ( g_Benchmark.uFrame == 0 )
+	{
+		UINT uLights = g_Benchmark.uLightCounts[g_Benchmark.uRun];
+		WCHAR wcbuf[64];
+		swprintf_s( wcbuf, 64, L"%u lights", uLights );
+		if ( g_Benchmark.uRun == 0 )
+		{
+			g_BenchmarkReport.SetInfo( L"device", DXUTGetDeviceStats() );
+		}
+		g_BenchmarkReport.BeginRun( wcbuf );
+		g_BenchmarkReport.SetRunParameter( L"lights", uLights );
+
+		g_uNumberOfLights = uLights;
+		g_NumPointLightsSlider->SetValue( (int)uLights );
+	}
+
+	// The warmup frames all show the start of the path, the frames waiting for the GPU its end
+	UINT uPathFrame = ( g_Benchmark.uFrame > BENCHMARK_WARMUP_FRAMES ) ? g_Benchmark.uFrame - BENCHMARK_WARMUP_FRAMES : 0;
+	uPathFrame = std::min( uPathFrame, g_Benchmark.uFrames - 1 );
+	AMD::CameraKey Key;
+	if ( g_BenchmarkPath.Evaluate( uPathFrame * BENCHMARK_FRAME_TIME, Key ) )
+	{
+		SetCameraFromKey( Key );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Appends the CPU times of pTimer, its siblings and their children in milliseconds,
+// named by their path as in TIMER_GetTime
+//--------------------------------------------------------------------------------------
+static void RecordBenchmarkTimers( TimingEvent* pTimer, const std::wstring& Parent )
+{
+	for ( ; pTimer != NULL; pTimer = pTimer->GetNextTimer() )
+	{
+		std::wstring Path = Parent.empty() ? std::wstring( pTimer->GetName() ) : Parent + L"|" + pTimer->GetName();
+		g_BenchmarkReport.SetValue( ( L"cpu/" + Path ).c_str(), pTimer->GetTime( ttCpu ) * 1000.0 );
+		RecordBenchmarkTimers( pTimer->GetFirstChild(), Path );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sets the GPU times of pTimer, its siblings and their children in the row of the frame
+// they were measured in, once they came back
+//--------------------------------------------------------------------------------------
+static void RecordBenchmarkGpuTimes( TimingEvent* pTimer, const std::wstring& Parent, size_t uRow, UINT uGpuFrame )
+{
+	for ( ; pTimer != NULL; pTimer = pTimer->GetNextTimer() )
+	{
+		std::wstring Path = Parent.empty() ? std::wstring( pTimer->GetName() ) : Parent + L"|" + pTimer->GetName();
+		double fTime;
+		if ( pTimer->GetGpuFrameTime( uGpuFrame, fTime ) )
+		{
+			g_BenchmarkReport.SetFrameValue( uRow, ( L"gpu/" + Path ).c_str(), fTime * 1000.0 );
+		}
+		RecordBenchmarkGpuTimes( pTimer->GetFirstChild(), Path, uRow, uGpuFrame );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Records the frame into the benchmark report, writes the report and exits after the
+// last run
+//--------------------------------------------------------------------------------------
+void BenchmarkEndFrame()
+{
+	// Nothing to do before BenchmarkFrameMove started the run, or after the last one
+	if ( g_Benchmark.uRun >= g_Benchmark.uRuns || g_BenchmarkReport.GetRunCount() <= g_Benchmark.uRun )
+		return;
+
+	LARGE_INTEGER llNow;
+	QueryPerformanceCounter( &llNow );
+
+	const UINT uMeasuredFrames = BENCHMARK_WARMUP_FRAMES + g_Benchmark.uFrames;
+	if ( g_Benchmark.uFrame >= BENCHMARK_WARMUP_FRAMES && g_Benchmark.uFrame < uMeasuredFrames )
+	{
+		LARGE_INTEGER llFrequency;
+		QueryPerformanceFrequency( &llFrequency );
+
+		g_BenchmarkReport.BeginFrame();
+		g_BenchmarkReport.SetValue( L"cpu/Frame", ( llNow.QuadPart - g_Benchmark.llFrameStart ) * 1000.0 / llFrequency.QuadPart );
+#if ENABLE_AMD_TIMER
+		RecordBenchmarkTimers( TimerEx::Instance().GetTimer(), std::wstring() );
+		if ( TimerEx::Instance().GetGpuQueryPool() )
+		{
+			const UINT uRow = g_Benchmark.uFrame - BENCHMARK_WARMUP_FRAMES;
+			g_Benchmark.uGpuFrames[uRow % BENCHMARK_GPU_LATENCY_FRAMES] = TimerEx::Instance().GetGpuQueryPool()->GetFrame();
+		}
+#endif
+		AMD::FrameCounterRegistry& Counters = AMD::FrameCounterRegistry::Instance();
+		for ( UINT i = 0; i < Counters.GetCount(); i++ )
+		{
+			g_BenchmarkReport.SetValue( Counters.GetName( i ), (double)Counters.GetFrameValue( i ) );
+		}
+		if ( g_bMeshletCulling && g_SceneMeshlets.IsCreated() )
+		{
+			const AMD::MeshletCullStatistics& Stats = g_SceneMeshlets.GetStatistics();
+			g_BenchmarkReport.SetValue( L"meshlets visible", Stats.uVisible );
+			g_BenchmarkReport.SetValue( L"triangles visible", Stats.uTrianglesVisible );
+		}
+	}
+	g_Benchmark.llFrameStart = llNow.QuadPart;
+
+#if ENABLE_AMD_TIMER
+	// GPU times come back a few frames late; the pool returns or drops a frame's before it is
+	// BENCHMARK_GPU_LATENCY_FRAMES frames old, so only the last rows can still be waiting
+	if ( g_Benchmark.uFrame >= BENCHMARK_WARMUP_FRAMES && TimerEx::Instance().GetGpuQueryPool() )
+	{
+		const UINT uRows = std::min( g_Benchmark.uFrame + 1, uMeasuredFrames ) - BENCHMARK_WARMUP_FRAMES;
+		for ( UINT uRow = ( uRows > BENCHMARK_GPU_LATENCY_FRAMES ) ? uRows - BENCHMARK_GPU_LATENCY_FRAMES : 0; uRow < uRows; uRow++ )
+		{
+			RecordBenchmarkGpuTimes( TimerEx::Instance().GetTimer(), std::wstring(), uRow, g_Benchmark.uGpuFrames[uRow % BENCHMARK_GPU_LATENCY_FRAMES] );
+		}
+	}
+#endif
+
+	// Keeps rendering the end of the path until the GPU times of the last frames are in
+	if ( ++g_Benchmark.uFrame < uMeasuredFrames + BENCHMARK_GPU_LATENCY_FRAMES )
+		return;
+
+	g_Benchmark.uFrame = 0;
+	if ( ++g_Benchmark.uRun < g_Benchmark.uRuns )
+		return;
+
+	WCHAR szFileName[MAX_PATH + 8];
+	swprintf_s( szFileName, MAX_PATH + 8, L"%s.csv", g_Benchmark.szOutput );
+	bool bWritten = g_BenchmarkReport.WriteCsv( szFileName );
+	swprintf_s( szFileName, MAX_PATH + 8, L"%s.json", g_Benchmark.szOutput );
+	bWritten = g_BenchmarkReport.WriteJson( szFileName ) && bWritten;
+	if ( !bWritten )
+	{
+		OutputDebugString( L"Failed to write the benchmark report.\n" );
+	}
+
+	// Close the window once the frame is done
+	g_Benchmark.iExitCode = bWritten ? 0 : 1;
+	PostMessage( DXUTGetHWND(), WM_CLOSE, 0, 0 );
 }
 
 
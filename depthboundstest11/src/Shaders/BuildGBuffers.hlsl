@@ -59,10 +59,11 @@ PS_INPUT VS_FillGBuffers( VS_INPUT i )
 {
     PS_INPUT Out;
 
-	matrix mWorldViewProjection = mul ( g_mViewProjection, g_mWorld );
+	precise matrix mWorldViewProjection = mul ( g_mViewProjection, g_mWorld );
 
-    // Compute position in clipping space
-    Out.vPosition = mul( float4( i.inPositionOS.xyz, 1.0 ), mWorldViewProjection );
+    // Compute position in clipping space (precise so it matches VS_DepthOnly bit for bit)
+    precise float4 vPosition = mul( float4( i.inPositionOS.xyz, 1.0 ), mWorldViewProjection );
+    Out.vPosition = vPosition;
     
     // Transform normals (which are defined locally to the model) into world space
 	Out.vTNormal   = mul(i.vInNormalOS,   (float3x3)g_mWorld);
@@ -76,6 +77,18 @@ PS_INPUT VS_FillGBuffers( VS_INPUT i )
     return Out;
 }   
 
+//--------------------------------------------------------------------------------------
+// Vertex shader: Depth prepass from the position-only vertex stream
+//--------------------------------------------------------------------------------------
+float4 VS_DepthOnly( float3 inPositionOS : POSITION ) : SV_POSITION
+{
+    // Same math as VS_FillGBuffers so the G-Buffer pass can test for EQUAL depth
+	precise matrix mWorldViewProjection = mul ( g_mViewProjection, g_mWorld );
+    precise float4 vPosition = mul( float4( inPositionOS.xyz, 1.0 ), mWorldViewProjection );
+
+    return vPosition;
+}
+
 //--------------------------------------------------------------------------------------
 // Pixel shader: Fill G-Buffers
 //--------------------------------------------------------------------------------------
@@ -77,4 +77,7 @@ cbuffer cbMain : register( b0 )
 
 	// visualization
 	float g_ShowDiscardedPixels;				// visualization to show discarded pixels
+
+	// Reduced resolution lighting
+	float g_fLightingDownsample;				// full resolution pixels per lighting pixel in x and y
 };
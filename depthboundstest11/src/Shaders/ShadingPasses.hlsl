@@ -40,6 +40,11 @@
 Texture2D txGBuffer0    : register(t0);
 Texture2D txGBuffer1    : register(t1);
 Texture2D txDepthBuffer : register(t2);
+
+// Reduced resolution lighting
+Texture2D txLowResLight  : register(t3);   // Diffuse light in xyz, specular light luminance in w
+Texture2D txLowResNormal : register(t4);   // Normal in xyz, index of the kept full resolution sample in w
+Texture2D txLowResDepth  : register(t5);
                         
                   
 //--------------------------------------------------------------------------------------
@@ -72,6 +77,13 @@ struct PS_FULLSCREEN_QUAD_INPUT
 };
 
 
+struct PS_DOWNSAMPLE_OUTPUT
+{
+    float4 vNormal : SV_TARGET0;
+    float  fDepth  : SV_DEPTH;
+};
+
+
 struct VS_QUAD_INPUT 
 {
     float3 vNDCPosition : NDCPOSITION;
@@ -204,6 +216,57 @@ VS_QUAD_OUTPUT VS_PointLightFromTile( VS_QUAD_INPUT In )
 }
 
 
+//--------------------------------------------------------------------------------------
+// Function:    PointLightIntensity
+//
+// Description: Diffuse (x) and specular (y) intensity of a point light at a surface
+//              point, including the distance falloff.
+//--------------------------------------------------------------------------------------
+float2 PointLightIntensity( float3 vWorldSpacePosition, float3 vNormal, float4 vLightPositionAndRange )
+{
+    float  fDiffuseIntensity = 0.0;
+    float  fSpecularIntensity = 0.0;
+
+    //
+    // Retrieve point light properties
+    //
+    float3 vLightPosition = vLightPositionAndRange.xyz;
+    float fLightRange = vLightPositionAndRange.w;
+	
+	//
+	// Apply light equation
+	//
+	
+	// Calculate light vector
+    float3 fLightVector = vLightPosition.xyz - vWorldSpacePosition.xyz;
+    
+    // Distance falloff
+	float fDistanceFallOff = saturate(1.0 - pow(length(fLightVector)/fLightRange, 4));
+
+    // Normalize light vector
+    fLightVector = normalize(fLightVector);
+    
+	// Diffuse intensity
+	fDiffuseIntensity = saturate(dot(vNormal.xyz, fLightVector));
+	
+    // Specular intensity	
+	if (fDiffuseIntensity>0)
+	{
+	    // Calculate view vector
+	    float3 vViewVector = normalize(vWorldSpacePosition.xyz - g_vEye.xyz);
+	    
+	    // Calculate reflection vector
+	    float3 vReflectionVector = normalize(reflect(fLightVector, vNormal.xyz));
+	    
+	    // Specular intensity
+		fSpecularIntensity = saturate(dot(vReflectionVector, vViewVector));
+		fSpecularIntensity = pow(fSpecularIntensity, 16);		// Hard-coded for now - should ideally come from material (thus from GBuffer)
+	}
+
+    return float2(fDiffuseIntensity, fSpecularIntensity) * fDistanceFallOff;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Function:    PS_PointLight
 //
@@ -216,8 +279,6 @@ float4 PS_PointLight( PS_QUAD_INPUT i ) : SV_TARGET
     float4 vDiffuseColor = float4(0, 0, 0, 0);
     float  fSpecularColor = 0;
     float4 vNormal = float4(0, 0, 0, 0);
-    float  fDiffuseIntensity = 0.0;
-    float  fSpecularIntensity = 0.0;
 	float4 discardColor = float4(0.03, 0.00, 0.03, 0);
     
     // Convert screen coordinates to integer
@@ -241,23 +302,6 @@ float4 PS_PointLight( PS_QUAD_INPUT i ) : SV_TARGET
 	// Convert Depth to World-space depth
     float4 vWorldSpacePosition = mul(float4(i.vPosition.x, i.vPosition.y, fDepthBufferDepth, 1.0), g_mInvViewProjectionViewport);
     vWorldSpacePosition.xyz = vWorldSpacePosition.xyz / vWorldSpacePosition.w;
-    
-    //
-    // Retrieve point light properties
-    //
-    float3 vLightPosition = i.vLightPositionAndRange.xyz;
-    float fLightRange = i.vLightPositionAndRange.w;
-    float3 vLightColor = i.vLightColor;    
-	
-	//
-	// Apply light equation
-	//
-	
-	// Calculate light vector
-    float3 fLightVector = vLightPosition.xyz - vWorldSpacePosition.xyz;
-    
-    // Distance falloff
-	float fDistanceFallOff = saturate(1.0 - pow(length(fLightVector)/fLightRange, 4));
 
 	if (g_ShowDiscardedPixels)
 	{
@@ -265,32 +309,201 @@ float4 PS_PointLight( PS_QUAD_INPUT i ) : SV_TARGET
 		return discardColor;
 	}
 
-    // Normalize light vector
-    fLightVector = normalize(fLightVector);
-    
-	// Diffuse intensity
-	fDiffuseIntensity = saturate(dot(vNormal.xyz, fLightVector));
-	
-    // Specular intensity	
-	if (fDiffuseIntensity>0)
-	{
-	    // Calculate view vector
-	    float3 vViewVector = normalize(vWorldSpacePosition.xyz - g_vEye.xyz);
-	    
-	    // Calculate reflection vector
-	    float3 vReflectionVector = normalize(reflect(fLightVector, vNormal.xyz));
-	    
-	    // Specular intensity
-		fSpecularIntensity = saturate(dot(vReflectionVector, vViewVector));
-		fSpecularIntensity = pow(fSpecularIntensity, 16);		// Hard-coded for now - should ideally come from material (thus from GBuffer)
-	}
+    float2 vIntensity = PointLightIntensity( vWorldSpacePosition.xyz, vNormal.xyz, i.vLightPositionAndRange );
     
     // Final equation
     float4 vColor;
-    vColor.xyz = (fDiffuseIntensity*vDiffuseColor.xyz + fSpecularIntensity*fSpecularColor) * vLightColor.xyz * fDistanceFallOff;
+    vColor.xyz = (vIntensity.x*vDiffuseColor.xyz + vIntensity.y*fSpecularColor) * i.vLightColor.xyz;
     vColor.w   = 0;
 
     return vColor;
 }
 
 
+//--------------------------------------------------------------------------------------
+// Function:    GetFullResolutionPosition
+//
+// Description: Full resolution pixel position of the sample a low resolution lighting
+//              pixel was reduced to (see PS_DownsampleDepthNormal)
+//--------------------------------------------------------------------------------------
+float2 GetFullResolutionPosition( int2 nLowResCoordinates, float fSampleIndex )
+{
+    int nFactor = (int)g_fLightingDownsample;
+    int nIndex  = (int)round( fSampleIndex * 15.0 );
+
+    return float2( nLowResCoordinates * nFactor + int2( nIndex % nFactor, nIndex / nFactor ) ) + 0.5;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Function:    PS_DownsampleDepthNormal
+//
+// Description: Reduce depth and normal to the lighting resolution. Each low resolution
+//              pixel keeps one of the full resolution samples it covers, alternating
+//              between the nearest and the farthest one in a checkerboard so that both
+//              sides of a depth edge are lit. The kept sample's index goes to normal.w.
+//--------------------------------------------------------------------------------------
+PS_DOWNSAMPLE_OUTPUT PS_DownsampleDepthNormal( PS_FULLSCREEN_QUAD_INPUT i )
+{
+    PS_DOWNSAMPLE_OUTPUT Out = (PS_DOWNSAMPLE_OUTPUT)0;
+
+    int  nFactor = (int)g_fLightingDownsample;
+    int2 nLowResCoordinates = int2(i.vPosition.xy);
+    int2 nFirst = nLowResCoordinates * nFactor;
+    bool bFarthest = ((nLowResCoordinates.x + nLowResCoordinates.y) & 1) != 0;
+
+    // The last row and column may hang over the edge of the full resolution buffer
+    uint uWidth, uHeight;
+    txDepthBuffer.GetDimensions( uWidth, uHeight );
+    int2 nCount = min( int2(nFactor, nFactor), int2(uWidth, uHeight) - nFirst );
+
+    int   nBestIndex = 0;
+    float fBestDepth = txDepthBuffer.Load( int3(nFirst, 0) ).x;
+
+    [loop]
+    for (int y = 0; y < nCount.y; y++)
+    {
+        [loop]
+        for (int x = 0; x < nCount.x; x++)
+        {
+            float fDepth = txDepthBuffer.Load( int3(nFirst + int2(x, y), 0) ).x;
+            if (bFarthest ? (fDepth > fBestDepth) : (fDepth < fBestDepth))
+            {
+                fBestDepth = fDepth;
+                nBestIndex = y * nFactor + x;
+            }
+        }
+    }
+
+    int2 nBest = nFirst + int2(nBestIndex % nFactor, nBestIndex / nFactor);
+    Out.vNormal = float4(txGBuffer1.Load( int3(nBest, 0) ).xyz, nBestIndex / 15.0);
+    Out.fDepth  = fBestDepth;
+
+    return Out;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Function:    PS_PointLightLowRes
+//
+// Description: Accumulate point light contribution at the lighting resolution. Albedo
+//              is applied at full resolution in PS_UpsampleLighting, so only the light
+//              is stored: diffuse light in xyz and specular light luminance in w.
+//--------------------------------------------------------------------------------------
+float4 PS_PointLightLowRes( PS_QUAD_INPUT i ) : SV_TARGET
+{
+	float4 discardColor = float4(0.03, 0.00, 0.03, 0);
+
+	int3 nScreenCoordinates = int3(i.vPosition.xy, 0);
+
+    // Normal and depth of the kept full resolution sample
+	float4 vNormal = txLowResNormal.Load( nScreenCoordinates );
+	float  fDepthBufferDepth = txLowResDepth.Load( nScreenCoordinates ).x;
+    float2 vFullResPosition = GetFullResolutionPosition( nScreenCoordinates.xy, vNormal.w );
+
+	vNormal.xyz = vNormal.xyz * 2.0 - 1.0;
+
+    float4 vWorldSpacePosition = mul(float4(vFullResPosition, fDepthBufferDepth, 1.0), g_mInvViewProjectionViewport);
+    vWorldSpacePosition.xyz = vWorldSpacePosition.xyz / vWorldSpacePosition.w;
+
+	if (g_ShowDiscardedPixels)
+	{
+		// shows pixels discarded by shader
+		return discardColor;
+	}
+
+    float2 vIntensity = PointLightIntensity( vWorldSpacePosition.xyz, vNormal.xyz, i.vLightPositionAndRange );
+
+    return float4(vIntensity.x * i.vLightColor.xyz, vIntensity.y * dot(i.vLightColor.xyz, float3(0.299, 0.587, 0.114)));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Function:    LinearDepth
+//
+// Description: View space depth from a depth buffer value
+//--------------------------------------------------------------------------------------
+float LinearDepth( float fDepthBufferDepth )
+{
+    return g_mProjection._43 / (fDepthBufferDepth - g_mProjection._33);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Function:    PS_UpsampleLighting
+//
+// Description: Bilateral upsample of the low resolution light accumulation. The four
+//              nearest lighting pixels are weighted bilinearly and by how well their
+//              depth and normal match the full resolution pixel, then the full
+//              resolution albedo and specular are applied.
+//--------------------------------------------------------------------------------------
+float4 PS_UpsampleLighting( PS_FULLSCREEN_QUAD_INPUT i ) : SV_TARGET
+{
+    float4 vDiffuseColor = float4(0, 0, 0, 0);
+    float  fSpecularColor = 0;
+
+	int3 nScreenCoordinates = int3(i.vPosition.xy, 0);
+
+    float fDepthBufferDepth = txDepthBuffer.Load( nScreenCoordinates ).x;
+    if (fDepthBufferDepth >= 1.0)
+        return float4(0, 0, 0, 0);
+
+    float4(vDiffuseColor.xyz, fSpecularColor) = txGBuffer0.Load( nScreenCoordinates );
+	float3 vNormal = txGBuffer1.Load( nScreenCoordinates ).xyz * 2.0 - 1.0;
+    float  fLinearDepth = LinearDepth( fDepthBufferDepth );
+
+    uint uWidth, uHeight;
+    txLowResLight.GetDimensions( uWidth, uHeight );
+    int2 nMax = int2(uWidth, uHeight) - 1;
+
+    float2 vLowResPosition = i.vPosition.xy / g_fLightingDownsample - 0.5;
+    int2   nBase = int2(floor(vLowResPosition));
+    float2 vFraction = vLowResPosition - nBase;
+
+    float4 vLight = float4(0, 0, 0, 0);
+    float  fTotalWeight = 0;
+    float4 vNearestLight = float4(0, 0, 0, 0);
+    float  fNearestDistance = 1e30;
+
+    [unroll]
+    for (int nTap = 0; nTap < 4; nTap++)
+    {
+        int2 nOffset = int2(nTap & 1, nTap >> 1);
+        int3 nTapCoordinates = int3(clamp(nBase + nOffset, int2(0, 0), nMax), 0);
+
+        float4 vTapLight  = txLowResLight.Load( nTapCoordinates );
+        float3 vTapNormal = txLowResNormal.Load( nTapCoordinates ).xyz * 2.0 - 1.0;
+        float  fTapDepth  = LinearDepth( txLowResDepth.Load( nTapCoordinates ).x );
+
+        float2 vBilinear = lerp( 1.0 - vFraction, vFraction, float2(nOffset) );
+        float  fDepthDistance = abs(fTapDepth - fLinearDepth) / fLinearDepth;
+        float  fDepthWeight = 1.0 / (fDepthDistance * 100.0 + 1e-3);
+        float  fNormalWeight = pow(saturate(dot(vNormal, vTapNormal)), 8);
+        float  fWeight = vBilinear.x * vBilinear.y * fDepthWeight * fNormalWeight;
+
+        vLight += vTapLight * fWeight;
+        fTotalWeight += fWeight;
+
+        if (fDepthDistance < fNearestDistance)
+        {
+            fNearestDistance = fDepthDistance;
+            vNearestLight = vTapLight;
+        }
+    }
+
+    // Fall back to the closest depth when no tap belongs to this surface
+    vLight = (fTotalWeight > 1e-4) ? vLight / fTotalWeight : vNearestLight;
+
+	if (g_ShowDiscardedPixels)
+	{
+		return float4(vLight.xyz, 0);
+	}
+
+    // Tint the specular luminance with the diffuse light's chromaticity
+    float  fDiffuseLuminance = dot(vLight.xyz, float3(0.299, 0.587, 0.114));
+    float3 vSpecularLight = vLight.w * (fDiffuseLuminance > 1e-5 ? vLight.xyz / fDiffuseLuminance : float3(1, 1, 1));
+
+    return float4(vLight.xyz * vDiffuseColor.xyz + vSpecularLight * fSpecularColor, 0);
+}
+
+
@@ -357,5 +357,6 @@ void      WINAPI DXUTDestroyState(); // Optional method to destroy DXUT's memory
 //--------------------------------------------------------------------------------------
 // DXUT core layer includes
 //--------------------------------------------------------------------------------------
+#include "DXUTClock.h"
 #include "DXUTmisc.h"
 #include "DXUTDevice11.h"
@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: DXUTClock.h
+//
+// High resolution clock shared by CDXUTTimer and the AMD SDK timers (CpuTimer, TimerEx).
+//
+// On x86/x64 CPUs with an invariant time stamp counter (constant rate in all power states,
+// synchronized across cores) the clock reads the TSC directly. Its rate is calibrated once
+// against QueryPerformanceCounter, or clock_gettime( CLOCK_MONOTONIC ) outside Windows.
+// Without an invariant TSC the clock reads that reference clock instead, so reads are
+// always consistent across cores and no thread needs to be pinned to one processor.
+//
+// Header only and without DXUT dependencies, so the timing code also builds on Linux.
+// The clock is set up by the first call, which should happen during startup on one thread,
+// e.g. by constructing DXUTGetGlobalTimer().
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define DXUT_CLOCK_HAS_TSC 1
+#else
+#define DXUT_CLOCK_HAS_TSC 0
+#endif
+
+enum DXUT_CLOCK_SOURCE
+{
+    DXUT_CLOCK_SOURCE_TSC,          // Invariant time stamp counter
+    DXUT_CLOCK_SOURCE_QPC,          // QueryPerformanceCounter
+    DXUT_CLOCK_SOURCE_MONOTONIC,    // clock_gettime( CLOCK_MONOTONIC )
+};
+
+class CDXUTClock
+{
+public:
+
+    // Current time in ticks of GetFrequency()
+    static long long Now()
+    {
+#if DXUT_CLOCK_HAS_TSC
+        if ( GetState().Source == DXUT_CLOCK_SOURCE_TSC )
+        {
+            return (long long)__rdtsc();
+        }
+#endif
+        return ReadReference();
+    }
+
+    // Ticks per second
+    static long long GetFrequency() { return GetState().llFrequency; }
+
+    static double TicksToSeconds( long long llTicks ) { return (double)llTicks * GetState().fSecondsPerTick; }
+
+    static DXUT_CLOCK_SOURCE GetSource() { return GetState().Source; }
+
+    static const char* GetSourceName()
+    {
+        switch ( GetState().Source )
+        {
+        case DXUT_CLOCK_SOURCE_TSC: return "invariant TSC";
+        case DXUT_CLOCK_SOURCE_QPC: return "QueryPerformanceCounter";
+        default:                    return "clock_gettime( CLOCK_MONOTONIC )";
+        }
+    }
+
+    // Measured cost of one Now(), in seconds
+    static double GetReadOverhead() { return GetState().fReadOverhead; }
+
+private:
+
+    struct State
+    {
+        DXUT_CLOCK_SOURCE   Source;
+        long long           llFrequency;
+        double              fSecondsPerTick;
+        double              fReadOverhead;
+
+        State()
+        {
+            Source = ReferenceSource();
+            llFrequency = ReferenceFrequency();
+
+#if DXUT_CLOCK_HAS_TSC
+            if ( HasInvariantTsc() )
+            {
+                long long llTscFrequency = CalibrateTsc();
+                if ( llTscFrequency > 0 )
+                {
+                    Source = DXUT_CLOCK_SOURCE_TSC;
+                    llFrequency = llTscFrequency;
+                }
+            }
+#endif
+            fSecondsPerTick = 1.0 / (double)llFrequency;
+            fReadOverhead = MeasureReadOverhead();
+        }
+
+        double MeasureReadOverhead() const
+        {
+            const int iReads = 1000;
+            long long llStart = Read();
+            long long llStop = llStart;
+            for ( int i = 0; i < iReads; i++ )
+            {
+                llStop = Read();
+            }
+
+            return (double)( llStop - llStart ) * fSecondsPerTick / iReads;
+        }
+
+        long long Read() const
+        {
+#if DXUT_CLOCK_HAS_TSC
+            if ( Source == DXUT_CLOCK_SOURCE_TSC )
+            {
+                return (long long)__rdtsc();
+            }
+#endif
+            return ReadReference();
+        }
+    };
+
+    static State& GetState()
+    {
+        static State s_State;
+        return s_State;
+    }
+
+    static DXUT_CLOCK_SOURCE ReferenceSource()
+    {
+#if defined( _WIN32 )
+        return DXUT_CLOCK_SOURCE_QPC;
+#else
+        return DXUT_CLOCK_SOURCE_MONOTONIC;
+#endif
+    }
+
+    static long long ReadReference()
+    {
+#if defined( _WIN32 )
+        LARGE_INTEGER qwTime;
+        QueryPerformanceCounter( &qwTime );
+        return qwTime.QuadPart;
+#else
+        timespec Time;
+        clock_gettime( CLOCK_MONOTONIC, &Time );
+        return (long long)Time.tv_sec * 1000000000ll + Time.tv_nsec;
+#endif
+    }
+
+    static long long ReferenceFrequency()
+    {
+#if defined( _WIN32 )
+        LARGE_INTEGER qwTicksPerSec;
+        QueryPerformanceFrequency( &qwTicksPerSec );
+        return qwTicksPerSec.QuadPart;
+#else
+        return 1000000000ll;
+#endif
+    }
+
+#if DXUT_CLOCK_HAS_TSC
+    // CPUID 0x80000007, EDX bit 8
+    static bool HasInvariantTsc()
+    {
+#if defined( _WIN32 )
+        int iRegs[4];
+        __cpuid( iRegs, 0x80000000 );
+        if ( (unsigned int)iRegs[0] < 0x80000007 )
+        {
+            return false;
+        }
+        __cpuid( iRegs, 0x80000007 );
+        return ( iRegs[3] & ( 1 << 8 ) ) != 0;
+#else
+        unsigned int uEax, uEbx, uEcx, uEdx;
+        if ( __get_cpuid_max( 0x80000000, 0 ) < 0x80000007 || !__get_cpuid( 0x80000007, &uEax, &uEbx, &uEcx, &uEdx ) )
+        {
+            return false;
+        }
+        return ( uEdx & ( 1u << 8 ) ) != 0;
+#endif
+    }
+
+    // Counts TSC ticks over 20 ms of the reference clock. Returns 0 if the two clocks
+    // disagree between two halves of the interval, e.g. because the TSC isn't usable.
+    static long long CalibrateTsc()
+    {
+        const long long llReferenceFrequency = ReferenceFrequency();
+        const long long llHalf = llReferenceFrequency / 100;
+
+        long long llRef[3], llTsc[3];
+        llRef[0] = ReadReference();
+        llTsc[0] = (long long)__rdtsc();
+        for ( int i = 1; i < 3; i++ )
+        {
+            do
+            {
+                llRef[i] = ReadReference();
+            } while ( llRef[i] - llRef[i - 1] < llHalf );
+            llTsc[i] = (long long)__rdtsc();
+        }
+
+        const double fRate0 = (double)( llTsc[1] - llTsc[0] ) / (double)( llRef[1] - llRef[0] );
+        const double fRate1 = (double)( llTsc[2] - llTsc[1] ) / (double)( llRef[2] - llRef[1] );
+        if ( fRate0 <= 0.0 || fRate1 <= 0.0 || fRate0 / fRate1 > 1.01 || fRate1 / fRate0 > 1.01 )
+        {
+            return 0;
+        }
+
+        return (long long)( (double)( llTsc[2] - llTsc[0] ) / (double)( llRef[2] - llRef[0] ) * (double)llReferenceFrequency );
+    }
+#endif
+};
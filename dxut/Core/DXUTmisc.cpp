@@ -38,10 +38,8 @@ CDXUTTimer::CDXUTTimer()
     m_llLastElapsedTime = 0;
     m_llBaseTime = 0;
 
-    // Use QueryPerformanceFrequency to get the frequency of the counter
-    LARGE_INTEGER qwTicksPerSec = { 0 };
-    QueryPerformanceFrequency( &qwTicksPerSec );
-    m_llQPFTicksPerSec = qwTicksPerSec.QuadPart;
+    // Ticks of the shared high resolution clock (invariant TSC or QueryPerformanceCounter)
+    m_llQPFTicksPerSec = CDXUTClock::GetFrequency();
 }
 
 
@@ -62,7 +60,7 @@ void CDXUTTimer::Start()
 {
     // Get the current time
     LARGE_INTEGER qwTime = { 0 };
-    QueryPerformanceCounter( &qwTime );
+    qwTime.QuadPart = CDXUTClock::Now();
 
     if( m_bTimerStopped )
         m_llBaseTime += qwTime.QuadPart - m_llStopTime;
@@ -78,7 +76,7 @@ void CDXUTTimer::Stop()
     if( !m_bTimerStopped )
     {
         LARGE_INTEGER qwTime = { 0 };
-        QueryPerformanceCounter( &qwTime );
+        qwTime.QuadPart = CDXUTClock::Now();
         m_llStopTime = qwTime.QuadPart;
         m_llLastElapsedTime = qwTime.QuadPart;
         m_bTimerStopped = TRUE;
@@ -97,7 +95,7 @@ void CDXUTTimer::Advance()
 double CDXUTTimer::GetAbsoluteTime() const
 {
     LARGE_INTEGER qwTime = { 0 };
-    QueryPerformanceCounter( &qwTime );
+    qwTime.QuadPart = CDXUTClock::Now();
 
     double fTime = qwTime.QuadPart / ( double )m_llQPFTicksPerSec;
 
@@ -168,7 +166,7 @@ LARGE_INTEGER CDXUTTimer::GetAdjustedCurrentTime() const
     if( m_llStopTime != 0 )
         qwTime.QuadPart = m_llStopTime;
     else
-        QueryPerformanceCounter( &qwTime );
+        qwTime.QuadPart = CDXUTClock::Now();
     return qwTime;
 }
 
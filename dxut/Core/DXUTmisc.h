@@ -95,6 +95,7 @@ public:
 
     // Limit the current thread to one processor (the current one). This ensures that timing code runs
     // on only one processor, and will not suffer any ill effects from power management.
+    // Not needed with the clocks CDXUTClock picks, which are consistent across processors.
     void            LimitThreadAffinityToCurrentProc();
 
 protected:
@@ -2259,6 +2259,7 @@ CDXUTDialogResourceManager::CDXUTDialogResourceManager() :
     m_pSpriteBuffer11(nullptr),
     m_SpriteBufferBytes11(0)
 {
+    ResetSpriteStats();
 }
 
 
@@ -2591,6 +2592,7 @@ void CDXUTDialogResourceManager::EndSprites11( ID3D11Device* pd3dDevice, ID3D11D
         { 
             memcpy( MappedResource.pData, (const void*)&m_SpriteVertices[0], SpriteDataBytes );
             pd3dImmediateContext->Unmap(m_pSpriteBuffer11, 0);
+            m_SpriteStats.nBytesMapped += SpriteDataBytes;
         }
 
         // Draw
@@ -2601,6 +2603,10 @@ void CDXUTDialogResourceManager::EndSprites11( ID3D11Device* pd3dDevice, ID3D11D
         pd3dImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
         pd3dImmediateContext->Draw( static_cast<UINT>( m_SpriteVertices.size() ), 0 );
 
+        // Two triangles per sprite
+        m_SpriteStats.nSprites += static_cast<UINT>( m_SpriteVertices.size() / 6 );
+        m_SpriteStats.nDrawCalls++;
+
         m_SpriteVertices.clear();
     }
 }
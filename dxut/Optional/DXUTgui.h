@@ -381,6 +381,14 @@ struct DXUTSpriteVertex
     DirectX::XMFLOAT2 vTex;
 };
 
+// Work done by EndSprites11 since the last ResetSpriteStats
+struct DXUTSpriteStats
+{
+    UINT nSprites;          // Quads flushed
+    UINT nDrawCalls;
+    UINT nBytesMapped;
+};
+
 
 //-----------------------------------------------------------------------------
 // Manages shared resources of dialogs
@@ -405,6 +413,9 @@ public:
     void BeginSprites11( );
     void EndSprites11( _In_ ID3D11Device* pd3dDevice, _In_ ID3D11DeviceContext* pd3dImmediateContext );
 
+    const DXUTSpriteStats& GetSpriteStats() const { return m_SpriteStats; }
+    void ResetSpriteStats() { ZeroMemory( &m_SpriteStats, sizeof( m_SpriteStats ) ); }
+
     ID3D11Device* GetD3D11Device() const { return m_pd3d11Device; }
     ID3D11DeviceContext* GetD3D11DeviceContext() const { return m_pd3d11DeviceContext; }
 
@@ -449,6 +460,7 @@ public:
     ID3D11Buffer* m_pSpriteBuffer11;
     UINT m_SpriteBufferBytes11;
     std::vector<DXUTSpriteVertex> m_SpriteVertices;
+    DXUTSpriteStats m_SpriteStats;
 
     UINT m_nBackBufferWidth;
     UINT m_nBackBufferHeight;
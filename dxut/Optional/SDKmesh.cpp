@@ -461,14 +461,158 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     }
     // Update 
         
+    hr = LoadLODs( pDev11, pData, DataBytes, pLoaderCallbacks11 );
 
-
-    hr = S_OK;
 Error:
     return hr;
 }
 
 
+//--------------------------------------------------------------------------------------
+// Reads the optional LOD chain that follows the buffer data. The chain is validated as a
+// whole before any buffer is created; a chain that fails is dropped and the mesh renders
+// at full detail.
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::LoadLODs( ID3D11Device* pDev11,
+                                BYTE* pData,
+                                size_t DataBytes,
+                                SDKMESH_CALLBACKS11* pLoaderCallbacks11 )
+{
+    UINT64 LODOffset = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize + m_pMeshHeader->BufferDataSize;
+    LODOffset = ( LODOffset + 7 ) & ~UINT64( 7 );
+
+    if( LODOffset + sizeof( SDKMESH_LOD_HEADER ) > DataBytes )
+        return S_OK;
+
+    auto pLODHeader = reinterpret_cast<const SDKMESH_LOD_HEADER*>( pData + LODOffset );
+    if( pLODHeader->Magic != SDKMESH_LOD_MAGIC )
+        return S_OK;
+
+    if( pLODHeader->Version != SDKMESH_LOD_VERSION ||
+        pLODHeader->NumIndexBuffers != m_pMeshHeader->NumIndexBuffers ||
+        pLODHeader->SubsetLODOffset > DataBytes ||
+        pLODHeader->NumSubsetLODs * sizeof( SDKMESH_SUBSET_LOD ) > DataBytes - pLODHeader->SubsetLODOffset ||
+        pLODHeader->IndexStreamHeadersOffset > DataBytes ||
+        pLODHeader->NumIndexBuffers * sizeof( SDKMESH_INDEX_BUFFER_HEADER ) > DataBytes - pLODHeader->IndexStreamHeadersOffset )
+    {
+        DXUTTRACE( L"Invalid LOD header in sdkmesh file, loading at full detail\n" );
+        return S_OK;
+    }
+
+    auto pSubsetLODs = reinterpret_cast<const SDKMESH_SUBSET_LOD*>( pData + pLODHeader->SubsetLODOffset );
+    auto pLODHeaders = reinterpret_cast<const SDKMESH_INDEX_BUFFER_HEADER*>( pData + pLODHeader->IndexStreamHeadersOffset );
+
+    // Every LOD index buffer must lie within the file and use the same index format as the
+    // main buffer it replaces, since RenderMesh binds it with the main buffer's format
+    for( UINT i = 0; i < pLODHeader->NumIndexBuffers; i++ )
+    {
+        const SDKMESH_INDEX_BUFFER_HEADER& Header = pLODHeaders[i];
+        if( Header.IndexType != m_pIndexBufferArray[i].IndexType ||
+            Header.DataOffset > DataBytes || Header.SizeBytes > DataBytes - Header.DataOffset )
+        {
+            DXUTTRACE( L"Invalid LOD index buffer in sdkmesh file, loading at full detail\n" );
+            DestroyLODs();
+            return S_OK;
+        }
+    }
+
+    m_SubsetLODs.assign( pSubsetLODs, pSubsetLODs + pLODHeader->NumSubsetLODs );
+    m_SubsetLODFirst.assign( m_pMeshHeader->NumTotalSubsets, 0 );
+    m_SubsetLODCount.assign( m_pMeshHeader->NumTotalSubsets, 0 );
+
+    for( UINT i = 0; i < pLODHeader->NumSubsetLODs; i++ )
+    {
+        const SDKMESH_SUBSET_LOD& LOD = m_SubsetLODs[i];
+        bool bValid = LOD.Mesh < m_pMeshHeader->NumMeshes && LOD.Subset < m_pMeshArray[ LOD.Mesh ].NumSubsets &&
+                      m_pMeshArray[ LOD.Mesh ].IndexBuffer < pLODHeader->NumIndexBuffers;
+
+        UINT iSubset = bValid ? m_pMeshArray[ LOD.Mesh ].pSubsets[ LOD.Subset ] : 0;
+        bValid = bValid && iSubset < m_pMeshHeader->NumTotalSubsets;
+
+        // The level's index range must be non-empty and fit within its LOD buffer
+        if( bValid )
+        {
+            const SDKMESH_INDEX_BUFFER_HEADER& Header = pLODHeaders[ m_pMeshArray[ LOD.Mesh ].IndexBuffer ];
+            UINT64 IndexSize = ( Header.IndexType == IT_32BIT ) ? 4 : 2;
+            UINT64 NumIndices = Header.SizeBytes / IndexSize;
+            bValid = Header.SizeBytes > 0 && LOD.IndexCount > 0 && LOD.IndexStart <= NumIndices && LOD.IndexCount <= NumIndices - LOD.IndexStart;
+        }
+
+        // Levels of a subset are stored consecutively, starting at 1
+        if( bValid )
+        {
+            if( m_SubsetLODCount[iSubset] == 0 )
+                m_SubsetLODFirst[iSubset] = i;
+            bValid = LOD.Level == m_SubsetLODCount[iSubset] + 1 && m_SubsetLODFirst[iSubset] + m_SubsetLODCount[iSubset] == i &&
+                     LOD.Level <= MAX_SUBSET_LODS;
+        }
+
+        if( !bValid )
+        {
+            DXUTTRACE( L"Invalid subset LOD in sdkmesh file, loading at full detail\n" );
+            DestroyLODs();
+            return S_OK;
+        }
+
+        m_SubsetLODCount[iSubset]++;
+    }
+
+    m_pLODIndexBufferArray = new (std::nothrow) SDKMESH_INDEX_BUFFER_HEADER[ pLODHeader->NumIndexBuffers ];
+    if( !m_pLODIndexBufferArray )
+    {
+        DestroyLODs();
+        return E_OUTOFMEMORY;
+    }
+
+    // Clear the offsets out of the union first so that a partially created chain can be released
+    memcpy( m_pLODIndexBufferArray, pLODHeaders, pLODHeader->NumIndexBuffers * sizeof( SDKMESH_INDEX_BUFFER_HEADER ) );
+    for( UINT i = 0; i < pLODHeader->NumIndexBuffers; i++ )
+    {
+        m_pLODIndexBufferArray[i].pIB11 = nullptr;
+    }
+
+    if( pDev11 )
+    {
+        for( UINT i = 0; i < pLODHeader->NumIndexBuffers; i++ )
+        {
+            if( pLODHeaders[i].SizeBytes == 0 )
+                continue;
+
+            SDKMESH_INDEX_BUFFER_HEADER* pHeader = &m_pLODIndexBufferArray[i];
+            if( FAILED( CreateIndexBuffer( pDev11, pHeader, pData + pLODHeaders[i].DataOffset, pLoaderCallbacks11 ) ) )
+            {
+                DXUTTRACE( L"Failed to create LOD index buffer, loading at full detail\n" );
+                pHeader->pIB11 = nullptr;
+                DestroyLODs();
+                return S_OK;
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Releases the LOD chain; the mesh keeps rendering at full detail
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::DestroyLODs()
+{
+    if( m_pLODIndexBufferArray )
+    {
+        for( UINT64 i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+        {
+            SAFE_RELEASE( m_pLODIndexBufferArray[i].pIB11 );
+        }
+    }
+    SAFE_DELETE_ARRAY( m_pLODIndexBufferArray );
+    m_SubsetLODs.clear();
+    m_SubsetLODFirst.clear();
+    m_SubsetLODCount.clear();
+}
+
+
 //--------------------------------------------------------------------------------------
 // transform bind pose frame using a recursive traversal
 //--------------------------------------------------------------------------------------
@@ -602,11 +746,22 @@ void CDXUTSDKMesh::RenderMesh( UINT iMesh,
     if( pMesh->NumVertexBuffers > MAX_D3D11_VERTEX_STREAMS )
         return;
 
-    for( UINT64 i = 0; i < pMesh->NumVertexBuffers; i++ )
+    UINT NumStreams = pMesh->NumVertexBuffers;
+    if( m_bPositionOnly )
     {
-        pVB[i] = m_pVertexBufferArray[ pMesh->VertexBuffers[i] ].pVB11;
-        Strides[i] = ( UINT )m_pVertexBufferArray[ pMesh->VertexBuffers[i] ].StrideBytes;
-        Offsets[i] = 0;
+        NumStreams = 1;
+        pVB[0] = m_PositionVBs[ m_MeshPositionVB[iMesh] ];
+        Strides[0] = sizeof( XMFLOAT3 );
+        Offsets[0] = 0;
+    }
+    else
+    {
+        for( UINT64 i = 0; i < pMesh->NumVertexBuffers; i++ )
+        {
+            pVB[i] = m_pVertexBufferArray[ pMesh->VertexBuffers[i] ].pVB11;
+            Strides[i] = ( UINT )m_pVertexBufferArray[ pMesh->VertexBuffers[i] ].StrideBytes;
+            Offsets[i] = 0;
+        }
     }
 
     SDKMESH_INDEX_BUFFER_HEADER* pIndexBufferArray;
@@ -627,8 +782,9 @@ void CDXUTSDKMesh::RenderMesh( UINT iMesh,
         break;
     };
 
-    pd3dDeviceContext->IASetVertexBuffers( 0, pMesh->NumVertexBuffers, pVB, Strides, Offsets );
+    pd3dDeviceContext->IASetVertexBuffers( 0, NumStreams, pVB, Strides, Offsets );
     pd3dDeviceContext->IASetIndexBuffer( pIB, ibFormat, 0 );
+    auto pBoundIB = pIB;
 
     SDKMESH_SUBSET* pSubset = nullptr;
     SDKMESH_MATERIAL* pMat = nullptr;
@@ -676,6 +832,27 @@ void CDXUTSDKMesh::RenderMesh( UINT iMesh,
             IndexCount *= 2;
             IndexStart *= 2;
         }
+        else if( m_bLODEnabled && m_pLODIndexBufferArray )
+        {
+            UINT Level = SelectSubsetLOD( pMesh->pSubsets[subset] );
+            auto pSubsetIB = pIB;
+            if( Level > 0 )
+            {
+                const SDKMESH_SUBSET_LOD& LOD = m_SubsetLODs[ m_SubsetLODFirst[ pMesh->pSubsets[subset] ] + Level - 1 ];
+                IndexCount = ( UINT )LOD.IndexCount;
+                IndexStart = ( UINT )LOD.IndexStart;
+                pSubsetIB = m_pLODIndexBufferArray[ pMesh->IndexBuffer ].pIB11;
+            }
+
+            if( pSubsetIB != pBoundIB )
+            {
+                pd3dDeviceContext->IASetIndexBuffer( pSubsetIB, ibFormat, 0 );
+                pBoundIB = pSubsetIB;
+            }
+        }
+
+        m_NumTrianglesRendered += IndexCount / 3;
+        m_NumDrawCalls++;
 
         pd3dDeviceContext->DrawIndexed( IndexCount, IndexStart, VertexStart );
     }
@@ -723,6 +900,13 @@ CDXUTSDKMesh::CDXUTSDKMesh() : m_NumOutstandingResources( 0 ),
                                m_pStaticMeshData( nullptr ),
                                m_pHeapData( nullptr ),
                                m_pAdjacencyIndexBufferArray( nullptr ),
+                               m_pLODIndexBufferArray( nullptr ),
+                               m_bLODEnabled( false ),
+                               m_fLODViewportHeight( 0.0f ),
+                               m_fLODPixelError( 1.0f ),
+                               m_NumTrianglesRendered( 0 ),
+                               m_NumDrawCalls( 0 ),
+                               m_bPositionOnly( false ),
                                m_pAnimationData( nullptr ),
                                m_pAnimationHeader( nullptr ),
                                m_ppVertices( nullptr ),
@@ -856,14 +1040,18 @@ void CDXUTSDKMesh::Destroy()
                 }
             }
         }
-        for( UINT64 i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+        // Without a device the buffer headers still hold file offsets rather than buffers
+        if( m_pDev11 )
         {
-            SAFE_RELEASE( m_pVertexBufferArray[i].pVB11 );
-        }
+            for( UINT64 i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
+            {
+                SAFE_RELEASE( m_pVertexBufferArray[i].pVB11 );
+            }
 
-        for( UINT64 i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
-        {
-            SAFE_RELEASE( m_pIndexBufferArray[i].pIB11 );
+            for( UINT64 i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
+            {
+                SAFE_RELEASE( m_pIndexBufferArray[i].pIB11 );
+            }
         }
     }
 
@@ -876,6 +1064,15 @@ void CDXUTSDKMesh::Destroy()
     }
     SAFE_DELETE_ARRAY( m_pAdjacencyIndexBufferArray );
 
+    DestroyLODs();
+
+    for( size_t i = 0; i < m_PositionVBs.size(); i++ )
+    {
+        SAFE_RELEASE( m_PositionVBs[i] );
+    }
+    m_PositionVBs.clear();
+    m_MeshPositionVB.clear();
+
     SAFE_DELETE_ARRAY( m_pHeapData );
     m_pStaticMeshData = nullptr;
     SAFE_DELETE_ARRAY( m_pAnimationData );
@@ -936,6 +1133,8 @@ void CDXUTSDKMesh::Render( ID3D11DeviceContext* pd3dDeviceContext,
                            UINT iNormalSlot,
                            UINT iSpecularSlot )
 {
+    m_NumTrianglesRendered = 0;
+    m_NumDrawCalls = 0;
     RenderFrame( 0, false, pd3dDeviceContext, iDiffuseSlot, iNormalSlot, iSpecularSlot );
 }
 
@@ -946,10 +1145,232 @@ void CDXUTSDKMesh::RenderAdjacent( ID3D11DeviceContext* pd3dDeviceContext,
                                    UINT iNormalSlot,
                                    UINT iSpecularSlot )
 {
+    m_NumTrianglesRendered = 0;
+    m_NumDrawCalls = 0;
     RenderFrame( 0, true, pd3dDeviceContext, iDiffuseSlot, iNormalSlot, iSpecularSlot );
 }
 
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool CDXUTSDKMesh::FindPositionElement( UINT iVB, UINT* pOffset ) const
+{
+    const D3DVERTEXELEMENT9* pDecl = m_pVertexBufferArray[iVB].Decl;
+
+    for( UINT i = 0; i < MAX_VERTEX_ELEMENTS && pDecl[i].Stream != 0xFF; i++ )
+    {
+        if( pDecl[i].Usage == D3DDECLUSAGE_POSITION && pDecl[i].UsageIndex == 0 &&
+            ( pDecl[i].Type == D3DDECLTYPE_FLOAT3 || pDecl[i].Type == D3DDECLTYPE_FLOAT4 ) )
+        {
+            *pOffset = pDecl[i].Offset;
+            return true;
+        }
+    }
+
+    *pOffset = 0;
+    return false;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::ExtractPositions( UINT iVB, std::vector<XMFLOAT3>& Positions ) const
+{
+    UINT Offset = 0;
+    if( !m_pMeshHeader || iVB >= m_pMeshHeader->NumVertexBuffers || !FindPositionElement( iVB, &Offset ) )
+        return E_FAIL;
+
+    const SDKMESH_VERTEX_BUFFER_HEADER* pHeader = &m_pVertexBufferArray[iVB];
+    const BYTE* pVertices = m_ppVertices[iVB] + Offset;
+
+    Positions.resize( ( size_t )pHeader->NumVertices );
+    for( size_t i = 0; i < Positions.size(); i++ )
+    {
+        memcpy( &Positions[i], pVertices + i * pHeader->StrideBytes, sizeof( XMFLOAT3 ) );
+    }
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CDXUTSDKMesh::CreatePositionStreams( ID3D11Device* pDev11 )
+{
+    HRESULT hr = S_OK;
+
+    if( !m_pMeshHeader || !m_ppVertices )
+        return E_FAIL;
+
+    for( size_t i = 0; i < m_PositionVBs.size(); i++ )
+    {
+        SAFE_RELEASE( m_PositionVBs[i] );
+    }
+    m_PositionVBs.assign( ( size_t )m_pMeshHeader->NumVertexBuffers, nullptr );
+    m_MeshPositionVB.assign( m_pMeshHeader->NumMeshes, UINT_MAX );
+
+    std::vector<XMFLOAT3> Positions;
+    for( UINT iMesh = 0; iMesh < m_pMeshHeader->NumMeshes && SUCCEEDED( hr ); iMesh++ )
+    {
+        const SDKMESH_MESH* pMesh = &m_pMeshArray[iMesh];
+        for( UINT i = 0; i < pMesh->NumVertexBuffers; i++ )
+        {
+            UINT Offset;
+            if( FindPositionElement( pMesh->VertexBuffers[i], &Offset ) )
+            {
+                m_MeshPositionVB[iMesh] = pMesh->VertexBuffers[i];
+                break;
+            }
+        }
+
+        // Every mesh needs positions, or a depth prepass would be missing it
+        const UINT iVB = m_MeshPositionVB[iMesh];
+        if( iVB == UINT_MAX )
+        {
+            hr = E_FAIL;
+            break;
+        }
+        if( m_PositionVBs[iVB] )
+            continue;
+
+        V( ExtractPositions( iVB, Positions ) );
+        if( SUCCEEDED( hr ) && Positions.empty() )
+            hr = E_FAIL;
+        if( FAILED( hr ) )
+            break;
+
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.ByteWidth = ( UINT )( Positions.size() * sizeof( XMFLOAT3 ) );
+        bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA InitData;
+        InitData.pSysMem = &Positions[0];
+        InitData.SysMemPitch = 0;
+        InitData.SysMemSlicePitch = 0;
+
+        V( pDev11->CreateBuffer( &bufferDesc, &InitData, &m_PositionVBs[iVB] ) );
+        DXUT_SetDebugName( m_PositionVBs[iVB], "CDXUTSDKMesh positions" );
+    }
+
+    if( FAILED( hr ) )
+    {
+        for( size_t i = 0; i < m_PositionVBs.size(); i++ )
+        {
+            SAFE_RELEASE( m_PositionVBs[i] );
+        }
+        m_PositionVBs.clear();
+        m_MeshPositionVB.clear();
+    }
+
+    return hr;
+}
+
+//--------------------------------------------------------------------------------------
+ID3D11Buffer* CDXUTSDKMesh::GetPositionVB11( _In_ UINT iMesh ) const
+{
+    if( iMesh >= m_MeshPositionVB.size() )
+        return nullptr;
+    return m_PositionVBs[ m_MeshPositionVB[iMesh] ];
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::RenderPositionOnly( ID3D11DeviceContext* pd3dDeviceContext )
+{
+    if( m_PositionVBs.empty() )
+        return;
+
+    m_NumTrianglesRendered = 0;
+    m_NumDrawCalls = 0;
+    m_bPositionOnly = true;
+    RenderFrame( 0, false, pd3dDeviceContext, INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT );
+    m_bPositionOnly = false;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void CDXUTSDKMesh::SetLODView( CXMMATRIX mWorldViewProjection, float fViewportHeight, float fMaxPixelError )
+{
+    XMStoreFloat4x4( &m_mLODWorldViewProjection, mWorldViewProjection );
+    m_fLODViewportHeight = fViewportHeight;
+    m_fLODPixelError = fMaxPixelError;
+    m_bLODEnabled = true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Picks the LOD level for a subset (0 is full detail) from the projected size of its
+// bounding box. The error of each level is in object space, so it is converted to pixels
+// using the ratio of the projected size to the size of the box.
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::SelectSubsetLOD( _In_ UINT iSubset ) const
+{
+    UINT Count = m_SubsetLODCount[iSubset];
+    if( !m_bLODEnabled || Count == 0 )
+        return 0;
+
+    const SDKMESH_SUBSET_LOD* pLODs = &m_SubsetLODs[ m_SubsetLODFirst[iSubset] ];
+
+    XMMATRIX mWorldViewProjection = XMLoadFloat4x4( &m_mLODWorldViewProjection );
+    XMVECTOR vCenter = XMLoadFloat3( &pLODs[0].BoundingBoxCenter );
+    XMVECTOR vExtents = XMLoadFloat3( &pLODs[0].BoundingBoxExtents );
+    XMVECTOR vMin = XMVectorReplicate( FLT_MAX );
+    XMVECTOR vMax = XMVectorReplicate( -FLT_MAX );
+
+    for( UINT i = 0; i < 8; i++ )
+    {
+        XMVECTOR vSign = XMVectorSet( ( i & 1 ) ? 1.0f : -1.0f, ( i & 2 ) ? 1.0f : -1.0f, ( i & 4 ) ? 1.0f : -1.0f, 0.0f );
+        XMVECTOR vCorner = XMVector3Transform( XMVectorMultiplyAdd( vExtents, vSign, vCenter ), mWorldViewProjection );
+
+        // Boxes crossing the near plane are always drawn at full detail
+        float w = XMVectorGetW( vCorner );
+        if( w <= 1e-4f )
+            return 0;
+
+        vCorner = XMVectorScale( vCorner, 1.0f / w );
+        vMin = XMVectorMin( vMin, vCorner );
+        vMax = XMVectorMax( vMax, vCorner );
+    }
+
+    float fDiagonal = 2.0f * XMVectorGetX( XMVector3Length( vExtents ) );
+    if( fDiagonal <= 0.0f )
+        return Count;
+
+    // NDC spans two units across the viewport
+    XMVECTOR vSize = XMVectorSubtract( vMax, vMin );
+    float fProjectedSize = std::max( XMVectorGetX( vSize ), XMVectorGetY( vSize ) ) * 0.5f * m_fLODViewportHeight;
+    float fPixelsPerUnit = fProjectedSize / fDiagonal;
+
+    UINT Level = 0;
+    while( Level < Count && pLODs[Level].Error * fPixelsPerUnit <= m_fLODPixelError )
+        Level++;
+
+    return Level;
+}
+
+
+//--------------------------------------------------------------------------------------
+UINT CDXUTSDKMesh::GetNumSubsetLODs( _In_ UINT iMesh, _In_ UINT iSubset ) const
+{
+    if( m_SubsetLODCount.empty() )
+        return 0;
+
+    return m_SubsetLODCount[ m_pMeshArray[ iMesh ].pSubsets[ iSubset ] ];
+}
+
+
+//--------------------------------------------------------------------------------------
+const SDKMESH_SUBSET_LOD* CDXUTSDKMesh::GetSubsetLOD( _In_ UINT iMesh, _In_ UINT iSubset, _In_ UINT iLevel ) const
+{
+    if( iLevel == 0 || iLevel > GetNumSubsetLODs( iMesh, iSubset ) )
+        return nullptr;
+
+    return &m_SubsetLODs[ m_SubsetLODFirst[ m_pMeshArray[ iMesh ].pSubsets[ iSubset ] ] + iLevel - 1 ];
+}
+
+
 //--------------------------------------------------------------------------------------
 D3D11_PRIMITIVE_TOPOLOGY CDXUTSDKMesh::GetPrimitiveType11( _In_ SDKMESH_PRIMITIVE_TYPE PrimType )
 {
@@ -1091,6 +1512,12 @@ BYTE* CDXUTSDKMesh::GetRawIndicesAt( _In_ UINT iIB ) const
     return m_ppIndices[iIB];
 }
 
+//--------------------------------------------------------------------------------------
+const D3DVERTEXELEMENT9* CDXUTSDKMesh::GetVertexDeclAt( _In_ UINT iVB ) const
+{
+    return m_pVertexBufferArray[iVB].Decl;
+}
+
 //--------------------------------------------------------------------------------------
 SDKMESH_MATERIAL* CDXUTSDKMesh::GetMaterial( _In_ UINT iMaterial ) const
 {
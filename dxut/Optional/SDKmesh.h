@@ -40,6 +40,9 @@
 #define INVALID_ANIMATION_DATA ((UINT)-1)
 #define INVALID_SAMPLER_SLOT ((UINT)-1)
 #define ERROR_RESOURCE_VALUE 1
+#define SDKMESH_LOD_MAGIC 0x444F4C53 // 'SLOD'
+#define SDKMESH_LOD_VERSION 1
+#define MAX_SUBSET_LODS 8
 
 template<typename TYPE> BOOL IsErrorResource( TYPE data )
 {
@@ -260,6 +263,35 @@ struct SDKANIMATION_FRAME_DATA
     };
 };
 
+//--------------------------------------------------------------------------------------
+// Optional LOD chain, stored after the buffer data (aligned to 8 bytes) so that older
+// loaders ignore it. There is one LOD index buffer per index buffer of the file, with the
+// same index type; LOD indices refer to the original vertex buffers.
+//--------------------------------------------------------------------------------------
+struct SDKMESH_LOD_HEADER
+{
+    UINT Magic;
+    UINT Version;
+    UINT NumSubsetLODs;
+    UINT NumIndexBuffers;
+
+    //Offsets from the start of the file
+    UINT64 SubsetLODOffset;
+    UINT64 IndexStreamHeadersOffset;
+};
+
+struct SDKMESH_SUBSET_LOD
+{
+    UINT Mesh;
+    UINT Subset;                    //Index into the mesh's subset list
+    UINT Level;                     //1 is the first simplified level, entries are sorted by mesh, subset and level
+    float Error;                    //Object space distance from the full detail surface
+    DirectX::XMFLOAT3 BoundingBoxCenter;    //Bounds of the full detail subset
+    DirectX::XMFLOAT3 BoundingBoxExtents;
+    UINT64 IndexStart;              //Range in the LOD index buffer of the mesh's IndexBuffer
+    UINT64 IndexCount;
+};
+
 #pragma pack(pop)
 
 static_assert( sizeof(D3DVERTEXELEMENT9) == 8, "Direct3D9 Decl structure size incorrect" );
@@ -273,6 +305,8 @@ static_assert( sizeof(SDKMESH_MATERIAL) == 1256, "SDK Mesh structure size incorr
 static_assert( sizeof(SDKANIMATION_FILE_HEADER) == 40, "SDK Mesh structure size incorrect" );
 static_assert( sizeof(SDKANIMATION_DATA) == 40, "SDK Mesh structure size incorrect" );
 static_assert( sizeof(SDKANIMATION_FRAME_DATA) == 112, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_LOD_HEADER) == 32, "SDK Mesh structure size incorrect" );
+static_assert( sizeof(SDKMESH_SUBSET_LOD) == 56, "SDK Mesh structure size incorrect" );
 
 #ifndef _CONVERTER_APP_
 
@@ -332,6 +366,27 @@ protected:
     // Adjacency information (not part of the m_pStaticMeshData, so it must be created and destroyed separately )
     SDKMESH_INDEX_BUFFER_HEADER* m_pAdjacencyIndexBufferArray;
 
+    // LOD chain (not part of the m_pStaticMeshData either). m_SubsetLODFirst holds the first
+    // entry in m_SubsetLODs for every subset in the file, m_SubsetLODCount the number of levels.
+    SDKMESH_INDEX_BUFFER_HEADER* m_pLODIndexBufferArray;
+    std::vector<SDKMESH_SUBSET_LOD> m_SubsetLODs;
+    std::vector<UINT> m_SubsetLODFirst;
+    std::vector<UINT> m_SubsetLODCount;
+
+    // LOD selection
+    bool m_bLODEnabled;
+    DirectX::XMFLOAT4X4 m_mLODWorldViewProjection;
+    float m_fLODViewportHeight;
+    float m_fLODPixelError;
+    UINT64 m_NumTrianglesRendered;
+    UINT m_NumDrawCalls;
+
+    // Tightly packed float3 positions for depth-only passes, one buffer per vertex buffer of
+    // the file (nullptr if unused), and the vertex buffer each mesh reads its positions from
+    std::vector<ID3D11Buffer*> m_PositionVBs;
+    std::vector<UINT> m_MeshPositionVB;
+    bool m_bPositionOnly;
+
     //Animation
     SDKANIMATION_FILE_HEADER* m_pAnimationHeader;
     SDKANIMATION_FRAME_DATA* m_pAnimationFrameData;
@@ -361,6 +416,13 @@ protected:
                                       _In_ bool bCopyStatic,
                                       _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks11 = nullptr );
 
+    HRESULT LoadLODs( _In_opt_ ID3D11Device* pDev11,
+                      _In_reads_(DataBytes) BYTE* pData,
+                      _In_ size_t DataBytes,
+                      _In_opt_ SDKMESH_CALLBACKS11* pLoaderCallbacks11 = nullptr );
+    void DestroyLODs();
+    UINT SelectSubsetLOD( _In_ UINT iSubset ) const;
+
     //frame manipulation
     void TransformBindPoseFrame( _In_ UINT iFrame, _In_ DirectX::CXMMATRIX parentWorld );
     void TransformFrame( _In_ UINT iFrame, _In_ DirectX::CXMMATRIX parentWorld, _In_ double fTime );
@@ -404,6 +466,28 @@ public:
                                  _In_ UINT iNormalSlot = INVALID_SAMPLER_SLOT,
                                  _In_ UINT iSpecularSlot = INVALID_SAMPLER_SLOT );
 
+    //LOD selection. Once enabled, Render draws the coarsest level of each subset whose error,
+    //scaled by the subset's projected size, is below fMaxPixelError pixels.
+    void SetLODView( _In_ DirectX::CXMMATRIX mWorldViewProjection, _In_ float fViewportHeight, _In_ float fMaxPixelError = 1.0f );
+    void DisableLOD() { m_bLODEnabled = false; }
+    bool HasLODs() const { return !m_SubsetLODs.empty(); }
+    UINT GetNumSubsetLODs( _In_ UINT iMesh, _In_ UINT iSubset ) const;
+    const SDKMESH_SUBSET_LOD* GetSubsetLOD( _In_ UINT iMesh, _In_ UINT iSubset, _In_ UINT iLevel ) const;
+
+    // Triangles and draw calls of the last Render, RenderAdjacent or RenderPositionOnly call
+    UINT64 GetNumTrianglesRendered() const { return m_NumTrianglesRendered; }
+    UINT GetNumDrawCalls() const { return m_NumDrawCalls; }
+
+    //Position-only streams. CreatePositionStreams copies the positions of every mesh into a
+    //separate 12 byte per vertex buffer, which RenderPositionOnly binds to slot 0 instead of
+    //the full vertex streams. It draws the same subsets and LODs as Render, without materials.
+    bool FindPositionElement( _In_ UINT iVB, _Out_ UINT* pOffset ) const;
+    HRESULT ExtractPositions( _In_ UINT iVB, _Inout_ std::vector<DirectX::XMFLOAT3>& Positions ) const;
+    HRESULT CreatePositionStreams( _In_ ID3D11Device* pDev11 );
+    bool HasPositionStreams() const { return !m_PositionVBs.empty(); }
+    ID3D11Buffer* GetPositionVB11( _In_ UINT iMesh ) const;
+    void RenderPositionOnly( _In_ ID3D11DeviceContext* pd3dDeviceContext );
+
     //Helpers (D3D11 specific)
     static D3D11_PRIMITIVE_TOPOLOGY GetPrimitiveType11( _In_ SDKMESH_PRIMITIVE_TYPE PrimType );
     DXGI_FORMAT GetIBFormat11( _In_ UINT iMesh ) const;
@@ -426,6 +510,7 @@ public:
 
     BYTE* GetRawVerticesAt( _In_ UINT iVB ) const;
     BYTE* GetRawIndicesAt( _In_ UINT iIB ) const;
+    const D3DVERTEXELEMENT9* GetVertexDeclAt( _In_ UINT iVB ) const;
 
     SDKMESH_MATERIAL* GetMaterial( _In_ UINT iMaterial ) const;
     SDKMESH_MESH*     GetMesh( _In_ UINT iMesh ) const;